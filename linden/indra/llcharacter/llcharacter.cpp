@@ -39,6 +39,8 @@
 #include "llcharacter.h"
 #include "llstring.h"
 #include "llfasttimer.h"
+#include "llcriticaldamp.h"
+#include "llthreadpool.h"
 
 #define SKEL_HEADER "Linden Skeleton 1.0"
 
@@ -57,6 +59,7 @@ LLCharacter::LLCharacter()
 	mSex( SEX_FEMALE ),
 	mAppearanceSerialNum( 0 ),
 	mSkeletonSerialNum( 0 ),
+	mAnimationLOD( ANIMATION_LOD_FULL ),
 	mInAppearance( false )
 {
 	mMotionController.setCharacter( this );
@@ -105,6 +108,31 @@ LLJoint *LLCharacter::getJoint( const std::string &name )
 	return joint;
 }
 
+//-----------------------------------------------------------------------------
+// markAnimationDetailJoints()
+//-----------------------------------------------------------------------------
+void LLCharacter::markAnimationDetailJoints()
+{
+	// joints whose motion is too small to notice once the avatar covers
+	// only a few pixels
+	static const char* DETAIL_JOINT_NAMES[] =
+	{
+		"mSkull", "mEyeLeft", "mEyeRight",
+		"mCollarLeft", "mCollarRight", "mWristLeft", "mWristRight",
+		"mAnkleLeft", "mAnkleRight", "mFootLeft", "mFootRight",
+		"mToeLeft", "mToeRight"
+	};
+
+	for (S32 i = 0; i < (S32)LL_ARRAY_SIZE(DETAIL_JOINT_NAMES); i++)
+	{
+		LLJoint* joint = getJoint(DETAIL_JOINT_NAMES[i]);
+		if (joint)
+		{
+			joint->mAnimationDetail = TRUE;
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 // registerMotion()
 //-----------------------------------------------------------------------------
@@ -182,23 +210,102 @@ void LLCharacter::requestStopMotion( LLMotion* motion)
 //-----------------------------------------------------------------------------
 // updateMotions()
 //-----------------------------------------------------------------------------
-void LLCharacter::updateMotions(e_update_t update_type)
+BOOL LLCharacter::updateMotions(e_update_t update_type)
+{
+	LLFastTimer t(LLFastTimer::FTM_UPDATE_ANIMATION);
+	if (prepareMotionUpdate(update_type))
+	{
+		mMotionController.blendMotions();
+		mMotionController.endUpdate();
+		return TRUE;
+	}
+	return FALSE;
+}
+
+//-----------------------------------------------------------------------------
+// beginMotionUpdate()
+//-----------------------------------------------------------------------------
+BOOL LLCharacter::beginMotionUpdate(e_update_t update_type)
+{
+	LLFastTimer t(LLFastTimer::FTM_UPDATE_ANIMATION);
+	return prepareMotionUpdate(update_type);
+}
+
+//-----------------------------------------------------------------------------
+// endMotionUpdate()
+//-----------------------------------------------------------------------------
+void LLCharacter::endMotionUpdate()
 {
 	LLFastTimer t(LLFastTimer::FTM_UPDATE_ANIMATION);
+	mMotionController.endUpdate();
+}
+
+//-----------------------------------------------------------------------------
+// prepareMotionUpdate()
+//-----------------------------------------------------------------------------
+BOOL LLCharacter::prepareMotionUpdate(e_update_t update_type)
+{
 	if (update_type == HIDDEN_UPDATE)
 	{
 		mMotionController.updateMotionsMinimal();
+		return FALSE;
 	}
-	else
+
+	// unpause if the number of outstanding pause requests has dropped to the initial one
+	if (mMotionController.isPaused() && mPauseRequest->getNumRefs() == 1)
+	{
+		mMotionController.unpauseAllMotions();
+	}
+	bool force_update = (update_type == FORCE_UPDATE);
+	return mMotionController.beginUpdate(force_update);
+}
+
+//-----------------------------------------------------------------------------
+// blendMotionsParallel()
+//-----------------------------------------------------------------------------
+namespace
+{
+	class BlendMotionsJob : public LLThreadPool::Job
 	{
-		// unpause if the number of outstanding pause requests has dropped to the initial one
-		if (mMotionController.isPaused() && mPauseRequest->getNumRefs() == 1)
+	public:
+		BlendMotionsJob(const std::vector<LLCharacter*>& characters) : mCharacters(characters) {}
+
+		/*virtual*/ void run(S32 begin, S32 end)
 		{
-			mMotionController.unpauseAllMotions();
+			for (S32 i = begin; i < end; i++)
+			{
+				LLCharacter* character = mCharacters[i];
+				character->blendMotions();
+				character->getRootJoint()->updateWorldMatrixChildren();
+			}
 		}
-		bool force_update = (update_type == FORCE_UPDATE);
-		mMotionController.updateMotions(force_update);
+
+	private:
+		const std::vector<LLCharacter*>& mCharacters;
+	};
+}
+
+//static
+void LLCharacter::blendMotionsParallel(const std::vector<LLCharacter*>& characters, bool threaded)
+{
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	if (characters.empty())
+	{
+		return;
+	}
+
+	BlendMotionsJob job(characters);
+	// Motions share the interpolant cache; keep it read only while they run.
+	LLCriticalDamp::setCacheFrozen(TRUE);
+	if (pool)
+	{
+		pool->parallelFor(job, (S32)characters.size(), 1, threaded);
+	}
+	else
+	{
+		job.run(0, (S32)characters.size());
 	}
+	LLCriticalDamp::setCacheFrozen(FALSE);
 }
 
 
@@ -37,6 +37,7 @@
 // Header Files
 //-----------------------------------------------------------------------------
 #include <string>
+#include <vector>
 
 #include "lljoint.h"
 #include "llmotioncontroller.h"
@@ -165,14 +166,49 @@ public:
 	virtual void requestStopMotion( LLMotion* motion );
 	
 	// periodic update function, steps the motion controller
+	// returns TRUE if the motions were blended this time, FALSE if the pose
+	// was only interpolated or the character is hidden or paused
 	enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
-	void updateMotions(e_update_t update_type);
+	BOOL updateMotions(e_update_t update_type);
+
+	// updateMotions() split for the parallel animation stage. Call
+	// beginMotionUpdate() on the main thread; if it returns TRUE, call
+	// blendMotions() (any thread) and then endMotionUpdate() (main thread).
+	BOOL beginMotionUpdate(e_update_t update_type);
+	void blendMotions() { mMotionController.blendMotions(); }
+	void endMotionUpdate();
+
+	// Runs blendMotions() and the world matrix update of the root joint for
+	// each character, spread over the LLThreadPool when threaded is true.
+	// Results do not depend on threaded. Each character must have returned
+	// TRUE from beginMotionUpdate().
+	static void blendMotionsParallel(const std::vector<LLCharacter*>& characters, bool threaded);
 
 	LLAnimPauseRequest requestPause();
 	BOOL areAnimationsPaused() { return mMotionController.isPaused(); }
 	void setAnimTimeFactor(F32 factor) { mMotionController.setTimeFactor(factor); }
 	void setTimeStep(F32 time_step) { mMotionController.setTimeStep(time_step); }
 
+	// Animation level of detail, picked by the owner from screen size and
+	// load. Coarser levels should come with a longer setTimeStep(); from
+	// ANIMATION_LOD_LOW on, motions leave the detail joints (see
+	// markAnimationDetailJoints()) alone and skip constraint solving.
+	enum EAnimationLOD
+	{
+		ANIMATION_LOD_FULL = 0,
+		ANIMATION_LOD_REDUCED,		// constraints at minimum iterations
+		ANIMATION_LOD_LOW,			// no detail joints, no constraints
+		ANIMATION_LOD_MINIMAL,
+		ANIMATION_LOD_COUNT
+	};
+	void setAnimationLOD(EAnimationLOD lod)	{ mAnimationLOD = lod; }
+	EAnimationLOD getAnimationLOD() const	{ return mAnimationLOD; }
+	BOOL animateDetailJoints() const		{ return mAnimationLOD < ANIMATION_LOD_LOW; }
+
+	// Flags the small joints of the standard skeleton as detail joints.
+	// Call after building the skeleton.
+	void markAnimationDetailJoints();
+
 	LLMotionController& getMotionController() { return mMotionController; }
 	
 	// Releases all motion instances which should result in
@@ -291,11 +327,14 @@ protected:
 	U32					mAppearanceSerialNum;
 	U32					mSkeletonSerialNum;
 	LLAnimPauseRequest	mPauseRequest;
+	EAnimationLOD		mAnimationLOD;
 
 	BOOL mInAppearance;
 
 
 private:
+	BOOL prepareMotionUpdate(e_update_t update_type);
+
 	// visual parameter stuff
 	typedef std::map<S32, LLVisualParam *>    VisualParamIndexMap_t;
 	VisualParamIndexMap_t mVisualParamIndexMap;
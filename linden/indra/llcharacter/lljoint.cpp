@@ -39,8 +39,9 @@
 
 #include "llmath.h"
 
-S32 LLJoint::sNumUpdates = 0;
-S32 LLJoint::sNumTouches = 0;
+// zero initialized, before APR is
+LLAtomicS32 LLJoint::sNumUpdates;
+LLAtomicS32 LLJoint::sNumTouches;
 
 //-----------------------------------------------------------------------------
 // LLJoint()
@@ -55,6 +56,7 @@ LLJoint::LLJoint()
 	mDirtyFlags = MATRIX_DIRTY | ROTATION_DIRTY | POSITION_DIRTY;
 	mUpdateXform = TRUE;
 	mJointNum = -1;
+	mAnimationDetail = FALSE;
 	touch();
 }
 
@@ -71,6 +73,7 @@ LLJoint::LLJoint(const std::string &name, LLJoint *parent)
 	mXform.setScale(LLVector3(1.0f, 1.0f, 1.0f));
 	mDirtyFlags = MATRIX_DIRTY | ROTATION_DIRTY | POSITION_DIRTY;
 	mJointNum = 0;
+	mAnimationDetail = FALSE;
 
 	setName(name);
 	if (parent)
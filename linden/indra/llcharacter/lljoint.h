@@ -45,6 +45,7 @@
 #include "llquaternion.h"
 #include "xform.h"
 #include "lldarray.h"
+#include "llapr.h"
 
 const S32 LL_CHARACTER_MAX_JOINTS_PER_MESH = 15;
 const U32 LL_CHARACTER_MAX_JOINTS = 32; // must be divisible by 4!
@@ -96,13 +97,17 @@ public:
 
 	S32				mJointNum;
 
+	// Small joints (eyes, toes, ...) that motions may leave alone on
+	// characters at a coarse animation LOD, see LLCharacter::setAnimationLOD().
+	BOOL			mAnimationDetail;
+
 	// child joints
 	typedef std::list<LLJoint*> child_list_t;
 	child_list_t mChildren;
 
-	// debug statics
-	static S32		sNumTouches;
-	static S32		sNumUpdates;
+	// debug statics, atomic since skeletons are updated on the thread pool
+	static LLAtomicS32	sNumTouches;
+	static LLAtomicS32	sNumUpdates;
 
 public:
 	LLJoint();
@@ -35,6 +35,8 @@
 //-----------------------------------------------------------------------------
 #include "linden_common.h"
 
+#include <algorithm>
+
 #include "llmath.h"
 #include "llanimationstates.h"
 #include "llassetstorage.h"
@@ -109,16 +111,16 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 		if (joint_motion_p->mUsage & LLJointState::ROT)
 		{
 			llinfos << "\t" << joint_motion_p->mRotationCurve.mNumKeys << " rotation keys at " 
-			<< joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey) << " bytes" << llendl;
+			<< joint_motion_p->mRotationCurve.getMemoryUsage() << " bytes" << llendl;
 
-			total_size += joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey);
+			total_size += joint_motion_p->mRotationCurve.getMemoryUsage();
 		}
 		if (joint_motion_p->mUsage & LLJointState::POS)
 		{
 			llinfos << "\t" << joint_motion_p->mPositionCurve.mNumKeys << " position keys at " 
-			<< joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey) << " bytes" << llendl;
+			<< joint_motion_p->mPositionCurve.getMemoryUsage() << " bytes" << llendl;
 
-			total_size += joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey);
+			total_size += joint_motion_p->mPositionCurve.getMemoryUsage();
 		}
 	}
 	llinfos << "Size: " << total_size << " bytes" << llendl;
@@ -126,6 +128,19 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 	return total_size;
 }
 
+U32 LLKeyframeMotion::JointMotionList::getMemoryUsage() const
+{
+	U32 total_size = sizeof(JointMotionList) + mJointMotionArray.capacity() * sizeof(JointMotion*);
+	for (U32 i = 0; i < getNumJointMotions(); i++)
+	{
+		const JointMotion* joint_motion_p = mJointMotionArray[i];
+		total_size += sizeof(JointMotion)
+					+ joint_motion_p->mRotationCurve.getMemoryUsage()
+					+ joint_motion_p->mPositionCurve.getMemoryUsage();
+	}
+	return total_size;
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // ****Curve classes
@@ -213,6 +228,72 @@ LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, ScaleKey& before, ScaleKey
 	}
 }
 
+template<class KEY>
+struct earlier_key
+{
+	bool operator()(const KEY& a, const KEY& b) const { return a.mTime < b.mTime; }
+};
+
+// Sorts keys by time and drops all but the last of any that share a time,
+// as the std::map the keys used to live in did.
+template<class KEY>
+static void sort_keys(std::vector<KEY>& keys)
+{
+	std::stable_sort(keys.begin(), keys.end(), earlier_key<KEY>());
+
+	S32 count = 0;
+	for (S32 i = 0; i < (S32)keys.size(); i++)
+	{
+		if (count && keys[count - 1].mTime == keys[i].mTime)
+		{
+			keys[count - 1] = keys[i];
+		}
+		else
+		{
+			keys[count++] = keys[i];
+		}
+	}
+	keys.resize(count);
+}
+
+inline F32 key_time(U16 time, F32 duration)
+{
+	return U16_to_F32(time, 0.f, duration);
+}
+
+// Returns the index of the first key at or after time, like
+// std::map::lower_bound(). cursor is the previous answer: playback normally
+// moves forward a key at a time so this rarely searches.
+template<class KEY>
+static S32 find_key(const std::vector<KEY>& keys, F32 time, F32 duration, S32 cursor)
+{
+	S32 count = (S32)keys.size();
+	if (cursor > count || (cursor > 0 && key_time(keys[cursor - 1].mTime, duration) >= time))
+	{
+		// moved back, usually a loop: binary search
+		S32 low = 0;
+		S32 high = llmin(cursor, count);
+		while (low < high)
+		{
+			S32 mid = (low + high) / 2;
+			if (key_time(keys[mid].mTime, duration) < time)
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		return low;
+	}
+	while (cursor < count && key_time(keys[cursor].mTime, duration) < time)
+	{
+		cursor++;
+	}
+	return cursor;
+}
+
 //-----------------------------------------------------------------------------
 // RotationCurve::RotationCurve()
 //-----------------------------------------------------------------------------
@@ -232,65 +313,112 @@ LLKeyframeMotion::RotationCurve::~RotationCurve()
 }
 
 //-----------------------------------------------------------------------------
-// RotationCurve::getValue()
+// RotationCurve::setKeys()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
+void LLKeyframeMotion::RotationCurve::setKeys(std::vector<Key>& keys)
 {
-	LLQuaternion value;
+	sort_keys(keys);
+	// copy rather than swap so the array is no bigger than it needs to be
+	key_array_t(keys.begin(), keys.end()).swap(mKeys);
+	mNumKeys = (S32)mKeys.size();
+}
+
+//-----------------------------------------------------------------------------
+// RotationCurve::getKey()
+//-----------------------------------------------------------------------------
+LLKeyframeMotion::RotationKey LLKeyframeMotion::RotationCurve::getKey(S32 index, F32 duration) const
+{
+	const Key& key = mKeys[index];
+	LLVector3 rot_vec;
+	rot_vec.mV[VX] = U16_to_F32(key.mRotation[VX], -1.f, 1.f);
+	rot_vec.mV[VY] = U16_to_F32(key.mRotation[VY], -1.f, 1.f);
+	rot_vec.mV[VZ] = U16_to_F32(key.mRotation[VZ], -1.f, 1.f);
+
+	RotationKey rot_key;
+	rot_key.mTime = key_time(key.mTime, duration);
+	rot_key.mRotation.unpackFromVector3(rot_vec);
+	return rot_key;
+}
 
+//-----------------------------------------------------------------------------
+// RotationCurve::getKeys()
+//-----------------------------------------------------------------------------
+BOOL LLKeyframeMotion::RotationCurve::getKeys(F32 time, F32 duration, RotationCursor& cursor,
+											  LLQuaternion& before, LLQuaternion& after, F32& u) const
+{
 	if (mKeys.empty())
 	{
-		value = LLQuaternion::DEFAULT;
-		return value;
+		before = LLQuaternion::DEFAULT;
+		return FALSE;
 	}
-	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+
+	if (!(time > cursor.mTimes[0] && time <= cursor.mTimes[1]))
 	{
-		// Past last key
-		--right;
-		value = right->second.mRotation;
+		S32 previous = cursor.mIndex;
+		cursor.mIndex = find_key(mKeys, time, duration, cursor.mIndex);
+		if (cursor.mIndex == 0 || cursor.mIndex == (S32)mKeys.size())
+		{
+			// Before first key or past last key
+			cursor.mTimes[0] = 1.f;
+			cursor.mTimes[1] = 0.f;
+			before = getKey(llmax(cursor.mIndex - 1, 0), duration).mRotation;
+			return FALSE;
+		}
+
+		// moving on to the next key, the old one is already unpacked
+		if (cursor.mIndex == previous + 1 && cursor.mTimes[0] < cursor.mTimes[1])
+		{
+			cursor.mTimes[0] = cursor.mTimes[1];
+			cursor.mValues[0] = cursor.mValues[1];
+		}
+		else
+		{
+			RotationKey key = getKey(cursor.mIndex - 1, duration);
+			cursor.mTimes[0] = key.mTime;
+			cursor.mValues[0] = key.mRotation;
+		}
+		RotationKey key = getKey(cursor.mIndex, duration);
+		cursor.mTimes[1] = key.mTime;
+		cursor.mValues[1] = key.mRotation;
 	}
-	else if (right == mKeys.begin() || right->first == time)
+
+	if (time == cursor.mTimes[1])
 	{
-		// Before first key or exactly on a key
-		value = right->second.mRotation;
+		// Exactly on a key
+		before = cursor.mValues[1];
+		return FALSE;
 	}
-	else
-	{
-		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		RotationKey& rot_before = left->second;
-		RotationKey& rot_after = right->second;
-		if (right == mKeys.end())
-		{
-			rot_after = mLoopInKey;
-			index_after = duration;
-		}
 
-		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, rot_before, rot_after);
+	// Between two keys
+	before = cursor.mValues[0];
+	if (mInterpolationType == IT_STEP)
+	{
+		return FALSE;
 	}
-	return value;
+	after = cursor.mValues[1];
+	u = (time - cursor.mTimes[0]) / (cursor.mTimes[1] - cursor.mTimes[0]);
+	return TRUE;
 }
 
 //-----------------------------------------------------------------------------
-// interp()
+// RotationCurve::getValue()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, RotationKey& before, RotationKey& after)
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration, RotationCursor& cursor) const
 {
-	switch (mInterpolationType)
+	LLQuaternion before;
+	LLQuaternion after;
+	F32 u;
+	if (getKeys(time, duration, cursor, before, after, u))
 	{
-	case IT_STEP:
-		return before.mRotation;
-
-	default:
-	case IT_LINEAR:
-	case IT_SPLINE:
-		return nlerp(u, before.mRotation, after.mRotation);
+		return nlerp(u, before, after);
 	}
+	return before;
+}
+
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration) const
+{
+	RotationCursor cursor;
+	return getValue(time, duration, cursor);
 }
 
 
@@ -312,10 +440,34 @@ LLKeyframeMotion::PositionCurve::~PositionCurve()
 	mNumKeys = 0;
 }
 
+//-----------------------------------------------------------------------------
+// PositionCurve::setKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::PositionCurve::setKeys(std::vector<Key>& keys)
+{
+	sort_keys(keys);
+	key_array_t(keys.begin(), keys.end()).swap(mKeys);
+	mNumKeys = (S32)mKeys.size();
+}
+
+//-----------------------------------------------------------------------------
+// PositionCurve::getKey()
+//-----------------------------------------------------------------------------
+LLKeyframeMotion::PositionKey LLKeyframeMotion::PositionCurve::getKey(S32 index, F32 duration) const
+{
+	const Key& key = mKeys[index];
+	PositionKey pos_key;
+	pos_key.mTime = key_time(key.mTime, duration);
+	pos_key.mPosition.mV[VX] = U16_to_F32(key.mPosition[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+	pos_key.mPosition.mV[VY] = U16_to_F32(key.mPosition[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+	pos_key.mPosition.mV[VZ] = U16_to_F32(key.mPosition[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+	return pos_key;
+}
+
 //-----------------------------------------------------------------------------
 // PositionCurve::getValue()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
+LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration, PositionCursor& cursor) const
 {
 	LLVector3 value;
 
@@ -324,35 +476,50 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 		value.clearVec();
 		return value;
 	}
-	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+
+	if (!(time > cursor.mTimes[0] && time <= cursor.mTimes[1]))
 	{
-		// Past last key
-		--right;
-		value = right->second.mPosition;
+		S32 previous = cursor.mIndex;
+		cursor.mIndex = find_key(mKeys, time, duration, cursor.mIndex);
+		if (cursor.mIndex == 0 || cursor.mIndex == (S32)mKeys.size())
+		{
+			// Before first key or past last key
+			cursor.mTimes[0] = 1.f;
+			cursor.mTimes[1] = 0.f;
+			return getKey(llmax(cursor.mIndex - 1, 0), duration).mPosition;
+		}
+
+		// as for rotations, reuse the key just passed
+		if (cursor.mIndex == previous + 1 && cursor.mTimes[0] < cursor.mTimes[1])
+		{
+			cursor.mTimes[0] = cursor.mTimes[1];
+			cursor.mValues[0] = cursor.mValues[1];
+		}
+		else
+		{
+			PositionKey key = getKey(cursor.mIndex - 1, duration);
+			cursor.mTimes[0] = key.mTime;
+			cursor.mValues[0] = key.mPosition;
+		}
+		PositionKey key = getKey(cursor.mIndex, duration);
+		cursor.mTimes[1] = key.mTime;
+		cursor.mValues[1] = key.mPosition;
 	}
-	else if (right == mKeys.begin() || right->first == time)
+
+	if (time == cursor.mTimes[1])
 	{
-		// Before first key or exactly on a key
-		value = right->second.mPosition;
+		// Exactly on a key
+		value = cursor.mValues[1];
+	}
+	else if (mInterpolationType == IT_STEP)
+	{
+		value = cursor.mValues[0];
 	}
 	else
 	{
 		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		PositionKey& pos_before = left->second;
-		PositionKey& pos_after = right->second;
-		if (right == mKeys.end())
-		{
-			pos_after = mLoopInKey;
-			index_after = duration;
-		}
-
-		F32 u = (time - index_before) / (index_after - index_before);
-		value = interp(u, pos_before, pos_after);
+		F32 u = (time - cursor.mTimes[0]) / (cursor.mTimes[1] - cursor.mTimes[0]);
+		value = lerp(cursor.mValues[0], cursor.mValues[1], u);
 	}
 
 	llassert(value.isFinite());
@@ -360,20 +527,24 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 	return value;
 }
 
+LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration) const
+{
+	PositionCursor cursor;
+	return getValue(time, duration, cursor);
+}
+
+
 //-----------------------------------------------------------------------------
-// interp()
+// RotationBatch::flush()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, PositionKey& after)
+void LLKeyframeMotion::RotationBatch::flush()
 {
-	switch (mInterpolationType)
+	nlerp_batch(mCount, mU, mBefore, mAfter, mBefore);
+	for (S32 i = 0; i < mCount; i++)
 	{
-	case IT_STEP:
-		return before.mPosition;
-	default:
-	case IT_LINEAR:
-	case IT_SPLINE:
-		return lerp(before.mPosition, after.mPosition, u);
+		mJointStates[i]->setRotation(mBefore[i]);
 	}
+	mCount = 0;
 }
 
 
@@ -386,7 +557,8 @@ LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, Po
 //-----------------------------------------------------------------------------
 // JointMotion::update()
 //-----------------------------------------------------------------------------
-void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration)
+void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration,
+										   JointCursor& cursor, RotationBatch& rotations)
 {
 	// this value being 0 is the cause of https://jira.lindenlab.com/browse/SL-22678 but I haven't 
 	// managed to get a stack to see how it got here. Testing for 0 here will stop the crash.
@@ -410,7 +582,18 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::ROT) && mRotationCurve.mNumKeys)
 	{
-		joint_state->setRotation( mRotationCurve.getValue( time, duration ) );
+		LLQuaternion before;
+		LLQuaternion after;
+		F32 u;
+		if (mRotationCurve.getKeys(time, duration, cursor.mRotation, before, after, u))
+		{
+			// blended with the other joints' rotations
+			rotations.add(joint_state, before, after, u);
+		}
+		else
+		{
+			joint_state->setRotation(before);
+		}
 	}
 
 	//-------------------------------------------------------------------------
@@ -418,7 +601,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::POS) && mPositionCurve.mNumKeys)
 	{
-		joint_state->setPosition( mPositionCurve.getValue( time, duration ) );
+		joint_state->setPosition( mPositionCurve.getValue( time, duration, cursor.mPosition ) );
 	}
 }
 
@@ -709,7 +892,11 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 
 	applyKeyframes(mLastLoopedTime);
 
-	applyConstraints(mLastLoopedTime, joint_mask);
+	// too small on screen for planted feet and reaching hands to show
+	if (mCharacter->getAnimationLOD() < LLCharacter::ANIMATION_LOD_LOW)
+	{
+		applyConstraints(mLastLoopedTime, joint_mask);
+	}
 
 	mLastUpdateTime = time;
 
@@ -722,12 +909,27 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
 	llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
+	if (mKeyCursors.size() != mJointMotionList->getNumJointMotions())
+	{
+		mKeyCursors.assign(mJointMotionList->getNumJointMotions(), JointCursor());
+	}
+
+	BOOL detail_joints = mCharacter->animateDetailJoints();
+	RotationBatch rotations;
 	for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
 	{
+		// the pose blender leaves these out as well, see LLPoseBlender::addMotion()
+		if (!detail_joints && mJointStates[i]->getJoint() && mJointStates[i]->getJoint()->mAnimationDetail)
+		{
+			continue;
+		}
 		mJointMotionList->getJointMotion(i)->update(mJointStates[i],
 													  time, 
-													  mJointMotionList->mDuration );
+													  mJointMotionList->mDuration,
+													  mKeyCursors[i],
+													  rotations);
 	}
+	rotations.flush();
 
 	LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
 	if (pose_priority)
@@ -1025,12 +1227,16 @@ void LLKeyframeMotion::applyConstraint(JointConstraint* constraint, F32 time, U8
 
 	LLVector3 source_to_target = target_pos - keyframe_source_pos;
 	
-	S32 max_iteration_count = llround(clamp_rescale(
+	S32 max_iteration_count = MIN_ITERATIONS;
+	if (mCharacter->getAnimationLOD() == LLCharacter::ANIMATION_LOD_FULL)
+	{
+		max_iteration_count = llround(clamp_rescale(
 										  mCharacter->getPixelArea(),
 										  MAX_PIXEL_AREA_CONSTRAINTS,
 										  MIN_PIXEL_AREA_CONSTRAINTS,
 										  (F32)MAX_ITERATIONS,
 										  (F32)MIN_ITERATIONS));
+	}
 
 	if (shared_data->mChainLength)
 	{
@@ -1331,6 +1537,7 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 	mJointMotionList->mJointMotionArray.reserve(num_motions);
 	mJointStates.clear();
 	mJointStates.reserve(num_motions);
+	mKeyCursors.clear();
 
 	//-------------------------------------------------------------------------
 	// initialize joint motions
@@ -1415,11 +1622,14 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 		// scan rotation curve keys
 		//---------------------------------------------------------------------
 		RotationCurve *rCurve = &joint_motion->mRotationCurve;
+		std::vector<RotationCurve::Key> rot_keys;
+		rot_keys.reserve(llclamp(rCurve->mNumKeys, 0, 1024));
 
 		for (S32 k = 0; k < joint_motion->mRotationCurve.mNumKeys; k++)
 		{
 			F32 time;
 			U16 time_short;
+			RotationCurve::Key packed_key;
 
 			if (old_version)
 			{
@@ -1447,8 +1657,6 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				}
 			}
 			
-			RotationKey rot_key;
-			rot_key.mTime = time;
 			LLVector3 rot_angles;
 			U16 x, y, z;
 
@@ -1459,29 +1667,24 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				success = dp.unpackVector3(rot_angles, "rot_angles");
 
 				LLQuaternion::Order ro = StringToOrder("ZYX");
-				rot_key.mRotation = mayaQ(rot_angles.mV[VX], rot_angles.mV[VY], rot_angles.mV[VZ], ro);
-				if(!(rot_key.mRotation.isFinite()))
+				LLQuaternion rotation = mayaQ(rot_angles.mV[VX], rot_angles.mV[VY], rot_angles.mV[VZ], ro);
+				if(!(rotation.isFinite()))
 				{
 					return FALSE;
 				}
+
+				// stored the way the current format packs them
+				LLVector3 rot_vec = rotation.packToVector3();
+				time_short = F32_to_U16(time, 0.f, mJointMotionList->mDuration);
+				x = F32_to_U16(rot_vec.mV[VX], -1.f, 1.f);
+				y = F32_to_U16(rot_vec.mV[VY], -1.f, 1.f);
+				z = F32_to_U16(rot_vec.mV[VZ], -1.f, 1.f);
 			}
 			else
 			{
 				success &= dp.unpackU16(x, "rot_angle_x");
 				success &= dp.unpackU16(y, "rot_angle_y");
 				success &= dp.unpackU16(z, "rot_angle_z");
-
-				LLVector3 rot_vec;
-				rot_vec.mV[VX] = U16_to_F32(x, -1.f, 1.f);
-				rot_vec.mV[VY] = U16_to_F32(y, -1.f, 1.f);
-				rot_vec.mV[VZ] = U16_to_F32(z, -1.f, 1.f);
-				rot_key.mRotation.unpackFromVector3(rot_vec);
-			}
-
-			if( !(rot_key.mRotation.isFinite()) )
-			{
-				llwarns << "non-finite angle in rotation key" << llendl;
-				success = FALSE;
 			}
 			
 			if (!success)
@@ -1490,8 +1693,13 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				return FALSE;
 			}
 
-			rCurve->mKeys[time] = rot_key;
+			packed_key.mTime = time_short;
+			packed_key.mRotation[VX] = x;
+			packed_key.mRotation[VY] = y;
+			packed_key.mRotation[VZ] = z;
+			rot_keys.push_back(packed_key);
 		}
+		rCurve->setKeys(rot_keys);
 
 		//---------------------------------------------------------------------
 		// scan position curve header
@@ -1512,11 +1720,14 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 		// scan position curve keys
 		//---------------------------------------------------------------------
 		PositionCurve *pCurve = &joint_motion->mPositionCurve;
+		std::vector<PositionCurve::Key> pos_keys;
+		pos_keys.reserve(llclamp(pCurve->mNumKeys, 0, 1024));
 		BOOL is_pelvis = joint_motion->mJointName == "mPelvis";
 		for (S32 k = 0; k < joint_motion->mPositionCurve.mNumKeys; k++)
 		{
 			U16 time_short;
 			PositionKey pos_key;
+			PositionCurve::Key packed_key;
 
 			if (old_version)
 			{
@@ -1539,6 +1750,8 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 
 			BOOL success = TRUE;
 
+			U16 x, y, z;
+
 			if (old_version)
 			{
 				success = dp.unpackVector3(pos_key.mPosition, "pos");
@@ -1546,39 +1759,42 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				{
 					return FALSE;
 				}
+
+				// stored the way the current format packs them
+				time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
+				x = F32_to_U16(pos_key.mPosition.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+				y = F32_to_U16(pos_key.mPosition.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+				z = F32_to_U16(pos_key.mPosition.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
 			}
 			else
 			{
-				U16 x, y, z;
-
 				success &= dp.unpackU16(x, "pos_x");
 				success &= dp.unpackU16(y, "pos_y");
 				success &= dp.unpackU16(z, "pos_z");
-
-				pos_key.mPosition.mV[VX] = U16_to_F32(x, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-				pos_key.mPosition.mV[VY] = U16_to_F32(y, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-				pos_key.mPosition.mV[VZ] = U16_to_F32(z, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			}
-			
-			if( !(pos_key.mPosition.isFinite()) )
-			{
-				llwarns << "non-finite position in key" << llendl;
-				success = FALSE;
 			}
+
+			pos_key.mPosition.mV[VX] = U16_to_F32(x, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			pos_key.mPosition.mV[VY] = U16_to_F32(y, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			pos_key.mPosition.mV[VZ] = U16_to_F32(z, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
 			
 			if (!success)
 			{
 				llwarns << "can't read position key (" << k << ")" << llendl;
 				return FALSE;
 			}
-			
-			pCurve->mKeys[pos_key.mTime] = pos_key;
+
+			packed_key.mTime = time_short;
+			packed_key.mPosition[VX] = x;
+			packed_key.mPosition[VY] = y;
+			packed_key.mPosition[VZ] = z;
+			pos_keys.push_back(packed_key);
 
 			if (is_pelvis)
 			{
 				mJointMotionList->mPelvisBBox.addPoint(pos_key.mPosition);
 			}
 		}
+		pCurve->setKeys(pos_keys);
 
 		joint_motion->mUsage = joint_state->getUsage();
 	}
@@ -1836,41 +2052,24 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		success &= dp.packS32(joint_motionp->mPriority, "joint_priority");
 		success &= dp.packS32(joint_motionp->mRotationCurve.mNumKeys, "num_rot_keys");
 
-		for (RotationCurve::key_map_t::iterator iter = joint_motionp->mRotationCurve.mKeys.begin();
+		// the keys are kept as the file has them, so they go back out unchanged
+		for (RotationCurve::key_array_t::const_iterator iter = joint_motionp->mRotationCurve.mKeys.begin();
 			 iter != joint_motionp->mRotationCurve.mKeys.end(); ++iter)
 		{
-			RotationKey& rot_key = iter->second;
-			U16 time_short = F32_to_U16(rot_key.mTime, 0.f, mJointMotionList->mDuration);
-			success &= dp.packU16(time_short, "time");
-
-			LLVector3 rot_angles = rot_key.mRotation.packToVector3();
-			
-			U16 x, y, z;
-			rot_angles.quantize16(-1.f, 1.f, -1.f, 1.f);
-			x = F32_to_U16(rot_angles.mV[VX], -1.f, 1.f);
-			y = F32_to_U16(rot_angles.mV[VY], -1.f, 1.f);
-			z = F32_to_U16(rot_angles.mV[VZ], -1.f, 1.f);
-			success &= dp.packU16(x, "rot_angle_x");
-			success &= dp.packU16(y, "rot_angle_y");
-			success &= dp.packU16(z, "rot_angle_z");
+			success &= dp.packU16(iter->mTime, "time");
+			success &= dp.packU16(iter->mRotation[VX], "rot_angle_x");
+			success &= dp.packU16(iter->mRotation[VY], "rot_angle_y");
+			success &= dp.packU16(iter->mRotation[VZ], "rot_angle_z");
 		}
 
 		success &= dp.packS32(joint_motionp->mPositionCurve.mNumKeys, "num_pos_keys");
-		for (PositionCurve::key_map_t::iterator iter = joint_motionp->mPositionCurve.mKeys.begin();
+		for (PositionCurve::key_array_t::const_iterator iter = joint_motionp->mPositionCurve.mKeys.begin();
 			 iter != joint_motionp->mPositionCurve.mKeys.end(); ++iter)
 		{
-			PositionKey& pos_key = iter->second;
-			U16 time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
-			success &= dp.packU16(time_short, "time");
-
-			U16 x, y, z;
-			pos_key.mPosition.quantize16(-LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			x = F32_to_U16(pos_key.mPosition.mV[VX], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			y = F32_to_U16(pos_key.mPosition.mV[VY], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			z = F32_to_U16(pos_key.mPosition.mV[VZ], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
-			success &= dp.packU16(x, "pos_x");
-			success &= dp.packU16(y, "pos_y");
-			success &= dp.packU16(z, "pos_z");
+			success &= dp.packU16(iter->mTime, "time");
+			success &= dp.packU16(iter->mPosition[VX], "pos_x");
+			success &= dp.packU16(iter->mPosition[VY], "pos_y");
+			success &= dp.packU16(iter->mPosition[VZ], "pos_z");
 		}
 	}	
 
@@ -337,21 +337,64 @@ public:
 		ScaleKey			mLoopOutKey;
 	};
 
+	//-------------------------------------------------------------------------
+	// KeyCursor
+	//-------------------------------------------------------------------------
+	// Where the previous sample of a curve fell, with the keys either side
+	// of it unpacked. Kept by every motion instance, as the curves themselves
+	// are shared through LLKeyframeDataCache, so playback only searches and
+	// unpacks keys when it moves past one.
+	template<class VALUE>
+	class KeyCursor
+	{
+	public:
+		KeyCursor() : mIndex(0) { mTimes[0] = 1.f; mTimes[1] = 0.f; }
+
+		S32			mIndex;		// first key at or after the sample time
+		F32			mTimes[2];	// mIndex - 1 and mIndex; empty when not between keys
+		VALUE		mValues[2];
+	};
+	typedef KeyCursor<LLQuaternion> RotationCursor;
+	typedef KeyCursor<LLVector3> PositionCursor;
+
+	class JointCursor
+	{
+	public:
+		RotationCursor	mRotation;
+		PositionCursor	mPosition;
+	};
+
 	//-------------------------------------------------------------------------
 	// RotationCurve
 	//-------------------------------------------------------------------------
+	// Keys are kept the way the .anim format stores them, 8 bytes a key in
+	// one array sorted by time.
 	class RotationCurve
 	{
 	public:
+		class Key
+		{
+		public:
+			U16		mTime;			// quantized over the motion duration
+			U16		mRotation[3];	// see LLQuaternion::packToVector3()
+		};
+
 		RotationCurve();
 		~RotationCurve();
-		LLQuaternion getValue(F32 time, F32 duration);
-		LLQuaternion interp(F32 u, RotationKey& before, RotationKey& after);
+		// Sorts the keys by time, keeping the last of any with the same time.
+		void setKeys(std::vector<Key>& keys);
+		RotationKey getKey(S32 index, F32 duration) const;
+		// Finds the keys either side of time, starting from cursor. Returns
+		// FALSE with the value in before when no interpolation is needed.
+		BOOL getKeys(F32 time, F32 duration, RotationCursor& cursor, LLQuaternion& before, LLQuaternion& after, F32& u) const;
+		LLQuaternion getValue(F32 time, F32 duration, RotationCursor& cursor) const;
+		LLQuaternion getValue(F32 time, F32 duration) const;
+		U32 getMemoryUsage() const { return mKeys.capacity() * sizeof(Key); }
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, RotationKey> key_map_t;
-		key_map_t		mKeys;
+		typedef std::vector<Key> key_array_t;
+		key_array_t		mKeys;
 		RotationKey		mLoopInKey;
 		RotationKey		mLoopOutKey;
 	};
@@ -362,19 +405,62 @@ public:
 	class PositionCurve
 	{
 	public:
+		class Key
+		{
+		public:
+			U16		mTime;			// quantized over the motion duration
+			U16		mPosition[3];	// quantized over +/-LL_MAX_PELVIS_OFFSET
+		};
+
 		PositionCurve();
 		~PositionCurve();
-		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, PositionKey& before, PositionKey& after);
+		void setKeys(std::vector<Key>& keys);
+		PositionKey getKey(S32 index, F32 duration) const;
+		LLVector3 getValue(F32 time, F32 duration, PositionCursor& cursor) const;
+		LLVector3 getValue(F32 time, F32 duration) const;
+		U32 getMemoryUsage() const { return mKeys.capacity() * sizeof(Key); }
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, PositionKey> key_map_t;
-		key_map_t		mKeys;
+		typedef std::vector<Key> key_array_t;
+		key_array_t		mKeys;
 		PositionKey		mLoopInKey;
 		PositionKey		mLoopOutKey;
 	};
 
+	//-------------------------------------------------------------------------
+	// RotationBatch
+	//-------------------------------------------------------------------------
+	// Rotations that fall between two keys, gathered from all the joints of
+	// a motion and blended together with nlerp_batch().
+	class RotationBatch
+	{
+	public:
+		RotationBatch() : mCount(0) {}
+		~RotationBatch() { flush(); }
+
+		void add(LLJointState* joint_state, const LLQuaternion& before, const LLQuaternion& after, F32 u)
+		{
+			mJointStates[mCount] = joint_state;
+			mBefore[mCount] = before;
+			mAfter[mCount] = after;
+			mU[mCount] = u;
+			if (++mCount == BATCH_SIZE)
+			{
+				flush();
+			}
+		}
+		void flush();
+
+	private:
+		enum { BATCH_SIZE = 16 };
+		LLJointState*	mJointStates[BATCH_SIZE];
+		LLQuaternion	mBefore[BATCH_SIZE];
+		LLQuaternion	mAfter[BATCH_SIZE];
+		F32				mU[BATCH_SIZE];
+		S32				mCount;
+	};
+
 	//-------------------------------------------------------------------------
 	// JointMotion
 	//-------------------------------------------------------------------------
@@ -388,7 +474,7 @@ public:
 		U32				mUsage;
 		LLJoint::JointPriority	mPriority;
 
-		void update(LLJointState* joint_state, F32 time, F32 duration);
+		void update(LLJointState* joint_state, F32 time, F32 duration, JointCursor& cursor, RotationBatch& rotations);
 	};
 	
 	//-------------------------------------------------------------------------
@@ -418,6 +504,8 @@ public:
 		JointMotionList();
 		~JointMotionList();
 		U32 dumpDiagInfo();
+		// bytes used by the joint curves and keys
+		U32 getMemoryUsage() const;
 		JointMotion* getJointMotion(U32 index) const { llassert(index < mJointMotionArray.size()); return mJointMotionArray[index]; }
 		U32 getNumJointMotions() const { return mJointMotionArray.size(); }
 	};
@@ -431,6 +519,7 @@ protected:
 	//-------------------------------------------------------------------------
 	JointMotionList*				mJointMotionList;
 	std::vector<LLPointer<LLJointState> > mJointStates;
+	std::vector<JointCursor>		mKeyCursors;
 	LLJoint*						mPelvisp;
 	LLCharacter*					mCharacter;
 	typedef std::list<JointConstraint*>	constraint_list_t;
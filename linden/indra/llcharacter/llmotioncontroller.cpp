@@ -143,7 +143,9 @@ LLMotionController::LLMotionController()
 	  mPauseTime(0.f),
 	  mTimeStep(0.f),
 	  mTimeStepCount(0),
-	  mLastInterp(0.f)
+	  mLastInterp(0.f),
+	  mFixedTimeDelta(0.f),
+	  mBlending(FALSE)
 {
 }
 
@@ -174,6 +176,8 @@ void LLMotionController::deleteAllMotions()
 	mLoadingMotions.clear();
 	mLoadedMotions.clear();
 	mActiveMotions.clear();
+	mPendingStopRequests.clear();
+	mPendingDeactivations.clear();
 
 	for_each(mAllMotions.begin(), mAllMotions.end(), DeletePairedPointer());
 	mAllMotions.clear();
@@ -498,7 +502,7 @@ void LLMotionController::updateIdleMotion(LLMotion* motionp)
 {
 	if (motionp->isStopped() && mAnimTime > motionp->getStopTime() + motionp->getEaseOutDuration())
 	{
-		deactivateMotionInstance(motionp);
+		retireMotionInstance(motionp);
 	}
 	else if (motionp->isStopped() && mAnimTime > motionp->getStopTime())
 	{
@@ -515,7 +519,7 @@ void LLMotionController::updateIdleMotion(LLMotion* motionp)
 		// this will only be called when an animation stops itself (runs out of time)
 		if (mLastTime <= motionp->mSendStopTimestamp)
 		{
-			mCharacter->requestStopMotion( motionp );
+			requestStopMotion(motionp);
 			stopMotionInstance(motionp, FALSE);
 		}
 	}
@@ -616,7 +620,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// this will only be called when an animation stops itself (runs out of time)
 				if (mLastTime <= motionp->mSendStopTimestamp)
 				{
-					mCharacter->requestStopMotion( motionp );
+					requestStopMotion(motionp);
 					stopMotionInstance(motionp, FALSE);
 				}
 			}
@@ -626,7 +630,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				if (motionp->isStopped() && mAnimTime > motionp->getStopTime() + motionp->getEaseOutDuration())
 				{
 					posep->setWeight(0.f);
-					deactivateMotionInstance(motionp);
+					retireMotionInstance(motionp);
 				}
 				continue;
 			}
@@ -653,7 +657,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 			else
 			{
 				posep->setWeight(0.f);
-				deactivateMotionInstance(motionp);
+				retireMotionInstance(motionp);
 				continue;
 			}
 		}
@@ -697,7 +701,7 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// this will only be called when an animation stops itself (runs out of time)
 				if (mLastTime <= motionp->mSendStopTimestamp)
 				{
-					mCharacter->requestStopMotion( motionp );
+					requestStopMotion(motionp);
 					stopMotionInstance(motionp, FALSE);
 				}
 			}
@@ -741,14 +745,14 @@ void LLMotionController::updateMotionsByType(LLMotion::LLMotionBlendType anim_ty
 				// animation has stopped itself due to internal logic
 				// propagate this to the network
 				// as not all viewers are guaranteed to have access to the same logic
-				mCharacter->requestStopMotion( motionp );
+				requestStopMotion(motionp);
 				stopMotionInstance(motionp, FALSE);
 			}
 
 		}
 
 		// even if onupdate returns FALSE, add this motion in to the blend one last time
-		mPoseBlender.addMotion(motionp);
+		mPoseBlender.addMotion(motionp, !mCharacter->animateDetailJoints());
 	}
 }
 
@@ -803,6 +807,20 @@ void LLMotionController::updateLoadingMotions()
 // updateMotion()
 //-----------------------------------------------------------------------------
 void LLMotionController::updateMotions(bool force_update)
+{
+	if (beginUpdate(force_update))
+	{
+		blendMotions();
+		endUpdate();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// beginUpdate()
+// Advances time and loads pending motions. Returns TRUE if blendMotions()
+// and endUpdate() must follow.
+//-----------------------------------------------------------------------------
+bool LLMotionController::beginUpdate(bool force_update)
 {
 	BOOL use_quantum = (mTimeStep != 0.f);
 
@@ -812,6 +830,11 @@ void LLMotionController::updateMotions(bool force_update)
 	mPrevTimerElapsed = cur_time;
 	mLastTime = mAnimTime;
 
+	if (mFixedTimeDelta > 0.f)
+	{
+		delta_time = mFixedTimeDelta;
+	}
+
 	// Always cap the number of loaded motions
 	purgeExcessMotions();
 	
@@ -836,7 +859,7 @@ void LLMotionController::updateMotions(bool force_update)
 				}
 
 				updateLoadingMotions();
-				return;
+				return false;
 			}
 			
 			// is calculating a new keyframe pose, make sure the last one gets applied
@@ -860,30 +883,102 @@ void LLMotionController::updateMotions(bool force_update)
 	if (mPaused && !force_update)
 	{
 		updateIdleActiveMotions();
+		mHasRunOnce = TRUE;
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// blendMotions()
+// Samples the active motions and blends them into the joint states. Only
+// touches this controller, its motions and its character's joints; anything
+// that reaches outside (stop requests, deactivation) is queued for
+// endUpdate(), so controllers of different characters can blend in parallel.
+//-----------------------------------------------------------------------------
+void LLMotionController::blendMotions()
+{
+	mBlending = TRUE;
+
+	// update additive motions
+	updateAdditiveMotions();
+	resetJointSignatures();
+
+	// update all regular motions
+	updateRegularMotions();
+
+	if (mTimeStep != 0.f)
+	{
+		mPoseBlender.blendAndCache(TRUE);
 	}
 	else
 	{
-		// update additive motions
-		updateAdditiveMotions();
-		resetJointSignatures();
+		mPoseBlender.blendAndApply();
+	}
 
-		// update all regular motions
-		updateRegularMotions();
+	mBlending = FALSE;
+}
 
-		if (use_quantum)
-		{
-			mPoseBlender.blendAndCache(TRUE);
-		}
-		else
+//-----------------------------------------------------------------------------
+// endUpdate()
+//-----------------------------------------------------------------------------
+void LLMotionController::endUpdate()
+{
+	llassert(!mBlending);
+
+	for (motion_vec_t::iterator iter = mPendingStopRequests.begin();
+		 iter != mPendingStopRequests.end(); ++iter)
+	{
+		mCharacter->requestStopMotion(*iter);
+	}
+	mPendingStopRequests.clear();
+
+	for (motion_vec_t::iterator iter = mPendingDeactivations.begin();
+		 iter != mPendingDeactivations.end(); ++iter)
+	{
+		if (isMotionActive(*iter))
 		{
-			mPoseBlender.blendAndApply();
+			deactivateMotionInstance(*iter);
 		}
 	}
+	mPendingDeactivations.clear();
 
 	mHasRunOnce = TRUE;
 //	llinfos << "Motion controller time " << motionTimer.getElapsedTimeF32() << llendl;
 }
 
+//-----------------------------------------------------------------------------
+// requestStopMotion()
+//-----------------------------------------------------------------------------
+void LLMotionController::requestStopMotion(LLMotion* motion)
+{
+	if (mBlending)
+	{
+		mPendingStopRequests.push_back(motion);
+	}
+	else
+	{
+		mCharacter->requestStopMotion(motion);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// retireMotionInstance()
+// deactivates now, or at endUpdate() while blending
+//-----------------------------------------------------------------------------
+void LLMotionController::retireMotionInstance(LLMotion* motion)
+{
+	if (mBlending)
+	{
+		mPendingDeactivations.push_back(motion);
+	}
+	else
+	{
+		deactivateMotionInstance(motion);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
@@ -1037,6 +1132,9 @@ LLMotion* LLMotionController::findMotion(const LLUUID& id)
 //-----------------------------------------------------------------------------
 void LLMotionController::deactivateAllMotions()
 {
+	mPendingStopRequests.clear();
+	mPendingDeactivations.clear();
+
 	for (motion_map_t::iterator iter = mAllMotions.begin();
 		 iter != mAllMotions.end(); iter++)
 	{
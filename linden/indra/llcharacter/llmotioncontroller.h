@@ -39,6 +39,7 @@
 #include <string>
 #include <map>
 #include <deque>
+#include <vector>
 
 #include "lluuidhashmap.h"
 #include "llmotion.h"
@@ -92,6 +93,7 @@ class LLMotionController
 public:
 	typedef std::list<LLMotion*> motion_list_t;
 	typedef std::set<LLMotion*> motion_set_t;
+	typedef std::vector<LLMotion*> motion_vec_t;
 	
 public:
 	// Constructor
@@ -138,6 +140,14 @@ public:
 	// deactivates terminated motions`
 	void updateMotions(bool force_update = false);
 
+	// updateMotions() in three steps, for characters animated in parallel.
+	// beginUpdate() and endUpdate() must run on the main thread; if
+	// beginUpdate() returns true, blendMotions() may then run on any thread,
+	// concurrently with other controllers, before endUpdate().
+	bool beginUpdate(bool force_update = false);
+	void blendMotions();
+	void endUpdate();
+
 	// minimal update (e.g. while hidden)
 	void updateMotionsMinimal();
 
@@ -156,8 +166,13 @@ public:
 	BOOL isPaused() { return mPaused; }
 
 	void setTimeStep(F32 step);
+	F32 getTimeStep() const { return mTimeStep; }
 
 	void setTimeFactor(F32 time_factor);
+
+	// advance by a fixed delta per update instead of the wall clock (0 = off),
+	// for deterministic tests and benchmarks
+	void setFixedTimeDelta(F32 delta) { mFixedTimeDelta = delta; }
 	F32 getTimeFactor() { return mTimeFactor; }
 
 	motion_list_t& getActiveMotions() { return mActiveMotions; }
@@ -186,6 +201,8 @@ protected:
 	void updateIdleActiveMotions();
 	void purgeExcessMotions();
 	void deactivateStoppedMotions();
+	void requestStopMotion(LLMotion* motion);
+	void retireMotionInstance(LLMotion* motion);
 
 protected:
 	F32					mTimeFactor;
@@ -220,6 +237,12 @@ protected:
 	F32					mTimeStep;
 	S32					mTimeStepCount;
 	F32					mLastInterp;
+	F32					mFixedTimeDelta;
+
+	// side effects queued by blendMotions() for endUpdate()
+	BOOL				mBlending;
+	motion_vec_t		mPendingStopRequests;
+	motion_vec_t		mPendingDeactivations;
 
 	U8					mJointSignature[2][LL_CHARACTER_MAX_JOINTS];
 };
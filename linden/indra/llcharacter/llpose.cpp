@@ -472,13 +472,17 @@ LLPoseBlender::~LLPoseBlender()
 //-----------------------------------------------------------------------------
 // addMotion()
 //-----------------------------------------------------------------------------
-BOOL LLPoseBlender::addMotion(LLMotion* motion)
+BOOL LLPoseBlender::addMotion(LLMotion* motion, BOOL skip_detail_joints)
 {
 	LLPose* pose = motion->getPose();
 
 	for(LLJointState* jsp = pose->getFirstJointState(); jsp; jsp = pose->getNextJointState())
 	{
 		LLJoint *jointp = jsp->getJoint();
+		if (skip_detail_joints && jointp && jointp->mAnimationDetail)
+		{
+			continue;
+		}
 		LLJointStateBlender* joint_blender;
 		if (mJointStateBlenderPool.find(jointp) == mJointStateBlenderPool.end())
 		{
@@ -123,7 +123,8 @@ public:
 	~LLPoseBlender();
 	
 	// request motion joint states to be added to pose blender joint state records
-	BOOL addMotion(LLMotion* motion);
+	// skip_detail_joints leaves joints flagged LLJoint::mAnimationDetail as they are
+	BOOL addMotion(LLMotion* motion, BOOL skip_detail_joints = FALSE);
 
 	// blend all joint states and apply to skeleton
 	void blendAndApply();
@@ -49,11 +49,16 @@ public:
 	// ACCESSORS
 	static F32 getInterpolant(const F32 time_constant, BOOL use_cache = TRUE);
 
+	// While frozen the cache is only read, never grown, so getInterpolant()
+	// may be called from several threads at once (parallel animation stage).
+	static void setCacheFrozen(BOOL frozen) { sCacheFrozen = frozen; }
+
 protected:	
 	static LLFrameTimer sInternalTimer;	// frame timer for calculating deltas
 
 	static std::map<F32, F32> 	sInterpolants;
 	static F32					sTimeDelta;
+	static BOOL					sCacheFrozen;
 };
 
 #endif  // LL_LLCRITICALDAMP_H
@@ -112,8 +112,10 @@ public:
 		FTM_STATESORT,
 		FTM_STATESORT_DRAWABLE,
 		FTM_STATESORT_POSTSORT,
+		FTM_STATESORT_SORT,
 		FTM_REBUILD_VBO,
 		FTM_REBUILD_VOLUME_VB,
+		FTM_REBUILD_VOLUME_GEOM,
 		FTM_REBUILD_BRIDGE_VB,
 		FTM_REBUILD_HUD_VB,
 		FTM_REBUILD_TERRAIN_VB,
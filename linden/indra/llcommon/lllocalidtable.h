@@ -0,0 +1,287 @@
+/**
+ * @file lllocalidtable.h
+ * @brief Dense open addressing map from simulator local ids to pointers.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLLOCALIDTABLE_H
+#define LL_LLLOCALIDTABLE_H
+
+#include "stdtypes.h"
+
+// Maps U32 local ids to pointers with a single flat array and linear probing.
+// Local ids handed out by one simulator are small and mostly sequential, so a
+// multiplicative hash spreads them well and a lookup is normally one cache
+// line. The table never holds more than half its slots, and removal shifts
+// later entries back instead of leaving tombstones, so probe chains stay short
+// however much the contents churn.
+//
+// DATA_TYPE must be a pointer type: NULL marks an empty slot and cannot be stored.
+template <class DATA_TYPE>
+class LLLocalIDTable
+{
+public:
+	LLLocalIDTable();
+	~LLLocalIDTable();
+
+	// Returns NULL if local_id is not in the map.
+	inline DATA_TYPE find(U32 local_id) const;
+
+	// Inserts or replaces. Returns the previous value, or NULL.
+	DATA_TYPE set(U32 local_id, DATA_TYPE data);
+
+	// Removes local_id. The second form only removes it if it maps to data,
+	// so a stale owner cannot zap an entry that has since been reused.
+	BOOL remove(U32 local_id);
+	BOOL remove(U32 local_id, DATA_TYPE data);
+
+	void clear();
+
+	S32 getLength() const		{ return mCount; }
+	S32 getCapacity() const		{ return mCapacity; }
+
+	// Slot access, for walking the whole map. Empty slots return NULL.
+	DATA_TYPE getSlotData(S32 slot) const	{ return mSlots[slot].mData; }
+	U32 getSlotKey(S32 slot) const			{ return mSlots[slot].mKey; }
+
+	// Average number of slots looked at per find() since the last reset.
+	F32 getAverageProbes() const	{ return mLookups ? (F32)mProbes / (F32)mLookups : 0.f; }
+	void resetProbeStats() const	{ mProbes = 0; mLookups = 0; }
+
+private:
+	struct Slot
+	{
+		U32			mKey;
+		DATA_TYPE	mData;
+	};
+
+	inline U32 home(U32 local_id) const
+	{
+		// Fibonacci hashing: the top bits of the product are the best mixed.
+		return (local_id * 2654435769U) >> mShift;
+	}
+	void resize(S32 capacity);
+	void removeSlot(U32 slot);
+
+	LLLocalIDTable(const LLLocalIDTable&);				// not implemented
+	LLLocalIDTable& operator=(const LLLocalIDTable&);	// not implemented
+
+private:
+	Slot*	mSlots;
+	S32		mCapacity;		// always 0 or a power of two
+	U32		mShift;
+	S32		mCount;
+
+	mutable U32 mProbes;
+	mutable U32 mLookups;
+};
+
+const S32 LOCAL_ID_TABLE_MIN_CAPACITY = 64;
+
+template <class DATA_TYPE>
+LLLocalIDTable<DATA_TYPE>::LLLocalIDTable()
+:	mSlots(NULL),
+	mCapacity(0),
+	mShift(32),
+	mCount(0),
+	mProbes(0),
+	mLookups(0)
+{
+}
+
+template <class DATA_TYPE>
+LLLocalIDTable<DATA_TYPE>::~LLLocalIDTable()
+{
+	delete[] mSlots;
+}
+
+template <class DATA_TYPE>
+inline DATA_TYPE LLLocalIDTable<DATA_TYPE>::find(U32 local_id) const
+{
+	mLookups++;
+	if (!mCount)
+	{
+		return NULL;
+	}
+	U32 mask = mCapacity - 1;
+	for (U32 slot = home(local_id); ; slot = (slot + 1) & mask)
+	{
+		mProbes++;
+		const Slot& entry = mSlots[slot];
+		if (!entry.mData)
+		{
+			return NULL;
+		}
+		if (entry.mKey == local_id)
+		{
+			return entry.mData;
+		}
+	}
+}
+
+template <class DATA_TYPE>
+DATA_TYPE LLLocalIDTable<DATA_TYPE>::set(U32 local_id, DATA_TYPE data)
+{
+	if (!data)
+	{
+		remove(local_id);
+		return NULL;
+	}
+	if ((mCount + 1) * 2 > mCapacity)
+	{
+		resize(mCapacity ? mCapacity * 2 : LOCAL_ID_TABLE_MIN_CAPACITY);
+	}
+
+	U32 mask = mCapacity - 1;
+	U32 slot = home(local_id);
+	while (mSlots[slot].mData && mSlots[slot].mKey != local_id)
+	{
+		slot = (slot + 1) & mask;
+	}
+	DATA_TYPE previous = mSlots[slot].mData;
+	if (!previous)
+	{
+		mCount++;
+	}
+	mSlots[slot].mKey = local_id;
+	mSlots[slot].mData = data;
+	return previous;
+}
+
+template <class DATA_TYPE>
+BOOL LLLocalIDTable<DATA_TYPE>::remove(U32 local_id)
+{
+	if (!mCount)
+	{
+		return FALSE;
+	}
+	U32 mask = mCapacity - 1;
+	for (U32 slot = home(local_id); mSlots[slot].mData; slot = (slot + 1) & mask)
+	{
+		if (mSlots[slot].mKey == local_id)
+		{
+			removeSlot(slot);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+template <class DATA_TYPE>
+BOOL LLLocalIDTable<DATA_TYPE>::remove(U32 local_id, DATA_TYPE data)
+{
+	if (!mCount)
+	{
+		return FALSE;
+	}
+	U32 mask = mCapacity - 1;
+	for (U32 slot = home(local_id); mSlots[slot].mData; slot = (slot + 1) & mask)
+	{
+		if (mSlots[slot].mKey == local_id)
+		{
+			if (mSlots[slot].mData != data)
+			{
+				return FALSE;
+			}
+			removeSlot(slot);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+template <class DATA_TYPE>
+void LLLocalIDTable<DATA_TYPE>::removeSlot(U32 slot)
+{
+	// Walk the rest of the cluster and pull back every entry whose home
+	// slot does not lie between the hole and its current position.
+	U32 mask = mCapacity - 1;
+	U32 hole = slot;
+	for (U32 next = (hole + 1) & mask; mSlots[next].mData; next = (next + 1) & mask)
+	{
+		U32 want = home(mSlots[next].mKey);
+		bool stays = (hole <= next) ? (hole < want && want <= next)
+									: (hole < want || want <= next);
+		if (!stays)
+		{
+			mSlots[hole] = mSlots[next];
+			hole = next;
+		}
+	}
+	mSlots[hole].mData = NULL;
+	mSlots[hole].mKey = 0;
+
+	if (--mCount == 0)
+	{
+		// Tables belong to regions that come and go; give the memory back.
+		clear();
+	}
+}
+
+template <class DATA_TYPE>
+void LLLocalIDTable<DATA_TYPE>::resize(S32 capacity)
+{
+	Slot* old_slots = mSlots;
+	S32 old_capacity = mCapacity;
+
+	mSlots = new Slot[capacity];
+	mCapacity = capacity;
+	mShift = 32;
+	for (S32 size = capacity; size > 1; size >>= 1)
+	{
+		mShift--;
+	}
+	for (S32 i = 0; i < capacity; i++)
+	{
+		mSlots[i].mKey = 0;
+		mSlots[i].mData = NULL;
+	}
+
+	U32 mask = mCapacity - 1;
+	for (S32 i = 0; i < old_capacity; i++)
+	{
+		if (old_slots[i].mData)
+		{
+			U32 slot = home(old_slots[i].mKey);
+			while (mSlots[slot].mData)
+			{
+				slot = (slot + 1) & mask;
+			}
+			mSlots[slot] = old_slots[i];
+		}
+	}
+	delete[] old_slots;
+}
+
+template <class DATA_TYPE>
+void LLLocalIDTable<DATA_TYPE>::clear()
+{
+	delete[] mSlots;
+	mSlots = NULL;
+	mCapacity = 0;
+	mShift = 32;
+	mCount = 0;
+}
+
+#endif // LL_LLLOCALIDTABLE_H
@@ -0,0 +1,277 @@
+/**
+ * @file llrangeallocator.cpp
+ * @brief First-fit sub-allocation of ranges from large blocks, with
+ * incremental defragmentation.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "linden_common.h"
+
+#include "llrangeallocator.h"
+
+#include <algorithm>
+
+LLRangeAllocator::LLRangeAllocator(U32 block_size, U32 max_range, U32 alignment)
+:	mBlockSize(block_size),
+	mMaxRange(max_range),
+	mAlignment(alignment),
+	mDraining(NULL),
+	mRangeCount(0),
+	mUsedBytes(0),
+	mMovedBytes(0)
+{
+}
+
+LLRangeAllocator::~LLRangeAllocator()
+{
+	// subclasses delete their blocks, this can't call back into them
+	for (std::vector<Block*>::iterator iter = mBlocks.begin(); iter != mBlocks.end(); ++iter)
+	{
+		delete *iter;
+	}
+}
+
+LLRangeAllocator::Block* LLRangeAllocator::findBlock(U32 name) const
+{
+	for (std::vector<Block*>::const_iterator iter = mBlocks.begin(); iter != mBlocks.end(); ++iter)
+	{
+		if ((*iter)->mName == name)
+		{
+			return *iter;
+		}
+	}
+	return NULL;
+}
+
+LLRangeAllocator::Block* LLRangeAllocator::newBlock()
+{
+	Block* block = new Block;
+	block->mName = createBlock(mBlockSize);
+	block->mFreeBytes = mBlockSize;
+	block->mFree[0] = mBlockSize;
+	mBlocks.push_back(block);
+	return block;
+}
+
+void LLRangeAllocator::releaseBlock(Block* block)
+{
+	llassert(block->mRanges.empty());
+	mBlocks.erase(std::find(mBlocks.begin(), mBlocks.end(), block));
+	if (mDraining == block)
+	{
+		mDraining = NULL;
+	}
+	deleteBlock(block->mName);
+	delete block;
+}
+
+BOOL LLRangeAllocator::allocateFrom(Block* block, U32 size, U32& offset)
+{
+	if (block->mFreeBytes < size)
+	{
+		return FALSE;
+	}
+
+	// first fit
+	for (std::map<U32, U32>::iterator iter = block->mFree.begin(); iter != block->mFree.end(); ++iter)
+	{
+		if (iter->second >= size)
+		{
+			offset = iter->first;
+			U32 left = iter->second - size;
+			block->mFree.erase(iter);
+			if (left)
+			{
+				block->mFree[offset + size] = left;
+			}
+			block->mFreeBytes -= size;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+BOOL LLRangeAllocator::allocate(void* owner, U32 size, U32& block_name, U32& offset)
+{
+	size = (size + mAlignment - 1) & ~(mAlignment - 1);
+	if (size == 0 || size > mMaxRange)
+	{
+		return FALSE;
+	}
+
+	Block* block = NULL;
+	for (std::vector<Block*>::iterator iter = mBlocks.begin(); iter != mBlocks.end(); ++iter)
+	{
+		if (*iter != mDraining && allocateFrom(*iter, size, offset))
+		{
+			block = *iter;
+			break;
+		}
+	}
+	if (!block)
+	{
+		block = newBlock();
+		allocateFrom(block, size, offset);
+	}
+
+	Range& range = block->mRanges[offset];
+	range.mSize = size;
+	range.mOwner = owner;
+	block_name = block->mName;
+
+	mRangeCount++;
+	mUsedBytes += size;
+	return TRUE;
+}
+
+void LLRangeAllocator::free(U32 block_name, U32 offset)
+{
+	Block* block = findBlock(block_name);
+	if (!block || block->mRanges.find(offset) == block->mRanges.end())
+	{
+		llerrs << "Freeing a range that was not allocated." << llendl;
+		return;
+	}
+	freeRange(block, offset);
+}
+
+void LLRangeAllocator::freeRange(Block* block, U32 offset)
+{
+	std::map<U32, Range>::iterator range_iter = block->mRanges.find(offset);
+	U32 size = range_iter->second.mSize;
+	block->mRanges.erase(range_iter);
+	block->mFreeBytes += size;
+	mRangeCount--;
+	mUsedBytes -= size;
+
+	// merge with the free space on either side
+	std::map<U32, U32>::iterator next = block->mFree.lower_bound(offset);
+	if (next != block->mFree.end() && next->first == offset + size)
+	{
+		size += next->second;
+		block->mFree.erase(next++);
+	}
+	if (next != block->mFree.begin())
+	{
+		std::map<U32, U32>::iterator prev = next;
+		--prev;
+		if (prev->first + prev->second == offset)
+		{
+			prev->second += size;
+			size = 0;
+		}
+	}
+	if (size)
+	{
+		block->mFree[offset] = size;
+	}
+
+	// keep one empty block so that an allocator that's in use doesn't thrash
+	if (block->mRanges.empty() && mBlocks.size() > 1)
+	{
+		releaseBlock(block);
+	}
+}
+
+BOOL LLRangeAllocator::defragmentStep(U32& max_bytes)
+{
+	if (!mDraining)
+	{
+		// Worth it once a whole block could be freed, with some to spare
+		U32 free_bytes = 0;
+		Block* emptiest = NULL;
+		for (std::vector<Block*>::iterator iter = mBlocks.begin(); iter != mBlocks.end(); ++iter)
+		{
+			free_bytes += (*iter)->mFreeBytes;
+			if (!emptiest || (*iter)->mFreeBytes > emptiest->mFreeBytes)
+			{
+				emptiest = *iter;
+			}
+		}
+		if (mBlocks.size() < 2 || free_bytes < mBlockSize + mBlockSize / 2)
+		{
+			return FALSE;
+		}
+		mDraining = emptiest;
+	}
+
+	BOOL moved = FALSE;
+	std::map<U32, Range>::iterator iter = mDraining->mRanges.begin();
+	while (iter != mDraining->mRanges.end() && max_bytes > 0)
+	{
+		U32 src_offset = iter->first;
+		Range range = iter->second;
+		++iter;
+
+		if (!canMoveRange(range.mOwner))
+		{ //being written, try again later
+			continue;
+		}
+
+		Block* dst = NULL;
+		U32 dst_offset = 0;
+		for (std::vector<Block*>::iterator block_iter = mBlocks.begin(); block_iter != mBlocks.end(); ++block_iter)
+		{
+			if (*block_iter != mDraining && allocateFrom(*block_iter, range.mSize, dst_offset))
+			{
+				dst = *block_iter;
+				break;
+			}
+		}
+		if (!dst)
+		{ //the others are too fragmented, give up on this one
+			mDraining = NULL;
+			break;
+		}
+
+		moveRange(range.mOwner, range.mSize, mDraining->mName, src_offset, dst->mName, dst_offset);
+
+		dst->mRanges[dst_offset] = range;
+		mRangeCount++;
+		mUsedBytes += range.mSize;
+		mMovedBytes += range.mSize;
+		max_bytes -= llmin(max_bytes, range.mSize);
+		moved = TRUE;
+
+		// may release mDraining
+		freeRange(mDraining, src_offset);
+		if (!mDraining)
+		{
+			break;
+		}
+	}
+
+	return moved;
+}
+
+void LLRangeAllocator::deleteEmptyBlocks()
+{
+	for (S32 i = (S32)mBlocks.size() - 1; i >= 0; i--)
+	{
+		if (mBlocks[i]->mRanges.empty())
+		{
+			releaseBlock(mBlocks[i]);
+		}
+	}
+}
@@ -0,0 +1,112 @@
+/**
+ * @file llrangeallocator.h
+ * @brief First-fit sub-allocation of ranges from large blocks, with
+ * incremental defragmentation.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLRANGEALLOCATOR_H
+#define LL_LLRANGEALLOCATOR_H
+
+#include "stdtypes.h"
+
+#include <map>
+#include <vector>
+
+// Hands out ranges of large fixed size blocks, such as shared GL buffers.
+// Ranges are taken first-fit from a per-block free list, and adjacent free
+// space is merged when a range is released. Once a whole block's worth of
+// space is free across the blocks, defragmentStep() drains the emptiest
+// block into the others a few ranges at a time and deletes it.
+//
+// The allocator only does the bookkeeping. A subclass owns the storage: it
+// creates and deletes blocks, and copies a range when one is moved and
+// points its owner at the new place.
+class LLRangeAllocator
+{
+public:
+	LLRangeAllocator(U32 block_size, U32 max_range, U32 alignment);
+	virtual ~LLRangeAllocator();
+
+	// Finds size bytes for owner. Returns FALSE if the range is bigger than
+	// max_range, and the owner should get storage of its own.
+	BOOL allocate(void* owner, U32 size, U32& block, U32& offset);
+	void free(U32 block, U32 offset);
+
+	// Moves ranges out of the block being emptied, up to max_bytes, which is
+	// reduced by what was moved. Returns FALSE if there was nothing to do.
+	BOOL defragmentStep(U32& max_bytes);
+
+	// Deletes the blocks that have no ranges left.
+	void deleteEmptyBlocks();
+
+	U32 getBlockSize() const		{ return mBlockSize; }
+	S32 getBlockCount() const		{ return (S32)mBlocks.size(); }
+	U32 getRangeCount() const		{ return mRangeCount; }
+	U32 getUsedBytes() const		{ return mUsedBytes; }
+	U32 getMovedBytes() const		{ return mMovedBytes; }
+
+protected:
+	// Returns the name of a new block of size bytes. Names must not be 0.
+	virtual U32 createBlock(U32 size) = 0;
+	virtual void deleteBlock(U32 block) = 0;
+	// Ranges whose owner is being written to are left where they are.
+	virtual BOOL canMoveRange(void* owner) const = 0;
+	// Copies a range to its new place and points owner there.
+	virtual void moveRange(void* owner, U32 size, U32 src_block, U32 src_offset,
+						   U32 dst_block, U32 dst_offset) = 0;
+
+private:
+	struct Range
+	{
+		U32 mSize;
+		void* mOwner;
+	};
+
+	struct Block
+	{
+		U32 mName;
+		U32 mFreeBytes;
+		std::map<U32, U32> mFree;		// offset to size, adjacent ranges merged
+		std::map<U32, Range> mRanges;	// offset to range
+	};
+
+	Block* findBlock(U32 name) const;
+	Block* newBlock();
+	void releaseBlock(Block* block);
+	BOOL allocateFrom(Block* block, U32 size, U32& offset);
+	void freeRange(Block* block, U32 offset);
+
+	U32 mBlockSize;
+	U32 mMaxRange;
+	U32 mAlignment;
+	std::vector<Block*> mBlocks;
+	Block* mDraining;	// being emptied by defragmentStep()
+
+	U32 mRangeCount;
+	U32 mUsedBytes;
+	U32 mMovedBytes;
+};
+
+#endif // LL_LLRANGEALLOCATOR_H
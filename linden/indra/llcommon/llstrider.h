@@ -49,6 +49,7 @@ public:
 
 	const LLStrider<Object>& operator =  (Object *first)    { mObjectp = first; return *this;}
 	void setStride (S32 skipBytes)	{ mSkip = (skipBytes ? skipBytes : sizeof(Object));}
+	U32  getStride() const         { return mSkip; }
 
 	void skip(const U32 index)     { mBytep += mSkip*index;}
 
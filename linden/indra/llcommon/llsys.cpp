@@ -43,6 +43,14 @@
 
 #include "llprocessor.h"
 
+#if LL_X86 && (LL_WINDOWS || LL_DARWIN || LL_SOLARIS)
+#	if LL_MSVC
+#		include <intrin.h>
+#	else
+#		include <cpuid.h>
+#	endif
+#endif
+
 #if LL_WINDOWS
 #	define WIN32_LEAN_AND_MEAN
 #	include <winsock2.h>
@@ -534,6 +542,48 @@ U32 LLOSInfo::getProcessResidentSizeKB()
 	return resident_size;
 }
 
+#if LL_X86 && (LL_WINDOWS || LL_DARWIN || LL_SOLARIS)
+// CProcessor predates AVX, so ask the CPU directly. The OS has to save the
+// YMM registers too (OSXSAVE set and XCR0 bits 1 and 2), or the instructions
+// fault even though the CPU advertises them.
+static bool detect_avx2()
+{
+	U32 regs[4];
+	U32 xcr0;
+# if LL_MSVC
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	__cpuid(info, 1);
+	regs[2] = (U32)info[2];
+	if ((regs[2] & 0x18001000) != 0x18001000)	// FMA, OSXSAVE, AVX
+	{
+		return false;
+	}
+	xcr0 = (U32)_xgetbv(0);
+	__cpuidex(info, 7, 0);
+	regs[1] = (U32)info[1];
+# else
+	if (__get_cpuid_max(0, NULL) < 7)
+	{
+		return false;
+	}
+	__cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+	if ((regs[2] & 0x18001000) != 0x18001000)	// FMA, OSXSAVE, AVX
+	{
+		return false;
+	}
+	U32 edx;
+	__asm__ __volatile__ ("xgetbv" : "=a" (xcr0), "=d" (edx) : "c" (0));
+	__cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+# endif
+	return (xcr0 & 6) == 6 && (regs[1] & 0x20) != 0;	// AVX2 is leaf 7 EBX bit 5
+}
+#endif
+
 LLCPUInfo::LLCPUInfo()
 {
 	std::ostringstream out;
@@ -543,6 +593,11 @@ LLCPUInfo::LLCPUInfo()
 	mHasSSE = info->_Ext.SSE_StreamingSIMD_Extensions;
 	mHasSSE2 = info->_Ext.SSE2_StreamingSIMD2_Extensions;
 	mHasAltivec = info->_Ext.Altivec_Extensions;
+#if LL_X86 && (LL_WINDOWS || LL_DARWIN || LL_SOLARIS)
+	mHasAVX2 = detect_avx2();
+#else
+	mHasAVX2 = false;
+#endif
 	mCPUMHz = (F64)(proc.GetCPUFrequency(50)/1000000.0);
 	mFamily.assign( info->strFamily );
 	mCPUString = "Unknown";
@@ -591,6 +646,8 @@ LLCPUInfo::LLCPUInfo()
 	LLStringUtil::toLower(flags);
 	mHasSSE = ( flags.find( " sse " ) != std::string::npos );
 	mHasSSE2 = ( flags.find( " sse2 " ) != std::string::npos );
+	mHasAVX2 = ( flags.find( " avx2 " ) != std::string::npos
+				 && flags.find( " fma " ) != std::string::npos );
 	
 	F64 mhz;
 	if (LLStringUtil::convertToF64(cpuinfo["cpu mhz"], mhz)
@@ -619,6 +676,11 @@ bool LLCPUInfo::hasSSE2() const
 	return mHasSSE2;
 }
 
+bool LLCPUInfo::hasAVX2() const
+{
+	return mHasAVX2;
+}
+
 F64 LLCPUInfo::getMHz() const
 {
 	return mCPUMHz;
@@ -667,6 +729,7 @@ void LLCPUInfo::stream(std::ostream& s) const
 	// CPU's attributes regardless of platform
 	s << "->mHasSSE:     " << (U32)mHasSSE << std::endl;
 	s << "->mHasSSE2:    " << (U32)mHasSSE2 << std::endl;
+	s << "->mHasAVX2:    " << (U32)mHasAVX2 << std::endl;
 	s << "->mHasAltivec: " << (U32)mHasAltivec << std::endl;
 	s << "->mCPUMHz:     " << mCPUMHz << std::endl;
 	s << "->mCPUString:  " << mCPUString << std::endl;
@@ -81,6 +81,7 @@ public:
 	bool hasAltivec() const;
 	bool hasSSE() const;
 	bool hasSSE2() const;
+	bool hasAVX2() const;	// AVX2 and FMA, with OS support for the wide registers
 	F64 getMHz() const;
 
 	// Family is "AMD Duron" or "Intel Pentium Pro"
@@ -89,6 +90,7 @@ public:
 private:
 	bool mHasSSE;
 	bool mHasSSE2;
+	bool mHasAVX2;
 	bool mHasAltivec;
 	F64 mCPUMHz;
 	std::string mFamily;
@@ -0,0 +1,229 @@
+/**
+ * @file llthreadpool.cpp
+ * @brief A small pool of worker threads for fork/join data-parallel loops.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "linden_common.h"
+
+#include "llthreadpool.h"
+
+#if LL_WINDOWS
+#	define WIN32_LEAN_AND_MEAN
+#	include <winsock2.h>
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#endif
+
+// Upper bound on threads picked automatically. The texture, cache and decode
+// threads also want a core, and the loops we run are short.
+const S32 MAX_AUTO_POOL_THREADS = 8;
+
+//static
+LLThreadPool* LLThreadPool::sInstance = NULL;
+
+//============================================================================
+
+LLThreadPool::Worker::Worker(const std::string& name, LLThreadPool* pool)
+:	LLThread(name),
+	mPool(pool)
+{
+}
+
+//virtual
+void LLThreadPool::Worker::run()
+{
+	U32 generation = 0;
+	while (mPool->waitForWork(generation))
+	{
+		mPool->runChunks(true);
+	}
+}
+
+//============================================================================
+
+LLThreadPool::LLThreadPool(const std::string& name, S32 num_threads)
+:	mJob(NULL),
+	mCount(0),
+	mGrain(1),
+	mNext(0),
+	mDone(0),
+	mBusyWorkers(0),
+	mGeneration(0),
+	mQuitting(false),
+	mRunning(false),
+	mLastChunks(0),
+	mLastWorkerChunks(0)
+{
+	for (S32 i = 0; i < num_threads; i++)
+	{
+		Worker* worker = new Worker(llformat("%s %d", name.c_str(), i), this);
+		mThreads.push_back(worker);
+		worker->start();
+	}
+}
+
+LLThreadPool::~LLThreadPool()
+{
+	llassert(!mRunning);
+
+	mCondition.lock();
+	mQuitting = true;
+	mCondition.broadcast();
+	mCondition.unlock();
+
+	// ~LLThread waits for each thread to leave run()
+	for (std::vector<Worker*>::iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+	{
+		delete *iter;
+	}
+	mThreads.clear();
+}
+
+void LLThreadPool::parallelFor(Job& job, S32 count, S32 grain, bool threaded)
+{
+	llassert(!mRunning);
+
+	grain = llmax(grain, 1);
+	if (!threaded || mThreads.empty() || count < 2 * grain)
+	{
+		mLastChunks = count > 0 ? 1 : 0;
+		mLastWorkerChunks = 0;
+		if (count > 0)
+		{
+			job.run(0, count);
+		}
+		return;
+	}
+
+	mCondition.lock();
+	mJob = &job;
+	mCount = count;
+	mGrain = grain;
+	mNext = 0;
+	mDone = 0;
+	mLastChunks = 0;
+	mLastWorkerChunks = 0;
+	mRunning = true;
+	mGeneration++;
+	mCondition.broadcast();
+	mCondition.unlock();
+
+	runChunks(false);
+
+	mCondition.lock();
+	// Wait for the last chunk, and for every worker to let go of mJob.
+	while (mDone < mCount || mBusyWorkers > 0)
+	{
+		mCondition.wait();
+	}
+	mRunning = false;
+	mJob = NULL;
+	mCondition.unlock();
+}
+
+bool LLThreadPool::waitForWork(U32& generation)
+{
+	mCondition.lock();
+	while (!mQuitting && generation == mGeneration)
+	{
+		mCondition.wait();
+	}
+	bool quitting = mQuitting;
+	if (!quitting)
+	{
+		generation = mGeneration;
+		mBusyWorkers++;
+	}
+	mCondition.unlock();
+	return !quitting;
+}
+
+void LLThreadPool::runChunks(bool is_worker)
+{
+	mCondition.lock();
+	while (mRunning && mNext < mCount)
+	{
+		S32 begin = mNext;
+		S32 end = llmin(begin + mGrain, mCount);
+		mNext = end;
+		mLastChunks++;
+		if (is_worker)
+		{
+			mLastWorkerChunks++;
+		}
+		Job* job = mJob;
+		mCondition.unlock();
+
+		job->run(begin, end);
+
+		mCondition.lock();
+		mDone += end - begin;
+	}
+	if (is_worker)
+	{
+		mBusyWorkers--;
+	}
+	if (mDone >= mCount && mBusyWorkers == 0)
+	{
+		mCondition.broadcast();
+	}
+	mCondition.unlock();
+}
+
+//============================================================================
+
+//static
+void LLThreadPool::initClass(S32 num_threads)
+{
+	llassert(sInstance == NULL);
+	if (num_threads < 0)
+	{
+		num_threads = llclamp(getProcessorCount() - 1, 0, MAX_AUTO_POOL_THREADS);
+	}
+	llinfos << "Starting thread pool with " << num_threads << " threads" << llendl;
+	sInstance = new LLThreadPool("Pool", num_threads);
+}
+
+//static
+void LLThreadPool::cleanupClass()
+{
+	delete sInstance;
+	sInstance = NULL;
+}
+
+//static
+S32 LLThreadPool::getProcessorCount()
+{
+	S32 count = 1;
+#if LL_WINDOWS
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	count = (S32)info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	count = (S32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return llmax(count, 1);
+}
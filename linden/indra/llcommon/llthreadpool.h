@@ -0,0 +1,122 @@
+/**
+ * @file llthreadpool.h
+ * @brief A small pool of worker threads for fork/join data-parallel loops.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLTHREADPOOL_H
+#define LL_LLTHREADPOOL_H
+
+#include "llthread.h"
+
+#include <string>
+#include <vector>
+
+//============================================================================
+// LLThreadPool
+//
+// Unlike LLQueuedThread, which serves a queue of long lived requests on one
+// background thread, this runs a single short loop body over an index range
+// on several threads at once and returns when every index has been handled.
+// The calling thread takes part in the work, so a pool with zero threads
+// simply runs the loop inline.
+//
+// Only one loop may be in flight at a time and it must be started from the
+// thread that owns the pool (normally the main thread). Loop bodies must not
+// touch the message system, GL, LLFastTimer or anything else that is not
+// thread safe; they should read their inputs and write their outputs to
+// per-index slots so that results do not depend on scheduling.
+
+class LL_COMMON_API LLThreadPool
+{
+public:
+	// Loop body. run() is called with disjoint [begin, end) sub-ranges,
+	// possibly concurrently from several threads.
+	class LL_COMMON_API Job
+	{
+	public:
+		virtual ~Job() {}
+		virtual void run(S32 begin, S32 end) = 0;
+	};
+
+	LLThreadPool(const std::string& name, S32 num_threads);
+	~LLThreadPool();
+
+	// Runs job over [0, count) and blocks until it is done. At most
+	// 'grain' indices are handed out at a time. If 'threaded' is false
+	// or count is below 2 * grain the loop is run inline.
+	void parallelFor(Job& job, S32 count, S32 grain = 1, bool threaded = true);
+
+	S32 getThreadCount() const			{ return (S32)mThreads.size(); }
+
+	// Number of chunks the last loop was split into, and how many of those
+	// were run by pool threads rather than the caller.
+	S32 getLastChunkCount() const		{ return mLastChunks; }
+	S32 getLastWorkerChunkCount() const	{ return mLastWorkerChunks; }
+
+	// Shared pool used by the viewer. A negative count sizes it from the
+	// number of processors, keeping one for the calling thread.
+	static void initClass(S32 num_threads = -1);
+	static void cleanupClass();
+	static LLThreadPool* getInstance()	{ return sInstance; }
+
+	static S32 getProcessorCount();
+
+private:
+	class Worker : public LLThread
+	{
+	public:
+		Worker(const std::string& name, LLThreadPool* pool);
+		/*virtual*/ void run();
+	private:
+		LLThreadPool* mPool;
+	};
+	friend class Worker;
+
+	// Hands out chunks of the current loop until none are left.
+	void runChunks(bool is_worker);
+	// Called by workers: blocks until a new loop is posted. Returns false on shutdown.
+	bool waitForWork(U32& generation);
+
+private:
+	std::vector<Worker*> mThreads;
+	LLCondition		mCondition;		// guards everything below
+
+	Job*			mJob;
+	S32				mCount;
+	S32				mGrain;
+	S32				mNext;			// next index to hand out
+	S32				mDone;			// indices finished
+	S32				mBusyWorkers;	// workers currently inside runChunks()
+	U32				mGeneration;	// bumped each time a loop is posted
+	bool			mQuitting;
+	bool			mRunning;
+
+	S32				mLastChunks;
+	S32				mLastWorkerChunks;
+
+	static LLThreadPool* sInstance;
+};
+
+#endif // LL_LLTHREADPOOL_H
@@ -0,0 +1,404 @@
+/**
+ * @file llimagecompositor.cpp
+ * @brief Software version of the GL compositing used for avatar bakes.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "linden_common.h"
+
+#include "llimagecompositor.h"
+
+#include "llmath.h"
+
+#include <map>
+
+// the alpha test is GL_GREATER 0.01
+const F32 ALPHA_REF = 0.01f;
+
+// rounds a blended value into the 8 bit target
+inline U8 to_channel(F32 value)
+{
+	return (U8)(llclamp(value, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+//-----------------------------------------------------------------------------
+// Source
+// An image as GL would sample it over the target: expanded to RGBA, with the
+// channels its format lacks set to 255, and resampled to the target size.
+//-----------------------------------------------------------------------------
+class LLImageCompositor::Source
+{
+public:
+	Source(const LLImageRaw* image, BOOL is_mask, S32 width, S32 height);
+
+	std::vector<U8>	mData;
+	bool			mHasColor;
+	bool			mHasAlpha;
+};
+
+// Expands w x h pixels of components channels to RGBA.
+static void expand_rgba(const U8* data, S32 w, S32 h, S32 components, BOOL is_mask, std::vector<U8>& rgba)
+{
+	rgba.resize(w * h * 4);
+	for (S32 i = 0; i < w * h; i++)
+	{
+		const U8* in = data + i * components;
+		U8* out = &rgba[i * 4];
+		switch (components)
+		{
+		case 1:
+			if (is_mask)
+			{
+				out[0] = out[1] = out[2] = 255;
+				out[3] = in[0];
+			}
+			else
+			{
+				out[0] = out[1] = out[2] = in[0];
+				out[3] = 255;
+			}
+			break;
+		case 2:
+			out[0] = out[1] = out[2] = in[0];
+			out[3] = in[1];
+			break;
+		case 3:
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+			out[3] = 255;
+			break;
+		default:
+			out[0] = in[0];
+			out[1] = in[1];
+			out[2] = in[2];
+			out[3] = in[3];
+			break;
+		}
+	}
+}
+
+// Bilinear filtering with texel centers at half integers and clamped
+// edges, with 8 bits of sub-texel precision. The results keep 16 bits of
+// fraction, so that two mip levels can be blended before rounding.
+static void resample(const std::vector<U8>& rgba, S32 w, S32 h, S32 width, S32 height, std::vector<U32>& out)
+{
+	std::vector<S32> x0(width), x1(width), fx(width);
+	for (S32 x = 0; x < width; x++)
+	{
+		S32 pos = (S32)(((S64)(2 * x + 1) * w * 256) / (2 * width)) - 128;
+		pos = llmax(pos, 0);
+		x0[x] = llmin(pos >> 8, w - 1);
+		x1[x] = llmin(x0[x] + 1, w - 1);
+		fx[x] = pos & 255;
+	}
+
+	out.resize(width * height * 4);
+	U32* dst = &out[0];
+	for (S32 y = 0; y < height; y++)
+	{
+		S32 pos = (S32)(((S64)(2 * y + 1) * h * 256) / (2 * height)) - 128;
+		pos = llmax(pos, 0);
+		S32 y0 = llmin(pos >> 8, h - 1);
+		S32 y1 = llmin(y0 + 1, h - 1);
+		U32 fy = pos & 255;
+		const U8* row0 = &rgba[y0 * w * 4];
+		const U8* row1 = &rgba[y1 * w * 4];
+		for (S32 x = 0; x < width; x++)
+		{
+			const U8* a = row0 + x0[x] * 4;
+			const U8* b = row0 + x1[x] * 4;
+			const U8* c = row1 + x0[x] * 4;
+			const U8* d = row1 + x1[x] * 4;
+			U32 f = fx[x];
+			for (S32 k = 0; k < 4; k++)
+			{
+				U32 top = a[k] * (256 - f) + b[k] * f;
+				U32 bottom = c[k] * (256 - f) + d[k] * f;
+				*dst++ = top * (256 - fy) + bottom * fy;
+			}
+		}
+	}
+}
+
+LLImageCompositor::Source::Source(const LLImageRaw* image, BOOL is_mask, S32 width, S32 height)
+{
+	S32 w = image->getWidth();
+	S32 h = image->getHeight();
+	S32 components = image->getComponents();
+	mHasColor = (components != 1) || !is_mask;
+	mHasAlpha = (components == 2) || (components == 4) || ((components == 1) && is_mask);
+
+	// Use the mip level GL would: halve while the image is at least twice
+	// the target size, with the same box filter LLImageGL builds mips with.
+	const U8* data = image->getData();
+	std::vector<U8> mip;
+	while ((w >= width * 2 || h >= height * 2) && !(w & 1) && !(h & 1))
+	{
+		std::vector<U8> level((w / 2) * (h / 2) * components);
+		LLImageBase::generateMip(data, &level[0], w / 2, h / 2, components);
+		mip.swap(level);
+		data = &mip[0];
+		w /= 2;
+		h /= 2;
+	}
+
+	// Mipmapped textures are minified with GL_LINEAR_MIPMAP_LINEAR, which
+	// blends in the next level by the fraction of log2 of the minification
+	// left over. Power of two sizes never leave one.
+	F32 ratio = llmax((F32)w / width, (F32)h / height);
+	U32 blend = 0;
+	std::vector<U8> next;
+	if (ratio > 1.f && !(w & 1) && !(h & 1))
+	{
+		blend = (U32)llclamp(llround(logf(ratio) / F_LN2 * 256.f), 0, 256);
+		next.resize((w / 2) * (h / 2) * components);
+		LLImageBase::generateMip(data, &next[0], w / 2, h / 2, components);
+	}
+
+	std::vector<U8> rgba;
+	expand_rgba(data, w, h, components, is_mask, rgba);
+	if (w == width && h == height && !blend)
+	{
+		mData.swap(rgba);
+		return;
+	}
+
+	std::vector<U32> filtered;
+	resample(rgba, w, h, width, height, filtered);
+	mData.resize(width * height * 4);
+	if (!blend)
+	{
+		for (U32 i = 0; i < mData.size(); i++)
+		{
+			mData[i] = (U8)((filtered[i] + 32768) >> 16);
+		}
+		return;
+	}
+
+	std::vector<U32> filtered_next;
+	expand_rgba(&next[0], w / 2, h / 2, components, is_mask, rgba);
+	resample(rgba, w / 2, h / 2, width, height, filtered_next);
+	for (U32 i = 0; i < mData.size(); i++)
+	{
+		U64 value = (U64)filtered[i] * (256 - blend) + (U64)filtered_next[i] * blend;
+		mData[i] = (U8)((value + (1 << 23)) >> 24);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// LLImageCompositor
+//-----------------------------------------------------------------------------
+LLImageCompositor::LLImageCompositor()
+{
+	mState.mBlendType = BT_ALPHA;
+	mState.mTextureBlendType = TB_MULT;
+	mState.mWriteColor = true;
+	mState.mWriteAlpha = true;
+	mState.mAlphaTest = true;
+	mState.mColor.setVec(1.f, 1.f, 1.f, 1.f);
+}
+
+LLImageCompositor::~LLImageCompositor()
+{
+}
+
+void LLImageCompositor::setColorMask(bool write_color, bool write_alpha)
+{
+	mState.mWriteColor = write_color;
+	mState.mWriteAlpha = write_alpha;
+}
+
+void LLImageCompositor::setColor(const LLColor4& color)
+{
+	setColor(color.mV[VRED], color.mV[VGREEN], color.mV[VBLUE], color.mV[VALPHA]);
+}
+
+void LLImageCompositor::setColor(F32 r, F32 g, F32 b, F32 a)
+{
+	// GL clamps the current color when it is used
+	mState.mColor.setVec(llclamp(r, 0.f, 1.f), llclamp(g, 0.f, 1.f), llclamp(b, 0.f, 1.f), llclamp(a, 0.f, 1.f));
+}
+
+void LLImageCompositor::addCommand(EOperation operation, LLImageRaw* image, BOOL is_mask)
+{
+	mCommands.push_back(Command());
+	Command& command = mCommands.back();
+	command.mOperation = operation;
+	command.mState = mState;
+	command.mImage = image;
+	command.mIsMask = is_mask;
+}
+
+void LLImageCompositor::drawRect()
+{
+	addCommand(OP_RECT);
+}
+
+void LLImageCompositor::drawImage(LLImageRaw* image, BOOL is_mask)
+{
+	if (image && image->getData() && image->getComponents() >= 1 && image->getComponents() <= 4)
+	{
+		addCommand(OP_IMAGE, image, is_mask);
+	}
+}
+
+void LLImageCompositor::multiplyMask()
+{
+	addCommand(OP_MASK);
+}
+
+void LLImageCompositor::execute(LLImageRaw* target, LLImageRaw* mask) const
+{
+	llassert_always(target && target->getComponents() == 4);
+	const S32 width = target->getWidth();
+	const S32 height = target->getHeight();
+	const S32 pixels = width * height;
+	U8* dst = target->getData();
+
+	// Sampled sources are shared between the draws of the same image and
+	// dropped after the last one.
+	typedef std::pair<const LLImageRaw*, BOOL> source_key_t;
+	typedef std::map<source_key_t, std::pair<S32, Source*> > source_map_t;
+	source_map_t sources;
+	for (std::vector<Command>::const_iterator iter = mCommands.begin(); iter != mCommands.end(); ++iter)
+	{
+		if (iter->mOperation == OP_IMAGE)
+		{
+			std::pair<S32, Source*>& entry = sources[source_key_t(iter->mImage.get(), iter->mIsMask)];
+			entry.first++;
+			entry.second = NULL;
+		}
+	}
+
+	for (std::vector<Command>::const_iterator iter = mCommands.begin(); iter != mCommands.end(); ++iter)
+	{
+		const Command& command = *iter;
+		if (command.mOperation == OP_MASK)
+		{
+			if (mask)
+			{
+				llassert_always(mask->getWidth() == width && mask->getHeight() == height && mask->getComponents() == 1);
+				U8* mask_data = mask->getData();
+				for (S32 i = 0; i < pixels; i++)
+				{
+					mask_data[i] = (U8)((mask_data[i] * (dst[i * 4 + 3] + 1)) >> 8);
+				}
+			}
+			continue;
+		}
+
+		const State& state = command.mState;
+		const F32* color = state.mColor.mV;
+		const bool write[4] = { state.mWriteColor, state.mWriteColor, state.mWriteColor, state.mWriteAlpha };
+		if ((!state.mWriteColor && !state.mWriteAlpha)
+			|| (command.mOperation == OP_RECT && state.mAlphaTest && !(color[3] > ALPHA_REF)))
+		{
+			continue;
+		}
+
+		source_map_t::iterator source_iter = sources.end();
+		const Source* source = NULL;
+		if (command.mOperation == OP_IMAGE)
+		{
+			source_iter = sources.find(source_key_t(command.mImage.get(), command.mIsMask));
+			if (!source_iter->second.second)
+			{
+				source_iter->second.second = new Source(command.mImage, command.mIsMask, width, height);
+			}
+			source = source_iter->second.second;
+		}
+
+		F32 fragment[4] = { color[0], color[1], color[2], color[3] };
+		for (S32 i = 0; i < pixels; i++)
+		{
+			if (source)
+			{
+				const U8* texel = &source->mData[i * 4];
+				if (state.mTextureBlendType == TB_MULT)
+				{
+					for (S32 k = 0; k < 4; k++)
+					{
+						fragment[k] = texel[k] * color[k] * (1.f / 255.f);
+					}
+				}
+				else
+				{
+					for (S32 k = 0; k < 3; k++)
+					{
+						fragment[k] = source->mHasColor ? texel[k] * (1.f / 255.f) : color[k];
+					}
+					fragment[3] = source->mHasAlpha ? texel[3] * (1.f / 255.f) : color[3];
+				}
+				if (state.mAlphaTest && !(fragment[3] > ALPHA_REF))
+				{
+					continue;
+				}
+			}
+
+			U8* pixel = dst + i * 4;
+			const F32 src_alpha = fragment[3];
+			const F32 dst_alpha = pixel[3] * (1.f / 255.f);
+			for (S32 k = 0; k < 4; k++)
+			{
+				if (!write[k])
+				{
+					continue;
+				}
+				const F32 dst_value = pixel[k] * (1.f / 255.f);
+				F32 value;
+				switch (state.mBlendType)
+				{
+				case BT_ALPHA:
+					value = fragment[k] * src_alpha + dst_value * (1.f - src_alpha);
+					break;
+				case BT_DEST_ALPHA:
+					value = fragment[k] * dst_alpha + dst_value * (1.f - dst_alpha);
+					break;
+				case BT_ADD:
+					value = fragment[k] + dst_value;
+					break;
+				case BT_MULT_ALPHA:
+					value = fragment[k] * dst_alpha;
+					break;
+				default:
+					value = fragment[k];
+					break;
+				}
+				pixel[k] = to_channel(value);
+			}
+		}
+
+		if (source && --source_iter->second.first == 0)
+		{
+			delete source_iter->second.second;
+			source_iter->second.second = NULL;
+		}
+	}
+
+	for (source_map_t::iterator iter = sources.begin(); iter != sources.end(); ++iter)
+	{
+		delete iter->second.second;
+	}
+}
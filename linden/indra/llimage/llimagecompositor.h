@@ -0,0 +1,132 @@
+/**
+ * @file llimagecompositor.h
+ * @brief Software version of the GL compositing used for avatar bakes.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLIMAGECOMPOSITOR_H
+#define LL_LLIMAGECOMPOSITOR_H
+
+#include "llimage.h"
+#include "llmemory.h"
+#include "v4color.h"
+
+#include <vector>
+
+// Records the drawing LLTexLayerSet does to composite an avatar bake and
+// replays it on an LLImageRaw the way the fixed function GL pipeline does:
+// every draw covers the whole target, textures are stretched over it with
+// clamping (trilinear between box filtered mip levels), GL_MODULATE or
+// GL_REPLACE combine them with the current color, the alpha test is
+// GL_GREATER 0.01 and the blend functions are those below, on an 8 bit RGBA
+// target.
+// Fragments are shaded and blended in floating point and rounded once when
+// they are written, as GL hardware does.
+//
+// Recording only keeps references to the source images, so the commands can
+// be built on the main thread and run on another one, provided nothing
+// changes those images in the meantime.
+class LLImageCompositor
+{
+public:
+	enum EBlendType
+	{
+		BT_ALPHA,		// GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+		BT_DEST_ALPHA,	// GL_DST_ALPHA, GL_ONE_MINUS_DST_ALPHA
+		BT_ADD,			// GL_ONE, GL_ONE
+		BT_MULT_ALPHA,	// GL_DST_ALPHA, GL_ZERO
+		BT_REPLACE		// GL_ONE, GL_ZERO
+	};
+
+	enum ETextureBlendType
+	{
+		TB_MULT,		// GL_MODULATE
+		TB_REPLACE		// GL_REPLACE
+	};
+
+	LLImageCompositor();
+	~LLImageCompositor();
+
+	// Drawing state. It starts out the way LLGLSUIDefault leaves GL: BT_ALPHA,
+	// TB_MULT, alpha test on, all channels written and an opaque white color.
+	void setBlendType(EBlendType type)				{ mState.mBlendType = type; }
+	void setTextureBlendType(ETextureBlendType type){ mState.mTextureBlendType = type; }
+	void setColorMask(bool write_color, bool write_alpha);
+	void setAlphaTest(bool enable)					{ mState.mAlphaTest = enable; }
+	void setColor(const LLColor4& color);
+	void setColor(F32 r, F32 g, F32 b, F32 a);
+
+	// Covers the target with the current color.
+	void drawRect();
+	// Covers the target with image. Single component images are luminance,
+	// or alpha when is_mask is set, as LLImageGL uploads them.
+	void drawImage(LLImageRaw* image, BOOL is_mask = FALSE);
+	// Multiplies the target's alpha into the mask given to execute(), as
+	// LLTexLayerSet::gatherAlphaMasks() combines the alpha of its layers.
+	void multiplyMask();
+
+	S32 getCommandCount() const						{ return (S32)mCommands.size(); }
+	void clear()									{ mCommands.clear(); }
+
+	// Runs the recorded commands on target, which needs 4 components. mask,
+	// when given, is a single component image the size of target that
+	// multiplyMask() writes to; it is not initialized here.
+	void execute(LLImageRaw* target, LLImageRaw* mask = NULL) const;
+
+private:
+	enum EOperation
+	{
+		OP_RECT,
+		OP_IMAGE,
+		OP_MASK
+	};
+
+	struct State
+	{
+		EBlendType			mBlendType;
+		ETextureBlendType	mTextureBlendType;
+		bool				mWriteColor;
+		bool				mWriteAlpha;
+		bool				mAlphaTest;
+		LLColor4			mColor;
+	};
+
+	struct Command
+	{
+		EOperation				mOperation;
+		State					mState;
+		LLPointer<LLImageRaw>	mImage;
+		BOOL					mIsMask;
+	};
+
+	class Source;
+
+	void addCommand(EOperation operation, LLImageRaw* image = NULL, BOOL is_mask = FALSE);
+
+private:
+	State					mState;
+	std::vector<Command>	mCommands;
+};
+
+#endif // LL_LLIMAGECOMPOSITOR_H
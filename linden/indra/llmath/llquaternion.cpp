@@ -42,6 +42,7 @@
 #include "m4math.h"
 #include "m3math.h"
 #include "llquantize.h"
+#include "llv4math.h"		// for LL_VECTORIZE
 
 // WARNING: Don't use this for global const definitions!  using this
 // at the top of a *.cpp file might not give you what you think.
@@ -719,6 +720,81 @@ LLQuaternion nlerp(F32 t, const LLQuaternion &q)
 	}
 }
 
+void nlerp_batch(U32 count, const F32* t, const LLQuaternion* p, const LLQuaternion* q, LLQuaternion* out)
+{
+	U32 i = 0;
+#if LL_VECTORIZE
+	// Four pairs at a time, one component per register. The operations are
+	// done in the same order as lerp() and LLQuaternion::normalize() so the
+	// results are bit for bit the same.
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 threshold = _mm_set1_ps(FP_MAG_THRESHOLD);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 px = _mm_loadu_ps(p[i].mQ);
+		__m128 py = _mm_loadu_ps(p[i + 1].mQ);
+		__m128 pz = _mm_loadu_ps(p[i + 2].mQ);
+		__m128 pw = _mm_loadu_ps(p[i + 3].mQ);
+		_MM_TRANSPOSE4_PS(px, py, pz, pw);
+		__m128 qx = _mm_loadu_ps(q[i].mQ);
+		__m128 qy = _mm_loadu_ps(q[i + 1].mQ);
+		__m128 qz = _mm_loadu_ps(q[i + 2].mQ);
+		__m128 qw = _mm_loadu_ps(q[i + 3].mQ);
+		_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, qx), _mm_mul_ps(py, qy)),
+										 _mm_mul_ps(pz, qz)), _mm_mul_ps(pw, qw));
+		S32 opposite = _mm_movemask_ps(_mm_cmplt_ps(d, _mm_setzero_ps()));
+
+		__m128 tq = _mm_loadu_ps(t + i);
+		__m128 tp = _mm_sub_ps(one, tq);
+		__m128 rx = _mm_add_ps(_mm_mul_ps(tq, qx), _mm_mul_ps(tp, px));
+		__m128 ry = _mm_add_ps(_mm_mul_ps(tq, qy), _mm_mul_ps(tp, py));
+		__m128 rz = _mm_add_ps(_mm_mul_ps(tq, qz), _mm_mul_ps(tp, pz));
+		__m128 rw = _mm_add_ps(_mm_mul_ps(tq, qw), _mm_mul_ps(tp, pw));
+
+		__m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)),
+													   _mm_mul_ps(rz, rz)), _mm_mul_ps(rw, rw)));
+		__m128 valid = _mm_cmpgt_ps(mag, threshold);
+		__m128 oomag = _mm_div_ps(one, mag);
+		// degenerate lanes become the identity
+		rx = _mm_and_ps(valid, _mm_mul_ps(rx, oomag));
+		ry = _mm_and_ps(valid, _mm_mul_ps(ry, oomag));
+		rz = _mm_and_ps(valid, _mm_mul_ps(rz, oomag));
+		rw = _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(rw, oomag)), _mm_andnot_ps(valid, one));
+
+		// pairs in opposite hemispheres take the slerp, as nlerp() does;
+		// worked out before the stores in case out is p or q
+		LLQuaternion slerped[4];
+		for (S32 lane = 0; lane < 4; lane++)
+		{
+			if (opposite & (1 << lane))
+			{
+				slerped[lane] = slerp(t[i + lane], p[i + lane], q[i + lane]);
+			}
+		}
+
+		_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+		_mm_storeu_ps(out[i].mQ, rx);
+		_mm_storeu_ps(out[i + 1].mQ, ry);
+		_mm_storeu_ps(out[i + 2].mQ, rz);
+		_mm_storeu_ps(out[i + 3].mQ, rw);
+
+		for (S32 lane = 0; opposite; lane++, opposite >>= 1)
+		{
+			if (opposite & 1)
+			{
+				out[i + lane] = slerped[lane];
+			}
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		out[i] = nlerp(t[i], p[i], q[i]);
+	}
+}
+
 // slerp from identity quaternion to another quaternion
 LLQuaternion slerp(F32 t, const LLQuaternion &q)
 {
@@ -0,0 +1,68 @@
+/**
+ * @file llskinning.cpp
+ * @brief Portable vertex skinning kernel.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "linden_common.h"
+#include "llmath.h"
+
+#include "llskinning.h"
+
+void ll_skin_vertices(const F32* joint_mats, const F32* weights,
+					  const F32* coords, const F32* normals, U32 count,
+					  U8* out_pos, U32 pos_stride,
+					  U8* out_normal, U32 normal_stride)
+{
+	// neighbouring vertices usually share a weight, so keep the last blend
+	F32 weight = F32_MAX;
+	F32 m[16];
+	for (U32 index = 0; index < count; ++index)
+	{
+		if (weight != weights[index])
+		{
+			weight = weights[index];
+			S32 joint = llfloor(weight);
+			F32 w = weight - joint;
+			const F32* a = joint_mats + joint * 16;
+			const F32* b = a + 16;
+			for (S32 i = 0; i < 16; i++)
+			{
+				m[i] = a[i] + w * (b[i] - a[i]);
+			}
+		}
+
+		const F32* v = coords + index * 3;
+		F32* o = (F32*)(out_pos + index * pos_stride);
+		o[0] = v[0] * m[0] + v[1] * m[4] + v[2] * m[8] + m[12];
+		o[1] = v[0] * m[1] + v[1] * m[5] + v[2] * m[9] + m[13];
+		o[2] = v[0] * m[2] + v[1] * m[6] + v[2] * m[10] + m[14];
+
+		const F32* n = normals + index * 3;
+		o = (F32*)(out_normal + index * normal_stride);
+		o[0] = n[0] * m[0] + n[1] * m[4] + n[2] * m[8];
+		o[1] = n[0] * m[1] + n[1] * m[5] + n[2] * m[9];
+		o[2] = n[0] * m[2] + n[1] * m[6] + n[2] * m[10];
+	}
+}
@@ -0,0 +1,71 @@
+/**
+ * @file llskinning.h
+ * @brief Software vertex skinning kernels for avatar meshes.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLSKINNING_H
+#define LL_LLSKINNING_H
+
+#include "stdtypes.h"
+
+// Skinning as done by LLViewerJointMesh when avatar vertex programs are off.
+//
+// Every vertex is bound to two neighbouring joints through its weight: the
+// integer part j picks the joint and the vertex follows
+// lerp(joint_mats[j], joint_mats[j + 1], weight - j). Joint matrices are
+// LLMatrix4 laid out as 16 floats (row vectors, translation in the last row)
+// with the skin pivot already folded into the translation. Normals use the
+// upper 3x3 only and are not renormalized, matching the other paths.
+//
+// Inputs are tightly packed (3 floats per coord and normal). Outputs are
+// vertex buffer striders: out_pos and out_normal point at the first vertex
+// and successive vertices are the given number of bytes apart.
+//
+// These take raw pointers on purpose: llskinning_avx2.cpp is built with
+// AVX2 code generation and must not instantiate any inline LLMatrix4 or
+// LLVector3 code that could be picked by the linker for generic callers.
+
+typedef void (*LLSkinVerticesFunc)(const F32* joint_mats, const F32* weights,
+								   const F32* coords, const F32* normals, U32 count,
+								   U8* out_pos, U32 pos_stride,
+								   U8* out_normal, U32 normal_stride);
+
+// Portable reference version.
+void ll_skin_vertices(const F32* joint_mats, const F32* weights,
+					  const F32* coords, const F32* normals, U32 count,
+					  U8* out_pos, U32 pos_stride,
+					  U8* out_normal, U32 normal_stride);
+
+// Eight vertices per iteration with AVX2 gathers and FMA blending. Only call
+// it when LLCPUInfo::hasAVX2() and ll_skin_avx2_built() are both true; when
+// the compiler could not build the wide path it forwards to ll_skin_vertices().
+void ll_skin_vertices_avx2(const F32* joint_mats, const F32* weights,
+						   const F32* coords, const F32* normals, U32 count,
+						   U8* out_pos, U32 pos_stride,
+						   U8* out_normal, U32 normal_stride);
+
+bool ll_skin_avx2_built();
+
+#endif // LL_LLSKINNING_H
@@ -0,0 +1,181 @@
+/**
+ * @file llskinning_avx2.cpp
+ * @brief AVX2/FMA vertex skinning kernel, eight vertices at a time.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+// Built with AVX2 and FMA code generation (see CMakeLists.txt), so this file
+// deliberately includes nothing but the raw pointer interface: any inline
+// function instantiated here would be compiled with AVX2 instructions and
+// could end up shared with callers on older CPUs.
+
+#include "llskinning.h"
+
+#if (defined(__AVX2__) && defined(__FMA__)) || (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define LL_SKIN_AVX2 1
+#else
+#define LL_SKIN_AVX2 0
+#endif
+
+#if LL_SKIN_AVX2
+
+#include <immintrin.h>
+
+bool ll_skin_avx2_built()
+{
+	return true;
+}
+
+// Splits eight packed xyz triples into x, y and z vectors with in-lane
+// shuffles, which is cheaper than gathering them.
+static inline void load_vec3x8(const F32* p, __m256& x, __m256& y, __m256& z)
+{
+	__m256 m03 = _mm256_castps128_ps256(_mm_loadu_ps(p));
+	__m256 m14 = _mm256_castps128_ps256(_mm_loadu_ps(p + 4));
+	__m256 m25 = _mm256_castps128_ps256(_mm_loadu_ps(p + 8));
+	m03 = _mm256_insertf128_ps(m03, _mm_loadu_ps(p + 12), 1);
+	m14 = _mm256_insertf128_ps(m14, _mm_loadu_ps(p + 16), 1);
+	m25 = _mm256_insertf128_ps(m25, _mm_loadu_ps(p + 20), 1);
+
+	__m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+	__m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+	x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+	z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+void ll_skin_vertices_avx2(const F32* joint_mats, const F32* weights,
+						   const F32* coords, const F32* normals, U32 count,
+						   U8* out_pos, U32 pos_stride,
+						   U8* out_normal, U32 normal_stride)
+{
+	// blended matrix elements per vertex, rows 0-3 by columns 0-2; the
+	// fourth column is never used
+	__m256 m[12];
+	// Most runs of eight vertices sit on a single weight, as whole meshes
+	// often hang off one joint; those share one blend like the scalar path.
+	bool uniform_valid = false;
+	F32 uniform_weight = 0.f;
+
+	U32 index = 0;
+	for (; index + 8 <= count; index += 8)
+	{
+		__m256 weight = _mm256_loadu_ps(weights + index);
+		__m256 joint = _mm256_floor_ps(weight);
+		__m256 frac = _mm256_sub_ps(weight, joint);
+
+		__m256 first = _mm256_set1_ps(weights[index]);
+		if (_mm256_movemask_ps(_mm256_cmp_ps(weight, first, _CMP_EQ_OQ)) == 0xFF)
+		{
+			if (!uniform_valid || uniform_weight != weights[index])
+			{
+				uniform_valid = true;
+				uniform_weight = weights[index];
+				F32 w = _mm256_cvtss_f32(frac);
+				const F32* a = joint_mats + (S32)_mm256_cvtss_f32(joint) * 16;
+				const F32* b = a + 16;
+				for (S32 row = 0; row < 4; row++)
+				{
+					for (S32 col = 0; col < 3; col++)
+					{
+						S32 e = row * 4 + col;
+						m[row * 3 + col] = _mm256_set1_ps(a[e] + w * (b[e] - a[e]));
+					}
+				}
+			}
+		}
+		else
+		{
+			uniform_valid = false;
+			__m256i mat_offsets = _mm256_slli_epi32(_mm256_cvttps_epi32(joint), 4);
+			for (S32 row = 0; row < 4; row++)
+			{
+				for (S32 col = 0; col < 3; col++)
+				{
+					const F32* element = joint_mats + row * 4 + col;
+					__m256 a = _mm256_i32gather_ps(element, mat_offsets, 4);
+					__m256 b = _mm256_i32gather_ps(element + 16, mat_offsets, 4);
+					m[row * 3 + col] = _mm256_fmadd_ps(frac, _mm256_sub_ps(b, a), a);
+				}
+			}
+		}
+
+		__m256 x, y, z, nx, ny, nz;
+		load_vec3x8(coords + index * 3, x, y, z);
+		load_vec3x8(normals + index * 3, nx, ny, nz);
+
+		F32 out[6][8];
+		for (S32 col = 0; col < 3; col++)
+		{
+			__m256 p = _mm256_fmadd_ps(z, m[6 + col], m[9 + col]);
+			p = _mm256_fmadd_ps(y, m[3 + col], p);
+			p = _mm256_fmadd_ps(x, m[col], p);
+			_mm256_storeu_ps(out[col], p);
+
+			__m256 q = _mm256_mul_ps(nz, m[6 + col]);
+			q = _mm256_fmadd_ps(ny, m[3 + col], q);
+			q = _mm256_fmadd_ps(nx, m[col], q);
+			_mm256_storeu_ps(out[3 + col], q);
+		}
+
+		// vertex buffers are interleaved, so scatter back by stride
+		for (S32 k = 0; k < 8; k++)
+		{
+			F32* o = (F32*)(out_pos + (index + k) * pos_stride);
+			o[0] = out[0][k];
+			o[1] = out[1][k];
+			o[2] = out[2][k];
+			o = (F32*)(out_normal + (index + k) * normal_stride);
+			o[0] = out[3][k];
+			o[1] = out[4][k];
+			o[2] = out[5][k];
+		}
+	}
+
+	if (index < count)
+	{
+		ll_skin_vertices(joint_mats, weights + index, coords + index * 3, normals + index * 3,
+						 count - index,
+						 out_pos + index * pos_stride, pos_stride,
+						 out_normal + index * normal_stride, normal_stride);
+	}
+}
+
+#else // LL_SKIN_AVX2
+
+bool ll_skin_avx2_built()
+{
+	return false;
+}
+
+void ll_skin_vertices_avx2(const F32* joint_mats, const F32* weights,
+						   const F32* coords, const F32* normals, U32 count,
+						   U8* out_pos, U32 pos_stride,
+						   U8* out_normal, U32 normal_stride)
+{
+	ll_skin_vertices(joint_mats, weights, coords, normals, count,
+					 out_pos, pos_stride, out_normal, normal_stride);
+}
+
+#endif // LL_SKIN_AVX2
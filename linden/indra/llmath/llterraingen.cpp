@@ -0,0 +1,549 @@
+/**
+ * @file llterraingen.cpp
+ * @brief Terrain patch texture and geometry jobs, and the thread that
+ * runs them.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "linden_common.h"
+
+#include <cmath>
+
+#include "llterraingen.h"
+
+#include "lltimer.h"
+#include "noise.h"
+
+static F32 bilinear(const F32 v00, const F32 v01, const F32 v10, const F32 v11, const F32 x_frac, const F32 y_frac)
+{
+	// Not sure if this is the right math...
+	// Take weighted average of all four points (bilinear interpolation)
+	F32 result;
+
+	const F32 inv_x_frac = 1.f - x_frac;
+	const F32 inv_y_frac = 1.f - y_frac;
+	result = inv_x_frac*inv_y_frac*v00
+			+ x_frac*inv_y_frac*v10
+			+ inv_x_frac*y_frac*v01
+			+ x_frac*y_frac*v11;
+
+	return result;
+}
+
+//-----------------------------------------------------------------------------
+// LLTerrainTextureJob
+//-----------------------------------------------------------------------------
+LLTerrainTextureJob::LLTerrainTextureJob()
+:	mGenerateHeights(FALSE),
+	mGenerateTexels(FALSE),
+	mRunTime(0.f),
+	mCompX(0),
+	mCompY(0),
+	mCompWidth(0),
+	mCompHeight(0),
+	mLayerWidth(0),
+	mLayerScale(1.f),
+	mTexScaleX(1.f),
+	mTexScaleY(1.f),
+	mSurfaceTexWidth(0),
+	mSurfaceTexHeight(0),
+	mTexX(0),
+	mTexY(0),
+	mTexWidth(0),
+	mTexHeight(0)
+{
+	for (S32 i = 0; i < CORNER_COUNT; i++)
+	{
+		mStartHeight[i] = 0.f;
+		mHeightRange[i] = 1.f;
+		mDetailData[i] = NULL;
+		mDetailDataSize[i] = 0;
+	}
+}
+
+void LLTerrainTextureJob::setComposition(const F32* layer, S32 layer_width, F32 layer_scale, F32 x, F32 y, F32 patch_size)
+{
+	mLayerWidth = layer_width;
+	mLayerScale = layer_scale;
+
+	// The texels are blended from the same samples
+	const F32 scale_inv = 1.f/layer_scale;
+	mCompX = llround( x * scale_inv );
+	mCompY = llround( y * scale_inv );
+	mCompWidth = llmin(llround( (x + patch_size) * scale_inv ), mLayerWidth) - mCompX;
+	mCompHeight = llmin(llround( (y + patch_size) * scale_inv ), mLayerWidth) - mCompY;
+
+	mComposition.resize(mCompWidth * mCompHeight);
+	for (S32 j = 0; j < mCompHeight; j++)
+	{
+		memcpy(&mComposition[j*mCompWidth], layer + (mCompY + j)*mLayerWidth + mCompX, mCompWidth * sizeof(F32));
+	}
+}
+
+void LLTerrainTextureJob::setHeights(const F32* heights, const F32 start_height[CORNER_COUNT], const F32 height_range[CORNER_COUNT],
+									 const LLVector3d& region_origin_global)
+{
+	mGenerateHeights = TRUE;
+	mHeights.assign(heights, heights + mCompWidth * mCompHeight);
+	for (S32 i = 0; i < CORNER_COUNT; i++)
+	{
+		mStartHeight[i] = start_height[i];
+		mHeightRange[i] = height_range[i];
+	}
+	mRegionOriginGlobal = region_origin_global;
+}
+
+void LLTerrainTextureJob::setTexels(const U8* const detail_data[CORNER_COUNT], const S32 detail_data_size[CORNER_COUNT],
+									F32 tex_scale_x, F32 tex_scale_y, S32 surface_tex_width, S32 surface_tex_height,
+									F32 x, F32 y, F32 tex_patch_size)
+{
+	mGenerateTexels = TRUE;
+	for (S32 i = 0; i < CORNER_COUNT; i++)
+	{
+		mDetailData[i] = detail_data[i];
+		mDetailDataSize[i] = detail_data_size[i];
+	}
+	mTexScaleX = tex_scale_x;
+	mTexScaleY = tex_scale_y;
+
+	// Generate and clamp x/y bounding box.
+	const F32 scale_inv = 1.f/mLayerScale;
+	S32 x_begin = (S32)(x * scale_inv);
+	S32 y_begin = (S32)(y * scale_inv);
+	S32 x_end = llround( (x + tex_patch_size) * scale_inv );
+	S32 y_end = llround( (y + tex_patch_size) * scale_inv );
+	if (x_end > mLayerWidth)
+	{
+		llwarns << "x end > width" << llendl;
+		x_end = mLayerWidth;
+	}
+	if (y_end > mLayerWidth)
+	{
+		llwarns << "y end > width" << llendl;
+		y_end = mLayerWidth;
+	}
+
+	mSurfaceTexWidth = surface_tex_width;
+	mSurfaceTexHeight = surface_tex_height;
+	const F32 tex_x_scalef = (F32)mSurfaceTexWidth / (F32)mLayerWidth;
+	const F32 tex_y_scalef = (F32)mSurfaceTexHeight / (F32)mLayerWidth;
+	mTexX = (S32)((F32)x_begin * tex_x_scalef);
+	mTexY = (S32)((F32)y_begin * tex_y_scalef);
+	mTexWidth = (S32)((F32)x_end * tex_x_scalef) - mTexX;
+	mTexHeight = (S32)((F32)y_end * tex_y_scalef) - mTexY;
+}
+
+void LLTerrainTextureJob::run()
+{
+	LLTimer timer;
+	if (mGenerateHeights)
+	{
+		generateHeights();
+	}
+	if (mGenerateTexels)
+	{
+		generateTexels();
+	}
+	mRunTime = timer.getElapsedTimeF32();
+}
+
+// Viewer side hack to generate composition values
+void LLTerrainTextureJob::generateHeights()
+{
+	// For perlin noise generation...
+	const F32 slope_squared = 1.5f*1.5f;
+	const F32 xyScale = 4.9215f; //0.93284f;
+	const F32 zScale = 4; //0.92165f;
+	const F32 z_offset = 0.f;
+	const F32 noise_magnitude = 2.f;		//  Degree to which noise modulates composition layer (versus
+											//  simple height)
+
+	// Heights map into textures as 0-1 = first, 1-2 = second, etc.
+	// So we need to compress heights into this range.
+	const S32 NUM_TEXTURES = 4;
+
+	const F32 xyScaleInv = (1.f / xyScale);
+	const F32 zScaleInv = (1.f / zScale);
+
+	const F32 inv_width = 1.f/mLayerWidth;
+
+	// OK, for now, just have the composition value equal the height at the point.
+	for (S32 j = 0; j < mCompHeight; j++)
+	{
+		for (S32 i = 0; i < mCompWidth; i++)
+		{
+			const S32 sample_x = mCompX + i;
+			const S32 sample_y = mCompY + j;
+
+			F32 vec[3];
+			F32 vec1[3];
+			F32 twiddle;
+
+			// Bilinearly interpolate the start height and height range of the textures
+			F32 start_height = bilinear(mStartHeight[SOUTHWEST],
+										mStartHeight[SOUTHEAST],
+										mStartHeight[NORTHWEST],
+										mStartHeight[NORTHEAST],
+										sample_x*inv_width, sample_y*inv_width); // These will be bilinearly interpolated
+			F32 height_range = bilinear(mHeightRange[SOUTHWEST],
+										mHeightRange[SOUTHEAST],
+										mHeightRange[NORTHWEST],
+										mHeightRange[NORTHEAST],
+										sample_x*inv_width, sample_y*inv_width); // These will be bilinearly interpolated
+
+			LLVector3 location(sample_x*mLayerScale, sample_y*mLayerScale, 0.f);
+
+			F32 height = mHeights[j*mCompWidth + i] + z_offset;
+
+			// Step 0: Measure the exact height at this texel
+			vec[0] = (F32)(mRegionOriginGlobal.mdV[VX]+location.mV[VX])*xyScaleInv;	//  Adjust to non-integer lattice
+			vec[1] = (F32)(mRegionOriginGlobal.mdV[VY]+location.mV[VY])*xyScaleInv;
+			vec[2] = height*zScaleInv;
+			//
+			//  Choose material value by adding to the exact height a random value
+			//
+			vec1[0] = vec[0]*(0.2222222222f);
+			vec1[1] = vec[1]*(0.2222222222f);
+			vec1[2] = vec[2]*(0.2222222222f);
+			twiddle = noise2(vec1)*6.5f;					//  Low freq component for large divisions
+
+			twiddle += turbulence2(vec, 2)*slope_squared;	//  High frequency component
+			twiddle *= noise_magnitude;
+
+			F32 scaled_noisy_height = (height + twiddle - start_height) * F32(NUM_TEXTURES) / height_range;
+
+			scaled_noisy_height = llmax(0.f, scaled_noisy_height);
+			scaled_noisy_height = llmin(3.f, scaled_noisy_height);
+			mComposition[j*mCompWidth + i] = scaled_noisy_height;
+		}
+	}
+}
+
+// Same as LLViewerLayer::getValueScaled(), from the copied samples
+F32 LLTerrainTextureJob::getComposition(F32 x, F32 y) const
+{
+	const F32 scale_inv = 1.f / mLayerScale;
+	F32 x_frac = x*scale_inv;
+	S32 x1 = llfloor(x_frac);
+	S32 x2 = x1 + 1;
+	x_frac -= x1;
+
+	F32 y_frac = y*scale_inv;
+	S32 y1 = llfloor(y_frac);
+	S32 y2 = y1 + 1;
+	y_frac -= y1;
+
+	x1 = llclamp(x1, 0, mLayerWidth - 1) - mCompX;
+	x2 = llclamp(x2, 0, mLayerWidth - 1) - mCompX;
+	y1 = llclamp(y1, 0, mLayerWidth - 1) - mCompY;
+	y2 = llclamp(y2, 0, mLayerWidth - 1) - mCompY;
+
+	// The blended texels never reach past the copied samples
+	x1 = llclamp(x1, 0, mCompWidth - 1);
+	x2 = llclamp(x2, 0, mCompWidth - 1);
+	y1 = llclamp(y1, 0, mCompHeight - 1);
+	y2 = llclamp(y2, 0, mCompHeight - 1);
+
+	const F32* row1 = &mComposition[y1 * mCompWidth];
+	const F32* row2 = &mComposition[y2 * mCompWidth];
+
+	F32 row1_interp = row1[x1] - x_frac * (row1[x1] - row1[x2]);
+	F32 row2_interp = row2[x1] - x_frac * (row2[x1] - row2[x2]);
+
+	return row1_interp - y_frac * (row1_interp - row2_interp);
+}
+
+// Generate texture from composition values.
+void LLTerrainTextureJob::generateTexels()
+{
+	const U8* const* st_data = mDetailData;
+	const S32* st_data_size = mDetailDataSize; // for debugging
+
+	const S32 tex_comps = 3;
+	const S32 st_comps = 3;
+	const S32 st_width = DETAIL_SIZE;
+	const S32 st_height = DETAIL_SIZE;
+
+	const S32 tex_x_begin = mTexX;
+	const S32 tex_y_begin = mTexY;
+	const S32 tex_x_end = mTexX + mTexWidth;
+	const S32 tex_y_end = mTexY + mTexHeight;
+
+	const F32 tex_x_ratiof = (F32)mLayerWidth*mLayerScale / (F32)mSurfaceTexWidth;
+	const F32 tex_y_ratiof = (F32)mLayerWidth*mLayerScale / (F32)mSurfaceTexHeight;
+
+	mTexels.resize(mTexWidth * mTexHeight * tex_comps);
+	U8* rawp = mTexels.empty() ? NULL : &mTexels[0];
+
+	F32 st_x_stride, st_y_stride;
+	st_x_stride = ((F32)st_width / (F32)mTexScaleX)*((F32)mLayerWidth / (F32)mSurfaceTexWidth);
+	st_y_stride = ((F32)st_height / (F32)mTexScaleY)*((F32)mLayerWidth / (F32)mSurfaceTexHeight);
+
+	llassert(st_x_stride > 0.f);
+	llassert(st_y_stride > 0.f);
+	////////////////////////////////
+	//
+	// Iterate through the target texture, striding through the
+	// subtextures and interpolating appropriately.
+	//
+	//
+
+	F32 sti, stj;
+	S32 st_offset;
+	sti = (tex_x_begin * st_x_stride) - st_width*(llfloor((tex_x_begin * st_x_stride)/st_width));
+	stj = (tex_y_begin * st_y_stride) - st_height*(llfloor((tex_y_begin * st_y_stride)/st_height));
+
+	for (S32 j = tex_y_begin; j < tex_y_end; j++)
+	{
+		U32 offset = (j - tex_y_begin) * mTexWidth * tex_comps;
+		sti = (tex_x_begin * st_x_stride) - st_width*((U32)(tex_x_begin * st_x_stride)/st_width);
+		for (S32 i = tex_x_begin; i < tex_x_end; i++)
+		{
+			S32 tex0, tex1;
+			F32 composition = getComposition(i*tex_x_ratiof, j*tex_y_ratiof);
+
+			tex0 = llfloor( composition );
+			tex0 = llclamp(tex0, 0, 3);
+			composition -= tex0;
+			tex1 = tex0 + 1;
+			tex1 = llclamp(tex1, 0, 3);
+
+			st_offset = (lltrunc(sti) + lltrunc(stj)*st_width) * st_comps;
+			for (S32 k = 0; k < tex_comps; k++)
+			{
+				// Linearly interpolate based on composition.
+				if (st_offset >= st_data_size[tex0] || st_offset >= st_data_size[tex1])
+				{
+					// SJB: This shouldn't be happening, but does... Rounding error?
+				}
+				else
+				{
+					F32 a = *(st_data[tex0] + st_offset);
+					F32 b = *(st_data[tex1] + st_offset);
+					rawp[ offset ] = (U8)lltrunc( a + composition * (b - a) );
+				}
+				offset++;
+				st_offset++;
+			}
+
+			sti += st_x_stride;
+			if (sti >= st_width)
+			{
+				sti -= st_width;
+			}
+		}
+
+		stj += st_y_stride;
+		if (stj >= st_height)
+		{
+			stj -= st_height;
+		}
+	}
+}
+
+void LLTerrainTextureJob::copyComposition(F32* layer) const
+{
+	if (!mGenerateHeights)
+	{
+		return;
+	}
+	for (S32 j = 0; j < mCompHeight; j++)
+	{
+		memcpy(layer + (mCompY + j)*mLayerWidth + mCompX, &mComposition[j*mCompWidth], mCompWidth * sizeof(F32));
+	}
+}
+
+void LLTerrainTextureJob::copyTexels(U8* image) const
+{
+	if (!mGenerateTexels)
+	{
+		return;
+	}
+	const S32 tex_comps = 3;
+	for (S32 j = 0; j < mTexHeight; j++)
+	{
+		memcpy(image + ((mTexY + j)*mSurfaceTexWidth + mTexX)*tex_comps,
+			   &mTexels[j*mTexWidth*tex_comps], mTexWidth*tex_comps);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// LLTerrainGeometryJob
+//-----------------------------------------------------------------------------
+LLTerrainGeometryJob::LLTerrainGeometryJob()
+:	mPoints(0),
+	mGridsPerEdge(0),
+	mMetersPerGrid(1.f)
+{
+}
+
+void LLTerrainGeometryJob::setPatch(S32 points, S32 grids_per_edge, F32 meters_per_grid,
+									const LLVector3& origin_region, const LLVector3d& origin_global)
+{
+	mPoints = points;
+	mGridsPerEdge = grids_per_edge;
+	mMetersPerGrid = meters_per_grid;
+	mOriginRegion = origin_region;
+	mOriginGlobal = origin_global;
+	mHeights.resize(mPoints * mPoints);
+	mComposition.resize(mPoints * mPoints);
+	mNormalHeights.resize((mPoints + 4) * (mPoints + 4));
+}
+
+void LLTerrainGeometryJob::run()
+{
+	const S32 width = mPoints + 4;
+	// Normals are taken across two grids each way
+	const F32 mpg = mMetersPerGrid * 2;
+	const F32 tex_scale = 1.f / mGridsPerEdge;
+
+	const F32 xyScale = 4.9215f*7.f; //0.93284f;
+	const F32 xyScaleInv = (1.f / xyScale)*(0.2222222222f);
+
+	mVertices.resize(mPoints * mPoints);
+	for (S32 y = 0; y < mPoints; y++)
+	{
+		for (S32 x = 0; x < mPoints; x++)
+		{
+			LLTerrainVertex& vertex = mVertices[y*mPoints + x];
+
+			vertex.mPosition.setVec(x * mMetersPerGrid, y * mMetersPerGrid, mHeights[y*mPoints + x]);
+
+			// (x - 2, y - 2) is at (x, y) in mNormalHeights
+			const F32* below = &mNormalHeights[y*width + x];
+			const F32* above = below + 4*width;
+			LLVector3 p00(-mpg,-mpg, below[0]);
+			LLVector3 p01(-mpg,+mpg, above[0]);
+			LLVector3 p10(+mpg,-mpg, below[4]);
+			LLVector3 p11(+mpg,+mpg, above[4]);
+
+			LLVector3 c1 = p11 - p00;
+			LLVector3 c2 = p01 - p10;
+
+			vertex.mNormal = c1;
+			vertex.mNormal %= c2;
+			vertex.mNormal.normVec();
+
+			vertex.mTexCoord0.setVec((mOriginRegion.mV[VX] + x * mMetersPerGrid) * tex_scale,
+									 (mOriginRegion.mV[VY] + y * mMetersPerGrid) * tex_scale);
+
+			F32 vec[3] = {
+							fmodf((F32)(mOriginGlobal.mdV[0] + x)*xyScaleInv, 256.f),
+							fmodf((F32)(mOriginGlobal.mdV[1] + y)*xyScaleInv, 256.f),
+							0.f
+						};
+			F32 rand_val = llclamp(noise2(vec)* 0.75f + 0.5f, 0.f, 1.f);
+			vertex.mTexCoord1.setVec(mComposition[y*mPoints + x], rand_val);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// LLTerrainJobThread
+//-----------------------------------------------------------------------------
+LLTerrainJobThread::LLTerrainJobThread(bool threaded)
+	: LLQueuedThread("terrainjobs", threaded)
+{
+	// noise2() sets its tables up on first use, which must not happen on
+	// the thread.
+	F32 vec[2] = { 0.f, 0.f };
+	noise2(vec);
+}
+
+LLQueuedThread::handle_t LLTerrainJobThread::addJob(LLTerrainJob* job)
+{
+	handle_t handle = generateHandle();
+	JobRequest* request = new JobRequest(handle, job);
+	addRequest(request);
+	return handle;
+}
+
+LLTerrainJob* LLTerrainJobThread::getFinishedJob(handle_t handle)
+{
+	JobRequest* request = (JobRequest*)getRequest(handle);
+	if (request && request->getStatus() == STATUS_COMPLETE)
+	{
+		return request->mJob;
+	}
+	return NULL;
+}
+
+void LLTerrainJobThread::completeJob(handle_t handle)
+{
+	// The thread deletes completed requests, so delete the job here
+	JobRequest* request = (JobRequest*)getRequest(handle);
+	if (request)
+	{
+		delete request->mJob;
+		request->mJob = NULL;
+		completeRequest(handle);
+	}
+}
+
+void LLTerrainJobThread::cancelJob(handle_t handle)
+{
+	abortRequest(handle, false);
+	mCanceledJobs.push_back(handle);
+}
+
+S32 LLTerrainJobThread::update(U32 max_time_ms)
+{
+	for (std::vector<handle_t>::iterator iter = mCanceledJobs.begin(); iter != mCanceledJobs.end(); )
+	{
+		status_t status = getRequestStatus(*iter);
+		if (status == STATUS_QUEUED || status == STATUS_INPROGRESS)
+		{
+			++iter;
+			continue;
+		}
+		completeJob(*iter);
+		iter = mCanceledJobs.erase(iter);
+	}
+
+	return LLQueuedThread::update(max_time_ms);
+}
+
+//-----------------------------------------------------------------------------
+// LLTerrainJobThread::JobRequest
+//-----------------------------------------------------------------------------
+LLTerrainJobThread::JobRequest::JobRequest(handle_t handle, LLTerrainJob* job)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL),
+	  mJob(job)
+{
+}
+
+LLTerrainJobThread::JobRequest::~JobRequest()
+{
+	// Normally already deleted by completeJob()
+	delete mJob;
+}
+
+bool LLTerrainJobThread::JobRequest::processRequest()
+{
+	if (mJob)
+	{
+		mJob->run();
+	}
+	return true;
+}
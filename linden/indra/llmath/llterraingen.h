@@ -0,0 +1,235 @@
+/**
+ * @file llterraingen.h
+ * @brief Terrain patch texture and geometry jobs, and the thread that
+ * runs them.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLTERRAINGEN_H
+#define LL_LLTERRAINGEN_H
+
+#include "llqueuedthread.h"
+#include "v2math.h"
+#include "v3dmath.h"
+#include "v3math.h"
+
+#include <vector>
+
+// One grid point of a patch, as LLTerrainGeometryJob builds it.  Positions
+// are relative to the patch origin, so they stay valid when the agent
+// changes regions.
+struct LLTerrainVertex
+{
+	LLVector3 mPosition;
+	LLVector3 mNormal;
+	LLVector2 mTexCoord0;
+	LLVector2 mTexCoord1;
+};
+
+// Work for one terrain patch.  The inputs are copied in on the main thread,
+// run() only touches the job's own buffers so it can be called from the
+// terrain job thread, and the results are copied out on the main thread
+// once the job is done.
+class LLTerrainJob
+{
+public:
+	virtual ~LLTerrainJob() {}
+
+	// ANY THREAD
+	virtual void run() = 0;
+};
+
+// Generates the composition values of a patch from its heights and blends
+// the four detail textures by them into its part of the surface texture.
+class LLTerrainTextureJob : public LLTerrainJob
+{
+public:
+	// Detail images are DETAIL_SIZE x DETAIL_SIZE RGB
+	static const S32 DETAIL_SIZE = 128;
+
+	enum ECorner
+	{
+		SOUTHWEST = 0,
+		SOUTHEAST = 1,
+		NORTHWEST = 2,
+		NORTHEAST = 3,
+		CORNER_COUNT = 4
+	};
+
+	LLTerrainTextureJob();
+
+	// Copies the composition samples of the patch at (x, y) meters into the
+	// region, with its north and east edges, from a region layer of
+	// layer_width x layer_width samples layer_scale meters apart.  Call
+	// this first.
+	void setComposition(const F32* layer, S32 layer_width, F32 layer_scale, F32 x, F32 y, F32 patch_size);
+
+	// Asks for the composition samples to be generated from the terrain
+	// height at each of them, getCompWidth() x getCompHeight() row by row.
+	void setHeights(const F32* heights, const F32 start_height[CORNER_COUNT], const F32 height_range[CORNER_COUNT],
+					const LLVector3d& region_origin_global);
+
+	// Asks for the patch's tex_patch_size meters square of a surface texture
+	// to be blended from the detail images, repeated tex_scale times across
+	// the region.  The image data must stay alive until the job is done.
+	void setTexels(const U8* const detail_data[CORNER_COUNT], const S32 detail_data_size[CORNER_COUNT],
+				   F32 tex_scale_x, F32 tex_scale_y, S32 surface_tex_width, S32 surface_tex_height,
+				   F32 x, F32 y, F32 tex_patch_size);
+
+	/*virtual*/ void run();
+
+	// Writes the generated composition samples back into the region layer
+	void copyComposition(F32* layer) const;
+	// Writes the texels into their rectangle of a surface sized RGB image
+	void copyTexels(U8* image) const;
+
+	BOOL generatedHeights() const	{ return mGenerateHeights; }
+	BOOL generatedTexels() const	{ return mGenerateTexels; }
+	S32 getCompX() const			{ return mCompX; }
+	S32 getCompY() const			{ return mCompY; }
+	S32 getCompWidth() const		{ return mCompWidth; }
+	S32 getCompHeight() const		{ return mCompHeight; }
+	S32 getTexX() const				{ return mTexX; }
+	S32 getTexY() const				{ return mTexY; }
+	S32 getTexWidth() const			{ return mTexWidth; }
+	S32 getTexHeight() const		{ return mTexHeight; }
+	S32 getTexelCount() const		{ return mTexWidth * mTexHeight; }
+	F32 getRunTime() const			{ return mRunTime; }
+
+private:
+	void generateHeights();
+	void generateTexels();
+	F32 getComposition(F32 x, F32 y) const;
+
+protected:
+	BOOL		mGenerateHeights;
+	BOOL		mGenerateTexels;
+	F32			mRunTime;
+
+	// Composition samples around the patch, mCompWidth x mCompHeight from
+	// (mCompX, mCompY).  Generated heights replace all of them.
+	S32			mCompX;
+	S32			mCompY;
+	S32			mCompWidth;
+	S32			mCompHeight;
+	std::vector<F32> mComposition;
+	std::vector<F32> mHeights;		// terrain height at each composition sample
+
+	S32			mLayerWidth;		// of the region composition, in samples
+	F32			mLayerScale;		// meters per sample
+	F32			mStartHeight[CORNER_COUNT];
+	F32			mHeightRange[CORNER_COUNT];
+	LLVector3d	mRegionOriginGlobal;
+
+	const U8*	mDetailData[CORNER_COUNT];
+	S32			mDetailDataSize[CORNER_COUNT];
+	F32			mTexScaleX;
+	F32			mTexScaleY;
+
+	// The patch's rectangle of the surface texture
+	S32			mSurfaceTexWidth;
+	S32			mSurfaceTexHeight;
+	S32			mTexX;
+	S32			mTexY;
+	S32			mTexWidth;
+	S32			mTexHeight;
+	std::vector<U8> mTexels;		// RGB, mTexWidth x mTexHeight
+};
+
+// Computes the normals and vertex attributes of every grid point of a
+// patch.
+class LLTerrainGeometryJob : public LLTerrainJob
+{
+public:
+	LLTerrainGeometryJob();
+
+	// points per patch edge, which is grids per patch edge + 1
+	void setPatch(S32 points, S32 grids_per_edge, F32 meters_per_grid,
+				  const LLVector3& origin_region, const LLVector3d& origin_global);
+	// 0 <= x, y < points
+	void setPoint(S32 x, S32 y, F32 height, F32 composition)
+	{
+		mHeights[y*mPoints + x] = height;
+		mComposition[y*mPoints + x] = composition;
+	}
+	// Normals are taken across two grids each way, so -2 <= x, y < points + 2
+	void setNormalHeight(S32 x, S32 y, F32 height)
+	{
+		mNormalHeights[(y + 2)*(mPoints + 4) + x + 2] = height;
+	}
+
+	/*virtual*/ void run();
+
+	// mPoints^2, row by row
+	std::vector<LLTerrainVertex> mVertices;
+
+protected:
+	S32			mPoints;			// per edge, grids per patch edge + 1
+	S32			mGridsPerEdge;
+	F32			mMetersPerGrid;
+	LLVector3	mOriginRegion;
+	LLVector3d	mOriginGlobal;
+	std::vector<F32> mHeights;		// mPoints^2
+	std::vector<F32> mNormalHeights; // (mPoints + 4)^2, two grids around the patch
+	std::vector<F32> mComposition;	// mPoints^2
+};
+
+// Runs terrain jobs in the background, in the order they were added.
+class LLTerrainJobThread : public LLQueuedThread
+{
+public:
+	class JobRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~JobRequest(); // use deleteRequest()
+
+	public:
+		JobRequest(handle_t handle, LLTerrainJob* job);
+
+		/*virtual*/ bool processRequest();
+
+		LLTerrainJob* mJob;
+	};
+
+public:
+	LLTerrainJobThread(bool threaded = true);
+
+	// MAIN THREAD
+	// Takes ownership of the job
+	handle_t addJob(LLTerrainJob* job);
+	// NULL while the job is queued or running
+	LLTerrainJob* getFinishedJob(handle_t handle);
+	// Deletes a finished job
+	void completeJob(handle_t handle);
+	// For jobs whose patch went away: the job is deleted when the thread
+	// gets to it.
+	void cancelJob(handle_t handle);
+
+	/*virtual*/ S32 update(U32 max_time_ms);
+
+private:
+	std::vector<handle_t>	mCanceledJobs;
+};
+
+#endif // LL_LLTERRAINGEN_H
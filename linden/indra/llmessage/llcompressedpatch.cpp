@@ -0,0 +1,62 @@
+/**
+ * @file llcompressedpatch.cpp
+ * @brief A layer patch kept compressed until it is needed.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "linden_common.h"
+
+#include "llcompressedpatch.h"
+
+#include "patch_code.h"
+
+LLCompressedPatch::LLCompressedPatch()
+{
+	mGroupHeader.stride = 0;
+	mGroupHeader.patch_size = 0;
+	mGroupHeader.layer_type = 0;
+	mPatchHeader.dc_offset = 0.f;
+	mPatchHeader.range = 0;
+	mPatchHeader.quant_wbits = 0;
+	mPatchHeader.patchids = 0;
+	memset(mCoefficients, 0, sizeof(mCoefficients));
+}
+
+void LLCompressedPatch::unpack(LLBitPack &bitpack, const LLGroupHeader &group_header)
+{
+	// Don't use the packed group_header stride because the strides used on
+	// simulator and viewer are not equal.
+	mGroupHeader = group_header;
+	mGroupHeader.stride = mGroupHeader.patch_size;
+
+	decode_patch_header(bitpack, &mPatchHeader, FALSE);
+	decode_patch(bitpack, mCoefficients);
+}
+
+void LLCompressedPatch::decompress(F32 *patch)
+{
+	init_patch_decompressor(mGroupHeader.patch_size);
+	set_group_of_patch_header(&mGroupHeader);
+	decompress_patch(patch, mCoefficients, &mPatchHeader);
+}
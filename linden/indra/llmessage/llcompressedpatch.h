@@ -0,0 +1,61 @@
+/**
+ * @file llcompressedpatch.h
+ * @brief A layer patch kept compressed until it is needed.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLCOMPRESSEDPATCH_H
+#define LL_LLCOMPRESSEDPATCH_H
+
+#include "patch_dct.h"
+
+class LLBitPack;
+
+// The header and quantized coefficients of one patch of a layer packet.
+// Layers that are only sampled now and then, like wind and clouds, keep
+// these and only run the inverse DCT when something reads the values, so
+// a packet that nothing samples before the next one arrives only costs the
+// bit unpacking.
+class LLCompressedPatch
+{
+public:
+	LLCompressedPatch();
+
+	// Reads the patch header and coefficients that follow in bitpack.
+	// group_header is what decode_patch_group_header() read for the packet.
+	void unpack(LLBitPack &bitpack, const LLGroupHeader &group_header);
+
+	// patch_size^2 values, row by row.  Sets the patch decoder up for this
+	// patch's size first, since other layers may have decoded in between.
+	void decompress(F32 *patch);
+
+	S32 getPatchSize() const	{ return mGroupHeader.patch_size; }
+
+private:
+	LLGroupHeader	mGroupHeader;
+	LLPatchHeader	mPatchHeader;
+	S32				mCoefficients[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+};
+
+#endif // LL_LLCOMPRESSEDPATCH_H
@@ -34,6 +34,7 @@
 
 #include "llmath.h"
 //#include "vmath.h"
+#include "llv4math.h"
 #include "v3math.h"
 #include "patch_dct.h"
 
@@ -59,6 +60,9 @@ void build_patch_dequantize_table(S32 size)
 
 S32	gCurrentDeSize = 0;
 
+// Inverse DCT basis: gPatchICosines[u*size + n] is the weight of frequency u
+// in sample n.  The DC row holds 1/sqrt(2) rather than cos(0), so both passes
+// of the inverse transform are plain matrix products.
 F32	gPatchICosines[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
 void setup_patch_icosines(S32 size)
@@ -66,7 +70,11 @@ void setup_patch_icosines(S32 size)
 	S32 n, u;
 	F32 oosob = F_PI*0.5f/size;
 
-	for (u = 0; u < size; u++)
+	for (n = 0; n < size; n++)
+	{
+		gPatchICosines[n] = OO_SQRT2;
+	}
+	for (u = 1; u < size; u++)
 	{
 		for (n = 0; n < size; n++)
 		{
@@ -152,444 +160,96 @@ void init_patch_decompressor(S32 size)
 	}
 }
 
-inline void idct_line(F32 *linein, F32 *lineout, S32 line)
+// One pass of the inverse transform, as a matrix product:
+//   out row n = sum over u < count of weight(n, u) * in row u
+// for the first 'width' entries of each row, where weight(n, u) is
+// weights[n*n_stride + u*u_stride].  Sixteen outputs are summed at a time
+// in registers.
+inline void idct_pass(F32 *out, const F32 *in, const F32 *weights, S32 n_stride, S32 u_stride,
+					  S32 count, S32 width, S32 size)
 {
-	S32 n;
-	F32 total;
-	F32 *pcp = gPatchICosines;
-
-#ifdef _PATCH_SIZE_16_AND_32_ONLY
-	F32 oosob = 2.f/16.f;
-	S32	line_size = line*NORMAL_PATCH_SIZE;
-	F32 *tlinein, *tpcp;
-
-
-	for (n = 0; n < NORMAL_PATCH_SIZE; n++)
-	{
-		tpcp = pcp + n;
-		tlinein = linein + line_size;
-	
-		total = OO_SQRT2*(*(tlinein++));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein)*(*(tpcp += NORMAL_PATCH_SIZE));
-
-		*(lineout + line_size + n) = total*oosob;
-	}
-#else
-	F32 oosob = 2.f/size;
-	S32	size = gGOPP->patch_size;
-	S32	line_size = line*size;
-	S32 u;
+	S32 n, u, x;
 	for (n = 0; n < size; n++)
 	{
-		total = OO_SQRT2*linein[line_size];
-		for (u = 1; u < size; u++)
+		F32 *lineout = out + n*size;
+		const F32 *w = weights + n*n_stride;
+		x = 0;
+#if LL_VECTORIZE
+		for ( ; x + 16 <= width; x += 16)
 		{
-			total += linein[line_size + u]*pcp[u*size+n];
+			__m128 acc0 = _mm_setzero_ps();
+			__m128 acc1 = _mm_setzero_ps();
+			__m128 acc2 = _mm_setzero_ps();
+			__m128 acc3 = _mm_setzero_ps();
+			const F32 *linein = in + x;
+			for (u = 0; u < count; u++, linein += size)
+			{
+				__m128 scale = _mm_set1_ps(w[u*u_stride]);
+				acc0 = _mm_add_ps(acc0, _mm_mul_ps(scale, _mm_loadu_ps(linein)));
+				acc1 = _mm_add_ps(acc1, _mm_mul_ps(scale, _mm_loadu_ps(linein + 4)));
+				acc2 = _mm_add_ps(acc2, _mm_mul_ps(scale, _mm_loadu_ps(linein + 8)));
+				acc3 = _mm_add_ps(acc3, _mm_mul_ps(scale, _mm_loadu_ps(linein + 12)));
+			}
+			_mm_storeu_ps(lineout + x, acc0);
+			_mm_storeu_ps(lineout + x + 4, acc1);
+			_mm_storeu_ps(lineout + x + 8, acc2);
+			_mm_storeu_ps(lineout + x + 12, acc3);
 		}
-		lineout[line_size + n] = total*oosob;
-	}
 #endif
-}
-
-inline void idct_line_large_slow(F32 *linein, F32 *lineout, S32 line)
-{
-	S32 n;
-	F32 total;
-	F32 *pcp = gPatchICosines;
-
-	F32 oosob = 2.f/32.f;
-	S32	line_size = line*LARGE_PATCH_SIZE;
-	F32 *tlinein, *tpcp;
-
-
-	for (n = 0; n < LARGE_PATCH_SIZE; n++)
-	{
-		tpcp = pcp + n;
-		tlinein = linein + line_size;
-	
-		total = OO_SQRT2*(*(tlinein++));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		*(lineout + line_size + n) = total*oosob;
-	}
-}
-
-// Nota Bene: assumes that coefficients beyond 128 are 0!
-
-void idct_line_large(F32 *linein, F32 *lineout, S32 line)
-{
-	S32 n;
-	F32 total;
-	F32 *pcp = gPatchICosines;
-
-	F32 oosob = 2.f/32.f;
-	S32	line_size = line*LARGE_PATCH_SIZE;
-	F32 *tlinein, *tpcp;
-	F32 *baselinein = linein + line_size;
-	F32 *baselineout = lineout + line_size;
-
-
-	for (n = 0; n < LARGE_PATCH_SIZE; n++)
-	{
-		tpcp = pcp++;
-		tlinein = baselinein;
-	
-		total = OO_SQRT2*(*(tlinein++));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein++)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein)*(*(tpcp));
-
-		*baselineout++ = total*oosob;
-	}
-}
-
-inline void idct_column(F32 *linein, F32 *lineout, S32 column)
-{
-	S32 n;
-	F32 total;
-	F32 *pcp = gPatchICosines;
-
-#ifdef _PATCH_SIZE_16_AND_32_ONLY
-	F32 *tlinein, *tpcp;
-
-	for (n = 0; n < NORMAL_PATCH_SIZE; n++)
-	{
-		tpcp = pcp + n;
-		tlinein = linein + column;
-
-		total = OO_SQRT2*(*tlinein);
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-		total += *(tlinein += NORMAL_PATCH_SIZE)*(*(tpcp += NORMAL_PATCH_SIZE));
-
-		*(lineout + (n<<4) + column) = total;
-	}
-
-#else
-	S32	size = gGOPP->patch_size;
-	S32 u;
-	S32 u_size;
-
-	for (n = 0; n < size; n++)
-	{
-		total = OO_SQRT2*linein[column];
-		for (u = 1; u < size; u++)
+		for ( ; x < width; x++)
 		{
-			u_size = u*size;
-			total += linein[u_size + column]*pcp[u_size+n];
+			F32 total = 0.f;
+			for (u = 0; u < count; u++)
+			{
+				total += w[u*u_stride]*in[u*size + x];
+			}
+			lineout[x] = total;
 		}
-		lineout[size*n + column] = total;
 	}
-#endif
 }
 
-inline void idct_column_large_slow(F32 *linein, F32 *lineout, S32 column)
+// Separable inverse DCT of a size x size block, in place and without the
+// 2/size normalization, which the callers fold into their dequantization.
+// Only the first 'rows' rows and 'cols' columns of coefficients may be
+// non-zero: quantized terrain rarely keeps many high frequencies, so both
+// passes skip the zero part of the block.
+void idct_patch(F32 *block, S32 size, S32 rows, S32 cols)
 {
-	S32 n;
-	F32 total;
-	F32 *pcp = gPatchICosines;
-
-	F32 *tlinein, *tpcp;
-
-	for (n = 0; n < LARGE_PATCH_SIZE; n++)
-	{
-		tpcp = pcp + n;
-		tlinein = linein + column;
-
-		total = OO_SQRT2*(*tlinein);
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-		total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
-
-		*(lineout + (n<<5) + column) = total;
-	}
-}
-
-// Nota Bene: assumes that coefficients beyond 128 are 0!
-
-void idct_column_large(F32 *linein, F32 *lineout, S32 column)
-{
-	S32 n, m;
-	F32 total;
-	F32 *pcp = gPatchICosines;
-
-	F32 *tlinein, *tpcp;
-	F32 *baselinein = linein + column;
-	F32 *baselineout = lineout + column;
-
-	for (n = 0; n < LARGE_PATCH_SIZE; n++)
-	{
-		tpcp = pcp++;
-		tlinein = baselinein;
+	F32 temp[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
 
-		total = OO_SQRT2*(*tlinein);
-		for (m = 1; m < NORMAL_PATCH_SIZE; m++)
-			total += *(tlinein += LARGE_PATCH_SIZE)*(*(tpcp += LARGE_PATCH_SIZE));
+	// columns: temp(n, x) = sum over v of basis(v, n) * block(v, x).  Only
+	// the first 'cols' columns of temp can be non-zero, and only those are
+	// read by the second pass.
+	S32 width = llmin(size, (cols + 15) & ~15);
+	idct_pass(temp, block, gPatchICosines, 1, size, rows, width, size);
 
-		*(baselineout + (n<<5)) = total;
-	}
+	// lines: block(n, x) = sum over u of temp(n, u) * basis(u, x)
+	idct_pass(block, gPatchICosines, temp, size, 1, cols, size, size);
 }
 
-inline void idct_patch(F32 *block)
+// Dequantizes cpatch into block in raster order and returns the extent of
+// the non-zero coefficients.
+inline void dequantize_patch(F32 *block, S32 *cpatch, S32 size, S32 &rows, S32 &cols)
 {
-	F32 temp[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+	S32 i, j;
+	const F32 *dq = gPatchDequantizeTable;
+	const S32 *decopy_matrix = gDeCopyMatrix;
 
-#ifdef _PATCH_SIZE_16_AND_32_ONLY
-	idct_column(block, temp, 0);	
-	idct_column(block, temp, 1);	
-	idct_column(block, temp, 2);	
-	idct_column(block, temp, 3);	
-
-	idct_column(block, temp, 4);	
-	idct_column(block, temp, 5);	
-	idct_column(block, temp, 6);	
-	idct_column(block, temp, 7);	
-
-	idct_column(block, temp, 8);	
-	idct_column(block, temp, 9);	
-	idct_column(block, temp, 10);	
-	idct_column(block, temp, 11);	
-
-	idct_column(block, temp, 12);	
-	idct_column(block, temp, 13);	
-	idct_column(block, temp, 14);	
-	idct_column(block, temp, 15);	
-
-	idct_line(temp, block, 0);	
-	idct_line(temp, block, 1);	
-	idct_line(temp, block, 2);	
-	idct_line(temp, block, 3);	
-
-	idct_line(temp, block, 4);	
-	idct_line(temp, block, 5);	
-	idct_line(temp, block, 6);	
-	idct_line(temp, block, 7);	
-
-	idct_line(temp, block, 8);	
-	idct_line(temp, block, 9);	
-	idct_line(temp, block, 10);	
-	idct_line(temp, block, 11);	
-
-	idct_line(temp, block, 12);	
-	idct_line(temp, block, 13);	
-	idct_line(temp, block, 14);	
-	idct_line(temp, block, 15);	
-#else
-	S32 i;
-	S32	size = gGOPP->patch_size;
-	for (i = 0; i < size; i++)
-	{
-		idct_column(block, temp, i);	
-	}
-	for (i = 0; i < size; i++)
+	rows = 0;
+	cols = 0;
+	for (j = 0; j < size; j++)
 	{
-		idct_line(temp, block, i);	
+		for (i = 0; i < size; i++)
+		{
+			S32 value = cpatch[*(decopy_matrix++)];
+			*(block++) = value*(*dq++);
+			if (value)
+			{
+				rows = llmax(rows, j + 1);
+				cols = llmax(cols, i + 1);
+			}
+		}
 	}
-#endif
-}
-
-inline void idct_patch_large(F32 *block)
-{
-	F32 temp[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
-
-	idct_column_large_slow(block, temp, 0);	
-	idct_column_large_slow(block, temp, 1);	
-	idct_column_large_slow(block, temp, 2);	
-	idct_column_large_slow(block, temp, 3);	
-
-	idct_column_large_slow(block, temp, 4);	
-	idct_column_large_slow(block, temp, 5);	
-	idct_column_large_slow(block, temp, 6);	
-	idct_column_large_slow(block, temp, 7);	
-
-	idct_column_large_slow(block, temp, 8);	
-	idct_column_large_slow(block, temp, 9);	
-	idct_column_large_slow(block, temp, 10);	
-	idct_column_large_slow(block, temp, 11);	
-
-	idct_column_large_slow(block, temp, 12);	
-	idct_column_large_slow(block, temp, 13);	
-	idct_column_large_slow(block, temp, 14);	
-	idct_column_large_slow(block, temp, 15);	
-
-	idct_column_large_slow(block, temp, 16);	
-	idct_column_large_slow(block, temp, 17);	
-	idct_column_large_slow(block, temp, 18);	
-	idct_column_large_slow(block, temp, 19);	
-
-	idct_column_large_slow(block, temp, 20);	
-	idct_column_large_slow(block, temp, 21);	
-	idct_column_large_slow(block, temp, 22);	
-	idct_column_large_slow(block, temp, 23);	
-
-	idct_column_large_slow(block, temp, 24);	
-	idct_column_large_slow(block, temp, 25);	
-	idct_column_large_slow(block, temp, 26);	
-	idct_column_large_slow(block, temp, 27);	
-
-	idct_column_large_slow(block, temp, 28);	
-	idct_column_large_slow(block, temp, 29);	
-	idct_column_large_slow(block, temp, 30);	
-	idct_column_large_slow(block, temp, 31);	
-
-	idct_line_large_slow(temp, block, 0);	
-	idct_line_large_slow(temp, block, 1);	
-	idct_line_large_slow(temp, block, 2);	
-	idct_line_large_slow(temp, block, 3);	
-
-	idct_line_large_slow(temp, block, 4);	
-	idct_line_large_slow(temp, block, 5);	
-	idct_line_large_slow(temp, block, 6);	
-	idct_line_large_slow(temp, block, 7);	
-
-	idct_line_large_slow(temp, block, 8);	
-	idct_line_large_slow(temp, block, 9);	
-	idct_line_large_slow(temp, block, 10);	
-	idct_line_large_slow(temp, block, 11);	
-
-	idct_line_large_slow(temp, block, 12);	
-	idct_line_large_slow(temp, block, 13);	
-	idct_line_large_slow(temp, block, 14);	
-	idct_line_large_slow(temp, block, 15);	
-
-	idct_line_large_slow(temp, block, 16);	
-	idct_line_large_slow(temp, block, 17);	
-	idct_line_large_slow(temp, block, 18);	
-	idct_line_large_slow(temp, block, 19);	
-
-	idct_line_large_slow(temp, block, 20);	
-	idct_line_large_slow(temp, block, 21);	
-	idct_line_large_slow(temp, block, 22);	
-	idct_line_large_slow(temp, block, 23);	
-
-	idct_line_large_slow(temp, block, 24);	
-	idct_line_large_slow(temp, block, 25);	
-	idct_line_large_slow(temp, block, 26);	
-	idct_line_large_slow(temp, block, 27);	
-
-	idct_line_large_slow(temp, block, 28);	
-	idct_line_large_slow(temp, block, 29);	
-	idct_line_large_slow(temp, block, 30);	
-	idct_line_large_slow(temp, block, 31);	
 }
 
 S32	gDitherNoise = 128;
@@ -598,7 +258,7 @@ void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
 {
 	S32		i, j;
 
-	F32		block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock = block;
+	F32		block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock;
 	F32		*tpatch;
 
 	LLGroupHeader	*gopp = gGOPP;
@@ -610,25 +270,14 @@ void decompress_patch(F32 *patch, S32 *cpatch, LLPatchHeader *ph)
 	S32		stride = gopp->stride;
 
 	F32		ooq = 1.f/(F32)quantize;
-	F32     *dq = gPatchDequantizeTable;
-	S32		*decopy_matrix = gDeCopyMatrix;
 
 	F32		mult = ooq*range;
 	F32		addval = mult*(F32)(1<<(prequant - 1))+hmin;
 
-	for (i = 0; i < size*size; i++)
-	{
-		*(tblock++) = *(cpatch + *(decopy_matrix++))*(*dq++);
-	}
-
-	if (size == 16)
-	{
-		idct_patch(block);
-	}
-	else
-	{
-		idct_patch_large(block);
-	}
+	S32		rows, cols;
+	dequantize_patch(block, cpatch, size, rows, cols);
+	idct_patch(block, size, rows, cols);
+	mult *= 2.f/size;
 
 	for (j = 0; j < size; j++)
 	{
@@ -646,7 +295,7 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
 {
 	S32		i, j;
 
-	F32			block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock = block;
+	F32			block[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE], *tblock;
 	LLVector3	*tvec;
 
 	LLGroupHeader	*gopp = gGOPP;
@@ -658,24 +307,14 @@ void decompress_patchv(LLVector3 *v, S32 *cpatch, LLPatchHeader *ph)
 	S32		stride = gopp->stride;
 
 	F32		ooq = 1.f/(F32)quantize;
-	F32     *dq = gPatchDequantizeTable;
-	S32		*decopy_matrix = gDeCopyMatrix;
 
 	F32		mult = ooq*range;
 	F32		addval = mult*(F32)(1<<(prequant - 1))+hmin;
 
-//	BOOL	b_diag = FALSE;
-//	BOOL	b_right = TRUE;
-
-	for (i = 0; i < size*size; i++)
-	{
-		*(tblock++) = *(cpatch + *(decopy_matrix++))*(*dq++);
-	}
-
-	if (size == 16)
-		idct_patch(block);
-	else
-		idct_patch_large(block);
+	S32		rows, cols;
+	dequantize_patch(block, cpatch, size, rows, cols);
+	idct_patch(block, size, rows, cols);
+	mult *= 2.f/size;
 
 	for (j = 0; j < size; j++)
 	{
@@ -1336,83 +1336,86 @@ S32 LLPrimitive::unpackTEMessage(LLMessageSystem *mesgsys, char *block_name, con
 
 S32 LLPrimitive::unpackTEMessage(LLDataPacker &dp)
 {
-	// use a negative block_num to indicate a single-block read (a non-variable block)
-	S32 retval = 0;
-	const U32 MAX_TES = 32;
-
-	// Avoid construction of 32 UUIDs per call
-	static LLUUID image_ids[MAX_TES];
-
-	U8     image_data[MAX_TES*16];
-	U8	   colors[MAX_TES*4];
-	F32    scale_s[MAX_TES];
-	F32    scale_t[MAX_TES];
-	S16    offset_s[MAX_TES];
-	S16    offset_t[MAX_TES];
-	S16    image_rot[MAX_TES];
-	U8	   bump[MAX_TES];
-	U8	   media_flags[MAX_TES];
-    U8     glow[MAX_TES];
+	LLTEContents tec;
+	S32 retval = parseTEMessage(dp, tec);
+	if (TEM_INVALID == retval)
+	{
+		return retval;
+	}
+	return applyParsedTEMessage(tec);
+}
 
+// static
+S32 LLPrimitive::parseTEMessage(LLDataPacker &dp, LLTEContents &tec)
+{
 	const U32 MAX_TE_BUFFER = 4096;
 	U8 packed_buffer[MAX_TE_BUFFER];
 	U8 *cur_ptr = packed_buffer;
 
+	tec.mSize = 0;
 	S32 size;
-	U32 face_count = 0;
-
 	if (!dp.unpackBinaryData(packed_buffer, size, "TextureEntry"))
 	{
-		retval = TEM_INVALID;
 		llwarns << "Bad texture entry block!  Abort!" << llendl;
-		return retval;
+		return TEM_INVALID;
 	}
 
 	if (size == 0)
 	{
-		return retval;
+		return 0;
 	}
 
-	face_count = getNumTEs();
-	U32 i;
+	// The exception masks are per face, so unpacking for more faces than the
+	// primitive has gives the same values for the ones it does have.
+	const U8 face_count = (U8)LLTEContents::MAX_TES;
 
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)image_data, 16, face_count, MVT_LLUUID);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mImageData, 16, face_count, MVT_LLUUID);
 	cur_ptr++;
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)colors, 4, face_count, MVT_U8);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mColors, 4, face_count, MVT_U8);
 	cur_ptr++;
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)scale_s, 4, face_count, MVT_F32);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mScaleS, 4, face_count, MVT_F32);
 	cur_ptr++;
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)scale_t, 4, face_count, MVT_F32);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mScaleT, 4, face_count, MVT_F32);
 	cur_ptr++;
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)offset_s, 2, face_count, MVT_S16Array);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mOffsetS, 2, face_count, MVT_S16Array);
 	cur_ptr++;
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)offset_t, 2, face_count, MVT_S16Array);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mOffsetT, 2, face_count, MVT_S16Array);
 	cur_ptr++;
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)image_rot, 2, face_count, MVT_S16Array);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mImageRot, 2, face_count, MVT_S16Array);
 	cur_ptr++;
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)bump, 1, face_count, MVT_U8);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mBump, 1, face_count, MVT_U8);
 	cur_ptr++;
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)media_flags, 1, face_count, MVT_U8);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mMediaFlags, 1, face_count, MVT_U8);
 	cur_ptr++;
-	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)glow, 1, face_count, MVT_U8);
+	cur_ptr += unpackTEField(cur_ptr, packed_buffer+size, (U8 *)tec.mGlow, 1, face_count, MVT_U8);
+
+	tec.mSize = size;
+	return 0;
+}
 
-	for (i = 0; i < face_count; i++)
+S32 LLPrimitive::applyParsedTEMessage(const LLTEContents &tec)
+{
+	S32 retval = 0;
+	if (tec.mSize == 0)
 	{
-		memcpy(image_ids[i].mData,&image_data[i*16],16);	/* Flawfinder: ignore */ 	
+		return retval;
 	}
-	
+
+	U32 face_count = llmin((U32)getNumTEs(), (U32)LLTEContents::MAX_TES);
+	LLUUID image_id;
 	LLColor4 color;
 	LLColor4U coloru;
-	for (i = 0; i < face_count; i++)
+	for (U32 i = 0; i < face_count; i++)
 	{
-		retval |= setTETexture(i, image_ids[i]);
-		retval |= setTEScale(i, scale_s[i], scale_t[i]);
-		retval |= setTEOffset(i, (F32)offset_s[i] / (F32)0x7FFF, (F32) offset_t[i] / (F32) 0x7FFF);
-		retval |= setTERotation(i, ((F32)image_rot[i] / TEXTURE_ROTATION_PACK_FACTOR) * F_TWO_PI);
-		retval |= setTEBumpShinyFullbright(i, bump[i]);
-		retval |= setTEMediaTexGen(i, media_flags[i]);
-		retval |= setTEGlow(i, (F32)glow[i] / (F32)0xFF);
-		coloru = LLColor4U(colors + 4*i);
+		memcpy(image_id.mData, &tec.mImageData[i*16], 16);	/* Flawfinder: ignore */
+		retval |= setTETexture(i, image_id);
+		retval |= setTEScale(i, tec.mScaleS[i], tec.mScaleT[i]);
+		retval |= setTEOffset(i, (F32)tec.mOffsetS[i] / (F32)0x7FFF, (F32) tec.mOffsetT[i] / (F32) 0x7FFF);
+		retval |= setTERotation(i, ((F32)tec.mImageRot[i] / TEXTURE_ROTATION_PACK_FACTOR) * F_TWO_PI);
+		retval |= setTEBumpShinyFullbright(i, tec.mBump[i]);
+		retval |= setTEMediaTexGen(i, tec.mMediaFlags[i]);
+		retval |= setTEGlow(i, (F32)tec.mGlow[i] / (F32)0xFF);
+		coloru = LLColor4U(tec.mColors + 4*i);
 
 		// Note:  This is an optimization to send common colors (1.f, 1.f, 1.f, 1.f)
 		// as all zeros.  However, the subtraction and addition must be done in unsigned
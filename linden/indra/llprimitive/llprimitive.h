@@ -291,6 +291,27 @@ public:
 	
 };
 
+// The faces of a TextureEntry block, unpacked by LLPrimitive::parseTEMessage()
+// without a primitive to apply them to, so it can run off the main thread.
+// Every field is unpacked for MAX_TES faces; applyParsedTEMessage() uses as
+// many as the primitive has.
+struct LLTEContents
+{
+	static const U32 MAX_TES = 32;
+
+	U8		mImageData[MAX_TES*16];
+	U8		mColors[MAX_TES*4];
+	F32		mScaleS[MAX_TES];
+	F32		mScaleT[MAX_TES];
+	S16		mOffsetS[MAX_TES];
+	S16		mOffsetT[MAX_TES];
+	S16		mImageRot[MAX_TES];
+	U8		mBump[MAX_TES];
+	U8		mMediaFlags[MAX_TES];
+	U8		mGlow[MAX_TES];
+	S32		mSize;		// of the packed block, 0 if there was none
+};
+
 
 class LLPrimitive : public LLXform
 {
@@ -360,12 +381,16 @@ public:
 
 	void copyTEs(const LLPrimitive *primitive);
 	S32 packTEField(U8 *cur_ptr, U8 *data_ptr, U8 data_size, U8 last_face_index, EMsgVariableType type) const;
-	S32 unpackTEField(U8 *cur_ptr, U8 *buffer_end, U8 *data_ptr, U8 data_size, U8 face_count, EMsgVariableType type);
+	static S32 unpackTEField(U8 *cur_ptr, U8 *buffer_end, U8 *data_ptr, U8 data_size, U8 face_count, EMsgVariableType type);
 	BOOL packTEMessage(LLMessageSystem *mesgsys, int shield = 0) const;
 	BOOL packTEMessage(LLDataPacker &dp) const;
 	S32 unpackTEMessage(LLMessageSystem *mesgsys, char *block_name);
 	S32 unpackTEMessage(LLMessageSystem *mesgsys, char *block_name, const S32 block_num); // Variable num of blocks
 	BOOL unpackTEMessage(LLDataPacker &dp);
+	// unpackTEMessage(LLDataPacker&) in two steps. The parse only reads dp and
+	// returns TEM_INVALID for a bad block, the apply returns the TEM_CHANGE flags.
+	static S32 parseTEMessage(LLDataPacker &dp, LLTEContents &tec);
+	S32 applyParsedTEMessage(const LLTEContents &tec);
 	
 #ifdef CHECK_FOR_FINITE
 	inline void setPosition(const LLVector3& pos);
@@ -32,11 +32,13 @@
 
 #include "linden_common.h"
 
+#include <algorithm>
 #include <boost/tokenizer.hpp>
 
 #include "llfont.h"
 #include "llfontgl.h"
 #include "llfontbitmapcache.h"
+#include "llfontlayoutcache.h"
 #include "llfontregistry.h"
 #include "llgl.h"
 #include "llrender.h"
@@ -55,6 +57,7 @@ BOOL LLFontGL::sDisplayFont = TRUE ;
 std::string LLFontGL::sAppDir;
 
 LLColor4 LLFontGL::sShadowColor(0.f, 0.f, 0.f, 1.f);
+U32 LLFontGL::sRunGeneration = 0;
 LLFontRegistry* LLFontGL::sFontRegistry = NULL;
 
 LLCoordFont LLFontGL::sCurOrigin;
@@ -128,6 +131,7 @@ LLFontGL::LLFontGL(const LLFontGL &source)
 LLFontGL::~LLFontGL()
 {
 	clearEmbeddedChars();
+	LLFontLayoutCache::getInstance()->removeFont(this);
 }
 
 void LLFontGL::reset()
@@ -151,6 +155,7 @@ void LLFontGL::reset()
 		}
 	}
 	resetBitmapCache(); 
+	sRunGeneration++;
 }
 
 // static 
@@ -274,6 +279,7 @@ void LLFontGL::destroyAllGL()
 void LLFontGL::destroyGL()
 {
 	mFontBitmapCachep->destroyGL();
+	sRunGeneration++;
 }
 
 
@@ -408,17 +414,7 @@ S32 LLFontGL::render(const LLWString &wstr,
 	// Strip off any style bits that are already accounted for by the font.
 	style = style & (~getFontDesc().getStyle());
 
-	F32 drop_shadow_strength = 0.f;
-	if (style & (DROP_SHADOW | DROP_SHADOW_SOFT))
-	{
-		F32 luminance;
-		color.calcHSL(NULL, NULL, &luminance);
-		drop_shadow_strength = clamp_rescale(luminance, 0.35f, 0.6f, 0.f, 1.f);
-		if (luminance < 0.35f)
-		{
-			style = style & ~(DROP_SHADOW | DROP_SHADOW_SOFT);
-		}
-	}
+	F32 drop_shadow_strength = getDropShadowStrength(color, style);
 
 	gGL.pushMatrix();
 	glLoadIdentity();
@@ -691,6 +687,288 @@ S32 LLFontGL::render(const LLWString &wstr,
 }
 
 
+namespace
+{
+	// A quad of a run before it is sorted into atlas spans
+	struct LLRunQuad
+	{
+		U32			mBitmap;
+		LLVector2	mPositions[4];
+		LLVector2	mTexCoords[4];
+		LLColor4U	mColor;
+	};
+
+	struct LLRunQuadBitmapLess
+	{
+		bool operator()(const LLRunQuad& a, const LLRunQuad& b) const
+		{
+			return a.mBitmap < b.mBitmap;
+		}
+	};
+}
+
+BOOL LLFontGL::layoutRun(const LLWString& wstr, const LLColor4& color, U8 style,
+						 S32 max_pixels, LLFontGlyphRun& run) const
+{
+	run.clear();
+
+	// Strip off any style bits that are already accounted for by the font.
+	style = style & (~getFontDesc().getStyle());
+	if (style & UNDERLINE)
+	{
+		return FALSE;
+	}
+
+	run.mFont = this;
+	run.mScaleX = sScaleX;
+	run.mScaleY = sScaleY;
+	run.mGeneration = sRunGeneration;
+
+	S32 scaled_max_pixels = max_pixels == S32_MAX ? S32_MAX : llceil((F32)max_pixels * sScaleX);
+	F32 drop_shadow_strength = getDropShadowStrength(color, style);
+	F32 slant_offset = ((style & ITALIC) ? ( -mAscender * 0.2f) : 0.f);
+
+	LLVector2 offsets[MAX_GLYPH_PASSES];
+	LLColor4 colors[MAX_GLYPH_PASSES];
+	S32 passes = getGlyphPasses(color, style, drop_shadow_strength, offsets, colors);
+
+	F32 inv_width = 1.f / mFontBitmapCachep->getBitmapWidth();
+	F32 inv_height = 1.f / mFontBitmapCachep->getBitmapHeight();
+
+	const S32 LAST_CHARACTER = LLFont::LAST_CHAR_FULL;
+
+	std::vector<LLRunQuad> quads;
+	quads.reserve(wstr.length() * passes);
+
+	F32 cur_x = 0.f;
+	F32 cur_y = 0.f;
+	S32 length = (S32)wstr.length();
+	for (S32 i = 0; i < length; i++)
+	{
+		llwchar wch = wstr[i];
+		if (!hasGlyph(wch))
+		{
+			addChar(wch);
+		}
+
+		const LLFontGlyphInfo* fgi= getGlyphInfo(wch);
+		if (!fgi)
+		{
+			llwarns << "Missing Glyph Info" << llendl;
+			break;
+		}
+
+		if (scaled_max_pixels < (cur_x + fgi->mXBearing + fgi->mWidth))
+		{
+			// Not enough room for this character.
+			break;
+		}
+
+		// Same rectangles as render()
+		LLRectf uv_rect((fgi->mXBitmapOffset) * inv_width,
+				(fgi->mYBitmapOffset + fgi->mHeight + PAD_UVY) * inv_height,
+				(fgi->mXBitmapOffset + fgi->mWidth) * inv_width,
+				(fgi->mYBitmapOffset - PAD_UVY) * inv_height);
+		LLRectf screen_rect(llround(cur_x + (F32)fgi->mXBearing),
+				    llround(cur_y + (F32)fgi->mYBearing),
+				    llround(cur_x + (F32)fgi->mXBearing) + (F32)fgi->mWidth,
+				    llround(cur_y + (F32)fgi->mYBearing) - (F32)fgi->mHeight);
+
+		for (S32 pass = 0; pass < passes; pass++)
+		{
+			LLRectf rect = screen_rect;
+			rect.translate(offsets[pass].mV[VX], offsets[pass].mV[VY]);
+
+			LLRunQuad quad;
+			quad.mBitmap = fgi->mBitmapNum;
+			quad.mColor.setVecScaleClamp(colors[pass]);
+			quad.mPositions[0].setVec(rect.mRight, rect.mTop);
+			quad.mPositions[1].setVec(rect.mLeft, rect.mTop);
+			quad.mPositions[2].setVec(rect.mLeft + slant_offset, rect.mBottom);
+			quad.mPositions[3].setVec(rect.mRight + slant_offset, rect.mBottom);
+			quad.mTexCoords[0].setVec(uv_rect.mRight, uv_rect.mTop);
+			quad.mTexCoords[1].setVec(uv_rect.mLeft, uv_rect.mTop);
+			quad.mTexCoords[2].setVec(uv_rect.mLeft, uv_rect.mBottom);
+			quad.mTexCoords[3].setVec(uv_rect.mRight, uv_rect.mBottom);
+			quads.push_back(quad);
+		}
+		run.mGlyphs++;
+
+		cur_x += fgi->mXAdvance;
+		cur_y += fgi->mYAdvance;
+
+		llwchar next_char = (i + 1 < length) ? wstr[i+1] : 0;
+		if (next_char && (next_char < LAST_CHARACTER))
+		{
+			// Kern this puppy.
+			if (!hasGlyph(next_char))
+			{
+				addChar(next_char);
+			}
+			cur_x += getXKerning(wch, next_char);
+		}
+
+		// Round after kerning.
+		cur_x = (F32)llfloor(cur_x + 0.5f);
+	}
+
+	// Glyphs do not overlap, so sorting by bitmap only changes which quads
+	// share a draw
+	std::stable_sort(quads.begin(), quads.end(), LLRunQuadBitmapLess());
+
+	S32 num_quads = (S32)quads.size();
+	run.mPositions.resize(num_quads * 4);
+	run.mTexCoords.resize(num_quads * 4);
+	run.mColors.resize(num_quads);
+	for (S32 q = 0; q < num_quads; q++)
+	{
+		const LLRunQuad& quad = quads[q];
+		if (run.mSpans.empty() || run.mSpans.back().mBitmap != quad.mBitmap)
+		{
+			LLFontGlyphRun::Span span;
+			span.mBitmap = quad.mBitmap;
+			span.mFirst = q;
+			span.mCount = 0;
+			run.mSpans.push_back(span);
+		}
+		run.mSpans.back().mCount++;
+
+		for (S32 v = 0; v < 4; v++)
+		{
+			run.mPositions[q * 4 + v] = quad.mPositions[v];
+			run.mTexCoords[q * 4 + v] = quad.mTexCoords[v];
+		}
+		run.mColors[q] = quad.mColor;
+	}
+
+	return TRUE;
+}
+
+LLFontGlyphRun::LLFontGlyphRun()
+:	mFont(NULL),
+	mScaleX(0.f),
+	mScaleY(0.f),
+	mGeneration(0),
+	mGlyphs(0)
+{
+}
+
+BOOL LLFontGlyphRun::isValid(const LLFontGL* font) const
+{
+	return mFont && mFont == font &&
+		mScaleX == LLFontGL::sScaleX && mScaleY == LLFontGL::sScaleY &&
+		mGeneration == LLFontGL::sRunGeneration;
+}
+
+void LLFontGlyphRun::clear()
+{
+	mFont = NULL;
+	mGlyphs = 0;
+	mPositions.clear();
+	mTexCoords.clear();
+	mColors.clear();
+	mSpans.clear();
+}
+
+void LLFontRunBatch::add(const LLFontGlyphRun& run, const LLVector3& origin, F32 alpha)
+{
+	if (run.mSpans.empty())
+	{
+		return;
+	}
+
+	Entry entry;
+	entry.mRun = &run;
+	entry.mOrigin = origin;
+	entry.mAlpha = (U8)llclamp(llround(alpha * 255.f), 0, 255);
+	mEntries.push_back(entry);
+}
+
+S32 LLFontRunBatch::render()
+{
+	if (mEntries.empty())
+	{
+		return 0;
+	}
+
+	LLFastTimer t(LLFastTimer::FTM_RENDER_FONTS);
+
+	gGL.getTexUnit(0)->enable(LLTexUnit::TT_TEXTURE);
+	gGL.setSceneBlendType(LLRender::BT_ALPHA);
+
+	// Atlas bitmaps in the order they are first used
+	std::vector<LLImageGL*> images;
+	for (std::vector<Entry>::iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+	{
+		const LLFontGlyphRun* run = iter->mRun;
+		for (std::vector<LLFontGlyphRun::Span>::const_iterator span = run->mSpans.begin(); span != run->mSpans.end(); ++span)
+		{
+			LLImageGL* image = run->mFont->mFontBitmapCachep->getImageGL(span->mBitmap);
+			if (std::find(images.begin(), images.end(), image) == images.end())
+			{
+				images.push_back(image);
+			}
+		}
+	}
+
+	// LLRender flushes on its own past this many vertices
+	const S32 MAX_BATCH_VERTICES = 2048;
+
+	S32 draws = 0;
+	for (std::vector<LLImageGL*>::iterator image = images.begin(); image != images.end(); ++image)
+	{
+		gGL.getTexUnit(0)->bind(*image);
+
+		S32 vertices = 0;
+		gGL.begin(LLRender::QUADS);
+		for (std::vector<Entry>::iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+		{
+			const LLFontGlyphRun* run = iter->mRun;
+			const F32 x = iter->mOrigin.mV[VX];
+			const F32 y = iter->mOrigin.mV[VY];
+			const F32 z = iter->mOrigin.mV[VZ];
+			for (std::vector<LLFontGlyphRun::Span>::const_iterator span = run->mSpans.begin(); span != run->mSpans.end(); ++span)
+			{
+				if (run->mFont->mFontBitmapCachep->getImageGL(span->mBitmap) != *image)
+				{
+					continue;
+				}
+
+				for (S32 q = span->mFirst; q < span->mFirst + span->mCount; q++)
+				{
+					if (vertices + 4 > MAX_BATCH_VERTICES)
+					{
+						gGL.end();
+						gGL.flush();
+						draws++;
+						vertices = 0;
+						gGL.begin(LLRender::QUADS);
+					}
+
+					LLColor4U color = run->mColors[q];
+					color.mV[VALPHA] = (U8)(((U32)color.mV[VALPHA] * iter->mAlpha) / 255);
+					gGL.color4ubv(color.mV);
+					for (S32 v = q * 4; v < q * 4 + 4; v++)
+					{
+						gGL.texCoord2fv(run->mTexCoords[v].mV);
+						gGL.vertex3f(x + run->mPositions[v].mV[VX], y + run->mPositions[v].mV[VY], z);
+					}
+					vertices += 4;
+				}
+			}
+		}
+		gGL.end();
+		if (vertices > 0)
+		{
+			gGL.flush();
+			draws++;
+		}
+	}
+
+	mEntries.clear();
+	return draws;
+}
+
 S32 LLFontGL::getWidth(const std::string& utf8text) const
 {
 	LLWString wtext = utf8str_to_wstring(utf8text);
@@ -738,6 +1016,15 @@ F32 LLFontGL::getWidthF32(const llwchar* wchars, const S32 begin_offset, const S
 		return 0;
 	}
 
+	if (begin_offset == 0)
+	{
+		const LLFontLayout* layout = getLayout(wchars, max_chars, use_embedded);
+		if (layout)
+		{
+			return layout->mWidth == 0.f ? 0.f : layout->mWidth / sScaleX;
+		}
+	}
+
 	const S32 LAST_CHARACTER = LLFont::LAST_CHAR_FULL;
 
 	F32 cur_x = 0;
@@ -805,6 +1092,24 @@ S32 LLFontGL::maxDrawableChars(const llwchar* wchars, F32 max_pixels, S32 max_ch
 
 	F32 scaled_max_pixels =	(F32)llceil(max_pixels * sScaleX);
 
+	const LLFontLayout* layout = getLayout(wchars, max_chars, use_embedded);
+	if (layout)
+	{
+		// First character whose glyph reaches past the edge
+		S32 i = (S32)(std::upper_bound(layout->mReach.begin(), layout->mReach.end(), scaled_max_pixels)
+					  - layout->mReach.begin());
+		clip = i < layout->getLength();
+		if (drawn_pixels)
+		{
+			*drawn_pixels = layout->mPen[i];
+		}
+		if (clip && end_on_word_boundary && (layout->mWordStart[i] != 0))
+		{
+			i = layout->mWordStart[i];
+		}
+		return i;
+	}
+
 	S32 i;
 	for (i=0; (i < max_chars); i++)
 	{
@@ -895,6 +1200,102 @@ S32 LLFontGL::maxDrawableChars(const llwchar* wchars, F32 max_pixels, S32 max_ch
 }
 
 
+const LLFontLayout* LLFontGL::getLayout(const llwchar* wchars, S32 max_chars, BOOL use_embedded) const
+{
+	if (!LLFontLayoutCache::sEnabled
+		|| (use_embedded && !mEmbeddedChars.empty()))
+	{
+		return NULL;
+	}
+
+	// Hashing stops at MAX_STRING_LENGTH, so long text buffers cost no
+	// more than measuring them directly
+	U32 hash = LLFontLayoutCache::hashStart();
+	S32 length = 0;
+	while (length < max_chars && wchars[length])
+	{
+		if (length == LLFontLayoutCache::MAX_STRING_LENGTH)
+		{
+			return NULL;
+		}
+		hash = LLFontLayoutCache::hashChar(hash, wchars[length]);
+		length++;
+	}
+
+	LLFontLayoutCache* cache = LLFontLayoutCache::getInstance();
+	const LLFontLayout* found = cache->find(this, wchars, length, hash);
+	if (found)
+	{
+		return found;
+	}
+
+	// Load every glyph first, getXKerning() treats glyphs that are not
+	// loaded yet as unkerned
+	for (S32 i = 0; i < length; i++)
+	{
+		getXAdvance(wchars[i]);
+	}
+
+	LLFontLayout& layout = cache->insert(this, wchars, length, hash);
+	layout.mPen.resize(length + 1);
+	layout.mReach.resize(length);
+	layout.mWordStart.resize(length);
+
+	const S32 LAST_CHARACTER = LLFont::LAST_CHAR_FULL;
+	F32 width_x = 0.f;
+	F32 cur_x = 0.f;
+	F32 reach = 0.f;
+	S32 start_of_last_word = 0;
+	BOOL in_word = FALSE;
+	layout.mPen[0] = 0.f;
+	for (S32 i = 0; i < length; i++)
+	{
+		llwchar wch = wchars[i];
+		llwchar next_char = (i + 1 < length) ? wchars[i+1] : 0;
+
+		// Same word tracking as maxDrawableChars()
+		if (in_word)
+		{
+			if (iswspace(wch))
+			{
+				in_word = FALSE;
+			}
+		}
+		else
+		{
+			start_of_last_word = i;
+			if (!iswspace(wch))
+			{
+				in_word = TRUE;
+			}
+		}
+		layout.mWordStart[i] = start_of_last_word;
+
+		F32 advance = getXAdvance(wch);
+		F32 kerning = next_char ? getXKerning(wch, next_char) : 0.f;
+
+		// maxDrawableChars() kerns every pair
+		cur_x += advance;
+		reach = llmax(reach, cur_x);
+		layout.mReach[i] = reach;
+		cur_x += kerning;
+		cur_x = (F32)llfloor(cur_x + 0.5f);
+		layout.mPen[i+1] = cur_x;
+
+		// getWidthF32() skips pairs with characters past LAST_CHAR_FULL
+		width_x += advance;
+		if (next_char && (next_char < LAST_CHARACTER))
+		{
+			width_x += kerning;
+		}
+		width_x = (F32)llfloor(width_x + 0.5f);
+	}
+	layout.mWidth = width_x;
+
+	return &layout;
+}
+
+
 S32	LLFontGL::firstDrawableChar(const llwchar* wchars, F32 max_pixels, S32 text_len, S32 start_pos, S32 max_chars) const
 {
 	if (!wchars || !wchars[0] || max_chars == 0)
@@ -1127,73 +1528,86 @@ void LLFontGL::drawGlyph(const LLRectf& screen_rect, const LLRectf& uv_rect, con
 	F32 slant_offset;
 	slant_offset = ((style & ITALIC) ? ( -mAscender * 0.2f) : 0.f);
 
+	LLVector2 offsets[MAX_GLYPH_PASSES];
+	LLColor4 colors[MAX_GLYPH_PASSES];
+	S32 passes = getGlyphPasses(color, style, drop_shadow_strength, offsets, colors);
+
 	gGL.begin(LLRender::QUADS);
 	{
-		//FIXME: bold and drop shadow are mutually exclusive only for convenience
-		//Allow both when we need them.
-		if (style & BOLD)
+		for (S32 pass = 0; pass < passes; pass++)
 		{
-			gGL.color4fv(color.mV);
-			for (S32 pass = 0; pass < 2; pass++)
-			{
-				LLRectf screen_rect_offset = screen_rect;
+			LLRectf screen_rect_offset = screen_rect;
+			screen_rect_offset.translate(offsets[pass].mV[VX], offsets[pass].mV[VY]);
 
-				screen_rect_offset.translate((F32)(pass * BOLD_OFFSET), 0.f);
-				renderQuad(screen_rect_offset, uv_rect, slant_offset);
-			}
+			gGL.color4fv(colors[pass].mV);
+			renderQuad(screen_rect_offset, uv_rect, slant_offset);
 		}
-		else if (style & DROP_SHADOW_SOFT)
-		{
-			LLColor4 shadow_color = LLFontGL::sShadowColor;
-			shadow_color.mV[VALPHA] = color.mV[VALPHA] * drop_shadow_strength * DROP_SHADOW_SOFT_STRENGTH;
-			gGL.color4fv(shadow_color.mV);
-			for (S32 pass = 0; pass < 5; pass++)
-			{
-				LLRectf screen_rect_offset = screen_rect;
+	}
+	gGL.end();
+}
 
-				switch(pass)
-				{
-				case 0:
-					screen_rect_offset.translate(-1.f, -1.f);
-					break;
-				case 1:
-					screen_rect_offset.translate(1.f, -1.f);
-					break;
-				case 2:
-					screen_rect_offset.translate(1.f, 1.f);
-					break;
-				case 3:
-					screen_rect_offset.translate(-1.f, 1.f);
-					break;
-				case 4:
-					screen_rect_offset.translate(0, -2.f);
-					break;
-				}
-			
-				renderQuad(screen_rect_offset, uv_rect, slant_offset);
-			}
-			gGL.color4fv(color.mV);
-			renderQuad(screen_rect, uv_rect, slant_offset);
-		}
-		else if (style & DROP_SHADOW)
+// Drop shadows fade out on dark text and are dropped below 35% luminance
+F32 LLFontGL::getDropShadowStrength(const LLColor4& color, U8& style) const
+{
+	F32 drop_shadow_strength = 0.f;
+	if (style & (DROP_SHADOW | DROP_SHADOW_SOFT))
+	{
+		F32 luminance;
+		color.calcHSL(NULL, NULL, &luminance);
+		drop_shadow_strength = clamp_rescale(luminance, 0.35f, 0.6f, 0.f, 1.f);
+		if (luminance < 0.35f)
 		{
-			LLColor4 shadow_color = LLFontGL::sShadowColor;
-			shadow_color.mV[VALPHA] = color.mV[VALPHA] * drop_shadow_strength;
-			gGL.color4fv(shadow_color.mV);
-			LLRectf screen_rect_shadow = screen_rect;
-			screen_rect_shadow.translate(1.f, -1.f);
-			renderQuad(screen_rect_shadow, uv_rect, slant_offset);
-			gGL.color4fv(color.mV);
-			renderQuad(screen_rect, uv_rect, slant_offset);
+			style = style & ~(DROP_SHADOW | DROP_SHADOW_SOFT);
 		}
-		else // normal rendering
+	}
+	return drop_shadow_strength;
+}
+
+S32 LLFontGL::getGlyphPasses(const LLColor4& color, U8 style, F32 drop_shadow_strength,
+							 LLVector2* offsets, LLColor4* colors) const
+{
+	S32 passes = 0;
+
+	//FIXME: bold and drop shadow are mutually exclusive only for convenience
+	//Allow both when we need them.
+	if (style & BOLD)
+	{
+		for (S32 pass = 0; pass < 2; pass++)
 		{
-			gGL.color4fv(color.mV);
-			renderQuad(screen_rect, uv_rect, slant_offset);
+			offsets[passes].setVec((F32)(pass * BOLD_OFFSET), 0.f);
+			colors[passes++] = color;
 		}
+	}
+	else if (style & DROP_SHADOW_SOFT)
+	{
+		static const F32 soft_offsets[5][2] = { { -1.f, -1.f }, { 1.f, -1.f }, { 1.f, 1.f }, { -1.f, 1.f }, { 0.f, -2.f } };
 
+		LLColor4 shadow_color = LLFontGL::sShadowColor;
+		shadow_color.mV[VALPHA] = color.mV[VALPHA] * drop_shadow_strength * DROP_SHADOW_SOFT_STRENGTH;
+		for (S32 pass = 0; pass < 5; pass++)
+		{
+			offsets[passes].setVec(soft_offsets[pass][0], soft_offsets[pass][1]);
+			colors[passes++] = shadow_color;
+		}
+		offsets[passes].setVec(0.f, 0.f);
+		colors[passes++] = color;
 	}
-	gGL.end();
+	else if (style & DROP_SHADOW)
+	{
+		LLColor4 shadow_color = LLFontGL::sShadowColor;
+		shadow_color.mV[VALPHA] = color.mV[VALPHA] * drop_shadow_strength;
+		offsets[passes].setVec(1.f, -1.f);
+		colors[passes++] = shadow_color;
+		offsets[passes].setVec(0.f, 0.f);
+		colors[passes++] = color;
+	}
+	else // normal rendering
+	{
+		offsets[passes].setVec(0.f, 0.f);
+		colors[passes++] = color;
+	}
+
+	return passes;
 }
 
 std::string LLFontGL::nameFromFont(const LLFontGL* fontp)
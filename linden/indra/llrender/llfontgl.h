@@ -37,6 +37,8 @@
 #include "llfont.h"
 #include "llimagegl.h"
 #include "v2math.h"
+#include "v3math.h"
+#include "v4coloru.h"
 #include "llcoord.h"
 #include "llrect.h"
 
@@ -50,6 +52,75 @@ class LLFontDescriptor;
 // Structure used to store previously requested fonts.
 class LLFontRegistry;
 
+class LLFontGL;
+class LLFontLayout;
+
+// The quads of one string laid out by LLFontGL::layoutRun(), in screen
+// pixels from the pen origin.  Holding on to a run skips the glyph lookups
+// and kerning for text that is drawn unchanged frame after frame.
+class LLFontGlyphRun
+{
+public:
+	LLFontGlyphRun();
+
+	// FALSE once the font scale changed or the glyph atlases were reset
+	BOOL isValid(const LLFontGL* font) const;
+	void clear();
+
+	S32 getGlyphCount() const		{ return mGlyphs; }
+
+private:
+	friend class LLFontGL;
+	friend class LLFontRunBatch;
+
+	// Quads mFirst to mFirst + mCount - 1 all come from atlas bitmap mBitmap
+	struct Span
+	{
+		U32 mBitmap;
+		S32 mFirst;
+		S32 mCount;
+	};
+
+	const LLFontGL*			mFont;
+	F32						mScaleX;
+	F32						mScaleY;
+	U32						mGeneration;
+	S32						mGlyphs;
+	std::vector<LLVector2>	mPositions;		// four per quad
+	std::vector<LLVector2>	mTexCoords;		// four per quad
+	std::vector<LLColor4U>	mColors;		// one per quad
+	std::vector<Span>		mSpans;
+};
+
+// Draws many glyph runs with one gGL batch per atlas bitmap, instead of a
+// matrix setup and a draw per string.  Runs are drawn in the order they
+// were added within each bitmap.
+class LLFontRunBatch
+{
+public:
+	// origin is in window pixels, alpha scales the colors of the run.  The
+	// run has to stay alive until render() or clear().
+	void add(const LLFontGlyphRun& run, const LLVector3& origin, F32 alpha);
+
+	// Draws every run added since the last call in the current (window
+	// space) transform and empties the batch.  Returns the number of draw
+	// calls it took.
+	S32 render();
+	void clear()					{ mEntries.clear(); }
+
+	BOOL isEmpty() const			{ return mEntries.empty(); }
+	S32 getRunCount() const			{ return (S32)mEntries.size(); }
+
+private:
+	struct Entry
+	{
+		const LLFontGlyphRun*	mRun;
+		LLVector3				mOrigin;
+		U8						mAlpha;
+	};
+	std::vector<Entry>		mEntries;
+};
+
 class LLFontGL : public LLFont
 {
 public:
@@ -161,6 +232,12 @@ public:
 		BOOL use_embedded = FALSE,
 		BOOL use_ellipses = FALSE) const;
 
+	// Lays text out the way render() draws it from the pen origin (LEFT,
+	// BASELINE, without embedded characters or ellipses) for an
+	// LLFontRunBatch.  Returns FALSE for UNDERLINE, which a run can't hold.
+	BOOL layoutRun(const LLWString& text, const LLColor4& color, U8 style,
+				   S32 max_pixels, LLFontGlyphRun& run) const;
+
 	// font metrics - override for LLFont that returns units of virtual pixels
 	/*virtual*/ F32 getLineHeight() const		{ return (F32)llround(mLineHeight / sScaleY); }
 	/*virtual*/ F32 getAscenderHeight() const	{ return (F32)llround(mAscender / sScaleY); }
@@ -221,6 +298,16 @@ protected:
 	void clearEmbeddedChars();
 	void renderQuad(const LLRectf& screen_rect, const LLRectf& uv_rect, F32 slant_amt) const;
 	void drawGlyph(const LLRectf& screen_rect, const LLRectf& uv_rect, const LLColor4& color, U8 style, F32 drop_shadow_fade) const;
+	F32 getDropShadowStrength(const LLColor4& color, U8& style) const;
+
+	// Offsets and colors of the quads drawGlyph() draws for one glyph
+	enum { MAX_GLYPH_PASSES = 6 };
+	S32 getGlyphPasses(const LLColor4& color, U8 style, F32 drop_shadow_strength,
+					   LLVector2* offsets, LLColor4* colors) const;
+
+	// Cached layout of the first max_chars characters, NULL when the
+	// string is too long to cache or uses embedded characters
+	const LLFontLayout* getLayout(const llwchar* wchars, S32 max_chars, BOOL use_embedded) const;
 
 public:
 	static F32 sVertDPI;
@@ -242,8 +329,12 @@ public:
 
 	static LLColor4 sShadowColor;
 
+	// Bumped whenever glyph atlases are rebuilt, see LLFontGlyphRun
+	static U32 sRunGeneration;
+
 	friend class LLTextBillboard;
 	friend class LLHUDText;
+	friend class LLFontRunBatch;
 
 protected:
 	/*virtual*/ BOOL addChar(const llwchar wch) const;
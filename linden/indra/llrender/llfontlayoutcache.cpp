@@ -0,0 +1,221 @@
+/**
+ * @file llfontlayoutcache.cpp
+ * @brief Keeps the layout of recently measured strings for LLFontGL.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "linden_common.h"
+
+#include "llfontlayoutcache.h"
+
+#include "llfontgl.h"
+#include "llrand.h"
+#include "lltimer.h"
+
+BOOL LLFontLayoutCache::sEnabled = TRUE;
+
+LLFontLayoutCache::LLFontLayoutCache()
+	: mCachedChars(0),
+	  mScaleX(1.f),
+	  mScaleY(1.f),
+	  mGeneration(0),
+	  mHits(0),
+	  mMisses(0)
+{
+}
+
+void LLFontLayoutCache::validate()
+{
+	if (mScaleX != LLFontGL::sScaleX
+		|| mScaleY != LLFontGL::sScaleY
+		|| mGeneration != LLFontGL::sRunGeneration)
+	{
+		// Advances and kerning come from the glyphs loaded at the old scale
+		clear();
+		mScaleX = LLFontGL::sScaleX;
+		mScaleY = LLFontGL::sScaleY;
+		mGeneration = LLFontGL::sRunGeneration;
+	}
+}
+
+const LLFontLayout* LLFontLayoutCache::find(const LLFontGL* font, const llwchar* wchars, S32 length, U32 hash)
+{
+	validate();
+
+	layout_map_t::iterator map_it = mLayoutMap.find(std::make_pair(font, hash));
+	if (map_it == mLayoutMap.end())
+	{
+		mMisses++;
+		return NULL;
+	}
+
+	layout_list_t::iterator it = map_it->second;
+	if (it->getLength() != length
+		|| memcmp(it->mText.data(), wchars, length * sizeof(llwchar)))
+	{
+		// Another string with the same hash, insert() replaces it
+		mMisses++;
+		return NULL;
+	}
+
+	mHits++;
+	mLayouts.splice(mLayouts.begin(), mLayouts, it);
+	return &mLayouts.front();
+}
+
+LLFontLayout& LLFontLayoutCache::insert(const LLFontGL* font, const llwchar* wchars, S32 length, U32 hash)
+{
+	std::pair<const LLFontGL*, U32> key(font, hash);
+	layout_map_t::iterator map_it = mLayoutMap.find(key);
+	if (map_it != mLayoutMap.end())
+	{
+		mCachedChars -= map_it->second->getLength();
+		mLayouts.erase(map_it->second);
+		mLayoutMap.erase(map_it);
+	}
+
+	mLayouts.push_front(LLFontLayout());
+	LLFontLayout& layout = mLayouts.front();
+	layout.mFont = font;
+	layout.mHash = hash;
+	layout.mText.assign(wchars, length);
+	layout.mWidth = 0.f;
+	mLayoutMap[key] = mLayouts.begin();
+
+	mCachedChars += length;
+	evict();
+
+	return layout;
+}
+
+void LLFontLayoutCache::evict()
+{
+	// Never the entry just inserted at the front
+	while (mCachedChars > MAX_CACHED_CHARS && mLayouts.size() > 1)
+	{
+		LLFontLayout& oldest = mLayouts.back();
+		mCachedChars -= oldest.getLength();
+		mLayoutMap.erase(std::make_pair(oldest.mFont, oldest.mHash));
+		mLayouts.pop_back();
+	}
+}
+
+void LLFontLayoutCache::removeFont(const LLFontGL* font)
+{
+	layout_list_t::iterator it = mLayouts.begin();
+	while (it != mLayouts.end())
+	{
+		if (it->mFont == font)
+		{
+			mCachedChars -= it->getLength();
+			mLayoutMap.erase(std::make_pair(it->mFont, it->mHash));
+			it = mLayouts.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void LLFontLayoutCache::clear()
+{
+	mLayouts.clear();
+	mLayoutMap.clear();
+	mCachedChars = 0;
+}
+
+//static
+void LLFontLayoutCache::benchmark(const LLFontGL* font, S32 num_lines)
+{
+	if (!font)
+	{
+		return;
+	}
+
+	const F32 WRAP_WIDTH = 400.f;
+	const char* words[] = { "hi", "hello", "lol", "Resident:", "anyone", "know", "where", "the",
+							"sandbox", "is?", "brb,", "teleporting", "to", "that", "new", "sim",
+							"(brb)", "thanks!", "script", "error", "on", "line", "42", "texture",
+							"rezzing", "slowly", "today", "http://example.com/landmark", "OK", "xD" };
+	const S32 NUM_WORDS = sizeof(words) / sizeof(words[0]);
+
+	// The same lines for every pass, a name followed by a few to a few
+	// dozen words, most of them repeated the way chat repeats itself
+	std::vector<LLWString> lines(num_lines);
+	for (S32 i = 0; i < num_lines; i++)
+	{
+		std::string line = llformat("Avatar%d Resident:", ll_rand(50));
+		S32 count = 2 + ll_rand(25);
+		for (S32 w = 0; w < count; w++)
+		{
+			line += " ";
+			line += words[ll_rand(NUM_WORDS)];
+		}
+		lines[i] = utf8str_to_wstring(line);
+	}
+
+	LLFontLayoutCache* cache = getInstance();
+	const BOOL was_enabled = sEnabled;
+	const char* names[] = { "uncached", "cold cache", "warm cache" };
+	S64 checksum[3];
+	for (S32 pass = 0; pass < 3; pass++)
+	{
+		sEnabled = pass > 0;
+		if (pass == 1)
+		{
+			cache->clear();
+		}
+		const U32 hits = cache->mHits;
+		const U32 misses = cache->mMisses;
+
+		checksum[pass] = 0;
+		LLTimer timer;
+		for (S32 i = 0; i < num_lines; i++)
+		{
+			// Wrap the way LLConsole does and measure each wrapped line
+			const llwchar* wchars = lines[i].c_str();
+			S32 remaining = (S32)lines[i].size();
+			while (remaining > 0)
+			{
+				S32 drawable = font->maxDrawableChars(wchars, WRAP_WIDTH, remaining, TRUE);
+				if (drawable == 0)
+				{
+					drawable = 1;
+				}
+				checksum[pass] = checksum[pass] * 31 + drawable * 1000 + font->getWidth(wchars, 0, drawable);
+				wchars += drawable;
+				remaining -= drawable;
+			}
+		}
+		F64 time = timer.getElapsedTimeF64();
+
+		llinfos << "Text layout benchmark (" << names[pass] << "): " << num_lines << " lines, "
+				<< llformat("%.3f", time * 1000.0) << " ms, " << (cache->mHits - hits) << " hits, "
+				<< (cache->mMisses - misses) << " misses, "
+				<< (checksum[pass] == checksum[0] ? "same layout as uncached" : "LAYOUT DIFFERS FROM UNCACHED")
+				<< llendl;
+	}
+	sEnabled = was_enabled;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file llfontlayoutcache.h
+ * @brief Keeps the layout of recently measured strings for LLFontGL.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLFONTLAYOUTCACHE_H
+#define LL_LLFONTLAYOUTCACHE_H
+
+#include "llmemory.h"
+#include "llstring.h"
+
+#include <list>
+#include <map>
+#include <vector>
+
+class LLFontGL;
+
+// One string measured in one font at the current UI scale.  Positions are
+// in scaled font pixels, the way LLFontGL steps its pen.
+class LLFontLayout
+{
+public:
+	S32 getLength() const			{ return (S32)mText.size(); }
+
+	const LLFontGL*		mFont;
+	U32					mHash;
+	LLWString			mText;
+
+	// getWidthF32() of the whole string, before dividing by the scale
+	F32					mWidth;
+
+	// Pen position before character i as maxDrawableChars() steps it,
+	// getLength() + 1 entries
+	std::vector<F32>	mPen;
+
+	// Furthest right glyph edge of characters 0 to i.  Never decreases, so
+	// the first character that does not fit is a binary search.
+	std::vector<F32>	mReach;
+
+	// Where the last word started once character i is reached, the line
+	// break maxDrawableChars() falls back to when it ends on a word
+	std::vector<S32>	mWordStart;
+};
+
+// Least recently used layouts, up to MAX_CACHED_CHARS characters in total.
+// Chat, name tags and labels measure and wrap the same short strings over
+// and over, this saves walking their glyphs and kerning pairs every time.
+class LLFontLayoutCache : public LLSingleton<LLFontLayoutCache>
+{
+public:
+	enum
+	{
+		MAX_STRING_LENGTH = 256,	// longer strings are measured directly
+		MAX_CACHED_CHARS = 65536
+	};
+
+	LLFontLayoutCache();
+
+	// Returns NULL when the string is not cached yet.  Drops everything
+	// first when the UI scale changed or the glyphs were reloaded.
+	const LLFontLayout* find(const LLFontGL* font, const llwchar* wchars, S32 length, U32 hash);
+
+	// New most recently used entry for the string, for the caller to fill
+	LLFontLayout& insert(const LLFontGL* font, const llwchar* wchars, S32 length, U32 hash);
+
+	void removeFont(const LLFontGL* font);
+	void clear();
+
+	U32 getHits() const				{ return mHits; }
+	U32 getMisses() const			{ return mMisses; }
+	S32 getCachedChars() const		{ return mCachedChars; }
+
+	static U32 hashChar(U32 hash, llwchar wch)	{ return (hash ^ (U32)wch) * 16777619U; }
+	static U32 hashStart()						{ return 2166136261U; }
+
+	// Wraps num_lines made up chat lines to a chat window width with the
+	// cache off, cold and warm, and logs the timings
+	static void benchmark(const LLFontGL* font, S32 num_lines);
+
+	static BOOL sEnabled;
+
+private:
+	void validate();
+	void evict();
+
+	typedef std::list<LLFontLayout> layout_list_t;
+	typedef std::map<std::pair<const LLFontGL*, U32>, layout_list_t::iterator> layout_map_t;
+
+	layout_list_t	mLayouts;		// most recently used first
+	layout_map_t	mLayoutMap;
+	S32				mCachedChars;
+	F32				mScaleX;
+	F32				mScaleY;
+	U32				mGeneration;
+	U32				mHits;
+	U32				mMisses;
+};
+
+#endif // LL_LLFONTLAYOUTCACHE_H
@@ -266,6 +266,11 @@ PFNGLDRAWRANGEELEMENTSPROC glDrawRangeElements = NULL;
 #endif // LL_LINUX_NV_GL_HEADERS
 #endif
 
+// GL_ARB_instanced_arrays, GL_ARB_draw_instanced
+LLPFNGLVERTEXATTRIBDIVISORARBPROC ll_glVertexAttribDivisorARB = NULL;
+LLPFNGLDRAWARRAYSINSTANCEDARBPROC ll_glDrawArraysInstancedARB = NULL;
+LLPFNGLDRAWELEMENTSINSTANCEDARBPROC ll_glDrawElementsInstancedARB = NULL;
+
 LLGLManager gGLManager;
 
 LLGLManager::LLGLManager() :
@@ -590,6 +595,7 @@ void LLGLManager::initExtensions()
 #else
 	mHasDepthClamp = FALSE;
 #endif
+	mHasInstancedArrays = FALSE;
 	mHasMipMapGeneration = FALSE;
 	mHasSeparateSpecularColor = FALSE;
 	mHasAnisotropic = FALSE;
@@ -616,6 +622,7 @@ void LLGLManager::initExtensions()
 	mHasFramebufferMultisample = mHasFramebufferObject && ExtensionExists("GL_EXT_framebuffer_multisample", gGLHExts.mSysExts);
 	mHasDrawBuffers = ExtensionExists("GL_ARB_draw_buffers", gGLHExts.mSysExts);
 	mHasDepthClamp = ExtensionExists("GL_ARB_depth_clamp", gGLHExts.mSysExts) || ExtensionExists("GL_NV_depth_clamp", gGLHExts.mSysExts);
+	mHasInstancedArrays = ExtensionExists("GL_ARB_instanced_arrays", gGLHExts.mSysExts) && ExtensionExists("GL_ARB_draw_instanced", gGLHExts.mSysExts);
 #if !LL_DARWIN
 	mHasPointParameters = !mIsATI && ExtensionExists("GL_ARB_point_parameters", gGLHExts.mSysExts);
 #endif
@@ -639,6 +646,7 @@ void LLGLManager::initExtensions()
 		mHasFramebufferMultisample = FALSE;
 		mHasDrawBuffers = FALSE;
 		mHasDepthClamp = FALSE;
+		mHasInstancedArrays = FALSE;
 		mHasMipMapGeneration = FALSE;
 		mHasSeparateSpecularColor = FALSE;
 		mHasAnisotropic = FALSE;
@@ -691,6 +699,7 @@ void LLGLManager::initExtensions()
 		if (strchr(blacklist,'r')) mHasDrawBuffers = FALSE;//S
 		if (strchr(blacklist,'s')) mHasFramebufferMultisample = FALSE;
 		if (strchr(blacklist,'t')) mHasDepthClamp = FALSE;
+		if (strchr(blacklist,'u')) mHasInstancedArrays = FALSE;
 
 	}
 #endif // LL_LINUX || LL_SOLARIS
@@ -809,6 +818,16 @@ void LLGLManager::initExtensions()
 	{
 		glDrawBuffersARB = (PFNGLDRAWBUFFERSARBPROC) GLH_EXT_GET_PROC_ADDRESS("glDrawBuffersARB");
 	}
+	if (mHasInstancedArrays)
+	{
+		ll_glVertexAttribDivisorARB = (LLPFNGLVERTEXATTRIBDIVISORARBPROC) GLH_EXT_GET_PROC_ADDRESS("glVertexAttribDivisorARB");
+		ll_glDrawArraysInstancedARB = (LLPFNGLDRAWARRAYSINSTANCEDARBPROC) GLH_EXT_GET_PROC_ADDRESS("glDrawArraysInstancedARB");
+		ll_glDrawElementsInstancedARB = (LLPFNGLDRAWELEMENTSINSTANCEDARBPROC) GLH_EXT_GET_PROC_ADDRESS("glDrawElementsInstancedARB");
+		if (!ll_glVertexAttribDivisorARB || !ll_glDrawArraysInstancedARB || !ll_glDrawElementsInstancedARB)
+		{
+			mHasInstancedArrays = FALSE;
+		}
+	}
 #if (!LL_LINUX && !LL_SOLARIS) || LL_LINUX_NV_GL_HEADERS
 	// This is expected to be a static symbol on Linux GL implementations, except if we use the nvidia headers - bah
 	glDrawRangeElements = (PFNGLDRAWRANGEELEMENTSPROC)GLH_EXT_GET_PROC_ADDRESS("glDrawRangeElements");
@@ -954,6 +973,9 @@ void LLGLManager::initExtensions()
 		glIsProgramARB = (PFNGLISPROGRAMARBPROC) GLH_EXT_GET_PROC_ADDRESS("glIsProgramARB");
 	}
 	LL_DEBUGS("RenderInit") << "GL Probe: Got symbols" << LL_ENDL;
+#else
+	// the instancing entry points are only looked up above
+	mHasInstancedArrays = FALSE;
 #endif
 
 	mInited = TRUE;
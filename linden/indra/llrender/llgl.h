@@ -89,6 +89,7 @@ public:
 	BOOL mHasPointParameters;
 	BOOL mHasDrawBuffers;
 	BOOL mHasDepthClamp;
+	BOOL mHasInstancedArrays;	// GL_ARB_instanced_arrays and GL_ARB_draw_instanced
 
 	// Other extensions.
 	BOOL mHasAnisotropic;
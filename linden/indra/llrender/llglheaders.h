@@ -830,4 +830,18 @@ extern void glGetBufferPointervARB (GLenum, GLenum, GLvoid* *);
 #define GL_DEPTH_CLAMP 0x864F
 #endif
 
+// GL_ARB_instanced_arrays and GL_ARB_draw_instanced are newer than some of
+// the glext.h headers we build against, so the entry points are declared
+// here on every platform.  The ll_ prefix keeps them from clashing with
+// prototypes in newer headers.
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+typedef void (APIENTRY * LLPFNGLVERTEXATTRIBDIVISORARBPROC) (GLuint index, GLuint divisor);
+typedef void (APIENTRY * LLPFNGLDRAWARRAYSINSTANCEDARBPROC) (GLenum mode, GLint first, GLsizei count, GLsizei primcount);
+typedef void (APIENTRY * LLPFNGLDRAWELEMENTSINSTANCEDARBPROC) (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices, GLsizei primcount);
+extern LLPFNGLVERTEXATTRIBDIVISORARBPROC ll_glVertexAttribDivisorARB;
+extern LLPFNGLDRAWARRAYSINSTANCEDARBPROC ll_glDrawArraysInstancedARB;
+extern LLPFNGLDRAWELEMENTSINSTANCEDARBPROC ll_glDrawElementsInstancedARB;
+
 #endif // LL_LLGLHEADERS_H
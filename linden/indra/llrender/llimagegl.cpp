@@ -38,6 +38,7 @@
 #include "llimagegl.h"
 
 #include "llerror.h"
+#include "llframetimer.h"
 #include "llimage.h"
 
 #include "llmath.h"
@@ -381,6 +382,7 @@ void LLImageGL::init(BOOL usemipmaps)
 
 	mTextureMemory = 0;
 	mLastBindTime = 0.f;
+	mLastBindFrame = 0;
 
 	mPickMask = NULL;
 	mPickMaskSize = 0;
@@ -525,6 +527,7 @@ void LLImageGL::dump()
 void LLImageGL::forceUpdateBindStats(void) const
 {
 	mLastBindTime = sLastFrameTime;
+	mLastBindFrame = LLFrameTimer::getFrameCount();
 }
 
 void LLImageGL::updateBindStats(void) const
@@ -542,6 +545,7 @@ void LLImageGL::updateBindStats(void) const
 	
 			updateBoundTexMem();
 			mLastBindTime = sLastFrameTime;
+			mLastBindFrame = LLFrameTimer::getFrameCount();
 		}
 	}
 }
@@ -1134,6 +1138,7 @@ BOOL LLImageGL::createGLTexture(S32 discard_level, const U8* data_in, BOOL data_
 	}
 	// mark this as bound at this point, so we don't throw it out immediately
 	mLastBindTime = sLastFrameTime;
+	mLastBindFrame = LLFrameTimer::getFrameCount();
 	return TRUE;
 }
 #if 0
@@ -186,6 +186,7 @@ public:
 	// Various GL/Rendering options
 	S32 mTextureMemory;
 	mutable F32  mLastBindTime;	// last time this was bound, by discard level
+	mutable U32  mLastBindFrame;	// frame count when this was last bound, used for LRU residency
 	
 private:
 	LLPointer<LLImageRaw> mSaveData; // used for destroyGL/restoreGL
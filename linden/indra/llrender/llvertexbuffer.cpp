@@ -32,6 +32,7 @@
 
 #include "linden_common.h"
 
+#include <algorithm>
 #include <boost/static_assert.hpp>
 
 #include "llvertexbuffer.h"
@@ -40,6 +41,7 @@
 #include "llmemory.h"
 #include "llmemtype.h"
 #include "llrender.h"
+#include "lltimer.h"
 
 //============================================================================
 
@@ -55,8 +57,10 @@ S32 LLVertexBuffer::sCount = 0;
 S32 LLVertexBuffer::sGLCount = 0;
 S32 LLVertexBuffer::sMappedCount = 0;
 BOOL LLVertexBuffer::sEnableVBOs = TRUE;
+BOOL LLVertexBuffer::sUsePool = FALSE;
 U32 LLVertexBuffer::sGLRenderBuffer = 0;
 U32 LLVertexBuffer::sGLRenderIndices = 0;
+U32 LLVertexBuffer::sGLRenderOffset = 0;
 U32 LLVertexBuffer::sLastMask = 0;
 BOOL LLVertexBuffer::sVBOActive = FALSE;
 BOOL LLVertexBuffer::sIBOActive = FALSE;
@@ -211,7 +215,7 @@ void LLVertexBuffer::drawRange(U32 mode, U32 start, U32 end, U32 count, U32 indi
 		llerrs << "Wrong index buffer bound." << llendl;
 	}
 
-	if (mGLBuffer != sGLRenderBuffer)
+	if (mGLBuffer != sGLRenderBuffer || mGLBufferOffset != sGLRenderOffset)
 	{
 		llerrs << "Wrong vertex buffer bound." << llendl;
 	}
@@ -241,7 +245,7 @@ void LLVertexBuffer::draw(U32 mode, U32 count, U32 indices_offset) const
 		llerrs << "Wrong index buffer bound." << llendl;
 	}
 
-	if (mGLBuffer != sGLRenderBuffer)
+	if (mGLBuffer != sGLRenderBuffer || mGLBufferOffset != sGLRenderOffset)
 	{
 		llerrs << "Wrong vertex buffer bound." << llendl;
 	}
@@ -266,7 +270,7 @@ void LLVertexBuffer::drawArrays(U32 mode, U32 first, U32 count) const
 		llerrs << "Bad vertex buffer draw range: [" << first << ", " << first+count << "]" << llendl;
 	}
 
-	if (mGLBuffer != sGLRenderBuffer || useVBOs() != sVBOActive)
+	if (mGLBuffer != sGLRenderBuffer || mGLBufferOffset != sGLRenderOffset || useVBOs() != sVBOActive)
 	{
 		llerrs << "Wrong vertex buffer bound." << llendl;
 	}
@@ -308,6 +312,7 @@ void LLVertexBuffer::unbind()
 
 	sGLRenderBuffer = 0;
 	sGLRenderIndices = 0;
+	sGLRenderOffset = 0;
 
 	setupClientArrays(0);
 }
@@ -317,6 +322,7 @@ void LLVertexBuffer::cleanupClass()
 {
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	unbind();
+	LLVertexBufferPool::cleanupClass();
 	clientCopy(); // deletes GL buffers
 }
 
@@ -327,6 +333,11 @@ void LLVertexBuffer::clientCopy(F64 max_time)
 		glDeleteBuffersARB(sDeleteList.size(), (GLuint*) &(sDeleteList[0]));
 		sDeleteList.clear();
 	}
+
+	if (sEnableVBOs)
+	{
+		LLVertexBufferPool::defragment(max_time);
+	}
 }
 
 //----------------------------------------------------------------------------
@@ -334,6 +345,8 @@ void LLVertexBuffer::clientCopy(F64 max_time)
 LLVertexBuffer::LLVertexBuffer(U32 typemask, S32 usage) :
 	LLRefCount(),
 	mNumVerts(0), mNumIndices(0), mUsage(usage), mGLBuffer(0), mGLIndices(0), 
+	mGLBufferOffset(0), mGLIndicesOffset(0), mGLBufferPool(NULL), mGLIndicesPool(NULL),
+	mClientData(NULL), mClientIndexData(NULL),
 	mMappedData(NULL),
 	mMappedIndexData(NULL), mLocked(FALSE),
 	mFinal(FALSE),
@@ -425,6 +438,16 @@ void LLVertexBuffer::genIndices()
 
 void LLVertexBuffer::releaseBuffer()
 {
+	if (mGLBufferPool)
+	{
+		mGLBufferPool->free(mGLBuffer, mGLBufferOffset);
+		mGLBufferPool = NULL;
+		mGLBufferOffset = 0;
+		delete [] mClientData;
+		mClientData = NULL;
+		return;
+	}
+
 	if (mUsage == GL_STREAM_DRAW_ARB)
 	{
 		sStreamVBOPool.release(mGLBuffer);
@@ -442,6 +465,16 @@ void LLVertexBuffer::releaseBuffer()
 
 void LLVertexBuffer::releaseIndices()
 {
+	if (mGLIndicesPool)
+	{
+		mGLIndicesPool->free(mGLIndices, mGLIndicesOffset);
+		mGLIndicesPool = NULL;
+		mGLIndicesOffset = 0;
+		delete [] mClientIndexData;
+		mClientIndexData = NULL;
+		return;
+	}
+
 	if (mUsage == GL_STREAM_DRAW_ARB)
 	{
 		sStreamIBOPool.release(mGLIndices);
@@ -477,8 +510,25 @@ void LLVertexBuffer::createGLBuffer()
 	if (useVBOs())
 	{
 		mMappedData = NULL;
-		genBuffer();
-		mResized = TRUE;
+		if (usePool(size))
+		{
+			mGLBufferPool = LLVertexBufferPool::getVertexPool(mTypeMask, mUsage);
+			if (mGLBufferPool->allocate(this, size, mGLBuffer, mGLBufferOffset))
+			{
+				mClientData = new U8[size];
+				memset(mClientData, 0, size);
+				mFilthy = TRUE;
+			}
+			else
+			{
+				mGLBufferPool = NULL;
+			}
+		}
+		if (!mGLBufferPool)
+		{
+			genBuffer();
+			mResized = TRUE;
+		}
 	}
 	else
 	{
@@ -509,8 +559,25 @@ void LLVertexBuffer::createGLIndices()
 	if (useVBOs())
 	{
 		mMappedIndexData = NULL;
-		genIndices();
-		mResized = TRUE;
+		if (usePool(size))
+		{
+			mGLIndicesPool = LLVertexBufferPool::getIndexPool(mUsage);
+			if (mGLIndicesPool->allocate(this, size, mGLIndices, mGLIndicesOffset))
+			{
+				mClientIndexData = new U8[size];
+				memset(mClientIndexData, 0, size);
+				mFilthy = TRUE;
+			}
+			else
+			{
+				mGLIndicesPool = NULL;
+			}
+		}
+		if (!mGLIndicesPool)
+		{
+			genIndices();
+			mResized = TRUE;
+		}
 	}
 	else
 	{
@@ -704,6 +771,10 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 						mEmpty = TRUE;
 					}
 				}
+				else if (mGLBufferPool)
+				{
+					resizePooledBuffer(oldsize, newsize);
+				}
 				mResized = TRUE;
 			}
 		}
@@ -741,6 +812,10 @@ void LLVertexBuffer::resizeBuffer(S32 newnverts, S32 newnindices)
 						mEmpty = TRUE;
 					}
 				}
+				else if (mGLIndicesPool)
+				{
+					resizePooledIndices(old_index_size, new_index_size);
+				}
 				mResized = TRUE;
 			}
 		}
@@ -774,6 +849,72 @@ BOOL LLVertexBuffer::useVBOs() const
 	return sEnableVBOs;
 }
 
+BOOL LLVertexBuffer::usePool(S32 size) const
+{
+	// streamed buffers are rewritten every frame; the pools turn down big ones
+	return sUsePool && (mUsage == GL_STATIC_DRAW_ARB || mUsage == GL_DYNAMIC_DRAW_ARB) && size > 0;
+}
+
+// Grows or shrinks a client copy, keeping what fits and zeroing the rest
+static U8* resize_client_copy(U8* data, S32 old_size, S32 new_size)
+{
+	U8* resized = new U8[new_size];
+	memcpy(resized, data, llmin(old_size, new_size));
+	if (new_size > old_size)
+	{
+		memset(resized + old_size, 0, new_size - old_size);
+	}
+	delete [] data;
+	return resized;
+}
+
+void LLVertexBuffer::resizePooledBuffer(S32 old_size, S32 new_size)
+{
+	// move to a range of the new size, the old contents come along in the client copy
+	mGLBufferPool->free(mGLBuffer, mGLBufferOffset);
+	if (mGLBufferPool->allocate(this, new_size, mGLBuffer, mGLBufferOffset))
+	{
+		mClientData = resize_client_copy(mClientData, old_size, new_size);
+		if (mMappedData)
+		{
+			mMappedData = mClientData;
+		}
+		mFilthy = TRUE;
+	}
+	else
+	{ //too big to pool now, setBuffer() sizes the new buffer
+		mGLBufferPool = NULL;
+		mGLBufferOffset = 0;
+		delete [] mClientData;
+		mClientData = NULL;
+		mMappedData = NULL;
+		genBuffer();
+	}
+}
+
+void LLVertexBuffer::resizePooledIndices(S32 old_size, S32 new_size)
+{
+	mGLIndicesPool->free(mGLIndices, mGLIndicesOffset);
+	if (mGLIndicesPool->allocate(this, new_size, mGLIndices, mGLIndicesOffset))
+	{
+		mClientIndexData = resize_client_copy(mClientIndexData, old_size, new_size);
+		if (mMappedIndexData)
+		{
+			mMappedIndexData = mClientIndexData;
+		}
+		mFilthy = TRUE;
+	}
+	else
+	{
+		mGLIndicesPool = NULL;
+		mGLIndicesOffset = 0;
+		delete [] mClientIndexData;
+		mClientIndexData = NULL;
+		mMappedIndexData = NULL;
+		genIndices();
+	}
+}
+
 //----------------------------------------------------------------------------
 
 // Map for data access
@@ -794,9 +935,25 @@ U8* LLVertexBuffer::mapBuffer(S32 access)
 		setBuffer(0);
 		mLocked = TRUE;
 		stop_glerror();
-		mMappedData = (U8*) glMapBufferARB(GL_ARRAY_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+		// Shared buffers are written by unmapBuffer(), mapping them would
+		// wait on every draw using them.
+		if (mGLBufferPool)
+		{
+			mMappedData = mClientData;
+		}
+		else
+		{
+			mMappedData = (U8*) glMapBufferARB(GL_ARRAY_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+		}
 		stop_glerror();
-		mMappedIndexData = (U8*) glMapBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+		if (mGLIndicesPool)
+		{
+			mMappedIndexData = mClientIndexData;
+		}
+		else if (mGLIndices)
+		{
+			mMappedIndexData = (U8*) glMapBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+		}
 		stop_glerror();
 
 		if (!mMappedData)
@@ -820,8 +977,8 @@ U8* LLVertexBuffer::mapBuffer(S32 access)
 			llerrs << "glMapBuffer returned NULL (no vertex data)" << llendl;
 		}
 
-		if (!mMappedIndexData)
-		{
+		if (!mMappedIndexData && mGLIndices)
+		{ // buffers allocated without indices have nothing to map
 			GLint buff;
 			glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING_ARB, &buff);
 			if (buff != mGLIndices)
@@ -846,10 +1003,51 @@ void LLVertexBuffer::unmapBuffer()
 		if (useVBOs() && mLocked)
 		{
 			stop_glerror();
-			glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
+			// New ranges and ranges written without marking what changed
+			// are uploaded whole.
+			BOOL upload_all = mFilthy || mDirtyRegions.empty();
+			if (mGLBufferPool)
+			{
+				if (upload_all)
+				{
+					glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, mGLBufferOffset, getSize(), mMappedData);
+				}
+				else
+				{
+					for (std::vector<DirtyRegion>::iterator iter = mDirtyRegions.begin(); iter != mDirtyRegions.end(); ++iter)
+					{
+						U32 offset = iter->mIndex * mStride;
+						glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, mGLBufferOffset + offset, iter->mCount * mStride, mMappedData + offset);
+					}
+				}
+			}
+			else
+			{
+				glUnmapBufferARB(GL_ARRAY_BUFFER_ARB);
+			}
 			stop_glerror();
-			glUnmapBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB);
+			if (mGLIndicesPool)
+			{
+				if (upload_all)
+				{
+					glBufferSubDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mGLIndicesOffset, getIndicesSize(), mMappedIndexData);
+				}
+				else
+				{
+					for (std::vector<DirtyRegion>::iterator iter = mDirtyRegions.begin(); iter != mDirtyRegions.end(); ++iter)
+					{
+						U32 offset = iter->mIndicesIndex * sizeof(U16);
+						glBufferSubDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, mGLIndicesOffset + offset, iter->mIndicesCount * sizeof(U16), mMappedIndexData + offset);
+					}
+				}
+			}
+			else if (mMappedIndexData)
+			{
+				glUnmapBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB);
+			}
 			stop_glerror();
+			mDirtyRegions.clear();
+			mFilthy = FALSE;
 
 			/*if (!sMapped)
 			{
@@ -860,7 +1058,8 @@ void LLVertexBuffer::unmapBuffer()
 
 			if (mUsage == GL_STATIC_DRAW_ARB)
 			{ //static draw buffers can only be mapped a single time
-				//throw out client data (we won't be using it again)
+				//throw out client data (we won't be using it again,
+				//though a pooled buffer keeps its copy for defragment())
 				mEmpty = TRUE;
 				mFinal = TRUE;
 			}
@@ -1003,6 +1202,10 @@ void LLVertexBuffer::setBuffer(U32 data_mask)
 			sVBOActive = TRUE;
 			setup = TRUE; // ... or the bound buffer changed
 		}
+		else if (mGLBuffer && mGLBufferOffset != sGLRenderOffset)
+		{
+			setup = TRUE; // ... or another range of a shared buffer is used
+		}
 		if (mGLIndices && (mGLIndices != sGLRenderIndices || !sIBOActive))
 		{
 			/*if (sMapped)
@@ -1050,13 +1253,13 @@ void LLVertexBuffer::setBuffer(U32 data_mask)
 				}
 			}
 
-			if (mGLBuffer)
+			if (mGLBuffer && !mGLBufferPool)
 			{
 				stop_glerror();
 				glBufferDataARB(GL_ARRAY_BUFFER_ARB, getSize(), NULL, mUsage);
 				stop_glerror();
 			}
-			if (mGLIndices)
+			if (mGLIndices && !mGLIndicesPool)
 			{
 				stop_glerror();
 				glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, getIndicesSize(), NULL, mUsage);
@@ -1111,6 +1314,7 @@ void LLVertexBuffer::setBuffer(U32 data_mask)
 	if (mGLBuffer)
 	{
 		sGLRenderBuffer = mGLBuffer;
+		sGLRenderOffset = mGLBufferOffset;
 		if (data_mask && setup)
 		{
 			setupVertexBuffer(data_mask); // subclass specific setup (virtual function)
@@ -1124,7 +1328,7 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask) const
 {
 	LLMemType mt(LLMemType::MTYPE_VERTEX_DATA);
 	stop_glerror();
-	U8* base = useVBOs() ? NULL : mMappedData;
+	U8* base = getVerticesPointer();
 	S32 stride = mStride;
 
 	if ((data_mask & mTypeMask) != data_mask)
@@ -1187,9 +1391,190 @@ void LLVertexBuffer::setupVertexBuffer(U32 data_mask) const
 
 void LLVertexBuffer::markDirty(U32 vert_index, U32 vert_count, U32 indices_index, U32 indices_count)
 {
-	// TODO: use GL_APPLE_flush_buffer_range here
-	/*if (useVBOs() && !mFilthy)
+	// TODO: use GL_APPLE_flush_buffer_range for buffers of their own
+	if (isPooled() && mLocked && !mFilthy)
+	{ //unmapBuffer() uploads only these
+		mDirtyRegions.push_back(DirtyRegion(vert_index, vert_count, indices_index, indices_count));
+	}
+}
+
+//============================================================================
+// LLVertexBufferPool
+
+// tuning params
+const U32 POOL_VERTEX_BUFFER_SIZE = 2 * 1024 * 1024;
+const U32 POOL_INDEX_BUFFER_SIZE = 512 * 1024;
+const U32 POOL_ALIGNMENT = 16;
+const U32 POOL_DEFRAG_BYTES_PER_FRAME = 256 * 1024;
+
+//static
+LLVertexBufferPool::pool_map_t LLVertexBufferPool::sVertexPools;
+LLVertexBufferPool::index_pool_map_t LLVertexBufferPool::sIndexPools;
+U32 LLVertexBufferPool::sRangeCount = 0;
+U32 LLVertexBufferPool::sBufferCount = 0;
+U32 LLVertexBufferPool::sBufferBytes = 0;
+U32 LLVertexBufferPool::sUsedBytes = 0;
+U32 LLVertexBufferPool::sMovedBytes = 0;
+
+LLVertexBufferPool::LLVertexBufferPool(U32 target, S32 usage, U32 buffer_size, U32 max_range)
+:	LLRangeAllocator(buffer_size, max_range, POOL_ALIGNMENT),
+	mTarget(target),
+	mUsage(usage)
+{
+}
+
+//static
+LLVertexBufferPool* LLVertexBufferPool::getVertexPool(U32 typemask, S32 usage)
+{
+	LLVertexBufferPool*& pool = sVertexPools[std::make_pair(typemask, usage)];
+	if (!pool)
 	{
-	
-	}*/
+		pool = new LLVertexBufferPool(GL_ARRAY_BUFFER_ARB, usage, POOL_VERTEX_BUFFER_SIZE, POOL_VERTEX_BUFFER_SIZE / 8);
+	}
+	return pool;
+}
+
+//static
+LLVertexBufferPool* LLVertexBufferPool::getIndexPool(S32 usage)
+{
+	LLVertexBufferPool*& pool = sIndexPools[usage];
+	if (!pool)
+	{
+		pool = new LLVertexBufferPool(GL_ELEMENT_ARRAY_BUFFER_ARB, usage, POOL_INDEX_BUFFER_SIZE, POOL_INDEX_BUFFER_SIZE / 8);
+	}
+	return pool;
+}
+
+U32 LLVertexBufferPool::createBlock(U32 size)
+{
+	U32 name = 0;
+	glGenBuffersARB(1, (GLuint*) &name);
+
+	stop_glerror();
+	glBindBufferARB(mTarget, name);
+	glBufferDataARB(mTarget, size, NULL, mUsage);
+	stop_glerror();
+	// the buffer bindings LLVertexBuffer keeps track of are stale now
+	LLVertexBuffer::unbind();
+
+	LLVertexBuffer::sGLCount++;
+	return name;
+}
+
+void LLVertexBufferPool::deleteBlock(U32 block)
+{
+	LLVertexBuffer::sDeleteList.push_back(block);
+	LLVertexBuffer::sGLCount--;
+}
+
+BOOL LLVertexBufferPool::canMoveRange(void* owner) const
+{
+	return !((LLVertexBuffer*) owner)->isLocked();
+}
+
+void LLVertexBufferPool::moveRange(void* owner, U32 size, U32 src_block, U32 src_offset,
+								   U32 dst_block, U32 dst_offset)
+{
+	LLVertexBuffer* buffer = (LLVertexBuffer*) owner;
+
+	// An unlocked buffer's client copy is what its range holds, reading the
+	// range back from GL would wait for the draws using it.
+	U8* data;
+	U32 data_size;
+	if (mTarget == GL_ARRAY_BUFFER_ARB)
+	{
+		data = buffer->mClientData;
+		data_size = buffer->getSize();
+		buffer->mGLBuffer = dst_block;
+		buffer->mGLBufferOffset = dst_offset;
+	}
+	else
+	{
+		data = buffer->mClientIndexData;
+		data_size = buffer->getIndicesSize();
+		buffer->mGLIndices = dst_block;
+		buffer->mGLIndicesOffset = dst_offset;
+	}
+
+	stop_glerror();
+	glBindBufferARB(mTarget, dst_block);
+	glBufferSubDataARB(mTarget, dst_offset, llmin(size, data_size), data);
+	stop_glerror();
+}
+
+//static
+void LLVertexBufferPool::updateStats()
+{
+	std::vector<LLVertexBufferPool*> pools;
+	for (pool_map_t::iterator iter = sVertexPools.begin(); iter != sVertexPools.end(); ++iter)
+	{
+		pools.push_back(iter->second);
+	}
+	for (index_pool_map_t::iterator iter = sIndexPools.begin(); iter != sIndexPools.end(); ++iter)
+	{
+		pools.push_back(iter->second);
+	}
+
+	sRangeCount = 0;
+	sBufferCount = 0;
+	sBufferBytes = 0;
+	sUsedBytes = 0;
+	sMovedBytes = 0;
+	for (std::vector<LLVertexBufferPool*>::iterator iter = pools.begin(); iter != pools.end(); ++iter)
+	{
+		LLVertexBufferPool* pool = *iter;
+		sRangeCount += pool->getRangeCount();
+		sBufferCount += pool->getBlockCount();
+		sBufferBytes += pool->getBlockCount() * pool->getBlockSize();
+		sUsedBytes += pool->getUsedBytes();
+		sMovedBytes += pool->getMovedBytes();
+	}
+}
+
+//static
+void LLVertexBufferPool::defragment(F64 max_time)
+{
+	LLTimer timer;
+	U32 max_bytes = POOL_DEFRAG_BYTES_PER_FRAME;
+	BOOL moved = FALSE;
+
+	for (pool_map_t::iterator iter = sVertexPools.begin(); iter != sVertexPools.end(); ++iter)
+	{
+		while (max_bytes > 0 && timer.getElapsedTimeF64() < max_time && iter->second->defragmentStep(max_bytes))
+		{
+			moved = TRUE;
+		}
+	}
+	for (index_pool_map_t::iterator iter = sIndexPools.begin(); iter != sIndexPools.end(); ++iter)
+	{
+		while (max_bytes > 0 && timer.getElapsedTimeF64() < max_time && iter->second->defragmentStep(max_bytes))
+		{
+			moved = TRUE;
+		}
+	}
+
+	if (moved)
+	{
+		LLVertexBuffer::unbind();
+	}
+	updateStats();
+}
+
+//static
+void LLVertexBufferPool::cleanupClass()
+{
+	for (pool_map_t::iterator iter = sVertexPools.begin(); iter != sVertexPools.end(); ++iter)
+	{
+		iter->second->deleteEmptyBlocks();
+	}
+	for (index_pool_map_t::iterator iter = sIndexPools.begin(); iter != sIndexPools.end(); ++iter)
+	{
+		iter->second->deleteEmptyBlocks();
+	}
+	updateStats();
+
+	if (sRangeCount > 0)
+	{
+		llwarns << sRangeCount << " vertex buffer ranges still in use after cleanup." << llendl;
+	}
 }
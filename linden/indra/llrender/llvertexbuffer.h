@@ -41,6 +41,8 @@
 #include "llstrider.h"
 #include "llmemory.h"
 #include "llrender.h"
+#include "llrangeallocator.h"
+#include <map>
 #include <set>
 #include <vector>
 #include <list>
@@ -74,6 +76,58 @@ protected:
 };
 
 
+//============================================================================
+// shared buffers for static and dynamic vertex and index data
+//
+// Instead of a GL buffer each, vertex buffers get a range of a large shared
+// buffer: one set of buffers per vertex type mask and usage, and one per
+// usage for indices.  Pooled vertex buffers keep a client copy of their
+// data, which mapBuffer() hands out and unmapBuffer() writes to their range
+// with glBufferSubData(), either whole or only the regions marked dirty.
+// Buffers that end up mostly empty are emptied into the others by
+// defragment(), which uploads the moved ranges from the client copies
+// rather than reading them back from GL.
+
+class LLVertexBuffer;
+
+class LLVertexBufferPool : public LLRangeAllocator
+{
+public:
+	static LLVertexBufferPool* getVertexPool(U32 typemask, S32 usage);
+	static LLVertexBufferPool* getIndexPool(S32 usage);
+
+	// Moves ranges out of sparse buffers, for at most max_time seconds
+	static void defragment(F64 max_time);
+	// Deletes the empty buffers.  Called when all vertex buffers are released.
+	static void cleanupClass();
+
+	static U32 sRangeCount;		// ranges handed out
+	static U32 sBufferCount;	// shared GL buffers
+	static U32 sBufferBytes;	// allocated in shared GL buffers
+	static U32 sUsedBytes;		// by ranges
+	static U32 sMovedBytes;		// copied by defragment()
+
+protected:
+	/*virtual*/ U32 createBlock(U32 size);
+	/*virtual*/ void deleteBlock(U32 block);
+	/*virtual*/ BOOL canMoveRange(void* owner) const;
+	/*virtual*/ void moveRange(void* owner, U32 size, U32 src_block, U32 src_offset,
+							   U32 dst_block, U32 dst_offset);
+
+private:
+	LLVertexBufferPool(U32 target, S32 usage, U32 buffer_size, U32 max_range);
+
+	static void updateStats();
+
+	typedef std::map<std::pair<U32, S32>, LLVertexBufferPool*> pool_map_t;
+	static pool_map_t sVertexPools;
+	typedef std::map<S32, LLVertexBufferPool*> index_pool_map_t;
+	static index_pool_map_t sIndexPools;
+
+	U32 mTarget;		// GL_ARRAY_BUFFER_ARB or GL_ELEMENT_ARRAY_BUFFER_ARB
+	S32 mUsage;			// GL usage of the shared buffers
+};
+
 //============================================================================
 // base class
 
@@ -128,6 +182,7 @@ public:
 	
 protected:
 	friend class LLRender;
+	friend class LLVertexBufferPool;
 
 	virtual ~LLVertexBuffer(); // use unref()
 
@@ -144,6 +199,9 @@ protected:
 	void	updateNumVerts(S32 nverts);
 	void	updateNumIndices(S32 nindices); 
 	virtual BOOL	useVBOs() const;
+	BOOL	usePool(S32 size) const;
+	void	resizePooledBuffer(S32 old_size, S32 new_size);
+	void	resizePooledIndices(S32 old_size, S32 new_size);
 	void	unmapBuffer();
 		
 public:
@@ -181,8 +239,10 @@ public:
 	S32 getRequestedVerts() const			{ return mRequestedNumVerts; }
 	S32 getRequestedIndices() const			{ return mRequestedNumIndices; }
 
-	U8* getIndicesPointer() const			{ return useVBOs() ? NULL : mMappedIndexData; }
-	U8* getVerticesPointer() const			{ return useVBOs() ? NULL : mMappedData; }
+	// offsets into the bound GL buffers when using VBOs
+	U8* getIndicesPointer() const			{ return useVBOs() ? (U8*) NULL + mGLIndicesOffset : mMappedIndexData; }
+	U8* getVerticesPointer() const			{ return useVBOs() ? (U8*) NULL + mGLBufferOffset : mMappedData; }
+	BOOL isPooled() const					{ return mGLBufferPool || mGLIndicesPool; }
 	S32 getStride() const					{ return mStride; }
 	S32 getTypeMask() const					{ return mTypeMask; }
 	BOOL hasDataType(S32 type) const		{ return ((1 << type) & getTypeMask()) ? TRUE : FALSE; }
@@ -212,6 +272,12 @@ protected:
 	S32		mUsage;			// GL usage
 	U32		mGLBuffer;		// GL VBO handle
 	U32		mGLIndices;		// GL IBO handle
+	U32		mGLBufferOffset;	// where the vertices start in mGLBuffer
+	U32		mGLIndicesOffset;	// where the indices start in mGLIndices
+	LLVertexBufferPool* mGLBufferPool;	// if not NULL, mGLBuffer is shared
+	LLVertexBufferPool* mGLIndicesPool;	// if not NULL, mGLIndices is shared
+	U8*		mClientData;		// what mGLBuffer holds for this buffer, if pooled
+	U8*		mClientIndexData;	// what mGLIndices holds for this buffer, if pooled
 	U8*		mMappedData;	// pointer to currently mapped data (NULL if unmapped)
 	U8*		mMappedIndexData;	// pointer to currently mapped indices (NULL if unmapped)
 	BOOL	mLocked;			// if TRUE, buffer is being or has been written to in client memory
@@ -246,10 +312,12 @@ public:
 	typedef std::list<LLVertexBuffer*> buffer_list_t;
 		
 	static BOOL sEnableVBOs;
+	static BOOL sUsePool;	// sub-allocate buffers from LLVertexBufferPool
 	static S32 sTypeOffsets[TYPE_MAX];
 	static U32 sGLMode[LLRender::NUM_MODES];
 	static U32 sGLRenderBuffer;
 	static U32 sGLRenderIndices;
+	static U32 sGLRenderOffset;	// mGLBufferOffset of the buffer set up for rendering
 	static BOOL sVBOActive;
 	static BOOL sIBOActive;
 	static U32 sLastMask;
@@ -0,0 +1,26 @@
+/** 
+ * @file particleFullbrightV.glsl
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ * $License$
+ */
+
+attribute vec4 part_color;
+
+void calcAtmospherics(vec3 inPositionEye);
+vec4 particleQuadVertex();
+
+void main()
+{
+	//transform vertex
+	vec4 vert = particleQuadVertex();
+	gl_Position = gl_ModelViewProjectionMatrix * vert;
+	
+	vec4 pos = (gl_ModelViewMatrix * vert);
+
+	calcAtmospherics(pos.xyz);
+
+	gl_FrontColor = part_color;
+
+	gl_FogFragCoord = pos.z;
+}
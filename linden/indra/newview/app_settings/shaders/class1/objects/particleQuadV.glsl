@@ -0,0 +1,35 @@
+/** 
+ * @file particleQuadV.glsl
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ * $License$
+ */
+
+// One record per particle, drawn instanced over the four corners of a quad
+attribute vec3 part_center;		// agent space
+attribute vec3 part_velocity;	// zero unless the particle follows its velocity
+attribute vec2 part_scale;
+
+uniform vec3 part_camera;		// agent space
+
+// Expands the particle into a camera facing quad the way
+// LLVOPartGroup::getGeometry() used to, corners come in gl_Vertex.xy.
+vec4 particleQuadVertex()
+{
+	vec3 at = part_center - part_camera;
+	vec3 right = normalize(cross(at, vec3(0.0, 0.0, 1.0)));
+	vec3 up = normalize(cross(right, at));
+
+	if (dot(part_velocity, part_velocity) > 0.0)
+	{
+		vec2 fracs = normalize(vec2(dot(part_velocity, right), dot(part_velocity, up)));
+		vec3 new_up = fracs.x * right + fracs.y * up;
+		right = normalize(fracs.y * right - fracs.x * up);
+		up = normalize(new_up);
+	}
+
+	gl_TexCoord[0] = gl_TextureMatrix[0] * vec4(gl_Vertex.xy * 0.5 + 0.5, 0.0, 1.0);
+
+	return vec4(part_center + (gl_Vertex.x * 0.5 * part_scale.x) * right
+				+ (gl_Vertex.y * 0.5 * part_scale.y) * up, 1.0);
+}
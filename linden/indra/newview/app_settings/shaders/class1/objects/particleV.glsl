@@ -0,0 +1,31 @@
+/** 
+ * @file particleV.glsl
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ * $License$
+ */
+
+attribute vec4 part_color;
+
+vec4 calcLighting(vec3 pos, vec3 norm, vec4 color, vec4 baseCol);
+void calcAtmospherics(vec3 inPositionEye);
+vec4 particleQuadVertex();
+
+void main()
+{
+	//transform vertex
+	vec4 vert = particleQuadVertex();
+	gl_Position = gl_ModelViewProjectionMatrix * vert;
+	
+	vec4 pos = (gl_ModelViewMatrix * vert);
+	
+	// particles face down the camera's view axis
+	vec3 norm = vec3(0.0, 0.0, 1.0);
+
+	calcAtmospherics(pos.xyz);
+
+	vec4 color = calcLighting(pos.xyz, norm, part_color, vec4(0.));
+	gl_FrontColor = color;
+
+	gl_FogFragCoord = pos.z;
+}
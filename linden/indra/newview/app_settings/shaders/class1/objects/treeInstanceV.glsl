@@ -0,0 +1,38 @@
+/** 
+ * @file treeInstanceV.glsl
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ * $License$
+ */
+
+// One record per branch or leaf cluster, drawn instanced over the shared
+// mesh of the tree species
+attribute vec4 tree_row0;			// agent space transform, by rows
+attribute vec4 tree_row1;
+attribute vec4 tree_row2;
+attribute float tree_tex_offset;	// billboards use the lower half of the texture
+
+vec4 calcLighting(vec3 pos, vec3 norm, vec4 color, vec4 baseCol);
+void calcAtmospherics(vec3 inPositionEye);
+
+void main()
+{
+	//transform vertex
+	vec4 vert = vec4(dot(tree_row0, gl_Vertex), dot(tree_row1, gl_Vertex), dot(tree_row2, gl_Vertex), 1.0);
+	gl_Position = gl_ModelViewProjectionMatrix * vert;
+	gl_TexCoord[0] = gl_TextureMatrix[0] * (gl_MultiTexCoord0 + vec4(0.0, tree_tex_offset, 0.0, 0.0));
+	
+	vec4 pos = (gl_ModelViewMatrix * vert);
+	
+	// Branches are only stretched along their axis, which their normals are
+	// perpendicular to, so this points where GL_NORMALIZE would
+	vec3 norm = vec3(dot(tree_row0.xyz, gl_Normal), dot(tree_row1.xyz, gl_Normal), dot(tree_row2.xyz, gl_Normal));
+	norm = normalize(gl_NormalMatrix * norm);
+
+	calcAtmospherics(pos.xyz);
+
+	vec4 color = calcLighting(pos.xyz, norm, gl_Color, vec4(0.));
+	gl_FrontColor = color;
+
+	gl_FogFragCoord = pos.z;
+}
@@ -92,9 +92,12 @@
 #include "llviewerkeyboard.h"
 #include "lllfsthread.h"
 #include "llworkerthread.h"
+#include "llthreadpool.h"
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "lltexlayer.h"
+#include "llterrainjobs.h"
 
 // The files below handle dependencies from cleanup.
 #include "llkeyframemotion.h"
@@ -118,6 +121,7 @@
 #include "llwlparammanager.h"
 #include "llwaterparammanager.h"
 #include "llcalc.h"
+#include "llskinning.h"
 
 #include "lldebugview.h"
 #include "llconsole.h"
@@ -467,6 +471,12 @@ static void settings_modify()
 		gSavedSettings.setU32("VectorizeProcessor", 0 );
 	}
 	else
+	if (gSysCPU.hasAVX2() && ll_skin_avx2_built())
+	{
+		gSavedSettings.setBOOL("VectorizeEnable", TRUE );
+		gSavedSettings.setU32("VectorizeProcessor", 3 );
+	}
+	else
 	if (gSysCPU.hasSSE2())
 	{
 		gSavedSettings.setBOOL("VectorizeEnable", TRUE );
@@ -553,6 +563,8 @@ const std::string LLAppViewer::sCrashSettingsName = "CrashSettings";
 LLTextureCache* LLAppViewer::sTextureCache = NULL; 
 LLImageDecodeThread* LLAppViewer::sImageDecodeThread = NULL; 
 LLTextureFetch* LLAppViewer::sTextureFetch = NULL; 
+LLTexLayerBakeThread* LLAppViewer::sTexLayerBakeThread = NULL;
+LLTerrainJobThread* LLAppViewer::sTerrainJobThread = NULL;
 
 LLAppViewer::LLAppViewer() : 
 	mMarkerFile(),
@@ -1065,6 +1077,8 @@ bool LLAppViewer::mainLoop()
 						// also pause worker threads during this wait period
 						LLAppViewer::getTextureCache()->pause();
 						LLAppViewer::getImageDecodeThread()->pause();
+						LLAppViewer::getTexLayerBakeThread()->pause();
+						LLAppViewer::getTerrainJobThread()->pause();
 					}
 				}
 				
@@ -1090,6 +1104,8 @@ bool LLAppViewer::mainLoop()
  					work_pending += LLAppViewer::getTextureCache()->update(1); // unpauses the texture cache thread
  					work_pending += LLAppViewer::getImageDecodeThread()->update(1); // unpauses the image thread
  					work_pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
+ 					work_pending += LLAppViewer::getTexLayerBakeThread()->update(1); // unpauses the avatar bake thread
+ 					work_pending += LLAppViewer::getTerrainJobThread()->update(1); // unpauses the terrain job thread
 					io_pending += LLVFSThread::updateClass(1);
 					io_pending += LLLFSThread::updateClass(1);
 					if (io_pending > 1000)
@@ -1116,6 +1132,8 @@ bool LLAppViewer::mainLoop()
 				{
 					LLAppViewer::getTextureCache()->pause();
 					LLAppViewer::getImageDecodeThread()->pause();
+					LLAppViewer::getTexLayerBakeThread()->pause();
+					LLAppViewer::getTerrainJobThread()->pause();
 					// LLAppViewer::getTextureFetch()->pause(); // Don't pause the fetch (IO) thread
 				}
 				//LLVFSThread::sLocal->pause(); // Prevent the VFS thread from running while rendering.
@@ -1466,6 +1484,8 @@ bool LLAppViewer::cleanup()
 		pending += LLAppViewer::getTextureCache()->update(1); // unpauses the worker thread
 		pending += LLAppViewer::getImageDecodeThread()->update(1); // unpauses the image thread
 		pending += LLAppViewer::getTextureFetch()->update(1); // unpauses the texture fetch thread
+		pending += LLAppViewer::getTexLayerBakeThread()->update(1); // unpauses the avatar bake thread
+		pending += LLAppViewer::getTerrainJobThread()->update(1); // unpauses the terrain job thread
 		pending += LLVFSThread::updateClass(0);
 		pending += LLLFSThread::updateClass(0);
 		if (pending == 0)
@@ -1484,12 +1504,20 @@ bool LLAppViewer::cleanup()
 	sTextureCache->shutdown();
 	sTextureFetch->shutdown();
 	sImageDecodeThread->shutdown();
+	sTexLayerBakeThread->shutdown();
+	sTerrainJobThread->shutdown();
 	delete sTextureCache;
     sTextureCache = NULL;
 	delete sTextureFetch;
     sTextureFetch = NULL;
 	delete sImageDecodeThread;
     sImageDecodeThread = NULL;
+	delete sTexLayerBakeThread;
+	sTexLayerBakeThread = NULL;
+	delete sTerrainJobThread;
+	sTerrainJobThread = NULL;
+	LLPatchTextureJob::cleanupClass();
+	LLThreadPool::cleanupClass();
 
 	gSavedSettings.cleanup();//do this after last time gSavedSettings is used  *surprise*
 
@@ -1626,8 +1654,15 @@ bool LLAppViewer::initThreads()
 	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(), sImageDecodeThread, enable_threads && true);
+	// Compositing and encoding of our avatar's bakes
+	LLAppViewer::sTexLayerBakeThread = new LLTexLayerBakeThread(enable_threads && true);
+	// Terrain patch textures and geometry
+	LLAppViewer::sTerrainJobThread = new LLTerrainJobThread(enable_threads && true);
 	LLImage::initClass(gSavedSettings.getBOOL("UseKDUIfAvailable"));
 
+	// Pool for short data-parallel jobs run from the main loop
+	LLThreadPool::initClass(enable_threads ? gSavedSettings.getS32("ThreadPoolSize") : 0);
+
 	// *FIX: no error handling here!
 	return true;
 }
@@ -3586,6 +3621,33 @@ void LLAppViewer::idle()
 				llinfos << "Unknown object updates: " << gObjectList.mNumUnknownUpdates << llendl;
 				gObjectList.mNumUnknownUpdates = 0;
 			}
+			if (gObjectList.mNumDecodedBlocks)
+			{
+				llinfos << "Object update blocks decoded: " << gObjectList.mNumDecodedBlocks
+						<< " (" << gObjectList.mNumThreadedBlocks << " on pool threads), decode "
+						<< gObjectList.mUpdateDecodeTimeStat.getMean() << " ms/frame, apply "
+						<< gObjectList.mUpdateApplyTimeStat.getMean() << " ms/frame" << llendl;
+				gObjectList.mNumDecodedBlocks = 0;
+				gObjectList.mNumThreadedBlocks = 0;
+			}
+			if (gObjectList.mNumDeferredUpdatesStat.getMean() > 0.f)
+			{
+				llinfos << "Object updates held back: " << gObjectList.mNumDeferredUpdatesStat.getMean()
+						<< "/frame, skipped " << gObjectList.mNumSkippedUpdatesStat.getMean()
+						<< "/frame, saving " << gObjectList.mUpdateTimeSavedStat.getMean() << " ms/frame, "
+						<< gObjectList.getNumDeferredUpdatesPending() << " pending" << llendl;
+			}
+			if (gObjectList.mAnimationTimeStat.getMean() > 0.f)
+			{
+				llinfos << "Avatar animation: " << gObjectList.mAnimationTimeStat.getMean()
+						<< " ms/frame, saved " << gObjectList.mAnimationTimeSavedStat.getMean()
+						<< " ms/frame, avatars at LOD full/reduced/low/minimal "
+						<< gObjectList.mAnimationLODStat[LLCharacter::ANIMATION_LOD_FULL].getMean() << "/"
+						<< gObjectList.mAnimationLODStat[LLCharacter::ANIMATION_LOD_REDUCED].getMean() << "/"
+						<< gObjectList.mAnimationLODStat[LLCharacter::ANIMATION_LOD_LOW].getMean() << "/"
+						<< gObjectList.mAnimationLODStat[LLCharacter::ANIMATION_LOD_MINIMAL].getMean()
+						<< ", bias " << LLVOAvatar::sAnimationLODBias << llendl;
+			}
 		}
 		gFrameStats.addFrameData();
 	}
@@ -4060,6 +4122,8 @@ void LLAppViewer::idleNetwork()
 	llpushcallstacks ;
 
 	gObjectList.mNumNewObjects = 0;
+	gObjectList.mUpdateDecodeTime = 0.f;
+	gObjectList.mUpdateApplyTime = 0.f;
 	S32 total_decoded = 0;
 
 	if (!gSavedSettings.getBOOL("SpeedTest"))
@@ -4142,6 +4206,8 @@ void LLAppViewer::idleNetwork()
 	}
 	llpushcallstacks ;
 	gObjectList.mNumNewObjectsStat.addValue(gObjectList.mNumNewObjects);
+	gObjectList.mUpdateDecodeTimeStat.addValue(gObjectList.mUpdateDecodeTime);
+	gObjectList.mUpdateApplyTimeStat.addValue(gObjectList.mUpdateApplyTime);
 
 	if (gDisconnected)
 		return;
@@ -38,6 +38,8 @@
 class LLTextureCache;
 class LLImageDecodeThread;
 class LLTextureFetch;
+class LLTexLayerBakeThread;
+class LLTerrainJobThread;
 class LLWatchdogTimeout;
 class LLCommandLineParser;
 
@@ -95,6 +97,8 @@ public:
 	static LLTextureCache* getTextureCache() { return sTextureCache; }
 	static LLImageDecodeThread* getImageDecodeThread() { return sImageDecodeThread; }
 	static LLTextureFetch* getTextureFetch() { return sTextureFetch; }
+	static LLTexLayerBakeThread* getTexLayerBakeThread() { return sTexLayerBakeThread; }
+	static LLTerrainJobThread* getTerrainJobThread() { return sTerrainJobThread; }
 
 	const std::string& getSerialNumber() { return mSerialNumber; }
 	
@@ -218,6 +222,8 @@ private:
 	static LLTextureCache* sTextureCache; 
 	static LLImageDecodeThread* sImageDecodeThread; 
 	static LLTextureFetch* sTextureFetch;
+	static LLTexLayerBakeThread* sTexLayerBakeThread;
+	static LLTerrainJobThread* sTerrainJobThread;
 
 	S32 mNumSessions;
 
@@ -54,6 +54,8 @@
 #include "pipeline.h"
 #include "lldrawpool.h"
 #include "llworld.h"
+#include "lldrawable.h"
+#include "hippolimits.h"
 
 extern LLPipeline gPipeline;
 
@@ -63,13 +65,16 @@ enum
 	LL_PUFF_DYING = 1
 };
 
-// Used for patch decoder
-S32 gBuffer[16*16];
+// Frames between puff updates of cloud groups that are out of view
+const S32 CLOUD_HIDDEN_UPDATE_FRAMES = 8;
 
 
 //static
 S32 LLCloudPuff::sPuffCount = 0;
 
+F32 LLCloudLayer::sFrameCost = 0.f;
+LLStat LLCloudLayer::sCostStat;
+
 LLCloudPuff::LLCloudPuff() :
 	mAlpha(0.01f),
 	mRate((gSavedSettings.getF32("CloudGrowRate")/100)*gSavedSettings.getF32("CloudUpdateRate")),
@@ -81,6 +86,10 @@ LLCloudGroup::LLCloudGroup() :
 	mCloudLayerp(NULL),
 	mDensity(0.f),
 	mTargetPuffCount(0),
+	mPendingTime(0.f),
+	mPendingFrames(0),
+	mMoved(FALSE),
+	mChanged(FALSE),
 	mVOCloudsp(NULL)
 {
 }
@@ -117,6 +126,20 @@ void LLCloudGroup::updatePuffs(const F32 dt)
 		gPipeline.createObject(mVOCloudsp);
 	}
 
+	mPendingTime += dt;
+	mPendingFrames++;
+	mMoved = FALSE;
+	if (mPendingFrames < CLOUD_HIDDEN_UPDATE_FRAMES && !isVisible())
+	{
+		return;
+	}
+
+	static F32* sCloudVelocityScale = rebind_llcontrol<F32>("CloudVelocityScale", &gSavedSettings, true);
+	static F32* sCloudUpdateRate = rebind_llcontrol<F32>("CloudUpdateRate", &gSavedSettings, true);
+
+	// Puffs move by a step per frame, so skipped frames are made up here
+	const F32 velocity_scale = (*sCloudVelocityScale/100)*(*sCloudUpdateRate)*mPendingFrames;
+
 	LLVector3 velocity;
 	LLVector3d vel_d;
 	// Update the positions of all of the clouds
@@ -124,17 +147,40 @@ void LLCloudGroup::updatePuffs(const F32 dt)
 	{
 		LLCloudPuff &puff = mCloudPuffs[i];
 		velocity = mCloudLayerp->getRegion()->mWind.getCloudVelocity(mCloudLayerp->getRegion()->getPosRegionFromGlobal(puff.mPositionGlobal));
-		velocity *= (gSavedSettings.getF32("CloudVelocityScale")/100)*gSavedSettings.getF32("CloudUpdateRate");
+		velocity *= velocity_scale;
 		vel_d.setVec(velocity);
 		mCloudPuffs[i].mPositionGlobal += vel_d;
-		mCloudPuffs[i].mAlpha += mCloudPuffs[i].mRate * dt;
+		mCloudPuffs[i].mAlpha += mCloudPuffs[i].mRate * mPendingTime;
 		mCloudPuffs[i].mAlpha = llmin(1.f, mCloudPuffs[i].mAlpha);
 		mCloudPuffs[i].mAlpha = llmax(0.f, mCloudPuffs[i].mAlpha);
 	}
+
+	mPendingTime = 0.f;
+	mPendingFrames = 0;
+	mMoved = TRUE;
+	mChanged |= !mCloudPuffs.empty();
+}
+
+BOOL LLCloudGroup::isVisible() const
+{
+	return mVOCloudsp && mVOCloudsp->mDrawable.notNull() && mVOCloudsp->mDrawable->isVisible();
+}
+
+BOOL LLCloudGroup::takeChanged()
+{
+	BOOL changed = mChanged;
+	mChanged = FALSE;
+	return changed;
 }
 
 void LLCloudGroup::updatePuffOwnership()
 {
+	if (!mMoved)
+	{
+		// Puffs handed to this group were placed in it
+		return;
+	}
+
 	U32 i = 0;
 	while (i < mCloudPuffs.size())
 	{
@@ -165,6 +211,8 @@ void LLCloudGroup::updatePuffOwnership()
 		puff.mAlpha = mCloudPuffs[i].mAlpha;
 		mCloudPuffs.erase(mCloudPuffs.begin() + i);
 		new_cgp->mCloudPuffs.push_back(puff);
+		new_cgp->mChanged = TRUE;
+		mChanged = TRUE;
 	}
 
 	//llinfos << "Puff count: " << LLCloudPuff::sPuffCount << llendl;
@@ -176,16 +224,20 @@ void LLCloudGroup::updatePuffCount()
 	{
 		return;
 	}
+	static F32* sCloudDensity = rebind_llcontrol<F32>("CloudDensity", &gSavedSettings, true);
+	static F32* sCloudCountMax = rebind_llcontrol<F32>("CloudCountMax", &gSavedSettings, true);
+
 	S32 i;
-	S32 target_puff_count = llround((S32)gSavedSettings.getF32("CloudDensity") * mDensity);
+	S32 target_puff_count = llround((S32)*sCloudDensity * mDensity);
 	target_puff_count = llmax(0, target_puff_count);
-	target_puff_count = llmin((S32)gSavedSettings.getF32("CloudCountMax"), target_puff_count);
+	target_puff_count = llmin((S32)*sCloudCountMax, target_puff_count);
 	S32 current_puff_count = (S32) mCloudPuffs.size();
 	// Create a new cloud if we need one
 	if (current_puff_count < target_puff_count)
 	{
 		LLVector3d puff_pos_global;
 		mCloudPuffs.resize(target_puff_count);
+		mChanged = TRUE;
 		for (i = current_puff_count; i < target_puff_count; i++)
 		{
 			puff_pos_global = mVOCloudsp->getPositionGlobal();
@@ -234,6 +286,7 @@ void LLCloudGroup::updatePuffCount()
 			//llinfos << "Removing dead puff!" << llendl;
 			mCloudPuffs.erase(mCloudPuffs.begin() + i);
 			LLCloudPuff::sPuffCount--;
+			mChanged = TRUE;
 		}
 		else
 		{
@@ -269,7 +322,8 @@ LLCloudLayer::LLCloudLayer()
 	mMetersPerEdge(1.0f),
 	mMetersPerGrid(1.0f),
 	mWindp(NULL),
-	mDensityp(NULL)
+	mDensityp(NULL),
+	mDecodePending(FALSE)
 {
 	S32 i, j;
 	for (i = 0; i < 4; i++)
@@ -311,6 +365,7 @@ void LLCloudLayer::create(LLViewerRegion *regionp)
 	{
 		mDensityp[i] = 0.f;
 	}
+	mDecodePending = FALSE;
 }
 
 void LLCloudLayer::setRegion(LLViewerRegion *regionp)
@@ -331,9 +386,10 @@ void LLCloudLayer::destroy()
 		}
 	}
 
+	setWindPointer(NULL);
 	delete [] mDensityp;
 	mDensityp = NULL;
-	mWindp = NULL;
+	mDecodePending = FALSE;
 }
 
 void LLCloudLayer::reset()
@@ -344,12 +400,12 @@ void LLCloudLayer::setWindPointer(LLWind *windp)
 {
 	if (mWindp)
 	{
-		mWindp->setCloudDensityPointer(NULL);
+		mWindp->setCloudLayer(NULL);
 	}
 	mWindp = windp;
 	if (mWindp)
 	{
-		mWindp->setCloudDensityPointer(mDensityp);
+		mWindp->setCloudLayer(this);
 	}
 }
 
@@ -361,8 +417,22 @@ void LLCloudLayer::setWidth(F32 width)
 }
 
 
+const F32* LLCloudLayer::getDensityGrid()
+{
+	if (mDecodePending)
+	{
+		decode();
+	}
+	return mDensityp;
+}
+
 F32 LLCloudLayer::getDensityRegion(const LLVector3 &pos_region)
 {	
+	if (mDecodePending)
+	{
+		decode();
+	}
+
 	// "position" is region-local
 	S32 i, j, ii, jj;
 
@@ -418,18 +488,35 @@ F32 LLCloudLayer::getDensityRegion(const LLVector3 &pos_region)
 
 void LLCloudLayer::decompress(LLBitPack &bitpack, LLGroupHeader *group_headerp)
 {
-	LLPatchHeader  patch_header;
+	if (!mDensityp || group_headerp->patch_size != CLOUD_GRIDS_PER_EDGE)
+	{
+		return;
+	}
+
+	mPatch.unpack(bitpack, *group_headerp);
+
+	mDecodePending = TRUE;
+	if (mWindp)
+	{
+		mWindp->setCloudDensityChanged();
+	}
+}
+
+void LLCloudLayer::decode()
+{
+	LLTimer timer;
 
-	init_patch_decompressor(group_headerp->patch_size);
+	mPatch.decompress(mDensityp);
+	mDecodePending = FALSE;
 
-	// Don't use the packed group_header stride because the strides used on
-	// simulator and viewer are not equal.
-	group_headerp->stride = group_headerp->patch_size; 		// offset required to step up one row
-	set_group_of_patch_header(group_headerp);
+	sFrameCost += timer.getElapsedTimeF32();
+}
 
-	decode_patch_header(bitpack, &patch_header, FALSE);
-	decode_patch(bitpack, gBuffer);
-	decompress_patch(mDensityp, gBuffer, &patch_header); 
+//static
+BOOL LLCloudLayer::useClassicClouds()
+{
+	static BOOL* sSkyUseClassicClouds = rebind_llcontrol<BOOL>("SkyUseClassicClouds", &gSavedSettings, true);
+	return *sSkyUseClassicClouds && gHippoLimits->skyUseClassicClouds;
 }
 
 void LLCloudLayer::updatePuffs(const F32 dt)
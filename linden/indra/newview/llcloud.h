@@ -74,6 +74,8 @@
 #include "v4color.h"
 #include "llmemory.h"
 #include "lldarray.h"
+#include "llstat.h"
+#include "llcompressedpatch.h"
 
 #include "llframetimer.h"
 
@@ -87,7 +89,6 @@ class LLVOClouds;
 class LLViewerRegion;
 class LLCloudLayer;
 class LLBitPack;
-class LLGroupHeader;
 
 const S32 CLOUD_GROUPS_PER_EDGE = 4;
 
@@ -133,6 +134,12 @@ public:
 
 	BOOL inGroup(const LLCloudPuff &puff) const;
 
+	// Whether the puffs were drawn last frame
+	BOOL isVisible() const;
+
+	// Returns TRUE once after the puffs moved or were added or removed
+	BOOL takeChanged();
+
 	F32 getDensity() const							{ return mDensity; }
 	S32 getNumPuffs() const							{ return (S32) mCloudPuffs.size(); }
 	const LLCloudPuff &getPuff(const S32 i)			{ return mCloudPuffs[i]; }
@@ -142,6 +149,13 @@ protected:
 	F32 mDensity;
 	S32 mTargetPuffCount;
 
+	// Groups out of view move their puffs every CLOUD_HIDDEN_UPDATE_FRAMES
+	// frames, by the time and frames gathered since
+	F32 mPendingTime;
+	S32 mPendingFrames;
+	BOOL mMoved;			// this frame
+	BOOL mChanged;			// since the puff geometry was last built
+
 	std::vector<LLCloudPuff> mCloudPuffs;
 	LLPointer<LLVOClouds> mVOCloudsp;
 };
@@ -176,6 +190,11 @@ public:
 
 	F32 getDensityRegion(const LLVector3 &pos_region);		// "position" is in local coordinates
 
+	// The whole density grid, NULL before create()
+	const F32* getDensityGrid();
+
+	// Keeps the packet's coefficients, the grid is decoded the first time
+	// it is sampled
 	void decompress(LLBitPack &bitpack, LLGroupHeader *group_header);
 
 	LLCloudLayer* getNeighbor(const S32 n) const					{ return mNeighbors[n]; }
@@ -184,6 +203,15 @@ public:
 	void disconnectNeighbor(U32 direction);
 	void disconnectAllNeighbors();
 
+	// SkyUseClassicClouds, unless the grid turned classic clouds off
+	static BOOL useClassicClouds();
+
+	// Seconds spent decoding and updating wind and cloud fields this frame,
+	// summed over every region.  sCostStat gets the mean over the active
+	// regions in milliseconds, so one busy region shows up diluted.
+	static F32 sFrameCost;
+	static LLStat sCostStat;
+
 public:
 	LLVector3d 	mOriginGlobal;
 	F32			mMetersPerEdge;
@@ -197,6 +225,12 @@ protected:
 	LLWind				*mWindp;
 	LLViewerRegion		*mRegionp;
 	F32 				*mDensityp;			// the probability density grid
+
+	// The last packet, until something samples the grid
+	BOOL				mDecodePending;
+	LLCompressedPatch	mPatch;
+
+	void decode();
 	
 	LLCloudGroup		mCloudGroups[CLOUD_GROUPS_PER_EDGE][CLOUD_GROUPS_PER_EDGE];
 };
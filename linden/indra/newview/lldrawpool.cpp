@@ -448,14 +448,76 @@ void LLRenderPass::renderTexture(U32 type, U32 mask)
 	pushBatches(type, mask, TRUE);
 }
 
+// TRUE if next can be drawn by the same call as params, once params covers
+// count indices
+static BOOL can_merge_batches(const LLDrawInfo& params, U32 count, const LLDrawInfo& next)
+{
+	return next.mOffset == params.mOffset + count &&
+		next.mVertexBuffer == params.mVertexBuffer &&
+		next.mTexture == params.mTexture &&
+		next.mTextureMatrix == params.mTextureMatrix &&
+		next.mModelMatrix == params.mModelMatrix &&
+		next.mGlowColor == params.mGlowColor;
+}
+
 void LLRenderPass::pushBatches(U32 type, U32 mask, BOOL texture)
 {
-	for (LLCullResult::drawinfo_list_t::iterator i = gPipeline.beginRenderMap(type); i != gPipeline.endRenderMap(type); ++i)	
+	static LLCachedControl<BOOL> merge_batches("RenderMergeBatches", TRUE);
+
+	// The render map is sorted by texture, matrices, vertex buffer and then
+	// index offset (see LLDrawInfo::CompareRenderState), so batches that
+	// continue each other's index range with the same state are adjacent.
+	// They are drawn with one call.
+	LLViewerImage* last_texture = NULL;
+	LLCullResult::drawinfo_list_t::iterator end = gPipeline.endRenderMap(type);
+	LLCullResult::drawinfo_list_t::iterator i = gPipeline.beginRenderMap(type);
+	while (i != end)
 	{
-		LLDrawInfo* pparams = *i;
-		if (pparams) 
+		LLDrawInfo* pparams = *i++;
+		if (!pparams)
 		{
-			pushBatch(*pparams, mask, texture);
+			continue;
+		}
+		LLDrawInfo& params = *pparams;
+
+		if (texture && params.mTexture.get() != last_texture)
+		{
+			last_texture = params.mTexture.get();
+			gPipeline.mBatchTextureBinds++;
+		}
+
+		U16 start = params.mStart;
+		U16 end_vert = params.mEnd;
+		U32 count = params.mCount;
+		if (merge_batches)
+		{
+			while (i != end && *i && can_merge_batches(params, count, **i))
+			{
+				start = llmin(start, (*i)->mStart);
+				end_vert = llmax(end_vert, (*i)->mEnd);
+				count += (*i)->mCount;
+				gPipeline.mBatchesMerged++;
+				++i;
+			}
+		}
+
+		if (count == params.mCount)
+		{
+			pushBatch(params, mask, texture);
+		}
+		else
+		{
+			// draw the merged range through the first batch
+			U16 saved_start = params.mStart;
+			U16 saved_end = params.mEnd;
+			U32 saved_count = params.mCount;
+			params.mStart = start;
+			params.mEnd = end_vert;
+			params.mCount = count;
+			pushBatch(params, mask, texture);
+			params.mStart = saved_start;
+			params.mEnd = saved_end;
+			params.mCount = saved_count;
 		}
 	}
 }
@@ -54,6 +54,7 @@
 #include "llviewerregion.h"
 #include "lldrawpoolwater.h"
 #include "llspatialpartition.h"
+#include "llvopartgroup.h"
 
 BOOL LLDrawPoolAlpha::sShowDebugAlpha = FALSE;
 
@@ -61,7 +62,8 @@ static BOOL deferred_render = FALSE;
 
 LLDrawPoolAlpha::LLDrawPoolAlpha(U32 type) :
 		LLRenderPass(type), current_shader(NULL), target_shader(NULL),
-		simple_shader(NULL), fullbright_shader(NULL)
+		simple_shader(NULL), fullbright_shader(NULL),
+		particle_shader(NULL), particle_fullbright_shader(NULL)
 {
 
 }
@@ -145,11 +147,15 @@ void LLDrawPoolAlpha::beginRenderPass(S32 pass)
 	{
 		simple_shader = &gObjectSimpleWaterProgram;
 		fullbright_shader = &gObjectFullbrightWaterProgram;
+		particle_shader = &gParticleWaterProgram;
+		particle_fullbright_shader = &gParticleFullbrightWaterProgram;
 	}
 	else
 	{
 		simple_shader = &gObjectSimpleProgram;
 		fullbright_shader = &gObjectFullbrightProgram;
+		particle_shader = &gParticleProgram;
+		particle_fullbright_shader = &gParticleFullbrightProgram;
 	}
 
 	if (mVertexShaderLevel > 0)
@@ -289,6 +295,13 @@ void LLDrawPoolAlpha::renderAlpha(U32 mask)
 			{
 				LLDrawInfo& params = **k;
 
+				if (params.mParticle && (deferred_render || !use_shaders))
+				{
+					// instanced particles need the particle shaders, the
+					// group is rebuilt expanded once they are gone
+					continue;
+				}
+
 				LLRenderPass::applyModelMatrix(params);
 
 				if (params.mTexture.notNull())
@@ -336,6 +349,20 @@ void LLDrawPoolAlpha::renderAlpha(U32 mask)
 					light_enabled = TRUE;
 				}
 
+				if (use_shaders)
+				{
+					// the lighting state above only changes on a switch,
+					// the particle programs come and go per draw
+					if (params.mParticle)
+					{
+						target_shader = params.mFullbright ? particle_fullbright_shader : particle_shader;
+					}
+					else
+					{
+						target_shader = params.mFullbright ? fullbright_shader : simple_shader;
+					}
+				}
+
 				// If we need shaders, and we're not ALREADY using the proper shader, then bind it
 				// (this way we won't rebind shaders unnecessarily).
 				if(use_shaders && (current_shader != target_shader))
@@ -369,9 +396,17 @@ void LLDrawPoolAlpha::renderAlpha(U32 mask)
 				{
 					params.mGroup->rebuildMesh();
 				}
-				params.mVertexBuffer->setBuffer(mask);
-				params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
-				gPipeline.addTrianglesDrawn(params.mCount/3);
+				if (params.mParticle)
+				{
+					LLVOPartGroup::pushInstances(params, current_shader);
+					gPipeline.addTrianglesDrawn(params.mCount*2);
+				}
+				else
+				{
+					params.mVertexBuffer->setBuffer(mask);
+					params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+					gPipeline.addTrianglesDrawn(params.mCount/3);
+				}
 
 				if (params.mTextureMatrix && params.mTexture.notNull())
 				{
@@ -83,6 +83,8 @@ private:
 	LLGLSLShader* target_shader;
 	LLGLSLShader* simple_shader;
 	LLGLSLShader* fullbright_shader;	
+	LLGLSLShader* particle_shader;
+	LLGLSLShader* particle_fullbright_shader;
 };
 
 class LLDrawPoolAlphaPostWater : public LLDrawPoolAlpha
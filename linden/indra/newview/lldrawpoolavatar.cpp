@@ -41,6 +41,7 @@
 #include "llagent.h"
 #include "lldrawable.h"
 #include "llface.h"
+#include "llimpostoratlas.h"
 #include "llsky.h"
 #include "llviewercamera.h"
 #include "llviewerregion.h"
@@ -399,6 +400,7 @@ void LLDrawPoolAvatar::beginFootShadow()
 
 void LLDrawPoolAvatar::endFootShadow()
 {
+	LLImpostorAtlas::getInstance()->renderQuads();
 	gPipeline.enableLightsDynamic();
 }
 
@@ -453,6 +455,7 @@ void LLDrawPoolAvatar::beginDeferredImpostor()
 
 void LLDrawPoolAvatar::endDeferredImpostor()
 {
+	LLImpostorAtlas::getInstance()->renderQuads(normal_channel, specular_channel);
 	sShaderLevel = mVertexShaderLevel;
 	sVertexProgram->disableTexture(LLViewerShaderMgr::DEFERRED_NORMAL);
 	sVertexProgram->disableTexture(LLViewerShaderMgr::SPECULAR_MAP);
@@ -688,17 +691,6 @@ void LLDrawPoolAvatar::renderAvatars(LLVOAvatar* single_avatar, S32 pass)
 
 		if (impostor)
 		{
-			if (LLPipeline::sRenderDeferred && avatarp->mImpostor.isComplete()) 
-			{
-				if (normal_channel > -1)
-				{
-					avatarp->mImpostor.bindTexture(2, normal_channel);
-				}
-				if (specular_channel > -1)
-				{
-					avatarp->mImpostor.bindTexture(1, specular_channel);
-				}
-			}
 			avatarp->renderImpostor();
 		}
 		else if (gPipeline.hasRenderDebugFeatureMask(LLPipeline::RENDER_DEBUG_FEATURE_FOOT_SHADOWS) && !LLPipeline::sRenderDeferred)
@@ -794,6 +786,7 @@ void LLDrawPoolAvatar::renderForSelect()
 		gGL.getTexUnit(0)->setTextureAlphaBlend(LLTexUnit::TBO_MULT, LLTexUnit::TBS_TEX_ALPHA, LLTexUnit::TBS_VERT_ALPHA);
 
 		avatarp->renderImpostor(color);
+		LLImpostorAtlas::getInstance()->renderQuads();
 
 		gGL.getTexUnit(0)->setTextureBlendType(LLTexUnit::TB_MULT);
 		return;
@@ -873,7 +866,7 @@ void LLVertexBufferAvatar::setupVertexBuffer(U32 data_mask) const
 {
 	if (sRenderingSkinned)
 	{
-		U8* base = useVBOs() ? NULL : mMappedData;
+		U8* base = getVerticesPointer();
 
 		glVertexPointer(3,GL_FLOAT, mStride, (void*)(base + 0));
 		glNormalPointer(GL_FLOAT, mStride, (void*)(base + mOffsets[TYPE_NORMAL]));
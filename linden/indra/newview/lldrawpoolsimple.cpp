@@ -241,7 +241,9 @@ void LLDrawPoolGrass::render(S32 pass)
 		LLGLEnable test(GL_ALPHA_TEST);
 		gGL.setSceneBlendType(LLRender::BT_ALPHA);
 		//render grass
+		const S32 draw_calls = gPipeline.mDrawCalls;
 		LLRenderPass::renderTexture(LLRenderPass::PASS_GRASS, getVertexDataMask());
+		gPipeline.mVegetationDrawCalls += gPipeline.mDrawCalls - draw_calls;
 	}			
 
 	gGL.setAlphaRejectSettings(LLRender::CF_DEFAULT);
@@ -266,7 +268,9 @@ void LLDrawPoolGrass::renderDeferred(S32 pass)
 		gDeferredTreeProgram.bind();
 		LLGLEnable test(GL_ALPHA_TEST);
 		//render grass
+		const S32 draw_calls = gPipeline.mDrawCalls;
 		LLRenderPass::renderTexture(LLRenderPass::PASS_GRASS, getVertexDataMask());
+		gPipeline.mVegetationDrawCalls += gPipeline.mDrawCalls - draw_calls;
 	}			
 
 	gGL.setAlphaRejectSettings(LLRender::CF_DEFAULT);
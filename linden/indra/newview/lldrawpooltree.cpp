@@ -50,7 +50,8 @@ static LLGLSLShader* shader = NULL;
 
 LLDrawPoolTree::LLDrawPoolTree(LLViewerImage *texturep) :
 	LLFacePool(POOL_TREE),
-	mTexturep(texturep)
+	mTexturep(texturep),
+	mInstanced(FALSE)
 {
 	gGL.getTexUnit(0)->bind(mTexturep.get());
 	mTexturep->setAddressMode(LLTexUnit::TAM_WRAP);
@@ -71,7 +72,13 @@ void LLDrawPoolTree::beginRenderPass(S32 pass)
 	LLFastTimer t(LLFastTimer::FTM_RENDER_TREES);
 	gGL.setAlphaRejectSettings(LLRender::CF_GREATER, 0.5f);
 	
-	if (LLPipeline::sUnderWaterRender)
+	mInstanced = useInstancing();
+
+	if (mInstanced)
+	{
+		shader = LLPipeline::sUnderWaterRender ? &gTreeInstanceWaterProgram : &gTreeInstanceProgram;
+	}
+	else if (LLPipeline::sUnderWaterRender)
 	{
 		shader = &gObjectSimpleWaterProgram;
 	}
@@ -101,10 +108,15 @@ void LLDrawPoolTree::render(S32 pass)
 
 	LLGLEnable test(GL_ALPHA_TEST);
 	LLOverrideFaceColor color(this, 1.f, 1.f, 1.f, 1.f);
+	const S32 draw_calls = gPipeline.mDrawCalls;
 
 	static BOOL* sRenderAnimateTrees = rebind_llcontrol<BOOL>("RenderAnimateTrees", &gSavedSettings, true);
 	
-	if (*sRenderAnimateTrees)
+	if (mInstanced)
+	{
+		renderInstanced();
+	}
+	else if (*sRenderAnimateTrees)
 	{
 		renderTree();
 	}
@@ -121,12 +133,15 @@ void LLDrawPoolTree::render(S32 pass)
 			gPipeline.addTrianglesDrawn(face->mVertexBuffer->getRequestedIndices()/3);
 		}
 	}
+
+	gPipeline.mVegetationDrawCalls += gPipeline.mDrawCalls - draw_calls;
 }
 
 void LLDrawPoolTree::endRenderPass(S32 pass)
 {
 	LLFastTimer t(LLFastTimer::FTM_RENDER_TREES);
 	gGL.setAlphaRejectSettings(LLRender::CF_DEFAULT);
+	mInstanced = FALSE;
 	
 	if (gPipeline.canUseWindLightShadersOnObjects())
 	{
@@ -246,6 +261,28 @@ void LLDrawPoolTree::renderForSelect()
 	gGL.getTexUnit(0)->setTextureBlendType(LLTexUnit::TB_MULT);
 }
 
+//static
+BOOL LLDrawPoolTree::getTreeLOD(LLVOTree* treep, S32& trunk_LOD)
+{
+	const F32 THRESH_ANGLE_FOR_BILLBOARD = 15.f;
+	const F32 BLEND_RANGE_FOR_BILLBOARD = 3.f;
+
+	F32 app_angle = treep->getAppAngle()*LLVOTree::sTreeFactor;
+	trunk_LOD = 0;
+
+	for (S32 j = 0; j < 4; j++)
+	{
+
+		if (app_angle > LLVOTree::sLODAngles[j])
+		{
+			trunk_LOD = j;
+			break;
+		}
+	} 
+
+	return app_angle < (THRESH_ANGLE_FOR_BILLBOARD - BLEND_RANGE_FOR_BILLBOARD);
+}
+
 void LLDrawPoolTree::renderTree(BOOL selecting)
 {
 	LLGLState normalize(GL_NORMALIZE, TRUE);
@@ -323,27 +360,13 @@ void LLDrawPoolTree::renderTree(BOOL selecting)
 
 			scale_mat *= rot_mat;
 
-			const F32 THRESH_ANGLE_FOR_BILLBOARD = 15.f;
-			const F32 BLEND_RANGE_FOR_BILLBOARD = 3.f;
-
 			F32 droop = treep->mDroop + 25.f*(1.f - treep->mTrunkBend.magVec());
 			
 			S32 stop_depth = 0;
-			F32 app_angle = treep->getAppAngle()*LLVOTree::sTreeFactor;
 			F32 alpha = 1.0;
 			S32 trunk_LOD = 0;
 
-			for (S32 j = 0; j < 4; j++)
-			{
-
-				if (app_angle > LLVOTree::sLODAngles[j])
-				{
-					trunk_LOD = j;
-					break;
-				}
-			} 
-
-			if (app_angle < (THRESH_ANGLE_FOR_BILLBOARD - BLEND_RANGE_FOR_BILLBOARD))
+			if (getTreeLOD(treep, trunk_LOD))
 			{
 				//
 				//  Draw only the billboard 
@@ -368,6 +391,132 @@ void LLDrawPoolTree::renderTree(BOOL selecting)
 	}
 }
 
+//static
+BOOL LLDrawPoolTree::useInstancing()
+{
+	static LLCachedControl<BOOL> tree_instancing("RenderTreeInstancing", TRUE);
+	static BOOL* sRenderAnimateTrees = rebind_llcontrol<BOOL>("RenderAnimateTrees", &gSavedSettings, true);
+	return tree_instancing
+		&& *sRenderAnimateTrees
+		&& gGLManager.mHasInstancedArrays
+		&& gTreeInstanceWaterProgram.mProgramObject
+		&& gPipeline.canUseWindLightShadersOnObjects()
+		&& !LLPipeline::sRenderDeferred;
+}
+
+void LLDrawPoolTree::renderInstanced()
+{
+	gGL.getTexUnit(sDiffTex)->bind(mTexturep.get(), TRUE);
+
+	// The camera is the only matrix left, branches carry their own
+	glMatrixMode(GL_MODELVIEW);
+	gGLLastMatrix = NULL;
+	glLoadMatrixd(gGLModelView);
+
+	for (std::vector<LLFace*>::iterator iter = mDrawFace.begin();
+		 iter != mDrawFace.end(); iter++)
+	{
+		LLFace *face = *iter;
+		LLDrawable *drawablep = face->getDrawable();
+
+		if (drawablep->isDead() || face->mVertexBuffer.isNull())
+		{
+			continue;
+		}
+
+		LLVOTree *treep = (LLVOTree *)drawablep->getVObj().get();
+
+		LLMatrix4 matrix;
+		treep->getBaseMatrix(matrix);
+
+		F32 droop = treep->mDroop + 25.f*(1.f - treep->mTrunkBend.magVec());
+		S32 trunk_LOD = 0;
+		S32 stop_depth = getTreeLOD(treep, trunk_LOD) ? -1 : 0;
+
+		InstanceBatch& batch = mBatches[face->mVertexBuffer];
+		treep->appendInstances(batch.mParts, matrix, trunk_LOD, stop_depth, treep->mDepth, treep->mTrunkDepth, 1.0, treep->mTwist, droop, treep->mBranches);
+	}
+
+	const GLint attribs[] =
+	{
+		shader->mAttribute[LLViewerShaderMgr::TREE_ROW0],
+		shader->mAttribute[LLViewerShaderMgr::TREE_ROW1],
+		shader->mAttribute[LLViewerShaderMgr::TREE_ROW2],
+		shader->mAttribute[LLViewerShaderMgr::TREE_TEX_OFFSET]
+	};
+	const S32 count = LL_ARRAY_SIZE(attribs);
+	const S32 stride = sizeof(LLTreeInstance);
+
+	batch_map_t::iterator iter = mBatches.begin();
+	while (iter != mBatches.end())
+	{
+		LLVertexBuffer* buffer = iter->first;
+		InstanceBatch& batch = iter->second;
+		BOOL empty = TRUE;
+
+		for (S32 part = 0; part < LLVOTree::NUM_INSTANCE_PARTS; part++)
+		{
+			std::vector<LLTreeInstance>& instances = batch.mParts[part];
+			if (instances.empty())
+			{
+				continue;
+			}
+			empty = FALSE;
+
+			// The records stay in client memory, nothing may be bound
+			// while their pointers are set
+			LLVertexBuffer::unbind();
+			const F32* base = instances[0].mRows[0];
+			glVertexAttribPointerARB(attribs[0], 4, GL_FLOAT, GL_FALSE, stride, base);
+			glVertexAttribPointerARB(attribs[1], 4, GL_FLOAT, GL_FALSE, stride, base + 4);
+			glVertexAttribPointerARB(attribs[2], 4, GL_FLOAT, GL_FALSE, stride, base + 8);
+			glVertexAttribPointerARB(attribs[3], 1, GL_FLOAT, GL_FALSE, stride, &instances[0].mTexOffset);
+			for (S32 i = 0; i < count; i++)
+			{
+				glEnableVertexAttribArrayARB(attribs[i]);
+				ll_glVertexAttribDivisorARB(attribs[i], 1);
+			}
+
+			buffer->setBuffer(LLDrawPoolTree::VERTEX_DATA_MASK);
+			U16* indicesp = (U16*) buffer->getIndicesPointer();
+
+			S32 offset = 0;
+			S32 index_count = LLVOTree::LEAF_INDICES;
+			if (part != LLVOTree::INSTANCE_LEAF)
+			{
+				S32 lod = part - LLVOTree::INSTANCE_TRUNK;
+				offset = LLVOTree::sLODIndexOffset[lod];
+				index_count = LLVOTree::sLODIndexCount[lod];
+			}
+
+			stop_glerror();
+			ll_glDrawElementsInstancedARB(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, indicesp + offset, instances.size());
+			stop_glerror();
+			gPipeline.addTrianglesDrawn(index_count/3 * instances.size());
+
+			for (S32 i = 0; i < count; i++)
+			{
+				ll_glVertexAttribDivisorARB(attribs[i], 0);
+				glDisableVertexAttribArrayARB(attribs[i]);
+			}
+
+			instances.clear();
+		}
+
+		if (empty)
+		{
+			// The species mesh was not drawn last frame either
+			mBatches.erase(iter++);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+
+	LLVertexBuffer::unbind();
+}
+
 BOOL LLDrawPoolTree::verify() const
 {
 /*	BOOL ok = TRUE;
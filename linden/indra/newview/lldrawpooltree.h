@@ -34,6 +34,7 @@
 #define LL_LLDRAWPOOLTREE_H
 
 #include "lldrawpool.h"
+#include "llvotree.h"
 
 class LLDrawPoolTree : public LLFacePool
 {
@@ -76,8 +77,27 @@ public:
 
 	static S32 sDiffTex;
 
+	// Draw every branch of a species with the same LOD in one instanced call
+	static BOOL useInstancing();
+
 private:
 	void renderTree(BOOL selecting = FALSE);
+	void renderInstanced();
+
+	// Returns TRUE when the tree is only drawn as a billboard
+	static BOOL getTreeLOD(LLVOTree* treep, S32& trunk_LOD);
+
+	struct InstanceBatch
+	{
+		std::vector<LLTreeInstance> mParts[LLVOTree::NUM_INSTANCE_PARTS];
+	};
+
+	// Instances collected per species mesh, kept from frame to frame so the
+	// vectors keep their storage
+	typedef std::map<LLVertexBuffer*, InstanceBatch> batch_map_t;
+	batch_map_t mBatches;
+
+	BOOL mInstanced;
 };
 
 #endif // LL_LLDRAWPOOLTREE_H
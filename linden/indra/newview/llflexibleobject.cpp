@@ -36,6 +36,7 @@
 #include "lldrawpoolbump.h"
 #include "llface.h"
 #include "llflexibleobject.h"
+#include "llflexiblesolver.h"
 #include "llglheaders.h"
 #include "llrendersphere.h"
 #include "llviewerobject.h"
@@ -51,6 +52,7 @@
 #include "llvoavatar.h"
 
 /*static*/ F32 LLVolumeImplFlexible::sUpdateFactor = 1.0f;
+/*static*/ LLVolumeImplFlexible::flexible_list_t LLVolumeImplFlexible::sBatch;
 
 // LLFlexibleObjectData::pack/unpack now in llprimitive.cpp
 
@@ -64,6 +66,8 @@ LLVolumeImplFlexible::LLVolumeImplFlexible(LLViewerObject* vo, LLFlexibleObjectD
 	mID = seed++;
 	mInitialized = FALSE;
 	mUpdated = FALSE;
+	mInBatch = FALSE;
+	mStepped = FALSE;
 	mInitializedRes = -1;
 	mSimulateRes = 0;
 	mFrameNum = 0;
@@ -75,6 +79,18 @@ LLVolumeImplFlexible::LLVolumeImplFlexible(LLViewerObject* vo, LLFlexibleObjectD
 	}
 }//-----------------------------------------------
 
+LLVolumeImplFlexible::~LLVolumeImplFlexible()
+{
+	if (mInBatch)
+	{
+		flexible_list_t::iterator iter = std::find(sBatch.begin(), sBatch.end(), this);
+		if (iter != sBatch.end())
+		{
+			sBatch.erase(iter);
+		}
+	}
+}
+
 LLVector3 LLVolumeImplFlexible::getFramePosition() const
 {
 	return mVO->getRenderPosition();
@@ -343,6 +359,13 @@ BOOL LLVolumeImplFlexible::doIdleUpdate(LLAgent &agent, LLWorld &world, const F6
 		if ((LLDrawable::getCurrentFrame()+id)%update_period == 0)
 		{
 			gPipeline.markRebuild(mVO->mDrawable, LLDrawable::REBUILD_POSITION, FALSE);
+
+			static LLCachedControl<BOOL> batch_solver("RenderFlexiBatchSolver", TRUE);
+			if (batch_solver && !mInBatch && !mStepped)
+			{
+				sBatch.push_back(this);
+				mInBatch = TRUE;
+			}
 		}
 	}
 	
@@ -362,8 +385,6 @@ inline S32 log2(S32 x)
 
 void LLVolumeImplFlexible::doFlexibleUpdate()
 {
-	LLVolume* volume = mVO->getVolume();
-	LLPath *path = &volume->getPath();
 	if (mSimulateRes == 0)
 	{
 		mVO->markForUpdate(TRUE);
@@ -374,7 +395,28 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 	}
 
 	llassert_always(mInitialized);
-	
+
+	if (mStepped)
+	{
+		// updateClass() already stepped us this frame
+		mStepped = FALSE;
+	}
+	else
+	{
+		LLFlexibleChain chain;
+		prepareChain(chain);
+		LLFlexibleSolver::solveChain(chain);
+		mLastSegmentRotation = chain.mLastSegmentRotation;
+	}
+
+	finishFlexibleUpdate();
+}
+
+// Anchors section 0 and works out this step's coefficients and forces.
+// Everything that reads the object, its region or the wind happens here,
+// on the main thread.
+void LLVolumeImplFlexible::prepareChain(LLFlexibleChain& chain)
+{
 	S32 num_sections = 1 << mSimulateRes;
 
     F32 secondsThisFrame = mTimer.getElapsedTimeAndResetF32();
@@ -385,14 +427,10 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 
 	LLVector3 BasePosition = getFramePosition();
 	LLQuaternion BaseRotation = getFrameRotation();
-	LLQuaternion parentSegmentRotation = BaseRotation;
-	LLVector3 anchorDirectionRotated = LLVector3::z_axis * parentSegmentRotation;
+	LLVector3 anchorDirectionRotated = LLVector3::z_axis * BaseRotation;
 	LLVector3 anchorScale = mVO->mDrawable->getScale();
 	
 	F32 section_length = anchorScale.mV[VZ] / (F32)num_sections;
-	F32 inv_section_length = 1.f / section_length;
-
-	S32 i;
 
 	// ANCHOR position is offset from BASE position (centroid) by half the length
 	LLVector3 AnchorPosition = BasePosition - (anchorScale.mV[VZ]/2 * anchorDirectionRotated);
@@ -401,10 +439,6 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 	mSection[0].mDirection = anchorDirectionRotated;
 	mSection[0].mRotation = BaseRotation;
 
-	LLQuaternion deltaRotation;
-
-	LLVector3 lastPosition;
-
 	// Coefficients which are constant across sections
 	F32 t_factor = mAttributes->getTension() * 0.1f;
 	t_factor = t_factor*(1 - pow(0.85f, secondsThisFrame*30));
@@ -423,134 +457,50 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 
 	F32 force_factor = section_length * secondsThisFrame;
 
-	// Update simulated sections
-	for (i=1; i<=num_sections; ++i)
-	{
-		LLVector3 parentSectionVector;
-		LLVector3 parentSectionPosition;
-		LLVector3 parentDirection;
+	chain.mSection = mSection;
+	chain.mSections = num_sections;
+	chain.mSectionLength = section_length;
+	chain.mTension = t_factor;
+	chain.mMomentum = momentum;
+	chain.mMaxAngle = max_angle;
+	chain.mBaseRotation = BaseRotation;
 
-		//---------------------------------------------------
-		// save value of position as lastPosition
-		//---------------------------------------------------
-		lastPosition = mSection[i].mPosition;
+	LLWind* wind = NULL;
+	if (mAttributes->getWindSensitivity() > 0.001f)
+	{
+		wind = &gAgent.getRegion()->mWind;
+	}
+	LLVector3 user_force = mAttributes->getUserForce() * force_factor;
 
-		//------------------------------------------------------------------------------------------
+	for (S32 i=1; i<=num_sections; ++i)
+	{
 		// gravity
-		//------------------------------------------------------------------------------------------
-		mSection[i].mPosition.mV[2] -= mAttributes->getGravity() * force_factor;
+		LLVector3 force(0.f, 0.f, -mAttributes->getGravity() * force_factor);
 
-		//------------------------------------------------------------------------------------------
-		// wind force
-		//------------------------------------------------------------------------------------------
-		if (mAttributes->getWindSensitivity() > 0.001f)
+		// wind force, sampled where gravity moved the section
+		if (wind)
 		{
-			mSection[i].mPosition += gAgent.getRegion()->mWind.getVelocity( mSection[i].mPosition ) * wind_factor;
+			force += wind->getVelocity( mSection[i].mPosition + force ) * wind_factor;
 		}
 
-		//------------------------------------------------------------------------------------------
 		// user-defined force
-		//------------------------------------------------------------------------------------------
-		mSection[i].mPosition += mAttributes->getUserForce() * force_factor;
-
-		//---------------------------------------------------
-		// tension (rigidity, stiffness)
-		//---------------------------------------------------
-		parentSectionPosition = mSection[i-1].mPosition;
-		parentDirection = mSection[i-1].mDirection;
+		force += user_force;
 
-		if ( i == 1 )
-		{
-			parentSectionVector = mSection[0].mDirection;
-		}
-		else
-		{
-			parentSectionVector = mSection[i-2].mDirection;
-		}
-
-		LLVector3 currentVector = mSection[i].mPosition - parentSectionPosition;
-
-		LLVector3 difference = (parentSectionVector*section_length) - currentVector;
-		LLVector3 tensionForce = difference * t_factor;
-
-		mSection[i].mPosition += tensionForce;
+		chain.mForce[i] = force;
+	}
+}
 
-		//------------------------------------------------------------------------------------------
-		// sphere collision, currently not used
-		//------------------------------------------------------------------------------------------
-		/*if ( mAttributes->mUsingCollisionSphere )
-		{
-			LLVector3 vectorToCenterOfCollisionSphere = mCollisionSpherePosition - mSection[i].mPosition;
-			if ( vectorToCenterOfCollisionSphere.magVecSquared() < mCollisionSphereRadius * mCollisionSphereRadius )
-			{
-				F32 distanceToCenterOfCollisionSphere = vectorToCenterOfCollisionSphere.magVec();
-				F32 penetration = mCollisionSphereRadius - distanceToCenterOfCollisionSphere;
-
-				LLVector3 normalToCenterOfCollisionSphere;
-				
-				if ( distanceToCenterOfCollisionSphere > 0.0f )
-				{
-					normalToCenterOfCollisionSphere = vectorToCenterOfCollisionSphere / distanceToCenterOfCollisionSphere;
-				}
-				else // rare
-				{
-					normalToCenterOfCollisionSphere = LLVector3::x_axis; // arbitrary
-				}
-
-				// push the position out to the surface of the collision sphere
-				mSection[i].mPosition -= normalToCenterOfCollisionSphere * penetration;
-			}
-		}*/
-
-		//------------------------------------------------------------------------------------------
-		// inertia
-		//------------------------------------------------------------------------------------------
-		mSection[i].mPosition += mSection[i].mVelocity * momentum;
-
-		//------------------------------------------------------------------------------------------
-		// clamp length & rotation
-		//------------------------------------------------------------------------------------------
-		mSection[i].mDirection = mSection[i].mPosition - parentSectionPosition;
-		mSection[i].mDirection.normVec();
-		deltaRotation.shortestArc( parentDirection, mSection[i].mDirection );
-
-		F32 angle;
-		LLVector3 axis;
-		deltaRotation.getAngleAxis(&angle, axis);
-		if (angle > F_PI) angle -= 2.f*F_PI;
-		if (angle < -F_PI) angle += 2.f*F_PI;
-		if (angle > max_angle)
-		{
-			//angle = 0.5f*(angle+max_angle);
-			deltaRotation.setQuat(max_angle, axis);
-		} else if (angle < -max_angle)
-		{
-			//angle = 0.5f*(angle-max_angle);
-			deltaRotation.setQuat(-max_angle, axis);
-		}
-		LLQuaternion segment_rotation = parentSegmentRotation * deltaRotation;
-		parentSegmentRotation = segment_rotation;
+void LLVolumeImplFlexible::finishFlexibleUpdate()
+{
+	LLVolume* volume = mVO->getVolume();
+	LLPath *path = &volume->getPath();
 
-		mSection[i].mDirection = (parentDirection * deltaRotation);
-		mSection[i].mPosition = parentSectionPosition + mSection[i].mDirection * section_length;
-		mSection[i].mRotation = segment_rotation;
+	S32 num_sections = 1 << mSimulateRes;
 
-		if (i > 1)
-		{
-			// Propogate half the rotation up to the parent
-			LLQuaternion halfDeltaRotation(angle/2, axis);
-			mSection[i-1].mRotation = mSection[i-1].mRotation * halfDeltaRotation;
-		}
+	F32 section_length = mVO->mDrawable->getScale().mV[VZ] / (F32)num_sections;
+	F32 inv_section_length = 1.f / section_length;
 
-		//------------------------------------------------------------------------------------------
-		// calculate velocity
-		//------------------------------------------------------------------------------------------
-		mSection[i].mVelocity = mSection[i].mPosition - lastPosition;
-		if (mSection[i].mVelocity.magVecSquared() > 1.f)
-		{
-			mSection[i].mVelocity.normVec();
-		}
-	}
+	S32 i;
 
 	// Calculate derivatives (not necessary until normals are automagically generated)
 	mSection[0].mdPosition = (mSection[1].mPosition - mSection[0].mPosition) * inv_section_length;
@@ -629,8 +579,55 @@ void LLVolumeImplFlexible::doFlexibleUpdate()
 		new_point->mScale = newSection[i].mScale;
 		new_point->mTexT = ((F32)i)/(num_render_sections);
 	}
+}
+
+//static
+void LLVolumeImplFlexible::updateClass()
+{
+	if (sBatch.empty())
+	{
+		return;
+	}
+
+	LLFastTimer ftm(LLFastTimer::FTM_FLEXIBLE_UPDATE);
 
-	mLastSegmentRotation = parentSegmentRotation;
+	static std::vector<LLFlexibleChain> chains;
+	static flexible_list_t stepped;
+	static std::vector<LLFlexibleChain*> chain_ptrs;
+	chains.resize(sBatch.size());
+	stepped.clear();
+	chain_ptrs.clear();
+
+	for (flexible_list_t::iterator iter = sBatch.begin(); iter != sBatch.end(); ++iter)
+	{
+		LLVolumeImplFlexible* flex = *iter;
+		flex->mInBatch = FALSE;
+
+		// only objects doUpdateGeometry() will get to this frame
+		LLDrawable* drawable = flex->mVO->mDrawable;
+		if (!drawable || drawable->isDead() ||
+			!drawable->isState(LLDrawable::IN_REBUILD_Q1 | LLDrawable::IN_REBUILD_Q2) ||
+			!flex->mInitialized || flex->mSimulateRes == 0 ||
+			flex->skipGeometryUpdate())
+		{
+			continue;
+		}
+
+		LLFlexibleChain& chain = chains[stepped.size()];
+		flex->prepareChain(chain);
+		chain_ptrs.push_back(&chain);
+		stepped.push_back(flex);
+	}
+	sBatch.clear();
+
+	static LLCachedControl<BOOL> threaded("ThreadedFlexiUpdate", TRUE);
+	LLFlexibleSolver::solve(chain_ptrs, threaded);
+
+	for (U32 i = 0; i < stepped.size(); ++i)
+	{
+		stepped[i]->mLastSegmentRotation = chains[i].mLastSegmentRotation;
+		stepped[i]->mStepped = TRUE;
+	}
 }
 
 void LLVolumeImplFlexible::preRebuild()
@@ -656,10 +653,8 @@ void LLVolumeImplFlexible::onSetScale(const LLVector3& scale, BOOL damped)
 	setAttributesOfAllSections((LLVector3*) &scale);
 }
 
-BOOL LLVolumeImplFlexible::doUpdateGeometry(LLDrawable *drawable)
+BOOL LLVolumeImplFlexible::skipGeometryUpdate() const
 {
-	LLVOVolume *volume = (LLVOVolume*)mVO;
-
 	if (mVO->isAttachment())
 	{	//don't update flexible attachments for impostored avatars unless the 
 		//impostor is being updated this frame (w00!)
@@ -678,6 +673,17 @@ BOOL LLVolumeImplFlexible::doUpdateGeometry(LLDrawable *drawable)
 			}
 		}
 	}
+	return FALSE;
+}
+
+BOOL LLVolumeImplFlexible::doUpdateGeometry(LLDrawable *drawable)
+{
+	LLVOVolume *volume = (LLVOVolume*)mVO;
+
+	if (skipGeometryUpdate())
+	{
+		return TRUE;
+	}
 
 	if (volume->mDrawable.isNull())
 	{
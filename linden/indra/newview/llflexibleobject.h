@@ -48,6 +48,8 @@
 #include "llvovolume.h"
 #include "llwind.h"
 
+#include <vector>
+
 // 10 ms for the whole thing!
 const F32	FLEXIBLE_OBJECT_TIMESLICE		= 0.003f;
 const U32	FLEXIBLE_OBJECT_MAX_LOD			= 10;
@@ -72,6 +74,8 @@ struct LLFlexibleObjectSection
 	//LLMatrix4		mdRotScale;
 };
 
+struct LLFlexibleChain;
+
 //---------------------------------------------------------
 // The LLVolumeImplFlexible class 
 //---------------------------------------------------------
@@ -79,6 +83,11 @@ class LLVolumeImplFlexible : public LLVolumeInterface
 {
 	public:
 		LLVolumeImplFlexible(LLViewerObject* volume, LLFlexibleObjectData* attributes);
+		~LLVolumeImplFlexible();
+
+		// Steps every flexible object marked for a position rebuild this
+		// frame in one batch, ahead of LLPipeline::updateGeom()
+		static void updateClass();
 
 		// Implements LLVolumeInterface
 		U32 getID() const { return mID; }
@@ -126,6 +135,8 @@ class LLVolumeImplFlexible : public LLVolumeInterface
 		LLQuaternion				mLastSegmentRotation;
 		BOOL						mInitialized;
 		BOOL						mUpdated;
+		BOOL						mInBatch;	// in sBatch
+		BOOL						mStepped;	// stepped by updateClass(), geometry not yet written
 		LLFlexibleObjectData*		mAttributes;
 		LLFlexibleObjectSection		mSection	[ (1<<FLEXIBLE_OBJECT_MAX_SECTIONS)+1 ];
 		S32							mInitializedRes;
@@ -141,6 +152,10 @@ class LLVolumeImplFlexible : public LLVolumeInterface
 		//--------------------------------------
 		void setAttributesOfAllSections	(LLVector3* inScale = NULL);
 
+		BOOL skipGeometryUpdate() const;
+		void prepareChain(LLFlexibleChain& chain);
+		void finishFlexibleUpdate();
+
 		void remapSections(LLFlexibleObjectSection *source, S32 source_sections,
 										 LLFlexibleObjectSection *dest, S32 dest_sections);
 		
@@ -148,6 +163,10 @@ public:
 		// Global setting for update rate
 		static F32					sUpdateFactor;
 
+private:
+		typedef std::vector<LLVolumeImplFlexible*> flexible_list_t;
+		static flexible_list_t		sBatch;
+
 };// end of class definition
 
 
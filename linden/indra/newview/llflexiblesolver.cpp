@@ -0,0 +1,557 @@
+/**
+ * @file llflexiblesolver.cpp
+ * @brief Steps the section chains of flexible prims in batches.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llflexiblesolver.h"
+
+#include "llrand.h"
+#include "llthreadpool.h"
+#include "lltimer.h"
+#include "llv4math.h"
+
+#include <algorithm>
+
+static const S32 MAX_SECTIONS = 1<<FLEXIBLE_OBJECT_MAX_SECTIONS;
+
+//static
+void LLFlexibleSolver::solveChain(LLFlexibleChain& chain)
+{
+	LLFlexibleObjectSection* section = chain.mSection;
+	const F32 section_length = chain.mSectionLength;
+	LLQuaternion parentSegmentRotation = chain.mBaseRotation;
+	LLQuaternion deltaRotation;
+	LLVector3 lastPosition;
+
+	for (S32 i = 1; i <= chain.mSections; ++i)
+	{
+		LLVector3 parentSectionVector;
+		LLVector3 parentSectionPosition;
+		LLVector3 parentDirection;
+
+		lastPosition = section[i].mPosition;
+
+		// gravity, wind and user force
+		section[i].mPosition += chain.mForce[i];
+
+		//---------------------------------------------------
+		// tension (rigidity, stiffness)
+		//---------------------------------------------------
+		parentSectionPosition = section[i-1].mPosition;
+		parentDirection = section[i-1].mDirection;
+
+		if ( i == 1 )
+		{
+			parentSectionVector = section[0].mDirection;
+		}
+		else
+		{
+			parentSectionVector = section[i-2].mDirection;
+		}
+
+		LLVector3 currentVector = section[i].mPosition - parentSectionPosition;
+
+		LLVector3 difference = (parentSectionVector*section_length) - currentVector;
+		LLVector3 tensionForce = difference * chain.mTension;
+
+		section[i].mPosition += tensionForce;
+
+		//------------------------------------------------------------------------------------------
+		// inertia
+		//------------------------------------------------------------------------------------------
+		section[i].mPosition += section[i].mVelocity * chain.mMomentum;
+
+		//------------------------------------------------------------------------------------------
+		// clamp length & rotation
+		//------------------------------------------------------------------------------------------
+		section[i].mDirection = section[i].mPosition - parentSectionPosition;
+		section[i].mDirection.normVec();
+		deltaRotation.shortestArc( parentDirection, section[i].mDirection );
+
+		F32 angle;
+		LLVector3 axis;
+		deltaRotation.getAngleAxis(&angle, axis);
+		if (angle > F_PI) angle -= 2.f*F_PI;
+		if (angle < -F_PI) angle += 2.f*F_PI;
+		if (angle > chain.mMaxAngle)
+		{
+			deltaRotation.setQuat(chain.mMaxAngle, axis);
+		} else if (angle < -chain.mMaxAngle)
+		{
+			deltaRotation.setQuat(-chain.mMaxAngle, axis);
+		}
+		LLQuaternion segment_rotation = parentSegmentRotation * deltaRotation;
+		parentSegmentRotation = segment_rotation;
+
+		section[i].mDirection = (parentDirection * deltaRotation);
+		section[i].mPosition = parentSectionPosition + section[i].mDirection * section_length;
+		section[i].mRotation = segment_rotation;
+
+		if (i > 1)
+		{
+			// Propogate half the rotation up to the parent
+			LLQuaternion halfDeltaRotation(angle/2, axis);
+			section[i-1].mRotation = section[i-1].mRotation * halfDeltaRotation;
+		}
+
+		//------------------------------------------------------------------------------------------
+		// calculate velocity
+		//------------------------------------------------------------------------------------------
+		section[i].mVelocity = section[i].mPosition - lastPosition;
+		if (section[i].mVelocity.magVecSquared() > 1.f)
+		{
+			section[i].mVelocity.normVec();
+		}
+	}
+
+	chain.mLastSegmentRotation = parentSegmentRotation;
+}
+
+#if LL_VECTORIZE
+namespace
+{
+	// Four chains side by side, one per lane
+	struct Vec4
+	{
+		__m128 x, y, z;
+	};
+
+	struct Quat4
+	{
+		__m128 x, y, z, w;
+	};
+
+	inline Vec4 gather(const LLVector3& a, const LLVector3& b, const LLVector3& c, const LLVector3& d)
+	{
+		Vec4 v;
+		v.x = _mm_set_ps(d.mV[VX], c.mV[VX], b.mV[VX], a.mV[VX]);
+		v.y = _mm_set_ps(d.mV[VY], c.mV[VY], b.mV[VY], a.mV[VY]);
+		v.z = _mm_set_ps(d.mV[VZ], c.mV[VZ], b.mV[VZ], a.mV[VZ]);
+		return v;
+	}
+
+	inline Quat4 gather(const LLQuaternion& a, const LLQuaternion& b, const LLQuaternion& c, const LLQuaternion& d)
+	{
+		Quat4 q;
+		q.x = _mm_set_ps(d.mQ[VX], c.mQ[VX], b.mQ[VX], a.mQ[VX]);
+		q.y = _mm_set_ps(d.mQ[VY], c.mQ[VY], b.mQ[VY], a.mQ[VY]);
+		q.z = _mm_set_ps(d.mQ[VZ], c.mQ[VZ], b.mQ[VZ], a.mQ[VZ]);
+		q.w = _mm_set_ps(d.mQ[VW], c.mQ[VW], b.mQ[VW], a.mQ[VW]);
+		return q;
+	}
+
+	inline void scatter(const Vec4& v, LLVector3* out[4])
+	{
+		F32 x[4], y[4], z[4];
+		_mm_storeu_ps(x, v.x);
+		_mm_storeu_ps(y, v.y);
+		_mm_storeu_ps(z, v.z);
+		for (S32 k = 0; k < 4; k++)
+		{
+			out[k]->setVec(x[k], y[k], z[k]);
+		}
+	}
+
+	inline void scatter(const Quat4& q, LLQuaternion* out[4])
+	{
+		F32 x[4], y[4], z[4], w[4];
+		_mm_storeu_ps(x, q.x);
+		_mm_storeu_ps(y, q.y);
+		_mm_storeu_ps(z, q.z);
+		_mm_storeu_ps(w, q.w);
+		for (S32 k = 0; k < 4; k++)
+		{
+			out[k]->mQ[VX] = x[k];
+			out[k]->mQ[VY] = y[k];
+			out[k]->mQ[VZ] = z[k];
+			out[k]->mQ[VW] = w[k];
+		}
+	}
+
+	inline Vec4 add(const Vec4& a, const Vec4& b)
+	{
+		Vec4 v = { _mm_add_ps(a.x, b.x), _mm_add_ps(a.y, b.y), _mm_add_ps(a.z, b.z) };
+		return v;
+	}
+
+	inline Vec4 sub(const Vec4& a, const Vec4& b)
+	{
+		Vec4 v = { _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) };
+		return v;
+	}
+
+	inline Vec4 mul(const Vec4& a, __m128 s)
+	{
+		Vec4 v = { _mm_mul_ps(a.x, s), _mm_mul_ps(a.y, s), _mm_mul_ps(a.z, s) };
+		return v;
+	}
+
+	inline __m128 dot(const Vec4& a, const Vec4& b)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+	}
+
+	inline Vec4 cross(const Vec4& a, const Vec4& b)
+	{
+		Vec4 v = { _mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+				   _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+				   _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x)) };
+		return v;
+	}
+
+	inline __m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	inline Vec4 select(__m128 mask, const Vec4& a, const Vec4& b)
+	{
+		Vec4 v = { select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z) };
+		return v;
+	}
+
+	// a * b as LLQuaternion's operator* has it
+	inline Quat4 mul(const Quat4& a, const Quat4& b)
+	{
+		Quat4 q;
+		q.x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b.w, a.x), _mm_mul_ps(b.x, a.w)), _mm_mul_ps(b.y, a.z)), _mm_mul_ps(b.z, a.y));
+		q.y = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b.w, a.y), _mm_mul_ps(b.y, a.w)), _mm_mul_ps(b.z, a.x)), _mm_mul_ps(b.x, a.z));
+		q.z = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b.w, a.z), _mm_mul_ps(b.z, a.w)), _mm_mul_ps(b.x, a.y)), _mm_mul_ps(b.y, a.x));
+		q.w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(b.w, a.w), _mm_mul_ps(b.x, a.x)), _mm_mul_ps(b.y, a.y)), _mm_mul_ps(b.z, a.z));
+		return q;
+	}
+
+	// Rotation of angle about axis, where cos_half and sin_half are those of
+	// half the angle, or the identity in the masked lanes
+	inline Quat4 axis_rotation(const Vec4& axis, __m128 cos_half, __m128 sin_half, __m128 identity)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		Quat4 q;
+		q.x = _mm_andnot_ps(identity, _mm_mul_ps(axis.x, sin_half));
+		q.y = _mm_andnot_ps(identity, _mm_mul_ps(axis.y, sin_half));
+		q.z = _mm_andnot_ps(identity, _mm_mul_ps(axis.z, sin_half));
+		q.w = select(identity, _mm_set1_ps(1.f), _mm_max_ps(cos_half, zero));
+		return q;
+	}
+}
+#endif
+
+//static
+BOOL LLFlexibleSolver::solveGroup(LLFlexibleChain** chains)
+{
+#if LL_VECTORIZE
+	// The scalar step finds the bend between sections with shortestArc()
+	// and takes it apart again with getAngleAxis().  Here the bend is kept
+	// as its cosine and axis, and the half angle sines and cosines the
+	// quaternions need come from the cosine directly.
+	const S32 sections = chains[0]->mSections;
+	LLFlexibleChain* c0 = chains[0];
+	LLFlexibleChain* c1 = chains[1];
+	LLFlexibleChain* c2 = chains[2];
+	LLFlexibleChain* c3 = chains[3];
+
+	Vec4 pos[MAX_SECTIONS+1];
+	Vec4 vel[MAX_SECTIONS+1];
+	Vec4 dir[MAX_SECTIONS+1];
+	Quat4 rot[MAX_SECTIONS+1];
+	for (S32 i = 0; i <= sections; i++)
+	{
+		pos[i] = gather(c0->mSection[i].mPosition, c1->mSection[i].mPosition, c2->mSection[i].mPosition, c3->mSection[i].mPosition);
+		vel[i] = gather(c0->mSection[i].mVelocity, c1->mSection[i].mVelocity, c2->mSection[i].mVelocity, c3->mSection[i].mVelocity);
+		dir[i] = gather(c0->mSection[i].mDirection, c1->mSection[i].mDirection, c2->mSection[i].mDirection, c3->mSection[i].mDirection);
+		rot[i] = gather(c0->mSection[i].mRotation, c1->mSection[i].mRotation, c2->mSection[i].mRotation, c3->mSection[i].mRotation);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 length = _mm_set_ps(c3->mSectionLength, c2->mSectionLength, c1->mSectionLength, c0->mSectionLength);
+	const __m128 tension = _mm_set_ps(c3->mTension, c2->mTension, c1->mTension, c0->mTension);
+	const __m128 momentum = _mm_set_ps(c3->mMomentum, c2->mMomentum, c1->mMomentum, c0->mMomentum);
+	F32 cos_max[4], sin_max[4], cos_half_max[4], sin_half_max[4];
+	for (S32 k = 0; k < 4; k++)
+	{
+		const F32 max_angle = chains[k]->mMaxAngle;
+		cos_max[k] = cosf(max_angle);
+		sin_max[k] = sinf(max_angle);
+		cos_half_max[k] = cosf(max_angle * 0.5f);
+		sin_half_max[k] = sinf(max_angle * 0.5f);
+	}
+	const __m128 cos_m = _mm_loadu_ps(cos_max);
+	const __m128 sin_m = _mm_loadu_ps(sin_max);
+	const __m128 cos_half_m = _mm_loadu_ps(cos_half_max);
+	const __m128 sin_half_m = _mm_loadu_ps(sin_half_max);
+	const __m128 mag_threshold = _mm_set1_ps(FP_MAG_THRESHOLD);
+	const __m128 parallel = _mm_set1_ps(1.f - F_APPROXIMATELY_ZERO);
+	const __m128 anti_parallel = _mm_set1_ps(-1.f + F_APPROXIMATELY_ZERO);
+
+	Quat4 segment = gather(c0->mBaseRotation, c1->mBaseRotation, c2->mBaseRotation, c3->mBaseRotation);
+
+	for (S32 i = 1; i <= sections; i++)
+	{
+		const Vec4 last = pos[i];
+		const Vec4& parent_pos = pos[i-1];
+		const Vec4& parent_dir = dir[i-1];
+		const Vec4& parent_vector = dir[i > 1 ? i-2 : 0];
+
+		// forces, tension and inertia
+		Vec4 p = add(pos[i], gather(c0->mForce[i], c1->mForce[i], c2->mForce[i], c3->mForce[i]));
+		p = add(p, mul(sub(mul(parent_vector, length), sub(p, parent_pos)), tension));
+		p = add(p, mul(vel[i], momentum));
+
+		// bend from the parent direction
+		Vec4 b = sub(p, parent_pos);
+		const __m128 b_length = _mm_sqrt_ps(dot(b, b));
+		const __m128 degenerate = _mm_cmple_ps(b_length, mag_threshold);
+		b = mul(b, _mm_div_ps(one, _mm_max_ps(b_length, mag_threshold)));
+		const __m128 cos_bend = dot(parent_dir, b);
+		if (_mm_movemask_ps(_mm_andnot_ps(degenerate, _mm_cmplt_ps(cos_bend, anti_parallel))))
+		{
+			return FALSE;
+		}
+		const __m128 identity = _mm_or_ps(degenerate, _mm_cmpgt_ps(cos_bend, parallel));
+
+		Vec4 axis = cross(parent_dir, b);
+		const __m128 sin_bend = _mm_max_ps(_mm_sqrt_ps(dot(axis, axis)), mag_threshold);
+		axis = mul(axis, _mm_div_ps(one, sin_bend));
+
+		const __m128 cos_half = _mm_sqrt_ps(_mm_max_ps(zero, _mm_mul_ps(_mm_add_ps(one, cos_bend), half)));
+		const __m128 sin_half = _mm_sqrt_ps(_mm_max_ps(zero, _mm_mul_ps(_mm_sub_ps(one, cos_bend), half)));
+
+		// clamp the bend to the max angle
+		const __m128 clamp = _mm_cmplt_ps(cos_bend, cos_m);
+		Quat4 delta = axis_rotation(axis, select(clamp, cos_half_m, cos_half), select(clamp, sin_half_m, sin_half), identity);
+
+		Vec4 clamped = add(mul(parent_dir, cos_m), mul(sub(b, mul(parent_dir, cos_bend)), _mm_div_ps(sin_m, sin_bend)));
+		Vec4 direction = select(identity, parent_dir, select(clamp, clamped, b));
+
+		segment = mul(segment, delta);
+		rot[i] = segment;
+
+		if (i > 1)
+		{
+			// Propogate half the rotation up to the parent
+			const __m128 cos_quarter = _mm_sqrt_ps(_mm_max_ps(zero, _mm_mul_ps(_mm_add_ps(one, cos_half), half)));
+			const __m128 sin_quarter = _mm_sqrt_ps(_mm_max_ps(zero, _mm_mul_ps(_mm_sub_ps(one, cos_half), half)));
+			rot[i-1] = mul(rot[i-1], axis_rotation(axis, cos_quarter, sin_quarter, identity));
+		}
+
+		dir[i] = direction;
+		pos[i] = add(parent_pos, mul(direction, length));
+
+		// velocity
+		Vec4 v = sub(pos[i], last);
+		const __m128 v_length_sq = dot(v, v);
+		const __m128 too_fast = _mm_cmpgt_ps(v_length_sq, one);
+		vel[i] = select(too_fast, mul(v, _mm_div_ps(one, _mm_sqrt_ps(v_length_sq))), v);
+	}
+
+	for (S32 i = 1; i <= sections; i++)
+	{
+		LLVector3* positions[4] = { &c0->mSection[i].mPosition, &c1->mSection[i].mPosition, &c2->mSection[i].mPosition, &c3->mSection[i].mPosition };
+		LLVector3* velocities[4] = { &c0->mSection[i].mVelocity, &c1->mSection[i].mVelocity, &c2->mSection[i].mVelocity, &c3->mSection[i].mVelocity };
+		LLVector3* directions[4] = { &c0->mSection[i].mDirection, &c1->mSection[i].mDirection, &c2->mSection[i].mDirection, &c3->mSection[i].mDirection };
+		LLQuaternion* rotations[4] = { &c0->mSection[i].mRotation, &c1->mSection[i].mRotation, &c2->mSection[i].mRotation, &c3->mSection[i].mRotation };
+		scatter(pos[i], positions);
+		scatter(vel[i], velocities);
+		scatter(dir[i], directions);
+		scatter(rot[i], rotations);
+	}
+	LLQuaternion* last_rotations[4] = { &c0->mLastSegmentRotation, &c1->mLastSegmentRotation, &c2->mLastSegmentRotation, &c3->mLastSegmentRotation };
+	scatter(segment, last_rotations);
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+// Runs a range of work items, a group of four chains or a single chain each
+class LLFlexibleSolver::GroupJob : public LLThreadPool::Job
+{
+public:
+	GroupJob(std::vector<LLFlexibleChain*>& chains, const std::vector<S32>& starts)
+	:	mChains(chains),
+		mStarts(starts)
+	{
+	}
+
+	/*virtual*/ void run(S32 begin, S32 end)
+	{
+		for (S32 i = begin; i < end; i++)
+		{
+			const S32 start = mStarts[i];
+			const S32 count = mStarts[i+1] - start;
+			if (count == 4 && solveGroup(&mChains[start]))
+			{
+				continue;
+			}
+			for (S32 k = start; k < start + count; k++)
+			{
+				solveChain(*mChains[k]);
+			}
+		}
+	}
+
+private:
+	std::vector<LLFlexibleChain*>&	mChains;
+	const std::vector<S32>&			mStarts;
+};
+
+namespace
+{
+	struct FewerSections
+	{
+		bool operator()(const LLFlexibleChain* a, const LLFlexibleChain* b) const
+		{
+			return a->mSections < b->mSections;
+		}
+	};
+}
+
+//static
+void LLFlexibleSolver::solve(std::vector<LLFlexibleChain*>& chains, BOOL threaded)
+{
+	if (chains.empty())
+	{
+		return;
+	}
+
+	// Groups of four chains with the same number of sections, the rest one
+	// at a time.  mStarts[i] to mStarts[i+1] is work item i.
+	std::stable_sort(chains.begin(), chains.end(), FewerSections());
+	std::vector<S32> starts;
+	S32 i = 0;
+	const S32 count = (S32)chains.size();
+	while (i < count)
+	{
+		starts.push_back(i);
+		if (i + 4 <= count && chains[i]->mSections == chains[i+3]->mSections)
+		{
+			i += 4;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	starts.push_back(count);
+
+	GroupJob job(chains, starts);
+	const S32 items = (S32)starts.size() - 1;
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	if (pool)
+	{
+		pool->parallelFor(job, items, 16, threaded ? true : false);
+	}
+	else
+	{
+		job.run(0, items);
+	}
+}
+
+//static
+void LLFlexibleSolver::benchmark(S32 num_chains)
+{
+	const S32 STEPS = 100;
+	const F32 STEP_TIME = 1.f / 30.f;
+	const S32 STRIDE = MAX_SECTIONS + 1;
+
+	// Prims with every number of sections, anchored still, hanging in a
+	// wind that differs between them
+	std::vector<LLFlexibleObjectSection> initial(num_chains * STRIDE);
+	std::vector<LLFlexibleChain> chains(num_chains);
+	for (S32 c = 0; c < num_chains; c++)
+	{
+		LLFlexibleChain& chain = chains[c];
+		LLFlexibleObjectSection* section = &initial[c * STRIDE];
+		chain.mSections = 1 << (c % (FLEXIBLE_OBJECT_MAX_SECTIONS + 1));
+		chain.mSectionLength = (0.25f + ll_frand(0.75f)) / chain.mSections;
+
+		const F32 tension = ll_frand(FLEXIBLE_OBJECT_MAX_TENSION);
+		chain.mTension = llmin(tension * 0.1f * (1.f - powf(0.85f, STEP_TIME * 30.f)), FLEXIBLE_OBJECT_MAX_INTERNAL_TENSION_FORCE);
+		const F32 friction = llmax(powf(10.f, (ll_frand(FLEXIBLE_OBJECT_MAX_AIR_FRICTION) * 2.f + 1.f) * STEP_TIME), 1.f);
+		chain.mMomentum = 1.f / friction;
+		chain.mMaxAngle = atanf(chain.mSectionLength * 2.f);
+		chain.mBaseRotation.setQuat(ll_frand(F_PI), LLVector3(ll_frand() - 0.5f, ll_frand() - 0.5f, 1.f));
+
+		section[0].mPosition.setVec(ll_frand(256.f), ll_frand(256.f), 20.f + ll_frand(10.f));
+		section[0].mDirection = LLVector3::z_axis * chain.mBaseRotation;
+		section[0].mRotation = chain.mBaseRotation;
+		section[0].mVelocity.setVec(0.f, 0.f, 0.f);
+
+		const F32 gravity = ll_frand(FLEXIBLE_OBJECT_MAX_GRAVITY);
+		const LLVector3 wind(ll_frand(4.f) - 2.f, ll_frand(4.f) - 2.f, 0.f);
+		const F32 force_factor = chain.mSectionLength * STEP_TIME;
+		for (S32 i = 1; i <= chain.mSections; i++)
+		{
+			section[i] = section[i-1];
+			section[i].mPosition += section[i-1].mDirection * chain.mSectionLength;
+			chain.mForce[i] = wind * (0.1f * ll_frand(FLEXIBLE_OBJECT_MAX_WIND_SENSITIVITY) * force_factor)
+				- LLVector3::z_axis * (gravity * force_factor);
+		}
+	}
+
+	const char* names[] = { "scalar", "batched", "batched, thread pool" };
+	std::vector<LLFlexibleObjectSection> results[3];
+	for (S32 pass = 0; pass < 3; pass++)
+	{
+		std::vector<LLFlexibleObjectSection>& sections = results[pass];
+		sections = initial;
+		std::vector<LLFlexibleChain*> chain_ptrs(num_chains);
+		for (S32 c = 0; c < num_chains; c++)
+		{
+			chains[c].mSection = &sections[c * STRIDE];
+			chain_ptrs[c] = &chains[c];
+		}
+
+		LLTimer timer;
+		for (S32 step = 0; step < STEPS; step++)
+		{
+			if (pass == 0)
+			{
+				for (S32 c = 0; c < num_chains; c++)
+				{
+					solveChain(chains[c]);
+				}
+			}
+			else
+			{
+				solve(chain_ptrs, pass == 2);
+			}
+		}
+		F64 time = timer.getElapsedTimeF64();
+
+		F32 difference = 0.f;
+		for (S32 s = 0; s < num_chains * STRIDE; s++)
+		{
+			difference = llmax(difference, (sections[s].mPosition - results[0][s].mPosition).magVec());
+		}
+		llinfos << "Flexible solver benchmark (" << names[pass] << "): " << num_chains << " prims, "
+				<< llformat("%.3f", time * 1000.0 / STEPS) << " ms/step, largest position difference from scalar "
+				<< difference << "m" << llendl;
+	}
+}
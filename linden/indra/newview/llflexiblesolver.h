@@ -0,0 +1,78 @@
+/**
+ * @file llflexiblesolver.h
+ * @brief Steps the section chains of flexible prims in batches.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLFLEXIBLESOLVER_H
+#define LL_LLFLEXIBLESOLVER_H
+
+#include "llflexibleobject.h"
+
+#include <vector>
+
+// One time step of one flexible prim.  LLVolumeImplFlexible::prepareChain()
+// fills it on the main thread, the solver only touches the chain and its
+// sections so chains can be stepped on any thread.
+struct LLFlexibleChain
+{
+	LLFlexibleObjectSection*	mSection;		// mSections + 1, section 0 is the anchor
+	S32							mSections;
+	F32							mSectionLength;
+	F32							mTension;		// fraction of the bend taken back per step
+	F32							mMomentum;		// fraction of the velocity kept per step
+	F32							mMaxAngle;		// between neighbor sections
+	LLQuaternion				mBaseRotation;	// of the prim
+
+	// Gravity, wind and the user force, moving each section this step
+	LLVector3					mForce[(1<<FLEXIBLE_OBJECT_MAX_SECTIONS)+1];
+
+	// Rotation of the last section, out
+	LLQuaternion				mLastSegmentRotation;
+};
+
+class LLFlexibleSolver
+{
+public:
+	// Steps every chain.  With LL_VECTORIZE chains with the same number of
+	// sections go four at a time in SSE lanes, and the groups are spread
+	// over the thread pool when threaded is TRUE.
+	static void solve(std::vector<LLFlexibleChain*>& chains, BOOL threaded);
+
+	// One chain, the way LLVolumeImplFlexible always stepped it
+	static void solveChain(LLFlexibleChain& chain);
+
+	// Steps num_chains synthetic chains with both and logs the timings
+	static void benchmark(S32 num_chains);
+
+private:
+	class GroupJob;
+
+	// chains[0..3] have the same number of sections.  Returns FALSE, with
+	// the chains untouched, when a section turned back on its parent, which
+	// only the scalar step handles.
+	static BOOL solveGroup(LLFlexibleChain** chains);
+};
+
+#endif // LL_LLFLEXIBLESOLVER_H
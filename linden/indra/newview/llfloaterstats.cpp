@@ -35,10 +35,13 @@
 #include "llviewerprecompiledheaders.h"
 
 #include "llfloaterstats.h"
+#include "llcloud.h"
 #include "llcontainerview.h"
 #include "llfloater.h"
+#include "llimpostoratlas.h"
 #include "llstatview.h"
 #include "llscrollcontainer.h"
+#include "llsurface.h"
 #include "lluictrlfactory.h"
 #include "llviewercontrol.h"
 #include "llviewerstats.h"
@@ -124,6 +127,78 @@ void LLFloaterStats::buildStats()
 	stat_barp->mLabelSpacing = 1000.f;
 	stat_barp->mPrecision = 1;
 
+	stat_barp = render_statviewp->addStat("Draw Calls", &(gPipeline.mDrawCallsStat), "DebugStatModeDrawCalls");
+	stat_barp->setUnitLabel("/fr");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 4000.f;
+	stat_barp->mTickSpacing = 1000.f;
+	stat_barp->mLabelSpacing = 2000.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Batches Merged", &(gPipeline.mBatchesMergedStat), "DebugStatModeBatchesMerged");
+	stat_barp->setUnitLabel("/fr");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 1000.f;
+	stat_barp->mTickSpacing = 250.f;
+	stat_barp->mLabelSpacing = 500.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Batch Texture Binds", &(gPipeline.mBatchTextureBindsStat), "DebugStatModeBatchTextureBinds");
+	stat_barp->setUnitLabel("/fr");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 2000.f;
+	stat_barp->mTickSpacing = 500.f;
+	stat_barp->mLabelSpacing = 1000.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Particle Vertex Data", &(gPipeline.mParticleVertexBytesStat), "DebugStatModeParticleVertexBytes");
+	stat_barp->setUnitLabel("KB/fr");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 1024.f;
+	stat_barp->mTickSpacing = 256.f;
+	stat_barp->mLabelSpacing = 512.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Text Glyphs Cached", &(gPipeline.mHUDTextGlyphsCachedStat), "DebugStatModeHUDTextGlyphsCached");
+	stat_barp->setUnitLabel("/fr");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 4000.f;
+	stat_barp->mTickSpacing = 1000.f;
+	stat_barp->mLabelSpacing = 2000.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Text Draws Saved", &(gPipeline.mHUDTextDrawsSavedStat), "DebugStatModeHUDTextDrawsSaved");
+	stat_barp->setUnitLabel("/fr");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 500.f;
+	stat_barp->mTickSpacing = 100.f;
+	stat_barp->mLabelSpacing = 250.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Tree/Grass Draws", &(gPipeline.mVegetationDrawCallsStat), "DebugStatModeVegetationDrawCalls");
+	stat_barp->setUnitLabel("/fr");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 5000.f;
+	stat_barp->mTickSpacing = 1000.f;
+	stat_barp->mLabelSpacing = 2500.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Tree Mesh KB", &(gPipeline.mTreeMeshBytesStat), "DebugStatModeTreeMeshBytes");
+	stat_barp->setUnitLabel(" KB");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 20000.f;
+	stat_barp->mTickSpacing = 4000.f;
+	stat_barp->mLabelSpacing = 10000.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
 	stat_barp = render_statviewp->addStat("Total Objs", &(gObjectList.mNumObjectsStat), "DebugStatModeTotalObjs");
 	stat_barp->mMinBar = 0.f;
 	stat_barp->mMaxBar = 10000.f;
@@ -140,6 +215,120 @@ void LLFloaterStats::buildStats()
 	stat_barp->mLabelSpacing = 500.f;
 	stat_barp->mPerSec = TRUE;
 
+	stat_barp = render_statviewp->addStat("Obj Decode", &(gObjectList.mUpdateDecodeTimeStat), "DebugStatModeObjDecode");
+	stat_barp->setUnitLabel("ms");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 20.f;
+	stat_barp->mTickSpacing = 5.f;
+	stat_barp->mLabelSpacing = 10.f;
+	stat_barp->mPrecision = 2;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Obj Apply", &(gObjectList.mUpdateApplyTimeStat), "DebugStatModeObjApply");
+	stat_barp->setUnitLabel("ms");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 20.f;
+	stat_barp->mTickSpacing = 5.f;
+	stat_barp->mLabelSpacing = 10.f;
+	stat_barp->mPrecision = 2;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Upd Skipped", &(gObjectList.mNumSkippedUpdatesStat), "DebugStatModeUpdSkipped");
+	stat_barp->setUnitLabel("/sec");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 2000.f;
+	stat_barp->mTickSpacing = 250.f;
+	stat_barp->mLabelSpacing = 1000.f;
+	stat_barp->mPerSec = TRUE;
+
+	stat_barp = render_statviewp->addStat("Upd Saved", &(gObjectList.mUpdateTimeSavedStat), "DebugStatModeUpdSaved");
+	stat_barp->setUnitLabel("ms");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 20.f;
+	stat_barp->mTickSpacing = 5.f;
+	stat_barp->mLabelSpacing = 10.f;
+	stat_barp->mPrecision = 2;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Anim Full", &(gObjectList.mAnimationLODStat[LLCharacter::ANIMATION_LOD_FULL]), "DebugStatModeAnimLODFull");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 100.f;
+	stat_barp->mTickSpacing = 25.f;
+	stat_barp->mLabelSpacing = 50.f;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Anim Reduced", &(gObjectList.mAnimationLODStat[LLCharacter::ANIMATION_LOD_REDUCED]), "DebugStatModeAnimLODReduced");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 100.f;
+	stat_barp->mTickSpacing = 25.f;
+	stat_barp->mLabelSpacing = 50.f;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Anim Low", &(gObjectList.mAnimationLODStat[LLCharacter::ANIMATION_LOD_LOW]), "DebugStatModeAnimLODLow");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 100.f;
+	stat_barp->mTickSpacing = 25.f;
+	stat_barp->mLabelSpacing = 50.f;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Anim Minimal", &(gObjectList.mAnimationLODStat[LLCharacter::ANIMATION_LOD_MINIMAL]), "DebugStatModeAnimLODMinimal");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 100.f;
+	stat_barp->mTickSpacing = 25.f;
+	stat_barp->mLabelSpacing = 50.f;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Anim Time", &(gObjectList.mAnimationTimeStat), "DebugStatModeAnimTime");
+	stat_barp->setUnitLabel("ms");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 20.f;
+	stat_barp->mTickSpacing = 5.f;
+	stat_barp->mLabelSpacing = 10.f;
+	stat_barp->mPrecision = 2;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Anim Saved", &(gObjectList.mAnimationTimeSavedStat), "DebugStatModeAnimSaved");
+	stat_barp->setUnitLabel("ms");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 20.f;
+	stat_barp->mTickSpacing = 5.f;
+	stat_barp->mLabelSpacing = 10.f;
+	stat_barp->mPrecision = 2;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Impostor Atlas", &(LLImpostorAtlas::getInstance()->mOccupancyStat), "DebugStatModeImpostorAtlas");
+	stat_barp->setUnitLabel("%");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 100.f;
+	stat_barp->mTickSpacing = 25.f;
+	stat_barp->mLabelSpacing = 50.f;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Impostor Draws Saved", &(LLImpostorAtlas::getInstance()->mDrawCallsSavedStat), "DebugStatModeImpostorDrawsSaved");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 100.f;
+	stat_barp->mTickSpacing = 25.f;
+	stat_barp->mLabelSpacing = 50.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Terrain Jobs", &(LLSurface::sPendingJobsStat), "DebugStatModeTerrainJobs");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 200.f;
+	stat_barp->mTickSpacing = 50.f;
+	stat_barp->mLabelSpacing = 100.f;
+	stat_barp->mPrecision = 0;
+	stat_barp->mPerSec = FALSE;
+
+	stat_barp = render_statviewp->addStat("Weather ms/Region (avg)", &(LLCloudLayer::sCostStat), "DebugStatModeWeatherCost");
+	stat_barp->setUnitLabel(" ms");
+	stat_barp->mMinBar = 0.f;
+	stat_barp->mMaxBar = 1.f;
+	stat_barp->mTickSpacing = 0.25f;
+	stat_barp->mLabelSpacing = 0.5f;
+	stat_barp->mPrecision = 3;
+	stat_barp->mPerSec = FALSE;
+
 
 	// Texture statistics
 	LLStatView *texture_statviewp = render_statviewp->addStatView("texture stat view", "Texture", "OpenDebugStatTexture", rect);
@@ -283,6 +283,9 @@ void LLHUDObject::renderAll()
 		}
 	}
 
+	// text queued by the LLHUDText objects above
+	LLHUDText::renderBatch(TRUE);
+
 	LLVertexBuffer::unbind();
 }
 
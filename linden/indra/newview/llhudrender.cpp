@@ -55,20 +55,20 @@ void hud_render_utf8text(const std::string &str, const LLVector3 &pos_agent,
 	hud_render_text(wstr, pos_agent, font, style, x_offset, y_offset, color, orthographic);
 }
 
-void hud_render_text(const LLWString &wstr, const LLVector3 &pos_agent,
-					const LLFontGL &font,
-					const U8 style,
-					const F32 x_offset, const F32 y_offset,
-					const LLColor4& color,
-					const BOOL orthographic)
+// Window position of the pen origin for text at pos_agent, offset in
+// screen pixels.  Returns FALSE when the text is behind the camera.
+static BOOL hud_text_window_pos(const LLVector3 &pos_agent,
+								const F32 x_offset, const F32 y_offset,
+								const BOOL orthographic,
+								F64& winX, F64& winY, F64& winZ)
 {
 	// Do cheap plane culling
 	LLVector3 dir_vec = pos_agent - LLViewerCamera::getInstance()->getOrigin();
 	dir_vec /= dir_vec.magVec();
 
-	if (wstr.empty() || (!orthographic && dir_vec * LLViewerCamera::getInstance()->getAtAxis() <= 0.f))
+	if (!orthographic && dir_vec * LLViewerCamera::getInstance()->getAtAxis() <= 0.f)
 	{
-		return;
+		return FALSE;
 	}
 
 	LLVector3 right_axis;
@@ -82,32 +82,29 @@ void hud_render_text(const LLWString &wstr, const LLVector3 &pos_agent,
 	{
 		LLViewerCamera::getInstance()->getPixelVectors(pos_agent, up_axis, right_axis);
 	}
-	LLCoordFrame render_frame = *LLViewerCamera::getInstance();
-	LLQuaternion rot;
-	if (!orthographic)
-	{
-		rot = render_frame.getQuaternion();
-		rot = rot * LLQuaternion(-F_PI_BY_TWO, LLViewerCamera::getInstance()->getYAxis());
-		rot = rot * LLQuaternion(F_PI_BY_TWO, LLViewerCamera::getInstance()->getXAxis());
-	}
-	else
-	{
-		rot = LLQuaternion(-F_PI_BY_TWO, LLVector3(0.f, 0.f, 1.f));
-		rot = rot * LLQuaternion(-F_PI_BY_TWO, LLVector3(0.f, 1.f, 0.f));
-	}
-	F32 angle;
-	LLVector3 axis;
-	rot.getAngleAxis(&angle, axis);
 
 	LLVector3 render_pos = pos_agent + (floorf(x_offset) * right_axis) + (floorf(y_offset) * up_axis);
 
 	//get the render_pos in screen space
-	
-	F64 winX, winY, winZ;
 	gluProject(render_pos.mV[0], render_pos.mV[1], render_pos.mV[2],
 				gGLModelView, gGLProjection, (GLint*) gGLViewport,
 				&winX, &winY, &winZ);
-		
+	return TRUE;
+}
+
+void hud_render_text(const LLWString &wstr, const LLVector3 &pos_agent,
+					const LLFontGL &font,
+					const U8 style,
+					const F32 x_offset, const F32 y_offset,
+					const LLColor4& color,
+					const BOOL orthographic)
+{
+	F64 winX, winY, winZ;
+	if (wstr.empty() || !hud_text_window_pos(pos_agent, x_offset, y_offset, orthographic, winX, winY, winZ))
+	{
+		return;
+	}
+
 	//fonts all render orthographically, set up projection
 	glMatrixMode(GL_PROJECTION);
 	glPushMatrix();
@@ -119,8 +116,6 @@ void hud_render_text(const LLWString &wstr, const LLVector3 &pos_agent,
 
 	LLUI::loadIdentity();
 	LLUI::translate((F32) winX*1.0f/LLFontGL::sScaleX, (F32) winY*1.0f/(LLFontGL::sScaleY), -(((F32) winZ*2.f)-1.f));
-	//glRotatef(angle * RAD_TO_DEG, axis.mV[VX], axis.mV[VY], axis.mV[VZ]);
-	//glScalef(right_scale, up_scale, 1.f);
 	F32 right_x;
 	
 	font.render(wstr, 0, 0, 0, color, LLFontGL::LEFT, LLFontGL::BASELINE, style, wstr.length(), 1000, &right_x);
@@ -130,3 +125,53 @@ void hud_render_text(const LLWString &wstr, const LLVector3 &pos_agent,
 	glPopMatrix();
 	glMatrixMode(GL_MODELVIEW);
 }
+
+BOOL hud_queue_text(LLFontRunBatch& batch,
+					const LLFontGlyphRun& run,
+					const LLVector3 &pos_agent,
+					const F32 x_offset, const F32 y_offset,
+					const F32 alpha,
+					const BOOL orthographic)
+{
+	F64 winX, winY, winZ;
+	if (!hud_text_window_pos(pos_agent, x_offset, y_offset, orthographic, winX, winY, winZ))
+	{
+		return FALSE;
+	}
+
+	// Same origin LLUI::translate() and LLFontGL::render() end up with in
+	// hud_render_text()
+	S32 origin_x = (S32)((F32)winX / LLFontGL::sScaleX);
+	S32 origin_y = (S32)((F32)winY / LLFontGL::sScaleY);
+	LLVector3 origin(floorf(origin_x * LLFontGL::sScaleX),
+					 floorf(origin_y * LLFontGL::sScaleY),
+					 -(((F32) winZ*2.f)-1.f));
+	batch.add(run, origin, alpha);
+	return TRUE;
+}
+
+S32 hud_render_batch(LLFontRunBatch& batch)
+{
+	if (batch.isEmpty())
+	{
+		return 0;
+	}
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glMatrixMode(GL_MODELVIEW);
+
+	LLUI::pushMatrix();
+
+	gViewerWindow->setup2DRender();
+
+	LLUI::loadIdentity();
+	S32 draws = batch.render();
+	LLUI::popMatrix();
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+
+	return draws;
+}
@@ -48,6 +48,20 @@ void hud_render_text(const LLWString &wstr,
 					 const LLColor4& color,
 					 const BOOL orthographic);
 
+// Queues a run laid out by LLFontGL::layoutRun() where hud_render_text()
+// would draw the same string, to be drawn by hud_render_batch().  Returns
+// FALSE when the text is behind the camera.
+BOOL hud_queue_text(LLFontRunBatch& batch,
+					const LLFontGlyphRun& run,
+					const LLVector3 &pos_agent,
+					const F32 x_offset,
+					const F32 y_offset,
+					const F32 alpha,
+					const BOOL orthographic);
+
+// Draws and empties batch, returns the number of draw calls it took
+S32 hud_render_batch(LLFontRunBatch& batch);
+
 // Legacy, slower
 void hud_render_utf8text(const std::string &str,
 						 const LLVector3 &pos_agent,
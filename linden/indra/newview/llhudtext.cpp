@@ -81,6 +81,7 @@ const F32 LOD_2_SCREEN_COVERAGE = 0.40f;
 std::set<LLPointer<LLHUDText> > LLHUDText::sTextObjects;
 std::vector<LLPointer<LLHUDText> > LLHUDText::sVisibleTextObjects;
 std::vector<LLPointer<LLHUDText> > LLHUDText::sVisibleHUDTextObjects;
+LLFontRunBatch LLHUDText::sTextBatch;
 BOOL LLHUDText::sDisplayText = TRUE ;
 
 bool lltextobject_further_away::operator()(const LLPointer<LLHUDText>& lhs, const LLPointer<LLHUDText>& rhs) const
@@ -494,6 +495,11 @@ void LLHUDText::renderText(BOOL for_select)
 	}
 
 	F32 y_offset = (F32)mOffsetY;
+
+	// Bubble text stays in front of its own bubble, everything else is
+	// queued for renderBatch()
+	static LLCachedControl<BOOL> batch_text("RenderHUDTextBatch", TRUE);
+	BOOL batch = batch_text && !for_select && !mUseBubble;
 		
 	// Render label
 	{
@@ -516,6 +522,11 @@ void LLHUDText::renderText(BOOL for_select)
 			}
 
 			LLColor4 label_color(0.f, 0.f, 0.f, 1.f);
+			if (batch)
+			{
+				queueSegment(*segment_iter, render_position, fontp, segment_iter->mStyle, x_offset, y_offset, label_color, alpha_factor);
+				continue;
+			}
 			label_color.mV[VALPHA] = alpha_factor;
 			hud_render_text(segment_iter->getText(), render_position, *fontp, segment_iter->mStyle, x_offset, y_offset, label_color, mOnHUDAttachment);
 		}
@@ -558,6 +569,12 @@ void LLHUDText::renderText(BOOL for_select)
 				x_offset = -0.5f * mWidth + (HORIZONTAL_PADDING / 2.f);
 			}
 
+			if (batch)
+			{
+				queueSegment(*segment_iter, render_position, fontp, style, x_offset, y_offset, segment_iter->mColor, alpha_factor);
+				continue;
+			}
+
 			text_color = segment_iter->mColor;
 			text_color.mV[VALPHA] *= alpha_factor;
 
@@ -572,6 +589,47 @@ void LLHUDText::renderText(BOOL for_select)
 	}
 }
 
+void LLHUDText::queueSegment(LLHUDTextSegment& segment, const LLVector3& render_position, const LLFontGL* fontp, U8 style,
+							 F32 x_offset, F32 y_offset, const LLColor4& color, F32 alpha_factor)
+{
+	BOOL cached;
+	const LLFontGlyphRun* run = segment.getGlyphRun(fontp, style, color, cached);
+	if (!run)
+	{
+		LLColor4 text_color = color;
+		text_color.mV[VALPHA] *= alpha_factor;
+		hud_render_text(segment.getText(), render_position, *fontp, style, x_offset, y_offset, text_color, mOnHUDAttachment);
+		return;
+	}
+
+	if (hud_queue_text(sTextBatch, *run, render_position, x_offset, y_offset, alpha_factor, mOnHUDAttachment) && cached)
+	{
+		gPipeline.mHUDTextGlyphsCached += run->getGlyphCount();
+	}
+}
+
+//static
+void LLHUDText::renderBatch(BOOL depth_test)
+{
+	if (sTextBatch.isEmpty())
+	{
+		return;
+	}
+
+	LLGLDepthTest gls_depth(depth_test, GL_FALSE);
+	LLGLState gls_blend(GL_BLEND, TRUE);
+	LLGLState gls_alpha(GL_ALPHA_TEST, TRUE);
+	gGL.getTexUnit(0)->setTextureBlendType(LLTexUnit::TB_MULT);
+
+	// Every queued line used to take at least one draw of its own
+	S32 lines = sTextBatch.getRunCount();
+	S32 draws = hud_render_batch(sTextBatch);
+	gPipeline.mHUDTextDrawsSaved += llmax(0, lines - draws);
+
+	/// Reset the default color to white.  The renderer expects this to be the default. 
+	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+}
+
 void LLHUDText::setStringUTF8(const std::string &wtext)
 {
 // [RLVa:KB] - Checked: 2009-07-09 (RLVa-1.0.0f)
@@ -953,6 +1011,7 @@ void LLHUDText::updateAll()
 	// and add them to the visible set if they are on screen and close enough
 	sVisibleTextObjects.clear();
 	sVisibleHUDTextObjects.clear();
+	sTextBatch.clear();
 	
 	TextObjectIterator text_it;
 	for (text_it = sTextObjects.begin(); text_it != sTextObjects.end(); ++text_it)
@@ -1130,6 +1189,7 @@ void LLHUDText::renderAllHUD()
 		{
 			(*text_it)->renderText(FALSE);
 		}
+		renderBatch(FALSE);
 	}
 	
 	LLVertexBuffer::unbind();
@@ -1209,6 +1269,21 @@ F32 LLHUDText::LLHUDTextSegment::getWidth(const LLFontGL* font)
 	}
 }
 
+const LLFontGlyphRun* LLHUDText::LLHUDTextSegment::getGlyphRun(const LLFontGL* font, U8 style, const LLColor4& color, BOOL& cached)
+{
+	cached = mRun.isValid(font) && mRunStyle == style && mRunColor == color;
+	if (!cached)
+	{
+		mRunStyle = style;
+		mRunColor = color;
+		if (!font->layoutRun(mText, color, style, 1000, mRun))
+		{
+			return NULL;
+		}
+	}
+	return &mRun;
+}
+
 // [RLVa:KB] - Checked: 2009-07-09 (RLVa-1.0.0f) | Added: RLVa-1.0.0f
 void LLHUDText::refreshAllObjectText()
 {
@@ -63,16 +63,23 @@ protected:
 	{
 	public:
 		LLHUDTextSegment(const LLWString& text, const LLFontGL::StyleFlags style, const LLColor4& color)
-			: mColor(color), mStyle(style), mText(text) {}
+			: mColor(color), mStyle(style), mText(text), mRunStyle(0) {}
 		F32 getWidth(const LLFontGL* font);
 		const LLWString& getText() const { return mText; };
 		void clearFontWidthMap() { mFontWidthMap.clear(); }
+
+		// The segment laid out in font, kept until the font, style or color
+		// change.  NULL when the style can't be laid out ahead.
+		const LLFontGlyphRun* getGlyphRun(const LLFontGL* font, U8 style, const LLColor4& color, BOOL& cached);
 		
 		LLColor4				mColor;
 		LLFontGL::StyleFlags	mStyle;
 	private:
 		LLWString				mText;
 		std::map<const LLFontGL*, F32> mFontWidthMap;
+		LLFontGlyphRun			mRun;
+		U8						mRunStyle;
+		LLColor4				mRunColor;
 	};
 
 public:
@@ -143,6 +150,9 @@ protected:
 	/*virtual*/ void render();
 	/*virtual*/ void renderForSelect();
 	void renderText(BOOL for_select);
+	void queueSegment(LLHUDTextSegment& segment, const LLVector3& render_position, const LLFontGL* fontp, U8 style,
+					  F32 x_offset, F32 y_offset, const LLColor4& color, F32 alpha_factor);
+	static void renderBatch(BOOL depth_test);
 	static void updateAll();
 	void setLOD(S32 lod);
 	S32 getMaxLines();
@@ -190,6 +200,7 @@ private:
 	static std::set<LLPointer<LLHUDText> > sTextObjects;
 	static std::vector<LLPointer<LLHUDText> > sVisibleTextObjects;
 	static std::vector<LLPointer<LLHUDText> > sVisibleHUDTextObjects;
+	static LLFontRunBatch sTextBatch;	// non-bubble text waiting for renderBatch()
 	typedef std::set<LLPointer<LLHUDText> >::iterator TextObjectIterator;
 	typedef std::vector<LLPointer<LLHUDText> >::iterator VisibleTextObjectIterator;
 };
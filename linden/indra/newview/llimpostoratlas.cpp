@@ -0,0 +1,414 @@
+/**
+ * @file llimpostoratlas.cpp
+ * @brief Shared render targets that avatar impostors are packed into.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llimpostoratlas.h"
+
+#include "llrender.h"
+#include "llrendertarget.h"
+
+#include "llviewercontrol.h"
+#include "pipeline.h"
+
+// tuning params
+const S32 IMPOSTOR_ATLAS_MIN_PAGE_SIZE = 512;	// the largest impostor
+const S32 IMPOSTOR_ATLAS_MAX_PAGE_SIZE = 4096;
+const S32 IMPOSTOR_ATLAS_MIN_SLOT_SIZE = 8;
+
+//-----------------------------------------------------------------------------
+// Page
+//-----------------------------------------------------------------------------
+class LLImpostorAtlas::Page : public LLRenderTarget
+{
+public:
+	struct Shelf
+	{
+		S32					mY;
+		S32					mHeight;
+		S32					mSlotWidth;
+		std::vector<U8>		mUsed;
+		S32					mUsedCount;
+	};
+
+	Page() : mTop(0), mSlotCount(0) {}
+
+	void setSlotRect(const LLImpostorSlot& slot)
+	{
+		// Without a framebuffer object the slot is rendered in the corner of
+		// the back buffer and copied into place by flushSlot().
+		S32 x = mFBO ? slot.mX : 0;
+		S32 y = mFBO ? slot.mY : 0;
+		glViewport(x, y, slot.mWidth, slot.mHeight);
+		glScissor(x, y, slot.mWidth, slot.mHeight);
+	}
+
+	void flushSlot(const LLImpostorSlot& slot)
+	{
+		if (mFBO)
+		{
+			flush();
+		}
+		else
+		{
+			gGL.flush();
+			gGL.getTexUnit(0)->bind(this);
+			glCopyTexSubImage2D(LLTexUnit::getInternalType(mUsage), 0, slot.mX, slot.mY, 0, 0, slot.mWidth, slot.mHeight);
+			gGL.getTexUnit(0)->disable();
+		}
+	}
+
+	std::vector<Shelf>	mShelves;
+	S32					mTop;		// the rows above are not in a shelf yet
+	S32					mSlotCount;
+};
+
+//-----------------------------------------------------------------------------
+// LLImpostorAtlas
+//-----------------------------------------------------------------------------
+LLImpostorAtlas::LLImpostorAtlas()
+:	mPageSize(1024),
+	mUsedArea(0),
+	mQuadCount(0),
+	mBatchCount(0)
+{
+}
+
+LLImpostorAtlas::~LLImpostorAtlas()
+{
+	release();
+}
+
+LLImpostorAtlas::Page* LLImpostorAtlas::newPage(S32 index)
+{
+	Page* page = new Page;
+	if (LLPipeline::sRenderDeferred)
+	{
+		page->allocate(mPageSize, mPageSize, GL_RGBA16F_ARB, TRUE, TRUE);
+		addDeferredAttachments(*page);
+	}
+	else
+	{
+		page->allocate(mPageSize, mPageSize, GL_RGBA, TRUE, TRUE);
+	}
+	if (!page->isComplete())
+	{
+		llwarns << "Unable to allocate a " << mPageSize << "x" << mPageSize << " impostor atlas page" << llendl;
+		delete page;
+		return NULL;
+	}
+
+	gGL.getTexUnit(0)->bind(page);
+	gGL.getTexUnit(0)->setTextureFilteringOption(LLTexUnit::TFO_POINT);
+	gGL.getTexUnit(0)->unbind(LLTexUnit::TT_TEXTURE);
+
+	if (index >= (S32)mPages.size())
+	{
+		mPages.resize(index + 1, NULL);
+		mQueuedQuads.resize(index + 1);
+	}
+	mPages[index] = page;
+	llinfos << "Allocated impostor atlas page " << index << " (" << mPageSize << "x" << mPageSize << ")" << llendl;
+	return page;
+}
+
+BOOL LLImpostorAtlas::allocate(S32 width, S32 height, LLImpostorSlot& slot)
+{
+	llassert(slot.isNull());
+
+	BOOL have_pages = FALSE;
+	for (std::vector<Page*>::iterator iter = mPages.begin(); iter != mPages.end(); ++iter)
+	{
+		have_pages |= (*iter != NULL);
+	}
+	if (!have_pages)
+	{
+		// The size only changes while there are no pages
+		S32 size = llclamp((S32)gSavedSettings.getU32("RenderImpostorAtlasSize"), IMPOSTOR_ATLAS_MIN_PAGE_SIZE, IMPOSTOR_ATLAS_MAX_PAGE_SIZE);
+		mPageSize = IMPOSTOR_ATLAS_MIN_PAGE_SIZE;
+		while (mPageSize < size)
+		{
+			mPageSize *= 2;
+		}
+	}
+
+	width = llclamp(width, IMPOSTOR_ATLAS_MIN_SLOT_SIZE, mPageSize);
+	height = llclamp(height, IMPOSTOR_ATLAS_MIN_SLOT_SIZE, mPageSize);
+
+	// In order: a free slot in a shelf of this size, an empty shelf as high,
+	// room for a new shelf, and a new page.
+	S32 page_index = -1;
+	S32 shelf_index = -1;
+	for (S32 pass = 0; pass < 3 && shelf_index < 0; pass++)
+	{
+		for (S32 p = 0; p < (S32)mPages.size() && shelf_index < 0; p++)
+		{
+			Page* page = mPages[p];
+			if (!page)
+			{
+				continue;
+			}
+			if (pass == 2)
+			{
+				if (page->mTop + height <= mPageSize)
+				{
+					Page::Shelf shelf;
+					shelf.mY = page->mTop;
+					shelf.mHeight = height;
+					shelf.mSlotWidth = 0;
+					shelf.mUsedCount = 0;
+					page->mShelves.push_back(shelf);
+					page->mTop += height;
+					page_index = p;
+					shelf_index = page->mShelves.size() - 1;
+				}
+				continue;
+			}
+			for (S32 s = 0; s < (S32)page->mShelves.size(); s++)
+			{
+				const Page::Shelf& shelf = page->mShelves[s];
+				if (shelf.mHeight != height)
+				{
+					continue;
+				}
+				if ((pass == 0 && shelf.mSlotWidth == width && shelf.mUsedCount < (S32)shelf.mUsed.size())
+					|| (pass == 1 && shelf.mUsedCount == 0))
+				{
+					page_index = p;
+					shelf_index = s;
+					break;
+				}
+			}
+		}
+	}
+
+	if (shelf_index < 0)
+	{
+		page_index = 0;
+		while (page_index < (S32)mPages.size() && mPages[page_index])
+		{
+			page_index++;
+		}
+		Page* page = newPage(page_index);
+		if (!page)
+		{
+			return FALSE;
+		}
+		Page::Shelf shelf;
+		shelf.mY = 0;
+		shelf.mHeight = height;
+		shelf.mSlotWidth = 0;
+		shelf.mUsedCount = 0;
+		page->mShelves.push_back(shelf);
+		page->mTop = height;
+		shelf_index = 0;
+	}
+
+	Page* page = mPages[page_index];
+	Page::Shelf& shelf = page->mShelves[shelf_index];
+	if (shelf.mUsedCount == 0 && shelf.mSlotWidth != width)
+	{
+		shelf.mSlotWidth = width;
+		shelf.mUsed.assign(mPageSize / width, 0);
+	}
+	S32 index = 0;
+	while (shelf.mUsed[index])
+	{
+		index++;
+	}
+	shelf.mUsed[index] = 1;
+	shelf.mUsedCount++;
+	page->mSlotCount++;
+	mUsedArea += width * height;
+
+	slot.mPage = page_index;
+	slot.mShelf = shelf_index;
+	slot.mIndex = index;
+	slot.mX = index * width;
+	slot.mY = shelf.mY;
+	slot.mWidth = width;
+	slot.mHeight = height;
+	return TRUE;
+}
+
+void LLImpostorAtlas::free(LLImpostorSlot& slot)
+{
+	if (slot.isNull())
+	{
+		return;
+	}
+
+	Page* page = slot.mPage < (S32)mPages.size() ? mPages[slot.mPage] : NULL;
+	if (page)
+	{
+		Page::Shelf& shelf = page->mShelves[slot.mShelf];
+		shelf.mUsed[slot.mIndex] = 0;
+		shelf.mUsedCount--;
+		page->mSlotCount--;
+		mUsedArea -= slot.mWidth * slot.mHeight;
+
+		// Give the rows of empty shelves at the top back
+		while (!page->mShelves.empty() && page->mShelves.back().mUsedCount == 0)
+		{
+			page->mTop = page->mShelves.back().mY;
+			page->mShelves.pop_back();
+		}
+
+		// Keep the first page around so that one avatar going in and out of
+		// impostor range doesn't allocate a page each time.
+		if (page->mSlotCount == 0 && slot.mPage > 0)
+		{
+			mQueuedQuads[slot.mPage].clear();
+			mPages[slot.mPage] = NULL;
+			delete page;
+		}
+	}
+
+	slot = LLImpostorSlot();
+}
+
+void LLImpostorAtlas::release()
+{
+	for (std::vector<Page*>::iterator iter = mPages.begin(); iter != mPages.end(); ++iter)
+	{
+		delete *iter;
+	}
+	mPages.clear();
+	mQueuedQuads.clear();
+	mUsedArea = 0;
+}
+
+void LLImpostorAtlas::bindSlot(const LLImpostorSlot& slot)
+{
+	Page* page = mPages[slot.mPage];
+	page->bindTarget();
+	page->setSlotRect(slot);
+	page->clear();
+	// clear() may have scissored to the whole page
+	page->setSlotRect(slot);
+}
+
+void LLImpostorAtlas::flushSlot(const LLImpostorSlot& slot)
+{
+	mPages[slot.mPage]->flushSlot(slot);
+}
+
+void LLImpostorAtlas::addQuad(const LLImpostorSlot& slot, const LLVector3* corners, const LLColor4U& color)
+{
+	if (slot.isNull() || slot.mPage >= (S32)mPages.size() || !mPages[slot.mPage])
+	{
+		return;
+	}
+
+	mQueuedQuads[slot.mPage].push_back(Quad());
+	Quad& quad = mQueuedQuads[slot.mPage].back();
+	for (S32 i = 0; i < 4; i++)
+	{
+		quad.mCorners[i] = corners[i];
+	}
+	quad.mColor = color;
+	F32 scale = 1.f / (F32)mPageSize;
+	quad.mTexCoords[0] = slot.mX * scale;
+	quad.mTexCoords[1] = slot.mY * scale;
+	quad.mTexCoords[2] = (slot.mX + slot.mWidth) * scale;
+	quad.mTexCoords[3] = (slot.mY + slot.mHeight) * scale;
+}
+
+void LLImpostorAtlas::renderQuads(S32 normal_channel, S32 specular_channel)
+{
+	BOOL queued = FALSE;
+	for (std::vector<std::vector<Quad> >::iterator iter = mQueuedQuads.begin(); iter != mQueuedQuads.end(); ++iter)
+	{
+		queued |= !iter->empty();
+	}
+	if (!queued)
+	{
+		return;
+	}
+
+	LLGLEnable test(GL_ALPHA_TEST);
+	gGL.setAlphaRejectSettings(LLRender::CF_GREATER, 0.f);
+
+	for (S32 p = 0; p < (S32)mPages.size(); p++)
+	{
+		std::vector<Quad>& quads = mQueuedQuads[p];
+		Page* page = mPages[p];
+		if (quads.empty() || !page)
+		{
+			continue;
+		}
+
+		gGL.getTexUnit(0)->bind(page);
+		if (normal_channel > -1)
+		{
+			page->bindTexture(2, normal_channel);
+		}
+		if (specular_channel > -1)
+		{
+			page->bindTexture(1, specular_channel);
+		}
+
+		gGL.begin(LLRender::QUADS);
+		for (std::vector<Quad>::iterator iter = quads.begin(); iter != quads.end(); ++iter)
+		{
+			const Quad& quad = *iter;
+			gGL.color4ubv(quad.mColor.mV);
+			gGL.texCoord2f(quad.mTexCoords[0], quad.mTexCoords[1]);
+			gGL.vertex3fv(quad.mCorners[0].mV);
+			gGL.texCoord2f(quad.mTexCoords[2], quad.mTexCoords[1]);
+			gGL.vertex3fv(quad.mCorners[1].mV);
+			gGL.texCoord2f(quad.mTexCoords[2], quad.mTexCoords[3]);
+			gGL.vertex3fv(quad.mCorners[2].mV);
+			gGL.texCoord2f(quad.mTexCoords[0], quad.mTexCoords[3]);
+			gGL.vertex3fv(quad.mCorners[3].mV);
+		}
+		gGL.end();
+		gGL.flush();
+
+		mQuadCount += quads.size();
+		mBatchCount++;
+		quads.clear();
+	}
+
+	gGL.setAlphaRejectSettings(LLRender::CF_DEFAULT);
+}
+
+void LLImpostorAtlas::updateStats()
+{
+	S32 page_area = 0;
+	for (std::vector<Page*>::iterator iter = mPages.begin(); iter != mPages.end(); ++iter)
+	{
+		if (*iter)
+		{
+			page_area += mPageSize * mPageSize;
+		}
+	}
+	mOccupancyStat.addValue(page_area > 0 ? 100.f * (F32)mUsedArea / (F32)page_area : 0.f);
+	mDrawCallsSavedStat.addValue((F32)(mQuadCount - mBatchCount));
+	mQuadCount = 0;
+	mBatchCount = 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file llimpostoratlas.h
+ * @brief Shared render targets that avatar impostors are packed into.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLIMPOSTORATLAS_H
+#define LL_LLIMPOSTORATLAS_H
+
+#include "llmemory.h"
+#include "llstat.h"
+#include "v3math.h"
+#include "v4coloru.h"
+
+#include <vector>
+
+// The rectangle of an atlas page an impostor is rendered into.
+struct LLImpostorSlot
+{
+	LLImpostorSlot() : mPage(-1), mShelf(-1), mIndex(-1), mX(0), mY(0), mWidth(0), mHeight(0) {}
+
+	BOOL isNull() const { return mPage < 0; }
+
+	S32 mPage;
+	S32 mShelf;
+	S32 mIndex;
+	S32 mX;
+	S32 mY;
+	S32 mWidth;
+	S32 mHeight;
+};
+
+// Avatar impostors used to get one render target each, and one bind and
+// draw call each.  They now share square pages (RenderImpostorAtlasSize)
+// split into shelves: horizontal strips as high as the impostors they hold,
+// which are all the same size.  Impostor sizes are powers of two, so few
+// kinds of shelves are needed and freed slots are reused by the next
+// impostor of the same size.
+//
+// Impostors are queued as they are drawn and rendered together, one batch
+// per page, by renderQuads() at the end of the pass.
+class LLImpostorAtlas : public LLSingleton<LLImpostorAtlas>
+{
+public:
+	LLImpostorAtlas();
+	~LLImpostorAtlas();
+
+	// Finds room for a width x height impostor, both powers of two no
+	// bigger than a page.  Returns FALSE if no page could be allocated.
+	BOOL allocate(S32 width, S32 height, LLImpostorSlot& slot);
+	// Gives the slot back and nulls it
+	void free(LLImpostorSlot& slot);
+	// Frees every page, when the GL buffers are released.  Slots handed out
+	// must be nulled by their owners.
+	void release();
+
+	// Renders into the slot: binds its page, sets the viewport and scissor
+	// box to the slot and clears it.  The caller enables GL_SCISSOR_TEST so
+	// the clear leaves the rest of the page alone.
+	void bindSlot(const LLImpostorSlot& slot);
+	void flushSlot(const LLImpostorSlot& slot);
+
+	// Queues an impostor quad: corners are in the order of the slot's
+	// texture corners (0,0), (1,0), (1,1), (0,1).
+	void addQuad(const LLImpostorSlot& slot, const LLVector3* corners, const LLColor4U& color);
+	// Draws the queued quads, binding the deferred attachments of the pages
+	// to the given channels if they are not -1.
+	void renderQuads(S32 normal_channel = -1, S32 specular_channel = -1);
+
+	// Once per frame
+	void updateStats();
+
+	LLStat mOccupancyStat;		// percent of the allocated pages in use
+	LLStat mDrawCallsSavedStat;	// impostors drawn minus batches drawn, per frame
+
+private:
+	class Page;
+
+	struct Quad
+	{
+		LLVector3	mCorners[4];
+		LLColor4U	mColor;
+		F32			mTexCoords[4];	// left, bottom, right, top
+	};
+
+	Page* newPage(S32 index);
+
+private:
+	std::vector<Page*>	mPages;			// NULL where a page was freed
+	std::vector<std::vector<Quad> > mQueuedQuads;	// by page
+	S32					mPageSize;
+	S32					mUsedArea;		// by slots, in pixels
+	S32					mQuadCount;		// drawn since the last updateStats()
+	S32					mBatchCount;
+};
+
+#endif // LL_LLIMPOSTORATLAS_H
@@ -43,6 +43,7 @@
 #include "llmemtype.h"
 
 #include "llcharacter.h"
+#include "llpolymesh.h"
 #include "llui.h"
 #include "llviewercontrol.h"
 #include "llstat.h"
@@ -264,6 +265,15 @@ void LLMemoryView::draw()
 	dumpData();
 
 #endif
+
+	// Morphed avatar meshes, which avatars with the same shape share
+	{
+		S32 kb_used = LLPolyMesh::sVertexDataBytesUsed >> 10;
+		S32 kb_allocated = LLPolyMeshVertexData::sBytes >> 10;
+		std::string mesh_desc = llformat("Avatar Mesh Vertices: %d KB in %d copies for %d KB of meshes (%d KB saved by sharing)",
+										 kb_allocated, LLPolyMeshVertexData::sCount, kb_used, kb_used - kb_allocated);
+		LLFontGL::getFontMonospace()->renderUTF8(mesh_desc, 0, 10, 10, LLColor4::white, LLFontGL::LEFT, LLFontGL::BOTTOM);
+	}
 	
 	LLView::draw();
 }
@@ -56,6 +56,10 @@ extern LLControlGroup gSavedSettings;				// read only
 //-----------------------------------------------------------------------------
 LLPolyMesh::LLPolyMeshSharedDataTable LLPolyMesh::sGlobalSharedMeshList;
 
+S32 LLPolyMesh::sVertexDataBytesUsed = 0;
+S32 LLPolyMeshVertexData::sCount = 0;
+S32 LLPolyMeshVertexData::sBytes = 0;
+
 //-----------------------------------------------------------------------------
 // LLPolyMeshSharedData()
 //-----------------------------------------------------------------------------
@@ -90,6 +94,10 @@ LLPolyMeshSharedData::LLPolyMeshSharedData()
 //-----------------------------------------------------------------------------
 LLPolyMeshSharedData::~LLPolyMeshSharedData()
 {
+	while (!mSharedVertexData.empty())
+	{
+		mSharedVertexData.begin()->second->unshare();
+	}
 	freeMeshData();
 	for_each(mMorphData.begin(), mMorphData.end(), DeletePointer());
 	mMorphData.clear();
@@ -676,6 +684,110 @@ const LLVector2 &LLPolyMeshSharedData::getUVs(U32 index)
 	return mTexCoords[index];
 }
 
+//-----------------------------------------------------------------------------
+// LLPolyMeshVertexData()
+//-----------------------------------------------------------------------------
+LLPolyMeshVertexData::LLPolyMeshVertexData(LLPolyMeshSharedData* shared_data)
+:	mSharedData(NULL),
+	mKeyHash(0)
+{
+	allocate(shared_data->mNumVertices);
+}
+
+LLPolyMeshVertexData::LLPolyMeshVertexData(const LLPolyMeshVertexData* source)
+:	mSharedData(NULL),
+	mKeyHash(0)
+{
+	allocate(source->mNumVertices);
+	memcpy(mVertexData, source->mVertexData, getSize());	/*Flawfinder: ignore*/
+}
+
+LLPolyMeshVertexData::~LLPolyMeshVertexData()
+{
+	unshare();
+	delete [] mVertexData;
+	sCount--;
+	sBytes -= getSize();
+}
+
+void LLPolyMeshVertexData::allocate(S32 num_vertices)
+{
+	// Allocate memory without initializing every vector
+	// NOTE: This makes asusmptions about the size of LLVector[234]
+	mNumVertices = num_vertices;
+	mNumFloats = num_vertices * (3*5 + 2 + 4);
+	mVertexData = new F32[mNumFloats];
+	S32 offset = 0;
+	mCoords = 				(LLVector3*)(mVertexData + offset); offset += 3*num_vertices;
+	mNormals = 				(LLVector3*)(mVertexData + offset); offset += 3*num_vertices;
+	mScaledNormals = 		(LLVector3*)(mVertexData + offset); offset += 3*num_vertices;
+	mBinormals = 			(LLVector3*)(mVertexData + offset); offset += 3*num_vertices;
+	mScaledBinormals = 		(LLVector3*)(mVertexData + offset); offset += 3*num_vertices;
+	mTexCoords = 			(LLVector2*)(mVertexData + offset); offset += 2*num_vertices;
+	mClothingWeights = 		(LLVector4*)(mVertexData + offset); offset += 4*num_vertices;
+
+	sCount++;
+	sBytes += getSize();
+}
+
+LLPolyMeshVertexData* LLPolyMeshVertexData::share(LLPolyMeshSharedData* shared_data, const std::vector<F32>& key)
+{
+	if (mSharedData == shared_data && key == mKey)
+	{
+		return this;
+	}
+	unshare();
+
+	// FNV-1a over the weights' bits
+	U32 hash = 2166136261u;
+	for (std::vector<F32>::const_iterator iter = key.begin(); iter != key.end(); ++iter)
+	{
+		U32 bits;
+		memcpy(&bits, &(*iter), sizeof(bits));	/*Flawfinder: ignore*/
+		for (S32 i = 0; i < 4; i++)
+		{
+			hash = (hash ^ ((bits >> (i * 8)) & 0xff)) * 16777619u;
+		}
+	}
+
+	typedef LLPolyMeshSharedData::vertex_data_map_t::iterator iter_t;
+	std::pair<iter_t, iter_t> range = shared_data->mSharedVertexData.equal_range(hash);
+	for (iter_t iter = range.first; iter != range.second; ++iter)
+	{
+		if (iter->second->mKey == key)
+		{
+			return iter->second;
+		}
+	}
+
+	mSharedData = shared_data;
+	mKeyHash = hash;
+	mKey = key;
+	shared_data->mSharedVertexData.insert(std::make_pair(hash, this));
+	return this;
+}
+
+void LLPolyMeshVertexData::unshare()
+{
+	if (!mSharedData)
+	{
+		return;
+	}
+
+	typedef LLPolyMeshSharedData::vertex_data_map_t::iterator iter_t;
+	std::pair<iter_t, iter_t> range = mSharedData->mSharedVertexData.equal_range(mKeyHash);
+	for (iter_t iter = range.first; iter != range.second; ++iter)
+	{
+		if (iter->second == this)
+		{
+			mSharedData->mSharedVertexData.erase(iter);
+			break;
+		}
+	}
+	mSharedData = NULL;
+	mKey.clear();
+}
+
 //-----------------------------------------------------------------------------
 // LLPolyMesh()
 //-----------------------------------------------------------------------------
@@ -688,7 +800,6 @@ LLPolyMesh::LLPolyMesh(LLPolyMeshSharedData *shared_data, LLPolyMesh *reference_
 	mSharedData = shared_data;
 	mReferenceMesh = reference_mesh;
 	mAvatarp = NULL;
-	mVertexData = NULL;
 
 	mCurVertexCount = 0;
 	mFaceIndexCount = 0;
@@ -696,41 +807,9 @@ LLPolyMesh::LLPolyMesh(LLPolyMeshSharedData *shared_data, LLPolyMesh *reference_
 	mFaceVertexCount = 0;
 	mFaceVertexOffset = 0;
 
-	if (shared_data->isLOD() && reference_mesh)
+	if (!shared_data->isLOD() || !reference_mesh)
 	{
-		mCoords = reference_mesh->mCoords;
-		mNormals = reference_mesh->mNormals;
-		mScaledNormals = reference_mesh->mScaledNormals;
-		mBinormals = reference_mesh->mBinormals;
-		mScaledBinormals = reference_mesh->mScaledBinormals;
-		mTexCoords = reference_mesh->mTexCoords;
-		mClothingWeights = reference_mesh->mClothingWeights;
-	}
-	else
-	{
-#if 1	// Allocate memory without initializing every vector
-		// NOTE: This makes asusmptions about the size of LLVector[234]
-		int nverts = mSharedData->mNumVertices;
-		int nfloats = nverts * (3*5 + 2 + 4);
-		mVertexData = new F32[nfloats];
-		int offset = 0;
-		mCoords = 				(LLVector3*)(mVertexData + offset); offset += 3*nverts;
-		mNormals = 				(LLVector3*)(mVertexData + offset); offset += 3*nverts;
-		mScaledNormals = 		(LLVector3*)(mVertexData + offset); offset += 3*nverts;
-		mBinormals = 			(LLVector3*)(mVertexData + offset); offset += 3*nverts;
-		mScaledBinormals = 		(LLVector3*)(mVertexData + offset); offset += 3*nverts;
-		mTexCoords = 			(LLVector2*)(mVertexData + offset); offset += 2*nverts;
-		mClothingWeights = 	(LLVector4*)(mVertexData + offset); offset += 4*nverts;
-#else
-		mCoords = new LLVector3[mSharedData->mNumVertices];
-		mNormals = new LLVector3[mSharedData->mNumVertices];
-		mScaledNormals = new LLVector3[mSharedData->mNumVertices];
-		mBinormals = new LLVector3[mSharedData->mNumVertices];
-		mScaledBinormals = new LLVector3[mSharedData->mNumVertices];
-		mTexCoords = new LLVector2[mSharedData->mNumVertices];
-		mClothingWeights = new LLVector4[mSharedData->mNumVertices];
-		memset(mClothingWeights, 0, sizeof(LLVector4) * mSharedData->mNumVertices);
-#endif
+		setVertexData(new LLPolyMeshVertexData(mSharedData));
 		initializeForMorph();
 	}
 }
@@ -747,17 +826,7 @@ LLPolyMesh::~LLPolyMesh()
 		delete mJointRenderData[i];
 		mJointRenderData[i] = NULL;
 	}
-#if 0 // These are now allocated as one big uninitialized chunk
-	delete [] mCoords;
-	delete [] mNormals;
-	delete [] mScaledNormals;
-	delete [] mBinormals;
-	delete [] mScaledBinormals;
-	delete [] mClothingWeights;
-	delete [] mTexCoords;
-#else
-	delete [] mVertexData;
-#endif
+	setVertexData(NULL);
 }
 
 
@@ -860,12 +929,76 @@ void LLPolyMesh::dumpDiagInfo()
 	llinfos << "-----------------------------------------------------" << llendl;
 }
 
+//-----------------------------------------------------------------------------
+// getWritableVertexData()
+//-----------------------------------------------------------------------------
+LLPolyMeshVertexData* LLPolyMesh::getWritableVertexData()
+{
+	if (mVertexData.isNull())
+	{
+		return mReferenceMesh->getWritableVertexData();
+	}
+	if (mVertexData->getNumRefs() > 1)
+	{
+		LLMemType mt(LLMemType::MTYPE_AVATAR_MESH);
+		setVertexData(new LLPolyMeshVertexData(mVertexData.get()));
+	}
+	else if (mVertexData->isShared())
+	{
+		mVertexData->unshare();
+	}
+	return mVertexData;
+}
+
+//-----------------------------------------------------------------------------
+// setVertexData()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::setVertexData(LLPolyMeshVertexData* vertex_data)
+{
+	if (mVertexData.notNull())
+	{
+		sVertexDataBytesUsed -= mVertexData->getSize();
+	}
+	mVertexData = vertex_data;
+	if (mVertexData.notNull())
+	{
+		sVertexDataBytesUsed += mVertexData->getSize();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// shareVertexData()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::shareVertexData()
+{
+	if (mVertexData.isNull() || mMorphTargets.empty())
+	{
+		return;
+	}
+
+	std::vector<F32> key;
+	key.reserve(mMorphTargets.size());
+	for (std::vector<LLPolyMorphTarget*>::iterator iter = mMorphTargets.begin();
+		 iter != mMorphTargets.end(); ++iter)
+	{
+		LLPolyMorphTarget* morph_target = *iter;
+		if (morph_target->isMasked())
+		{
+			// the mask comes from our textures, not from the weights
+			return;
+		}
+		key.push_back(morph_target->getLastWeight());
+	}
+
+	setVertexData(mVertexData->share(mSharedData, key));
+}
+
 //-----------------------------------------------------------------------------
 // getWritableCoords()
 //-----------------------------------------------------------------------------
 LLVector3 *LLPolyMesh::getWritableCoords()
 {
-	return mCoords;
+	return getWritableVertexData()->mCoords;
 }
 
 //-----------------------------------------------------------------------------
@@ -873,7 +1006,7 @@ LLVector3 *LLPolyMesh::getWritableCoords()
 //-----------------------------------------------------------------------------
 LLVector3 *LLPolyMesh::getWritableNormals()
 {
-	return mNormals;
+	return getWritableVertexData()->mNormals;
 }
 
 //-----------------------------------------------------------------------------
@@ -881,7 +1014,7 @@ LLVector3 *LLPolyMesh::getWritableNormals()
 //-----------------------------------------------------------------------------
 LLVector3 *LLPolyMesh::getWritableBinormals()
 {
-	return mBinormals;
+	return getWritableVertexData()->mBinormals;
 }
 
 
@@ -890,7 +1023,7 @@ LLVector3 *LLPolyMesh::getWritableBinormals()
 //-----------------------------------------------------------------------------
 LLVector4	*LLPolyMesh::getWritableClothingWeights()
 {
-	return mClothingWeights;
+	return getWritableVertexData()->mClothingWeights;
 }
 
 //-----------------------------------------------------------------------------
@@ -898,7 +1031,7 @@ LLVector4	*LLPolyMesh::getWritableClothingWeights()
 //-----------------------------------------------------------------------------
 LLVector2	*LLPolyMesh::getWritableTexCoords()
 {
-	return mTexCoords;
+	return getWritableVertexData()->mTexCoords;
 }
 
 //-----------------------------------------------------------------------------
@@ -906,7 +1039,7 @@ LLVector2	*LLPolyMesh::getWritableTexCoords()
 //-----------------------------------------------------------------------------
 LLVector3 *LLPolyMesh::getScaledNormals()
 {
-	return mScaledNormals;
+	return getWritableVertexData()->mScaledNormals;
 }
 
 //-----------------------------------------------------------------------------
@@ -914,7 +1047,7 @@ LLVector3 *LLPolyMesh::getScaledNormals()
 //-----------------------------------------------------------------------------
 LLVector3 *LLPolyMesh::getScaledBinormals()
 {
-	return mScaledBinormals;
+	return getWritableVertexData()->mScaledBinormals;
 }
 
 
@@ -926,13 +1059,14 @@ void LLPolyMesh::initializeForMorph()
 	if (!mSharedData)
 		return;
 
-	memcpy(mCoords, mSharedData->mBaseCoords, sizeof(LLVector3) * mSharedData->mNumVertices);	/*Flawfinder: ignore*/
-	memcpy(mNormals, mSharedData->mBaseNormals, sizeof(LLVector3) * mSharedData->mNumVertices);	/*Flawfinder: ignore*/
-	memcpy(mScaledNormals, mSharedData->mBaseNormals, sizeof(LLVector3) * mSharedData->mNumVertices);	/*Flawfinder: ignore*/
-	memcpy(mBinormals, mSharedData->mBaseBinormals, sizeof(LLVector3) * mSharedData->mNumVertices);	/*Flawfinder: ignore*/
-	memcpy(mScaledBinormals, mSharedData->mBaseBinormals, sizeof(LLVector3) * mSharedData->mNumVertices);		/*Flawfinder: ignore*/
-	memcpy(mTexCoords, mSharedData->mTexCoords, sizeof(LLVector2) * mSharedData->mNumVertices);		/*Flawfinder: ignore*/
-	memset(mClothingWeights, 0, sizeof(LLVector4) * mSharedData->mNumVertices);
+	LLPolyMeshVertexData* vertex_data = getWritableVertexData();
+	memcpy(vertex_data->mCoords, mSharedData->mBaseCoords, sizeof(LLVector3) * mSharedData->mNumVertices);	/*Flawfinder: ignore*/
+	memcpy(vertex_data->mNormals, mSharedData->mBaseNormals, sizeof(LLVector3) * mSharedData->mNumVertices);	/*Flawfinder: ignore*/
+	memcpy(vertex_data->mScaledNormals, mSharedData->mBaseNormals, sizeof(LLVector3) * mSharedData->mNumVertices);	/*Flawfinder: ignore*/
+	memcpy(vertex_data->mBinormals, mSharedData->mBaseBinormals, sizeof(LLVector3) * mSharedData->mNumVertices);	/*Flawfinder: ignore*/
+	memcpy(vertex_data->mScaledBinormals, mSharedData->mBaseBinormals, sizeof(LLVector3) * mSharedData->mNumVertices);		/*Flawfinder: ignore*/
+	memcpy(vertex_data->mTexCoords, mSharedData->mTexCoords, sizeof(LLVector2) * mSharedData->mNumVertices);		/*Flawfinder: ignore*/
+	memset(vertex_data->mClothingWeights, 0, sizeof(LLVector4) * mSharedData->mNumVertices);
 }
 
 //-----------------------------------------------------------------------------
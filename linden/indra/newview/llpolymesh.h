@@ -35,7 +35,9 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include "llstl.h"
+#include "llmemory.h"
 
 #include "v3math.h"
 #include "v2math.h"
@@ -66,10 +68,12 @@ typedef S32 LLPolyFace[3];
 // faces grouped into named face sets.
 //-----------------------------------------------------------------------------
 class LLPolyMorphTarget;
+class LLPolyMeshVertexData;
 
 class LLPolyMeshSharedData
 {
 	friend class LLPolyMesh;
+	friend class LLPolyMeshVertexData;
 private:
 	// transform data
 	LLVector3				mPosition;
@@ -105,6 +109,10 @@ private:
 	LLPolyMeshSharedData*		mReferenceData;
 	S32							mLastIndexOffset;
 
+	// morphed vertex data that meshes of this kind can share, by key hash
+	typedef std::multimap<U32, LLPolyMeshVertexData*> vertex_data_map_t;
+	vertex_data_map_t			mSharedVertexData;
+
 public:
 	// Temporarily...
 	// Triangle indices
@@ -148,6 +156,60 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------
+// LLPolyMeshVertexData
+// The morphed vertices of an LLPolyMesh.  Meshes whose morph targets are all
+// at the same weights, as on avatars with identical shapes, use one copy,
+// which is copied again before any of them changes it.
+//-----------------------------------------------------------------------------
+class LLPolyMeshVertexData : public LLRefCount
+{
+protected:
+	~LLPolyMeshVertexData();
+
+public:
+	// Vertices of the undeformed mesh
+	LLPolyMeshVertexData(LLPolyMeshSharedData* shared_data);
+	// A private copy of source
+	LLPolyMeshVertexData(const LLPolyMeshVertexData* source);
+
+	S32 getSize() const { return mNumFloats * sizeof(F32); }
+
+	// Offers this data to the other meshes of shared_data's kind with the
+	// morph weights in key.  Returns the data already offered for key if
+	// there is one.
+	LLPolyMeshVertexData* share(LLPolyMeshSharedData* shared_data, const std::vector<F32>& key);
+	// Takes it back before it is modified
+	void unshare();
+	BOOL isShared() const { return mSharedData != NULL; }
+
+private:
+	void allocate(S32 num_vertices);
+
+public:
+	S32						mNumVertices;
+	S32						mNumFloats;
+	// Single array of floats for allocation / deletion
+	F32						*mVertexData;
+	LLVector3				*mCoords;
+	LLVector3				*mNormals;
+	LLVector3				*mScaledNormals;
+	LLVector3				*mBinormals;
+	LLVector3				*mScaledBinormals;
+	LLVector2				*mTexCoords;
+	LLVector4				*mClothingWeights;
+
+	// Totals for LLMemoryView
+	static S32				sCount;
+	static S32				sBytes;
+
+private:
+	// set while this is in the mesh's table of shared vertex data
+	LLPolyMeshSharedData*	mSharedData;
+	U32						mKeyHash;
+	std::vector<F32>		mKey;
+};
+
 class LLJointRenderData
 {
 public:
@@ -223,7 +285,7 @@ public:
 
 	// Get coords
 	const LLVector3	*getCoords() const{
-		return mCoords;
+		return getVertexData()->mCoords;
 	}
 
 	// non const version
@@ -231,12 +293,12 @@ public:
 
 	// Get normals
 	const LLVector3	*getNormals() const{ 
-		return mNormals; 
+		return getVertexData()->mNormals; 
 	}
 
 	// Get normals
 	const LLVector3	*getBinormals() const{ 
-		return mBinormals; 
+		return getVertexData()->mBinormals; 
 	}
 
 	// Get base mesh normals
@@ -260,7 +322,7 @@ public:
 
 	// Get texCoords
 	const LLVector2	*getTexCoords() const { 
-		return mTexCoords; 
+		return getVertexData()->mTexCoords; 
 	}
 
 	// non const version
@@ -284,7 +346,7 @@ public:
 
 	const LLVector4		*getClothingWeights()
 	{
-		return mClothingWeights;	
+		return getVertexData()->mClothingWeights;	
 	}
 
 	//--------------------------------------------------------------------
@@ -327,6 +389,19 @@ public:
 	void setAvatar(LLVOAvatar* avatarp) { mAvatarp = avatarp; }
 	LLVOAvatar* getAvatar() { return mAvatarp; }
 
+	// Morph targets call this as they are set up, to be part of the key
+	// shareVertexData() uses.
+	void addMorphTarget(LLPolyMorphTarget* morph_target) { mMorphTargets.push_back(morph_target); }
+
+	// Switches to the vertex data of another mesh of the same kind whose
+	// morph targets have the same weights, or offers ours to later ones.
+	// Meshes with masked morphs keep their own.
+	void shareVertexData();
+
+	// Bytes of morphed vertex data all meshes use, counting shared data once
+	// per mesh using it (see LLPolyMeshVertexData::sBytes for the real total).
+	static S32 sVertexDataBytesUsed;
+
 	LLDynamicArray<LLJointRenderData*>	mJointRenderData;
 
 	U32				mFaceVertexOffset;
@@ -337,31 +412,29 @@ public:
 private:
 	void initializeForMorph();
 
+	// LOD meshes use the vertex data of their reference mesh
+	const LLPolyMeshVertexData* getVertexData() const { return mVertexData.notNull() ? mVertexData.get() : mReferenceMesh->mVertexData.get(); }
+	// Makes the data this mesh uses its own before it is modified
+	LLPolyMeshVertexData* getWritableVertexData();
+	void setVertexData(LLPolyMeshVertexData* vertex_data);
+
 	// Dumps diagnostic information about the global mesh table
 	static void dumpDiagInfo();
 
 protected:
 	// mesh data shared across all instances of a given mesh
 	LLPolyMeshSharedData	*mSharedData;
-	// Single array of floats for allocation / deletion
-	F32						*mVertexData;
-	// deformed vertices (resulting from application of morph targets)
-	LLVector3				*mCoords;
-	// deformed normals (resulting from application of morph targets)
-	LLVector3				*mScaledNormals;
-	// output normals (after normalization)
-	LLVector3				*mNormals;
-	// deformed binormals (resulting from application of morph targets)
-	LLVector3				*mScaledBinormals;
-	// output binormals (after normalization)
-	LLVector3				*mBinormals;
-	// weight values that mark verts as clothing/skin
-	LLVector4				*mClothingWeights;
-	// output texture coordinates
-	LLVector2				*mTexCoords;
+	// deformed vertices, normals and binormals (resulting from application
+	// of morph targets), output normals and binormals (after normalization),
+	// weight values that mark verts as clothing/skin and output texture
+	// coordinates.  NULL for LOD meshes.
+	LLPointer<LLPolyMeshVertexData> mVertexData;
 	
 	LLPolyMesh				*mReferenceMesh;
 
+	// morph targets deforming this mesh
+	std::vector<LLPolyMorphTarget*> mMorphTargets;
+
 	// global mesh list
 	typedef std::map<std::string, LLPolyMeshSharedData*> LLPolyMeshSharedDataTable; 
 	static LLPolyMeshSharedDataTable sGlobalSharedMeshList;
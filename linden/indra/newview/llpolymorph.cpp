@@ -298,6 +298,7 @@ BOOL LLPolyMorphTarget::setInfo(LLPolyMorphTargetInfo* info)
 		llwarns << "No morph target named " << getInfo()->mMorphName << " found in mesh." << llendl;
 		return FALSE;  // Continue, ignoring this tag
 	}
+	mMesh->addMorphTarget(this);
 	return TRUE;
 }
 
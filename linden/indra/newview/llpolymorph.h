@@ -167,6 +167,7 @@ public:
 
 	void	applyMask(U8 *maskData, S32 width, S32 height, S32 num_components, BOOL invert);
 	void	addPendingMorphMask() { mNumMorphMasksPending++; }
+	BOOL	isMasked() const { return mVertMask != NULL; }
 
 protected:
 	LLPolyMorphData*				mMorphData;
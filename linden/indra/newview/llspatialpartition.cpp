@@ -469,7 +469,7 @@ void validate_draw_info(LLDrawInfo& params)
 	
 	//bad indices
 	U32* indicesp = (U32*) params.mVertexBuffer->getIndicesPointer();
-	if (indicesp)
+	if (indicesp && !params.mVertexBuffer->isPooled())
 	{
 		for (U32 i = params.mOffset; i < params.mOffset+params.mCount; i++)
 		{
@@ -598,7 +598,7 @@ void LLSpatialPartition::rebuildGeom(LLSpatialGroup* group)
 	
 	addGeometryCount(group, vertex_count, index_count);
 
-	if (vertex_count > 0 && index_count > 0)
+	if (vertex_count > 0 && (index_count > 0 || !mIndexedGeometry))
 	{ //create vertex buffer containing volume geometry for this node
 		group->mBuilt = 1.f;
 		if (group->mVertexBuffer.isNull() || (group->mBufferUsage != group->mVertexBuffer->getUsage() && LLVertexBuffer::sEnableVBOs))
@@ -1369,6 +1369,7 @@ LLSpatialPartition::LLSpatialPartition(U32 data_mask, U32 buffer_usage)
 	mLODSeed = 0;
 	mLODPeriod = 1;
 	mVertexDataMask = data_mask;
+	mIndexedGeometry = TRUE;
 	mBufferUsage = buffer_usage;
 	mDepthMask = FALSE;
 	mSlopRatio = 0.25f;
@@ -1964,8 +1965,15 @@ void pushVerts(LLDrawInfo* params, U32 mask)
 {
 	LLRenderPass::applyModelMatrix(*params);
 	params->mVertexBuffer->setBuffer(mask);
-	params->mVertexBuffer->drawRange(params->mParticle ? LLRender::POINTS : LLRender::TRIANGLES,
+	if (params->mParticle)
+	{ // one vertex per particle, at its center
+		params->mVertexBuffer->drawArrays(LLRender::POINTS, params->mStart, params->mCount);
+	}
+	else
+	{
+		params->mVertexBuffer->drawRange(LLRender::TRIANGLES,
 								params->mStart, params->mEnd, params->mCount, params->mOffset);
+	}
 }
 
 void pushVerts(LLSpatialGroup* group, U32 mask)
@@ -2062,8 +2070,15 @@ void pushVertsColorCoded(LLSpatialGroup* group, U32 mask)
 			LLRenderPass::applyModelMatrix(*params);
 			glColor4f(colors[col].mV[0], colors[col].mV[1], colors[col].mV[2], 0.5f);
 			params->mVertexBuffer->setBuffer(mask);
-			params->mVertexBuffer->drawRange(params->mParticle ? LLRender::POINTS : LLRender::TRIANGLES,
-				params->mStart, params->mEnd, params->mCount, params->mOffset);
+			if (params->mParticle)
+			{
+				params->mVertexBuffer->drawArrays(LLRender::POINTS, params->mStart, params->mCount);
+			}
+			else
+			{
+				params->mVertexBuffer->drawRange(LLRender::TRIANGLES,
+					params->mStart, params->mEnd, params->mCount, params->mOffset);
+			}
 			col = (col+1)%col_count;
 		}
 	}
@@ -43,6 +43,7 @@
 #include "llcubemap.h"
 #include "lldrawpool.h"
 #include "llface.h"
+#include "llvopartgroup.h"
 
 #include <queue>
 
@@ -129,6 +130,34 @@ public:
 
 	};
 
+	struct CompareRenderState
+	{ //sort by texture, matrices, vertex buffer and then index offset, NULL at the end
+		bool operator()(const LLDrawInfo* const& lhs, const LLDrawInfo* const& rhs)
+		{
+			if (lhs == rhs || !lhs || !rhs)
+			{
+				return lhs != rhs && rhs == NULL;
+			}
+			if (lhs->mTexture.get() != rhs->mTexture.get())
+			{
+				return lhs->mTexture.get() > rhs->mTexture.get();
+			}
+			if (lhs->mTextureMatrix != rhs->mTextureMatrix)
+			{
+				return lhs->mTextureMatrix > rhs->mTextureMatrix;
+			}
+			if (lhs->mModelMatrix != rhs->mModelMatrix)
+			{
+				return lhs->mModelMatrix > rhs->mModelMatrix;
+			}
+			if (lhs->mVertexBuffer.get() != rhs->mVertexBuffer.get())
+			{
+				return lhs->mVertexBuffer.get() > rhs->mVertexBuffer.get();
+			}
+			return lhs->mOffset < rhs->mOffset;
+		}
+	};
+
 	struct CompareBump
 	{
 		bool operator()(const LLPointer<LLDrawInfo>& lhs, const LLPointer<LLDrawInfo>& rhs) 
@@ -377,6 +406,7 @@ public:
 	U32 mLODSeed;
 	U32 mLODPeriod;	//number of frames between LOD updates for a given spatial group (staggered by mLODSeed)
 	U32 mVertexDataMask;
+	BOOL mIndexedGeometry; // if FALSE, groups are drawn without indices (default TRUE)
 	F32 mSlopRatio; //percentage distance must change before drawables receive LOD update (default is 0.25);
 	BOOL mDepthMask; //if TRUE, objects in this partition will be written to depth during alpha rendering
 	U32 mDrawableType;
@@ -525,7 +555,14 @@ public:
 	virtual void addGeometryCount(LLSpatialGroup* group, U32 &vertex_count, U32& index_count);
 	virtual F32 calcPixelArea(LLSpatialGroup* group, LLCamera& camera);
 protected:
+	// Particles are gathered into records and either uploaded as they are,
+	// when drawn instanced, or expanded into quads all at once.
+	void getRecordGeometry(LLSpatialGroup* group);
+
 	U32 mRenderPass;
+	BOOL mUseRecords;		// the drawables are LLVOPartGroups
+	BOOL mAllowInstancing;
+	std::vector<LLParticleRecord> mRecords;
 };
 
 class LLHUDParticlePartition : public LLParticlePartition
@@ -559,6 +596,21 @@ public:
 	void genDrawInfo(LLSpatialGroup* group, U32 mask, std::vector<LLFace*>& faces, BOOL distance_sort = FALSE);
 	void registerFace(LLSpatialGroup* group, LLFace* facep, U32 type);
 
+	// Face geometry is queued once the face's vertex buffer is mapped and
+	// filled in by flushGeometry(), across LLThreadPool threads. The
+	// buffers must stay mapped until then; flushGeometry() unmaps them.
+	static void queueGeometry(LLFace* facep, U16 index_offset);
+	static void flushGeometry();
+
+private:
+	class GeometryJob;
+	struct GeometryItem
+	{
+		LLFace*	mFace;
+		U16		mIndexOffset;
+		BOOL	mRebuilt;
+	};
+	static std::vector<GeometryItem> sGeometryQueue;
 };
 
 //spatial partition that uses volume geometry manager (implemented in LLVOVolume.cpp)
@@ -70,6 +70,7 @@ S32 LLSurface::sTextureSize = 256;
 S32 LLSurface::sTexelsUpdated = 0;
 F32 LLSurface::sTextureUpdateTime = 0.f;
 LLStat LLSurface::sTexelsUpdatedPerSecStat;
+LLStat LLSurface::sPendingJobsStat;
 
 // ---------------- LLSurface:: Public Members ---------------
 
@@ -86,11 +87,11 @@ LLSurface::LLSurface(U32 type, LLViewerRegion *regionp) :
 	mGridsPerPatchEdge(0),
 	mMetersPerGrid(1.0f),
 	mMetersPerEdge(1.0f),
+	mPendingJobCount(0),
 	mRegionp(regionp)
 {
 	// Surface data
 	mSurfaceZ = NULL;
-	mNorm = NULL;
 
 	// Patch data
 	mPatchList = NULL;
@@ -120,8 +121,6 @@ LLSurface::~LLSurface()
 	delete [] mSurfaceZ;
 	mSurfaceZ = NULL;
 
-	delete [] mNorm;
-
 	mGridsPerEdge = 0;
 	mGridsPerPatchEdge = 0;
 	mPatchesPerEdge = 0;
@@ -190,15 +189,12 @@ void LLSurface::create(const S32 grids_per_edge,
 	// Initialize data arrays for surface
 	///
 	mSurfaceZ = new F32[number_of_grids];
-	mNorm = new LLVector3[number_of_grids];
 
 	// Reset the surface to be a flat square grid
 	for(S32 i=0; i < number_of_grids; i++) 
 	{
 		// Surface is flat and zero
-		// Normals all point up
 		mSurfaceZ[i] = 0.0f;
-		mNorm[i].setVec(0.f, 0.f, 1.f);
 	}
 
 
@@ -671,7 +667,7 @@ BOOL LLSurface::idleUpdate(F32 max_update_time)
 		getRegion()->dirtyHeights();
 	}
 
-	// Always call updateNormals() / updateVerticalStats()
+	// Always call updateNormals() / updateVerticalStats() / updateJobs()
 	//  every frame to avoid artifacts
 	for(std::set<LLSurfacePatch *>::iterator iter = mDirtyPatchList.begin();
 		iter != mDirtyPatchList.end(); )
@@ -680,9 +676,10 @@ BOOL LLSurface::idleUpdate(F32 max_update_time)
 		LLSurfacePatch *patchp = *curiter;
 		patchp->updateNormals();
 		patchp->updateVerticalStats();
+		BOOL jobs_done = patchp->updateJobs();
 		if (max_update_time == 0.f || update_timer.getElapsedTimeF32() < max_update_time)
 		{
-			if (patchp->updateTexture())
+			if (patchp->updateTexture() && jobs_done)
 			{
 				did_update = TRUE;
 				patchp->clearDirty();
@@ -1046,7 +1043,6 @@ void LLSurface::createPatchData()
 			S32 data_offset = i * mGridsPerPatchEdge + j * mGridsPerPatchEdge * mGridsPerEdge;
 
 			patchp->setDataZ(mSurfaceZ + data_offset);
-			patchp->setDataNorm(mNorm + data_offset);
 
 
 			// We make each patch point to its neighbors so we can do resolution checking 
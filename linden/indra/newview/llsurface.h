@@ -142,6 +142,7 @@ public:
 	void dirtyAllPatches();	// Use this to dirty all patches when changing terrain parameters
 
 	void dirtySurfacePatch(LLSurfacePatch *patchp);
+	S32 getPendingJobCount() const					{ return mPendingJobCount; }
 	LLVOWater *getWaterObj()						{ return mWaterObjp; }
 
 	static void setTextureSize(const S32 texture_size);
@@ -176,6 +177,7 @@ public:
 	static F32 sTextureUpdateTime;
 	static S32 sTexelsUpdated;
 	static LLStat sTexelsUpdatedPerSecStat;
+	static LLStat sPendingJobsStat;		// terrain jobs in flight, summed over every region
 
 protected:
 	void createSTexture();
@@ -201,9 +203,6 @@ protected:
 	// Array of grid data, mGridsPerEdge * mGridsPerEdge
 	F32 *mSurfaceZ;
 
-	// Array of grid normals, mGridsPerEdge * mGridsPerEdge
-	LLVector3 *mNorm;
-
 	std::set<LLSurfacePatch *> mDirtyPatchList;
 
 
@@ -227,6 +226,7 @@ protected:
 	F32			mMaxZ;					// max z for this region (during the session)
 
 	S32			mSurfacePatchUpdateCount;					// Number of frames since last update.
+	S32			mPendingJobCount;			// Patch jobs on the terrain job thread
 
 private:
 	LLViewerRegion *mRegionp; // Patch whose coordinate system this surface is using.
@@ -33,7 +33,10 @@
 #include "llviewerprecompiledheaders.h"
 
 #include "llsurfacepatch.h"
+#include "llappviewer.h"
 #include "llpatchvertexarray.h"
+#include "llterrainjobs.h"
+#include "llviewercontrol.h"
 #include "llviewerobjectlist.h"
 #include "llvosurfacepatch.h"
 #include "llsurface.h"
@@ -58,8 +61,11 @@ LLSurfacePatch::LLSurfacePatch() :
 	mDirty(FALSE),
 	mDirtyZStats(TRUE),
 	mHeightsGenerated(FALSE),
+	mGeometryDirty(FALSE),
 	mDataOffset(0),
 	mDataZ(NULL),
+	mTextureJob(LLQueuedThread::nullHandle()),
+	mGeometryJob(LLQueuedThread::nullHandle()),
 	mVObjp(NULL),
 	mOriginRegion(0.f, 0.f, 0.f),
 	mCenterRegion(0.f, 0.f, 0.f),
@@ -90,6 +96,18 @@ LLSurfacePatch::LLSurfacePatch() :
 
 LLSurfacePatch::~LLSurfacePatch()
 {
+	LLTerrainJobThread* thread = LLAppViewer::getTerrainJobThread();
+	if (thread)
+	{
+		if (mTextureJob != LLQueuedThread::nullHandle())
+		{
+			thread->cancelJob(mTextureJob);
+		}
+		if (mGeometryJob != LLQueuedThread::nullHandle())
+		{
+			thread->cancelJob(mGeometryJob);
+		}
+	}
 	mVObjp = NULL;
 }
 
@@ -213,155 +231,81 @@ void LLSurfacePatch::eval(const U32 x, const U32 y, const U32 stride, LLVector3
 		return; // failsafe
 	}
 	llassert_always(vertex && normal && tex0 && tex1);
-	
-	U32 surface_stride = mSurfacep->getGridsPerEdge();
-	U32 point_offset = x + y*surface_stride;
-
-	*normal = getNormal(x, y);
-
-	LLVector3 pos_agent = getOriginAgent();
-	pos_agent.mV[VX] += x * mSurfacep->getMetersPerGrid();
-	pos_agent.mV[VY] += y * mSurfacep->getMetersPerGrid();
-	pos_agent.mV[VZ]  = *(mDataZ + point_offset);
-	*vertex     = pos_agent;
-
-	LLVector3 rel_pos = pos_agent - mSurfacep->getOriginAgent();
-	LLVector3 tex_pos = rel_pos * (1.f/surface_stride);
-	tex0->mV[0]  = tex_pos.mV[0];
-	tex0->mV[1]  = tex_pos.mV[1];
-	tex1->mV[0] = mSurfacep->getRegion()->getCompositionXY(llfloor(mOriginRegion.mV[0])+x, llfloor(mOriginRegion.mV[1])+y);
-
-	const F32 xyScale = 4.9215f*7.f; //0.93284f;
-	const F32 xyScaleInv = (1.f / xyScale)*(0.2222222222f);
-
-	F32 vec[3] = {
-					fmod((F32)(mOriginGlobal.mdV[0] + x)*xyScaleInv, 256.f),
-					fmod((F32)(mOriginGlobal.mdV[1] + y)*xyScaleInv, 256.f),
-					0.f
-				};
-	F32 rand_val = llclamp(noise2(vec)* 0.75f + 0.5f, 0.f, 1.f);
-	tex1->mV[1] = rand_val;
 
+	if (mVertices.empty())
+	{
+		// Until the first geometry job is done, just the heights
+		*vertex = getPointAgent(x, y);
+		normal->setVec(0.f, 0.f, 1.f);
+		*tex0 = getTexCoords(x, y);
+		tex1->setVec(0.f, 0.5f);
+		return;
+	}
 
+	const LLTerrainVertex& point = mVertices[x + y*(mSurfacep->getGridsPerPatchEdge() + 1)];
+	*vertex = getOriginAgent() + point.mPosition;
+	*normal = point.mNormal;
+	*tex0 = point.mTexCoord0;
+	*tex1 = point.mTexCoord1;
 }
 
 
-void LLSurfacePatch::calcNormal(const U32 x, const U32 y, const U32 stride)
+F32 LLSurfacePatch::getNeighborZ(S32 x, S32 y) const
 {
-	U32 patch_width = mSurfacep->mPVArray.mPatchWidth;
+	S32 patch_width = (S32)mSurfacep->mPVArray.mPatchWidth;
 	U32 surface_stride = mSurfacep->getGridsPerEdge();
 
-	const F32 mpg = mSurfacep->getMetersPerGrid() * stride;
-
-	S32 poffsets[2][2][2];
-	poffsets[0][0][0] = x - stride;
-	poffsets[0][0][1] = y - stride;
-
-	poffsets[0][1][0] = x - stride;
-	poffsets[0][1][1] = y + stride;
-
-	poffsets[1][0][0] = x + stride;
-	poffsets[1][0][1] = y - stride;
-
-	poffsets[1][1][0] = x + stride;
-	poffsets[1][1][1] = y + stride;
-
-	const LLSurfacePatch *ppatches[2][2];
-
-	// LLVector3 p1, p2, p3, p4;
-
-	ppatches[0][0] = this;
-	ppatches[0][1] = this;
-	ppatches[1][0] = this;
-	ppatches[1][1] = this;
-
-	U32 i, j;
-	for (i = 0; i < 2; i++)
+	const LLSurfacePatch *patchp = this;
+	if (x < 0)
 	{
-		for (j = 0; j < 2; j++)
+		if (!patchp->getNeighborPatch(WEST))
 		{
-			if (poffsets[i][j][0] < 0)
-			{
-				if (!ppatches[i][j]->getNeighborPatch(WEST))
-				{
-					poffsets[i][j][0] = 0;
-				}
-				else
-				{
-					poffsets[i][j][0] += patch_width;
-					ppatches[i][j] = ppatches[i][j]->getNeighborPatch(WEST);
-				}
-			}
-			if (poffsets[i][j][1] < 0)
-			{
-				if (!ppatches[i][j]->getNeighborPatch(SOUTH))
-				{
-					poffsets[i][j][1] = 0;
-				}
-				else
-				{
-					poffsets[i][j][1] += patch_width;
-					ppatches[i][j] = ppatches[i][j]->getNeighborPatch(SOUTH);
-				}
-			}
-			if (poffsets[i][j][0] >= (S32)patch_width)
-			{
-				if (!ppatches[i][j]->getNeighborPatch(EAST))
-				{
-					poffsets[i][j][0] = patch_width - 1;
-				}
-				else
-				{
-					poffsets[i][j][0] -= patch_width;
-					ppatches[i][j] = ppatches[i][j]->getNeighborPatch(EAST);
-				}
-			}
-			if (poffsets[i][j][1] >= (S32)patch_width)
-			{
-				if (!ppatches[i][j]->getNeighborPatch(NORTH))
-				{
-					poffsets[i][j][1] = patch_width - 1;
-				}
-				else
-				{
-					poffsets[i][j][1] -= patch_width;
-					ppatches[i][j] = ppatches[i][j]->getNeighborPatch(NORTH);
-				}
-			}
+			x = 0;
+		}
+		else
+		{
+			x += patch_width;
+			patchp = patchp->getNeighborPatch(WEST);
+		}
+	}
+	if (y < 0)
+	{
+		if (!patchp->getNeighborPatch(SOUTH))
+		{
+			y = 0;
+		}
+		else
+		{
+			y += patch_width;
+			patchp = patchp->getNeighborPatch(SOUTH);
+		}
+	}
+	if (x >= patch_width)
+	{
+		if (!patchp->getNeighborPatch(EAST))
+		{
+			x = patch_width - 1;
+		}
+		else
+		{
+			x -= patch_width;
+			patchp = patchp->getNeighborPatch(EAST);
+		}
+	}
+	if (y >= patch_width)
+	{
+		if (!patchp->getNeighborPatch(NORTH))
+		{
+			y = patch_width - 1;
+		}
+		else
+		{
+			y -= patch_width;
+			patchp = patchp->getNeighborPatch(NORTH);
 		}
 	}
 
-	LLVector3 p00(-mpg,-mpg,
-				  *(ppatches[0][0]->mDataZ
-				  + poffsets[0][0][0]
-				  + poffsets[0][0][1]*surface_stride));
-	LLVector3 p01(-mpg,+mpg,
-				  *(ppatches[0][1]->mDataZ
-				  + poffsets[0][1][0]
-				  + poffsets[0][1][1]*surface_stride));
-	LLVector3 p10(+mpg,-mpg,
-				  *(ppatches[1][0]->mDataZ
-				  + poffsets[1][0][0]
-				  + poffsets[1][0][1]*surface_stride));
-	LLVector3 p11(+mpg,+mpg,
-				  *(ppatches[1][1]->mDataZ
-				  + poffsets[1][1][0]
-				  + poffsets[1][1][1]*surface_stride));
-
-	LLVector3 c1 = p11 - p00;
-	LLVector3 c2 = p01 - p10;
-
-	LLVector3 normal = c1;
-	normal %= c2;
-	normal.normVec();
-
-	*(mDataNorm + surface_stride * y + x) = normal;
-}
-
-const LLVector3 &LLSurfacePatch::getNormal(const U32 x, const U32 y) const
-{
-	U32 surface_stride = mSurfacep->getGridsPerEdge();
-	return *(mDataNorm + surface_stride * y + x);
+	return *(patchp->mDataZ + x + y*surface_stride);
 }
 
 
@@ -459,55 +403,17 @@ void LLSurfacePatch::updateNormals()
 	U32 grids_per_patch_edge = mSurfacep->getGridsPerPatchEdge();
 	U32 grids_per_edge = mSurfacep->getGridsPerEdge();
 
+	// The geometry job rebuilds all of the normals, so this only needs to
+	// know whether any are out of date.
 	BOOL dirty_patch = FALSE;
 
-	U32 i, j;
-	// update the east edge
-	if (mNormalsInvalid[EAST] || mNormalsInvalid[NORTHEAST] || mNormalsInvalid[SOUTHEAST])
-	{
-		for (j = 0; j <= grids_per_patch_edge; j++)
-		{
-			calcNormal(grids_per_patch_edge, j, 2);
-			calcNormal(grids_per_patch_edge - 1, j, 2);
-			calcNormal(grids_per_patch_edge - 2, j, 2);
-		}
-
-		dirty_patch = TRUE;
-	}
-
-	// update the north edge
-	if (mNormalsInvalid[NORTHEAST] || mNormalsInvalid[NORTH] || mNormalsInvalid[NORTHWEST])
-	{
-		for (i = 0; i <= grids_per_patch_edge; i++)
-		{
-			calcNormal(i, grids_per_patch_edge, 2);
-			calcNormal(i, grids_per_patch_edge - 1, 2);
-			calcNormal(i, grids_per_patch_edge - 2, 2);
-		}
-
-		dirty_patch = TRUE;
-	}
-
-	// update the west edge
-	if (mNormalsInvalid[NORTHWEST] || mNormalsInvalid[WEST] || mNormalsInvalid[SOUTHWEST])
-	{
-		for (j = 0; j < grids_per_patch_edge; j++)
-		{
-			calcNormal(0, j, 2);
-			calcNormal(1, j, 2);
-		}
-		dirty_patch = TRUE;
-	}
-
-	// update the south edge
-	if (mNormalsInvalid[SOUTHWEST] || mNormalsInvalid[SOUTH] || mNormalsInvalid[SOUTHEAST])
+	U32 i;
+	for (i = 0; i < 9; i++)
 	{
-		for (i = 0; i < grids_per_patch_edge; i++)
+		if (mNormalsInvalid[i])
 		{
-			calcNormal(i, 0, 2);
-			calcNormal(i, 1, 2);
+			dirty_patch = TRUE;
 		}
-		dirty_patch = TRUE;
 	}
 
 	// Invalidating the northeast corner is different, because depending on what the adjacent neighbors are,
@@ -581,28 +487,11 @@ void LLSurfacePatch::updateNormals()
 			// We've got a northeast patch in the same surface.
 			// The z and normals will be handled by that patch.
 		}
-		calcNormal(grids_per_patch_edge, grids_per_patch_edge, 2);
-		calcNormal(grids_per_patch_edge, grids_per_patch_edge - 1, 2);
-		calcNormal(grids_per_patch_edge - 1, grids_per_patch_edge, 2);
-		calcNormal(grids_per_patch_edge - 1, grids_per_patch_edge - 1, 2);
-		dirty_patch = TRUE;
-	}
-
-	// update the middle normals
-	if (mNormalsInvalid[MIDDLE])
-	{
-		for (j=2; j < grids_per_patch_edge - 2; j++)
-		{
-			for (i=2; i < grids_per_patch_edge - 2; i++)
-			{
-				calcNormal(i, j, 2);
-			}
-		}
-		dirty_patch = TRUE;
 	}
 
 	if (dirty_patch)
 	{
+		mGeometryDirty = TRUE;
 		mSurfacep->dirtySurfacePatch(this);
 	}
 
@@ -678,53 +567,35 @@ void LLSurfacePatch::updateNorthEdge()
 
 BOOL LLSurfacePatch::updateTexture()
 {
-	if (mSTexUpdate)		//  Update texture as needed
+	if (mTextureJob != LLQueuedThread::nullHandle())
 	{
-		F32 meters_per_grid = getSurface()->getMetersPerGrid();
-		F32 grids_per_patch_edge = (F32)getSurface()->getGridsPerPatchEdge();
+		// updateJobs() applies it
+		return FALSE;
+	}
 
+	if (mSTexUpdate)		//  Update texture as needed
+	{
 		if ((!getNeighborPatch(EAST) || getNeighborPatch(EAST)->getHasReceivedData())
 			&& (!getNeighborPatch(WEST) || getNeighborPatch(WEST)->getHasReceivedData())
 			&& (!getNeighborPatch(SOUTH) || getNeighborPatch(SOUTH)->getHasReceivedData())
 			&& (!getNeighborPatch(NORTH) || getNeighborPatch(NORTH)->getHasReceivedData()))
 		{
 			LLViewerRegion *regionp = getSurface()->getRegion();
-			LLVector3d origin_region = getOriginGlobal() - getSurface()->getOriginGlobal();
 
 			// Have to figure out a better way to deal with these edge conditions...
 			LLVLComposition* comp = regionp->getComposition();
-			if (!mHeightsGenerated)
+			if (!comp->getParamsReady())
 			{
-				F32 patch_size = meters_per_grid*(grids_per_patch_edge+1);
-				if (comp->generateHeights((F32)origin_region[VX], (F32)origin_region[VY],
-										  patch_size, patch_size))
-				{
-					mHeightsGenerated = TRUE;
-				}
-				else
-				{
-					return FALSE;
-				}
+				// All the parameters haven't been set yet (we haven't gotten the message from the sim)
+				return FALSE;
 			}
-			
-			if (comp->generateComposition())
-			{
-				if (mVObjp)
-				{
-					mVObjp->dirtyGeom();
-				}
-				updateCompositionStats();
-				F32 tex_patch_size = meters_per_grid*grids_per_patch_edge;
-				if (comp->generateTexture((F32)origin_region[VX], (F32)origin_region[VY],
-										  tex_patch_size, tex_patch_size))
-				{
-					mSTexUpdate = FALSE;
 
-					// Also generate the water texture
-					mSurfacep->generateWaterTexture((F32)origin_region.mdV[VX], (F32)origin_region.mdV[VY],
-													tex_patch_size, tex_patch_size);
-					return TRUE;
-				}
+			// The composition values only depend on the heights, so they are
+			// generated once even if the detail textures aren't loaded yet.
+			BOOL generate_texels = comp->generateComposition();
+			if (!mHeightsGenerated || generate_texels)
+			{
+				startTextureJob(!mHeightsGenerated, generate_texels);
 			}
 		}
 		return FALSE;
@@ -736,6 +607,144 @@ BOOL LLSurfacePatch::updateTexture()
 }
 
 
+BOOL LLSurfacePatch::updateJobs()
+{
+	LLTerrainJobThread* thread = LLAppViewer::getTerrainJobThread();
+	if (thread && mTextureJob != LLQueuedThread::nullHandle())
+	{
+		LLPatchTextureJob* job = (LLPatchTextureJob*)thread->getFinishedJob(mTextureJob);
+		if (job)
+		{
+			finishTextureJob(job);
+			thread->completeJob(mTextureJob);
+			mTextureJob = LLQueuedThread::nullHandle();
+			mSurfacep->mPendingJobCount--;
+		}
+	}
+	if (thread && mGeometryJob != LLQueuedThread::nullHandle())
+	{
+		LLPatchGeometryJob* job = (LLPatchGeometryJob*)thread->getFinishedJob(mGeometryJob);
+		if (job)
+		{
+			finishGeometryJob(job);
+			thread->completeJob(mGeometryJob);
+			mGeometryJob = LLQueuedThread::nullHandle();
+			mSurfacep->mPendingJobCount--;
+		}
+	}
+
+	if (mGeometryDirty && mGeometryJob == LLQueuedThread::nullHandle())
+	{
+		startGeometryJob();
+	}
+
+	return mTextureJob == LLQueuedThread::nullHandle() && mGeometryJob == LLQueuedThread::nullHandle() && !mGeometryDirty;
+}
+
+
+void LLSurfacePatch::startTextureJob(BOOL generate_heights, BOOL generate_texels)
+{
+	LLPatchTextureJob* job = new LLPatchTextureJob;
+	if (!job->prepare(this, generate_heights, generate_texels))
+	{
+		delete job;
+		return;
+	}
+
+	// Cleared now, so that new heights arriving while the job runs ask for
+	// another one
+	if (job->generatedHeights())
+	{
+		mHeightsGenerated = TRUE;
+	}
+	if (job->generatedTexels())
+	{
+		mSTexUpdate = FALSE;
+	}
+
+	static LLCachedControl<BOOL> threaded_jobs("ThreadedTerrainJobs", TRUE);
+	LLTerrainJobThread* thread = LLAppViewer::getTerrainJobThread();
+	if (threaded_jobs && thread)
+	{
+		mTextureJob = thread->addJob(job);
+		mSurfacep->mPendingJobCount++;
+	}
+	else
+	{
+		job->run();
+		finishTextureJob(job);
+		delete job;
+	}
+}
+
+
+void LLSurfacePatch::finishTextureJob(LLPatchTextureJob* job)
+{
+	LLTimer upload_timer;
+	LLVLComposition* comp = mSurfacep->getRegion()->getComposition();
+	job->finish(comp, mSurfacep->getSTexture());
+
+	if (job->generatedHeights())
+	{
+		// The vertices carry the composition too
+		mGeometryDirty = TRUE;
+		mSurfacep->dirtySurfacePatch(this);
+	}
+	updateCompositionStats();
+
+	if (job->generatedTexels())
+	{
+		// Also generate the water texture
+		LLVector3d origin_region = getOriginGlobal() - getSurface()->getOriginGlobal();
+		F32 tex_patch_size = getSurface()->getMetersPerGrid()*(F32)getSurface()->getGridsPerPatchEdge();
+		mSurfacep->generateWaterTexture((F32)origin_region.mdV[VX], (F32)origin_region.mdV[VY],
+										tex_patch_size, tex_patch_size);
+
+		comp->unboostDetailTextures();
+		LLSurface::sTextureUpdateTime += job->getRunTime() + upload_timer.getElapsedTimeF32();
+		LLSurface::sTexelsUpdated += job->getTexelCount();
+	}
+
+	if (mVObjp)
+	{
+		mVObjp->dirtyGeom();
+	}
+}
+
+
+void LLSurfacePatch::startGeometryJob()
+{
+	mGeometryDirty = FALSE;
+
+	LLPatchGeometryJob* job = new LLPatchGeometryJob;
+	job->prepare(this);
+
+	static LLCachedControl<BOOL> threaded_jobs("ThreadedTerrainJobs", TRUE);
+	LLTerrainJobThread* thread = LLAppViewer::getTerrainJobThread();
+	if (threaded_jobs && thread)
+	{
+		mGeometryJob = thread->addJob(job);
+		mSurfacep->mPendingJobCount++;
+	}
+	else
+	{
+		job->run();
+		finishGeometryJob(job);
+		delete job;
+	}
+}
+
+
+void LLSurfacePatch::finishGeometryJob(LLPatchGeometryJob* job)
+{
+	mVertices.swap(job->mVertices);
+	if (mVObjp)
+	{
+		mVObjp->dirtyGeom();
+	}
+}
+
+
 void LLSurfacePatch::dirtyZ()
 {
 	mSTexUpdate = TRUE;
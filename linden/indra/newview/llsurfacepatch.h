@@ -33,15 +33,21 @@
 #ifndef LL_LLSURFACEPATCH_H
 #define LL_LLSURFACEPATCH_H
 
+#include "v2math.h"
 #include "v3math.h"
 #include "v3dmath.h"
 #include "llmemory.h"
+#include "llqueuedthread.h"
+#include "llterraingen.h"
+
+#include <vector>
 
 class LLSurface;
 class LLVOSurfacePatch;
-class LLVector2;
 class LLColor4U;
 class LLAgent;
+class LLPatchTextureJob;
+class LLPatchGeometryJob;
 
 // A patch shouldn't know about its visibility since that really depends on the 
 // camera that is looking (or not looking) at it.  So, anything about a patch
@@ -80,6 +86,9 @@ public:
 	void colorPatch(const U8 r, const U8 g, const U8 b);
 
 	BOOL updateTexture();
+	// Applies finished texture and geometry jobs and starts a geometry job
+	// if the normals changed.  Returns TRUE once no job is left.
+	BOOL updateJobs();
 
 	void updateVerticalStats();
 	void updateCompositionStats();
@@ -107,8 +116,10 @@ public:
 	LLVector3 getPointAgent(const U32 x, const U32 y) const; // get the point at the offset.
 	LLVector2 getTexCoords(const U32 x, const U32 y) const;
 
-	void calcNormal(const U32 x, const U32 y, const U32 stride);
-	const LLVector3 &getNormal(const U32 x, const U32 y) const;
+	// Height at a grid point up to a patch width outside this patch, read
+	// from the neighbor patches, or clamped to this patch where there is
+	// no neighbor.
+	F32 getNeighborZ(S32 x, S32 y) const;
 
 	void eval(const U32 x, const U32 y, const U32 stride,
 				LLVector3 *vertex, LLVector3 *normal, LLVector2 *tex0, LLVector2 *tex1);
@@ -135,7 +146,6 @@ public:
 
 	void setSurface(LLSurface *surfacep);
 	void setDataZ(F32 *data_z)					{ mDataZ = data_z; }
-	void setDataNorm(LLVector3 *data_norm)		{ mDataNorm = data_norm; }
 	F32 *getDataZ() const						{ return mDataZ; }
 
 	void dirty();			// Mark this surface patch as dirty...
@@ -154,10 +164,17 @@ protected:
 	BOOL mDirty;
 	BOOL mDirtyZStats;
 	BOOL mHeightsGenerated;
+	BOOL mGeometryDirty;	// The normals need to be rebuilt
 
 	U32 mDataOffset;
 	F32 *mDataZ;
-	LLVector3 *mDataNorm;
+
+	// Jobs on the terrain job thread, or null handles
+	LLQueuedThread::handle_t mTextureJob;
+	LLQueuedThread::handle_t mGeometryJob;
+
+	// Results of the last geometry job, what eval() returns
+	std::vector<LLTerrainVertex> mVertices;
 
 	// Pointer to the LLVOSurfacePatch object which is used in the new renderer.
 	LLPointer<LLVOSurfacePatch> mVObjp;
@@ -184,6 +201,15 @@ protected:
 	U64 mLastUpdateTime;	// Time patch was last updated
 
 	LLSurface *mSurfacep; // Pointer to "parent" surface
+
+	friend class LLPatchTextureJob;
+	friend class LLPatchGeometryJob;
+
+private:
+	void startTextureJob(BOOL generate_heights, BOOL generate_texels);
+	void finishTextureJob(LLPatchTextureJob* job);
+	void startGeometryJob();
+	void finishGeometryJob(LLPatchGeometryJob* job);
 };
 
 
@@ -0,0 +1,172 @@
+/**
+ * @file llterrainjobs.cpp
+ * @brief Terrain jobs fed from and applied to surface patches.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llterrainjobs.h"
+
+#include "llregionhandle.h" // for from_region_handle
+#include "llsurface.h"
+#include "llsurfacepatch.h"
+#include "llviewerimage.h"
+#include "llviewerregion.h"
+#include "llvlcomposition.h"
+
+LLPointer<LLImageRaw> LLPatchTextureJob::sUploadImage;
+
+//-----------------------------------------------------------------------------
+// LLPatchTextureJob
+//-----------------------------------------------------------------------------
+BOOL LLPatchTextureJob::prepare(LLSurfacePatch* patchp, BOOL generate_heights, BOOL generate_texels)
+{
+	LLSurface* surfacep = patchp->getSurface();
+	LLViewerRegion* regionp = surfacep->getRegion();
+	if (!regionp)
+	{
+		// We don't always have the region yet here....
+		return FALSE;
+	}
+	LLVLComposition* compp = regionp->getComposition();
+	LLViewerImage* texturep = surfacep->getSTexture();
+
+	generate_texels = generate_texels && compp->getDetailRawImages(mDetailImages);
+	if (generate_texels && texturep->getComponents() != 3)
+	{
+		llwarns << "Base texture comps != input texture comps" << llendl;
+		generate_texels = FALSE;
+	}
+	if (!generate_heights && !generate_texels)
+	{
+		return FALSE;
+	}
+
+	LLVector3d origin_region = patchp->getOriginGlobal() - surfacep->getOriginGlobal();
+	const F32 x = (F32)origin_region.mdV[VX];
+	const F32 y = (F32)origin_region.mdV[VY];
+	const F32 meters_per_grid = surfacep->getMetersPerGrid();
+	const F32 grids_per_patch_edge = (F32)surfacep->getGridsPerPatchEdge();
+
+	// The composition samples of the patch, with its north and east edges
+	setComposition(compp->mDatap, compp->mWidth, compp->mScale, x, y, meters_per_grid*(grids_per_patch_edge+1));
+
+	if (generate_heights)
+	{
+		std::vector<F32> heights(mCompWidth * mCompHeight);
+		for (S32 j = 0; j < mCompHeight; j++)
+		{
+			for (S32 i = 0; i < mCompWidth; i++)
+			{
+				LLVector3 location((mCompX + i)*mLayerScale, (mCompY + j)*mLayerScale, 0.f);
+				heights[j*mCompWidth + i] = surfacep->resolveHeightRegion(location);
+			}
+		}
+		setHeights(&heights[0], compp->mStartHeight, compp->mHeightRange, from_region_handle(regionp->getHandle()));
+	}
+
+	if (generate_texels)
+	{
+		const U8* detail_data[CORNER_COUNT];
+		S32 detail_data_size[CORNER_COUNT];
+		for (S32 i = 0; i < CORNER_COUNT; i++)
+		{
+			detail_data[i] = mDetailImages[i]->getData();
+			detail_data_size[i] = mDetailImages[i]->getDataSize();
+		}
+		setTexels(detail_data, detail_data_size, compp->mTexScaleX, compp->mTexScaleY,
+				  texturep->getWidth(), texturep->getHeight(), x, y, meters_per_grid*grids_per_patch_edge);
+	}
+
+	return TRUE;
+}
+
+void LLPatchTextureJob::finish(LLVLComposition* compp, LLViewerImage* texturep)
+{
+	copyComposition(compp->mDatap);
+
+	if (mGenerateTexels && texturep && mTexWidth > 0 && mTexHeight > 0
+		&& texturep->getWidth() == mSurfaceTexWidth && texturep->getHeight() == mSurfaceTexHeight)
+	{
+		const S32 tex_comps = 3;
+		if (sUploadImage.isNull()
+			|| sUploadImage->getWidth() != mSurfaceTexWidth
+			|| sUploadImage->getHeight() != mSurfaceTexHeight)
+		{
+			sUploadImage = new LLImageRaw(mSurfaceTexWidth, mSurfaceTexHeight, tex_comps);
+		}
+		copyTexels(sUploadImage->getData());
+		texturep->setSubImage(sUploadImage, mTexX, mTexY, mTexWidth, mTexHeight);
+	}
+
+	// Reference counts aren't thread safe, so these go here rather than
+	// wherever the thread deletes the job.
+	for (S32 i = 0; i < CORNER_COUNT; i++)
+	{
+		mDetailImages[i] = NULL;
+	}
+}
+
+// static
+void LLPatchTextureJob::cleanupClass()
+{
+	sUploadImage = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// LLPatchGeometryJob
+//-----------------------------------------------------------------------------
+void LLPatchGeometryJob::prepare(LLSurfacePatch* patchp)
+{
+	LLSurface* surfacep = patchp->getSurface();
+	LLViewerRegion* regionp = surfacep->getRegion();
+
+	const S32 points = surfacep->getGridsPerPatchEdge() + 1;
+	const S32 grids_per_edge = surfacep->getGridsPerEdge();
+	setPatch(points, grids_per_edge, surfacep->getMetersPerGrid(), patchp->mOriginRegion, patchp->getOriginGlobal());
+
+	// Composition is looked up through the world for the points on the
+	// region's north and east edges.
+	const S32 origin_x = llfloor(mOriginRegion.mV[VX]);
+	const S32 origin_y = llfloor(mOriginRegion.mV[VY]);
+	const F32* data_z = patchp->getDataZ();
+	for (S32 y = 0; y < points; y++)
+	{
+		for (S32 x = 0; x < points; x++)
+		{
+			setPoint(x, y, *(data_z + x + y*grids_per_edge),
+					 regionp ? regionp->getCompositionXY(origin_x + x, origin_y + y) : 0.f);
+		}
+	}
+
+	// As calcNormal() read them
+	for (S32 y = -2; y < points + 2; y++)
+	{
+		for (S32 x = -2; x < points + 2; x++)
+		{
+			setNormalHeight(x, y, patchp->getNeighborZ(x, y));
+		}
+	}
+}
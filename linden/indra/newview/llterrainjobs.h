@@ -0,0 +1,70 @@
+/**
+ * @file llterrainjobs.h
+ * @brief Terrain jobs fed from and applied to surface patches.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLTERRAINJOBS_H
+#define LL_LLTERRAINJOBS_H
+
+#include "llterraingen.h"
+#include "llimage.h"
+
+class LLSurfacePatch;
+class LLViewerImage;
+class LLVLComposition;
+
+// prepare() copies what the job reads from the patch, its region's
+// composition and detail textures.  finish() stores the composition values
+// and uploads the texels.  Both are MAIN THREAD only.
+class LLPatchTextureJob : public LLTerrainTextureJob
+{
+public:
+	// Returns FALSE if there is nothing to do, or the detail textures have
+	// no raw images to blend yet.
+	BOOL prepare(LLSurfacePatch* patchp, BOOL generate_heights, BOOL generate_texels);
+
+	void finish(LLVLComposition* compp, LLViewerImage* texturep);
+
+	static void cleanupClass();
+
+private:
+	// The references are only taken and dropped on the main thread
+	LLPointer<LLImageRaw> mDetailImages[CORNER_COUNT];
+
+	// Full size scratch image that finished jobs copy texels into, since
+	// setSubImage() reads the source at the destination offset.
+	static LLPointer<LLImageRaw> sUploadImage;
+};
+
+// Copies the heights, composition and neighboring heights of a patch, for
+// LLVOSurfacePatch to read the vertices from once the job is done.
+class LLPatchGeometryJob : public LLTerrainGeometryJob
+{
+public:
+	// MAIN THREAD
+	void prepare(LLSurfacePatch* patchp);
+};
+
+#endif // LL_LLTERRAINJOBS_H
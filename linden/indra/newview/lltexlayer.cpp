@@ -34,6 +34,7 @@
 
 #include "imageids.h"
 #include "llagent.h"
+#include "llappviewer.h"
 #include "llcrc.h"
 #include "lldir.h"
 #include "llglheaders.h"
@@ -45,6 +46,7 @@
 #include "lltexlayer.h"
 #include "llui.h"
 #include "llvfile.h"
+#include "llviewercontrol.h"
 #include "llviewerimagelist.h"
 #include "llviewerimagelist.h"
 #include "llviewerregion.h"
@@ -63,6 +65,33 @@ using namespace LLVOAvatarDefines;
 
 const S32 MAX_BAKE_UPLOAD_ATTEMPTS = 4;
 
+// Interleaves a composite with its mask into the 5 channel image bakes are
+// uploaded as, and encodes it.  Returns NULL if encoding failed.
+static LLPointer<LLImageJ2C> encode_baked_image(const U8* color_data, const U8* mask_data, S32 width, S32 height)
+{
+	S32 baked_image_components =  5; // red green blue bump clothing
+	LLPointer<LLImageRaw> baked_image = new LLImageRaw( width, height, baked_image_components );
+	U8* baked_image_data = baked_image->getData();
+	
+	const char* comment_text = LINDEN_J2C_COMMENT_PREFIX "RGBHM"; // 5 channels: rgb, heightfield/alpha, mask
+	for (S32 i = 0; i < width * height; i++)
+	{
+		baked_image_data[5 * i + 0] = color_data[4 * i + 0];
+		baked_image_data[5 * i + 1] = color_data[4 * i + 1];
+		baked_image_data[5 * i + 2] = color_data[4 * i + 2];
+		baked_image_data[5 * i + 3] = color_data[4 * i + 3]; // alpha should be correct for eyelashes.
+		baked_image_data[5 * i + 4] = mask_data[i];
+	}
+	
+	LLPointer<LLImageJ2C> compressed_image = new LLImageJ2C;
+	compressed_image->setRate(0.f);
+	if (!compressed_image->encode(baked_image, comment_text))
+	{
+		return NULL;
+	}
+	return compressed_image;
+}
+
 // static
 S32 LLTexLayerSetBuffer::sGLByteCount = 0;
 
@@ -102,7 +131,9 @@ LLTexLayerSetBuffer::LLTexLayerSetBuffer(LLTexLayerSet* owner, S32 width, S32 he
 	mUploadPending( FALSE ), // Not used for any logic here, just to sync sending of updates
 	mUploadFailCount( 0 ),
 	mUploadAfter( 0 ),
-	mTexLayerSet( owner )	
+	mTexLayerSet( owner ),
+	mBakeHandle( LLQueuedThread::nullHandle() ),
+	mBakeCanceled( FALSE )
 {
 	LLTexLayerSetBuffer::sGLByteCount += getSize();
 }
@@ -111,6 +142,20 @@ LLTexLayerSetBuffer::~LLTexLayerSetBuffer()
 {
 	LLTexLayerSetBuffer::sGLByteCount -= getSize();
 	destroyGLTexture();
+	LLTexLayerBakeThread* bake_thread = LLAppViewer::getTexLayerBakeThread();
+	if (bake_thread && mBakeHandle != LLQueuedThread::nullHandle())
+	{
+		// Let the thread delete a bake still in flight when it gets to it.
+		LLQueuedThread::status_t status = bake_thread->getRequestStatus(mBakeHandle);
+		if (status == LLQueuedThread::STATUS_QUEUED || status == LLQueuedThread::STATUS_INPROGRESS)
+		{
+			bake_thread->abortRequest(mBakeHandle, true);
+		}
+		else
+		{
+			bake_thread->completeRequest(mBakeHandle);
+		}
+	}
 	for (S32 order = 0; order < ORDER_COUNT; order++)
 	{
 		LLDynamicTexture::sInstances[order].erase(this);  // will fail in all but one case.
@@ -147,6 +192,8 @@ void LLTexLayerSetBuffer::requestUpdate()
 	// If we're in the middle of uploading a baked texture, we don't care about it any more.
 	// When it's downloaded, ignore it.
 	mUploadID.setNull();
+	// Same for one still being baked: drop it and bake again.
+	mBakeCanceled = TRUE;
 }
 
 void LLTexLayerSetBuffer::requestUpload()
@@ -178,12 +225,14 @@ void LLTexLayerSetBuffer::cancelUpload()
 	}
 	mUploadPending = FALSE;
 	mUploadAfter = 0;
+	mBakeCanceled = TRUE;
 }
 
 // do we need to upload, and do we have sufficient data to create an uploadable composite?
 BOOL LLTexLayerSetBuffer::needsUploadNow() const
 {
 	BOOL upload = mNeedsUpload && mTexLayerSet->isLocalTextureDataFinal() && (gAgent.mNumPendingQueries == 0);
+	upload &= (mBakeHandle == LLQueuedThread::nullHandle());
 	return (upload && (LLFrameTimer::getTotalTime() > mUploadAfter));
 }
 
@@ -210,6 +259,8 @@ void LLTexLayerSetBuffer::popProjection()
 
 BOOL LLTexLayerSetBuffer::needsRender()
 {
+	updateCPUBake();
+
 	LLVOAvatar* avatar = mTexLayerSet->getAvatar();
 	BOOL upload_now = needsUploadNow();
 	BOOL needs_update = (mNeedsUpdate || upload_now) && !avatar->mAppearanceAnimating;
@@ -272,7 +323,7 @@ BOOL LLTexLayerSetBuffer::render()
 		{
 			if (mTexLayerSet->isVisible())
 			{
-				readBackAndUpload();
+				bakeAndUpload();
 			}
 			else
 			{
@@ -284,7 +335,7 @@ BOOL LLTexLayerSetBuffer::render()
 					avatar->setNewBakedTexture(avatar->getBakedTE(mTexLayerSet), IMG_INVISIBLE);
 					llinfos << "Invisible baked texture set for " << mTexLayerSet->getBodyRegion() << llendl;
 				}
-				readBackAndUpload();   //... here: Opensim is not happy if we don't
+				bakeAndUpload();   //... here: Opensim is not happy if we don't
 				//TODO: find out if SL is happy if we do
 			}
 		}
@@ -321,6 +372,18 @@ BOOL LLTexLayerSetBuffer::updateImmediate()
 	return result;
 }
 
+// Uploads the composite that was just rendered.  When every image it was
+// made from is in memory it is composited again and encoded on the bake
+// thread, which keeps the readback and the encoding off the frame.
+void LLTexLayerSetBuffer::bakeAndUpload()
+{
+	static LLCachedControl<BOOL> bake_on_cpu("AvatarBakeOnCPU", TRUE);
+	if (!bake_on_cpu || !LLAppViewer::getTexLayerBakeThread() || !startCPUBake())
+	{
+		readBackAndUpload();
+	}
+}
+
 void LLTexLayerSetBuffer::readBackAndUpload()
 {
 	// pointers for storing data to upload
@@ -347,107 +410,168 @@ void LLTexLayerSetBuffer::readBackAndUpload()
 	mTexLayerSet->gatherAlphaMasks(baked_mask_data, mWidth, mHeight);
 //	imdebug("lum b=8 w=%d h=%d %p", mWidth, mHeight, baked_mask_data);
 
+	LLPointer<LLImageJ2C> compressedImage = encode_baked_image(baked_color_data, baked_mask_data, mWidth, mHeight);
+	if (compressedImage.notNull())
+	{
+		uploadBakedImage(compressedImage);
+	}
+	else
+	{
+		mUploadPending = FALSE;
+		llinfos << "unable to create baked upload file" << llendl;
+	}
 
-	// writes into baked_color_data
-	const char* comment_text = NULL;
+	delete [] baked_color_data;
+}
 
-	S32 baked_image_components =  5; // red green blue bump clothing
-	LLPointer<LLImageRaw> baked_image = new LLImageRaw( mWidth, mHeight, baked_image_components );
-	U8* baked_image_data = baked_image->getData();
-	
-	comment_text = LINDEN_J2C_COMMENT_PREFIX "RGBHM"; // 5 channels: rgb, heightfield/alpha, mask
-	S32 i = 0;
-	for (S32 u = 0; u < mWidth; u++)
+// Records the composite and its mask for the bake thread.  Returns FALSE,
+// without starting anything, if one of the images is only on the GPU.
+BOOL LLTexLayerSetBuffer::startCPUBake()
+{
+	LLImageCompositor color_compositor;
+	LLImageCompositor mask_compositor;
+	if (!mTexLayerSet->render(color_compositor) || !mTexLayerSet->gatherAlphaMasks(mask_compositor))
+	{
+		return FALSE;
+	}
+
+	// The GL composite is what the CPU one has to match
+	LLPointer<LLImageRaw> compare_image;
+	static LLCachedControl<BOOL> compare_bakes("DebugAvatarBakeCompare", FALSE);
+	if (compare_bakes)
+	{
+		compare_image = new LLImageRaw(mWidth, mHeight, 4);
+		glReadPixels(mOrigin.mX, mOrigin.mY, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, compare_image->getData());
+		stop_glerror();
+	}
+
+	llinfos << "Baking " << mTexLayerSet->getBodyRegion() << " in the background" << llendl;
+	LLViewerStats::getInstance()->incStat(LLViewerStats::ST_TEX_BAKES);
+
+	llassert( gAgent.getAvatarObject() == mTexLayerSet->getAvatar() );
+
+	// As in readBackAndUpload().  The recorded drawing holds on to the images
+	// it needs.
+	mTexLayerSet->deleteCaches();
+
+	mBakeHandle = LLAppViewer::getTexLayerBakeThread()->bake(mWidth, mHeight, color_compositor, mask_compositor, compare_image);
+	mBakeCanceled = FALSE;
+	return TRUE;
+}
+
+// Uploads the result of the CPU bake once the bake thread is done with it.
+void LLTexLayerSetBuffer::updateCPUBake()
+{
+	LLTexLayerBakeThread* bake_thread = LLAppViewer::getTexLayerBakeThread();
+	if (!bake_thread || mBakeHandle == LLQueuedThread::nullHandle())
 	{
-		for (S32 v = 0; v < mHeight; v++)
+		return;
+	}
+
+	LLQueuedThread::status_t status = bake_thread->getRequestStatus(mBakeHandle);
+	if (status == LLQueuedThread::STATUS_QUEUED || status == LLQueuedThread::STATUS_INPROGRESS)
+	{
+		return;
+	}
+
+	LLTexLayerBakeThread::BakeRequest* request = bake_thread->getBakeRequest(mBakeHandle);
+	if (request && status == LLQueuedThread::STATUS_COMPLETE && !mBakeCanceled)
+	{
+		llinfos << "Baked " << mTexLayerSet->getBodyRegion() << ": composited in "
+				<< llformat("%.1f", request->mCompositeTime * 1000.f) << " ms, encoded in "
+				<< llformat("%.1f", request->mEncodeTime * 1000.f) << " ms" << llendl;
+		if (request->mMaxDifference >= 0)
+		{
+			llinfos << "CPU bake differs from the GL one by up to " << request->mMaxDifference
+					<< ", " << request->mMeanDifference << " on average" << llendl;
+		}
+
+		if (request->mCompressedImage.notNull())
 		{
-			baked_image_data[5 * i + 0] = baked_color_data[4 * i + 0];
-			baked_image_data[5 * i + 1] = baked_color_data[4 * i + 1];
-			baked_image_data[5 * i + 2] = baked_color_data[4 * i + 2];
-			baked_image_data[5 * i + 3] = baked_color_data[4 * i + 3]; // alpha should be correct for eyelashes.
-			baked_image_data[5 * i + 4] = baked_mask_data[i];
-			i++;
+			uploadBakedImage(request->mCompressedImage);
+		}
+		else
+		{
+			mUploadPending = FALSE;
+			llinfos << "unable to create baked upload file" << llendl;
 		}
 	}
-	
-	LLPointer<LLImageJ2C> compressedImage = new LLImageJ2C;
-	compressedImage->setRate(0.f);
+	bake_thread->completeRequest(mBakeHandle);
+	mBakeHandle = LLQueuedThread::nullHandle();
+}
+
+void LLTexLayerSetBuffer::uploadBakedImage(LLImageJ2C* compressedImage)
+{
 	LLTransactionID tid;
 	LLAssetID asset_id;
 	tid.generate();
 	asset_id = tid.makeAssetID(gAgent.getSecureSessionID());
 
-	BOOL res = false;
-	if( compressedImage->encode(baked_image, comment_text))
+	BOOL res = LLVFile::writeFile(compressedImage->getData(), compressedImage->getDataSize(),
+								  gVFS, asset_id, LLAssetType::AT_TEXTURE);
+	if (res)
 	{
-		res = LLVFile::writeFile(compressedImage->getData(), compressedImage->getDataSize(),
-								 gVFS, asset_id, LLAssetType::AT_TEXTURE);
-		if (res)
+		LLPointer<LLImageJ2C> integrity_test = new LLImageJ2C;
+		BOOL valid = FALSE;
+		S32 file_size;
+		U8* data = LLVFile::readFile(gVFS, asset_id, LLAssetType::AT_TEXTURE, &file_size);
+		if (data)
 		{
-			LLPointer<LLImageJ2C> integrity_test = new LLImageJ2C;
-			BOOL valid = FALSE;
-			S32 file_size;
-			U8* data = LLVFile::readFile(gVFS, asset_id, LLAssetType::AT_TEXTURE, &file_size);
-			if (data)
-			{
-				valid = integrity_test->validate(data, file_size); // integrity_test will delete 'data'
-			}
-			else
-			{
-				integrity_test->setLastError("Unable to read entire file");
-			}
+			valid = integrity_test->validate(data, file_size); // integrity_test will delete 'data'
+		}
+		else
+		{
+			integrity_test->setLastError("Unable to read entire file");
+		}
+		
+		if( valid )
+		{
+			// baked_upload_data is owned by the responder and deleted after the request completes
+			LLBakedUploadData* baked_upload_data =
+				new LLBakedUploadData( gAgent.getAvatarObject(), this->mTexLayerSet, this, asset_id );
+			mUploadID = asset_id;
 			
-			if( valid )
+			// upload the image
+			std::string url = gAgent.getRegion()->getCapability("UploadBakedTexture");
+
+			if(!url.empty()
+				&& !LLPipeline::sForceOldBakedUpload // Toggle the debug setting UploadBakedTexOld to change between the new caps method and old method
+				&& (mUploadFailCount < MAX_BAKE_UPLOAD_ATTEMPTS-1)) // allow last ditch attempt via asset store, since capabilty seems prone to transient failures.
 			{
-				// baked_upload_data is owned by the responder and deleted after the request completes
-				LLBakedUploadData* baked_upload_data =
-					new LLBakedUploadData( gAgent.getAvatarObject(), this->mTexLayerSet, this, asset_id );
-				mUploadID = asset_id;
-				
-				// upload the image
-				std::string url = gAgent.getRegion()->getCapability("UploadBakedTexture");
-
-				if(!url.empty()
-					&& !LLPipeline::sForceOldBakedUpload // Toggle the debug setting UploadBakedTexOld to change between the new caps method and old method
-					&& (mUploadFailCount < MAX_BAKE_UPLOAD_ATTEMPTS-1)) // allow last ditch attempt via asset store, since capabilty seems prone to transient failures.
-				{
-					llinfos << "Baked texture upload via capability of " << mUploadID << " to " << url << llendl;
+				llinfos << "Baked texture upload via capability of " << mUploadID << " to " << url << llendl;
 
-					LLSD body = LLSD::emptyMap();
-					LLHTTPClient::post(url, body, new LLSendTexLayerResponder(body, mUploadID, LLAssetType::AT_TEXTURE, baked_upload_data));
-					// Responder will call LLTexLayerSetBuffer::onTextureUploadComplete()
-				} 
-				else
-				{
-					llinfos << "Baked texture upload via Asset Store." <<  llendl;
-					// gAssetStorage->storeAssetData(mTransactionID, LLAssetType::AT_IMAGE_JPEG, &uploadCallback, (void *)this, FALSE);
-					gAssetStorage->storeAssetData(tid,
-												  LLAssetType::AT_TEXTURE,
-												  LLTexLayerSetBuffer::onTextureUploadComplete,
-												  baked_upload_data,
-												  TRUE,		// temp_file
-												  TRUE,		// is_priority
-												  TRUE);	// store_local
-				}
-		
-				mNeedsUpload = FALSE;
-			}
+				LLSD body = LLSD::emptyMap();
+				LLHTTPClient::post(url, body, new LLSendTexLayerResponder(body, mUploadID, LLAssetType::AT_TEXTURE, baked_upload_data));
+				// Responder will call LLTexLayerSetBuffer::onTextureUploadComplete()
+			} 
 			else
 			{
-				mUploadPending = FALSE;
-				llinfos << "unable to create baked upload file: corrupted" << llendl;
-				LLVFile file(gVFS, asset_id, LLAssetType::AT_TEXTURE, LLVFile::WRITE);
-				file.remove();
+				llinfos << "Baked texture upload via Asset Store." <<  llendl;
+				// gAssetStorage->storeAssetData(mTransactionID, LLAssetType::AT_IMAGE_JPEG, &uploadCallback, (void *)this, FALSE);
+				gAssetStorage->storeAssetData(tid,
+											  LLAssetType::AT_TEXTURE,
+											  LLTexLayerSetBuffer::onTextureUploadComplete,
+											  baked_upload_data,
+											  TRUE,		// temp_file
+											  TRUE,		// is_priority
+											  TRUE);	// store_local
 			}
+	
+			mNeedsUpload = FALSE;
+		}
+		else
+		{
+			mUploadPending = FALSE;
+			llinfos << "unable to create baked upload file: corrupted" << llendl;
+			LLVFile file(gVFS, asset_id, LLAssetType::AT_TEXTURE, LLVFile::WRITE);
+			file.remove();
 		}
 	}
-	if (!res)
+	else
 	{
 		mUploadPending = FALSE;
 		llinfos << "unable to create baked upload file" << llendl;
 	}
-
-	delete [] baked_color_data;
 }
 
 
@@ -843,6 +967,94 @@ BOOL LLTexLayerSet::render( S32 x, S32 y, S32 width, S32 height )
 	return success;
 }
 
+// Records what render() just drew.  Uses the visibility render() found.
+BOOL LLTexLayerSet::render( LLImageCompositor& compositor )
+{
+	BOOL success = TRUE;
+
+	// clear buffer area
+	compositor.setAlphaTest(false);
+	compositor.setColor( 0.f, 0.f, 0.f, 1.f );
+	compositor.drawRect();
+	compositor.setAlphaTest(true);
+
+	if (mIsVisible)
+	{
+		// composite color layers
+		for (layer_list_t::iterator iter = mLayerList.begin(); iter != mLayerList.end(); iter++)
+		{
+			LLTexLayer* layer = *iter;
+			if (layer->getRenderPass() == RP_COLOR || layer->getRenderPass() == RP_BUMP)
+			{
+				success &= layer->render(compositor);
+			}
+		}
+
+		success &= renderAlphaMaskTextures(compositor, false);
+	}
+	else
+	{
+		compositor.setBlendType(LLImageCompositor::BT_REPLACE);
+		compositor.setAlphaTest(false);
+		compositor.setColor( 0.f, 0.f, 0.f, 0.f );
+		compositor.drawRect();
+		compositor.setAlphaTest(true);
+		compositor.setBlendType(LLImageCompositor::BT_ALPHA);
+	}
+
+	return success;
+}
+
+BOOL LLTexLayerSet::renderAlphaMaskTextures( LLImageCompositor& compositor, bool forceClear )
+{
+	const LLTexLayerSetInfo *info = getInfo();
+	BOOL success = TRUE;
+
+	compositor.setColorMask(false, true);
+	compositor.setBlendType(LLImageCompositor::BT_REPLACE);
+
+	// (Optionally) replace alpha with a single component image from a tga file.
+	if (!info->mStaticAlphaFileName.empty())
+	{
+		LLImageRaw* image_raw = gTexStaticImageList.getImageRaw(info->mStaticAlphaFileName);
+		if (image_raw)
+		{
+			// drawn under LLGLSUIDefault, so with the alpha test
+			compositor.setTextureBlendType(LLImageCompositor::TB_REPLACE);
+			compositor.drawImage(image_raw, TRUE);
+		}
+		else
+		{
+			success = FALSE;
+		}
+	}
+	else if (forceClear || info->mClearAlpha || (mMaskLayerList.size() > 0))
+	{
+		// Set the alpha channel to one (clean up after previous blending)
+		compositor.setAlphaTest(false);
+		compositor.setColor( 0.f, 0.f, 0.f, 1.f );
+		compositor.drawRect();
+		compositor.setAlphaTest(true);
+	}
+
+	// (Optional) Mask out part of the baked texture with alpha masks
+	if (mMaskLayerList.size() > 0)
+	{
+		compositor.setBlendType(LLImageCompositor::BT_MULT_ALPHA);
+		compositor.setTextureBlendType(LLImageCompositor::TB_REPLACE);
+		for (layer_list_t::iterator iter = mMaskLayerList.begin(); iter != mMaskLayerList.end(); iter++)
+		{
+			LLTexLayer* layer = *iter;
+			success &= layer->blendAlphaTexture(compositor);
+		}
+	}
+
+	compositor.setTextureBlendType(LLImageCompositor::TB_MULT);
+	compositor.setColorMask(true, true);
+	compositor.setBlendType(LLImageCompositor::BT_ALPHA);
+	return success;
+}
+
 void LLTexLayerSet::requestUpdate()
 {
 	if( mUpdatesEnabled )
@@ -944,6 +1156,32 @@ void LLTexLayerSet::gatherAlphaMasks(U8 *data, S32 width, S32 height)
 	renderAlphaMaskTextures(mComposite->getOriginX(), mComposite->getOriginY(), width, height, true);
 }
 
+// Records the rest of the mask gathering above, to be run on a copy of the
+// composite.  Only layers with masked morphs keep alpha data around, and
+// LLTexLayer::render() already gathered it for the layers it drew.
+BOOL LLTexLayerSet::gatherAlphaMasks( LLImageCompositor& compositor )
+{
+	for( layer_list_t::iterator iter = mLayerList.begin(); iter != mLayerList.end(); iter++ )
+	{
+		LLTexLayer* layer = *iter;
+		if (!layer->hasAlphaParams() || !layer->hasMaskedMorphs())
+		{
+			continue;
+		}
+		LLColor4 net_color;
+		layer->findNetColor( &net_color );
+		if (!mIsVisible || is_approx_zero(net_color.mV[VW]))
+		{
+			if (!layer->renderAlphaMasks(compositor, &net_color))
+			{
+				return FALSE;
+			}
+			compositor.multiplyMask();
+		}
+	}
+	return TRUE;
+}
+
 void LLTexLayerSet::applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_components)
 {
 	for( layer_list_t::iterator iter = mLayerList.begin(); iter != mLayerList.end(); iter++ )
@@ -1473,6 +1711,102 @@ BOOL LLTexLayer::render( S32 x, S32 y, S32 width, S32 height )
 	return success;
 }
 
+BOOL LLTexLayer::render( LLImageCompositor& compositor )
+{
+	LLColor4 net_color;
+	BOOL color_specified = findNetColor(&net_color);
+
+	if (mTexLayerSet->getAvatar()->mIsDummy)
+	{
+		color_specified = true;
+		net_color = LLVOAvatar::getDummyColor();
+	}
+
+	// If you can't see the layer, don't render it.
+	if( is_approx_zero( net_color.mV[VW] ) )
+	{
+		return TRUE;
+	}
+
+	BOOL alpha_mask_specified = FALSE;
+	if( !mParamAlphaList.empty() )
+	{
+		if( !renderAlphaMasks( compositor, &net_color ) )
+		{
+			return FALSE;
+		}
+		if( !mMaskedMorphs.empty() )
+		{
+			// This is the alpha renderAlphaMasks() keeps for gatherAlphaMasks()
+			compositor.multiplyMask();
+		}
+		alpha_mask_specified = TRUE;
+		compositor.setBlendType(LLImageCompositor::BT_DEST_ALPHA);
+	}
+
+	compositor.setColor( net_color );
+
+	if( getInfo()->mWriteAllChannels )
+	{
+		compositor.setBlendType(LLImageCompositor::BT_REPLACE);
+	}
+	else if (getInfo()->mUseLocalTextureAlphaOnly)
+	{
+		// Use the alpha channel only
+		compositor.setColorMask(false, true);
+	}
+
+	if( (getInfo()->mLocalTexture != -1) && !getInfo()->mUseLocalTextureAlphaOnly )
+	{
+		LLImageRaw* image_raw = NULL;
+		if( !mTexLayerSet->getAvatar()->getLocalTextureRaw((ETextureIndex)getInfo()->mLocalTexture, &image_raw ) )
+		{
+			return FALSE;
+		}
+		if( image_raw )
+		{
+			compositor.setAlphaTest(!getInfo()->mWriteAllChannels);
+			compositor.drawImage( image_raw );
+			compositor.setAlphaTest(true);
+		}
+	}
+
+	if( !getInfo()->mStaticImageFileName.empty() )
+	{
+		LLImageRaw* image_raw = gTexStaticImageList.getImageRaw( getInfo()->mStaticImageFileName );
+		if( !image_raw )
+		{
+			return FALSE;
+		}
+		compositor.drawImage( image_raw, getInfo()->mStaticImageIsMask );
+	}
+
+	if( ((-1 == getInfo()->mLocalTexture) ||
+		 getInfo()->mUseLocalTextureAlphaOnly) &&
+		getInfo()->mStaticImageFileName.empty() &&
+		color_specified )
+	{
+		compositor.setAlphaTest(false);
+		compositor.setColor( net_color );
+		compositor.drawRect();
+		compositor.setAlphaTest(true);
+	}
+
+	if( alpha_mask_specified || getInfo()->mWriteAllChannels )
+	{
+		// Restore standard blend func value
+		compositor.setBlendType(LLImageCompositor::BT_ALPHA);
+	}
+
+	if (getInfo()->mUseLocalTextureAlphaOnly)
+	{
+		// Restore color + alpha mode.
+		compositor.setColorMask(true, true);
+	}
+
+	return TRUE;
+}
+
 BOOL LLTexLayer::blendAlphaTexture(S32 x, S32 y, S32 width, S32 height)
 {
 	BOOL success = TRUE;
@@ -1516,6 +1850,36 @@ BOOL LLTexLayer::blendAlphaTexture(S32 x, S32 y, S32 width, S32 height)
 	return success;
 }
 
+BOOL LLTexLayer::blendAlphaTexture( LLImageCompositor& compositor )
+{
+	LLImageRaw* image_raw = NULL;
+	BOOL is_mask = FALSE;
+	if (!getInfo()->mStaticImageFileName.empty())
+	{
+		image_raw = gTexStaticImageList.getImageRaw(getInfo()->mStaticImageFileName);
+		if (!image_raw)
+		{
+			return FALSE;
+		}
+		is_mask = getInfo()->mStaticImageIsMask;
+	}
+	else if (getInfo()->mLocalTexture >=0 && getInfo()->mLocalTexture < TEX_NUM_INDICES)
+	{
+		if (!mTexLayerSet->getAvatar()->getLocalTextureRaw((ETextureIndex)getInfo()->mLocalTexture, &image_raw))
+		{
+			return FALSE;
+		}
+	}
+
+	if (image_raw)
+	{
+		compositor.setAlphaTest(false);
+		compositor.drawImage(image_raw, is_mask);
+		compositor.setAlphaTest(true);
+	}
+	return TRUE;
+}
+
 U8*	LLTexLayer::getAlphaData()
 {
 	LLCRC alpha_mask_crc;
@@ -1753,6 +2117,83 @@ BOOL LLTexLayer::renderAlphaMasks( S32 x, S32 y, S32 width, S32 height, LLColor4
 	return success;
 }
 
+// Like the GL version, without the morph mask updates.  Those stay with the
+// GL composite.
+BOOL LLTexLayer::renderAlphaMasks( LLImageCompositor& compositor, LLColor4* colorp )
+{
+	llassert( !mParamAlphaList.empty() );
+
+	compositor.setColorMask(false, true);
+
+	alpha_list_t::iterator iter = mParamAlphaList.begin();
+	LLTexLayerParamAlpha* first_param = *iter;
+
+	// Note: if the first param is a mulitply, multiply against the current buffer's alpha
+	compositor.setAlphaTest(false);
+	if( !first_param || !first_param->getMultiplyBlend() )
+	{
+		// Clear the alpha
+		compositor.setBlendType(LLImageCompositor::BT_REPLACE);
+		compositor.setColor( 0.f, 0.f, 0.f, 0.f );
+		compositor.drawRect();
+	}
+
+	// Accumulate alphas
+	compositor.setColor( 1.f, 1.f, 1.f, 1.f );
+
+	for( iter = mParamAlphaList.begin(); iter != mParamAlphaList.end(); iter++ )
+	{
+		LLTexLayerParamAlpha* param = *iter;
+		if( !param->render( compositor ) )
+		{
+			return FALSE;
+		}
+	}
+
+	// Approximates a min() function
+	compositor.setBlendType(LLImageCompositor::BT_MULT_ALPHA);
+
+	// Accumulate the alpha component of the texture
+	if( getInfo()->mLocalTexture != -1 )
+	{
+		LLImageRaw* image_raw = NULL;
+		if( !mTexLayerSet->getAvatar()->getLocalTextureRaw((ETextureIndex)getInfo()->mLocalTexture, &image_raw ) )
+		{
+			return FALSE;
+		}
+		if( image_raw && (image_raw->getComponents() == 4) )
+		{
+			compositor.drawImage( image_raw );
+		}
+	}
+
+	if( !getInfo()->mStaticImageFileName.empty() )
+	{
+		LLImageRaw* image_raw = gTexStaticImageList.getImageRaw( getInfo()->mStaticImageFileName );
+		if( !image_raw )
+		{
+			return FALSE;
+		}
+		if(	(image_raw->getComponents() == 4) ||
+			( (image_raw->getComponents() == 1) && getInfo()->mStaticImageIsMask ) )
+		{
+			compositor.drawImage( image_raw, getInfo()->mStaticImageIsMask );
+		}
+	}
+
+	// Draw a rectangle with the layer color to multiply the alpha by that color's alpha.
+	if( colorp->mV[VW] != 1.f )
+	{
+		compositor.setColor( *colorp );
+		compositor.drawRect();
+	}
+
+	compositor.setAlphaTest(true);
+	compositor.setColorMask(true, true);
+
+	return TRUE;
+}
+
 void LLTexLayer::applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_components)
 {
 	for( morph_list_t::iterator iter = mMaskedMorphs.begin();
@@ -2068,6 +2509,40 @@ BOOL LLTexLayerParamAlpha::getSkip()
 }
 
 
+// Don't load the image file until we actually need it the first time.
+// Returns FALSE if it could not be loaded.
+BOOL LLTexLayerParamAlpha::loadStaticImage()
+{
+	if( mStaticImageTGA.isNull() )
+	{
+		mStaticImageTGA = gTexStaticImageList.getImageTGA( getInfo()->mStaticImageFileName );  
+		// We now have something in one of our caches
+		LLTexLayerSet::sHasCaches |= mStaticImageTGA.notNull() ? TRUE : FALSE;
+
+		if( mStaticImageTGA.isNull() )
+		{
+			llwarns << "Unable to load static file: " << getInfo()->mStaticImageFileName << llendl;
+			mStaticImageInvalid = TRUE; // don't try again.
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// Applies domain and effective weight to data as it is decoded. Also resizes the raw image if needed.
+void LLTexLayerParamAlpha::processStaticImage(F32 effective_weight)
+{
+//	llinfos << "Building Cached Alpha: " << mName << ": (" << mStaticImageRaw->getWidth() << ", " << mStaticImageRaw->getHeight() << ") " << effective_weight << llendl;
+	mCachedEffectiveWeight = effective_weight;
+
+	// A new image rather than decoding into the old one, which a CPU bake
+	// may still be reading.
+	mStaticImageRaw = NULL;
+	mStaticImageRaw = new LLImageRaw;
+	mStaticImageTGA->decodeAndProcess( mStaticImageRaw, getInfo()->mDomain, effective_weight );
+	mNeedsCreateTexture = TRUE;
+}
+
 BOOL LLTexLayerParamAlpha::render( S32 x, S32 y, S32 width, S32 height )
 {
 	BOOL success = TRUE;
@@ -2091,19 +2566,9 @@ BOOL LLTexLayerParamAlpha::render( S32 x, S32 y, S32 width, S32 height )
 
 	if( !getInfo()->mStaticImageFileName.empty() && !mStaticImageInvalid)
 	{
-		if( mStaticImageTGA.isNull() )
+		if( !loadStaticImage() )
 		{
-			// Don't load the image file until we actually need it the first time.  Like now.
-			mStaticImageTGA = gTexStaticImageList.getImageTGA( getInfo()->mStaticImageFileName );  
-			// We now have something in one of our caches
-			LLTexLayerSet::sHasCaches |= mStaticImageTGA.notNull() ? TRUE : FALSE;
-
-			if( mStaticImageTGA.isNull() )
-			{
-				llwarns << "Unable to load static file: " << getInfo()->mStaticImageFileName << llendl;
-				mStaticImageInvalid = TRUE; // don't try again.
-				return FALSE;
-			}
+			return FALSE;
 		}
 
 		const S32 image_tga_width = mStaticImageTGA->getWidth();
@@ -2113,9 +2578,6 @@ BOOL LLTexLayerParamAlpha::render( S32 x, S32 y, S32 width, S32 height )
 			(mCachedProcessedImageGL->getHeight() != image_tga_height) ||
 			(weight_changed) )
 		{
-//			llinfos << "Building Cached Alpha: " << mName << ": (" << mStaticImageRaw->getWidth() << ", " << mStaticImageRaw->getHeight() << ") " << effective_weight << llendl;
-			mCachedEffectiveWeight = effective_weight;
-
 			if( !mCachedProcessedImageGL )
 			{
 				mCachedProcessedImageGL = new LLImageGL( image_tga_width, image_tga_height, 1, FALSE);
@@ -2126,11 +2588,7 @@ BOOL LLTexLayerParamAlpha::render( S32 x, S32 y, S32 width, S32 height )
 				mCachedProcessedImageGL->setExplicitFormat( GL_ALPHA8, GL_ALPHA );
 			}
 
-			// Applies domain and effective weight to data as it is decoded. Also resizes the raw image if needed.
-			mStaticImageRaw = NULL;
-			mStaticImageRaw = new LLImageRaw;
-			mStaticImageTGA->decodeAndProcess( mStaticImageRaw, getInfo()->mDomain, effective_weight );
-			mNeedsCreateTexture = TRUE;
+			processStaticImage(effective_weight);
 		}
 
 		if( mCachedProcessedImageGL )
@@ -2171,6 +2629,46 @@ BOOL LLTexLayerParamAlpha::render( S32 x, S32 y, S32 width, S32 height )
 	return success;
 }
 
+// Called with the alpha test off, like the GL version.
+BOOL LLTexLayerParamAlpha::render( LLImageCompositor& compositor )
+{
+	F32 effective_weight = ( mTexLayer->getTexLayerSet()->getAvatar()->getSex() & getSex() ) ? mCurWeight : getDefaultWeight();
+	if( getSkip() )
+	{
+		return TRUE;
+	}
+
+	if( getInfo()->mMultiplyBlend )
+	{
+		compositor.setBlendType(LLImageCompositor::BT_MULT_ALPHA); // Multiplication: approximates a min() function
+	}
+	else
+	{
+		compositor.setBlendType(LLImageCompositor::BT_ADD);  // Addition: approximates a max() function
+	}
+
+	if( !getInfo()->mStaticImageFileName.empty() && !mStaticImageInvalid)
+	{
+		if( !loadStaticImage() )
+		{
+			return FALSE;
+		}
+
+		if( mStaticImageRaw.isNull() || (effective_weight != mCachedEffectiveWeight) )
+		{
+			processStaticImage(effective_weight);
+		}
+		compositor.drawImage( mStaticImageRaw, TRUE );
+	}
+	else
+	{
+		compositor.setColor( 0.f, 0.f, 0.f, effective_weight );
+		compositor.drawRect();
+	}
+
+	return TRUE;
+}
+
 //-----------------------------------------------------------------------------
 // LLTexGlobalColorInfo
 //-----------------------------------------------------------------------------
@@ -2503,7 +3001,8 @@ LLStringTable LLTexStaticImageList::sImageNames(16384);
 LLTexStaticImageList::LLTexStaticImageList()
 	:
 	mGLBytes( 0 ),
-	mTGABytes( 0 )
+	mTGABytes( 0 ),
+	mRawBytes( 0 )
 {}
 
 LLTexStaticImageList::~LLTexStaticImageList()
@@ -2515,24 +3014,28 @@ void LLTexStaticImageList::dumpByteCount()
 {
 	llinfos << "Avatar Static Textures " <<
 		"KB GL:" << (mGLBytes / 1024) <<
-		"KB TGA:" << (mTGABytes / 1024) << "KB" << llendl;
+		"KB TGA:" << (mTGABytes / 1024) <<
+		"KB Raw:" << (mRawBytes / 1024) << "KB" << llendl;
 }
 
 void LLTexStaticImageList::deleteCachedImages()
 {
-	if( mGLBytes || mTGABytes )
+	if( mGLBytes || mTGABytes || mRawBytes )
 	{
 		llinfos << "Clearing Static Textures " <<
 			"KB GL:" << (mGLBytes / 1024) <<
-			"KB TGA:" << (mTGABytes / 1024) << "KB" << llendl;
+			"KB TGA:" << (mTGABytes / 1024) <<
+			"KB Raw:" << (mRawBytes / 1024) << "KB" << llendl;
 
 		//mStaticImageLists uses LLPointers, clear() will cause deletion
 		
 		mStaticImageListTGA.clear();
 		mStaticImageListGL.clear();
+		mStaticImageListRaw.clear();
 		
 		mGLBytes = 0;
 		mTGABytes = 0;
+		mRawBytes = 0;
 	}
 }
 
@@ -2612,6 +3115,27 @@ LLImageGL* LLTexStaticImageList::getImageGL(const std::string& file_name, BOOL i
 	return image_gl;
 }
 
+// Returns the decoded data from a tga file named file_name, for the CPU bake.
+// Caches the result to speed identical subsequent requests.
+LLImageRaw* LLTexStaticImageList::getImageRaw(const std::string& file_name)
+{
+	const char *namekey = sImageNames.addString(file_name);
+	image_raw_map_t::iterator iter = mStaticImageListRaw.find(namekey);
+	if( iter != mStaticImageListRaw.end() )
+	{
+		return iter->second;
+	}
+
+	LLPointer<LLImageRaw> image_raw = new LLImageRaw;
+	if( !loadImageRaw( file_name, image_raw ) )
+	{
+		return NULL;
+	}
+	mStaticImageListRaw[ namekey ] = image_raw;
+	mRawBytes += image_raw->getDataSize();
+	return image_raw;
+}
+
 // Reads a .tga file, decodes it, and puts the decoded data in image_raw.
 // Returns TRUE if successful.
 BOOL LLTexStaticImageList::loadImageRaw( const std::string& file_name, LLImageRaw* image_raw )
@@ -2637,3 +3161,85 @@ LLMaskedMorph::LLMaskedMorph( LLPolyMorphTarget *morph_target, BOOL invert ) : m
 	morph_target->addPendingMorphMask();
 }
 
+
+//-----------------------------------------------------------------------------
+// LLTexLayerBakeThread
+//-----------------------------------------------------------------------------
+LLTexLayerBakeThread::LLTexLayerBakeThread(bool threaded)
+	: LLQueuedThread("texlayerbake", threaded)
+{
+}
+
+LLQueuedThread::handle_t LLTexLayerBakeThread::bake(S32 width, S32 height,
+													const LLImageCompositor& color_compositor,
+													const LLImageCompositor& mask_compositor,
+													LLImageRaw* compare_image)
+{
+	handle_t handle = generateHandle();
+	BakeRequest* request = new BakeRequest(handle, width, height, color_compositor, mask_compositor, compare_image);
+	addRequest(request);
+	return handle;
+}
+
+LLTexLayerBakeThread::BakeRequest::BakeRequest(handle_t handle, S32 width, S32 height,
+											   const LLImageCompositor& color_compositor,
+											   const LLImageCompositor& mask_compositor,
+											   LLImageRaw* compare_image)
+	: LLQueuedThread::QueuedRequest(handle, LLQueuedThread::PRIORITY_NORMAL),
+	  mCompositeTime(0.f),
+	  mEncodeTime(0.f),
+	  mMaxDifference(-1),
+	  mMeanDifference(0.f),
+	  mWidth(width),
+	  mHeight(height),
+	  mColorCompositor(color_compositor),
+	  mMaskCompositor(mask_compositor),
+	  mCompareImage(compare_image)
+{
+}
+
+LLTexLayerBakeThread::BakeRequest::~BakeRequest()
+{
+}
+
+bool LLTexLayerBakeThread::BakeRequest::processRequest()
+{
+	LLTimer timer;
+
+	LLPointer<LLImageRaw> color = new LLImageRaw(mWidth, mHeight, 4);
+	LLPointer<LLImageRaw> mask = new LLImageRaw(mWidth, mHeight, 1);
+	memset(mask->getData(), 255, mWidth * mHeight);
+	mColorCompositor.execute(color, mask);
+
+	// Layers the color pass didn't draw still contribute their alpha masks
+	if (mMaskCompositor.getCommandCount() > 0)
+	{
+		LLPointer<LLImageRaw> scratch = new LLImageRaw(color->getData(), mWidth, mHeight, 4);
+		mMaskCompositor.execute(scratch, mask);
+	}
+	mCompositeTime = timer.getElapsedTimeF32();
+
+	if (mCompareImage.notNull())
+	{
+		const U8* a = color->getData();
+		const U8* b = mCompareImage->getData();
+		const S32 count = mWidth * mHeight * 4;
+		S32 max_difference = 0;
+		F64 total = 0.0;
+		for (S32 i = 0; i < count; i++)
+		{
+			S32 difference = llabs((S32)a[i] - (S32)b[i]);
+			max_difference = llmax(max_difference, difference);
+			total += difference;
+		}
+		mMaxDifference = max_difference;
+		mMeanDifference = (F32)(total / count);
+		mCompareImage = NULL;
+	}
+
+	timer.reset();
+	mCompressedImage = encode_baked_image(color->getData(), mask->getData(), mWidth, mHeight);
+	mEncodeTime = timer.getElapsedTimeF32();
+
+	return true;
+}
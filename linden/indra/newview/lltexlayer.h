@@ -36,6 +36,7 @@
 #include <deque>
 #include "llassetstorage.h"
 #include "lldynamictexture.h"
+#include "llimagecompositor.h"
 #include "llrect.h"
 #include "llstring.h"
 #include "lluuid.h"
@@ -45,12 +46,14 @@
 #include "llwearable.h"
 #include "v4color.h"
 #include "llfloater.h"
+#include "llqueuedthread.h"
 
 class LLTexLayerSetInfo;
 class LLTexLayerSet;
 class LLTexLayerInfo;
 class LLTexLayer;
 class LLImageGL;
+class LLImageJ2C;
 class LLImageTGA;
 class LLTexGlobalColorInfo;
 class LLTexLayerParamAlphaInfo;
@@ -223,6 +226,7 @@ public:
 	BOOL					uploadPending() { return mUploadPending; }
 	BOOL					render( S32 x, S32 y, S32 width, S32 height );
 	void					readBackAndUpload();
+	void					bakeAndUpload();
 
 	static void				onTextureUploadComplete( const LLUUID& uuid,
 													 void* userdata,
@@ -236,6 +240,9 @@ private:
 	void					pushProjection();
 	void					popProjection();
 	BOOL					needsUploadNow() const;
+	BOOL					startCPUBake();
+	void					updateCPUBake();
+	void					uploadBakedImage(LLImageJ2C* compressedImage);
 
 private:
 	BOOL					mNeedsUpdate;
@@ -245,6 +252,8 @@ private:
 	S32						mUploadFailCount;
 	U64						mUploadAfter;	// delay upload until after this time (in microseconds)
 	LLTexLayerSet*			mTexLayerSet;
+	LLQueuedThread::handle_t mBakeHandle;	// CPU bake being composited and encoded by LLTexLayerBakeThread
+	BOOL					mBakeCanceled;	// ...whose result is out of date
 
 	static S32				sGLByteCount;
 };
@@ -267,6 +276,10 @@ public:
 	
 	BOOL					render( S32 x, S32 y, S32 width, S32 height );
 	void					renderAlphaMaskTextures(S32 x, S32 y, S32 width, S32 height, bool forceClear = false);
+	// Record the same drawing for LLImageCompositor.  These return FALSE when a
+	// source image is not available in memory.
+	BOOL					render( LLImageCompositor& compositor );
+	BOOL					renderAlphaMaskTextures( LLImageCompositor& compositor, bool forceClear = false );
 	BOOL					isBodyRegion( const std::string& region ) { return mInfo->mBodyRegion == region; }
 	LLTexLayerSetBuffer*	getComposite();
 	void					requestUpdate();
@@ -282,6 +295,7 @@ public:
 	BOOL					getUpdatesEnabled()						{ return mUpdatesEnabled; }
 	void					deleteCaches();
 	void					gatherAlphaMasks(U8 *data, S32 width, S32 height);
+	BOOL					gatherAlphaMasks( LLImageCompositor& compositor );
 	void					applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_components);
 	const std::string		getBodyRegion() 				{ return mInfo->mBodyRegion; }
 	BOOL					hasComposite()					{ return (mComposite != NULL); }
@@ -337,6 +351,7 @@ public:
 	BOOL					setInfo(LLTexLayerInfo *info);
 	
 	BOOL					render( S32 x, S32 y, S32 width, S32 height );
+	BOOL					render( LLImageCompositor& compositor );
 	void					requestUpdate();
 	LLTexLayerSet*			getTexLayerSet()						{ return mTexLayerSet; }
 
@@ -353,8 +368,11 @@ public:
 	BOOL					findNetColor( LLColor4* color );
 	BOOL					renderImageRaw( U8* in_data, S32 in_width, S32 in_height, S32 in_components, S32 width, S32 height, BOOL is_mask );
 	BOOL					renderAlphaMasks(  S32 x, S32 y, S32 width, S32 height, LLColor4* colorp );
+	BOOL					renderAlphaMasks( LLImageCompositor& compositor, LLColor4* colorp );
 	BOOL					hasAlphaParams() { return (!mParamAlphaList.empty());}
+	BOOL					hasMaskedMorphs() { return (!mMaskedMorphs.empty());}
 	BOOL					blendAlphaTexture(S32 x, S32 y, S32 width, S32 height);
+	BOOL					blendAlphaTexture( LLImageCompositor& compositor );
 	BOOL					isVisibilityMask() const;
 	BOOL					isInvisibleAlphaMask();
 
@@ -413,12 +431,16 @@ public:
 
 	// New functions
 	BOOL					render( S32 x, S32 y, S32 width, S32 height );
+	BOOL					render( LLImageCompositor& compositor );
 	BOOL					getSkip();
 	void					deleteCaches();
 	LLTexLayer*				getTexLayer()		{ return mTexLayer; }
 	BOOL					getMultiplyBlend()	{ return getInfo()->mMultiplyBlend; }
 
 protected:
+	BOOL					loadStaticImage();
+	void					processStaticImage(F32 effective_weight);
+
 	LLPointer<LLImageGL>	mCachedProcessedImageGL;
 	LLTexLayer*				mTexLayer;
 	LLPointer<LLImageTGA>	mStaticImageTGA;
@@ -534,12 +556,15 @@ private:
 
 	typedef std::map< const char *, LLPointer<LLImageGL> > image_gl_map_t;
 	typedef std::map< const char *, LLPointer<LLImageTGA> > image_tga_map_t;
+	typedef std::map< const char *, LLPointer<LLImageRaw> > image_raw_map_t;
 	image_gl_map_t mStaticImageListGL;
 	image_tga_map_t mStaticImageListTGA;
+	image_raw_map_t mStaticImageListRaw;
 
 public:
 	S32 mGLBytes;
 	S32 mTGABytes;
+	S32 mRawBytes;
 };
 
 // Used by LLTexLayerSetBuffer for a callback.
@@ -564,6 +589,54 @@ public:
 	U64						mStartTime;		// Used to measure time baked texture upload requires
 };
 
+//-----------------------------------------------------------------------------
+// LLTexLayerBakeThread
+// Composites the bakes recorded by LLTexLayerSetBuffer::startCPUBake() and
+// encodes them for upload, off the main thread.
+//-----------------------------------------------------------------------------
+class LLTexLayerBakeThread : public LLQueuedThread
+{
+public:
+	class BakeRequest : public LLQueuedThread::QueuedRequest
+	{
+	protected:
+		virtual ~BakeRequest(); // use deleteRequest()
+
+	public:
+		BakeRequest(handle_t handle, S32 width, S32 height,
+					const LLImageCompositor& color_compositor,
+					const LLImageCompositor& mask_compositor,
+					LLImageRaw* compare_image);
+
+		/*virtual*/ bool processRequest();
+
+		// output
+		LLPointer<LLImageJ2C>	mCompressedImage;	// NULL if encoding failed
+		F32						mCompositeTime;		// in seconds
+		F32						mEncodeTime;
+		S32						mMaxDifference;		// from mCompareImage, if there was one
+		F32						mMeanDifference;
+
+	private:
+		// input
+		S32						mWidth;
+		S32						mHeight;
+		LLImageCompositor		mColorCompositor;
+		LLImageCompositor		mMaskCompositor;
+		LLPointer<LLImageRaw>	mCompareImage;		// RGBA read back from the GL composite
+	};
+
+public:
+	LLTexLayerBakeThread(bool threaded = true);
+
+	// MAIN THREAD
+	handle_t bake(S32 width, S32 height,
+				  const LLImageCompositor& color_compositor,
+				  const LLImageCompositor& mask_compositor,
+				  LLImageRaw* compare_image);
+	BakeRequest* getBakeRequest(handle_t handle) { return (BakeRequest*)getRequest(handle); }
+};
+
 extern LLTexStaticImageList gTexStaticImageList;
 
 
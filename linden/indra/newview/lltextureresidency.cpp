@@ -0,0 +1,235 @@
+/**
+ * @file lltextureresidency.cpp
+ * @brief Keeps GL texture memory under a hard budget by evicting or
+ *        downscaling the least recently bound textures.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltextureresidency.h"
+
+#include "llframetimer.h"
+#include "llimagegl.h"
+
+#include "llappviewer.h"
+#include "llviewercontrol.h"
+#include "llviewerimage.h"
+#include "llviewerimagelist.h"
+
+#include <algorithm>
+
+// tuning params
+const F32 RESIDENCY_TARGET_SCALE = 0.95f;	// when over budget, reclaim down to this fraction of it
+const F32 RESIDENCY_RELAX_SCALE = 0.85f;	// below this fraction floors may be lowered again
+const U32 RESIDENCY_EVICT_FRAMES = 120;		// not bound for this many frames: evict rather than downscale
+const U32 RESIDENCY_MAX_RELAX_PER_FRAME = 8;
+const U32 RESIDENCY_MAX_RECENT_DECISIONS = 8;
+
+// Orders textures so that the best eviction candidates come first.
+struct CompareResidencyLRU
+{
+	bool operator()(const LLViewerImage* lhs, const LLViewerImage* rhs) const
+	{
+		if (lhs->mLastBindFrame != rhs->mLastBindFrame)
+		{
+			return lhs->mLastBindFrame < rhs->mLastBindFrame; // older
+		}
+		if (lhs->mMaxVirtualSize != rhs->mMaxVirtualSize)
+		{
+			return lhs->mMaxVirtualSize < rhs->mMaxVirtualSize; // smaller on screen
+		}
+		if (lhs->mTextureMemory != rhs->mTextureMemory)
+		{
+			return lhs->mTextureMemory > rhs->mTextureMemory; // frees more
+		}
+		return lhs < rhs;
+	}
+};
+
+LLTextureResidencyManager::LLTextureResidencyManager()
+:	mEnabled(TRUE),
+	mBudgetBytes(0),
+	mResidentBytes(0),
+	mCandidateCount(0),
+	mRelaxAllowed(FALSE),
+	mRelaxBudget(0),
+	mFrameBytesReclaimed(0),
+	mTotalBytesReclaimed(0.0)
+{
+	for (S32 i = 0; i < DECISION_COUNT; i++)
+	{
+		mFrameCount[i] = 0;
+		mTotalCount[i] = 0;
+	}
+}
+
+//static
+const char* LLTextureResidencyManager::getDecisionName(EDecision type)
+{
+	switch (type)
+	{
+	case DECISION_EVICT:		return "evict";
+	case DECISION_DOWNSCALE:	return "down";
+	case DECISION_RELAX:		return "relax";
+	default:					return "?";
+	}
+}
+
+void LLTextureResidencyManager::updateBudget()
+{
+	static LLCachedControl<BOOL> residency_enabled("TextureResidencyManager", TRUE);
+	static LLCachedControl<S32> residency_budget("TextureResidencyBudget", 0);
+
+	mEnabled = residency_enabled;
+
+	S32 budget_mb = residency_budget;
+	if (budget_mb <= 0)
+	{
+		budget_mb = gImageList.getMaxResidentTexMem();
+	}
+	// The setting is free form, so keep it between the smallest card we support
+	// and the physical memory of the machine.
+	S32 system_ram = (S32)BYTES_TO_MEGA_BYTES(gSysMemory.getPhysicalMemoryClamped());
+	budget_mb = llclamp(budget_mb, MIN_VIDEO_RAM_IN_MEGA_BYTES, llmax(system_ram, MIN_VIDEO_RAM_IN_MEGA_BYTES));
+	mBudgetBytes = MEGA_BYTES_TO_BYTES((S64)budget_mb);
+}
+
+void LLTextureResidencyManager::recordDecision(const LLViewerImage* imagep, EDecision type, S32 bytes, S32 discard)
+{
+	mFrameCount[type]++;
+	mTotalCount[type]++;
+	mFrameBytesReclaimed += bytes;
+	mTotalBytesReclaimed += (F64)bytes;
+
+	Decision decision;
+	decision.mID = imagep->getID();
+	decision.mType = type;
+	decision.mBytes = bytes;
+	decision.mDiscard = discard;
+	decision.mFrame = LLFrameTimer::getFrameCount();
+	mRecentDecisions.push_front(decision);
+	if (mRecentDecisions.size() > RESIDENCY_MAX_RECENT_DECISIONS)
+	{
+		mRecentDecisions.pop_back();
+	}
+}
+
+BOOL LLTextureResidencyManager::canRelax(const LLViewerImage* imagep)
+{
+	if (!mRelaxAllowed || mRelaxBudget == 0)
+	{
+		return FALSE;
+	}
+	// Relaxing costs memory, so only spend it on textures that are actually on screen.
+	if (!imagep->getBoundRecently())
+	{
+		return FALSE;
+	}
+	mRelaxBudget--;
+	recordDecision(imagep, DECISION_RELAX, 0, imagep->getResidencyDiscardLevel() - 1);
+	return TRUE;
+}
+
+void LLTextureResidencyManager::updateResidency(std::vector<LLViewerImage*>& resident)
+{
+	for (S32 i = 0; i < DECISION_COUNT; i++)
+	{
+		mFrameCount[i] = 0;
+	}
+	mFrameBytesReclaimed = 0;
+
+	updateBudget();
+	mResidentBytes = LLImageGL::sGlobalTextureMemoryInBytes;
+	mCandidateCount = (S32)resident.size();
+
+	if (!mEnabled)
+	{
+		mRelaxAllowed = FALSE;
+		return;
+	}
+
+	mRelaxAllowed = mResidentBytes < (S64)((F64)mBudgetBytes * RESIDENCY_RELAX_SCALE);
+	mRelaxBudget = RESIDENCY_MAX_RELAX_PER_FRAME;
+
+	if (mResidentBytes <= mBudgetBytes)
+	{
+		return;
+	}
+
+	S64 to_reclaim = mResidentBytes - (S64)((F64)mBudgetBytes * RESIDENCY_TARGET_SCALE);
+	U32 cur_frame = LLFrameTimer::getFrameCount();
+
+	std::sort(resident.begin(), resident.end(), CompareResidencyLRU());
+
+	// First pass: anything not drawn this frame, oldest first.
+	std::vector<LLViewerImage*>::iterator iter = resident.begin();
+	for ( ; iter != resident.end() && to_reclaim > 0; ++iter)
+	{
+		LLViewerImage* imagep = *iter;
+		if (imagep->mLastBindFrame == cur_frame)
+		{
+			// Sorted by bind frame, so everything after this is in use right now.
+			break;
+		}
+
+		S32 freed = 0;
+		if (cur_frame - imagep->mLastBindFrame > RESIDENCY_EVICT_FRAMES || imagep->mMaxVirtualSize <= 0.f)
+		{
+			freed = imagep->evictTexture();
+			if (freed > 0)
+			{
+				recordDecision(imagep, DECISION_EVICT, freed, imagep->getResidencyDiscardLevel());
+			}
+		}
+		else if (imagep->getDiscardLevel() < imagep->getMaxDiscardLevel())
+		{
+			S32 discard = imagep->getDiscardLevel() + 1;
+			freed = imagep->downscaleTexture(discard);
+			if (freed > 0)
+			{
+				recordDecision(imagep, DECISION_DOWNSCALE, freed, discard);
+			}
+		}
+		to_reclaim -= freed;
+	}
+
+	// Second pass: still over the hard budget, so drop a level on what is in view,
+	// starting with the textures that cover the fewest pixels.
+	for ( ; iter != resident.end() && to_reclaim > 0; ++iter)
+	{
+		LLViewerImage* imagep = *iter;
+		if (imagep->getDiscardLevel() >= imagep->getMaxDiscardLevel())
+		{
+			continue;
+		}
+		S32 discard = imagep->getDiscardLevel() + 1;
+		S32 freed = imagep->downscaleTexture(discard);
+		if (freed > 0)
+		{
+			recordDecision(imagep, DECISION_DOWNSCALE, freed, discard);
+			to_reclaim -= freed;
+		}
+	}
+}
@@ -0,0 +1,111 @@
+/**
+ * @file lltextureresidency.h
+ * @brief Keeps GL texture memory under a hard budget by evicting or
+ *        downscaling the least recently bound textures.
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLTEXTURERESIDENCY_H
+#define LL_LLTEXTURERESIDENCY_H
+
+#include "llmemory.h"
+#include "lluuid.h"
+
+#include <deque>
+#include <vector>
+
+class LLViewerImage;
+
+// Explicit GL texture residency control.
+//
+// LLViewerImageList hands the manager every discardable texture that owns a GL
+// name once per frame. While resident texture memory is above the budget, the
+// manager walks those textures in LRU order (oldest bind frame first, smallest
+// on-screen pixel area breaking ties) and either evicts them outright, if they
+// have not been bound for a while, or raises a per-image discard floor so they
+// are rebuilt at a lower resolution. Once usage drops below the low water mark
+// the floors are relaxed again by LLViewerImage::processTextureStats().
+class LLTextureResidencyManager : public LLSingleton<LLTextureResidencyManager>
+{
+public:
+	enum EDecision
+	{
+		DECISION_EVICT = 0,
+		DECISION_DOWNSCALE,
+		DECISION_RELAX,
+		DECISION_COUNT
+	};
+
+	struct Decision
+	{
+		LLUUID		mID;
+		EDecision	mType;
+		S32			mBytes;		// GL bytes released (0 for relax)
+		S32			mDiscard;	// discard floor after the decision
+		U32			mFrame;
+	};
+	typedef std::deque<Decision> decision_list_t;
+
+	LLTextureResidencyManager();
+
+	// Called once per frame by LLViewerImageList with all textures that own GL memory
+	// and are allowed to be discarded.
+	void updateResidency(std::vector<LLViewerImage*>& resident);
+
+	// TRUE when the given image may lower its residency floor by one level this frame.
+	BOOL canRelax(const LLViewerImage* imagep);
+
+	BOOL isEnabled() const				{ return mEnabled; }
+	S64  getBudgetBytes() const			{ return mBudgetBytes; }
+	S64  getResidentBytes() const		{ return mResidentBytes; }
+	S32  getCandidateCount() const		{ return mCandidateCount; }
+	U32  getFrameCount(EDecision type) const		{ return mFrameCount[type]; }
+	U32  getTotalCount(EDecision type) const		{ return mTotalCount[type]; }
+	S32  getFrameBytesReclaimed() const	{ return mFrameBytesReclaimed; }
+	F64  getTotalBytesReclaimed() const	{ return mTotalBytesReclaimed; }
+	const decision_list_t& getRecentDecisions() const { return mRecentDecisions; }
+
+	static const char* getDecisionName(EDecision type);
+
+private:
+	void updateBudget();
+	void recordDecision(const LLViewerImage* imagep, EDecision type, S32 bytes, S32 discard);
+
+private:
+	BOOL	mEnabled;
+	S64		mBudgetBytes;			// 64 bit, budgets of 2 GB and more are valid
+	S64		mResidentBytes;
+	S32		mCandidateCount;
+	BOOL	mRelaxAllowed;
+	U32		mRelaxBudget;			// number of floors that may still be relaxed this frame
+
+	U32		mFrameCount[DECISION_COUNT];
+	U32		mTotalCount[DECISION_COUNT];
+	S32		mFrameBytesReclaimed;
+	F64		mTotalBytesReclaimed;
+
+	decision_list_t mRecentDecisions;
+};
+
+#endif // LL_LLTEXTURERESIDENCY_H
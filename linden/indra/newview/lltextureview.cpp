@@ -49,6 +49,7 @@
 #include "lltexlayer.h"
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
+#include "lltextureresidency.h"
 #include "llviewercontrol.h"
 #include "llviewerobject.h"
 #include "llviewerimage.h"
@@ -337,6 +338,11 @@ void LLTextureBar::draw()
 		{
 			std::string num_str = llformat("%3dx%3d (%d) %7d", mImagep->getWidth(), mImagep->getHeight(),
 										mImagep->getDiscardLevel(), mImagep->mTextureMemory);
+			if (mImagep->getResidencyDiscardLevel() >= 0)
+			{
+				// discard floor imposed by the residency manager
+				num_str += llformat(" R%d", mImagep->getResidencyDiscardLevel());
+			}
 			LLFontGL::getFontMonospace()->renderUTF8(num_str, 0, title_x4, getRect().getHeight(), color,
 											LLFontGL::LEFT, LLFontGL::TOP);
 		}
@@ -373,7 +379,7 @@ public:
 		  mTextureView(texview)
 	{
 		S32 line_height = (S32)(LLFontGL::getFontMonospace()->getLineHeight() + .5f);
-		setRect(LLRect(0,0,100,line_height * 4));
+		setRect(LLRect(0,0,100,line_height * 6));
 	}
 
 	virtual void draw();	
@@ -416,6 +422,45 @@ void LLGLTexMemBar::draw()
 											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
 
 	//----------------------------------------------------------------------------
+	// Residency manager decisions
+
+	LLTextureResidencyManager* residency = LLTextureResidencyManager::getInstance();
+	S32 resident_mem = (S32)BYTES_TO_MEGA_BYTES(residency->getResidentBytes());
+	S32 budget_mem = (S32)BYTES_TO_MEGA_BYTES(residency->getBudgetBytes());
+	color = !residency->isEnabled() ? LLColor4::grey :
+			(resident_mem < llfloor(budget_mem * texmem_lower_bound_scale)) ? LLColor4::green :
+			(resident_mem <= budget_mem) ? LLColor4::yellow : LLColor4::red;
+	color[VALPHA] = text_color[VALPHA];
+	text = llformat("Residency: %d/%d MB%s Cand: %d Evict: %d(%d) Down: %d(%d) Relax: %d(%d) Freed: %.1f/%.0f MB",
+					resident_mem, budget_mem,
+					residency->isEnabled() ? "" : " (off)",
+					residency->getCandidateCount(),
+					residency->getFrameCount(LLTextureResidencyManager::DECISION_EVICT),
+					residency->getTotalCount(LLTextureResidencyManager::DECISION_EVICT),
+					residency->getFrameCount(LLTextureResidencyManager::DECISION_DOWNSCALE),
+					residency->getTotalCount(LLTextureResidencyManager::DECISION_DOWNSCALE),
+					residency->getFrameCount(LLTextureResidencyManager::DECISION_RELAX),
+					residency->getTotalCount(LLTextureResidencyManager::DECISION_RELAX),
+					(F32)residency->getFrameBytesReclaimed() / (1024.f * 1024.f),
+					(F32)(residency->getTotalBytesReclaimed() / (1024.0 * 1024.0)));
+	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, line_height*5,
+											 color, LLFontGL::LEFT, LLFontGL::TOP);
+
+	text = "Recent:";
+	const LLTextureResidencyManager::decision_list_t& decisions = residency->getRecentDecisions();
+	for (LLTextureResidencyManager::decision_list_t::const_iterator iter = decisions.begin();
+		 iter != decisions.end(); ++iter)
+	{
+		text += llformat(" %s %s(%d) %dK",
+						 iter->mID.asString().substr(0,7).c_str(),
+						 LLTextureResidencyManager::getDecisionName(iter->mType),
+						 iter->mDiscard,
+						 iter->mBytes >> 10);
+	}
+	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, line_height*4,
+											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
+
+	//----------------------------------------------------------------------------
 #if 0
 	S32 bar_left = 400;
 	S32 bar_width = 200;
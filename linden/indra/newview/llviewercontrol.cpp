@@ -47,6 +47,7 @@
 #include "lldrawpoolterrain.h"
 #include "llflexibleobject.h"
 #include "llfeaturemanager.h"
+#include "llfontlayoutcache.h"
 #include "llviewershadermgr.h"
 #include "llpanelgeneral.h"
 #include "llpanelinput.h"
@@ -396,6 +397,23 @@ static bool handleResetVertexBuffersChanged(const LLSD&)
 	return true;
 }
 
+static bool handleRenderVBOPoolChanged(const LLSD& newvalue)
+{
+	LLVertexBuffer::sUsePool = newvalue.asBoolean();
+	if (gPipeline.isInit())
+	{
+		gPipeline.resetVertexBuffers();
+	}
+	return true;
+}
+
+static bool handleFontLayoutCacheChanged(const LLSD& newvalue)
+{
+	LLFontLayoutCache::sEnabled = newvalue.asBoolean();
+	LLFontLayoutCache::getInstance()->clear();
+	return true;
+}
+
 static bool handleRenderDynamicLODChanged(const LLSD& newvalue)
 {
 	LLPipeline::sDynamicLOD = newvalue.asBoolean();
@@ -526,6 +544,7 @@ void settings_setup_listeners()
 	gSavedSettings.getControl("RenderFarClip")->getSignal()->connect(boost::bind(&handleRenderFarClipChanged, _1));
 	gSavedSettings.getControl("RenderTerrainDetail")->getSignal()->connect(boost::bind(&handleTerrainDetailChanged, _1));
 	gSavedSettings.getControl("RenderAnimateTrees")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _1));
+	gSavedSettings.getControl("RenderTreeInstancing")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _1));
 	gSavedSettings.getControl("RenderAvatarVP")->getSignal()->connect(boost::bind(&handleSetShaderChanged, _1));
 	gSavedSettings.getControl("VertexShaderEnable")->getSignal()->connect(boost::bind(&handleSetShaderChanged, _1));
 	gSavedSettings.getControl("RenderGlow")->getSignal()->connect(boost::bind(&handleReleaseGLBufferChanged, _1));
@@ -559,6 +578,8 @@ void settings_setup_listeners()
 	gSavedSettings.getControl("RenderFastAlpha")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _1));
 	gSavedSettings.getControl("RenderObjectBump")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _1));
 	gSavedSettings.getControl("RenderMaxVBOSize")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _1));
+	gSavedSettings.getControl("RenderVBOPool")->getSignal()->connect(boost::bind(&handleRenderVBOPoolChanged, _1));
+	gSavedSettings.getControl("FontLayoutCache")->getSignal()->connect(boost::bind(&handleFontLayoutCacheChanged, _1));
 	gSavedSettings.getControl("RenderUseFBO")->getSignal()->connect(boost::bind(&handleRenderUseFBOChanged, _1));
 	gSavedSettings.getControl("RenderDeferredNoise")->getSignal()->connect(boost::bind(&handleReleaseGLBufferChanged, _1));
 	gSavedSettings.getControl("RenderUseImpostors")->getSignal()->connect(boost::bind(&handleRenderUseImpostorsChanged, _1));
@@ -60,6 +60,7 @@
 #include "pipeline.h"
 #include "llappviewer.h"
 #include "llface.h"
+#include "lltextureresidency.h"
 #include "llviewercamera.h"
 #include "llvovolume.h"
 ///////////////////////////////////////////////////////////////////////////////
@@ -308,6 +309,7 @@ void LLViewerImage::init(bool firstinit)
 	mFullyLoaded = FALSE;
 	mDesiredDiscardLevel = MAX_DISCARD_LEVEL + 1;
 	mMinDesiredDiscardLevel = MAX_DISCARD_LEVEL + 1;
+	mResidencyDiscardLevel = -1;
 	mCalculatedDiscardLevel = -1.f;
 
 	mDecodingAux = FALSE;
@@ -440,6 +442,45 @@ void LLViewerImage::destroyTexture()
 	destroyGLTexture() ;
 }
 
+S32 LLViewerImage::evictTexture()
+{
+	if (mNeedsCreateTexture || !getHasGLTexture())
+	{
+		return 0;
+	}
+
+	S32 freed = mTextureMemory;
+	destroyGLTexture();
+
+	// Only hold on to the decoded data if a loaded callback still wants it.
+	if (!hasCallbacks() && !mForceToSaveRawImage)
+	{
+		destroyRawImage();
+	}
+	return freed;
+}
+
+S32 LLViewerImage::downscaleTexture(S32 discard_level)
+{
+	if (mNeedsCreateTexture || !getHasGLTexture() || getDiscardLevel() >= discard_level)
+	{
+		return 0;
+	}
+
+	setResidencyDiscardLevel(discard_level);
+
+	if (mCachedRawImage.notNull() && mCachedRawDiscardLevel >= discard_level)
+	{
+		// Fall back to the small cached copy; the fetcher will refill up to the floor.
+		S32 freed = mTextureMemory - getMipBytes(mCachedRawDiscardLevel);
+		switchToCachedImage();
+		return llmax(freed, 0);
+	}
+
+	// No usable cached copy, release the texture and let it be refetched at the lower level.
+	return evictTexture();
+}
+
 void LLViewerImage::addToCreateTexture()
 {
 	if(isForSculptOnly())
@@ -730,6 +771,16 @@ void LLViewerImage::processTextureStats()
 		// Clamp to min desired discard
 		mDesiredDiscardLevel = llmin(mMinDesiredDiscardLevel, mDesiredDiscardLevel);
 
+		// Respect the residency manager's floor, loosening it once there is room again
+		if (mResidencyDiscardLevel >= 0 && mBoostLevel < LLViewerImageBoostLevel::BOOST_HIGH)
+		{
+			if (LLTextureResidencyManager::getInstance()->canRelax(this))
+			{
+				mResidencyDiscardLevel--;
+			}
+			mDesiredDiscardLevel = llmax(mDesiredDiscardLevel, mResidencyDiscardLevel);
+		}
+
 		//
 		// At this point we've calculated the quality level that we want,
 		// if possible.  Now we check to see if we have it, and take the
@@ -256,6 +256,17 @@ public:
 	void destroyTexture() ;
 	void addToCreateTexture();
 
+	// ONLY call from LLTextureResidencyManager
+	// Unconditionally releases the GL texture (and raw data nobody is waiting on).
+	// Returns the number of GL bytes freed.
+	S32  evictTexture();
+	// Drops the GL texture to at least the given discard level, using the cached
+	// raw image when possible. Returns the number of GL bytes expected to be freed.
+	S32  downscaleTexture(S32 discard_level);
+	// Lowest discard level the residency manager currently allows, -1 if unconstrained.
+	S32  getResidencyDiscardLevel() const	{ return mResidencyDiscardLevel; }
+	void setResidencyDiscardLevel(S32 discard) { mResidencyDiscardLevel = (S8)llclamp(discard, -1, (S32)MAX_DISCARD_LEVEL); }
+
 	BOOL needsAux() const							{ return mNeedsAux; }
 
 	// setDesiredDiscardLevel is only used by LLViewerImageList
@@ -312,6 +323,9 @@ public:
 	
 	void        forceToSaveRawImage(S32 desired_discard = 0) ;
 	void        destroySavedRawImage() ;
+	LLImageRaw* getSavedRawImage() const { return mSavedRawImage ;}
+	S32         getSavedRawImageLevel() const {return mSavedRawDiscardLevel;}
+	BOOL        isForcedToSaveRawImage() const {return mForceToSaveRawImage;}
 
 	BOOL        isSameTexture(const LLViewerImage* tex) const ;
 
@@ -382,6 +396,7 @@ private:
 
 	S8  mDesiredDiscardLevel;			// The discard level we'd LIKE to have - if we have it and there's space
 	S8  mMinDesiredDiscardLevel;		// The minimum discard level we'd like to have
+	S8  mResidencyDiscardLevel;			// Discard level floor imposed by LLTextureResidencyManager, -1 = none
 	S8  mNeedsCreateTexture;	
 	mutable S8  mNeedsGLTexture;
 	S8  mNeedsAux;					// We need to decode the auxiliary channels
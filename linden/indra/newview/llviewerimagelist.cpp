@@ -55,6 +55,7 @@
 #include "llagent.h"
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
+#include "lltextureresidency.h"
 #include "llviewercontrol.h"
 #include "llviewerimage.h"
 #include "llviewermedia.h"
@@ -567,6 +568,9 @@ void LLViewerImageList::updateImages(F32 max_time)
 
 	updateImagesDecodePriorities();
 
+	llpushcallstacks ;
+	updateImagesResidency();
+
 	llpushcallstacks ;
 	F32 total_max_time = max_time;
 	max_time -= updateImagesFetchTextures(max_time);
@@ -695,6 +699,26 @@ void LLViewerImageList::updateImagesDecodePriorities()
 	}
 }
 
+void LLViewerImageList::updateImagesResidency()
+{
+	if (gNoRender || gGLManager.mIsDisabled) return;
+
+	std::vector<LLViewerImage*> resident;
+	resident.reserve(mImageList.size());
+	for (image_priority_list_t::iterator iter = mImageList.begin();
+		 iter != mImageList.end(); ++iter)
+	{
+		LLViewerImage* imagep = *iter;
+		if (imagep->getHasGLTexture() &&
+			imagep->getUseDiscard() &&
+			imagep->getBoostLevel() < LLViewerImageBoostLevel::BOOST_HIGH)
+		{
+			resident.push_back(imagep);
+		}
+	}
+	LLTextureResidencyManager::getInstance()->updateResidency(resident);
+}
+
 /*
  static U8 get_image_type(LLViewerImage* imagep, LLHost target_host)
  {
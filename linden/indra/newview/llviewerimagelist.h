@@ -155,6 +155,7 @@ private:
 	F32  updateImagesCreateTextures(F32 max_time);
 	F32  updateImagesFetchTextures(F32 max_time);
 	void updateImagesUpdateStats();
+	void updateImagesResidency();
 	
 public:
 	typedef std::set<LLPointer<LLViewerImage> > image_list_t;	
@@ -62,6 +62,8 @@
 #include "v4math.h"
 #include "m3math.h"
 #include "m4math.h"
+#include "llskinning.h"
+#include "llsys.h"
 
 #if !LL_DARWIN && !LL_LINUX && !LL_SOLARIS
 extern PFNGLWEIGHTPOINTERARBPROC glWeightPointerARB;
@@ -168,6 +170,8 @@ LLViewerJointMesh::LLViewerJointMesh()
 	mMeshID = 0;
 	mUpdateXform = FALSE;
 
+	mSkinCacheValid = FALSE;
+
 	mValid = FALSE;
 }
 
@@ -666,6 +670,8 @@ void LLViewerJointMesh::updateFaceSizes(U32 &num_vertices, U32& num_indices, F32
 void LLViewerJointMesh::updateFaceData(LLFace *face, F32 pixel_area, BOOL damp_wind)
 {
 	mFace = face;
+	// the unskinned vertices are written back, so the next skin must run
+	mSkinCacheValid = FALSE;
 
 	if (mFace->mVertexBuffer.isNull())
 	{
@@ -852,6 +858,7 @@ void LLViewerJointMesh::updateVectorize()
 	std::string vp;
 	switch(sVectorizeProcessor)
 	{
+		case 3: vp = "AVX2"; break;
 		case 2: vp = "SSE2"; break;					// *TODO: replace the magic #s
 		case 1: vp = "SSE"; break;
 		default: vp = "COMPILER DEFAULT"; break;
@@ -863,6 +870,18 @@ void LLViewerJointMesh::updateVectorize()
 	{
 		switch(sVectorizeProcessor)
 		{
+			case 3:
+				// only selected when the CPU has it, but the setting can be
+				// carried over from another machine
+				if (gSysCPU.hasAVX2() && ll_skin_avx2_built())
+				{
+					sUpdateGeometryFunc = &updateGeometryAVX2;
+				}
+				else
+				{
+					sUpdateGeometryFunc = gSysCPU.hasSSE2() ? &updateGeometrySSE2 : &updateGeometryVectorized;
+				}
+				break;
 			case 2:
 				sUpdateGeometryFunc = &updateGeometrySSE2;
 				break;
@@ -880,6 +899,68 @@ void LLViewerJointMesh::updateVectorize()
 	}
 }
 
+// static
+void LLViewerJointMesh::updateGeometryAVX2(LLFace *face, LLPolyMesh *mesh)
+{
+	// Same pivot translation as the SSE2 path, but into plain matrices; the
+	// kernel works from raw floats.
+	static LLMatrix4 sJointMat[32];
+	LLDynamicArray<LLJointRenderData*>& joint_data = mesh->getReferenceMesh()->mJointRenderData;
+
+	for (S32 j = 0, jend = joint_data.count(); j < jend; ++j)
+	{
+		const LLMatrix4& w = *joint_data[j]->mWorldMatrix;
+		const LLVector3& pivot = joint_data[j]->mSkinJoint ?
+			joint_data[j]->mSkinJoint->mRootToJointSkinOffset
+			: joint_data[j+1]->mSkinJoint->mRootToParentJointSkinOffset;
+		LLMatrix4& m = sJointMat[j];
+		m = w;
+		for (S32 i = 0; i < 4; i++)
+		{
+			m.mMatrix[VW][i] += pivot.mV[VX] * w.mMatrix[VX][i]
+							  + pivot.mV[VY] * w.mMatrix[VY][i]
+							  + pivot.mV[VZ] * w.mMatrix[VZ][i];
+		}
+	}
+
+	LLStrider<LLVector3> o_vertices;
+	LLStrider<LLVector3> o_normals;
+
+	LLVertexBuffer *buffer = face->mVertexBuffer;
+	buffer->getVertexStrider(o_vertices,  mesh->mFaceVertexOffset);
+	buffer->getNormalStrider(o_normals,   mesh->mFaceVertexOffset);
+
+	ll_skin_vertices_avx2(&sJointMat[0].mMatrix[0][0], mesh->getWeights(),
+						  mesh->getCoords()->mV, mesh->getNormals()->mV, mesh->getNumVertices(),
+						  (U8*)o_vertices.get(), o_vertices.getStride(),
+						  (U8*)o_normals.get(), o_normals.getStride());
+
+	buffer->setBuffer(0);
+}
+
+BOOL LLViewerJointMesh::skinMatricesChanged()
+{
+	LLDynamicArray<LLJointRenderData*>& joint_data = mMesh->getReferenceMesh()->mJointRenderData;
+	S32 count = joint_data.count();
+
+	BOOL changed = !mSkinCacheValid || (S32)mSkinnedMatrices.size() != count;
+	if (changed)
+	{
+		mSkinnedMatrices.resize(count);
+	}
+	for (S32 j = 0; j < count; ++j)
+	{
+		const LLMatrix4& mat = *joint_data[j]->mWorldMatrix;
+		if (changed || memcmp(&mSkinnedMatrices[j], &mat, sizeof(LLMatrix4)))
+		{
+			mSkinnedMatrices[j] = mat;
+			changed = TRUE;
+		}
+	}
+	mSkinCacheValid = TRUE;
+	return changed;
+}
+
 void LLViewerJointMesh::updateJointGeometry()
 {
 	if (!(mValid
@@ -892,6 +973,22 @@ void LLViewerJointMesh::updateJointGeometry()
 		return;
 	}
 
+	// Nothing to do when every joint is where it was at the last skin;
+	// standing and sitting avatars mostly are. Not used while profiling,
+	// it would hide the cost being measured.
+	static LLCachedControl<BOOL> skinning_cache("AvatarSkinningCache", TRUE);
+	if (skinning_cache && !sVectorizePerfTest)
+	{
+		if (!skinMatricesChanged())
+		{
+			return;
+		}
+	}
+	else
+	{
+		mSkinCacheValid = FALSE;
+	}
+
 	if (!sVectorizePerfTest)
 	{
 		// Once we've measured performance, just run the specified
@@ -37,8 +37,11 @@
 #include "llviewerimage.h"
 #include "llpolymesh.h"
 #include "v4color.h"
+#include "m4math.h"
 #include "llapr.h"
 
+#include <vector>
+
 class LLDrawable;
 class LLFace;
 class LLCharacter;
@@ -86,6 +89,11 @@ protected:
 	LLSkinJoint*				mSkinJoints;
 	S32							mMeshID;
 
+	// Joint world matrices the face was last software skinned with, so an
+	// avatar that holds still is not skinned again every frame.
+	std::vector<LLMatrix4>		mSkinnedMatrices;
+	BOOL						mSkinCacheValid;
+
 public:
 	static BOOL					sPipelineRender;
 	//RN: this is here for testing purposes
@@ -164,6 +172,8 @@ private:
 	static void updateGeometryVectorized(LLFace* face, LLPolyMesh* mesh);
 	static void updateGeometrySSE(LLFace* face, LLPolyMesh* mesh);
 	static void updateGeometrySSE2(LLFace* face, LLPolyMesh* mesh);
+	// eight vertices at a time, kernel in llmath/llskinning_avx2.cpp
+	static void updateGeometryAVX2(LLFace* face, LLPolyMesh* mesh);
 
 	// Use a fuction pointer to indicate which version we are running.
 	static void (*sUpdateGeometryFunc)(LLFace* face, LLPolyMesh* mesh);
@@ -174,6 +184,10 @@ private:
 
 	// Free skin data
 	void freeSkinData();
+
+	// Compares the joint matrices against the last skin and remembers them;
+	// FALSE means the skinned vertices in the face are still current.
+	BOOL skinMatricesChanged();
 };
 
 #endif // LL_LLVIEWERJOINTMESH_H
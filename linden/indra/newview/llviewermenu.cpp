@@ -48,6 +48,7 @@
 #include "llfeaturemanager.h"
 #include "llfocusmgr.h"
 #include "llfontgl.h"
+#include "llfontlayoutcache.h"
 #include "llinstantmessage.h"
 #include "llpermissionsflags.h"
 #include "llrect.h"
@@ -82,6 +83,7 @@
 #include "lldrawpooltree.h"
 #include "llface.h"
 #include "llfirstuse.h"
+#include "llflexiblesolver.h"
 #include "llfloater.h"
 #include "floaterao.h"
 #include "floaterdice.h"
@@ -227,6 +229,7 @@
 #include "llfloaternotificationsconsole.h"
 
 #include "lltexlayer.h"
+#include "llviewerpartsim.h"
 #include "primbackup.h"
 
 #include "jcfloater_animation_list.h"
@@ -9556,6 +9559,38 @@ class LLAdvancedDumpRegionObjectCache : public view_listener_t
 
 
 
+///////////////
+// BENCHMARK //
+///////////////
+
+
+class LLAdvancedBenchmark : public view_listener_t
+{
+	bool handleEvent(LLPointer<LLEvent> event, const LLSD& userdata)
+	{
+		std::string benchmark = userdata.asString();
+		if ("particles" == benchmark)
+		{
+			// Particle groups belong to a region, so there has to be one
+			if (gAgent.getRegion())
+			{
+				LLViewerPartSim::getInstance()->benchmark(50000);
+			}
+		}
+		else if ("flexible prims" == benchmark)
+		{
+			LLFlexibleSolver::benchmark(1000);
+		}
+		else if ("text layout" == benchmark)
+		{
+			LLFontLayoutCache::benchmark(LLFontGL::getFontSansSerifSmall(), 10000);
+		}
+		return true;
+	}
+};
+
+
+
 //////////////////////
 // WEB BROWSER TEST //
 //////////////////////
@@ -11443,6 +11478,7 @@ void initialize_menus()
 	// Advanced > World
 	addMenu(new LLAdvancedDumpScriptedCamera(), "Advanced.DumpScriptedCamera");
 	addMenu(new LLAdvancedDumpRegionObjectCache(), "Advanced.DumpRegionObjectCache");
+	addMenu(new LLAdvancedBenchmark(), "Advanced.Benchmark");
 
 	// Advanced > UI
 	addMenu(new LLAdvancedWebBrowserTest(), "Advanced.WebBrowserTest");
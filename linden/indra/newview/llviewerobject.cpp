@@ -172,6 +172,8 @@ LLViewerObject::LLViewerObject(const LLUUID &id, const LLPCode pcode, LLViewerRe
 	mChildList(),
 	mID(id),
 	mLocalID(0),
+	mLocalIDTableIndex(0),
+	mLocalIDTableKey(0),
 	mTotalCRC(0),
 	mTEImages(NULL),
 	mGLName(0),
@@ -683,9 +685,25 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 	LLMemType mt(LLMemType::MTYPE_OBJECT);
 	U32 retval = 0x0;
 	
+	// Held back terse updates come without a message; what we would have read
+	// from it was saved when they arrived.
+	const LLUpdateMessageContext* replay = mesgsys ? NULL : gObjectList.getReplayContext();
+	if (!mesgsys && (!replay || !dp || update_type != OUT_TERSE_IMPROVED))
+	{
+		llwarns << "Update for " << mID << " has no message to read from" << llendl;
+		return retval;
+	}
+
 	// Coordinates of objects on simulators are region-local.
 	U64 region_handle;
-	mesgsys->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
+	if (replay)
+	{
+		region_handle = replay->mRegionHandle;
+	}
+	else
+	{
+		mesgsys->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
+	}
 	mRegionp = LLWorld::getInstance()->getRegionFromHandle(region_handle);
 	if (!mRegionp)
 	{
@@ -697,10 +715,21 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 	}
 
 	U16 time_dilation16;
-	mesgsys->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, time_dilation16);
+	if (replay)
+	{
+		time_dilation16 = replay->mTimeDilation;
+	}
+	else
+	{
+		mesgsys->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, time_dilation16);
+	}
 	F32 time_dilation = ((F32) time_dilation16) / 65535.f;
 	mTimeDilation = time_dilation;
-	mRegionp->setTimeDilation(time_dilation);
+	if (!replay)
+	{
+		// newer messages from the region have already set this
+		mRegionp->setTimeDilation(time_dilation);
+	}
 
 	// this will be used to determine if we've really changed position
 	// Use getPosition, not getPositionRegion, since this is what we're comparing directly against.
@@ -1278,19 +1307,10 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 	}
 	else
 	{
-		// handle the compressed case
-		LLUUID sound_uuid;
-		LLUUID	owner_id;
-		F32    gain = 0;
-		U8     sound_flags = 0;
-		F32		cutoff = 0;
+		// handle the compressed case, decoded by LLViewerObjectList::processUpdateCore()
+		const LLObjectUpdateData& update = *gObjectList.getDecodedUpdate();
 
-		U16 val[4];
-
-		U8		state;
-
-		dp->unpackU8(state, "State");
-		mState = state;
+		mState = update.mState;
 
 		switch(update_type)
 		{
@@ -1299,43 +1319,16 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 #ifdef DEBUG_UPDATE_TYPE
 				llinfos << "CompTI:" << getID() << llendl;
 #endif
-				U8		value;
-				dp->unpackU8(value, "agent");
-				if (value)
+				if (update.mHasFootPlane)
 				{
-					LLVector4 collision_plane;
-					dp->unpackVector4(collision_plane, "Plane");
-					((LLVOAvatar*)this)->setFootPlane(collision_plane);
+					((LLVOAvatar*)this)->setFootPlane(update.mFootPlane);
 				}
 				test_pos_parent = getPosition();
-				dp->unpackVector3(new_pos_parent, "Pos");
-				dp->unpackU16(val[VX], "VelX");
-				dp->unpackU16(val[VY], "VelY");
-				dp->unpackU16(val[VZ], "VelZ");
-				setVelocity(U16_to_F32(val[VX], -128.f, 128.f),
-							U16_to_F32(val[VY], -128.f, 128.f),
-							U16_to_F32(val[VZ], -128.f, 128.f));
-				dp->unpackU16(val[VX], "AccX");
-				dp->unpackU16(val[VY], "AccY");
-				dp->unpackU16(val[VZ], "AccZ");
-				setAcceleration(U16_to_F32(val[VX], -64.f, 64.f),
-								U16_to_F32(val[VY], -64.f, 64.f),
-								U16_to_F32(val[VZ], -64.f, 64.f));
-
-				dp->unpackU16(val[VX], "ThetaX");
-				dp->unpackU16(val[VY], "ThetaY");
-				dp->unpackU16(val[VZ], "ThetaZ");
-				dp->unpackU16(val[VS], "ThetaS");
-				new_rot.mQ[VX] = U16_to_F32(val[VX], -1.f, 1.f);
-				new_rot.mQ[VY] = U16_to_F32(val[VY], -1.f, 1.f);
-				new_rot.mQ[VZ] = U16_to_F32(val[VZ], -1.f, 1.f);
-				new_rot.mQ[VS] = U16_to_F32(val[VS], -1.f, 1.f);
-				dp->unpackU16(val[VX], "AccX");
-				dp->unpackU16(val[VY], "AccY");
-				dp->unpackU16(val[VZ], "AccZ");
-				setAngularVelocity(	U16_to_F32(val[VX], -64.f, 64.f),
-									U16_to_F32(val[VY], -64.f, 64.f),
-									U16_to_F32(val[VZ], -64.f, 64.f));
+				new_pos_parent = update.mPosition;
+				setVelocity(update.mVelocity);
+				setAcceleration(update.mAcceleration);
+				new_rot = update.mRotation;
+				setAngularVelocity(update.mAngularVelocity);
 			}
 			break;
 			case OUT_FULL_COMPRESSED:
@@ -1344,9 +1337,9 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 #ifdef DEBUG_UPDATE_TYPE
 				llinfos << "CompFull:" << getID() << llendl;
 #endif
-				dp->unpackU32(crc, "CRC");
+				crc = update.mCRC;
 				mTotalCRC = crc;
-				dp->unpackU8(material, "Material");
+				material = update.mMaterial;
 				U8 old_material = getMaterial();
 				if (old_material != material)
 				{
@@ -1356,50 +1349,33 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 						gPipeline.markMoved(mDrawable, FALSE); // undamped
 					}
 				}
-				dp->unpackU8(click_action, "ClickAction");
+				click_action = update.mClickAction;
 				setClickAction(click_action);
-				dp->unpackVector3(new_scale, "Scale");
-				dp->unpackVector3(new_pos_parent, "Pos");
-				LLVector3 vec;
-				dp->unpackVector3(vec, "Rot");
-				new_rot.unpackFromVector3(vec);
+				new_scale = update.mScale;
+				new_pos_parent = update.mPosition;
+				new_rot = update.mRotation;
 				setAcceleration(LLVector3::zero);
 
-				U32 value;
-				dp->unpackU32(value, "SpecialCode");
-				dp->setPassFlags(value);
-				dp->unpackUUID(owner_id, "Owner");
+				U32 value = update.mSpecialCode;
+				const LLUUID& owner_id = update.mOwnerID;
 
 				if (value & 0x80)
 				{
-					dp->unpackVector3(vec, "Omega");
-					setAngularVelocity(vec);
+					setAngularVelocity(update.mAngularVelocity);
 				}
 
-				if (value & 0x20)
-				{
-					dp->unpackU32(parent_id, "ParentID");
-				}
-				else
-				{
-					parent_id = 0;
-				}
+				parent_id = update.mParentID;
 
-				S32 sp_size;
-				U32 size;
-				if (value & 0x2)
-				{
-					sp_size = 1;
-					delete [] mData;
-					mData = new U8[1];
-					dp->unpackU8(((U8*)mData)[0], "TreeData");
-				}
-				else if (value & 0x1)
+				if (value & (0x2 | 0x1))
 				{
-					dp->unpackU32(size, "ScratchPadSize");
+					// TreeData or ScratchPad
+					U32 size = (U32)update.mScratchPad.size();
 					delete [] mData;
 					mData = new U8[size];
-					dp->unpackBinaryData((U8 *)mData, sp_size, "PartData");
+					if (size)
+					{
+						memcpy(mData, &update.mScratchPad[0], size);	/* Flawfinder: ignore */
+					}
 				}
 				else
 				{
@@ -1419,17 +1395,12 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
 				if (value & 0x4)
 				{
-					std::string temp_string;
-					dp->unpackString(temp_string, "Text");
-					LLColor4U coloru;
-					dp->unpackBinaryDataFixed(coloru.mV, 4, "Color");
-					coloru.mV[3] = 255 - coloru.mV[3];
-					mText->setColor(LLColor4(coloru));
-					mText->setStringUTF8(temp_string);
+					mText->setColor(LLColor4(update.mTextColor));
+					mText->setStringUTF8(update.mText);
 // [RLVa:KB] - Version: 1.23.4 | Checked: 2009-07-09 (RLVa-1.0.0f) | Added: RLVa-1.0.0f
 					if (rlv_handler_t::isEnabled())
 					{
-						mText->setObjectText(temp_string);
+						mText->setObjectText(update.mText);
 					}
 // [/RLVa:KB]
 
@@ -1443,8 +1414,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
 				if (value & 0x200)
 				{
-					std::string media_url;
-					dp->unpackString(media_url, "MediaURL");
+					const std::string& media_url = update.mMediaURL;
 					if (!mMedia)
 					{
 						retval |= MEDIA_URL_ADDED;
@@ -1472,7 +1442,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 				//
 				if (value & 0x8)
 				{
-					unpackParticleSource(*dp, owner_id);
+					unpackParticleSource(update.mPartSysData, owner_id);
 				}
 				else
 				{
@@ -1487,18 +1457,12 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 				}
 
 				// Unpack extra params
-				U8 num_parameters;
-				dp->unpackU8(num_parameters, "num_params");
-				U8 param_block[MAX_OBJECT_PARAMS_SIZE];
-				for (U8 param=0; param<num_parameters; ++param)
+				for (S32 param = 0; param < update.mNumExtraParams; ++param)
 				{
-					U16 param_type;
-					S32 param_size;
-					dp->unpackU16(param_type, "param_type");
-					dp->unpackBinaryData(param_block, param_size, "param_data");
-					//llinfos << "Param type: " << param_type << ", Size: " << param_size << llendl;
-					LLDataPackerBinaryBuffer dp2(param_block, param_size);
-					unpackParameterEntry(param_type, &dp2);
+					const LLObjectUpdateData::ExtraParam& extra = update.mExtraParams[param];
+					//llinfos << "Param type: " << extra.mType << ", Size: " << extra.mSize << llendl;
+					LLDataPackerBinaryBuffer dp2((U8*)extra.mData, extra.mSize);
+					unpackParameterEntry(extra.mType, &dp2);
 				}
 
 				for (iter = mExtraParameterList.begin(); iter != mExtraParameterList.end(); ++iter)
@@ -1510,25 +1474,14 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 					}
 				}
 
-				if (value & 0x10)
-				{
-					dp->unpackUUID(sound_uuid, "SoundUUID");
-					dp->unpackF32(gain, "SoundGain");
-					dp->unpackU8(sound_flags, "SoundFlags");
-					dp->unpackF32(cutoff, "SoundRadius");
-				}
-
 				if (value & 0x100)
 				{
-					std::string name_value_list;
-					dp->unpackString(name_value_list, "NV");
-
-					setNameValueList(name_value_list);
+					setNameValueList(update.mNameValues);
 				}
 
 				mTotalCRC = crc;
 
-				setAttachedSound(sound_uuid, owner_id, gain, sound_flags);
+				setAttachedSound(update.mSoundID, owner_id, update.mSoundGain, update.mSoundFlags);
 
 				// only get these flags on updates from sim, not cached ones
 				// Preload these five flags for every object.
@@ -1567,13 +1520,9 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 			else
 			{
 				// No parent now, new parent in message -> attach to that parent if possible
-				LLUUID parent_uuid;
-				LLViewerObjectList::getUUIDFromLocal(parent_uuid,
-														parent_id,
-														mesgsys->getSenderIP(),
-														mesgsys->getSenderPort());
-
-				LLViewerObject *sent_parentp = gObjectList.findObject(parent_uuid);
+				LLViewerObject *sent_parentp = LLViewerObjectList::findObjectFromLocal(parent_id,
+																					mesgsys->getSenderIP(),
+																					mesgsys->getSenderPort());
 
 				//
 				// Check to see if we have the corresponding viewer object for the parent.
@@ -1704,12 +1653,9 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 				}
 				else
 				{
-					LLUUID parent_uuid;
-					LLViewerObjectList::getUUIDFromLocal(parent_uuid,
-														parent_id,
-														gMessageSystem->getSenderIP(),
-														gMessageSystem->getSenderPort());
-					sent_parentp = gObjectList.findObject(parent_uuid);
+					sent_parentp = LLViewerObjectList::findObjectFromLocal(parent_id,
+																		 gMessageSystem->getSenderIP(),
+																		 gMessageSystem->getSenderPort());
 					
 					if (isAvatar())
 					{
@@ -1822,9 +1768,17 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
 	new_rot.normQuat();
 
+	if (replay)
+	{
+		// Catch up with the time the update spent waiting.
+		F32 delay = mTimeDilation * (F32)(LLFrameTimer::getElapsedSeconds() - replay->mReceivedTime);
+		new_pos_parent += getVelocity() * delay;
+	}
+
 	if (gPingInterpolate)
 	{ 
-		LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(mesgsys->getSender());
+		LLHost sender = replay ? LLHost(replay->mSenderIP, replay->mSenderPort) : mesgsys->getSender();
+		LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(sender);
 		if (cdp)
 		{
 			F32 ping_delay = 0.5f * mTimeDilation * ( ((F32)cdp->getPingDelay()) * 0.001f + gFrameDTClamped);
@@ -1843,7 +1797,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 	//
 	//
 
-	U32 packet_id = mesgsys->getCurrentRecvPacketID(); 
+	U32 packet_id = replay ? replay->mPacketID : mesgsys->getCurrentRecvPacketID(); 
 	if (packet_id < mLatestRecvPacketID && 
 		mLatestRecvPacketID - packet_id < 65536)
 	{
@@ -1999,6 +1953,152 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 	return retval;
 }
 
+// static
+void LLViewerObject::decodeUpdate(LLDataPacker &dp, const EObjectUpdateType update_type,
+								  const LLPCode pcode, LLObjectUpdateData &update)
+{
+	U16 val[4];
+
+	update.mPCode = pcode;
+	dp.unpackU8(update.mState, "State");
+
+	if (OUT_TERSE_IMPROVED == update_type)
+	{
+		U8 value;
+		dp.unpackU8(value, "agent");
+		update.mHasFootPlane = value ? TRUE : FALSE;
+		if (value)
+		{
+			dp.unpackVector4(update.mFootPlane, "Plane");
+		}
+		dp.unpackVector3(update.mPosition, "Pos");
+		dp.unpackU16(val[VX], "VelX");
+		dp.unpackU16(val[VY], "VelY");
+		dp.unpackU16(val[VZ], "VelZ");
+		update.mVelocity.setVec(U16_to_F32(val[VX], -128.f, 128.f),
+								U16_to_F32(val[VY], -128.f, 128.f),
+								U16_to_F32(val[VZ], -128.f, 128.f));
+		dp.unpackU16(val[VX], "AccX");
+		dp.unpackU16(val[VY], "AccY");
+		dp.unpackU16(val[VZ], "AccZ");
+		update.mAcceleration.setVec(U16_to_F32(val[VX], -64.f, 64.f),
+									U16_to_F32(val[VY], -64.f, 64.f),
+									U16_to_F32(val[VZ], -64.f, 64.f));
+
+		dp.unpackU16(val[VX], "ThetaX");
+		dp.unpackU16(val[VY], "ThetaY");
+		dp.unpackU16(val[VZ], "ThetaZ");
+		dp.unpackU16(val[VS], "ThetaS");
+		update.mRotation.mQ[VX] = U16_to_F32(val[VX], -1.f, 1.f);
+		update.mRotation.mQ[VY] = U16_to_F32(val[VY], -1.f, 1.f);
+		update.mRotation.mQ[VZ] = U16_to_F32(val[VZ], -1.f, 1.f);
+		update.mRotation.mQ[VS] = U16_to_F32(val[VS], -1.f, 1.f);
+		dp.unpackU16(val[VX], "AccX");
+		dp.unpackU16(val[VY], "AccY");
+		dp.unpackU16(val[VZ], "AccZ");
+		update.mAngularVelocity.setVec(U16_to_F32(val[VX], -64.f, 64.f),
+									   U16_to_F32(val[VY], -64.f, 64.f),
+									   U16_to_F32(val[VZ], -64.f, 64.f));
+		return;
+	}
+
+	dp.unpackU32(update.mCRC, "CRC");
+	dp.unpackU8(update.mMaterial, "Material");
+	dp.unpackU8(update.mClickAction, "ClickAction");
+	dp.unpackVector3(update.mScale, "Scale");
+	dp.unpackVector3(update.mPosition, "Pos");
+	LLVector3 vec;
+	dp.unpackVector3(vec, "Rot");
+	update.mRotation.unpackFromVector3(vec);
+
+	U32 value;
+	dp.unpackU32(value, "SpecialCode");
+	update.mSpecialCode = value;
+	dp.unpackUUID(update.mOwnerID, "Owner");
+
+	if (value & 0x80)
+	{
+		dp.unpackVector3(update.mAngularVelocity, "Omega");
+	}
+
+	update.mParentID = 0;
+	if (value & 0x20)
+	{
+		dp.unpackU32(update.mParentID, "ParentID");
+	}
+
+	if (value & 0x2)
+	{
+		update.mScratchPad.resize(1);
+		dp.unpackU8(update.mScratchPad[0], "TreeData");
+	}
+	else if (value & 0x1)
+	{
+		U32 size;
+		S32 sp_size;
+		dp.unpackU32(size, "ScratchPadSize");
+		update.mScratchPad.resize(llmax(size, (U32)1));
+		dp.unpackBinaryData(&update.mScratchPad[0], sp_size, "PartData");
+		update.mScratchPad.resize(size);
+	}
+
+	if (value & 0x4)
+	{
+		dp.unpackString(update.mText, "Text");
+		dp.unpackBinaryDataFixed(update.mTextColor.mV, 4, "Color");
+		update.mTextColor.mV[3] = 255 - update.mTextColor.mV[3];
+	}
+
+	if (value & 0x200)
+	{
+		dp.unpackString(update.mMediaURL, "MediaURL");
+	}
+
+	if (value & 0x8)
+	{
+		update.mPartSysData.unpack(dp);
+	}
+
+	U8 num_parameters;
+	dp.unpackU8(num_parameters, "num_params");
+	update.mNumExtraParams = num_parameters;
+	if ((S32)update.mExtraParams.size() < update.mNumExtraParams)
+	{
+		update.mExtraParams.resize(update.mNumExtraParams);
+	}
+	for (S32 param = 0; param < update.mNumExtraParams; ++param)
+	{
+		LLObjectUpdateData::ExtraParam& extra = update.mExtraParams[param];
+		dp.unpackU16(extra.mType, "param_type");
+		if (!dp.unpackBinaryData(extra.mData, extra.mSize, "param_data"))
+		{
+			extra.mSize = 0;
+		}
+	}
+
+	update.mSoundID.setNull();
+	update.mSoundGain = 0.f;
+	update.mSoundFlags = 0;
+	update.mSoundRadius = 0.f;
+	if (value & 0x10)
+	{
+		dp.unpackUUID(update.mSoundID, "SoundUUID");
+		dp.unpackF32(update.mSoundGain, "SoundGain");
+		dp.unpackU8(update.mSoundFlags, "SoundFlags");
+		dp.unpackF32(update.mSoundRadius, "SoundRadius");
+	}
+
+	if (value & 0x100)
+	{
+		dp.unpackString(update.mNameValues, "NV");
+	}
+
+	if (LL_PCODE_VOLUME == pcode)
+	{
+		LLVOVolume::decodeVolumeUpdate(dp, update);
+	}
+}
+
 BOOL LLViewerObject::isActive() const
 {
 	return TRUE;
@@ -4281,7 +4381,7 @@ void LLViewerObject::unpackParticleSource(const S32 block_num, const LLUUID& own
 	}
 }
 
-void LLViewerObject::unpackParticleSource(LLDataPacker &dp, const LLUUID& owner_id)
+void LLViewerObject::unpackParticleSource(const LLPartSysData& particle_parameters, const LLUUID& owner_id)
 {
 	if (!mPartSourcep.isNull() && mPartSourcep->isDead())
 	{
@@ -4290,7 +4390,7 @@ void LLViewerObject::unpackParticleSource(LLDataPacker &dp, const LLUUID& owner_
 	if (mPartSourcep)
 	{
 		// If we've got one already, just update the existing source (or remove it)
-		if (!LLViewerPartSourceScript::unpackPSS(this, mPartSourcep, dp))
+		if (!LLViewerPartSourceScript::unpackPSS(this, mPartSourcep, particle_parameters))
 		{
 			mPartSourcep->setDead();
 			mPartSourcep = NULL;
@@ -4298,7 +4398,7 @@ void LLViewerObject::unpackParticleSource(LLDataPacker &dp, const LLUUID& owner_
 	}
 	else
 	{
-		LLPointer<LLViewerPartSourceScript> pss = LLViewerPartSourceScript::unpackPSS(this, NULL, dp);
+		LLPointer<LLViewerPartSourceScript> pss = LLViewerPartSourceScript::unpackPSS(this, NULL, particle_parameters);
 		//If the owner is muted, don't create the system
 		if(LLMuteList::getInstance()->isMuted(owner_id, LLMute::flagParticles)) return;
 		// We need to be able to deal with a particle source that hasn't changed, but still got an update!
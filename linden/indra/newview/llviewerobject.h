@@ -42,13 +42,17 @@
 #include "llinventory.h"
 #include "llmemory.h"
 #include "llmemtype.h"
+#include "llpartdata.h"
 #include "llprimitive.h"
+#include "lltextureanim.h"
 #include "lluuid.h"
 #include "llvoinventorylistener.h"
 #include "object_flags.h"
 #include "llquaternion.h"
 #include "v3dmath.h"
 #include "v3math.h"
+#include "v4coloru.h"
+#include "v4math.h"
 #include "llvertexbuffer.h"
 
 class LLAgent;			// TODO: Get rid of this.
@@ -114,6 +118,73 @@ public:
 	LLColor4	mColor;
 };
 
+// Everything processUpdateMessage() reads from the message system for a
+// compressed terse update, apart from the object data itself. LLViewerObjectList
+// keeps one with each update it holds back for a low interest object and
+// replays the update later with mesgsys == NULL.
+struct LLUpdateMessageContext
+{
+	U64				mRegionHandle;
+	U16				mTimeDilation;
+	U32				mSenderIP;
+	U32				mSenderPort;
+	U32				mPacketID;
+	F64				mReceivedTime;	// LLFrameTimer::getElapsedSeconds() on arrival
+};
+
+// The body of a compressed object update, unpacked into plain values by
+// LLViewerObject::decodeUpdate() without touching the object, so it can run on
+// LLThreadPool threads. processUpdateMessage() applies it on the main thread.
+struct LLObjectUpdateData
+{
+	struct ExtraParam
+	{
+		U16				mType;
+		S32				mSize;
+		U8				mData[MAX_OBJECT_PARAMS_SIZE];
+	};
+
+	LLPCode			mPCode;
+	U8				mState;
+	LLVector3		mPosition;
+	LLQuaternion	mRotation;
+
+	// OUT_TERSE_IMPROVED only
+	BOOL			mHasFootPlane;
+	LLVector4		mFootPlane;
+	LLVector3		mVelocity;
+	LLVector3		mAcceleration;
+	LLVector3		mAngularVelocity;	// also full updates with SpecialCode 0x80
+
+	// OUT_FULL_COMPRESSED and OUT_FULL_CACHED only
+	U32				mCRC;
+	U8				mMaterial;
+	U8				mClickAction;
+	LLVector3		mScale;
+	U32				mSpecialCode;		// which of the optional fields below are present
+	LLUUID			mOwnerID;
+	U32				mParentID;
+	std::vector<U8>	mScratchPad;
+	std::string		mText;
+	LLColor4U		mTextColor;
+	std::string		mMediaURL;
+	LLPartSysData	mPartSysData;
+	S32				mNumExtraParams;
+	std::vector<ExtraParam>	mExtraParams;	// may hold stale entries past mNumExtraParams
+	LLUUID			mSoundID;
+	F32				mSoundGain;
+	U8				mSoundFlags;
+	F32				mSoundRadius;
+	std::string		mNameValues;
+
+	// LL_PCODE_VOLUME full updates only, see LLVOVolume::decodeVolumeUpdate()
+	BOOL			mVolumeParamsValid;
+	LLVolumeParams	mVolumeParams;
+	S32				mTEResult;			// TEM_INVALID if the TextureEntry block was bad
+	LLTEContents	mTEContents;
+	LLTextureAnim	mTextureAnim;
+};
+
 //============================================================================
 
 class LLViewerObject : public LLPrimitive, public LLRefCount
@@ -159,12 +230,20 @@ public:
 	// Return codes for processUpdateMessage
 	enum { MEDIA_URL_REMOVED = 0x1, MEDIA_URL_ADDED = 0x2, MEDIA_URL_UPDATED = 0x4, INVALID_UPDATE = 0x80000000 };
 
+	// mesgsys is NULL when a held back terse update is replayed, see LLUpdateMessageContext.
+	// Compressed updates (dp set) are applied from gObjectList.getDecodedUpdate(),
+	// dp itself is only dumped to the log when the data turns out to be bogus.
 	virtual U32		processUpdateMessage(LLMessageSystem *mesgsys,
 										void **user_data,
 										U32 block_num,
 										const EObjectUpdateType update_type,
 										LLDataPacker *dp);
 
+	// Unpacks a compressed update, dp positioned just past the LocalID (terse)
+	// or PCode (full). Only reads dp, so it is safe on any thread.
+	static void		decodeUpdate(LLDataPacker &dp, const EObjectUpdateType update_type,
+								 const LLPCode pcode, LLObjectUpdateData &update);
+
 
 	virtual BOOL    isActive() const; // Whether this object needs to do an idleUpdate.
 	BOOL			onActiveList() const				{return mOnActiveList;}
@@ -524,6 +603,11 @@ public:
 	// Local ID = 0 is not used
 	U32				mLocalID;
 
+	// Where LLViewerObjectList's local id tables hold this object: simulator
+	// index (0 = not registered) and the local id it was registered under.
+	U32				mLocalIDTableIndex;
+	U32				mLocalIDTableKey;
+
 	// Last total CRC received from sim, used for caching
 	U32				mTotalCRC;
 
@@ -585,7 +669,7 @@ protected:
 	BOOL isOnMap();
 
 	void unpackParticleSource(const S32 block_num, const LLUUID& owner_id);
-	void unpackParticleSource(LLDataPacker &dp, const LLUUID& owner_id);
+	void unpackParticleSource(const LLPartSysData& particle_parameters, const LLUUID& owner_id);
 	void deleteParticleSource();
 	void setParticleSource(const LLPartSysData& particle_parameters, const LLUUID& owner_id);
 
@@ -67,6 +67,7 @@
 #include "u64.h"
 #include "llviewerimagelist.h"
 #include "lldatapacker.h"
+#include "llthreadpool.h"
 #ifdef LL_STANDALONE
 #include <zlib.h>
 #else
@@ -95,7 +96,9 @@ extern LLPipeline	gPipeline;
 // Statics for object lookup tables.
 U32						LLViewerObjectList::sSimulatorMachineIndex = 1; // Not zero deliberately, to speed up index check.
 LLMap<U64, U32>			LLViewerObjectList::sIPAndPortToIndex;
-std::map<U64, LLUUID>	LLViewerObjectList::sIndexAndLocalIDToUUID;
+std::vector<LLViewerObjectList::local_id_table_t*> LLViewerObjectList::sLocalIDTables;
+U64						LLViewerObjectList::sLastIPAndPort = 0;
+U32						LLViewerObjectList::sLastSimulatorIndex = 0;
 
 
 LLViewerObjectList::LLViewerObjectList()
@@ -111,6 +114,16 @@ LLViewerObjectList::LLViewerObjectList()
 	mNumDeadObjectUpdates = 0;
 	mNumUnknownKills = 0;
 	mNumUnknownUpdates = 0;
+	mUpdateDecodeTime = 0.f;
+	mUpdateApplyTime = 0.f;
+	mNumDecodedBlocks = 0;
+	mNumThreadedBlocks = 0;
+	mNumUpdateBlocks = 0;
+	mNumDeferredUpdates = 0;
+	mNumSkippedUpdates = 0;
+	mTerseUpdateCost = 0.f;
+	mReplayContext = NULL;
+	mDecodedUpdate = NULL;
 }
 
 LLViewerObjectList::~LLViewerObjectList()
@@ -127,36 +140,73 @@ void LLViewerObjectList::destroy()
 	mDeadObjects.clear();
 	mMapObjects.clear();
 	mUUIDObjectMap.clear();
+
+	for (std::vector<local_id_table_t*>::iterator iter = sLocalIDTables.begin();
+		 iter != sLocalIDTables.end(); ++iter)
+	{
+		delete *iter;
+	}
+	sLocalIDTables.clear();
 }
 
 
-void LLViewerObjectList::getUUIDFromLocal(LLUUID &id,
-										  const U32 local_id,
-										  const U32 ip,
-										  const U32 port)
+//static
+U32 LLViewerObjectList::getSimulatorIndex(const U32 ip, const U32 port, BOOL create)
 {
 	U64 ipport = (((U64)ip) << 32) | (U64)port;
 
+	// Nearly every lookup in a message is for the sender of the previous one.
+	if (ipport == sLastIPAndPort && sLastSimulatorIndex)
+	{
+		return sLastSimulatorIndex;
+	}
+
 	U32 index = sIPAndPortToIndex[ipport];
 
 	if (!index)
 	{
+		if (!create)
+		{
+			return 0;
+		}
 		index = sSimulatorMachineIndex++;
 		sIPAndPortToIndex[ipport] = index;
 	}
 
-	U64	indexid = (((U64)index) << 32) | (U64)local_id;
+	sLastIPAndPort = ipport;
+	sLastSimulatorIndex = index;
+	return index;
+}
+
+//static
+LLViewerObject* LLViewerObjectList::findObjectFromLocal(const U32 local_id,
+														 const U32 ip,
+														 const U32 port)
+{
+	U32 index = getSimulatorIndex(ip, port, TRUE);
+	if (index >= sLocalIDTables.size() || !sLocalIDTables[index])
+	{
+		return NULL;
+	}
+	return sLocalIDTables[index]->find(local_id);
+}
 
-	id = get_if_there(sIndexAndLocalIDToUUID, indexid, LLUUID::null);
+//static
+void LLViewerObjectList::getUUIDFromLocal(LLUUID &id,
+										  const U32 local_id,
+										  const U32 ip,
+										  const U32 port)
+{
+	LLViewerObject* objectp = findObjectFromLocal(local_id, ip, port);
+	id = objectp ? objectp->mID : LLUUID::null;
 }
 
+//static
 U64 LLViewerObjectList::getIndex(const U32 local_id,
 								 const U32 ip,
 								 const U32 port)
 {
-	U64 ipport = (((U64)ip) << 32) | (U64)port;
-
-	U32 index = sIPAndPortToIndex[ipport];
+	U32 index = getSimulatorIndex(ip, port, FALSE);
 
 	if (!index)
 	{
@@ -166,56 +216,59 @@ U64 LLViewerObjectList::getIndex(const U32 local_id,
 	return (((U64)index) << 32) | (U64)local_id;
 }
 
-BOOL LLViewerObjectList::removeFromLocalIDTable(const LLViewerObject* objectp)
+//static
+BOOL LLViewerObjectList::removeFromLocalIDTable(LLViewerObject* objectp)
 {
-	if (objectp && objectp->getRegion())
+	if (!objectp || !objectp->mLocalIDTableIndex)
 	{
-		U32 local_id = objectp->mLocalID;
-		LLHost region_host = objectp->getRegion()->getHost();
-		U32 ip = region_host.getAddress();
-		U32 port = region_host.getPort();
-		U64 ipport = (((U64)ip) << 32) | (U64)port;
-		U32 index = sIPAndPortToIndex[ipport];
+		return FALSE;
+	}
 
-		U64	indexid = (((U64)index) << 32) | (U64)local_id;
-		
-		std::map<U64, LLUUID>::iterator iter = sIndexAndLocalIDToUUID.find(indexid);
-		if (iter == sIndexAndLocalIDToUUID.end())
-		{
-			return FALSE;
-		}
-		
-		// Found existing entry
-		if (iter->second == objectp->getID())
-		{   // Full UUIDs match, so remove the entry
-			sIndexAndLocalIDToUUID.erase(iter);
-			return TRUE;
-		}
-		// UUIDs did not match - this would zap a valid entry, so don't erase it
-		//llinfos << "Tried to erase entry where id in table (" 
-		//		<< iter->second	<< ") did not match object " << object.getID() << llendl;
+	// Use where the object was registered rather than its current region and
+	// local id, which the caller may already have changed.
+	U32 index = objectp->mLocalIDTableIndex;
+	objectp->mLocalIDTableIndex = 0;
+	if (index >= sLocalIDTables.size() || !sLocalIDTables[index])
+	{
+		return FALSE;
 	}
-	return FALSE;
+	// Only removes the entry if it still points at this object, so this can't
+	// zap an object that has since taken over the local id.
+	return sLocalIDTables[index]->remove(objectp->mLocalIDTableKey, objectp);
 }
 
-void LLViewerObjectList::setUUIDAndLocal(const LLUUID &id,
+//static
+void LLViewerObjectList::setUUIDAndLocal(LLViewerObject* objectp,
 										  const U32 local_id,
 										  const U32 ip,
 										  const U32 port)
 {
-	U64 ipport = (((U64)ip) << 32) | (U64)port;
+	if (!objectp)
+	{
+		return;
+	}
 
-	U32 index = sIPAndPortToIndex[ipport];
+	// An object lives in exactly one table under one local id.
+	removeFromLocalIDTable(objectp);
 
-	if (!index)
+	U32 index = getSimulatorIndex(ip, port, TRUE);
+	if (index >= sLocalIDTables.size())
 	{
-		index = sSimulatorMachineIndex++;
-		sIPAndPortToIndex[ipport] = index;
+		sLocalIDTables.resize(index + 1, NULL);
+	}
+	if (!sLocalIDTables[index])
+	{
+		sLocalIDTables[index] = new local_id_table_t;
 	}
 
-	U64	indexid = (((U64)index) << 32) | (U64)local_id;
-
-	sIndexAndLocalIDToUUID[indexid] = id;
+	LLViewerObject* previous = sLocalIDTables[index]->set(local_id, objectp);
+	if (previous && previous != objectp)
+	{
+		// The sim reused the local id; the old object is no longer reachable by it.
+		previous->mLocalIDTableIndex = 0;
+	}
+	objectp->mLocalIDTableIndex = index;
+	objectp->mLocalIDTableKey = local_id;
 }
 
 S32 gFullObjectUpdates = 0;
@@ -226,12 +279,26 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
 										   U32 i, 
 										   const EObjectUpdateType update_type, 
 										   LLDataPacker* dpp, 
-										   BOOL just_created)
+										   BOOL just_created,
+										   const LLObjectUpdateData* update)
 {
-	LLMessageSystem* msg = gMessageSystem;
+	// Replayed updates have no message behind them, see applyDeferredUpdates().
+	LLMessageSystem* msg = mReplayContext ? NULL : gMessageSystem;
+
+	// Compressed updates are applied from their decoded form. Cached and
+	// replayed ones were not decoded up front, nor were full updates for an
+	// object that turned out not to have the PCode they were decoded for.
+	if (dpp && (!update
+				|| (update_type != OUT_TERSE_IMPROVED && update->mPCode != objectp->getPCode())))
+	{
+		LLViewerObject::decodeUpdate(*dpp, update_type, objectp->getPCode(), mInlineUpdate);
+		update = &mInlineUpdate;
+	}
 
 	// ignore returned flags
+	mDecodedUpdate = update;
 	objectp->processUpdateMessage(msg, user_data, i, update_type, dpp);
+	mDecodedUpdate = NULL;
 		
 	if (objectp->isDead())
 	{
@@ -257,7 +324,14 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
 	// RN: this must be called after we have a drawable 
 	// (from gPipeline.addObject)
 	// so that the drawable parent is set properly
-	findOrphans(objectp, msg->getSenderIP(), msg->getSenderPort());
+	if (mReplayContext)
+	{
+		findOrphans(objectp, mReplayContext->mSenderIP, mReplayContext->mSenderPort);
+	}
+	else
+	{
+		findOrphans(objectp, msg->getSenderIP(), msg->getSenderPort());
+	}
 
 	// If we're just wandering around, don't create new objects selected.
 	if (just_created 
@@ -342,14 +416,40 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		return;
 	}
 
-	U8 compressed_dpbuffer[2048];
-	LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
+	// Motion updates for objects the camera barely sees can wait and be
+	// coalesced, see applyDeferredUpdates().
+	static LLCachedControl<BOOL> throttle_updates("ObjectUpdateThrottle", TRUE);
+	BOOL defer_terse = throttle_updates && compressed && update_type == OUT_TERSE_IMPROVED;
+	LLUpdateMessageContext context;
+	LLVector3 camera_agent;
+	F32 near_distance = 0.f;
+	F32 min_pixel_area = 0.f;
+	if (defer_terse)
+	{
+		near_distance = gSavedSettings.getF32("ObjectUpdateNearDistance");
+		min_pixel_area = gSavedSettings.getF32("ObjectUpdateMinPixelArea");
+		context.mRegionHandle = region_handle;
+		mesgsys->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, context.mTimeDilation);
+		context.mSenderIP = mesgsys->getSenderIP();
+		context.mSenderPort = mesgsys->getSenderPort();
+		context.mPacketID = mesgsys->getCurrentRecvPacketID();
+		context.mReceivedTime = LLFrameTimer::getElapsedSeconds();
+		camera_agent = gAgent.getPosAgentFromGlobal(camera_global);
+	}
+
+	LLTimer decode_timer;
+	BOOL predecoded = decodeUpdateBlocks(mesgsys, num_objects, update_type, cached, compressed);
+	mUpdateDecodeTime += decode_timer.getElapsedTimeF32() * 1000.f;
+	LLTimer apply_timer;
+
+	LLDataPackerBinaryBuffer compressed_dp;
 	LLDataPacker *cached_dpp = NULL;
 	
 	for (i = 0; i < num_objects; i++)
 	{
 		LLTimer update_timer;
 		BOOL justCreated = FALSE;
+		BOOL found_local = FALSE;
 
 		if (cached)
 		{
@@ -374,34 +474,13 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		}
 		else if (compressed)
 		{
-			U8							compbuffer[2048];
-			S32							uncompressed_length = 2048;
-			S32							compressed_length;
-			
-			compressed_dp.reset();
-
-			U32 flags = 0;
-			if (update_type != OUT_TERSE_IMPROVED)
+			UpdateBlock& block = mUpdateBlocks[i];
+			if (block.mDataSize < 0)
 			{
-				mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
-			}
-			
-			if (flags & FLAGS_ZLIB_COMPRESSED)
-			{
-				compressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
-				mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compbuffer, 0, i);
-				uncompressed_length = 2048;
-				uncompress(compressed_dpbuffer, (unsigned long *)&uncompressed_length,
-						   compbuffer, compressed_length);
-				compressed_dp.assignBuffer(compressed_dpbuffer, uncompressed_length);
-			}
-			else
-			{
-				uncompressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
-				mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compressed_dpbuffer, 0, i);
-				compressed_dp.assignBuffer(compressed_dpbuffer, uncompressed_length);
+				llwarns << "Failed to inflate object update block " << i << llendl;
+				continue;
 			}
-
+			compressed_dp.assignBuffer(block.getData(), block.mDataSize);
 
 			if (update_type != OUT_TERSE_IMPROVED)
 			{
@@ -412,11 +491,11 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			else
 			{
 				compressed_dp.unpackU32(local_id, "LocalID");
-				getUUIDFromLocal(fullid,
-								 local_id,
-								 gMessageSystem->getSenderIP(),
-								 gMessageSystem->getSenderPort());
-				if (fullid.isNull())
+				objectp = findObjectFromLocal(local_id,
+											  gMessageSystem->getSenderIP(),
+											  gMessageSystem->getSenderPort());
+				found_local = TRUE;
+				if (!objectp)
 				{
 					//llwarns << "update for unknown localid " << local_id << " host " << gMessageSystem->getSender() << llendl;
 					mNumUnknownUpdates++;
@@ -426,11 +505,11 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		else if (update_type != OUT_FULL)
 		{
 			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
-			getUUIDFromLocal(fullid,
-							local_id,
-							gMessageSystem->getSenderIP(),
-							gMessageSystem->getSenderPort());
-			if (fullid.isNull())
+			objectp = findObjectFromLocal(local_id,
+										  gMessageSystem->getSenderIP(),
+										  gMessageSystem->getSenderPort());
+			found_local = TRUE;
+			if (!objectp)
 			{
 				//llwarns << "update for unknown localid " << local_id << " host " << gMessageSystem->getSender() << llendl;
 				mNumUnknownUpdates++;
@@ -442,7 +521,15 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
 		//	llinfos << "Full Update, obj " << local_id << ", global ID" << fullid << "from " << mesgsys->getSender() << llendl;
 		}
-		objectp = findObject(fullid);
+		if (found_local)
+		{
+			// Terse updates only carry the local id; the table hands back the object itself.
+			fullid = objectp ? objectp->mID : LLUUID::null;
+		}
+		else
+		{
+			objectp = findObject(fullid);
+		}
 
 		// This looks like it will break if the local_id of the object doesn't change
 		// upon boundary crossing, but we check for region id matching later...
@@ -451,8 +538,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			((objectp->mLocalID != local_id) ||
 			 (objectp->getRegion() != regionp)))
 		{
-			removeFromLocalIDTable(objectp);
-			setUUIDAndLocal(fullid,
+			setUUIDAndLocal(objectp,
 							local_id,
 							gMessageSystem->getSenderIP(),
 							gMessageSystem->getSenderPort());
@@ -516,17 +602,35 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			llwarns << "Dead object " << objectp->mID << " in UUID map 1!" << llendl;
 		}
 
+		if (defer_terse && !justCreated
+			&& !mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_TextureEntry)
+			&& isLowInterest(objectp, camera_agent, near_distance, min_pixel_area)
+			&& deferUpdate(objectp, mUpdateBlocks[i], context))
+		{
+			continue;
+		}
+
+		if (!justCreated && !mDeferredUpdates.empty())
+		{
+			// Whatever arrives now supersedes an update held back earlier.
+			dropDeferredUpdate(objectp);
+		}
+
 		if (compressed)
 		{
 			if (update_type != OUT_TERSE_IMPROVED)
 			{
 				objectp->mLocalID = local_id;
 			}
-			processUpdateCore(objectp, user_data, i, update_type, &compressed_dp, justCreated);
+			processUpdateCore(objectp, user_data, i, update_type, &compressed_dp, justCreated, &mUpdateBlocks[i].mUpdate);
 			if (update_type != OUT_TERSE_IMPROVED)
 			{
 				objectp->mRegionp->cacheFullUpdate(objectp, compressed_dp);
 			}
+			else
+			{
+				mTerseUpdateCost = lerp(mTerseUpdateCost, update_timer.getElapsedTimeF32() * 1000.f, 0.05f);
+			}
 		}
 		else if (cached)
 		{
@@ -543,9 +647,257 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		}
 	}
 
+	if (predecoded)
+	{
+		mUpdateApplyTime += apply_timer.getElapsedTimeF32() * 1000.f;
+	}
+
 	LLVOAvatar::cullAvatarsByPixelArea();
 }
 
+// Runs on LLThreadPool threads, so it may only touch its own blocks.
+class LLViewerObjectList::DecodeJob : public LLThreadPool::Job
+{
+public:
+	DecodeJob(UpdateBlock* blocks, const EObjectUpdateType update_type)
+	:	mBlocks(blocks),
+		mUpdateType(update_type)
+	{
+	}
+
+	/*virtual*/ void run(S32 begin, S32 end)
+	{
+		for (S32 i = begin; i < end; i++)
+		{
+			UpdateBlock& block = mBlocks[i];
+			if (block.mFlags & FLAGS_ZLIB_COMPRESSED)
+			{
+				uLongf length = sizeof(block.mData);
+				if (uncompress(block.mData, &length, block.mRaw, block.mRawSize) == Z_OK)
+				{
+					block.mInflated = TRUE;
+					block.mDataSize = (S32)length;
+				}
+				else
+				{
+					block.mDataSize = -1;
+				}
+			}
+			else
+			{
+				block.mDataSize = block.mRawSize;
+			}
+			if (block.mDataSize < 0)
+			{
+				continue;
+			}
+
+			// Same header processObjectUpdate() reads on the main thread.
+			LLDataPackerBinaryBuffer dp(block.getData(), block.mDataSize);
+			LLPCode pcode = 0;
+			U32 local_id;
+			if (mUpdateType != OUT_TERSE_IMPROVED)
+			{
+				LLUUID fullid;
+				dp.unpackUUID(fullid, "ID");
+				dp.unpackU32(local_id, "LocalID");
+				dp.unpackU8(pcode, "PCode");
+			}
+			else
+			{
+				dp.unpackU32(local_id, "LocalID");
+			}
+			LLViewerObject::decodeUpdate(dp, mUpdateType, pcode, block.mUpdate);
+		}
+	}
+
+private:
+	UpdateBlock*		mBlocks;
+	EObjectUpdateType	mUpdateType;
+};
+
+BOOL LLViewerObjectList::decodeUpdateBlocks(LLMessageSystem* mesgsys, S32 num_objects,
+											const EObjectUpdateType update_type, bool cached, bool compressed)
+{
+	mNumUpdateBlocks = 0;
+
+	// Cached updates are looked up in the region's cache and uncompressed ones
+	// are read straight from the message by the object, so only compressed
+	// updates are decoded up front.
+	if (!compressed)
+	{
+		return FALSE;
+	}
+
+	if ((S32)mUpdateBlocks.size() < num_objects)
+	{
+		mUpdateBlocks.resize(num_objects);
+	}
+
+	// The message system is not thread safe: copy everything out first.
+	for (S32 i = 0; i < num_objects; i++)
+	{
+		UpdateBlock& block = mUpdateBlocks[i];
+		block.mFlags = 0;
+		block.mInflated = FALSE;
+		block.mDataSize = 0;
+		if (update_type != OUT_TERSE_IMPROVED)
+		{
+			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, block.mFlags, i);
+		}
+		block.mRawSize = llmin(mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data), (S32)sizeof(block.mRaw));
+		mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, block.mRaw, 0, i, sizeof(block.mRaw));
+	}
+
+	static LLCachedControl<BOOL> threaded_decode("ThreadedObjectUpdateDecode", TRUE);
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	DecodeJob job(&mUpdateBlocks[0], update_type);
+	if (pool)
+	{
+		pool->parallelFor(job, num_objects, 4, threaded_decode ? true : false);
+		if (pool->getLastChunkCount() > 0)
+		{
+			mNumThreadedBlocks += num_objects * pool->getLastWorkerChunkCount() / pool->getLastChunkCount();
+		}
+	}
+	else
+	{
+		job.run(0, num_objects);
+	}
+
+	mNumDecodedBlocks += num_objects;
+	mNumUpdateBlocks = num_objects;
+	return TRUE;
+}
+
+BOOL LLViewerObjectList::isLowInterest(LLViewerObject* objectp, const LLVector3& camera_agent,
+										F32 near_distance, F32 min_pixel_area) const
+{
+	// Avatars, anything someone sits on, child prims (and so attachments),
+	// selections and objects without geometry are always updated right away.
+	if (objectp->isAvatar()
+		|| objectp->isSeat()
+		|| objectp->getParent()
+		|| objectp->isSelected()
+		|| objectp->mDrawable.isNull())
+	{
+		return FALSE;
+	}
+
+	F32 distance = dist_vec(objectp->getPositionAgent(), camera_agent) - objectp->getScale().magVec() * 0.5f;
+	if (distance < near_distance)
+	{
+		return FALSE;
+	}
+	if (distance > gAgent.mDrawDistance)
+	{
+		return TRUE;
+	}
+	// The pixel area is refreshed lazily by updateApparentAngles(), which is
+	// close enough for this.
+	return objectp->getPixelArea() < min_pixel_area;
+}
+
+BOOL LLViewerObjectList::deferUpdate(LLViewerObject* objectp, UpdateBlock& block, const LLUpdateMessageContext& context)
+{
+	if (block.mDataSize <= 0 || block.mDataSize > (S32)sizeof(((DeferredUpdate*)NULL)->mData))
+	{
+		return FALSE;
+	}
+
+	DeferredUpdate& update = mDeferredUpdates[objectp];
+	if (update.mObject.isNull())
+	{
+		update.mObject = objectp;
+		update.mDeferredTime = context.mReceivedTime;
+		mDeferredQueue.push_back(objectp);
+	}
+	else
+	{
+		// Latest state wins, the update already waiting is never applied.
+		mNumSkippedUpdates++;
+	}
+	update.mContext = context;
+	update.mDataSize = block.mDataSize;
+	memcpy(update.mData, block.getData(), block.mDataSize);
+	mNumDeferredUpdates++;
+	return TRUE;
+}
+
+void LLViewerObjectList::dropDeferredUpdate(LLViewerObject* objectp)
+{
+	deferred_update_map_t::iterator iter = mDeferredUpdates.find(objectp);
+	if (iter != mDeferredUpdates.end())
+	{
+		// its entry in mDeferredQueue is skipped when it comes up
+		mDeferredUpdates.erase(iter);
+		mNumSkippedUpdates++;
+	}
+}
+
+void LLViewerObjectList::applyDeferredUpdates()
+{
+	if (!mDeferredQueue.empty())
+	{
+		LLFastTimer t(LLFastTimer::FTM_PROCESS_OBJECTS);
+
+		// Low interest objects get at most one motion update per interval,
+		// and only as many per frame as fit in the budget.
+		const F32 defer_interval = gSavedSettings.getF32("ObjectUpdateDeferInterval");
+		const F32 max_delay = gSavedSettings.getF32("ObjectUpdateMaxDelay");
+		const F32 budget_ms = gSavedSettings.getF32("ObjectUpdateDeferBudget");
+
+		const F64 now = LLFrameTimer::getElapsedSeconds();
+		LLTimer budget_timer;
+		while (!mDeferredQueue.empty())
+		{
+			deferred_update_map_t::iterator iter = mDeferredUpdates.find(mDeferredQueue.front());
+			if (iter == mDeferredUpdates.end())
+			{
+				mDeferredQueue.pop_front();
+				continue;
+			}
+
+			// The queue is oldest first, so everything behind a young update is younger still.
+			F64 age = now - iter->second.mDeferredTime;
+			if (age < defer_interval
+				|| (age < max_delay && budget_timer.getElapsedTimeF32() * 1000.f >= budget_ms))
+			{
+				break;
+			}
+
+			DeferredUpdate update = iter->second;
+			mDeferredUpdates.erase(iter);
+			mDeferredQueue.pop_front();
+
+			LLViewerObject* objectp = update.mObject;
+			if (objectp->isDead()
+				|| !LLWorld::getInstance()->getRegionFromHandle(update.mContext.mRegionHandle))
+			{
+				mNumSkippedUpdates++;
+				continue;
+			}
+
+			LLTimer update_timer;
+			LLDataPackerBinaryBuffer dp(update.mData, update.mDataSize);
+			U32 local_id;
+			dp.unpackU32(local_id, "LocalID");
+
+			mReplayContext = &update.mContext;
+			processUpdateCore(objectp, NULL, 0, OUT_TERSE_IMPROVED, &dp, FALSE);
+			mReplayContext = NULL;
+
+			mTerseUpdateCost = lerp(mTerseUpdateCost, update_timer.getElapsedTimeF32() * 1000.f, 0.05f);
+		}
+	}
+
+	mNumDeferredUpdatesStat.addValue(mNumDeferredUpdates);
+	mNumSkippedUpdatesStat.addValue(mNumSkippedUpdates);
+	mUpdateTimeSavedStat.addValue(mNumSkippedUpdates * mTerseUpdateCost);
+	mNumDeferredUpdates = 0;
+	mNumSkippedUpdates = 0;
+}
+
 void LLViewerObjectList::processCompressedObjectUpdate(LLMessageSystem *mesgsys,
 											 void **user_data,
 											 const EObjectUpdateType update_type)
@@ -673,6 +1025,8 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 	//clear avatar LOD change counter
 	LLVOAvatar::sNumLODChangesThisFrame = 0;
 
+	applyDeferredUpdates();
+
 	const F64 frame_time = LLFrameTimer::getElapsedSeconds();
 	
 	std::vector<LLViewerObject*> kill_list;
@@ -700,6 +1054,9 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 
 	static BOOL* sFreezeTime = rebind_llcontrol<BOOL>("FreezeTime", &gSavedSettings, true);
 
+	// avatar animation from the idle updates below is batched and joined here
+	LLVOAvatar::beginAnimationStage();
+
 	if ((*sFreezeTime))
 	{
 		for (std::vector<LLViewerObject*>::iterator iter = idle_list.begin();
@@ -737,6 +1094,14 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 		}
 	}
 
+	LLVOAvatar::endAnimationStage();
+	for (S32 i = 0; i < LLCharacter::ANIMATION_LOD_COUNT; i++)
+	{
+		mAnimationLODStat[i].addValue(LLVOAvatar::sAnimationLODCounts[i]);
+	}
+	mAnimationTimeStat.addValue(LLVOAvatar::sAnimationTime);
+	mAnimationTimeSavedStat.addValue(LLVOAvatar::sAnimationTimeSaved);
+
 	mNumSizeCulled = 0;
 	mNumVisCulled = 0;
 
@@ -833,6 +1198,7 @@ void LLViewerObjectList::cleanupReferences(LLViewerObject *objectp)
 
 	mUUIDObjectMap.erase(objectp->mID);
 	removeFromLocalIDTable(objectp);
+	dropDeferredUpdate(objectp);
 
 	if (objectp->onActiveList())
 	{
@@ -930,6 +1296,9 @@ void LLViewerObjectList::killAllObjects()
 
 	cleanDeadObjects(FALSE);
 
+	mDeferredUpdates.clear();
+	mDeferredQueue.clear();
+
 	if(!mObjects.empty())
 	{
 		llwarns << "LLViewerObjectList::killAllObjects still has entries in mObjects: " << mObjects.count() << llendl;
@@ -1363,7 +1732,7 @@ LLViewerObject *LLViewerObjectList::createObject(const LLPCode pcode, LLViewerRe
 	}
 
 	mUUIDObjectMap[fullid] = objectp;
-	setUUIDAndLocal(fullid,
+	setUUIDAndLocal(objectp,
 					local_id,
 					gMessageSystem->getSenderIP(),
 					gMessageSystem->getSenderPort());
@@ -33,12 +33,16 @@
 #ifndef LL_LLVIEWEROBJECTLIST_H
 #define LL_LLVIEWEROBJECTLIST_H
 
+#include <deque>
 #include <map>
 #include <set>
+#include <vector>
 
 // common includes
+#include "llcharacter.h"
 #include "llstat.h"
 #include "lldarrayptr.h"
+#include "lllocalidtable.h"
 #include "llstring.h"
 
 // project includes
@@ -87,10 +91,22 @@ public:
 	void cleanDeadObjects(const BOOL use_timer = TRUE);	// Clean up the dead object list.
 
 	// Simulator and viewer side object updates...
-	void processUpdateCore(LLViewerObject* objectp, void** data, U32 block, const EObjectUpdateType update_type, LLDataPacker* dpp, BOOL justCreated);
+	// update is the decoded form of dpp if the caller already has it, otherwise dpp is decoded here.
+	void processUpdateCore(LLViewerObject* objectp, void** data, U32 block, const EObjectUpdateType update_type, LLDataPacker* dpp, BOOL justCreated,
+						   const LLObjectUpdateData* update = NULL);
 	void processObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type, bool cached=false, bool compressed=false);
 	void processCompressedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
 	void processCachedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
+
+	// Message context of the held back terse update being replayed, if any.
+	const LLUpdateMessageContext* getReplayContext() const	{ return mReplayContext; }
+	// The compressed update processUpdateCore() is applying, if any.
+	const LLObjectUpdateData* getDecodedUpdate() const	{ return mDecodedUpdate; }
+	// Applies terse updates held back for low interest objects, oldest first,
+	// until the frame's budget runs out. Updates held past their deadline are
+	// applied regardless.
+	void applyDeferredUpdates();
+	S32 getNumDeferredUpdatesPending() const	{ return (S32)mDeferredUpdates.size(); }
 	void updateApparentAngles(LLAgent &agent);
 	void update(LLAgent &agent, LLWorld &world);
 
@@ -163,9 +179,26 @@ public:
 	LLStat mNumNewObjectsStat;
 	LLStat mNumSizeCulledStat;
 	LLStat mNumVisCulledStat;
+	LLStat mUpdateDecodeTimeStat;	// ms per frame spent unpacking object update blocks
+	LLStat mUpdateApplyTimeStat;	// ms per frame spent applying them to objects
+	LLStat mNumDeferredUpdatesStat;	// terse updates held back per frame for low interest objects
+	LLStat mNumSkippedUpdatesStat;	// held back updates superseded before they were applied
+	LLStat mUpdateTimeSavedStat;	// estimated ms per frame not spent applying those
+	LLStat mAnimationLODStat[LLCharacter::ANIMATION_LOD_COUNT];	// avatars animated at each LOD
+	LLStat mAnimationTimeStat;		// ms per frame spent updating avatar motions
+	LLStat mAnimationTimeSavedStat;	// estimated ms per frame the animation LODs saved
 
 	S32 mNumNewObjects;
 
+	F32 mUpdateDecodeTime;
+	F32 mUpdateApplyTime;
+	S32 mNumDecodedBlocks;
+	S32 mNumThreadedBlocks;		// blocks decoded by pool threads rather than the main thread
+
+	S32 mNumDeferredUpdates;
+	S32 mNumSkippedUpdates;
+	F32 mTerseUpdateCost;		// running average ms to apply one terse update
+
 	S32 mNumSizeCulled;
 	S32 mNumVisCulled;
 
@@ -177,12 +210,16 @@ public:
 								const U32 local_id,
 								const U32 ip,
 								const U32 port);
-	static void setUUIDAndLocal(const LLUUID &id,
+	// Same lookup without the detour through the UUID map.
+	static LLViewerObject* findObjectFromLocal(const U32 local_id,
+											   const U32 ip,
+											   const U32 port);
+	static void setUUIDAndLocal(LLViewerObject* objectp,
 								const U32 local_id,
 								const U32 ip,
 								const U32 port); // Requires knowledge of message system info!
 
-	static BOOL removeFromLocalIDTable(const LLViewerObject* objectp);
+	static BOOL removeFromLocalIDTable(LLViewerObject* objectp);
 	// Used ONLY by the orphaned object code.
 	static U64 getIndex(const U32 local_id, const U32 ip, const U32 port);
 
@@ -191,6 +228,64 @@ public:
 	S32 mNumUnknownKills;
 	S32 mNumDeadObjects;
 protected:
+	// One ObjectData block of an update message. The raw bytes are copied out of
+	// the message system on the main thread, everything else is filled in by
+	// decodeUpdateBlocks(), possibly on LLThreadPool threads.
+	struct UpdateBlock
+	{
+		U32					mFlags;
+		S32					mRawSize;
+		U8					mRaw[2048];
+		BOOL				mInflated;	// mData holds the zlib expansion of mRaw
+		S32					mDataSize;	// < 0 if the block could not be decoded
+		U8					mData[2048];
+		LLObjectUpdateData	mUpdate;	// the block past its header, if mDataSize >= 0
+
+		U8* getData()		{ return mInflated ? mData : mRaw; }
+	};
+	class DecodeJob;
+
+	// Copies the blocks of a compressed update out of the message, then inflates
+	// and unpacks them all before any object is touched. The objects are updated
+	// from the results one by one afterwards, in message order. Returns FALSE
+	// for update types that are decoded inline.
+	BOOL decodeUpdateBlocks(LLMessageSystem* mesgsys, S32 num_objects,
+							const EObjectUpdateType update_type, bool cached, bool compressed);
+
+	std::vector<UpdateBlock> mUpdateBlocks;
+	S32		mNumUpdateBlocks;
+
+	// A compressed terse update held back for a low interest object. Only the
+	// newest one per object is kept: later updates overwrite it in place.
+	struct DeferredUpdate
+	{
+		LLPointer<LLViewerObject>	mObject;
+		LLUpdateMessageContext		mContext;
+		F64							mDeferredTime;	// arrival of the first update coalesced into this one
+		S32							mDataSize;
+		U8							mData[128];
+	};
+	typedef std::map<LLViewerObject*, DeferredUpdate> deferred_update_map_t;
+
+	// Camera driven interest test: far away or tiny objects that nothing the
+	// user is doing depends on can have their motion updates held back.
+	BOOL isLowInterest(LLViewerObject* objectp, const LLVector3& camera_agent,
+					   F32 near_distance, F32 min_pixel_area) const;
+	// Holds the update back, coalescing it with one already waiting. FALSE if it
+	// has to be applied now.
+	BOOL deferUpdate(LLViewerObject* objectp, UpdateBlock& block, const LLUpdateMessageContext& context);
+	// Forgets a held back update that something newer has made obsolete.
+	void dropDeferredUpdate(LLViewerObject* objectp);
+
+	deferred_update_map_t			mDeferredUpdates;
+	// Arrival order, may name objects no longer in mDeferredUpdates. Holds a
+	// reference so a killed object's address cannot be reused by a new object
+	// while its stale entry is still queued.
+	std::deque<LLPointer<LLViewerObject> >	mDeferredQueue;
+	const LLUpdateMessageContext*	mReplayContext;
+	const LLObjectUpdateData*		mDecodedUpdate;
+	LLObjectUpdateData				mInlineUpdate;	// for updates that were not decoded up front
+
 	LLDynamicArray<U64>	mOrphanParents;	// LocalID/ip,port of orphaned objects
 	LLDynamicArray<OrphanInfo> mOrphanChildren;	// UUID's of orphaned objects
 	S32 mNumOrphans;
@@ -211,7 +306,16 @@ protected:
 	static U32 sSimulatorMachineIndex;
 	static LLMap<U64, U32> sIPAndPortToIndex;
 
-	static std::map<U64, LLUUID> sIndexAndLocalIDToUUID;
+	// Index of the simulator at ip:port, creating one if asked to.
+	static U32 getSimulatorIndex(const U32 ip, const U32 port, BOOL create);
+
+	// One local id table per simulator, indexed by simulator index. Objects
+	// are taken out of them in cleanupReferences() and when an update moves
+	// them to another region or local id, so the pointers are never stale.
+	typedef LLLocalIDTable<LLViewerObject*> local_id_table_t;
+	static std::vector<local_id_table_t*> sLocalIDTables;
+	static U64 sLastIPAndPort;
+	static U32 sLastSimulatorIndex;
 
 	std::set<LLViewerObject *> mSelectPickList;
 
@@ -45,12 +45,22 @@
 #include "llworld.h"
 #include "pipeline.h"
 #include "llspatialpartition.h"
+#include "llthreadpool.h"
+#include "llv4math.h"
+#include "llviewerimagelist.h"
 #include "llvovolume.h"
 
 const F32 PART_SIM_BOX_SIDE = 16.f;
 const F32 PART_SIM_BOX_OFFSET = 0.5f*PART_SIM_BOX_SIDE;
 const F32 PART_SIM_BOX_RAD = 0.5f*F_SQRT3*PART_SIM_BOX_SIDE;
 
+// Below this many particles to integrate, waking the thread pool costs
+// more than it saves.
+const S32 PART_THREAD_MIN_COUNT = 1024;
+
+// Free particle records beyond the particle cap go back to the heap.
+const S32 PART_MAX_FREE_RECORDS = 8192;
+
 //static
 S32 LLViewerPartSim::sMaxParticleCount = 0;
 S32 LLViewerPartSim::sParticleCount = 0;
@@ -70,6 +80,7 @@ const F32 LLViewerPartSim::PART_ADAPT_RATE_MULT_RECIP = 1.0f/PART_ADAPT_RATE_MUL
 
 
 U32 LLViewerPart::sNextPartID = 1;
+std::vector<void*> LLViewerPart::sFreeList;
 
 F32 calc_desired_size(LLVector3 pos, LLVector2 scale)
 {
@@ -106,7 +117,6 @@ void LLViewerPart::init(LLPointer<LLViewerPartSource> sourcep, LLViewerImage *im
 	mFlags = 0x00f;
 	mLastUpdateTime = 0.f;
 	mMaxAge = 10.f;
-	mSkipOffset = 0.0f;
 
 	mVPCallback = cb;
 	mPartSourcep = sourcep;
@@ -114,6 +124,283 @@ void LLViewerPart::init(LLPointer<LLViewerPartSource> sourcep, LLViewerImage *im
 	mImagep = imagep;
 }
 
+//static
+void* LLViewerPart::operator new(size_t size)
+{
+	if (size == sizeof(LLViewerPart) && !sFreeList.empty())
+	{
+		void* ptr = sFreeList.back();
+		sFreeList.pop_back();
+		return ptr;
+	}
+	return ::operator new(size);
+}
+
+//static
+void LLViewerPart::operator delete(void* ptr, size_t size)
+{
+	if (ptr && size == sizeof(LLViewerPart) && (S32)sFreeList.size() < PART_MAX_FREE_RECORDS)
+	{
+		sFreeList.push_back(ptr);
+		return;
+	}
+	::operator delete(ptr);
+}
+
+//static
+void LLViewerPart::cleanupClass()
+{
+	for (S32 i = 0; i < (S32)sFreeList.size(); i++)
+	{
+		::operator delete(sFreeList[i]);
+	}
+	sFreeList.clear();
+}
+
+
+/////////////////////////////
+//
+// LLViewerPartStore implementation
+//
+//
+
+#if LL_VECTORIZE
+// Stores value in the lanes where mask is clear, leaving the others alone
+inline void store_unmasked(F32* dest, const __m128 value, const __m128 mask)
+{
+	const __m128 old = _mm_loadu_ps(dest);
+	_mm_storeu_ps(dest, _mm_or_ps(_mm_and_ps(mask, old), _mm_andnot_ps(mask, value)));
+}
+#endif
+
+LLViewerPartStore::LLViewerPartStore()
+:	mSize(0)
+{
+}
+
+//static
+BOOL LLViewerPartStore::isScalar(const LLViewerPart& part)
+{
+	const U32 SCALAR_FLAGS = LLPartData::LL_PART_BOUNCE_MASK
+							| LLPartData::LL_PART_WIND_MASK
+							| LLPartData::LL_PART_FOLLOW_SRC_MASK
+							| LLPartData::LL_PART_TARGET_POS_MASK
+							| LLPartData::LL_PART_TARGET_LINEAR_MASK;
+	return part.mVPCallback || (part.mFlags & SCALAR_FLAGS);
+}
+
+void LLViewerPartStore::reserve(S32 capacity)
+{
+	// Whole groups of four, so integrate() needs no remainder loop
+	capacity = (capacity + 3) & ~3;
+	if (capacity <= (S32)mScalar.size())
+	{
+		return;
+	}
+	capacity = llmax(capacity, (S32)mScalar.size() * 2);
+
+	for (S32 i = 0; i < NUM_COMPONENTS; i++)
+	{
+		// Padding gets a maximum age of 1 so integrate() doesn't divide by 0
+		mData[i].resize(capacity, i == MAX_AGE ? 1.f : 0.f);
+	}
+	mScalar.resize(capacity, ~0U);
+}
+
+void LLViewerPartStore::add(const LLViewerPart& part, F32 skip_offset)
+{
+	reserve(mSize + 1);
+	S32 slot = mSize++;
+
+	mScalar[slot] = isScalar(part) ? ~0U : 0;
+	store(slot, part);
+
+	mData[ACCEL_X][slot] = part.mAccel.mV[VX];
+	mData[ACCEL_Y][slot] = part.mAccel.mV[VY];
+	mData[ACCEL_Z][slot] = part.mAccel.mV[VZ];
+	mData[MAX_AGE][slot] = part.mMaxAge;
+
+	// Interpolating between equal values keeps them, so integrate() can
+	// interpolate every particle.
+	const BOOL interp_color = part.mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK;
+	const LLColor4& start_color = interp_color ? part.mStartColor : part.mColor;
+	const LLColor4& end_color = interp_color ? part.mEndColor : part.mColor;
+	for (S32 i = 0; i < 4; i++)
+	{
+		mData[START_R + i][slot] = start_color.mV[i];
+		mData[END_R + i][slot] = end_color.mV[i];
+	}
+
+	const BOOL interp_scale = part.mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK;
+	const LLVector2& start_scale = interp_scale ? part.mStartScale : part.mScale;
+	const LLVector2& end_scale = interp_scale ? part.mEndScale : part.mScale;
+	for (S32 i = 0; i < 2; i++)
+	{
+		mData[START_SCALE_X + i][slot] = start_scale.mV[i];
+		mData[END_SCALE_X + i][slot] = end_scale.mV[i];
+	}
+
+	mData[SKIP_OFFSET][slot] = skip_offset;
+	mData[STEP_TIME][slot] = 0.f;
+}
+
+void LLViewerPartStore::remove(S32 slot)
+{
+	S32 last = --mSize;
+	if (slot != last)
+	{
+		for (S32 i = 0; i < NUM_COMPONENTS; i++)
+		{
+			mData[i][slot] = mData[i][last];
+		}
+		mScalar[slot] = mScalar[last];
+	}
+}
+
+void LLViewerPartStore::integrate(F32 lastdt, F32 skipped_time)
+{
+	const F32 base_dt = lastdt + skipped_time;
+
+#if LL_VECTORIZE
+	const __m128 base = _mm_set1_ps(base_dt);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 one = _mm_set1_ps(1.f);
+	for (S32 i = 0; i < mSize; i += 4)
+	{
+		// Scalar particles only get their time step, updateScalarPart()
+		// does the rest.
+		const __m128 scalar = _mm_loadu_ps((const F32*)&mScalar[i]);
+
+		const __m128 dt = _mm_sub_ps(base, _mm_loadu_ps(&mData[SKIP_OFFSET][i]));
+		_mm_storeu_ps(&mData[STEP_TIME][i], dt);
+		_mm_storeu_ps(&mData[SKIP_OFFSET][i], _mm_setzero_ps());
+
+		const __m128 age = _mm_add_ps(_mm_loadu_ps(&mData[AGE][i]), dt);
+		store_unmasked(&mData[AGE][i], age, scalar);
+
+		// Velocity interpolation
+		const __m128 half_dt_sq = _mm_mul_ps(half, _mm_mul_ps(dt, dt));
+		for (S32 axis = 0; axis < 3; axis++)
+		{
+			F32* posp = &mData[POS_X + axis][i];
+			F32* velp = &mData[VEL_X + axis][i];
+			const __m128 accel = _mm_loadu_ps(&mData[ACCEL_X + axis][i]);
+			const __m128 vel = _mm_loadu_ps(velp);
+			__m128 pos = _mm_add_ps(_mm_loadu_ps(posp), _mm_mul_ps(dt, vel));
+			pos = _mm_add_ps(pos, _mm_mul_ps(half_dt_sq, accel));
+			store_unmasked(posp, pos, scalar);
+			store_unmasked(velp, _mm_add_ps(vel, _mm_mul_ps(accel, dt)), scalar);
+		}
+
+		// Color and scale interpolation
+		const __m128 frac = _mm_div_ps(age, _mm_loadu_ps(&mData[MAX_AGE][i]));
+		const __m128 inv_frac = _mm_sub_ps(one, frac);
+		for (S32 c = 0; c < 4; c++)
+		{
+			const __m128 color = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&mData[START_R + c][i]), inv_frac),
+											_mm_mul_ps(_mm_loadu_ps(&mData[END_R + c][i]), frac));
+			store_unmasked(&mData[COLOR_R + c][i], color, scalar);
+		}
+		for (S32 c = 0; c < 2; c++)
+		{
+			const __m128 scale = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&mData[START_SCALE_X + c][i]), inv_frac),
+											_mm_mul_ps(_mm_loadu_ps(&mData[END_SCALE_X + c][i]), frac));
+			store_unmasked(&mData[SCALE_X + c][i], scale, scalar);
+		}
+	}
+#else
+	for (S32 i = 0; i < mSize; i++)
+	{
+		const F32 dt = base_dt - mData[SKIP_OFFSET][i];
+		mData[STEP_TIME][i] = dt;
+		mData[SKIP_OFFSET][i] = 0.f;
+		if (mScalar[i])
+		{
+			continue;
+		}
+
+		const F32 age = mData[AGE][i] + dt;
+		mData[AGE][i] = age;
+
+		const F32 half_dt_sq = 0.5f*dt*dt;
+		for (S32 axis = 0; axis < 3; axis++)
+		{
+			const F32 accel = mData[ACCEL_X + axis][i];
+			mData[POS_X + axis][i] += dt*mData[VEL_X + axis][i] + half_dt_sq*accel;
+			mData[VEL_X + axis][i] += accel*dt;
+		}
+
+		const F32 frac = age / mData[MAX_AGE][i];
+		const F32 inv_frac = 1.f - frac;
+		for (S32 c = 0; c < 4; c++)
+		{
+			mData[COLOR_R + c][i] = mData[START_R + c][i]*inv_frac + mData[END_R + c][i]*frac;
+		}
+		for (S32 c = 0; c < 2; c++)
+		{
+			mData[SCALE_X + c][i] = mData[START_SCALE_X + c][i]*inv_frac + mData[END_SCALE_X + c][i]*frac;
+		}
+	}
+#endif
+}
+
+void LLViewerPartStore::load(S32 slot, LLViewerPart& part) const
+{
+	part.mPosAgent = getPosition(slot);
+	part.mVelocity = getVelocity(slot);
+	part.mColor = getColor(slot);
+	part.mScale = getScale(slot);
+	part.mLastUpdateTime = mData[AGE][slot];
+}
+
+void LLViewerPartStore::store(S32 slot, const LLViewerPart& part)
+{
+	for (S32 i = 0; i < 3; i++)
+	{
+		mData[POS_X + i][slot] = part.mPosAgent.mV[i];
+		mData[VEL_X + i][slot] = part.mVelocity.mV[i];
+	}
+	for (S32 i = 0; i < 4; i++)
+	{
+		mData[COLOR_R + i][slot] = part.mColor.mV[i];
+	}
+	mData[SCALE_X][slot] = part.mScale.mV[VX];
+	mData[SCALE_Y][slot] = part.mScale.mV[VY];
+	mData[AGE][slot] = part.mLastUpdateTime;
+}
+
+void LLViewerPartStore::translate(const LLVector3& offset)
+{
+	for (S32 axis = 0; axis < 3; axis++)
+	{
+		F32* posp = mSize ? &mData[POS_X + axis][0] : NULL;
+		for (S32 i = 0; i < mSize; i++)
+		{
+			posp[i] += offset.mV[axis];
+		}
+	}
+}
+
+LLVector3 LLViewerPartStore::getPosition(S32 slot) const
+{
+	return LLVector3(mData[POS_X][slot], mData[POS_Y][slot], mData[POS_Z][slot]);
+}
+
+LLVector3 LLViewerPartStore::getVelocity(S32 slot) const
+{
+	return LLVector3(mData[VEL_X][slot], mData[VEL_Y][slot], mData[VEL_Z][slot]);
+}
+
+LLColor4 LLViewerPartStore::getColor(S32 slot) const
+{
+	return LLColor4(mData[COLOR_R][slot], mData[COLOR_G][slot], mData[COLOR_B][slot], mData[COLOR_A][slot]);
+}
+
+LLVector2 LLViewerPartStore::getScale(S32 slot) const
+{
+	return LLVector2(mData[SCALE_X][slot], mData[SCALE_Y][slot]);
+}
+
 
 /////////////////////////////
 //
@@ -258,149 +545,49 @@ BOOL LLViewerPartGroup::addPart(LLViewerPart* part, F32 desired_size)
 	gPipeline.markRebuild(mVOPartGroupp->mDrawable, LLDrawable::REBUILD_ALL, TRUE);
 	
 	mParticles.push_back(part);
-	part->mSkipOffset=mSkippedTime;
+	mStore.add(*part, mSkippedTime);
 	LLViewerPartSim::incPartCount(1);
 	return TRUE;
 }
 
 
+void LLViewerPartGroup::integrateParticles(const F32 lastdt)
+{
+	mStore.integrate(lastdt, mSkippedTime);
+}
+
 void LLViewerPartGroup::updateParticles(const F32 lastdt)
 {
 	LLMemType mt(LLMemType::MTYPE_PARTICLES);
-	F32 dt;
-	
-	LLVector3 gravity(0.f, 0.f, GRAVITY);
 
 	LLViewerPartSim::checkParticleCount(mParticles.size());
 
-	LLViewerRegion *regionp = getRegion();
 	S32 end = (S32) mParticles.size();
 	for (S32 i = 0 ; i < (S32)mParticles.size();)
 	{
-		LLVector3 a(0.f, 0.f, 0.f);
 		LLViewerPart* part = mParticles[i] ;
 
-		dt = lastdt + mSkippedTime - part->mSkipOffset;
-		part->mSkipOffset = 0.f;
-
-		// Update current time
-		const F32 cur_time = part->mLastUpdateTime + dt;
-		const F32 frac = cur_time / part->mMaxAge;
-
-		// "Drift" the object based on the source object
-		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
-		{
-			part->mPosAgent = part->mPartSourcep->mPosAgent;
-			part->mPosAgent += part->mPosOffset;
-		}
-
-		// Do a custom callback if we have one...
-		if (part->mVPCallback)
-		{
-			(*part->mVPCallback)(*part, dt);
-		}
-
-		if (part->mFlags & LLPartData::LL_PART_WIND_MASK)
-		{
-			LLVector3 tempVel(part->mVelocity);
-			part->mVelocity *= 1.f - 0.1f*dt;
-			part->mVelocity += 0.1f*dt*regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(part->mPosAgent));
-		}
-
-		// Now do interpolation towards a target
-		if (part->mFlags & LLPartData::LL_PART_TARGET_POS_MASK)
-		{
-			F32 remaining = part->mMaxAge - part->mLastUpdateTime;
-			F32 step = dt / remaining;
-
-			step = llclamp(step, 0.f, 0.1f);
-			step *= 5.f;
-			// we want a velocity that will result in reaching the target in the 
-			// Interpolate towards the target.
-			LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPosAgent;
-
-			delta_pos /= remaining;
-
-			part->mVelocity *= (1.f - step);
-			part->mVelocity += step*delta_pos;
-		}
-
-
-		if (part->mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
-		{
-			LLVector3 delta_pos = part->mPartSourcep->mTargetPosAgent - part->mPartSourcep->mPosAgent;			
-			part->mPosAgent = part->mPartSourcep->mPosAgent;
-			part->mPosAgent += frac*delta_pos;
-			part->mVelocity = delta_pos;
-		}
-		else
-		{
-			// Do velocity interpolation
-			part->mPosAgent += dt*part->mVelocity;
-			part->mPosAgent += 0.5f*dt*dt*part->mAccel;
-			part->mVelocity += part->mAccel*dt;
-		}
-
-		// Do a bounce test
-		if (part->mFlags & LLPartData::LL_PART_BOUNCE_MASK)
-		{
-			// Need to do point vs. plane check...
-			// For now, just check relative to object height...
-			F32 dz = part->mPosAgent.mV[VZ] - part->mPartSourcep->mPosAgent.mV[VZ];
-			if (dz < 0)
-			{
-				part->mPosAgent.mV[VZ] += -2.f*dz;
-				part->mVelocity.mV[VZ] *= -0.75f;
-			}
-		}
-
-
-		// Reset the offset from the source position
-		if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+		if (mStore.isScalar(i))
 		{
-			part->mPosOffset = part->mPosAgent;
-			part->mPosOffset -= part->mPartSourcep->mPosAgent;
+			updateScalarPart(i, *part);
 		}
 
-		// Do color interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
-		{
-			part->mColor.setVec(part->mStartColor);
-			// note: LLColor4's v%k means multiply-alpha-only,
-			//       LLColor4's v*k means multiply-rgb-only
-			part->mColor *= 1.f - frac; // rgb*k
-			part->mColor %= 1.f - frac; // alpha*k
-			part->mColor += frac%(frac*part->mEndColor); // rgb,alpha
-		}
-
-		// Do scale interpolation
-		if (part->mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
-		{
-			part->mScale.setVec(part->mStartScale);
-			part->mScale *= 1.f - frac;
-			part->mScale += frac*part->mEndScale;
-		}
-
-		// Set the last update time to now.
-		part->mLastUpdateTime = cur_time;
-
-
 		// Kill dead particles (either flagged dead, or too old)
-		if ((part->mLastUpdateTime > part->mMaxAge) || (LLViewerPart::LL_PART_DEAD_MASK == part->mFlags))
+		if ((mStore.get(LLViewerPartStore::AGE, i) > part->mMaxAge) || (LLViewerPart::LL_PART_DEAD_MASK == part->mFlags))
 		{
-			mParticles[i] = mParticles.back() ;
-			mParticles.pop_back() ;
+			removeSlot(i);
 			delete part ;
 		}
 		else 
 		{
-			F32 desired_size = calc_desired_size(part->mPosAgent, part->mScale);
-			if (!posInGroup(part->mPosAgent, desired_size))
+			LLVector3 pos_agent = mStore.getPosition(i);
+			F32 desired_size = calc_desired_size(pos_agent, mStore.getScale(i));
+			if (!posInGroup(pos_agent, desired_size))
 			{
 				// Transfer particles between groups
+				mStore.load(i, *part);
+				removeSlot(i);
 				LLViewerPartSim::getInstance()->put(part) ;
-				mParticles[i] = mParticles.back() ;
-				mParticles.pop_back() ;
 			}
 			else
 			{
@@ -430,6 +617,124 @@ void LLViewerPartGroup::updateParticles(const F32 lastdt)
 	LLViewerPartSim::checkParticleCount() ;
 }
 
+void LLViewerPartGroup::removeSlot(S32 slot)
+{
+	mParticles[slot] = mParticles.back() ;
+	mParticles.pop_back() ;
+	mStore.remove(slot);
+}
+
+// Particles that follow their source, have a target, bounce, feel the wind
+// or have a callback, updated through their record as they always were.
+void LLViewerPartGroup::updateScalarPart(S32 slot, LLViewerPart& part)
+{
+	mStore.load(slot, part);
+	const F32 dt = mStore.get(LLViewerPartStore::STEP_TIME, slot);
+
+	// Update current time
+	const F32 cur_time = part.mLastUpdateTime + dt;
+	const F32 frac = cur_time / part.mMaxAge;
+
+	// "Drift" the object based on the source object
+	if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+	{
+		part.mPosAgent = part.mPartSourcep->mPosAgent;
+		part.mPosAgent += part.mPosOffset;
+	}
+
+	// Do a custom callback if we have one...
+	if (part.mVPCallback)
+	{
+		(*part.mVPCallback)(part, dt);
+	}
+
+	if (part.mFlags & LLPartData::LL_PART_WIND_MASK)
+	{
+		LLViewerRegion *regionp = getRegion();
+		part.mVelocity *= 1.f - 0.1f*dt;
+		part.mVelocity += 0.1f*dt*regionp->mWind.getVelocity(regionp->getPosRegionFromAgent(part.mPosAgent));
+	}
+
+	// Now do interpolation towards a target
+	if (part.mFlags & LLPartData::LL_PART_TARGET_POS_MASK)
+	{
+		F32 remaining = part.mMaxAge - part.mLastUpdateTime;
+		F32 step = dt / remaining;
+
+		step = llclamp(step, 0.f, 0.1f);
+		step *= 5.f;
+		// we want a velocity that will result in reaching the target in the 
+		// Interpolate towards the target.
+		LLVector3 delta_pos = part.mPartSourcep->mTargetPosAgent - part.mPosAgent;
+
+		delta_pos /= remaining;
+
+		part.mVelocity *= (1.f - step);
+		part.mVelocity += step*delta_pos;
+	}
+
+
+	if (part.mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK)
+	{
+		LLVector3 delta_pos = part.mPartSourcep->mTargetPosAgent - part.mPartSourcep->mPosAgent;			
+		part.mPosAgent = part.mPartSourcep->mPosAgent;
+		part.mPosAgent += frac*delta_pos;
+		part.mVelocity = delta_pos;
+	}
+	else
+	{
+		// Do velocity interpolation
+		part.mPosAgent += dt*part.mVelocity;
+		part.mPosAgent += 0.5f*dt*dt*part.mAccel;
+		part.mVelocity += part.mAccel*dt;
+	}
+
+	// Do a bounce test
+	if (part.mFlags & LLPartData::LL_PART_BOUNCE_MASK)
+	{
+		// Need to do point vs. plane check...
+		// For now, just check relative to object height...
+		F32 dz = part.mPosAgent.mV[VZ] - part.mPartSourcep->mPosAgent.mV[VZ];
+		if (dz < 0)
+		{
+			part.mPosAgent.mV[VZ] += -2.f*dz;
+			part.mVelocity.mV[VZ] *= -0.75f;
+		}
+	}
+
+
+	// Reset the offset from the source position
+	if (part.mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK)
+	{
+		part.mPosOffset = part.mPosAgent;
+		part.mPosOffset -= part.mPartSourcep->mPosAgent;
+	}
+
+	// Do color interpolation
+	if (part.mFlags & LLPartData::LL_PART_INTERP_COLOR_MASK)
+	{
+		part.mColor.setVec(part.mStartColor);
+		// note: LLColor4's v%k means multiply-alpha-only,
+		//       LLColor4's v*k means multiply-rgb-only
+		part.mColor *= 1.f - frac; // rgb*k
+		part.mColor %= 1.f - frac; // alpha*k
+		part.mColor += frac%(frac*part.mEndColor); // rgb,alpha
+	}
+
+	// Do scale interpolation
+	if (part.mFlags & LLPartData::LL_PART_INTERP_SCALE_MASK)
+	{
+		part.mScale.setVec(part.mStartScale);
+		part.mScale *= 1.f - frac;
+		part.mScale += frac*part.mEndScale;
+	}
+
+	// Set the last update time to now.
+	part.mLastUpdateTime = cur_time;
+
+	mStore.store(slot, part);
+}
+
 
 void LLViewerPartGroup::shift(const LLVector3 &offset)
 {
@@ -438,10 +743,7 @@ void LLViewerPartGroup::shift(const LLVector3 &offset)
 	mMinObjPos += offset;
 	mMaxObjPos += offset;
 
-	for (S32 i = 0 ; i < (S32)mParticles.size(); i++)
-	{
-		mParticles[i]->mPosAgent += offset;
-	}
+	mStore.translate(offset);
 }
 
 void LLViewerPartGroup::removeParticlesByID(const U32 source_id)
@@ -502,6 +804,8 @@ void LLViewerPartSim::destroyClass()
 
 	// Kill all of the sources 
 	mViewerPartSources.clear();
+
+	LLViewerPart::cleanupClass();
 }
 
 BOOL LLViewerPartSim::shouldAddPart()
@@ -709,6 +1013,11 @@ void LLViewerPartSim::updateSimulation()
 		num_updates++;
 	}
 
+	static LLCachedControl<BOOL> threaded_update("ThreadedParticleUpdate", TRUE);
+
+	mUpdateGroups.clear();
+	mUpdateTimes.clear();
+	S32 num_parts = 0;
 	count = (S32) mViewerPartGroups.size();
 	for (i = 0; i < count; i++)
 	{
@@ -730,22 +1039,41 @@ void LLViewerPartSim::updateSimulation()
 			{
 				gPipeline.markRebuild(vobj->mDrawable, LLDrawable::REBUILD_ALL, TRUE);
 			}
-			mViewerPartGroups[i]->updateParticles(dt * visirate);
-			mViewerPartGroups[i]->mSkippedTime=0.0f;
-			if (!mViewerPartGroups[i]->getCount())
-			{
-				delete mViewerPartGroups[i];
-				mViewerPartGroups.erase(mViewerPartGroups.begin() + i);
-				i--;
-				count--;
-			}
+			mUpdateGroups.push_back(mViewerPartGroups[i]);
+			mUpdateTimes.push_back(dt * visirate);
+			num_parts += mViewerPartGroups[i]->getCount();
 		}
 		else
 		{	
 			mViewerPartGroups[i]->mSkippedTime+=dt;
 		}
+	}
+
+	integrateGroups(mUpdateGroups, mUpdateTimes, threaded_update && num_parts >= PART_THREAD_MIN_COUNT);
+
+	// The rest of the update may move particles between groups and create
+	// new ones, so it stays on this thread.
+	S32 next = 0;
+	for (i = 0; i < count && next < (S32)mUpdateGroups.size(); i++)
+	{
+		LLViewerPartGroup* groupp = mViewerPartGroups[i];
+		if (groupp != mUpdateGroups[next])
+		{
+			continue;
+		}
 
+		groupp->updateParticles(mUpdateTimes[next]);
+		groupp->mSkippedTime=0.0f;
+		next++;
+		if (!groupp->getCount())
+		{
+			delete groupp;
+			mViewerPartGroups.erase(mViewerPartGroups.begin() + i);
+			i--;
+			count--;
+		}
 	}
+
 	if (LLDrawable::getCurrentFrame()%16==0)
 	{
 		if (sParticleCount > sMaxParticleCount * 0.875f
@@ -768,6 +1096,148 @@ void LLViewerPartSim::updateSimulation()
 	//llinfos << "Particles: " << sParticleCount << " Adaptive Rate: " << sParticleAdaptiveRate << llendl;
 }
 
+// Integrates groups on LLThreadPool threads.  Each index only touches its
+// own group's particle store.
+class LLViewerPartSim::IntegrateJob : public LLThreadPool::Job
+{
+public:
+	IntegrateJob(const group_list_t& groups, const std::vector<F32>& times)
+	:	mGroups(groups),
+		mTimes(times)
+	{
+	}
+
+	/*virtual*/ void run(S32 begin, S32 end)
+	{
+		for (S32 i = begin; i < end; i++)
+		{
+			mGroups[i]->integrateParticles(mTimes[i]);
+		}
+	}
+
+private:
+	const group_list_t&		mGroups;
+	const std::vector<F32>&	mTimes;
+};
+
+void LLViewerPartSim::integrateGroups(const group_list_t& groups, const std::vector<F32>& times, BOOL threaded)
+{
+	IntegrateJob job(groups, times);
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	if (pool)
+	{
+		pool->parallelFor(job, (S32)groups.size(), 1, threaded ? true : false);
+	}
+	else
+	{
+		job.run(0, (S32)groups.size());
+	}
+}
+
+void LLViewerPartSim::benchmark(S32 num_parts)
+{
+	LLMemType mt(LLMemType::MTYPE_PARTICLES);
+
+	// Keep the benchmark particles and the real ones apart
+	group_list_t saved_groups;
+	saved_groups.swap(mViewerPartGroups);
+
+	LLViewerCamera* camera = LLViewerCamera::getInstance();
+	const LLVector3 center = camera->getOrigin() + camera->getAtAxis() * 24.f;
+	LLPointer<LLViewerPartSource> sourcep = new LLViewerPartSource(LLViewerPartSource::LL_PART_SOURCE_NULL);
+	sourcep->mPosAgent = center;
+	sourcep->mTargetPosAgent = center;
+	LLPointer<LLViewerImage> imagep = gImageList.getImageFromFile("pixiesmall.j2c");
+
+	// Typical script systems: a fountain, a burst, falling sparks and a
+	// bouncing one, which takes the per particle path.
+	const S32 NUM_SYSTEMS = 4;
+	LLPartSysData systems[NUM_SYSTEMS];
+	for (S32 i = 0; i < NUM_SYSTEMS; i++)
+	{
+		LLPartSysData& data = systems[i];
+		data.mFlags = LLPartSysData::LL_PART_USE_NEW_ANGLE;
+		data.mPartData.mFlags = LLPartData::LL_PART_INTERP_COLOR_MASK | LLPartData::LL_PART_INTERP_SCALE_MASK;
+		data.mPartData.mMaxAge = 10.f;
+		data.mPartData.mStartColor.setVec(1.f, 0.8f, 0.4f, 1.f);
+		data.mPartData.mEndColor.setVec(1.f, 0.2f, 0.f, 0.f);
+		data.mPartData.mStartScale.setVec(0.2f, 0.2f);
+		data.mPartData.mEndScale.setVec(0.6f, 0.6f);
+		data.mBurstRadius = 0.5f;
+		data.mBurstSpeedMin = 1.f;
+		data.mBurstSpeedMax = 3.f;
+		data.mInnerAngle = 0.f;
+		data.mOuterAngle = 0.5f;
+		data.mPartAccel.setVec(0.f, 0.f, -1.f);
+	}
+	systems[0].mPattern = LLPartSysData::LL_PART_SRC_PATTERN_ANGLE_CONE;
+	systems[0].mPartData.mFlags |= LLPartData::LL_PART_FOLLOW_VELOCITY_MASK;
+	systems[1].mPattern = LLPartSysData::LL_PART_SRC_PATTERN_EXPLODE;
+	systems[1].mPartData.mFlags |= LLPartData::LL_PART_EMISSIVE_MASK;
+	systems[2].mPattern = LLPartSysData::LL_PART_SRC_PATTERN_DROP;
+	systems[2].mPartData.mFlags = LLPartData::LL_PART_INTERP_COLOR_MASK;
+	systems[3].mPattern = LLPartSysData::LL_PART_SRC_PATTERN_EXPLODE;
+	systems[3].mPartData.mFlags |= LLPartData::LL_PART_BOUNCE_MASK;
+
+	const S32 FRAMES = 30;
+	const F32 FRAME_TIME = 1.f / 30.f;
+	for (S32 pass = 0; pass < 2; pass++)
+	{
+		const BOOL threaded = pass == 1;
+
+		LLTimer timer;
+		for (S32 i = 0; i < num_parts; i++)
+		{
+			LLViewerPart* part = new LLViewerPart();
+			part->init(sourcep, imagep, NULL);
+			LLViewerPartSourceScript::initPart(part, systems[i % NUM_SYSTEMS], center,
+											   LLQuaternion::DEFAULT, LLQuaternion::DEFAULT);
+			put(part);
+		}
+		F64 spawn_time = timer.getElapsedTimeF64();
+
+		F64 integrate_time = 0.0;
+		F64 update_time = 0.0;
+		for (S32 frame = 0; frame < FRAMES; frame++)
+		{
+			mUpdateGroups = mViewerPartGroups;
+			mUpdateTimes.assign(mUpdateGroups.size(), FRAME_TIME);
+
+			timer.reset();
+			integrateGroups(mUpdateGroups, mUpdateTimes, threaded);
+			integrate_time += timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (S32 i = 0; i < (S32)mUpdateGroups.size(); i++)
+			{
+				mUpdateGroups[i]->updateParticles(FRAME_TIME);
+			}
+			update_time += timer.getElapsedTimeF64();
+		}
+
+		S32 count = 0;
+		for (S32 i = 0; i < (S32)mViewerPartGroups.size(); i++)
+		{
+			count += mViewerPartGroups[i]->getCount();
+		}
+		llinfos << "Particle benchmark (" << (threaded ? "thread pool" : "main thread") << "): "
+				<< count << " particles in " << mViewerPartGroups.size() << " groups, spawned in "
+				<< llformat("%.2f", spawn_time * 1000.0) << " ms, integrate "
+				<< llformat("%.3f", integrate_time * 1000.0 / FRAMES) << " ms/frame, update "
+				<< llformat("%.3f", update_time * 1000.0 / FRAMES) << " ms/frame" << llendl;
+
+		for (S32 i = 0; i < (S32)mViewerPartGroups.size(); i++)
+		{
+			delete mViewerPartGroups[i];
+		}
+		mViewerPartGroups.clear();
+	}
+
+	mUpdateGroups.clear();
+	mUpdateTimes.clear();
+	mViewerPartGroups.swap(saved_groups);
+}
+
 void LLViewerPartSim::updatePartBurstRate()
 {
 	if (!(LLDrawable::getCurrentFrame() & 0xf))
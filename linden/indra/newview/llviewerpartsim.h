@@ -39,6 +39,8 @@
 #include "llpartdata.h"
 #include "llviewerpartsource.h"
 
+#include <vector>
+
 class LLViewerImage;
 class LLViewerPart;
 class LLViewerRegion;
@@ -62,16 +64,22 @@ public:
 
 	void init(LLPointer<LLViewerPartSource> sourcep, LLViewerImage *imagep, LLVPCallback cb);
 
+	// Sources create and kill particles by the thousand, so their records
+	// are recycled through a free list instead of going back to the heap.
+	static void* operator new(size_t size);
+	static void operator delete(void* ptr, size_t size);
+	static void cleanupClass();
 
 	U32					mPartID;					// Particle ID used primarily for moving between groups
 	F32					mLastUpdateTime;			// Last time the particle was updated
-	F32					mSkipOffset;				// Offset against current group mSkippedTime
 
 	LLVPCallback		mVPCallback;				// Callback function for more complicated behaviors
 	LLPointer<LLViewerPartSource> mPartSourcep;		// Particle source used for this object
 	
 
-	// Current particle state (possibly used for rendering)
+	// Particle state when spawned or moved between groups.  While the
+	// particle is in a group its current state lives in the group's
+	// LLViewerPartStore instead.
 	LLPointer<LLViewerImage>	mImagep;
 	LLVector3		mPosAgent;
 	LLVector3		mVelocity;
@@ -80,9 +88,80 @@ public:
 	LLVector2		mScale;
 
 	static U32		sNextPartID;
+
+private:
+	static std::vector<void*> sFreeList;
 };
 
 
+///////////////////
+//
+// Current state of the particles of a group, one array per component so
+// that the common case (no callback, source, target, wind or bounce) can
+// be integrated four particles at a time.  Slot i belongs to
+// LLViewerPartGroup::mParticles[i].  The arrays keep their capacity as
+// particles die, so slots are reused rather than reallocated.
+//
+
+class LLViewerPartStore
+{
+public:
+	enum EComponent
+	{
+		POS_X, POS_Y, POS_Z,
+		VEL_X, VEL_Y, VEL_Z,
+		ACCEL_X, ACCEL_Y, ACCEL_Z,
+		AGE,
+		MAX_AGE,
+		COLOR_R, COLOR_G, COLOR_B, COLOR_A,
+		START_R, START_G, START_B, START_A,		// Equal to the color unless it is interpolated
+		END_R, END_G, END_B, END_A,
+		SCALE_X, SCALE_Y,
+		START_SCALE_X, START_SCALE_Y,			// Equal to the scale unless it is interpolated
+		END_SCALE_X, END_SCALE_Y,
+		SKIP_OFFSET,							// Group skipped time when the particle was added
+		STEP_TIME,								// Time step of the last integrate()
+		NUM_COMPONENTS
+	};
+
+	LLViewerPartStore();
+
+	S32 size() const								{ return mSize; }
+
+	// Particles that need per particle work on the main thread
+	static BOOL isScalar(const LLViewerPart& part);
+	BOOL isScalar(S32 slot) const					{ return mScalar[slot] != 0; }
+
+	void add(const LLViewerPart& part, F32 skip_offset);
+	// Moves the last slot into this one
+	void remove(S32 slot);
+
+	// ANY THREAD.  Advances every particle that isn't scalar by its time
+	// step (lastdt + skipped_time - its skip offset) and records the step.
+	void integrate(F32 lastdt, F32 skipped_time);
+
+	// Copies the current state to and from the particle's record, for
+	// scalar updates and moves between groups.
+	void load(S32 slot, LLViewerPart& part) const;
+	void store(S32 slot, const LLViewerPart& part);
+
+	void translate(const LLVector3& offset);
+
+	F32 get(EComponent component, S32 slot) const	{ return mData[component][slot]; }
+	LLVector3 getPosition(S32 slot) const;
+	LLVector3 getVelocity(S32 slot) const;
+	LLColor4 getColor(S32 slot) const;
+	LLVector2 getScale(S32 slot) const;
+
+private:
+	void reserve(S32 capacity);
+
+private:
+	std::vector<F32>	mData[NUM_COMPONENTS];	// padded to a multiple of 4
+	std::vector<U32>	mScalar;				// ~0 for scalar particles, as a SIMD mask
+	S32					mSize;
+};
+
 
 class LLViewerPartGroup
 {
@@ -96,6 +175,11 @@ public:
 
 	BOOL addPart(LLViewerPart* part, const F32 desired_size = -1.f);
 	
+	// ANY THREAD.  First half of the update: integrates the particles
+	// that don't need the main thread.
+	void integrateParticles(const F32 lastdt);
+	// Second half: updates the rest one at a time, kills old particles
+	// and moves the ones that left the group.
 	void updateParticles(const F32 lastdt);
 
 	BOOL posInGroup(const LLVector3 &pos, const F32 desired_size = -1.f);
@@ -107,6 +191,7 @@ public:
 
 	const LLVector3 &getCenterAgent() const		{ return mCenterAgent; }
 	S32 getCount() const					{ return (S32) mParticles.size(); }
+	const LLViewerPartStore& getStore() const	{ return mStore; }
 	LLViewerRegion *getRegion() const		{ return mRegionp; }
 
 	void removeParticlesByID(const U32 source_id);
@@ -120,6 +205,10 @@ public:
 	bool mHud;
 
 protected:
+	void removeSlot(S32 slot);
+	void updateScalarPart(S32 slot, LLViewerPart& part);
+
+	LLViewerPartStore mStore;
 	LLVector3 mCenterAgent;
 	F32 mBoxRadius;
 	LLVector3 mMinObjPos;
@@ -204,6 +293,19 @@ public:
 	static S32 sParticleCount2;
 
 	static void checkParticleCount(U32 size = 0) ;
+
+	// Spawns num_parts particles from a few synthetic script sources in
+	// front of the camera, in groups of their own, and logs how long
+	// updating them takes with and without the thread pool.
+	void benchmark(S32 num_parts);
+
+private:
+	class IntegrateJob;
+	// Runs integrateParticles() on each group, with its time step
+	void integrateGroups(const group_list_t& groups, const std::vector<F32>& times, BOOL threaded);
+
+	group_list_t mUpdateGroups;			// scratch for updateSimulation()
+	std::vector<F32> mUpdateTimes;
 };
 
 #endif // LL_LLVIEWERPARTSIM_H
@@ -283,105 +283,13 @@ void LLViewerPartSourceScript::update(const F32 dt)
 			LLViewerPart* part = new LLViewerPart();
 
 			part->init(this, mImagep, NULL);
-			part->mFlags = mPartSysData.mPartData.mFlags;
+			initPart(part, mPartSysData, mPosAgent,
+					 mSourceObjectp.notNull() ? mSourceObjectp->getRenderRotation() : LLQuaternion::DEFAULT,
+					 mRotation);
 			if (!mSourceObjectp.isNull() && mSourceObjectp->isHUDAttachment())
 			{
 				part->mFlags |= LLPartData::LL_PART_HUD;
 			}
-			part->mMaxAge = mPartSysData.mPartData.mMaxAge;
-			part->mStartColor = mPartSysData.mPartData.mStartColor;
-			part->mEndColor = mPartSysData.mPartData.mEndColor;
-			part->mColor = part->mStartColor;
-
-			part->mStartScale = mPartSysData.mPartData.mStartScale;
-			part->mEndScale = mPartSysData.mPartData.mEndScale;
-			part->mScale = part->mStartScale;
-
-			part->mAccel = mPartSysData.mPartAccel;
-
-			if (mPartSysData.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_DROP)
-			{
-				part->mPosAgent = mPosAgent;
-				part->mVelocity.setVec(0.f, 0.f, 0.f);
-			}
-			else if (mPartSysData.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_EXPLODE)
-			{
-				part->mPosAgent = mPosAgent;
-				LLVector3 part_dir_vector;
-
-				F32 mvs;
-				do
-				{
-					part_dir_vector.mV[VX] = ll_frand(2.f) - 1.f;
-					part_dir_vector.mV[VY] = ll_frand(2.f) - 1.f;
-					part_dir_vector.mV[VZ] = ll_frand(2.f) - 1.f;
-					mvs = part_dir_vector.magVecSquared();
-				}
-				while ((mvs > 1.f) || (mvs < 0.01f));
-
-				part_dir_vector.normVec();
-				part->mPosAgent += mPartSysData.mBurstRadius*part_dir_vector;
-				part->mVelocity = part_dir_vector;
-				F32 speed = mPartSysData.mBurstSpeedMin + ll_frand(mPartSysData.mBurstSpeedMax - mPartSysData.mBurstSpeedMin);
-				part->mVelocity *= speed;
-			}
-			else if (mPartSysData.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_ANGLE
-				|| mPartSysData.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_ANGLE_CONE)
-			{				
-				part->mPosAgent = mPosAgent;
-				
-				// original implemenetation for part_dir_vector was just:					
-				LLVector3 part_dir_vector(0.0, 0.0, 1.0);
-				// params from the script...
-				// outer = outer cone angle
-				// inner = inner cone angle
-				//		between outer and inner there will be particles
-				F32 innerAngle = mPartSysData.mInnerAngle;
-				F32 outerAngle = mPartSysData.mOuterAngle;
-
-				// generate a random angle within the given space...
-				F32 angle = innerAngle + ll_frand(outerAngle - innerAngle);
-				// split which side it will go on randomly...
-				if (ll_frand() < 0.5) 
-				{
-					angle = -angle;
-				}
-				// Both patterns rotate around the x-axis first:
-				part_dir_vector.rotVec(angle, 1.0, 0.0, 0.0);
-
-				// If this is a cone pattern, rotate again to create the cone.
-				if (mPartSysData.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_ANGLE_CONE)
-				{
-					part_dir_vector.rotVec(ll_frand(4*F_PI), 0.0, 0.0, 1.0);
-				}
-								
-				// Only apply this rotation if using the deprecated angles. 
-				if (! (mPartSysData.mFlags & LLPartSysData::LL_PART_USE_NEW_ANGLE))
-				{
-					// Deprecated...
-					part_dir_vector.rotVec(outerAngle, 1.0, 0.0, 0.0);
-				}
-				
-				if (mSourceObjectp)
-				{
-					part_dir_vector = part_dir_vector * mSourceObjectp->getRenderRotation();
-				}
-								
-				part_dir_vector = part_dir_vector * mRotation;
-								
-				part->mPosAgent += mPartSysData.mBurstRadius*part_dir_vector;
-
-				part->mVelocity = part_dir_vector;
-
-				F32 speed = mPartSysData.mBurstSpeedMin + ll_frand(mPartSysData.mBurstSpeedMax - mPartSysData.mBurstSpeedMin);
-				part->mVelocity *= speed;
-			}
-			else
-			{
-				part->mPosAgent = mPosAgent;
-				part->mVelocity.setVec(0.f, 0.f, 0.f);
-				//llwarns << "Unknown source pattern " << (S32)mPartSysData.mPattern << llendl;
-			}
 
 			if (part->mFlags & LLPartData::LL_PART_FOLLOW_SRC_MASK ||	// SVC-193, VWR-717
 				part->mFlags & LLPartData::LL_PART_TARGET_LINEAR_MASK) 
@@ -397,6 +305,104 @@ void LLViewerPartSourceScript::update(const F32 dt)
 	}
 }
 
+// static
+void LLViewerPartSourceScript::initPart(LLViewerPart* part, const LLPartSysData& data, const LLVector3& pos_agent,
+										const LLQuaternion& object_rotation, const LLQuaternion& rotation)
+{
+	part->mFlags = data.mPartData.mFlags;
+	part->mMaxAge = data.mPartData.mMaxAge;
+	part->mStartColor = data.mPartData.mStartColor;
+	part->mEndColor = data.mPartData.mEndColor;
+	part->mColor = part->mStartColor;
+
+	part->mStartScale = data.mPartData.mStartScale;
+	part->mEndScale = data.mPartData.mEndScale;
+	part->mScale = part->mStartScale;
+
+	part->mAccel = data.mPartAccel;
+
+	if (data.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_DROP)
+	{
+		part->mPosAgent = pos_agent;
+		part->mVelocity.setVec(0.f, 0.f, 0.f);
+	}
+	else if (data.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_EXPLODE)
+	{
+		part->mPosAgent = pos_agent;
+		LLVector3 part_dir_vector;
+
+		F32 mvs;
+		do
+		{
+			part_dir_vector.mV[VX] = ll_frand(2.f) - 1.f;
+			part_dir_vector.mV[VY] = ll_frand(2.f) - 1.f;
+			part_dir_vector.mV[VZ] = ll_frand(2.f) - 1.f;
+			mvs = part_dir_vector.magVecSquared();
+		}
+		while ((mvs > 1.f) || (mvs < 0.01f));
+
+		part_dir_vector.normVec();
+		part->mPosAgent += data.mBurstRadius*part_dir_vector;
+		part->mVelocity = part_dir_vector;
+		F32 speed = data.mBurstSpeedMin + ll_frand(data.mBurstSpeedMax - data.mBurstSpeedMin);
+		part->mVelocity *= speed;
+	}
+	else if (data.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_ANGLE
+		|| data.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_ANGLE_CONE)
+	{				
+		part->mPosAgent = pos_agent;
+		
+		// original implemenetation for part_dir_vector was just:					
+		LLVector3 part_dir_vector(0.0, 0.0, 1.0);
+		// params from the script...
+		// outer = outer cone angle
+		// inner = inner cone angle
+		//		between outer and inner there will be particles
+		F32 innerAngle = data.mInnerAngle;
+		F32 outerAngle = data.mOuterAngle;
+
+		// generate a random angle within the given space...
+		F32 angle = innerAngle + ll_frand(outerAngle - innerAngle);
+		// split which side it will go on randomly...
+		if (ll_frand() < 0.5) 
+		{
+			angle = -angle;
+		}
+		// Both patterns rotate around the x-axis first:
+		part_dir_vector.rotVec(angle, 1.0, 0.0, 0.0);
+
+		// If this is a cone pattern, rotate again to create the cone.
+		if (data.mPattern & LLPartSysData::LL_PART_SRC_PATTERN_ANGLE_CONE)
+		{
+			part_dir_vector.rotVec(ll_frand(4*F_PI), 0.0, 0.0, 1.0);
+		}
+						
+		// Only apply this rotation if using the deprecated angles. 
+		if (! (data.mFlags & LLPartSysData::LL_PART_USE_NEW_ANGLE))
+		{
+			// Deprecated...
+			part_dir_vector.rotVec(outerAngle, 1.0, 0.0, 0.0);
+		}
+		
+		part_dir_vector = part_dir_vector * object_rotation;
+						
+		part_dir_vector = part_dir_vector * rotation;
+						
+		part->mPosAgent += data.mBurstRadius*part_dir_vector;
+
+		part->mVelocity = part_dir_vector;
+
+		F32 speed = data.mBurstSpeedMin + ll_frand(data.mBurstSpeedMax - data.mBurstSpeedMin);
+		part->mVelocity *= speed;
+	}
+	else
+	{
+		part->mPosAgent = pos_agent;
+		part->mVelocity.setVec(0.f, 0.f, 0.f);
+		//llwarns << "Unknown source pattern " << (S32)data.mPattern << llendl;
+	}
+}
+
 // static
 LLPointer<LLViewerPartSourceScript> LLViewerPartSourceScript::unpackPSS(LLViewerObject *source_objp, LLPointer<LLViewerPartSourceScript> pssp, const S32 block_num)
 {
@@ -440,16 +446,13 @@ LLPointer<LLViewerPartSourceScript> LLViewerPartSourceScript::unpackPSS(LLViewer
 }
 
 
-LLPointer<LLViewerPartSourceScript> LLViewerPartSourceScript::unpackPSS(LLViewerObject *source_objp, LLPointer<LLViewerPartSourceScript> pssp, LLDataPacker &dp)
+LLPointer<LLViewerPartSourceScript> LLViewerPartSourceScript::unpackPSS(LLViewerObject *source_objp, LLPointer<LLViewerPartSourceScript> pssp, const LLPartSysData& particle_parameters)
 {
 	LLMemType mt(LLMemType::MTYPE_PARTICLES);
 	if (!pssp)
 	{
 		LLPointer<LLViewerPartSourceScript> new_pssp = new LLViewerPartSourceScript(source_objp);
-		if (!new_pssp->mPartSysData.unpack(dp))
-		{
-			return NULL;
-		}
+		new_pssp->mPartSysData = particle_parameters;
 		if (new_pssp->mPartSysData.mTargetUUID.notNull())
 		{
 			LLViewerObject *target_objp = gObjectList.findObject(new_pssp->mPartSysData.mTargetUUID);
@@ -459,10 +462,7 @@ LLPointer<LLViewerPartSourceScript> LLViewerPartSourceScript::unpackPSS(LLViewer
 	}
 	else
 	{
-		if (!pssp->mPartSysData.unpack(dp))
-		{
-			return NULL;
-		}
+		pssp->mPartSysData = particle_parameters;
 		if (pssp->mPartSysData.mTargetUUID.notNull())
 		{
 			LLViewerObject *target_objp = gObjectList.findObject(pssp->mPartSysData.mTargetUUID);
@@ -119,9 +119,15 @@ public:
 
 	// Returns a new particle source to attach to an object...
 	static LLPointer<LLViewerPartSourceScript> unpackPSS(LLViewerObject *source_objp, LLPointer<LLViewerPartSourceScript> pssp, const S32 block_num);
-	static LLPointer<LLViewerPartSourceScript> unpackPSS(LLViewerObject *source_objp, LLPointer<LLViewerPartSourceScript> pssp, LLDataPacker &dp);
+	static LLPointer<LLViewerPartSourceScript> unpackPSS(LLViewerObject *source_objp, LLPointer<LLViewerPartSourceScript> pssp, const LLPartSysData& particle_parameters);
 	static LLPointer<LLViewerPartSourceScript> createPSS(LLViewerObject *source_objp, const LLPartSysData& particle_parameters);
 
+	// Sets up a particle of the given system emitted from pos_agent, as
+	// update() does.  The emission direction is turned by object_rotation,
+	// then by rotation.
+	static void initPart(LLViewerPart* part, const LLPartSysData& data, const LLVector3& pos_agent,
+						 const LLQuaternion& object_rotation, const LLQuaternion& rotation);
+
 	LLViewerImage *getImage() const				{ return mImagep; }
 	void setImage(LLViewerImage *imagep);
 	LLPartSysData				mPartSysData;
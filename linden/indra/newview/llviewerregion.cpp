@@ -67,11 +67,6 @@
 #include "llspatialpartition.h"
 #include "llviewerparcelmgr.h"
 
-// Viewer object cache version, change if object update
-// format changes. JC
-const U32 INDRA_OBJECT_CACHE_VERSION = 14;
-
-
 extern BOOL gNoRender;
 
 const F32 WATER_TEXTURE_SCALE = 8.f;			//  Number of times to repeat the water texture across a region
@@ -172,6 +167,9 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
 	mProductSKU("unknown"),
 	mProductName("unknown"),
 	mCacheLoaded(FALSE),
+	mCacheLoadTime(0.f),
+	mCacheFileHits(0),
+	mCacheFileCorrupt(0),
 	mCacheEntriesCount(0),
 	mCacheID(),
 	mEventPoll(NULL),
@@ -281,6 +279,12 @@ LLViewerRegion::~LLViewerRegion()
 }
 
 
+std::string LLViewerRegion::getCacheFilename() const
+{
+	return gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
+		llformat("objects_%d_%d.slc",U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
+}
+
 void LLViewerRegion::loadCache()
 {
 	if (mCacheLoaded)
@@ -291,78 +295,10 @@ void LLViewerRegion::loadCache()
 	// Presume success.  If it fails, we don't want to try again.
 	mCacheLoaded = TRUE;
 
-	LLVOCacheEntry *entry;
-
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc",U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
-
-	LLFILE* fp = LLFile::fopen(filename, "rb");		/* Flawfinder: ignore */
-	if (!fp)
-	{
-		// might not have a file, which is normal
-		return;
-	}
-
-	U32 zero;
-	size_t nread;
-	nread = fread(&zero, sizeof(U32), 1, fp);
-	if (nread != 1 || zero)
-	{
-		// a non-zero value here means bad things!
-		// skip reading the cached values
-		llinfos << "Cache file invalid" << llendl;
-		fclose(fp);
-		return;
-	}
-
-	U32 version;
-	nread = fread(&version, sizeof(U32), 1, fp);
-	if (nread != 1 || version != INDRA_OBJECT_CACHE_VERSION)
-	{
-		// a version mismatch here means we've changed the binary format!
-		// skip reading the cached values
-		llinfos << "Cache version changed, discarding" << llendl;
-		fclose(fp);
-		return;
-	}
-
-	LLUUID cache_id;
-	nread = fread(&cache_id.mData, 1, UUID_BYTES, fp);
-	if (nread != (size_t)UUID_BYTES || mCacheID != cache_id)
-	{
-		llinfos << "Cache ID doesn't match for this region, discarding"
-			<< llendl;
-		fclose(fp);
-		return;
-	}
-
-	S32 num_entries;
-	nread = fread(&num_entries, sizeof(S32), 1, fp);
-	if (nread != 1)
-	{
-		llinfos << "Short read, discarding" << llendl;
-		fclose(fp);
-		return;
-	}
-	
-	S32 i;
-	for (i = 0; i < num_entries; i++)
-	{
-		entry = new LLVOCacheEntry(fp);
-		if (!entry->getLocalID())
-		{
-			llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
-			delete entry;
-			entry = NULL;
-			break;
-		}
-		mCacheEnd.insert(*entry);
-		mCacheMap[entry->getLocalID()] = entry;
-		mCacheEntriesCount++;
-	}
-
-	fclose(fp);
+	// Only the header is validated here, entries are decoded when they are hit.
+	LLTimer load_timer;
+	mCacheFile.open(getCacheFilename(), mCacheID);
+	mCacheLoadTime = load_timer.getElapsedTimeF32();
 }
 
 
@@ -376,50 +312,65 @@ void LLViewerRegion::saveCache()
 	S32 num_entries = mCacheEntriesCount;
 	if (0 == num_entries)
 	{
+		// nothing was hit or changed, the file on disk is still current
+		mCacheFile.close();
 		return;
 	}
 
-	std::string filename;
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,"") + gDirUtilp->getDirDelimiter() +
-		llformat("objects_%d_%d.slc", U32(mHandle>>32)/REGION_WIDTH_UNITS, U32(mHandle)/REGION_WIDTH_UNITS );
-
-	LLFILE* fp = LLFile::fopen(filename, "wb");		/* Flawfinder: ignore */
-	if (!fp)
-	{
-		llwarns << "Unable to write cache file " << filename << llendl;
-		return;
-	}
+	std::vector<LLVOCacheIndexEntry> slots;
+	std::vector<const U8*> data;
+	slots.reserve(MAX_OBJECT_CACHE_ENTRIES);
+	data.reserve(MAX_OBJECT_CACHE_ENTRIES);
 
-	// write out zero to indicate a version cache file
-	U32 zero = 0;
-	if (fwrite(&zero, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
+	LLVOCacheIndexEntry slot;
+	memset(&slot, 0, sizeof(slot));
 
-	// write out version number
-	U32 version = INDRA_OBJECT_CACHE_VERSION;
-	if (fwrite(&version, sizeof(U32), 1, fp) != 1)
-	{
-		llwarns << "Short write" << llendl;
-	}
-
-	// write the cache id for this sim
-	if (fwrite(&mCacheID.mData, 1, UUID_BYTES, fp) != (size_t)UUID_BYTES)
+	LLVOCacheEntry *entry;
+	for (entry = mCacheStart.getNext(); entry && (entry != &mCacheEnd); entry = entry->getNext())
 	{
-		llwarns << "Short write" << llendl;
+		slot.mLocalID = entry->getLocalID();
+		slot.mCRC = entry->getCRC();
+		slot.mSize = entry->getSize();
+		slot.mHitCount = entry->getHitCount();
+		slot.mDupeCount = entry->getDupeCount();
+		slot.mCRCChangeCount = entry->getCRCChangeCount();
+		slots.push_back(slot);
+		data.push_back(entry->getData());
 	}
 
-	if (fwrite(&num_entries, sizeof(S32), 1, fp) != 1)
+	// Carry over entries from the old file that were never touched this session.
+	const LLVOCacheIndexEntry* index = mCacheFile.getIndex();
+	for (U32 i = 0; index && i < mCacheFile.getIndexSize() && slots.size() < MAX_OBJECT_CACHE_ENTRIES; i++)
 	{
-		llwarns << "Short write" << llendl;
+		if (!index[i].mLocalID || mCacheMap.count(index[i].mLocalID))
+		{
+			continue;
+		}
+		const U8* slot_data = mCacheFile.getSlotData(&index[i]);
+		if (slot_data)
+		{
+			slots.push_back(index[i]);
+			data.push_back(slot_data);
+		}
 	}
 
-	LLVOCacheEntry *entry;
+	// The old file is still mapped, so write next to it and rename it over
+	// the old one afterwards. rename() replaces the old file in one step on
+	// POSIX; Windows refuses to rename over an existing file, so there the old
+	// one is removed first and a crash in between loses the cache.
+	std::string filename = getCacheFilename();
+	std::string temp_filename = filename + ".tmp";
+	BOOL written = LLVOCacheFile::write(temp_filename, mCacheID, slots, data);
 
-	for (entry = mCacheStart.getNext(); entry && (entry != &mCacheEnd); entry = entry->getNext())
+	mCacheFile.close();
+	if (written && LLFile::rename(temp_filename, filename))
 	{
-		entry->writeToFile(fp);
+		LLFile::remove(filename);
+		if (LLFile::rename(temp_filename, filename))
+		{
+			llwarns << "Unable to write cache file " << filename << llendl;
+			LLFile::remove(temp_filename);
+		}
 	}
 
 	mCacheMap.clear();
@@ -427,8 +378,30 @@ void LLViewerRegion::saveCache()
 	mCacheEnd.init();
 	mCacheStart.deleteAll();
 	mCacheStart.init();
+	mCacheEntriesCount = 0;
+}
 
-	fclose(fp);
+LLVOCacheEntry* LLViewerRegion::decodeCacheEntry(const LLVOCacheIndexEntry* slot)
+{
+	LLVOCacheEntry* entry = mCacheFile.decode(slot);
+	if (!entry)
+	{
+		mCacheFileCorrupt++;
+		return NULL;
+	}
+	mCacheFileHits++;
+
+	if (mCacheEntriesCount > MAX_OBJECT_CACHE_ENTRIES)
+	{
+		LLVOCacheEntry* oldest = mCacheStart.getNext();
+		mCacheMap.erase(oldest->getLocalID());
+		delete oldest;
+		mCacheEntriesCount--;
+	}
+	mCacheEnd.insert(*entry);
+	mCacheMap[entry->getLocalID()] = entry;
+	mCacheEntriesCount++;
+	return entry;
 }
 
 void LLViewerRegion::sendMessage()
@@ -1098,6 +1071,16 @@ void LLViewerRegion::cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinary
 
 	LLVOCacheEntry* entry = get_if_there(mCacheMap, local_id, (LLVOCacheEntry*)NULL);
 
+	if (!entry)
+	{
+		const LLVOCacheIndexEntry* slot = mCacheFile.find(local_id);
+		if (slot && slot->mCRC == crc)
+		{
+			// the cache file already has this version of the object
+			return ;
+		}
+	}
+
 	if (entry)
 	{
 		// we've seen this object before
@@ -1145,6 +1128,26 @@ LLDataPacker *LLViewerRegion::getDP(U32 local_id, U32 crc)
 
 	LLVOCacheEntry* entry = get_if_there(mCacheMap, local_id, (LLVOCacheEntry*)NULL);
 
+	if (!entry)
+	{
+		const LLVOCacheIndexEntry* slot = mCacheFile.find(local_id);
+		if (slot)
+		{
+			if (slot->mCRC != crc)
+			{
+				// don't bother decoding a stale entry
+				mCacheMissCRC.put(local_id);
+				return NULL;
+			}
+			entry = decodeCacheEntry(slot);
+			if (!entry)
+			{
+				mCacheMissFull.put(local_id);
+				return NULL;
+			}
+		}
+	}
+
 	if (entry)
 	{
 		// we've seen this object before
@@ -1278,6 +1281,47 @@ void LLViewerRegion::dumpCache()
 	}
 
 	llinfos << "Count " << mCacheEntriesCount << llendl;
+	llinfos << "File entries " << mCacheFile.getNumEntries()
+			<< " index " << mCacheFile.getIndexSize()
+			<< " load " << mCacheLoadTime * 1000.f << " ms"
+			<< " hits " << mCacheFileHits
+			<< " corrupt " << mCacheFileCorrupt << llendl;
+
+	// Probe and checksum every file entry to measure hit cost.
+	const LLVOCacheIndexEntry* index = mCacheFile.getIndex();
+	if (index)
+	{
+		S32 probes = 0;
+		S32 found = 0;
+		LLTimer probe_timer;
+		for (U32 j = 0; j < mCacheFile.getIndexSize(); j++)
+		{
+			if (index[j].mLocalID)
+			{
+				probes++;
+				found += (mCacheFile.find(index[j].mLocalID) != NULL);
+			}
+		}
+		F32 probe_time = probe_timer.getElapsedTimeF32();
+
+		probe_timer.reset();
+		for (U32 j = 0; j < mCacheFile.getIndexSize(); j++)
+		{
+			if (index[j].mLocalID)
+			{
+				delete mCacheFile.decode(&index[j]);
+			}
+		}
+		F32 decode_time = probe_timer.getElapsedTimeF32();
+
+		if (probes)
+		{
+			llinfos << "Probe " << found << "/" << probes
+					<< " " << probe_time * 1000000.f / probes << " us/probe"
+					<< " decode " << decode_time * 1000000.f / probes << " us/hit" << llendl;
+		}
+	}
+
 	for (i = 0; i < BINS; i++)
 	{
 		llinfos << "Hits " << i << " " << hit_bin[i] << llendl;
@@ -379,12 +379,21 @@ private:
 	std::string mProductName;
 	
 	
+	std::string getCacheFilename() const;
+	// Decodes a cache file entry into mCacheMap, NULL if it is corrupt.
+	LLVOCacheEntry* decodeCacheEntry(const LLVOCacheIndexEntry* slot);
+
 	// Maps local ids to cache entries.
 	// Regions can have order 10,000 objects, so assume
 	// a structure of size 2^14 = 16,000
 	BOOL									mCacheLoaded;
 	typedef std::map<U32, LLVOCacheEntry *>	cache_map_t;
 	cache_map_t			  				 	mCacheMap;
+	// Entries loaded from disk stay in the mapped file until they are hit.
+	LLVOCacheFile							mCacheFile;
+	F32										mCacheLoadTime;
+	U32										mCacheFileHits;
+	U32										mCacheFileCorrupt;
 	LLVOCacheEntry							mCacheStart;
 	LLVOCacheEntry							mCacheEnd;
 	U32										mCacheEntriesCount;
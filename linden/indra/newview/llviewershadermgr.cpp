@@ -77,6 +77,14 @@ LLGLSLShader		gObjectFullbrightShinyProgram;
 LLGLSLShader		gObjectShinyProgram;
 LLGLSLShader		gObjectShinyWaterProgram;
 
+LLGLSLShader		gParticleProgram;
+LLGLSLShader		gParticleWaterProgram;
+LLGLSLShader		gParticleFullbrightProgram;
+LLGLSLShader		gParticleFullbrightWaterProgram;
+
+LLGLSLShader		gTreeInstanceProgram;
+LLGLSLShader		gTreeInstanceWaterProgram;
+
 //environment shaders
 LLGLSLShader		gTerrainProgram;
 LLGLSLShader		gTerrainWaterProgram;
@@ -143,6 +151,12 @@ LLViewerShaderMgr::LLViewerShaderMgr() :
 	mShaderList.push_back(&gObjectFullbrightWaterProgram);
 	mShaderList.push_back(&gAvatarWaterProgram);
 	mShaderList.push_back(&gObjectShinyWaterProgram);
+	mShaderList.push_back(&gParticleProgram);
+	mShaderList.push_back(&gParticleWaterProgram);
+	mShaderList.push_back(&gParticleFullbrightProgram);
+	mShaderList.push_back(&gParticleFullbrightWaterProgram);
+	mShaderList.push_back(&gTreeInstanceProgram);
+	mShaderList.push_back(&gTreeInstanceWaterProgram);
 	mShaderList.push_back(&gUnderWaterProgram);
 	mShaderList.push_back(&gDeferredSunProgram);
 	mShaderList.push_back(&gDeferredBlurLightProgram);
@@ -189,6 +203,18 @@ void LLViewerShaderMgr::initAttribsAndUniforms(void)
 
 		mAvatarUniforms.push_back("matrixPalette");
 
+		mParticleAttribs.push_back("part_center");
+		mParticleAttribs.push_back("part_velocity");
+		mParticleAttribs.push_back("part_scale");
+		mParticleAttribs.push_back("part_color");
+
+		mParticleUniforms.push_back("part_camera");
+
+		mTreeInstanceAttribs.push_back("tree_row0");
+		mTreeInstanceAttribs.push_back("tree_row1");
+		mTreeInstanceAttribs.push_back("tree_row2");
+		mTreeInstanceAttribs.push_back("tree_tex_offset");
+
 		mReservedUniforms.reserve(24);
 		mReservedUniforms.push_back("diffuseMap");
 		mReservedUniforms.push_back("specularMap");
@@ -477,6 +503,12 @@ void LLViewerShaderMgr::unloadShaders()
 	gObjectShinyProgram.unload();
 	gObjectFullbrightShinyProgram.unload();
 	gObjectShinyWaterProgram.unload();
+	gParticleProgram.unload();
+	gParticleWaterProgram.unload();
+	gParticleFullbrightProgram.unload();
+	gParticleFullbrightWaterProgram.unload();
+	gTreeInstanceProgram.unload();
+	gTreeInstanceWaterProgram.unload();
 	gWaterProgram.unload();
 	gUnderWaterProgram.unload();
 	gTerrainProgram.unload();
@@ -1038,6 +1070,12 @@ BOOL LLViewerShaderMgr::loadShadersObject()
 		gObjectSimpleWaterProgram.unload();
 		gObjectFullbrightProgram.unload();
 		gObjectFullbrightWaterProgram.unload();
+		gParticleProgram.unload();
+		gParticleWaterProgram.unload();
+		gParticleFullbrightProgram.unload();
+		gParticleFullbrightWaterProgram.unload();
+		gTreeInstanceProgram.unload();
+		gTreeInstanceWaterProgram.unload();
 		return FALSE;
 	}
 
@@ -1153,10 +1191,176 @@ BOOL LLViewerShaderMgr::loadShadersObject()
 		mVertexShaderLevel[SHADER_OBJECT] = 0;
 		return FALSE;
 	}
+
+	loadShadersParticle();
+	loadShadersTreeInstance();
 	
 	return TRUE;
 }
 
+void LLViewerShaderMgr::loadShadersParticle()
+{
+	// Particles are expanded on the CPU without these, so failing to load
+	// them leaves the other object shaders alone.
+	BOOL success = gGLManager.mHasInstancedArrays;
+
+	if (success)
+	{
+		gParticleProgram.mName = "Particle Shader";
+		gParticleProgram.mFeatures.calculatesLighting = true;
+		gParticleProgram.mFeatures.calculatesAtmospherics = true;
+		gParticleProgram.mFeatures.hasGamma = true;
+		gParticleProgram.mFeatures.hasAtmospherics = true;
+		gParticleProgram.mFeatures.hasLighting = true;
+		gParticleProgram.mShaderFiles.clear();
+		gParticleProgram.mShaderFiles.push_back(make_pair("objects/particleV.glsl", GL_VERTEX_SHADER_ARB));
+		gParticleProgram.mShaderFiles.push_back(make_pair("objects/particleQuadV.glsl", GL_VERTEX_SHADER_ARB));
+		gParticleProgram.mShaderFiles.push_back(make_pair("objects/simpleF.glsl", GL_FRAGMENT_SHADER_ARB));
+		gParticleProgram.mShaderLevel = mVertexShaderLevel[SHADER_OBJECT];
+		success = gParticleProgram.createShader(&mParticleAttribs, &mParticleUniforms);
+	}
+
+	if (success)
+	{
+		gParticleWaterProgram.mName = "Particle Water Shader";
+		gParticleWaterProgram.mFeatures.calculatesLighting = true;
+		gParticleWaterProgram.mFeatures.calculatesAtmospherics = true;
+		gParticleWaterProgram.mFeatures.hasWaterFog = true;
+		gParticleWaterProgram.mFeatures.hasAtmospherics = true;
+		gParticleWaterProgram.mFeatures.hasLighting = true;
+		gParticleWaterProgram.mShaderFiles.clear();
+		gParticleWaterProgram.mShaderFiles.push_back(make_pair("objects/particleV.glsl", GL_VERTEX_SHADER_ARB));
+		gParticleWaterProgram.mShaderFiles.push_back(make_pair("objects/particleQuadV.glsl", GL_VERTEX_SHADER_ARB));
+		gParticleWaterProgram.mShaderFiles.push_back(make_pair("objects/simpleWaterF.glsl", GL_FRAGMENT_SHADER_ARB));
+		gParticleWaterProgram.mShaderLevel = mVertexShaderLevel[SHADER_OBJECT];
+		gParticleWaterProgram.mShaderGroup = LLGLSLShader::SG_WATER;
+		success = gParticleWaterProgram.createShader(&mParticleAttribs, &mParticleUniforms);
+	}
+
+	if (success)
+	{
+		gParticleFullbrightProgram.mName = "Particle Fullbright Shader";
+		gParticleFullbrightProgram.mFeatures.calculatesAtmospherics = true;
+		gParticleFullbrightProgram.mFeatures.hasGamma = true;
+		gParticleFullbrightProgram.mFeatures.hasTransport = true;
+		gParticleFullbrightProgram.mFeatures.isFullbright = true;
+		gParticleFullbrightProgram.mShaderFiles.clear();
+		gParticleFullbrightProgram.mShaderFiles.push_back(make_pair("objects/particleFullbrightV.glsl", GL_VERTEX_SHADER_ARB));
+		gParticleFullbrightProgram.mShaderFiles.push_back(make_pair("objects/particleQuadV.glsl", GL_VERTEX_SHADER_ARB));
+		gParticleFullbrightProgram.mShaderFiles.push_back(make_pair("objects/fullbrightF.glsl", GL_FRAGMENT_SHADER_ARB));
+		gParticleFullbrightProgram.mShaderLevel = mVertexShaderLevel[SHADER_OBJECT];
+		success = gParticleFullbrightProgram.createShader(&mParticleAttribs, &mParticleUniforms);
+	}
+
+	if (success)
+	{
+		gParticleFullbrightWaterProgram.mName = "Particle Fullbright Water Shader";
+		gParticleFullbrightWaterProgram.mFeatures.calculatesAtmospherics = true;
+		gParticleFullbrightWaterProgram.mFeatures.isFullbright = true;
+		gParticleFullbrightWaterProgram.mFeatures.hasWaterFog = true;
+		gParticleFullbrightWaterProgram.mFeatures.hasTransport = true;
+		gParticleFullbrightWaterProgram.mShaderFiles.clear();
+		gParticleFullbrightWaterProgram.mShaderFiles.push_back(make_pair("objects/particleFullbrightV.glsl", GL_VERTEX_SHADER_ARB));
+		gParticleFullbrightWaterProgram.mShaderFiles.push_back(make_pair("objects/particleQuadV.glsl", GL_VERTEX_SHADER_ARB));
+		gParticleFullbrightWaterProgram.mShaderFiles.push_back(make_pair("objects/fullbrightWaterF.glsl", GL_FRAGMENT_SHADER_ARB));
+		gParticleFullbrightWaterProgram.mShaderLevel = mVertexShaderLevel[SHADER_OBJECT];
+		gParticleFullbrightWaterProgram.mShaderGroup = LLGLSLShader::SG_WATER;
+		success = gParticleFullbrightWaterProgram.createShader(&mParticleAttribs, &mParticleUniforms);
+	}
+
+	if (success)
+	{
+		// Every record attribute has to be active, and off location 0 since
+		// that one aliases gl_Vertex, which carries the quad corners.
+		LLGLSLShader* programs[] = { &gParticleProgram, &gParticleWaterProgram,
+									 &gParticleFullbrightProgram, &gParticleFullbrightWaterProgram };
+		for (S32 i = 0; success && i < (S32) LL_ARRAY_SIZE(programs); i++)
+		{
+			for (S32 attrib = PARTICLE_CENTER; attrib <= PARTICLE_COLOR; attrib++)
+			{
+				if (programs[i]->mAttribute[attrib] <= 0)
+				{
+					llwarns << programs[i]->mName << " is missing particle attribute "
+							<< mParticleAttribs[attrib - END_RESERVED_ATTRIBS] << llendl;
+					success = FALSE;
+					break;
+				}
+			}
+		}
+	}
+
+	if (!success)
+	{
+		gParticleProgram.unload();
+		gParticleWaterProgram.unload();
+		gParticleFullbrightProgram.unload();
+		gParticleFullbrightWaterProgram.unload();
+	}
+}
+
+void LLViewerShaderMgr::loadShadersTreeInstance()
+{
+	// Trees are drawn a branch at a time without these
+	BOOL success = gGLManager.mHasInstancedArrays;
+
+	if (success)
+	{
+		gTreeInstanceProgram.mName = "Tree Instance Shader";
+		gTreeInstanceProgram.mFeatures.calculatesLighting = true;
+		gTreeInstanceProgram.mFeatures.calculatesAtmospherics = true;
+		gTreeInstanceProgram.mFeatures.hasGamma = true;
+		gTreeInstanceProgram.mFeatures.hasAtmospherics = true;
+		gTreeInstanceProgram.mFeatures.hasLighting = true;
+		gTreeInstanceProgram.mShaderFiles.clear();
+		gTreeInstanceProgram.mShaderFiles.push_back(make_pair("objects/treeInstanceV.glsl", GL_VERTEX_SHADER_ARB));
+		gTreeInstanceProgram.mShaderFiles.push_back(make_pair("objects/simpleF.glsl", GL_FRAGMENT_SHADER_ARB));
+		gTreeInstanceProgram.mShaderLevel = mVertexShaderLevel[SHADER_OBJECT];
+		success = gTreeInstanceProgram.createShader(&mTreeInstanceAttribs, NULL);
+	}
+
+	if (success)
+	{
+		gTreeInstanceWaterProgram.mName = "Tree Instance Water Shader";
+		gTreeInstanceWaterProgram.mFeatures.calculatesLighting = true;
+		gTreeInstanceWaterProgram.mFeatures.calculatesAtmospherics = true;
+		gTreeInstanceWaterProgram.mFeatures.hasWaterFog = true;
+		gTreeInstanceWaterProgram.mFeatures.hasAtmospherics = true;
+		gTreeInstanceWaterProgram.mFeatures.hasLighting = true;
+		gTreeInstanceWaterProgram.mShaderFiles.clear();
+		gTreeInstanceWaterProgram.mShaderFiles.push_back(make_pair("objects/treeInstanceV.glsl", GL_VERTEX_SHADER_ARB));
+		gTreeInstanceWaterProgram.mShaderFiles.push_back(make_pair("objects/simpleWaterF.glsl", GL_FRAGMENT_SHADER_ARB));
+		gTreeInstanceWaterProgram.mShaderLevel = mVertexShaderLevel[SHADER_OBJECT];
+		gTreeInstanceWaterProgram.mShaderGroup = LLGLSLShader::SG_WATER;
+		success = gTreeInstanceWaterProgram.createShader(&mTreeInstanceAttribs, NULL);
+	}
+
+	if (success)
+	{
+		// Same as the particle records, the instance attributes have to be
+		// active and off location 0, gl_Vertex is the species mesh.
+		LLGLSLShader* programs[] = { &gTreeInstanceProgram, &gTreeInstanceWaterProgram };
+		for (S32 i = 0; success && i < (S32) LL_ARRAY_SIZE(programs); i++)
+		{
+			for (S32 attrib = TREE_ROW0; attrib <= TREE_TEX_OFFSET; attrib++)
+			{
+				if (programs[i]->mAttribute[attrib] <= 0)
+				{
+					llwarns << programs[i]->mName << " is missing tree attribute "
+							<< mTreeInstanceAttribs[attrib - END_RESERVED_ATTRIBS] << llendl;
+					success = FALSE;
+					break;
+				}
+			}
+		}
+	}
+
+	if (!success)
+	{
+		gTreeInstanceProgram.unload();
+		gTreeInstanceWaterProgram.unload();
+	}
+}
+
 BOOL LLViewerShaderMgr::loadShadersAvatar()
 {
 	BOOL success = TRUE;
@@ -58,6 +58,8 @@ public:
 	BOOL loadShadersEnvironment();
 	BOOL loadShadersWater();
 	BOOL loadShadersInterface();
+	void loadShadersParticle();
+	void loadShadersTreeInstance();
 	BOOL loadShadersWindLight();
 
 	std::vector<S32> mVertexShaderLevel;
@@ -182,6 +184,27 @@ public:
 		AVATAR_MATRIX = END_RESERVED_UNIFORMS
 	} eAvatarUniforms;
 
+	typedef enum
+	{
+		PARTICLE_CENTER = END_RESERVED_ATTRIBS,
+		PARTICLE_VELOCITY,
+		PARTICLE_SCALE,
+		PARTICLE_COLOR
+	} eParticleAttribs;
+
+	typedef enum
+	{
+		PARTICLE_CAMERA = END_RESERVED_UNIFORMS
+	} eParticleUniforms;
+
+	typedef enum
+	{
+		TREE_ROW0 = END_RESERVED_ATTRIBS,
+		TREE_ROW1,
+		TREE_ROW2,
+		TREE_TEX_OFFSET
+	} eTreeInstanceAttribs;
+
 	// simple model of forward iterator
 	// http://www.sgi.com/tech/stl/ForwardIterator.html
 	class shader_iter
@@ -262,6 +285,14 @@ private:
 
 	std::vector<std::string> mAvatarUniforms;
 
+	//instanced particle parameter tables
+	std::vector<std::string> mParticleAttribs;
+
+	std::vector<std::string> mParticleUniforms;
+
+	//instanced tree parameter table
+	std::vector<std::string> mTreeInstanceAttribs;
+
 	// the list of shaders we need to propagate parameters to.
 	std::vector<LLGLSLShader *> mShaderList;
 
@@ -292,6 +323,13 @@ extern LLGLSLShader			gObjectFullbrightShinyProgram;
 extern LLGLSLShader			gObjectShinyProgram;
 extern LLGLSLShader			gObjectShinyWaterProgram;
 
+extern LLGLSLShader			gParticleProgram;
+extern LLGLSLShader			gParticleWaterProgram;
+extern LLGLSLShader			gParticleFullbrightProgram;
+extern LLGLSLShader			gParticleFullbrightWaterProgram;
+extern LLGLSLShader			gTreeInstanceProgram;
+extern LLGLSLShader			gTreeInstanceWaterProgram;
+
 //environment shaders
 extern LLGLSLShader			gTerrainProgram;
 extern LLGLSLShader			gTerrainWaterProgram;
@@ -58,6 +58,7 @@
 #include "indra_constants.h"
 #include "llassetstorage.h"
 #include "llfontgl.h"
+#include "llfontlayoutcache.h"
 #include "llmousehandler.h"
 #include "llrect.h"
 #include "llsky.h"
@@ -426,6 +427,15 @@ public:
 			addText(xpos, ypos, llformat("%d Vertex Buffers", LLVertexBuffer::sGLCount));
 			ypos += y_inc;
 
+			if (LLVertexBufferPool::sBufferCount > 0)
+			{
+				addText(xpos, ypos, llformat("%d Pooled Vertex Buffers in %d (%d%% used, %d KB moved)",
+					LLVertexBufferPool::sRangeCount, LLVertexBufferPool::sBufferCount,
+					(S32) (100.f * LLVertexBufferPool::sUsedBytes / LLVertexBufferPool::sBufferBytes),
+					LLVertexBufferPool::sMovedBytes / 1024));
+				ypos += y_inc;
+			}
+
 			addText(xpos, ypos, llformat("%d Mapped Buffers", LLVertexBuffer::sMappedCount));
 			ypos += y_inc;
 
@@ -1317,6 +1327,8 @@ LLViewerWindow::LLViewerWindow(
 		gSavedSettings.setBOOL("RenderVBOEnable", FALSE);
 	}
 	LLVertexBuffer::initClass(gSavedSettings.getBOOL("RenderVBOEnable") && gGLManager.mHasVertexBufferObject);
+	LLVertexBuffer::sUsePool = gSavedSettings.getBOOL("RenderVBOPool");
+	LLFontLayoutCache::sEnabled = gSavedSettings.getBOOL("FontLayoutCache");
 
 	if (LLFeatureManager::getInstance()->isSafe()
 		|| (gSavedSettings.getS32("LastFeatureVersion") != LLFeatureManager::getInstance()->getVersion())
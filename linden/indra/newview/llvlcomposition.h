@@ -46,11 +46,13 @@ public:
 
 	void setSurface(LLSurface *surfacep);
 
-	// Viewer side hack to generate composition values
-	BOOL generateHeights(const F32 x, const F32 y, const F32 width, const F32 height);
+	// Returns TRUE once the detail textures are loaded far enough to blend.
+	// Composition values and textures are generated by LLTerrainTextureJob.
 	BOOL generateComposition();
-	// Generate texture from composition values.
-	BOOL generateTexture(const F32 x, const F32 y, const F32 width, const F32 height);		
+	// BASE_SIZE square RGB images of the detail textures, for blending
+	BOOL getDetailRawImages(LLPointer<LLImageRaw>* images);
+	// Once the detail textures have been blended
+	void unboostDetailTextures();
 
 	// Use these as indeces ito the get/setters below that use 'corner'
 	enum ECorner
@@ -73,6 +75,7 @@ public:
 
 	friend class LLVOSurfacePatch;
 	friend class LLDrawPoolTerrain;
+	friend class LLPatchTextureJob;
 	void setParamsReady()		{ mParamsReady = TRUE; }
 	BOOL getParamsReady() const	{ return mParamsReady; }
 protected:
@@ -36,6 +36,8 @@
 
 #include <stdio.h>
 #include <ctype.h>
+#include <algorithm>
+#include <functional>
 
 #include "llaudioengine.h"
 #include "llavatarnamecache.h"
@@ -52,6 +54,7 @@
 #include "llheadrotmotion.h"
 #include "llhudeffecttrail.h"
 #include "llhudmanager.h"
+#include "llimpostoratlas.h"
 #include "llinventoryview.h"
 #include "llkeyframefallmotion.h"
 #include "llkeyframestandmotion.h"
@@ -63,6 +66,7 @@
 #include "llresmgr.h"
 #include "llselectmgr.h"
 #include "llsprite.h"
+#include "llthreadpool.h"
 #include "lltargetingmotion.h"
 #include "lltexlayer.h"
 #include "lltoolgrab.h"	// for needsRenderBeam
@@ -710,6 +714,18 @@ BOOL LLVOAvatar::sVisibleInFirstPerson = FALSE;
 F32 LLVOAvatar::sLODFactor = 1.f;
 BOOL LLVOAvatar::sUseImpostors = FALSE;
 BOOL LLVOAvatar::sJointDebug = FALSE;
+BOOL LLVOAvatar::sAnimationStageOpen = FALSE;
+BOOL LLVOAvatar::sAnimationStageRunning = FALSE;
+std::vector<LLPointer<LLVOAvatar> > LLVOAvatar::sAnimationStageQueue;
+S32 LLVOAvatar::sAnimationLODCounts[LLCharacter::ANIMATION_LOD_COUNT];
+F32 LLVOAvatar::sAnimationTime = 0.f;
+F32 LLVOAvatar::sAnimationTimeSaved = 0.f;
+F32 LLVOAvatar::sAnimationLODBias = 0.f;
+S32 LLVOAvatar::sAnimationLODFrameCounts[LLCharacter::ANIMATION_LOD_COUNT];
+S32 LLVOAvatar::sAnimationFrameBlends = 0;
+U64 LLVOAvatar::sAnimationFrameTime = 0;
+F32 LLVOAvatar::sAnimationBlendCost = 0.f;
+F32 LLVOAvatar::sAnimationTimeAverage = 0.f;
 
 EmeraldGlobalBoobConfig LLVOAvatar::sBoobConfig;
 
@@ -767,6 +783,8 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 	mTexEyeColor( NULL ),
 	mNeedsSkin(FALSE),
 	mUpdatePeriod(1),
+	mAnimationStaged(FALSE),
+	mVisualParamsDeferred(FALSE),
 //	mFullyLoadedInitialized(FALSE)
 	mPreviousFullyLoaded(FALSE),
 	mVisibleChat( FALSE ),
@@ -838,6 +856,7 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 	}
 
 	mNeedsImpostorUpdate = TRUE;
+	mImpostorUpdateTime = 0.0;
 	mNeedsAnimUpdate = TRUE;
 
 	mImpostorDistance = 0;
@@ -1053,6 +1072,8 @@ LLVOAvatar::~LLVOAvatar()
 	delete [] mCollisionVolumes;
 	mCollisionVolumes = NULL;
 
+	LLImpostorAtlas::getInstance()->free(mImpostorSlot);
+
 
 	mNumJoints = 0;
 
@@ -1294,8 +1315,10 @@ void LLVOAvatar::resetImpostors()
 		iter != LLCharacter::sInstances.end(); ++iter)
 	{
 		LLVOAvatar* avatar = (LLVOAvatar*) *iter;
-		avatar->mImpostor.release();
+		avatar->mImpostorSlot = LLImpostorSlot();
+		avatar->mNeedsImpostorUpdate = TRUE;
 	}
+	LLImpostorAtlas::getInstance()->release();
 }
 
 // static
@@ -2061,6 +2084,9 @@ void LLVOAvatar::buildCharacter()
 		return;
 	}
 
+	// joints that coarse animation LODs leave alone
+	markAnimationDetailJoints();
+
 	//-------------------------------------------------------------------------
 	// initialize the pelvis
 	//-------------------------------------------------------------------------
@@ -2405,6 +2431,17 @@ void LLVOAvatar::updateMeshData()
 	{
 		stop_glerror();
 
+		// Other avatars with the same shape can use the same morphed meshes.
+		// Ours changes too often while editing appearance to be worth it.
+		static LLCachedControl<BOOL> share_meshes("AvatarShareMeshData", TRUE);
+		if (share_meshes && !mIsSelf)
+		{
+			for (polymesh_map_t::iterator iter = mMeshes.begin(); iter != mMeshes.end(); ++iter)
+			{
+				iter->second->shareVertexData();
+			}
+		}
+
 		S32 f_num = 0 ;
 		const U32 VERTEX_NUMBER_THRESHOLD = 128 ;//small number of this means each part of an avatar has its own vertex buffer.
 		const S32 num_parts = mMeshLOD.size();
@@ -2697,11 +2734,24 @@ BOOL LLVOAvatar::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 	// store off last frame's root position to be consistent with camera position
 	LLVector3 root_pos_last = mRoot.getWorldPosition();
 	bool detailed_update = updateCharacter(agent);
+	if (mAnimationStaged)
+	{
+		// finished by endAnimationStage()
+		mStagedRootPosLast = root_pos_last;
+		return TRUE;
+	}
+
+	idleUpdateFinish(detailed_update, root_pos_last);
+	return TRUE;
+}
+
+void LLVOAvatar::idleUpdateFinish(bool detailed_update, const LLVector3& root_pos_last)
+{
 	bool voice_enabled = gVoiceClient->getVoiceEnabled( mID ) && gVoiceClient->inProximalChannel();
 
 	if (gNoRender)
 	{
-		return TRUE;
+		return;
 	}
 
 	//Zwag: Make sure all composites and bakes are active.
@@ -2725,7 +2775,6 @@ BOOL LLVOAvatar::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 	idleUpdateNameTag( root_pos_last );
 	idleUpdateRenderCost();
 	idleUpdateTractorBeam();
-	return TRUE;
 }
 
 void LLVOAvatar::idleUpdateVoiceVisualizer(bool voice_enabled)
@@ -4250,17 +4299,7 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	// change animation time quanta based on avatar render load
 	if (!mIsSelf && !mIsDummy)
 	{
-		F32 time_quantum = clamp_rescale((F32)sInstances.size(), 10.f, 35.f, 0.f, 0.25f);
-		F32 pixel_area_scale = clamp_rescale(mPixelArea, 100, 5000, 1.f, 0.f);
-		F32 time_step = time_quantum * pixel_area_scale;
-		if (time_step != 0.f)
-		{
-			// disable walk motion servo controller as it doesn't work with motion timesteps
-			stopMotion(ANIM_AGENT_WALK_ADJUST);
-			removeAnimationData("Walk Speed");
-		}
-		mMotionController.setTimeStep(time_step);
-//		llinfos << "Setting timestep to " << time_quantum * pixel_area_scale << llendl;
+		updateAnimationLOD();
 	}
 
 	if (getParent() && !mIsSitting)
@@ -4284,6 +4323,9 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 
 	BOOL throttle = TRUE;
 
+	// no ground plane unless we resolve one below
+	mStageGroundNormal.clearVec();
+
 	if (!(mIsSitting && getParent()))
 	{
 		//--------------------------------------------------------------------
@@ -4325,6 +4367,8 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 		root_pos = gAgent.getPosGlobalFromAgent(getRenderPosition());
 
 		resolveHeightGlobal(root_pos, ground_under_pelvis, normal);
+		mStageGroundPos = gAgent.getPosAgentFromGlobal(ground_under_pelvis);
+		mStageGroundNormal = normal;
 		F32 foot_to_ground = (F32) (root_pos.mdV[VZ] - mPelvisToFoot - ground_under_pelvis.mdV[VZ]);
 		BOOL in_air = ( (!LLWorld::getInstance()->getRegionFromPosGlobal(ground_under_pelvis)) ||
 				foot_to_ground > FOOT_GROUND_COLLISION_TOLERANCE);
@@ -4522,14 +4566,51 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	mSpeed = speed;
 
 	// update animations
+	LLCharacter::e_update_t update_type = LLCharacter::NORMAL_UPDATE;
 	if (mSpecialRenderMode == 1) // Animation Preview
-		updateMotions(LLCharacter::FORCE_UPDATE);
-	else
-		updateMotions(LLCharacter::NORMAL_UPDATE);
+		update_type = LLCharacter::FORCE_UPDATE;
+
+	U64 motion_start = LLTimer::getTotalTime();
+	sAnimationLODFrameCounts[getAnimationLOD()]++;
+	if (!sAnimationStageOpen || !canStageAnimation())
+	{
+		if (updateMotions(update_type))
+		{
+			sAnimationFrameBlends++;
+		}
+	}
+	else if (beginMotionUpdate(update_type))
+	{
+		// blend with the other avatars in endAnimationStage()
+		sAnimationFrameBlends++;
+		sAnimationFrameTime += LLTimer::getTotalTime() - motion_start;
+		mAnimationStaged = TRUE;
+		sAnimationStageQueue.push_back(this);
+		return TRUE;
+	}
+	sAnimationFrameTime += LLTimer::getTotalTime() - motion_start;
+
+	updateCharacterFinish();
+	return TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// updateCharacterFinish()
+// the part of updateCharacter() that follows the motion update
+//-----------------------------------------------------------------------------
+void LLVOAvatar::updateCharacterFinish()
+{
+	if (mVisualParamsDeferred)
+	{
+		mVisualParamsDeferred = FALSE;
+		updateVisualParams();
+	}
 
 	// update head position
 	updateHeadOffset();
 
+	LLVector3 normal;
+
 	//-------------------------------------------------------------------------
 	// Find the ground under each foot, these are used for a variety
 	// of things that follow
@@ -4626,8 +4707,183 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 
 	//mesh vertices need to be reskinned
 	mNeedsSkin = TRUE;
+}
 
-	return TRUE;
+struct CompareAvatarID
+{
+	bool operator()(const LLPointer<LLVOAvatar>& lhs, const LLPointer<LLVOAvatar>& rhs)
+	{
+		return lhs.get()->getID() < rhs.get()->getID();
+	}
+};
+
+//-----------------------------------------------------------------------------
+// beginAnimationStage()
+//-----------------------------------------------------------------------------
+//static
+void LLVOAvatar::beginAnimationStage()
+{
+	static LLCachedControl<BOOL> threaded_animation("ThreadedAnimation", TRUE);
+	llassert(sAnimationStageQueue.empty());
+	sAnimationStageOpen = threaded_animation && LLThreadPool::getInstance();
+}
+
+//-----------------------------------------------------------------------------
+// endAnimationStage()
+//-----------------------------------------------------------------------------
+//static
+void LLVOAvatar::endAnimationStage()
+{
+	static LLCachedControl<BOOL> deterministic("ThreadedAnimationDeterministic", FALSE);
+
+	sAnimationStageOpen = FALSE;
+	if (sAnimationStageQueue.empty())
+	{
+		updateAnimationBudget();
+		return;
+	}
+
+	if (deterministic)
+	{
+		std::sort(sAnimationStageQueue.begin(), sAnimationStageQueue.end(), CompareAvatarID());
+	}
+
+	std::vector<LLCharacter*> characters;
+	characters.reserve(sAnimationStageQueue.size());
+	for (std::vector<LLPointer<LLVOAvatar> >::iterator iter = sAnimationStageQueue.begin();
+		 iter != sAnimationStageQueue.end(); ++iter)
+	{
+		LLVOAvatar* avatarp = *iter;
+		if (!avatarp->isDead())
+		{
+			characters.push_back(avatarp);
+		}
+	}
+
+	{
+		LLFastTimer t(LLFastTimer::FTM_UPDATE_ANIMATION);
+		U64 blend_start = LLTimer::getTotalTime();
+		sAnimationStageRunning = TRUE;
+		LLCharacter::blendMotionsParallel(characters, !deterministic);
+		sAnimationStageRunning = FALSE;
+		sAnimationFrameTime += LLTimer::getTotalTime() - blend_start;
+	}
+
+	for (std::vector<LLPointer<LLVOAvatar> >::iterator iter = sAnimationStageQueue.begin();
+		 iter != sAnimationStageQueue.end(); ++iter)
+	{
+		LLVOAvatar* avatarp = *iter;
+		avatarp->mAnimationStaged = FALSE;
+		if (avatarp->isDead())
+		{
+			continue;
+		}
+		LLFastTimer t(LLFastTimer::FTM_AVATAR_UPDATE);
+		avatarp->endMotionUpdate();
+		avatarp->updateCharacterFinish();
+		avatarp->idleUpdateFinish(true, avatarp->mStagedRootPosLast);
+	}
+	sAnimationStageQueue.clear();
+
+	updateAnimationBudget();
+}
+
+// Screen area below which an avatar drops to the next animation LOD, before
+// the budget bias: roughly 100x100, 50x50 and 20x25 pixels.
+static const F32 ANIMATION_LOD_AREA[LLCharacter::ANIMATION_LOD_COUNT - 1] = { 10000.f, 2500.f, 500.f };
+// Seconds between blends at each LOD, interpolated in between. The existing
+// time quantum does the decimation, so the rate holds when the frame rate
+// changes: 0.05 is every other frame at 40 fps, every third at 60.
+static const F32 ANIMATION_LOD_TIME_STEP[LLCharacter::ANIMATION_LOD_COUNT] = { 0.f, 0.05f, 0.1f, 0.2f };
+
+//-----------------------------------------------------------------------------
+// updateAnimationLOD()
+//-----------------------------------------------------------------------------
+void LLVOAvatar::updateAnimationLOD()
+{
+	static LLCachedControl<BOOL> animation_lod("AnimationLOD", TRUE);
+
+	F32 time_step;
+	if (animation_lod)
+	{
+		// each step of bias quarters the area, so the smallest avatars are
+		// the first to drop a level when the budget runs out
+		F32 area = mPixelArea / powf(4.f, sAnimationLODBias);
+		S32 current = getAnimationLOD();
+		S32 lod = ANIMATION_LOD_FULL;
+		while (lod < ANIMATION_LOD_COUNT - 1)
+		{
+			// some hysteresis, so avatars near a boundary do not flip each frame
+			F32 threshold = ANIMATION_LOD_AREA[lod] * (lod < current ? 1.25f : 1.f);
+			if (area >= threshold)
+			{
+				break;
+			}
+			lod++;
+		}
+		setAnimationLOD((EAnimationLOD)lod);
+		time_step = ANIMATION_LOD_TIME_STEP[lod];
+	}
+	else
+	{
+		setAnimationLOD(ANIMATION_LOD_FULL);
+		F32 time_quantum = clamp_rescale((F32)sInstances.size(), 10.f, 35.f, 0.f, 0.25f);
+		F32 pixel_area_scale = clamp_rescale(mPixelArea, 100, 5000, 1.f, 0.f);
+		time_step = time_quantum * pixel_area_scale;
+	}
+
+	if (time_step != 0.f)
+	{
+		// disable walk motion servo controller as it doesn't work with motion timesteps
+		stopMotion(ANIM_AGENT_WALK_ADJUST);
+		removeAnimationData("Walk Speed");
+	}
+	if (time_step != mMotionController.getTimeStep())
+	{
+		mMotionController.setTimeStep(time_step);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// updateAnimationBudget()
+//-----------------------------------------------------------------------------
+//static
+void LLVOAvatar::updateAnimationBudget()
+{
+	F32 frame_time = (F32)sAnimationFrameTime / 1000.f;
+
+	S32 animated = 0;
+	for (S32 i = 0; i < ANIMATION_LOD_COUNT; i++)
+	{
+		sAnimationLODCounts[i] = sAnimationLODFrameCounts[i];
+		animated += sAnimationLODFrameCounts[i];
+		sAnimationLODFrameCounts[i] = 0;
+	}
+
+	if (sAnimationFrameBlends > 0)
+	{
+		sAnimationBlendCost = lerp(sAnimationBlendCost, frame_time / sAnimationFrameBlends, 0.05f);
+	}
+	sAnimationTime = frame_time;
+	// Only counts the blends skipped between time steps; the joints and
+	// constraints left out of the blends that do run save a little more.
+	sAnimationTimeSaved = llmax(0, animated - sAnimationFrameBlends) * sAnimationBlendCost;
+
+	// Decimated avatars cost nothing for a few frames and then all at once,
+	// so steer on the running average. Back off slowly to avoid see-sawing.
+	sAnimationTimeAverage = lerp(sAnimationTimeAverage, frame_time, 0.1f);
+	F32 budget = gSavedSettings.getF32("AnimationLODBudget");
+	if (budget > 0.f && sAnimationTimeAverage > budget)
+	{
+		sAnimationLODBias = llmin(sAnimationLODBias + 0.05f, (F32)(ANIMATION_LOD_COUNT - 1));
+	}
+	else if (budget <= 0.f || sAnimationTimeAverage < budget * 0.5f)
+	{
+		sAnimationLODBias = llmax(sAnimationLODBias - 0.01f, 0.f);
+	}
+
+	sAnimationFrameBlends = 0;
+	sAnimationFrameTime = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -5129,7 +5385,7 @@ U32 LLVOAvatar::renderFootShadows()
 
 U32 LLVOAvatar::renderImpostor(LLColor4U color)
 {
-	if (!mImpostor.isComplete())
+	if (mImpostorSlot.isNull())
 	{
 		return 0;
 	}
@@ -5143,22 +5399,9 @@ U32 LLVOAvatar::renderImpostor(LLColor4U color)
 	left *= mImpostorDim.mV[0];
 	up *= mImpostorDim.mV[1];
 
-	LLGLEnable test(GL_ALPHA_TEST);
-	gGL.setAlphaRejectSettings(LLRender::CF_GREATER, 0.f);
-
-	gGL.color4ubv(color.mV);
-	gGL.getTexUnit(0)->bind(&mImpostor);
-	gGL.begin(LLRender::QUADS);
-	gGL.texCoord2f(0,0);
-	gGL.vertex3fv((pos+left-up).mV);
-	gGL.texCoord2f(1,0);
-	gGL.vertex3fv((pos-left-up).mV);
-	gGL.texCoord2f(1,1);
-	gGL.vertex3fv((pos-left+up).mV);
-	gGL.texCoord2f(0,1);
-	gGL.vertex3fv((pos+left+up).mV);
-	gGL.end();
-	gGL.flush();
+	// drawn with the other impostors by LLImpostorAtlas::renderQuads()
+	LLVector3 corners[4] = { pos+left-up, pos-left-up, pos-left+up, pos+left+up };
+	LLImpostorAtlas::getInstance()->addQuad(mImpostorSlot, corners, color);
 
 	return 6;
 }
@@ -5833,6 +6076,25 @@ void LLVOAvatar::getGround(const LLVector3 &in_pos_agent, LLVector3 &out_pos_age
 		return;
 	}
 
+	if (sAnimationStageRunning)
+	{
+		// Ray casting into the world is not thread safe; use the plane
+		// resolved under the pelvis at the start of this update.
+		out_pos_agent = in_pos_agent;
+		if (mStageGroundNormal.mV[VZ] > 0.1f)
+		{
+			LLVector3 offset = in_pos_agent - mStageGroundPos;
+			out_pos_agent.mV[VZ] = mStageGroundPos.mV[VZ]
+				- (mStageGroundNormal.mV[VX] * offset.mV[VX] + mStageGroundNormal.mV[VY] * offset.mV[VY]) / mStageGroundNormal.mV[VZ];
+			outNorm = mStageGroundNormal;
+		}
+		else
+		{
+			outNorm.setVec(z_vec);
+		}
+		return;
+	}
+
 	p0_global = gAgent.getPosGlobalFromAgent(in_pos_agent) + z_vec;
 	p1_global = gAgent.getPosGlobalFromAgent(in_pos_agent) - z_vec;
 	LLViewerObject *obj;
@@ -5841,6 +6103,52 @@ void LLVOAvatar::getGround(const LLVector3 &in_pos_agent, LLVector3 &out_pos_age
 	out_pos_agent = gAgent.getPosAgentFromGlobal(out_pos_global);
 }
 
+//-----------------------------------------------------------------------------
+// canStageAnimation()
+// While the animation stage runs, getGround() answers from the plane under
+// the pelvis. That is only what a ray cast would find when the ground under
+// the feet lies on the same plane, so avatars on stairs, steps and uneven
+// prims blend on the main thread. The ankles are probed where the last
+// update left them.
+//-----------------------------------------------------------------------------
+BOOL LLVOAvatar::canStageAnimation()
+{
+	const F32 MAX_PLANE_DISTANCE = 0.01f;
+	const F32 MIN_NORMAL_DOT = 0.999f;
+
+	if (gNoRender || mIsDummy)
+	{ // getGround() doesn't look at the world
+		return TRUE;
+	}
+
+	if (mStageGroundNormal.isExactlyZero())
+	{ // seated, updateCharacter() didn't resolve the ground
+		LLVector3 pelvis_pos = mRoot.getWorldPosition();
+		getGround(pelvis_pos, mStageGroundPos, mStageGroundNormal);
+	}
+	if (mStageGroundNormal.mV[VZ] <= 0.1f)
+	{
+		return FALSE;
+	}
+
+	LLJoint* ankles[2] = { mAnkleLeftp, mAnkleRightp };
+	for (S32 i = 0; i < 2; i++)
+	{
+		if (!ankles[i])
+		{
+			return FALSE;
+		}
+		LLVector3 ground_pos, ground_normal;
+		getGround(ankles[i]->getWorldPosition(), ground_pos, ground_normal);
+		if (llabs((ground_pos - mStageGroundPos) * mStageGroundNormal) > MAX_PLANE_DISTANCE ||
+			ground_normal * mStageGroundNormal < MIN_NORMAL_DOT)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 //-----------------------------------------------------------------------------
 // LLVOAvatar::getTimeDilation()
 //-----------------------------------------------------------------------------
@@ -6376,6 +6684,13 @@ void LLVOAvatar::updateVisualParams()
 		return;
 	}
 
+	if (sAnimationStageRunning)
+	{
+		// called by a motion on a worker thread, see updateCharacterFinish()
+		mVisualParamsDeferred = TRUE;
+		return;
+	}
+
 	setSex( (getVisualParamWeight( "male" ) > 0.5f) ? SEX_MALE : SEX_FEMALE );
 
 	LLCharacter::updateVisualParams();
@@ -7367,9 +7682,35 @@ void LLVOAvatar::processRebakeAvatarTextures(LLMessageSystem* msg, void**)
 	}
 }
 
-// Tombstone for
-// BOOL LLVOAvatar::getLocalTextureRaw(ETextureIndex index, LLImageRaw* image_raw)
-// its corpse was found in slviewer-src-viewer-1.23.4-r124025
+// Gets the full resolution decoded data of a local texture for the CPU bake.
+// Returns FALSE if it isn't in memory yet; it is then requested so that a
+// later bake can use it.  Returns TRUE with a NULL image for the default texture.
+BOOL LLVOAvatar::getLocalTextureRaw(ETextureIndex index, LLImageRaw** image_raw_pp)
+{
+	*image_raw_pp = NULL;
+	if (!isIndexLocalTexture(index)) return FALSE;
+
+	if (getLocalTextureID(index) == IMG_DEFAULT_AVATAR)
+	{
+		return TRUE;
+	}
+
+	LLViewerImage* image = mLocalTextureData[index].mImage;
+	if (!image)
+	{
+		return FALSE;
+	}
+	if (image->getSavedRawImageLevel() != 0 || !image->getSavedRawImage())
+	{
+		if (!image->isForcedToSaveRawImage())
+		{
+			image->forceToSaveRawImage(0);
+		}
+		return FALSE;
+	}
+	*image_raw_pp = image->getSavedRawImage();
+	return TRUE;
+}
 
 BOOL LLVOAvatar::getLocalTextureGL(ETextureIndex index, LLImageGL** image_gl_pp)
 {
@@ -7936,6 +8277,15 @@ void LLVOAvatar::setLocalTexture( ETextureIndex index, LLViewerImage* tex, BOOL
 			tex->setMinDiscardLevel(desired_discard);
 		}
 	}
+	if (mIsSelf && tex != local_tex_data.mImage && tex->getID() != IMG_DEFAULT_AVATAR)
+	{
+		// Keep the decoded data of our own textures around for the CPU bake
+		static LLCachedControl<BOOL> bake_on_cpu("AvatarBakeOnCPU", TRUE);
+		if (bake_on_cpu)
+		{
+			tex->forceToSaveRawImage(0);
+		}
+	}
 	local_tex_data.mIsBakedReady = baked_version_ready;
 	local_tex_data.mImage = tex;
 }
@@ -9996,16 +10346,54 @@ U32 LLVOAvatar::getPartitionType() const
 //static
 void LLVOAvatar::updateImpostors()
 {
+	// Impostors that need regenerating are done most stale and biggest on
+	// screen first, and at most RenderImpostorUpdatesPerFrame of them a
+	// frame; the others keep their old image for now.  Avatars that have no
+	// impostor yet come before all of them.
+	typedef std::pair<F32, LLVOAvatar*> candidate_t;
+	std::vector<candidate_t> candidates;
+	F64 now = LLFrameTimer::getElapsedSeconds();
 	for (std::vector<LLCharacter*>::iterator iter = LLCharacter::sInstances.begin();
 		iter != LLCharacter::sInstances.end(); ++iter)
 	{
 		LLVOAvatar* avatar = (LLVOAvatar*) *iter;
 
-		if (!avatar->isDead() && avatar->needsImpostorUpdate() && avatar->isVisible() && avatar->isImpostor())
+		if (avatar->isDead())
 		{
-			gPipeline.generateImpostor(avatar);
+			continue;
+		}
+		if (!avatar->isImpostor())
+		{
+			// give the atlas space back
+			LLImpostorAtlas::getInstance()->free(avatar->mImpostorSlot);
+			continue;
+		}
+		if (avatar->isVisible() && (avatar->needsImpostorUpdate() || avatar->mImpostorSlot.isNull()))
+		{
+			F32 score = F32_MAX;
+			if (!avatar->mImpostorSlot.isNull())
+			{
+				score = ((F32)(now - avatar->mImpostorUpdateTime) + 0.1f) * avatar->mImpostorPixelArea;
+			}
+			candidates.push_back(candidate_t(score, avatar));
 		}
 	}
+
+	U32 count = candidates.size();
+	// A U32 setting, but LLSD has no unambiguous conversion to U32.
+	static LLCachedControl<S32> updates_per_frame("RenderImpostorUpdatesPerFrame", 4);
+	if (updates_per_frame > 0)
+	{
+		count = llmin(count, (U32)(S32)updates_per_frame);
+	}
+	std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+					  std::greater<candidate_t>());
+	for (U32 i = 0; i < count; i++)
+	{
+		gPipeline.generateImpostor(candidates[i].second);
+	}
+
+	LLImpostorAtlas::getInstance()->updateStats();
 }
 
 BOOL LLVOAvatar::isImpostor() const
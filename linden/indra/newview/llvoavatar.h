@@ -46,6 +46,7 @@
 #include "llcharacter.h"
 #include "llviewerjointmesh.h"
 #include "llviewerjointattachment.h"
+#include "llimpostoratlas.h"
 #include "llrendertarget.h"
 #include "llwearable.h"
 #include "llvoavatardefines.h"
@@ -318,7 +319,7 @@ public:
 	LLVOAvatarDefines::ETextureIndex	getBakedTE( LLTexLayerSet* layerset );
 	void			updateComposites();
 	void			onGlobalColorChanged( LLTexGlobalColor* global_color, BOOL set_by_user );
-// Removed:	BOOL		getLocalTextureRaw( LLVOAvatarDefines::ETextureIndex index, LLImageRaw* image_raw_pp );
+	BOOL		getLocalTextureRaw( LLVOAvatarDefines::ETextureIndex index, LLImageRaw** image_raw_pp );
 	BOOL			getLocalTextureGL( LLVOAvatarDefines::ETextureIndex index, LLImageGL** image_gl_pp );
 	const LLUUID&	getLocalTextureID( LLVOAvatarDefines::ETextureIndex index );
 	LLGLuint		getScratchTexName( LLGLenum format, U32* texture_bytes );
@@ -416,8 +417,9 @@ public:
 	// impostor state
 	//--------------------------------------------------------------------
 public:
-	LLRenderTarget	mImpostor;
+	LLImpostorSlot	mImpostorSlot;
 	BOOL			mNeedsImpostorUpdate;
+	F64				mImpostorUpdateTime;	// when the impostor was last generated
 private:
 	LLVector3		mImpostorOffset;
 	LLVector2		mImpostorDim;
@@ -772,6 +774,53 @@ public:
 	static void updateFreezeCounter(S32 counter = 0 );
 private:
 	static S32 sFreezeCounter;
+
+	//--------------------------------------------------------------------
+	// Parallel animation stage
+	//--------------------------------------------------------------------
+public:
+	// Avatars that update between these calls have their motion blending and
+	// skeleton update deferred to endAnimationStage(), which runs them all
+	// across the thread pool and then finishes each avatar's idle update.
+	static void beginAnimationStage();
+	static void endAnimationStage();
+private:
+	void updateCharacterFinish();
+	void idleUpdateFinish(bool detailed_update, const LLVector3& root_pos_last);
+	// TRUE if the ground plane under the pelvis is also under both ankles
+	BOOL canStageAnimation();
+
+	static BOOL sAnimationStageOpen;
+	static BOOL sAnimationStageRunning;	// blending on worker threads
+	static std::vector<LLPointer<LLVOAvatar> > sAnimationStageQueue;
+
+	BOOL		mAnimationStaged;
+	BOOL		mVisualParamsDeferred;
+	LLVector3	mStagedRootPosLast;
+	// ground under the pelvis, answers getGround() while staged
+	LLVector3	mStageGroundPos;
+	LLVector3	mStageGroundNormal;
+
+	//--------------------------------------------------------------------
+	// Animation LOD
+	//--------------------------------------------------------------------
+public:
+	// Totals of the last frame's avatar animation, for statistics.
+	static S32 sAnimationLODCounts[LLCharacter::ANIMATION_LOD_COUNT];	// avatars animated at each LOD
+	static F32 sAnimationTime;			// ms spent updating avatar motions
+	static F32 sAnimationTimeSaved;		// estimated ms saved by blends the LODs skipped
+	static F32 sAnimationLODBias;		// how far over budget has pushed the LODs, 0 when under
+private:
+	// Picks this avatar's animation LOD and time step from its screen size.
+	void updateAnimationLOD();
+	// Closes the frame's animation accounting and moves the budget bias.
+	static void updateAnimationBudget();
+
+	static S32 sAnimationLODFrameCounts[LLCharacter::ANIMATION_LOD_COUNT];
+	static S32 sAnimationFrameBlends;	// avatars whose motions were blended this frame
+	static U64 sAnimationFrameTime;		// microseconds
+	static F32 sAnimationBlendCost;		// running average ms per blend
+	static F32 sAnimationTimeAverage;	// running average ms per frame
 	
 	//-----------------------------------------------------------------------------------------------
 	// Avatar skeleton setup.
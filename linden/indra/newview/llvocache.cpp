@@ -35,6 +35,9 @@
 #include "llvocache.h"
 
 #include "llerror.h"
+#include "llcrc.h"
+
+#include "apr_mmap.h"
 
 //---------------------------------------------------------------------------
 // LLVOCacheEntry
@@ -64,42 +67,16 @@ LLVOCacheEntry::LLVOCacheEntry()
 }
 
 
-static inline void checkedRead(LLFILE *fp, void *data, size_t nbytes)
+LLVOCacheEntry::LLVOCacheEntry(const LLVOCacheIndexEntry& slot, const U8* data)
 {
-	if (fread(data, 1, nbytes, fp) != nbytes)
-	{
-		llwarns << "Short read" << llendl;
-		memset(data, 0, nbytes);
-	}
-}
-
-LLVOCacheEntry::LLVOCacheEntry(LLFILE *fp)
-{
-	S32 size;
-	checkedRead(fp, &mLocalID, sizeof(U32));
-	checkedRead(fp, &mCRC, sizeof(U32));
-	checkedRead(fp, &mHitCount, sizeof(S32));
-	checkedRead(fp, &mDupeCount, sizeof(S32));
-	checkedRead(fp, &mCRCChangeCount, sizeof(S32));
-
-	checkedRead(fp, &size, sizeof(S32));
-
-	// Corruption in the cache entries
-	if ((size > 10000) || (size < 1))
-	{
-		// We've got a bogus size, skip reading it.
-		// We won't bother seeking, because the rest of this file
-		// is likely bogus, and will be tossed anyway.
-		llwarns << "Bogus cache entry, size " << size << ", aborting!" << llendl;
-		mLocalID = 0;
-		mCRC = 0;
-		mBuffer = NULL;
-		return;
-	}
-
-	mBuffer = new U8[size];
-	checkedRead(fp, mBuffer, size);
-	mDP.assignBuffer(mBuffer, size);
+	mLocalID = slot.mLocalID;
+	mCRC = slot.mCRC;
+	mHitCount = slot.mHitCount;
+	mDupeCount = slot.mDupeCount;
+	mCRCChangeCount = slot.mCRCChangeCount;
+	mBuffer = new U8[slot.mSize];
+	memcpy(mBuffer, data, slot.mSize);		/* Flawfinder: ignore */
+	mDP.assignBuffer(mBuffer, slot.mSize);
 }
 
 LLVOCacheEntry::~LLVOCacheEntry()
@@ -157,22 +134,276 @@ void LLVOCacheEntry::dump() const
 		<< llendl;
 }
 
-static inline void checkedWrite(LLFILE *fp, const void *data, size_t nbytes)
+//---------------------------------------------------------------------------
+// LLVOCacheFile
+//---------------------------------------------------------------------------
+
+// Viewer object cache version, change if object update
+// format changes. JC
+const U32 INDRA_OBJECT_CACHE_VERSION = 15;
+
+// Bogus sizes mean a corrupt file, same limit the old loader used.
+const U32 MAX_CACHE_ENTRY_SIZE = 10000;
+
+struct LLVOCacheFileHeader
+{
+	U32		mZero;			// always zero, old viewers read this as a bad file
+	U32		mVersion;
+	U8		mCacheID[UUID_BYTES];
+	U32		mNumEntries;
+	U32		mIndexSize;
+	U32		mDataOffset;
+};
+
+LLVOCacheFile::LLVOCacheFile()
+:	mMap(NULL),
+	mHeapCopy(NULL),
+	mData(NULL),
+	mDataSize(0),
+	mIndex(NULL),
+	mIndexSize(0),
+	mNumEntries(0)
+{
+}
+
+LLVOCacheFile::~LLVOCacheFile()
+{
+	close();
+}
+
+//static
+U32 LLVOCacheFile::calcIndexSize(U32 num_entries)
+{
+	// keep the load factor at or below one half
+	U32 size = 16;
+	while (size < num_entries * 2)
+	{
+		size <<= 1;
+	}
+	return size;
+}
+
+BOOL LLVOCacheFile::open(const std::string& filename, const LLUUID& cache_id)
+{
+	close();
+
+	S32 file_size = 0;
+	LLAPRFile infile;
+	infile.open(filename, APR_READ|APR_BINARY, LLAPRFile::global, &file_size);
+	if (!infile.getFileHandle())
+	{
+		// might not have a file, which is normal
+		return FALSE;
+	}
+	if (file_size < (S32)sizeof(LLVOCacheFileHeader))
+	{
+		llinfos << "Cache file invalid" << llendl;
+		return FALSE;
+	}
+
+	if (!mPool)
+	{
+		mPool.create();
+	}
+	apr_status_t status = apr_mmap_create(&mMap, infile.getFileHandle(), 0, file_size, APR_MMAP_READ, mPool());
+	if (status == APR_SUCCESS && mMap)
+	{
+		mData = (const U8*)mMap->mm;
+	}
+	else
+	{
+		// Not every file system lets us map; a single read is still far cheaper
+		// than decoding every entry up front.
+		mMap = NULL;
+		mHeapCopy = new U8[file_size];
+		if (infile.read(mHeapCopy, file_size) != file_size)
+		{
+			llinfos << "Short read, discarding" << llendl;
+			close();
+			return FALSE;
+		}
+		mData = mHeapCopy;
+	}
+	mDataSize = (U32)file_size;
+	infile.close();
+
+	LLVOCacheFileHeader header;
+	memcpy(&header, mData, sizeof(header));		/* Flawfinder: ignore */
+	if (header.mZero)
+	{
+		// a non-zero value here means bad things!
+		llinfos << "Cache file invalid" << llendl;
+		close();
+		return FALSE;
+	}
+	if (header.mVersion != INDRA_OBJECT_CACHE_VERSION)
+	{
+		// a version mismatch here means we've changed the binary format!
+		llinfos << "Cache version changed, discarding" << llendl;
+		close();
+		return FALSE;
+	}
+	if (memcmp(header.mCacheID, cache_id.mData, UUID_BYTES))
+	{
+		llinfos << "Cache ID doesn't match for this region, discarding" << llendl;
+		close();
+		return FALSE;
+	}
+
+	// 64 bit, a corrupt index size must not wrap around
+	U64 index_end = (U64)sizeof(header) + (U64)header.mIndexSize * sizeof(LLVOCacheIndexEntry);
+	if (!header.mIndexSize ||
+		(header.mIndexSize & (header.mIndexSize - 1)) ||
+		header.mNumEntries > header.mIndexSize / 2 ||
+		index_end > (U64)mDataSize ||
+		(U64)header.mDataOffset < index_end ||
+		header.mDataOffset > mDataSize)
+	{
+		llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
+		close();
+		return FALSE;
+	}
+
+	mIndex = (const LLVOCacheIndexEntry*)(mData + sizeof(header));
+	mIndexSize = header.mIndexSize;
+	mNumEntries = header.mNumEntries;
+	return TRUE;
+}
+
+void LLVOCacheFile::close()
+{
+	if (mMap)
+	{
+		apr_mmap_delete(mMap);
+		mMap = NULL;
+	}
+	delete [] mHeapCopy;
+	mHeapCopy = NULL;
+	mData = NULL;
+	mDataSize = 0;
+	mIndex = NULL;
+	mIndexSize = 0;
+	mNumEntries = 0;
+}
+
+const LLVOCacheIndexEntry* LLVOCacheFile::find(U32 local_id) const
+{
+	if (!mIndex || !local_id)
+	{
+		return NULL;
+	}
+
+	U32 slot = hashLocalID(local_id, mIndexSize);
+	for (U32 probes = 0; probes < mIndexSize; probes++)
+	{
+		const LLVOCacheIndexEntry* entry = mIndex + slot;
+		if (entry->mLocalID == local_id)
+		{
+			return entry;
+		}
+		if (!entry->mLocalID)
+		{
+			break;
+		}
+		slot = (slot + 1) & (mIndexSize - 1);
+	}
+	return NULL;
+}
+
+const U8* LLVOCacheFile::getSlotData(const LLVOCacheIndexEntry* slot) const
+{
+	if (!slot || !mData ||
+		slot->mSize < 1 || slot->mSize > MAX_CACHE_ENTRY_SIZE ||
+		slot->mOffset > mDataSize || slot->mSize > mDataSize - slot->mOffset)
+	{
+		return NULL;
+	}
+	return mData + slot->mOffset;
+}
+
+LLVOCacheEntry* LLVOCacheFile::decode(const LLVOCacheIndexEntry* slot) const
+{
+	const U8* data = getSlotData(slot);
+	if (!data)
+	{
+		llwarns << "Bogus cache entry for local id " << (slot ? slot->mLocalID : 0) << llendl;
+		return NULL;
+	}
+
+	LLCRC crc;
+	crc.update(data, slot->mSize);
+	if (crc.getCRC() != slot->mChecksum)
+	{
+		llwarns << "Checksum mismatch in cache entry for local id " << slot->mLocalID << llendl;
+		return NULL;
+	}
+	return new LLVOCacheEntry(*slot, data);
+}
+
+static inline BOOL checkedWrite(LLFILE *fp, const void *data, size_t nbytes)
 {
 	if (fwrite(data, 1, nbytes, fp) != nbytes)
 	{
 		llwarns << "Short write" << llendl;
+		return FALSE;
 	}
+	return TRUE;
 }
 
-void LLVOCacheEntry::writeToFile(LLFILE *fp) const
+//static
+BOOL LLVOCacheFile::write(const std::string& filename, const LLUUID& cache_id,
+						  const std::vector<LLVOCacheIndexEntry>& slots,
+						  const std::vector<const U8*>& data)
 {
-	checkedWrite(fp, &mLocalID, sizeof(U32));
-	checkedWrite(fp, &mCRC, sizeof(U32));
-	checkedWrite(fp, &mHitCount, sizeof(S32));
-	checkedWrite(fp, &mDupeCount, sizeof(S32));
-	checkedWrite(fp, &mCRCChangeCount, sizeof(S32));
-	S32 size = mDP.getBufferSize();
-	checkedWrite(fp, &size, sizeof(S32));
-	checkedWrite(fp, mBuffer, size);
+	llassert(slots.size() == data.size());
+
+	LLVOCacheFileHeader header;
+	header.mZero = 0;
+	header.mVersion = INDRA_OBJECT_CACHE_VERSION;
+	memcpy(header.mCacheID, cache_id.mData, UUID_BYTES);		/* Flawfinder: ignore */
+	header.mNumEntries = slots.size();
+	header.mIndexSize = calcIndexSize(header.mNumEntries);
+	header.mDataOffset = sizeof(header) + header.mIndexSize * sizeof(LLVOCacheIndexEntry);
+
+	// Build the index, laying the data out in the order given.
+	std::vector<LLVOCacheIndexEntry> index(header.mIndexSize);
+	memset(&index[0], 0, index.size() * sizeof(LLVOCacheIndexEntry));
+	U32 offset = header.mDataOffset;
+	for (U32 i = 0; i < slots.size(); i++)
+	{
+		LLVOCacheIndexEntry entry = slots[i];
+		entry.mOffset = offset;
+		LLCRC crc;
+		crc.update(data[i], entry.mSize);
+		entry.mChecksum = crc.getCRC();
+		offset += entry.mSize;
+
+		U32 slot = hashLocalID(entry.mLocalID, header.mIndexSize);
+		while (index[slot].mLocalID)
+		{
+			slot = (slot + 1) & (header.mIndexSize - 1);
+		}
+		index[slot] = entry;
+	}
+
+	LLFILE* fp = LLFile::fopen(filename, "wb");		/* Flawfinder: ignore */
+	if (!fp)
+	{
+		llwarns << "Unable to write cache file " << filename << llendl;
+		return FALSE;
+	}
+
+	BOOL success = checkedWrite(fp, &header, sizeof(header)) &&
+				   checkedWrite(fp, &index[0], index.size() * sizeof(LLVOCacheIndexEntry));
+	for (U32 i = 0; success && i < slots.size(); i++)
+	{
+		success = checkedWrite(fp, data[i], slots[i].mSize);
+	}
+	fclose(fp);
+
+	if (!success)
+	{
+		LLFile::remove(filename);
+	}
+	return success;
 }
@@ -36,7 +36,26 @@
 #include "lluuid.h"
 #include "lldatapacker.h"
 #include "lldlinked.h"
+#include "llapr.h"
+#include "aiaprpool.h"
 
+#include <vector>
+
+struct apr_mmap_t;
+
+//---------------------------------------------------------------------------
+// On-disk index slot, one per hash bucket. A local id of zero marks an empty slot.
+struct LLVOCacheIndexEntry
+{
+	U32		mLocalID;
+	U32		mCRC;			// object CRC as sent by the simulator
+	U32		mOffset;		// offset of the packed update data from the start of the file
+	U32		mSize;			// size of the packed update data
+	U32		mChecksum;		// LLCRC of the packed update data
+	S32		mHitCount;
+	S32		mDupeCount;
+	S32		mCRCChangeCount;
+};
 
 //---------------------------------------------------------------------------
 // Cache entries
@@ -46,17 +65,19 @@ class LLVOCacheEntry : public LLDLinked<LLVOCacheEntry>
 {
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLFILE *fp);
+	LLVOCacheEntry(const LLVOCacheIndexEntry& slot, const U8* data);
 	LLVOCacheEntry();
 	~LLVOCacheEntry();
 
 	U32 getLocalID() const			{ return mLocalID; }
 	U32 getCRC() const				{ return mCRC; }
 	S32 getHitCount() const			{ return mHitCount; }
+	S32 getDupeCount() const		{ return mDupeCount; }
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
+	const U8* getData() const		{ return mBuffer; }
+	S32 getSize() const				{ return mDP.getBufferSize(); }
 
 	void dump() const;
-	void writeToFile(LLFILE *fp) const;
 	void assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp);
 	LLDataPackerBinaryBuffer *getDP(U32 crc);
 	void recordHit();
@@ -72,4 +93,61 @@ protected:
 	U8							*mBuffer;
 };
 
+//---------------------------------------------------------------------------
+// Per-region object cache file.
+//
+// Layout (native byte order):
+//   U32 zero, U32 version, cache id, U32 entry count, U32 index size, U32 data offset
+//   LLVOCacheIndexEntry[index size]   open addressed on local id, linear probing
+//   packed object update data
+//
+// The file is mapped read only, so connecting to a region only validates the
+// header. Entries are checksummed and turned into LLVOCacheEntry objects the
+// first time an ObjectUpdateCached message actually asks for them.
+class LLVOCacheFile
+{
+public:
+	LLVOCacheFile();
+	~LLVOCacheFile();
+
+	// Returns FALSE if the file is missing, from another version or region, or corrupt.
+	BOOL open(const std::string& filename, const LLUUID& cache_id);
+	void close();
+	BOOL isOpen() const						{ return mData != NULL; }
+
+	const LLVOCacheIndexEntry* find(U32 local_id) const;
+	// Validates the slot's checksum and copies its data. Returns NULL on corruption.
+	LLVOCacheEntry* decode(const LLVOCacheIndexEntry* slot) const;
+	const U8* getSlotData(const LLVOCacheIndexEntry* slot) const;
+
+	U32 getNumEntries() const				{ return mNumEntries; }
+	U32 getIndexSize() const				{ return mIndexSize; }
+	const LLVOCacheIndexEntry* getIndex() const	{ return mIndex; }
+
+	// Writes a new cache file. The entries must have unique, non-zero local ids.
+	static BOOL write(const std::string& filename, const LLUUID& cache_id,
+					  const std::vector<LLVOCacheIndexEntry>& slots,
+					  const std::vector<const U8*>& data);
+
+	static U32 hashLocalID(U32 local_id, U32 index_size)
+	{
+		// index_size is a power of two, so this keeps the low bits of the
+		// product. They only depend on the low bits of the id, but an odd
+		// multiplier maps those one to one, and region local ids are mostly
+		// sequential, so neighbours still land in different slots.
+		return (local_id * 2654435761u) & (index_size - 1);
+	}
+	static U32 calcIndexSize(U32 num_entries);
+
+private:
+	AIAPRPool					mPool;
+	apr_mmap_t*					mMap;
+	U8*							mHeapCopy;	// used when the file could not be mapped
+	const U8*					mData;
+	U32							mDataSize;
+	const LLVOCacheIndexEntry*	mIndex;
+	U32							mIndexSize;
+	U32							mNumEntries;
+};
+
 #endif
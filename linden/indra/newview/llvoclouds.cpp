@@ -59,6 +59,7 @@ LLVOClouds::LLVOClouds(const LLUUID &id, const LLPCode pcode, LLViewerRegion *re
 :	LLAlphaObject(id, LL_VO_CLOUDS, regionp)
 {
 	mCloudGroupp = NULL;
+	mNumPuffsBuilt = 0;
 	mbCanSelect = FALSE;
 	setNumTEs(1);
 	LLViewerImage* image = gImageList.getImage(gCloudTextureID);
@@ -85,8 +86,27 @@ BOOL LLVOClouds::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 		return TRUE;
 	}
 	
+	if (!mDrawable || !mCloudGroupp)
+	{
+		return TRUE;
+	}
+
+	BOOL rebuild;
+	if (!LLCloudLayer::useClassicClouds())
+	{
+		// Once to drop the puffs, nothing moves them while clouds are off
+		rebuild = mNumPuffsBuilt > 0;
+	}
+	else
+	{
+		// Visible puffs turn to face the camera every frame, the others
+		// only need their new positions
+		BOOL changed = mCloudGroupp->takeChanged();
+		rebuild = changed || mDrawable->isVisible();
+	}
+
 	// Set dirty flag (so renderer will rebuild primitive)
-	if (mDrawable)
+	if (rebuild)
 	{
 		gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_VOLUME, TRUE);
 	}
@@ -127,7 +147,8 @@ BOOL LLVOClouds::updateGeometry(LLDrawable *drawable)
 
 	LLFace *facep;
 	
-	S32 num_faces = mCloudGroupp->getNumPuffs();
+	S32 num_faces = LLCloudLayer::useClassicClouds() ? mCloudGroupp->getNumPuffs() : 0;
+	mNumPuffsBuilt = num_faces;
 
 	if (num_faces > drawable->getNumFaces())
 	{
@@ -188,7 +209,7 @@ void LLVOClouds::getGeometry(S32 te,
 							LLStrider<U16>& indicesp)
 {
 
-	if (te >= mCloudGroupp->getNumPuffs())
+	if (te >= mNumPuffsBuilt || te >= mCloudGroupp->getNumPuffs())
 	{
 		return;
 	}
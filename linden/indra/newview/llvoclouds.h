@@ -78,6 +78,7 @@ protected:
 	virtual ~LLVOClouds();
 
 	LLCloudGroup *mCloudGroupp;
+	S32 mNumPuffsBuilt;		// faces with geometry since the last rebuild
 };
 
 extern LLUUID gCloudTextureID;
@@ -566,6 +566,8 @@ LLGrassPartition::LLGrassPartition()
 	mSlopRatio = 0.1f;
 	mRenderPass = LLRenderPass::PASS_GRASS;
 	mBufferUsage = GL_DYNAMIC_DRAW_ARB;
+	mUseRecords = FALSE;
+	mAllowInstancing = FALSE;
 }
 
 // virtual
@@ -43,10 +43,14 @@
 #include "llagent.h"
 #include "lldrawable.h"
 #include "llface.h"
+#include "llglslshader.h"
 #include "llsky.h"
+#include "llv4math.h"
 #include "llviewercamera.h"
+#include "llviewercontrol.h"
 #include "llviewerpartsim.h"
 #include "llviewerregion.h"
+#include "llviewershadermgr.h"
 #include "pipeline.h"
 #include "llspatialpartition.h"
 
@@ -54,6 +58,90 @@ const F32 MAX_PART_LIFETIME = 120.f;
 
 extern U64 gFrameTime;
 
+LLPointer<LLVertexBuffer> LLVOPartGroup::sCornerBuffer;
+
+namespace
+{
+	// Half of the quad's right and up axes, the way getGeometry() always
+	// built them: facing the camera, turned to the velocity if the
+	// particle follows it.
+	void get_quad_axes(const LLParticleRecord& record, const LLVector3& camera_agent,
+					   LLVector3& right, LLVector3& up)
+	{
+		LLVector3 at = record.mCenter - camera_agent;
+		right = at % LLVector3(0.f, 0.f, 1.f);
+		right.normalize();
+		up = right % at;
+		up.normalize();
+
+		if (!record.mVelocity.isExactlyZero())
+		{
+			LLVector2 up_fracs(record.mVelocity * right, record.mVelocity * up);
+			up_fracs.normalize();
+			LLVector3 new_up = up_fracs.mV[0] * right + up_fracs.mV[1] * up;
+			LLVector3 new_right = up_fracs.mV[1] * right - up_fracs.mV[0] * up;
+			up = new_up;
+			right = new_right;
+			up.normalize();
+			right.normalize();
+		}
+
+		right *= 0.5f * record.mScale.mV[0];
+		up *= 0.5f * record.mScale.mV[1];
+	}
+
+	void write_quad(const LLParticleRecord& record, const LLVector3& right, const LLVector3& up,
+					const LLVector3& normal, U16 vert_offset,
+					LLStrider<LLVector3>& verticesp,
+					LLStrider<LLVector3>& normalsp,
+					LLStrider<LLVector2>& texcoordsp,
+					LLStrider<LLColor4U>& colorsp,
+					LLStrider<U16>& indicesp)
+	{
+		*verticesp++ = record.mCenter + up - right;
+		*verticesp++ = record.mCenter - up - right;
+		*verticesp++ = record.mCenter + up + right;
+		*verticesp++ = record.mCenter - up + right;
+
+		*colorsp++ = record.mColor;
+		*colorsp++ = record.mColor;
+		*colorsp++ = record.mColor;
+		*colorsp++ = record.mColor;
+
+		*texcoordsp++ = LLVector2(0.f, 1.f);
+		*texcoordsp++ = LLVector2(0.f, 0.f);
+		*texcoordsp++ = LLVector2(1.f, 1.f);
+		*texcoordsp++ = LLVector2(1.f, 0.f);
+
+		*normalsp++   = normal;
+		*normalsp++   = normal;
+		*normalsp++   = normal;
+		*normalsp++   = normal;
+
+		*indicesp++ = vert_offset + 0;
+		*indicesp++ = vert_offset + 1;
+		*indicesp++ = vert_offset + 2;
+
+		*indicesp++ = vert_offset + 1;
+		*indicesp++ = vert_offset + 3;
+		*indicesp++ = vert_offset + 2;
+	}
+
+#if LL_VECTORIZE
+	// 1 / length for lengths LLVector3::normalize() doesn't zero, 0 for the rest
+	inline __m128 inv_length(__m128 length_squared)
+	{
+		const __m128 valid = _mm_cmpgt_ps(length_squared, _mm_set1_ps(FP_MAG_THRESHOLD * FP_MAG_THRESHOLD));
+		return _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(length_squared)));
+	}
+
+	inline __m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+#endif
+}
+
 LLVOPartGroup::LLVOPartGroup(const LLUUID &id, const LLPCode pcode, LLViewerRegion *regionp)
 	:	LLAlphaObject(id, pcode, regionp),
 		mViewerPartGroupp(NULL)
@@ -128,7 +216,7 @@ F32 LLVOPartGroup::getPartSize(S32 idx)
 {
 	if (idx < (S32) mViewerPartGroupp->mParticles.size())
 	{
-		return mViewerPartGroupp->mParticles[idx]->mScale.mV[0];
+		return mViewerPartGroupp->getStore().get(LLViewerPartStore::SCALE_X, idx);
 	}
 
 	return 0.f;
@@ -187,11 +275,13 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 	mDepth = 0.f;
 	S32 i = 0 ;
 	LLVector3 camera_agent = getCameraPosition();
+	const LLViewerPartStore& store = mViewerPartGroupp->getStore();
 	for (i = 0 ; i < (S32)mViewerPartGroupp->mParticles.size(); i++)
 	{
 		const LLViewerPart *part = mViewerPartGroupp->mParticles[i];
 
-		LLVector3 part_pos_agent(part->mPosAgent);
+		LLVector3 part_pos_agent(store.getPosition(i));
+		LLVector2 part_scale(store.getScale(i));
 		LLVector3 at(part_pos_agent - camera_agent);
 
 		F32 camera_dist_squared = at.lengthSquared();
@@ -200,7 +290,7 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 			inv_camera_dist_squared = 1.f / camera_dist_squared;
 		else
 			inv_camera_dist_squared = 1.f;
-		F32 area = part->mScale.mV[0] * part->mScale.mV[1] * inv_camera_dist_squared;
+		F32 area = part_scale.mV[0] * part_scale.mV[1] * inv_camera_dist_squared;
 		tot_area = llmax(tot_area, area);
  		
 		if (tot_area > max_area)
@@ -240,8 +330,8 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 			facep->clearState(LLFace::FULLBRIGHT);
 		}
 
-		facep->mCenterLocal = part->mPosAgent;
-		facep->setFaceColor(part->mColor);
+		facep->mCenterLocal = part_pos_agent;
+		facep->setFaceColor(store.getColor(i));
 		facep->setTexture(part->mImagep);
 
 		mPixelArea = tot_area * pixel_meter_ratio;
@@ -265,6 +355,30 @@ BOOL LLVOPartGroup::updateGeometry(LLDrawable *drawable)
 	return TRUE;
 }
 
+BOOL LLVOPartGroup::getRecord(S32 idx, LLParticleRecord& record)
+{
+	if (idx >= (S32) mViewerPartGroupp->mParticles.size())
+	{
+		return FALSE;
+	}
+
+	const LLViewerPart &part = *((LLViewerPart*) (mViewerPartGroupp->mParticles[idx]));
+	const LLViewerPartStore& store = mViewerPartGroupp->getStore();
+
+	record.mCenter = store.getPosition(idx);
+	if (part.mFlags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK)
+	{
+		record.mVelocity = store.getVelocity(idx);
+	}
+	else
+	{
+		record.mVelocity.clearVec();
+	}
+	record.mScale = store.getScale(idx);
+	record.mColor = store.getColor(idx);
+	return TRUE;
+}
+
 void LLVOPartGroup::getGeometry(S32 idx,
 								LLStrider<LLVector3>& verticesp,
 								LLStrider<LLVector3>& normalsp, 
@@ -272,78 +386,192 @@ void LLVOPartGroup::getGeometry(S32 idx,
 								LLStrider<LLColor4U>& colorsp, 
 								LLStrider<U16>& indicesp)
 {
-	if (idx >= (S32) mViewerPartGroupp->mParticles.size())
+	LLParticleRecord record;
+	if (!getRecord(idx, record))
 	{
 		return;
 	}
 
-	const LLViewerPart &part = *((LLViewerPart*) (mViewerPartGroupp->mParticles[idx]));
-
 	U32 vert_offset = mDrawable->getFace(idx)->getGeomIndex();
+	expandRecords(&record, 1, getCameraPosition(), vert_offset,
+				  verticesp, normalsp, texcoordsp, colorsp, indicesp);
+}
 
-	
-	LLVector3 part_pos_agent(part.mPosAgent);
-	LLVector3 camera_agent = getCameraPosition(); 
-	LLVector3 at = part_pos_agent - camera_agent;
-	LLVector3 up;
+//static
+void LLVOPartGroup::expandRecords(const LLParticleRecord* records, S32 count,
+								  const LLVector3& camera_agent, U16 index_offset,
+								  LLStrider<LLVector3>& verticesp,
+								  LLStrider<LLVector3>& normalsp,
+								  LLStrider<LLVector2>& texcoordsp,
+								  LLStrider<LLColor4U>& colorsp,
+								  LLStrider<U16>& indicesp)
+{
+	LLVector3 normal = -LLViewerCamera::getInstance()->getXAxis();
 	LLVector3 right;
+	LLVector3 up;
+	S32 i = 0;
+
+#if LL_VECTORIZE
+	// The axes of four quads at a time, the vertices are written from them
+	// one particle at a time since the buffer is interleaved.
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 cam_x = _mm_set1_ps(camera_agent.mV[VX]);
+	const __m128 cam_y = _mm_set1_ps(camera_agent.mV[VY]);
+	const __m128 cam_z = _mm_set1_ps(camera_agent.mV[VZ]);
+	F32 axes[6][4];
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const LLParticleRecord* r = records + i;
+		const __m128 at_x = _mm_sub_ps(_mm_set_ps(r[3].mCenter.mV[VX], r[2].mCenter.mV[VX], r[1].mCenter.mV[VX], r[0].mCenter.mV[VX]), cam_x);
+		const __m128 at_y = _mm_sub_ps(_mm_set_ps(r[3].mCenter.mV[VY], r[2].mCenter.mV[VY], r[1].mCenter.mV[VY], r[0].mCenter.mV[VY]), cam_y);
+		const __m128 at_z = _mm_sub_ps(_mm_set_ps(r[3].mCenter.mV[VZ], r[2].mCenter.mV[VZ], r[1].mCenter.mV[VZ], r[0].mCenter.mV[VZ]), cam_z);
+
+		// right = at % z
+		__m128 inv = inv_length(_mm_add_ps(_mm_mul_ps(at_x, at_x), _mm_mul_ps(at_y, at_y)));
+		__m128 right_x = _mm_mul_ps(at_y, inv);
+		__m128 right_y = _mm_sub_ps(zero, _mm_mul_ps(at_x, inv));
+		__m128 right_z = zero;
+
+		// up = right % at
+		__m128 up_x = _mm_mul_ps(right_y, at_z);
+		__m128 up_y = _mm_sub_ps(zero, _mm_mul_ps(right_x, at_z));
+		__m128 up_z = _mm_sub_ps(_mm_mul_ps(right_x, at_y), _mm_mul_ps(right_y, at_x));
+		inv = inv_length(_mm_add_ps(_mm_add_ps(_mm_mul_ps(up_x, up_x), _mm_mul_ps(up_y, up_y)), _mm_mul_ps(up_z, up_z)));
+		up_x = _mm_mul_ps(up_x, inv);
+		up_y = _mm_mul_ps(up_y, inv);
+		up_z = _mm_mul_ps(up_z, inv);
+
+		const __m128 vel_x = _mm_set_ps(r[3].mVelocity.mV[VX], r[2].mVelocity.mV[VX], r[1].mVelocity.mV[VX], r[0].mVelocity.mV[VX]);
+		const __m128 vel_y = _mm_set_ps(r[3].mVelocity.mV[VY], r[2].mVelocity.mV[VY], r[1].mVelocity.mV[VY], r[0].mVelocity.mV[VY]);
+		const __m128 vel_z = _mm_set_ps(r[3].mVelocity.mV[VZ], r[2].mVelocity.mV[VZ], r[1].mVelocity.mV[VZ], r[0].mVelocity.mV[VZ]);
+		const __m128 follow = _mm_or_ps(_mm_or_ps(_mm_cmpneq_ps(vel_x, zero), _mm_cmpneq_ps(vel_y, zero)), _mm_cmpneq_ps(vel_z, zero));
+		if (_mm_movemask_ps(follow))
+		{
+			__m128 frac_x = _mm_add_ps(_mm_mul_ps(vel_x, right_x), _mm_mul_ps(vel_y, right_y));
+			__m128 frac_y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vel_x, up_x), _mm_mul_ps(vel_y, up_y)), _mm_mul_ps(vel_z, up_z));
+			inv = inv_length(_mm_add_ps(_mm_mul_ps(frac_x, frac_x), _mm_mul_ps(frac_y, frac_y)));
+			frac_x = _mm_mul_ps(frac_x, inv);
+			frac_y = _mm_mul_ps(frac_y, inv);
+
+			__m128 new_up_x = _mm_add_ps(_mm_mul_ps(frac_x, right_x), _mm_mul_ps(frac_y, up_x));
+			__m128 new_up_y = _mm_add_ps(_mm_mul_ps(frac_x, right_y), _mm_mul_ps(frac_y, up_y));
+			__m128 new_up_z = _mm_mul_ps(frac_y, up_z);
+			__m128 new_right_x = _mm_sub_ps(_mm_mul_ps(frac_y, right_x), _mm_mul_ps(frac_x, up_x));
+			__m128 new_right_y = _mm_sub_ps(_mm_mul_ps(frac_y, right_y), _mm_mul_ps(frac_x, up_y));
+			__m128 new_right_z = _mm_sub_ps(zero, _mm_mul_ps(frac_x, up_z));
+
+			inv = inv_length(_mm_add_ps(_mm_add_ps(_mm_mul_ps(new_up_x, new_up_x), _mm_mul_ps(new_up_y, new_up_y)), _mm_mul_ps(new_up_z, new_up_z)));
+			up_x = select(follow, _mm_mul_ps(new_up_x, inv), up_x);
+			up_y = select(follow, _mm_mul_ps(new_up_y, inv), up_y);
+			up_z = select(follow, _mm_mul_ps(new_up_z, inv), up_z);
+
+			inv = inv_length(_mm_add_ps(_mm_add_ps(_mm_mul_ps(new_right_x, new_right_x), _mm_mul_ps(new_right_y, new_right_y)), _mm_mul_ps(new_right_z, new_right_z)));
+			right_x = select(follow, _mm_mul_ps(new_right_x, inv), right_x);
+			right_y = select(follow, _mm_mul_ps(new_right_y, inv), right_y);
+			right_z = select(follow, _mm_mul_ps(new_right_z, inv), right_z);
+		}
 
-	right = at % LLVector3(0.f, 0.f, 1.f);
-	right.normalize();
-	up = right % at;
-	up.normalize();
+		const __m128 half_x = _mm_mul_ps(half, _mm_set_ps(r[3].mScale.mV[VX], r[2].mScale.mV[VX], r[1].mScale.mV[VX], r[0].mScale.mV[VX]));
+		const __m128 half_y = _mm_mul_ps(half, _mm_set_ps(r[3].mScale.mV[VY], r[2].mScale.mV[VY], r[1].mScale.mV[VY], r[0].mScale.mV[VY]));
+		_mm_storeu_ps(axes[0], _mm_mul_ps(right_x, half_x));
+		_mm_storeu_ps(axes[1], _mm_mul_ps(right_y, half_x));
+		_mm_storeu_ps(axes[2], _mm_mul_ps(right_z, half_x));
+		_mm_storeu_ps(axes[3], _mm_mul_ps(up_x, half_y));
+		_mm_storeu_ps(axes[4], _mm_mul_ps(up_y, half_y));
+		_mm_storeu_ps(axes[5], _mm_mul_ps(up_z, half_y));
 
-	if (part.mFlags & LLPartData::LL_PART_FOLLOW_VELOCITY_MASK)
+		for (S32 k = 0; k < 4; k++)
+		{
+			right.setVec(axes[0][k], axes[1][k], axes[2][k]);
+			up.setVec(axes[3][k], axes[4][k], axes[5][k]);
+			write_quad(r[k], right, up, normal, index_offset + (i + k) * 4,
+					   verticesp, normalsp, texcoordsp, colorsp, indicesp);
+		}
+	}
+#endif
+
+	for (; i < count; i++)
 	{
-		LLVector3 normvel = part.mVelocity;
-		normvel.normalize();
-		LLVector2 up_fracs;
-		up_fracs.mV[0] = normvel*right;
-		up_fracs.mV[1] = normvel*up;
-		up_fracs.normalize();
-		LLVector3 new_up;
-		LLVector3 new_right;
-		new_up = up_fracs.mV[0] * right + up_fracs.mV[1]*up;
-		new_right = up_fracs.mV[1] * right - up_fracs.mV[0]*up;
-		up = new_up;
-		right = new_right;
-		up.normalize();
-		right.normalize();
+		get_quad_axes(records[i], camera_agent, right, up);
+		write_quad(records[i], right, up, normal, index_offset + i * 4,
+				   verticesp, normalsp, texcoordsp, colorsp, indicesp);
 	}
+}
 
-	right *= 0.5f*part.mScale.mV[0];
-	up *= 0.5f*part.mScale.mV[1];
+//static
+BOOL LLVOPartGroup::useInstancing()
+{
+	static LLCachedControl<BOOL> instanced_particles("RenderInstancedParticles", TRUE);
+	return instanced_particles
+		&& gGLManager.mHasInstancedArrays
+		&& gParticleFullbrightWaterProgram.mProgramObject
+		&& gPipeline.canUseWindLightShadersOnObjects()
+		&& !LLPipeline::sRenderDeferred;
+}
 
+//static
+void LLVOPartGroup::pushInstances(LLDrawInfo& params, LLGLSLShader* shader)
+{
+	if (sCornerBuffer.isNull())
+	{
+		// in the order getGeometry() writes them, drawn as a strip
+		sCornerBuffer = new LLVertexBuffer(LLVertexBuffer::MAP_VERTEX, GL_STATIC_DRAW_ARB);
+		sCornerBuffer->allocateBuffer(4, 0, true);
+		LLStrider<LLVector3> cornersp;
+		sCornerBuffer->getVertexStrider(cornersp);
+		*cornersp++ = LLVector3(-1.f, 1.f, 0.f);
+		*cornersp++ = LLVector3(-1.f, -1.f, 0.f);
+		*cornersp++ = LLVector3(1.f, 1.f, 0.f);
+		*cornersp++ = LLVector3(1.f, -1.f, 0.f);
+		sCornerBuffer->setBuffer(0);
+	}
 
-	LLVector3 normal = -LLViewerCamera::getInstance()->getXAxis();
-		
-	*verticesp++ = part_pos_agent + up - right;
-	*verticesp++ = part_pos_agent - up - right;
-	*verticesp++ = part_pos_agent + up + right;
-	*verticesp++ = part_pos_agent - up + right;
-
-	*colorsp++ = part.mColor;
-	*colorsp++ = part.mColor;
-	*colorsp++ = part.mColor;
-	*colorsp++ = part.mColor;
-
-	*texcoordsp++ = LLVector2(0.f, 1.f);
-	*texcoordsp++ = LLVector2(0.f, 0.f);
-	*texcoordsp++ = LLVector2(1.f, 1.f);
-	*texcoordsp++ = LLVector2(1.f, 0.f);
-
-	*normalsp++   = normal;
-	*normalsp++   = normal;
-	*normalsp++   = normal;
-	*normalsp++   = normal;
-
-	*indicesp++ = vert_offset + 0;
-	*indicesp++ = vert_offset + 1;
-	*indicesp++ = vert_offset + 2;
-
-	*indicesp++ = vert_offset + 1;
-	*indicesp++ = vert_offset + 3;
-	*indicesp++ = vert_offset + 2;
+	const GLint attribs[] =
+	{
+		shader->mAttribute[LLViewerShaderMgr::PARTICLE_CENTER],
+		shader->mAttribute[LLViewerShaderMgr::PARTICLE_VELOCITY],
+		shader->mAttribute[LLViewerShaderMgr::PARTICLE_SCALE],
+		shader->mAttribute[LLViewerShaderMgr::PARTICLE_COLOR]
+	};
+	const S32 count = LL_ARRAY_SIZE(attribs);
+
+	// The attribute pointers are taken from the buffer bound when they are
+	// set, so the records go first and the corners replace them for the
+	// vertex array.
+	LLVertexBuffer* buffer = params.mVertexBuffer;
+	buffer->setBuffer(0);
+	const S32 stride = buffer->getStride();
+	U8* base = buffer->getVerticesPointer() + params.mStart * stride;
+	glVertexAttribPointerARB(attribs[0], 3, GL_FLOAT, GL_FALSE, stride, base + buffer->getOffset(LLVertexBuffer::TYPE_VERTEX));
+	glVertexAttribPointerARB(attribs[1], 3, GL_FLOAT, GL_FALSE, stride, base + buffer->getOffset(LLVertexBuffer::TYPE_NORMAL));
+	glVertexAttribPointerARB(attribs[2], 2, GL_FLOAT, GL_FALSE, stride, base + buffer->getOffset(LLVertexBuffer::TYPE_TEXCOORD0));
+	glVertexAttribPointerARB(attribs[3], 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, base + buffer->getOffset(LLVertexBuffer::TYPE_COLOR));
+	for (S32 i = 0; i < count; i++)
+	{
+		glEnableVertexAttribArrayARB(attribs[i]);
+		ll_glVertexAttribDivisorARB(attribs[i], 1);
+	}
+
+	sCornerBuffer->setBuffer(LLVertexBuffer::MAP_VERTEX);
+	shader->uniform3fv(LLViewerShaderMgr::PARTICLE_CAMERA, 1, gAgent.getCameraPositionAgent().mV);
+
+	stop_glerror();
+	ll_glDrawArraysInstancedARB(GL_TRIANGLE_STRIP, 0, 4, params.mCount);
+	stop_glerror();
+
+	for (S32 i = 0; i < count; i++)
+	{
+		ll_glVertexAttribDivisorARB(attribs[i], 0);
+		glDisableVertexAttribArrayARB(attribs[i]);
+	}
+}
+
+//static
+void LLVOPartGroup::resetVertexBuffers()
+{
+	sCornerBuffer = NULL;
 }
 
 U32 LLVOPartGroup::getPartitionType() const
@@ -360,6 +588,8 @@ LLParticlePartition::LLParticlePartition()
 	mBufferUsage = GL_DYNAMIC_DRAW_ARB;
 	mSlopRatio = 0.f;
 	mLODPeriod = 1;
+	mUseRecords = TRUE;
+	mAllowInstancing = TRUE;
 }
 
 LLHUDParticlePartition::LLHUDParticlePartition() :
@@ -367,6 +597,8 @@ LLHUDParticlePartition::LLHUDParticlePartition() :
 {
 	mDrawableType = LLPipeline::RENDER_TYPE_HUD_PARTICLES;
 	mPartitionType = LLViewerRegion::PARTITION_HUD_PARTICLE;
+	// HUD particles face their own camera, they are always expanded on the CPU
+	mAllowInstancing = FALSE;
 }
 
 void LLParticlePartition::addGeometryCount(LLSpatialGroup* group, U32& vertex_count, U32& index_count)
@@ -375,6 +607,9 @@ void LLParticlePartition::addGeometryCount(LLSpatialGroup* group, U32& vertex_co
 
 	mFaceList.clear();
 
+	// one vertex per particle and no indices when drawn instanced
+	mIndexedGeometry = !(mUseRecords && mAllowInstancing && LLVOPartGroup::useInstancing());
+
 	for (LLSpatialGroup::element_iter i = group->getData().begin(); i != group->getData().end(); ++i)
 	{
 		LLDrawable* drawablep = *i;
@@ -408,8 +643,15 @@ void LLParticlePartition::addGeometryCount(LLSpatialGroup* group, U32& vertex_co
 			obj->mDepth += facep->mDistance;
 			
 			mFaceList.push_back(facep);
-			vertex_count += facep->getGeomCount();
-			index_count += facep->getIndicesCount();
+			if (mIndexedGeometry)
+			{
+				vertex_count += facep->getGeomCount();
+				index_count += facep->getIndicesCount();
+			}
+			else
+			{
+				vertex_count++;
+			}
 		}
 		
 		obj->mDepth /= count;
@@ -423,6 +665,12 @@ void LLParticlePartition::getGeometry(LLSpatialGroup* group)
 					LLFastTimer::FTM_REBUILD_GRASS_VB :
 					LLFastTimer::FTM_REBUILD_PARTICLE_VB);
 
+	if (mUseRecords)
+	{
+		getRecordGeometry(group);
+		return;
+	}
+
 	std::sort(mFaceList.begin(), mFaceList.end(), LLFace::CompareDistanceGreater());
 
 	U32 index_count = 0;
@@ -495,6 +743,112 @@ void LLParticlePartition::getGeometry(LLSpatialGroup* group)
 	mFaceList.clear();
 }
 
+void LLParticlePartition::getRecordGeometry(LLSpatialGroup* group)
+{
+	std::sort(mFaceList.begin(), mFaceList.end(), LLFace::CompareDistanceGreater());
+
+	group->clearDrawMap();
+
+	LLVertexBuffer* buffer = group->mVertexBuffer;
+
+	LLStrider<U16> indicesp;
+	LLStrider<LLVector3> verticesp;
+	LLStrider<LLVector3> normalsp;
+	LLStrider<LLVector2> texcoordsp;
+	LLStrider<LLColor4U> colorsp;
+
+	buffer->getVertexStrider(verticesp);
+	buffer->getNormalStrider(normalsp);
+	buffer->getColorStrider(colorsp);
+	buffer->getTexCoord0Strider(texcoordsp);
+
+	mRecords.resize(mFaceList.size());
+	for (U32 i = 0; i < mFaceList.size(); ++i)
+	{
+		LLFace* facep = mFaceList[i];
+		LLVOPartGroup* object = (LLVOPartGroup*) facep->getViewerObject();
+		if (!object->getRecord(facep->getTEOffset(), mRecords[i]))
+		{ // keeps the quad, as getGeometry() used to, but makes it empty
+			mRecords[i] = LLParticleRecord();
+		}
+	}
+
+	const U32 geom_count = mIndexedGeometry ? 4 : 1;
+	const U32 indices_count = mIndexedGeometry ? 6 : 0;
+	if (!mRecords.empty())
+	{
+		if (mIndexedGeometry)
+		{
+			buffer->getIndexStrider(indicesp);
+			LLVector3 camera_agent = ((LLVOPartGroup*) mFaceList[0]->getViewerObject())->getCameraPosition();
+			LLVOPartGroup::expandRecords(&mRecords[0], mRecords.size(), camera_agent, 0,
+										 verticesp, normalsp, texcoordsp, colorsp, indicesp);
+		}
+		else
+		{
+			for (U32 i = 0; i < mRecords.size(); ++i)
+			{
+				const LLParticleRecord& record = mRecords[i];
+				*verticesp++ = record.mCenter;
+				*normalsp++ = record.mVelocity;
+				*texcoordsp++ = record.mScale;
+				*colorsp++ = record.mColor;
+			}
+		}
+	}
+	gPipeline.mParticleVertexBytes += mRecords.size() * (geom_count * buffer->getStride() + indices_count * sizeof(U16));
+
+	LLSpatialGroup::drawmap_elem_t& draw_vec = group->mDrawMap[mRenderPass];	
+
+	U32 index_count = 0;
+	U32 vertex_count = 0;
+	for (std::vector<LLFace*>::iterator i = mFaceList.begin(); i != mFaceList.end(); ++i)
+	{
+		LLFace* facep = *i;
+		facep->setGeomIndex(vertex_count);
+		facep->setIndicesIndex(index_count);
+		facep->mVertexBuffer = buffer;
+		facep->setPoolType(LLDrawPool::POOL_ALPHA);
+
+		S32 idx = draw_vec.size()-1;
+
+		BOOL fullbright = facep->isState(LLFace::FULLBRIGHT);
+		F32 vsize = facep->getVirtualSize();
+
+		if (idx >= 0 && draw_vec[idx]->mEnd == vertex_count-1 &&
+			draw_vec[idx]->mTexture == facep->getTexture() &&
+			(U16) (draw_vec[idx]->mEnd - draw_vec[idx]->mStart + geom_count) <= (U32) gGLManager.mGLMaxVertexRange &&
+			draw_vec[idx]->mEnd - draw_vec[idx]->mStart + geom_count < 4096 &&
+			draw_vec[idx]->mFullbright == fullbright)
+		{
+			// instanced draws count particles, the others indices
+			draw_vec[idx]->mCount += mIndexedGeometry ? indices_count : 1;
+			draw_vec[idx]->mEnd += geom_count;
+			draw_vec[idx]->mVSize = llmax(draw_vec[idx]->mVSize, vsize);
+		}
+		else
+		{
+			U32 start = vertex_count;
+			U32 end = start + geom_count-1;
+			U32 count = mIndexedGeometry ? indices_count : 1;
+			LLDrawInfo* info = new LLDrawInfo(start, end, count, index_count, facep->getTexture(), buffer,
+											  fullbright, 0, !mIndexedGeometry);
+			info->mExtents[0] = group->mObjectExtents[0];
+			info->mExtents[1] = group->mObjectExtents[1];
+			info->mVSize = vsize;
+			draw_vec.push_back(info);
+			//for alpha sorting
+			facep->setDrawInfo(info);
+		}
+
+		vertex_count += geom_count;
+		index_count += indices_count;
+	}
+
+	buffer->setBuffer(0);
+	mFaceList.clear();
+}
+
 F32 LLParticlePartition::calcPixelArea(LLSpatialGroup* group, LLCamera& camera)
 {
 	return 1024.f;
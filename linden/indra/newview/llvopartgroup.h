@@ -34,12 +34,30 @@
 #define LL_LLVOPARTGROUP_H
 
 #include "llviewerobject.h"
+#include "v2math.h"
 #include "v3math.h"
 #include "v3color.h"
+#include "v4coloru.h"
 #include "llframetimer.h"
 
+class LLDrawInfo;
+class LLGLSLShader;
 class LLViewerPartGroup;
 
+// What a particle's quad is built from.  Uploaded as is, one vertex of
+// LLVOPartGroup::VERTEX_DATA_MASK per particle, when the particle shaders
+// expand the quads; otherwise expanded into four vertices on the CPU.
+struct LLParticleRecord
+{
+	// An empty quad: zero sized and fully transparent.
+	LLParticleRecord() : mColor(0, 0, 0, 0) {}
+
+	LLVector3	mCenter;	// agent space
+	LLVector3	mVelocity;	// zero unless the particle follows its velocity
+	LLVector2	mScale;
+	LLColor4U	mColor;
+};
+
 class LLVOPartGroup : public LLAlphaObject
 {
 public:
@@ -72,18 +90,40 @@ public:
 								LLStrider<LLColor4U>& colorsp, 
 								LLStrider<U16>& indicesp);
 
+	// Returns FALSE if there is no such particle
+	BOOL getRecord(S32 idx, LLParticleRecord& record);
+
 	void updateFaceSize(S32 idx) { }
 	F32 getPartSize(S32 idx);
 	void setViewerPartGroup(LLViewerPartGroup *part_groupp)		{ mViewerPartGroupp = part_groupp; }
 	LLViewerPartGroup* getViewerPartGroup()	{ return mViewerPartGroupp; }
 
+	virtual LLVector3 getCameraPosition() const;
+
+	// TRUE if world particles should be uploaded as records and drawn
+	// instanced (RenderInstancedParticles)
+	static BOOL useInstancing();
+	// Draws the records of a particle draw info as camera facing quads,
+	// with the particle shader already bound.
+	static void pushInstances(LLDrawInfo& params, LLGLSLShader* shader);
+	// Writes four vertices and six indices per record, starting at vertex
+	// index_offset.
+	static void expandRecords(const LLParticleRecord* records, S32 count,
+							  const LLVector3& camera_agent, U16 index_offset,
+							  LLStrider<LLVector3>& verticesp,
+							  LLStrider<LLVector3>& normalsp,
+							  LLStrider<LLVector2>& texcoordsp,
+							  LLStrider<LLColor4U>& colorsp,
+							  LLStrider<U16>& indicesp);
+	// Releases the corner buffer instances are drawn from
+	static void resetVertexBuffers();
+
 protected:
 	~LLVOPartGroup();
 
 	LLViewerPartGroup *mViewerPartGroupp;
 
-	virtual LLVector3 getCameraPosition() const;
-
+	static LLPointer<LLVertexBuffer> sCornerBuffer;
 };
 
 
@@ -65,6 +65,9 @@ static const S32 NUM_TILES_X = 8;
 static const S32 NUM_TILES_Y = 4;
 static const S32 NUM_TILES = NUM_TILES_X * NUM_TILES_Y;
 
+// Below this the sky textures show the fog color instead of the WindLight sky
+static const F32 HORIZON_DIR_Z = -0.02f;
+
 // Heavenly body constants
 static const F32 SUN_DISK_RADIUS	= 0.5f;
 static const F32 MOON_DISK_RADIUS	= SUN_DISK_RADIUS * 0.9f;
@@ -308,6 +311,63 @@ void LLSkyTex::bindTexture(BOOL curr)
 
 F32	LLHeavenBody::sInterpVal = 0;
 
+/***************************************
+		SkyColorTable
+***************************************/
+
+LLSkyColorTable::LLSkyColorTable()
+:	mColors(SIZE),
+	mSunAxis(1.f, 0.f)
+{
+}
+
+void LLSkyColorTable::setSunAxis(const LLVector2& axis)
+{
+	F32 length = axis.length();
+	// with the sun overhead every azimuth is the same
+	mSunAxis = length > F_APPROXIMATELY_ZERO ? axis / length : LLVector2(1.f, 0.f);
+}
+
+LLVector3 LLSkyColorTable::getEntryDirection(S32 idx) const
+{
+	// elevations go by the square of the index, azimuths by the sine of
+	// half the angle from the sun, as lookup() indexes them
+	F32 s = (F32)(idx / AZIMUTHS) / (ELEVATIONS - 1);
+	F32 u = (F32)(idx % AZIMUTHS) / (AZIMUTHS - 1);
+	F32 z = HORIZON_DIR_Z + (1.f - HORIZON_DIR_Z) * s * s;
+	F32 r = sqrtf(llmax(0.f, 1.f - z * z));
+	F32 cos_az = 1.f - 2.f * u * u;
+	F32 sin_az = 2.f * u * sqrtf(llmax(0.f, 1.f - u * u));
+	return LLVector3(r * (cos_az * mSunAxis.mV[VX] - sin_az * mSunAxis.mV[VY]),
+					 r * (cos_az * mSunAxis.mV[VY] + sin_az * mSunAxis.mV[VX]),
+					 z);
+}
+
+LLColor3 LLSkyColorTable::lookup(const LLVector3& dir) const
+{
+	F32 s = sqrtf(llclamp((dir.mV[VZ] - HORIZON_DIR_Z) / (1.f - HORIZON_DIR_Z), 0.f, 1.f)) * (ELEVATIONS - 1);
+
+	F32 horizontal = sqrtf(dir.mV[VX] * dir.mV[VX] + dir.mV[VY] * dir.mV[VY]);
+	F32 cos_az = horizontal > F_APPROXIMATELY_ZERO ?
+		(dir.mV[VX] * mSunAxis.mV[VX] + dir.mV[VY] * mSunAxis.mV[VY]) / horizontal : 1.f;
+	F32 u = sqrtf(llclamp((1.f - cos_az) * 0.5f, 0.f, 1.f)) * (AZIMUTHS - 1);
+
+	S32 i = llmin((S32)s, ELEVATIONS - 2);
+	S32 j = llmin((S32)u, AZIMUTHS - 2);
+	F32 fs = s - i;
+	F32 fu = u - j;
+
+	const LLColor3* row = &mColors[i * AZIMUTHS + j];
+	LLColor3 low = row[0] + (row[1] - row[0]) * fu;
+	row += AZIMUTHS;
+	LLColor3 high = row[0] + (row[1] - row[0]) * fu;
+	return low + (high - low) * fs;
+}
+
+/***************************************
+		Sky
+***************************************/
+
 S32 LLVOSky::sResolution = LLSkyTex::getResolution();
 S32 LLVOSky::sTileResX = sResolution/NUM_TILES_X;
 S32 LLVOSky::sTileResY = sResolution/NUM_TILES_Y;
@@ -352,6 +412,10 @@ LLVOSky::LLVOSky(const LLUUID &id, const LLPCode pcode, LLViewerRegion *regionp)
 	mbCanSelect = FALSE;
 	mUpdateTimer.reset();
 
+	mSkyColorTable = 0;
+	mSkyColorTableBuilt = 0;
+	mSkyColorTableValid = FALSE;
+
 	for (S32 i = 0; i < 6; i++)
 	{
 		mSkyTex[i].init();
@@ -414,6 +478,9 @@ void LLVOSky::init()
 
 	calcAtmospherics();
 
+	mSkyColorTableBuilt = 0;
+	buildSkyColorTable(LLSkyColorTable::SIZE);
+
 	// Initialize the cached normalized direction vectors
 	for (S32 side = 0; side < 6; ++side)
 	{
@@ -543,6 +610,18 @@ void LLVOSky::initSkyTextureDirs(const S32 side, const S32 tile)
 	}
 }
 
+// The environment map is a desaturated sky, so that shiny shows up at
+// night as well.
+static LLColor3 shinySkyColor(const LLColor3& color)
+{
+	const F32 saturation = 0.3f;
+	F32 brightness = color.brightness();
+	LLColor3 greyscale(brightness, brightness, brightness);
+	LLColor3 sky_color = color * saturation + greyscale * (1.0f - saturation);
+	sky_color *= (0.5f + 0.5f * brightness);
+	return sky_color;
+}
+
 void LLVOSky::createSkyTexture(const S32 side, const S32 tile)
 {
 	S32 tile_x = tile % NUM_TILES_X;
@@ -551,17 +630,62 @@ void LLVOSky::createSkyTexture(const S32 side, const S32 tile)
 	S32 tile_x_pos = tile_x * sTileResX;
 	S32 tile_y_pos = tile_y * sTileResY;
 
+	const LLSkyColorTable* table = mSkyColorTableValid ? &mSkyColorTables[mSkyColorTable] : NULL;
+
 	S32 x, y;
 	for (y = tile_y_pos; y < (tile_y_pos + sTileResY); ++y)
 	{
 		for (x = tile_x_pos; x < (tile_x_pos + sTileResX); ++x)
 		{
-			mSkyTex[side].setPixel(calcSkyColorInDir(mSkyTex[side].getDir(x, y)), x, y);
-			mShinyTex[side].setPixel(calcSkyColorInDir(mSkyTex[side].getDir(x, y), true), x, y);
+			const LLVector3& dir = mSkyTex[side].getDir(x, y);
+			if (table && dir.mV[VZ] >= HORIZON_DIR_Z)
+			{
+				LLColor3 sky_color = table->lookup(dir);
+				mSkyTex[side].setPixel(LLColor4(sky_color, 0.f), x, y);
+				mShinyTex[side].setPixel(LLColor4(shinySkyColor(sky_color), 0.f), x, y);
+			}
+			else
+			{
+				mSkyTex[side].setPixel(calcSkyColorInDir(dir), x, y);
+				mShinyTex[side].setPixel(calcSkyColorInDir(dir, true), x, y);
+			}
 		}
 	}
 }
 
+void LLVOSky::buildSkyColorTable(S32 count)
+{
+	static LLCachedControl<BOOL> use_table("SkyUseColorTable", TRUE);
+	if (!use_table)
+	{
+		mSkyColorTableValid = FALSE;
+		mSkyColorTableBuilt = 0;
+		return;
+	}
+
+	LLSkyColorTable& table = mSkyColorTables[1 - mSkyColorTable];
+	if (mSkyColorTableBuilt == 0)
+	{
+		// calcSkyColorWLVert() measures the glow from Pn * lightnorm, and Pn
+		// is dir in GL axes negated
+		table.setSunAxis(LLVector2(-lightnorm.mV[2], -lightnorm.mV[0]));
+	}
+
+	S32 end = llmin(mSkyColorTableBuilt + count, (S32)LLSkyColorTable::SIZE);
+	for (S32 i = mSkyColorTableBuilt; i < end; ++i)
+	{
+		table.setEntry(i, calcSkyColorWL(table.getEntryDirection(i)));
+	}
+	mSkyColorTableBuilt = end;
+
+	if (mSkyColorTableBuilt == LLSkyColorTable::SIZE)
+	{
+		mSkyColorTable = 1 - mSkyColorTable;
+		mSkyColorTableBuilt = 0;
+		mSkyColorTableValid = TRUE;
+	}
+}
+
 static inline LLColor3 componentDiv(LLColor3 const &left, LLColor3 const & right)
 {
 	return LLColor3(left.mV[0]/right.mV[0],
@@ -681,7 +805,7 @@ void LLVOSky::initAtmospherics(void)
 LLColor4 LLVOSky::calcSkyColorInDir(const LLVector3 &dir, bool isShiny)
 {
 	F32 saturation = 0.3f;
-	if (dir.mV[VZ] < -0.02f)
+	if (dir.mV[VZ] < HORIZON_DIR_Z)
 	{
 		LLColor4 col = LLColor4(llmax(mFogColor[0],0.2f), llmax(mFogColor[1],0.2f), llmax(mFogColor[2],0.22f),0.f);
 		if (isShiny)
@@ -713,6 +837,16 @@ LLColor4 LLVOSky::calcSkyColorInDir(const LLVector3 &dir, bool isShiny)
 		return col;
 	}
 
+	LLColor3 sky_color = calcSkyColorWL(dir);
+	if (isShiny)
+	{
+		sky_color = shinySkyColor(sky_color);
+	}
+	return LLColor4(sky_color, 0.0f);
+}
+
+LLColor3 LLVOSky::calcSkyColorWL(const LLVector3 &dir)
+{
 	// undo OGL_TO_CFR_ROTATION and negate vertical direction.
 	LLVector3 Pn = LLVector3(-dir[1] , -dir[2], -dir[0]);
 
@@ -727,16 +861,8 @@ LLColor4 LLVOSky::calcSkyColorInDir(const LLVector3 &dir, bool isShiny)
 	calcSkyColorWLVert(Pn, vary_HazeColor, vary_CloudColorSun, vary_CloudColorAmbient,
 						vary_CloudDensity, vary_HorizontalProjection);
 	
-	LLColor3 sky_color =  calcSkyColorWLFrag(Pn, vary_HazeColor, vary_CloudColorSun, vary_CloudColorAmbient, 
-								vary_CloudDensity, vary_HorizontalProjection);
-	if (isShiny)
-	{
-		F32 brightness = sky_color.brightness();
-		LLColor3 greyscale = smear(brightness);
-		sky_color = sky_color * saturation + greyscale * (1.0f - saturation);
-		sky_color *= (0.5f + 0.5f * brightness);
-	}
-	return LLColor4(sky_color, 0.0f);
+	return calcSkyColorWLFrag(Pn, vary_HazeColor, vary_CloudColorSun, vary_CloudColorAmbient, 
+							  vary_CloudDensity, vary_HorizontalProjection);
 }
 
 // turn on floating point precision
@@ -1116,6 +1242,8 @@ BOOL LLVOSky::updateSky()
                     if (mForceUpdate)
 					{
 						updateFog(LLViewerCamera::getInstance()->getFar());
+						mSkyColorTableBuilt = 0;
+						buildSkyColorTable(LLSkyColorTable::SIZE);
 						for (int side = 0; side < 6; side++) 
 						{
 							for (int tile = 0; tile < NUM_TILES; tile++) 
@@ -1174,6 +1302,9 @@ BOOL LLVOSky::updateSky()
 		}
 		else
 		{
+			// the next table is built over this cycle, for the next one
+			buildSkyColorTable((LLSkyColorTable::SIZE + total_no_tiles - 1) / total_no_tiles);
+
 			const S32 side = frame / NUM_TILES;
 			const S32 tile = frame % NUM_TILES;
 			createSkyTexture(side, tile);
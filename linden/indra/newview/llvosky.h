@@ -39,6 +39,9 @@
 #include "llviewerimage.h"
 #include "llviewerobject.h"
 #include "llframetimer.h"
+#include "v2math.h"
+
+#include <vector>
 
 
 //////////////////////////////////
@@ -193,6 +196,37 @@ protected:
 	void createGLImage(BOOL curr=TRUE);
 };
 
+// Sky colors above the horizon by elevation and by azimuth from the sun,
+// which is all the WindLight sky color depends on.  The sky textures are
+// filled by looking texels up in it instead of evaluating the sky for each.
+class LLSkyColorTable
+{
+public:
+	enum
+	{
+		ELEVATIONS = 64,	// denser towards the horizon
+		AZIMUTHS = 64,		// denser towards the sun
+		SIZE = ELEVATIONS * AZIMUTHS
+	};
+
+	LLSkyColorTable();
+
+	// Horizontal direction to the sun in the sky texture frame, azimuths are
+	// measured from it.  Set before building the entries.
+	void setSunAxis(const LLVector2& axis);
+
+	// Direction whose color goes in entry idx
+	LLVector3 getEntryDirection(S32 idx) const;
+	void setEntry(S32 idx, const LLColor3& color)	{ mColors[idx] = color; }
+
+	// Bilinear, dir normalized and above the horizon
+	LLColor3 lookup(const LLVector3& dir) const;
+
+private:
+	std::vector<LLColor3> mColors;
+	LLVector2 mSunAxis;
+};
+
 /// TODO Move into the stars draw pool (and rename them appropriately).
 class LLHeavenBody
 {
@@ -501,6 +535,12 @@ public:
 	void createSkyTexture(const S32 side, const S32 tile);
 
 	LLColor4 calcSkyColorInDir(const LLVector3& dir, bool isShiny = false);
+	// Above the horizon, before the environment map desaturation
+	LLColor3 calcSkyColorWL(const LLVector3& dir);
+
+	// Builds up to count entries of the pending sky color table, it takes
+	// over from the current one once complete.
+	void buildSkyColorTable(S32 count);
 	
 	LLColor3 calcRadianceAtPoint(const LLVector3& pos) const
 	{
@@ -634,6 +674,11 @@ protected:
 
 	LLFrameTimer		mUpdateTimer;
 
+	LLSkyColorTable		mSkyColorTables[2];
+	S32					mSkyColorTable;				// the one textures are filled from
+	S32					mSkyColorTableBuilt;		// entries of the other one
+	BOOL				mSkyColorTableValid;
+
 public:
 	//by bao
 	//fake vertex buffer updating
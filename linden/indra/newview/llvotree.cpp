@@ -79,6 +79,9 @@ F32 LLVOTree::sTreeFactor = 1.f;
 LLVOTree::SpeciesMap LLVOTree::sSpeciesTable;
 S32 LLVOTree::sMaxTreeSpecies = 0;
 
+LLVOTree::buffer_map_t LLVOTree::sReferenceBuffers;
+S32 LLVOTree::sMeshBytes = 0;
+
 LLVOTree::SpeciesNames LLVOTree::sSpeciesNames;
 
 
@@ -89,6 +92,7 @@ LLVOTree::LLVOTree(const LLUUID &id, const LLPCode pcode, LLViewerRegion *region
 {
 	mSpecies = 0;
 	mFrameCount = 0;
+	mMeshBytes = 0;
 	mWind = mRegionp->mWind.getVelocity(getPositionRegion());
 	mTrunkLOD = 0;
 }
@@ -96,6 +100,8 @@ LLVOTree::LLVOTree(const LLUUID &id, const LLPCode pcode, LLViewerRegion *region
 
 LLVOTree::~LLVOTree()
 {
+	setMeshBytes(0);
+
 	if (mData)
 	{
 		delete[] mData;
@@ -516,346 +522,369 @@ LLDrawable* LLVOTree::createDrawable(LLPipeline *pipeline)
 }
 
 
-// Yes, I know this is bad.  I'll clean this up soon. - djs 04/02/02
-const S32 LEAF_INDICES = 24;
-const S32 LEAF_VERTICES = 16;
-
-BOOL LLVOTree::updateGeometry(LLDrawable *drawable)
+//static
+LLPointer<LLVertexBuffer> LLVOTree::createReferenceBuffer(U8 species)
 {
-	LLFastTimer ftm(LLFastTimer::FTM_UPDATE_TREE);
-
-	if (mReferenceBuffer.isNull() || mDrawable->getFace(0)->mVertexBuffer.isNull())
-	{
-		const F32 SRR3 = 0.577350269f; // sqrt(1/3)
-		const F32 SRR2 = 0.707106781f; // sqrt(1/2)
-		U32 i, j;
+	const F32 SRR3 = 0.577350269f; // sqrt(1/3)
+	const F32 SRR2 = 0.707106781f; // sqrt(1/2)
+	U32 i, j;
 
-		U32 slices = MAX_SLICES;
+	U32 slices = MAX_SLICES;
 
-		S32 max_indices = LEAF_INDICES;
-		S32 max_vertices = LEAF_VERTICES;
-		S32 lod;
+	S32 max_indices = LEAF_INDICES;
+	S32 max_vertices = LEAF_VERTICES;
+	S32 lod;
 
-		LLFace *face = drawable->getFace(0);
+	for (lod = 0; lod < 4; lod++)
+	{
+		slices = sLODSlices[lod];
+		sLODVertexOffset[lod] = max_vertices;
+		sLODVertexCount[lod] = slices*slices;
+		sLODIndexOffset[lod] = max_indices;
+		sLODIndexCount[lod] = (slices-1)*(slices-1)*6;
+		max_indices += sLODIndexCount[lod];
+		max_vertices += sLODVertexCount[lod];
+	}
+	static BOOL* sRenderAnimateTrees = rebind_llcontrol<BOOL>("RenderAnimateTrees", &gSavedSettings, true);
+	LLPointer<LLVertexBuffer> buffer = new LLVertexBuffer(LLDrawPoolTree::VERTEX_DATA_MASK, *sRenderAnimateTrees ? GL_STATIC_DRAW_ARB : 0);
+	buffer->allocateBuffer(max_vertices, max_indices, TRUE);
 
-		face->mCenterAgent = getPositionAgent();
-		face->mCenterLocal = face->mCenterAgent;
+	LLStrider<LLVector3> vertices;
+	LLStrider<LLVector3> normals;
+	LLStrider<LLVector2> tex_coords;
+	LLStrider<U16> indicesp;
 
-		for (lod = 0; lod < 4; lod++)
+	buffer->getVertexStrider(vertices);
+	buffer->getNormalStrider(normals);
+	buffer->getTexCoord0Strider(tex_coords);
+	buffer->getIndexStrider(indicesp);
+			
+	S32 vertex_count = 0;
+	S32 index_count = 0;
+	
+	// First leaf
+	*(normals++) =		LLVector3(-SRR2, -SRR2, 0.f);
+	*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_BOTTOM);
+	*(vertices++) =		LLVector3(-0.5f*LEAF_WIDTH, 0.f, 0.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(SRR3, -SRR3, SRR3);
+	*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_TOP);
+	*(vertices++) =		LLVector3(0.5f*LEAF_WIDTH, 0.f, 1.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(-SRR3, -SRR3, SRR3);
+	*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_TOP);
+	*(vertices++) =		LLVector3(-0.5f*LEAF_WIDTH, 0.f, 1.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(SRR2, -SRR2, 0.f);
+	*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_BOTTOM);
+	*(vertices++) =		LLVector3(0.5f*LEAF_WIDTH, 0.f, 0.f);
+	vertex_count++;
+
+
+	*(indicesp++) = 0;
+	index_count++;
+	*(indicesp++) = 1;
+	index_count++;
+	*(indicesp++) = 2;
+	index_count++;
+
+	*(indicesp++) = 0;
+	index_count++;
+	*(indicesp++) = 3;
+	index_count++;
+	*(indicesp++) = 1;
+	index_count++;
+
+	// Same leaf, inverse winding/normals
+	*(normals++) =		LLVector3(-SRR2, SRR2, 0.f);
+	*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_BOTTOM);
+	*(vertices++) =		LLVector3(-0.5f*LEAF_WIDTH, 0.f, 0.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(SRR3, SRR3, SRR3);
+	*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_TOP);
+	*(vertices++) =		LLVector3(0.5f*LEAF_WIDTH, 0.f, 1.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(-SRR3, SRR3, SRR3);
+	*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_TOP);
+	*(vertices++) =		LLVector3(-0.5f*LEAF_WIDTH, 0.f, 1.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(SRR2, SRR2, 0.f);
+	*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_BOTTOM);
+	*(vertices++) =		LLVector3(0.5f*LEAF_WIDTH, 0.f, 0.f);
+	vertex_count++;
+
+	*(indicesp++) = 4;
+	index_count++;
+	*(indicesp++) = 6;
+	index_count++;
+	*(indicesp++) = 5;
+	index_count++;
+
+	*(indicesp++) = 4;
+	index_count++;
+	*(indicesp++) = 5;
+	index_count++;
+	*(indicesp++) = 7;
+	index_count++;
+
+
+	// next leaf
+	*(normals++) =		LLVector3(SRR2, -SRR2, 0.f);
+	*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_BOTTOM);
+	*(vertices++) =		LLVector3(0.f, -0.5f*LEAF_WIDTH, 0.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(SRR3, SRR3, SRR3);
+	*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_TOP);
+	*(vertices++) =		LLVector3(0.f, 0.5f*LEAF_WIDTH, 1.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(SRR3, -SRR3, SRR3);
+	*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_TOP);
+	*(vertices++) =		LLVector3(0.f, -0.5f*LEAF_WIDTH, 1.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(SRR2, SRR2, 0.f);
+	*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_BOTTOM);
+	*(vertices++) =		LLVector3(0.f, 0.5f*LEAF_WIDTH, 0.f);
+	vertex_count++;
+
+	*(indicesp++) = 8;
+	index_count++;
+	*(indicesp++) = 9;
+	index_count++;
+	*(indicesp++) = 10;
+	index_count++;
+
+	*(indicesp++) = 8;
+	index_count++;
+	*(indicesp++) = 11;
+	index_count++;
+	*(indicesp++) = 9;
+	index_count++;
+
+
+	// other side of same leaf
+	*(normals++) =		LLVector3(-SRR2, -SRR2, 0.f);
+	*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_BOTTOM);
+	*(vertices++) =		LLVector3(0.f, -0.5f*LEAF_WIDTH, 0.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(-SRR3, SRR3, SRR3);
+	*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_TOP);
+	*(vertices++) =		LLVector3(0.f, 0.5f*LEAF_WIDTH, 1.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(-SRR3, -SRR3, SRR3);
+	*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_TOP);
+	*(vertices++) =		LLVector3(0.f, -0.5f*LEAF_WIDTH, 1.f);
+	vertex_count++;
+
+	*(normals++) =		LLVector3(-SRR2, SRR2, 0.f);
+	*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_BOTTOM);
+	*(vertices++) =		LLVector3(0.f, 0.5f*LEAF_WIDTH, 0.f);
+	vertex_count++;
+
+	*(indicesp++) = 12;
+	index_count++;
+	*(indicesp++) = 14;
+	index_count++;
+	*(indicesp++) = 13;
+	index_count++;
+
+	*(indicesp++) = 12;
+	index_count++;
+	*(indicesp++) = 13;
+	index_count++;
+	*(indicesp++) = 15;
+	index_count++;
+
+	// Generate geometry for the cylinders
+
+	// Different LOD's
+
+	// Generate the vertices
+	// Generate the indices
+
+	for (lod = 0; lod < 4; lod++)
+	{
+		slices = sLODSlices[lod];
+		F32 base_radius = 0.65f;
+		F32 top_radius = base_radius * sSpeciesTable[species]->mTaper;
+		//llinfos << "Species " << ((U32) species) << ", taper = " << sSpeciesTable[species].mTaper << llendl;
+		//llinfos << "Droop " << mDroop << ", branchlength: " << mBranchLength << llendl;
+		F32 angle = 0;
+		F32 angle_inc = 360.f/(slices-1);
+		F32 z = 0.f;
+		F32 z_inc = 1.f;
+		if (slices > 3)
 		{
-			slices = sLODSlices[lod];
-			sLODVertexOffset[lod] = max_vertices;
-			sLODVertexCount[lod] = slices*slices;
-			sLODIndexOffset[lod] = max_indices;
-			sLODIndexCount[lod] = (slices-1)*(slices-1)*6;
-			max_indices += sLODIndexCount[lod];
-			max_vertices += sLODVertexCount[lod];
+			z_inc = 1.f/(slices - 3);
 		}
-		static BOOL* sRenderAnimateTrees = rebind_llcontrol<BOOL>("RenderAnimateTrees", &gSavedSettings, true);
-		mReferenceBuffer = new LLVertexBuffer(LLDrawPoolTree::VERTEX_DATA_MASK, *sRenderAnimateTrees ? GL_STATIC_DRAW_ARB : 0);
-		mReferenceBuffer->allocateBuffer(max_vertices, max_indices, TRUE);
-
-		LLStrider<LLVector3> vertices;
-		LLStrider<LLVector3> normals;
-		LLStrider<LLVector2> tex_coords;
-		LLStrider<U16> indicesp;
-
-		mReferenceBuffer->getVertexStrider(vertices);
-		mReferenceBuffer->getNormalStrider(normals);
-		mReferenceBuffer->getTexCoord0Strider(tex_coords);
-		mReferenceBuffer->getIndexStrider(indicesp);
-				
-		S32 vertex_count = 0;
-		S32 index_count = 0;
-		
-		// First leaf
-		*(normals++) =		LLVector3(-SRR2, -SRR2, 0.f);
-		*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_BOTTOM);
-		*(vertices++) =		LLVector3(-0.5f*LEAF_WIDTH, 0.f, 0.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(SRR3, -SRR3, SRR3);
-		*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_TOP);
-		*(vertices++) =		LLVector3(0.5f*LEAF_WIDTH, 0.f, 1.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(-SRR3, -SRR3, SRR3);
-		*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_TOP);
-		*(vertices++) =		LLVector3(-0.5f*LEAF_WIDTH, 0.f, 1.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(SRR2, -SRR2, 0.f);
-		*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_BOTTOM);
-		*(vertices++) =		LLVector3(0.5f*LEAF_WIDTH, 0.f, 0.f);
-		vertex_count++;
-
-
-		*(indicesp++) = 0;
-		index_count++;
-		*(indicesp++) = 1;
-		index_count++;
-		*(indicesp++) = 2;
-		index_count++;
-
-		*(indicesp++) = 0;
-		index_count++;
-		*(indicesp++) = 3;
-		index_count++;
-		*(indicesp++) = 1;
-		index_count++;
-
-		// Same leaf, inverse winding/normals
-		*(normals++) =		LLVector3(-SRR2, SRR2, 0.f);
-		*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_BOTTOM);
-		*(vertices++) =		LLVector3(-0.5f*LEAF_WIDTH, 0.f, 0.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(SRR3, SRR3, SRR3);
-		*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_TOP);
-		*(vertices++) =		LLVector3(0.5f*LEAF_WIDTH, 0.f, 1.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(-SRR3, SRR3, SRR3);
-		*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_TOP);
-		*(vertices++) =		LLVector3(-0.5f*LEAF_WIDTH, 0.f, 1.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(SRR2, SRR2, 0.f);
-		*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_BOTTOM);
-		*(vertices++) =		LLVector3(0.5f*LEAF_WIDTH, 0.f, 0.f);
-		vertex_count++;
-
-		*(indicesp++) = 4;
-		index_count++;
-		*(indicesp++) = 6;
-		index_count++;
-		*(indicesp++) = 5;
-		index_count++;
-
-		*(indicesp++) = 4;
-		index_count++;
-		*(indicesp++) = 5;
-		index_count++;
-		*(indicesp++) = 7;
-		index_count++;
-
-
-		// next leaf
-		*(normals++) =		LLVector3(SRR2, -SRR2, 0.f);
-		*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_BOTTOM);
-		*(vertices++) =		LLVector3(0.f, -0.5f*LEAF_WIDTH, 0.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(SRR3, SRR3, SRR3);
-		*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_TOP);
-		*(vertices++) =		LLVector3(0.f, 0.5f*LEAF_WIDTH, 1.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(SRR3, -SRR3, SRR3);
-		*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_TOP);
-		*(vertices++) =		LLVector3(0.f, -0.5f*LEAF_WIDTH, 1.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(SRR2, SRR2, 0.f);
-		*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_BOTTOM);
-		*(vertices++) =		LLVector3(0.f, 0.5f*LEAF_WIDTH, 0.f);
-		vertex_count++;
-
-		*(indicesp++) = 8;
-		index_count++;
-		*(indicesp++) = 9;
-		index_count++;
-		*(indicesp++) = 10;
-		index_count++;
-
-		*(indicesp++) = 8;
-		index_count++;
-		*(indicesp++) = 11;
-		index_count++;
-		*(indicesp++) = 9;
-		index_count++;
-
-
-		// other side of same leaf
-		*(normals++) =		LLVector3(-SRR2, -SRR2, 0.f);
-		*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_BOTTOM);
-		*(vertices++) =		LLVector3(0.f, -0.5f*LEAF_WIDTH, 0.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(-SRR3, SRR3, SRR3);
-		*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_TOP);
-		*(vertices++) =		LLVector3(0.f, 0.5f*LEAF_WIDTH, 1.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(-SRR3, -SRR3, SRR3);
-		*(tex_coords++) =	LLVector2(LEAF_LEFT, LEAF_TOP);
-		*(vertices++) =		LLVector3(0.f, -0.5f*LEAF_WIDTH, 1.f);
-		vertex_count++;
-
-		*(normals++) =		LLVector3(-SRR2, SRR2, 0.f);
-		*(tex_coords++) =	LLVector2(LEAF_RIGHT, LEAF_BOTTOM);
-		*(vertices++) =		LLVector3(0.f, 0.5f*LEAF_WIDTH, 0.f);
-		vertex_count++;
-
-		*(indicesp++) = 12;
-		index_count++;
-		*(indicesp++) = 14;
-		index_count++;
-		*(indicesp++) = 13;
-		index_count++;
-
-		*(indicesp++) = 12;
-		index_count++;
-		*(indicesp++) = 13;
-		index_count++;
-		*(indicesp++) = 15;
-		index_count++;
-
-		// Generate geometry for the cylinders
-
-		// Different LOD's
-
-		// Generate the vertices
-		// Generate the indices
-
-		for (lod = 0; lod < 4; lod++)
-		{
-			slices = sLODSlices[lod];
-			F32 base_radius = 0.65f;
-			F32 top_radius = base_radius * sSpeciesTable[mSpecies]->mTaper;
-			//llinfos << "Species " << ((U32) mSpecies) << ", taper = " << sSpeciesTable[mSpecies].mTaper << llendl;
-			//llinfos << "Droop " << mDroop << ", branchlength: " << mBranchLength << llendl;
-			F32 angle = 0;
-			F32 angle_inc = 360.f/(slices-1);
-			F32 z = 0.f;
-			F32 z_inc = 1.f;
-			if (slices > 3)
-			{
-				z_inc = 1.f/(slices - 3);
-			}
-			F32 radius = base_radius;
+		F32 radius = base_radius;
+
+		F32 x1,y1;
+		F32 noise_scale = sSpeciesTable[species]->mNoiseMag;
+		LLVector3 nvec;
 
-			F32 x1,y1;
-			F32 noise_scale = sSpeciesTable[mSpecies]->mNoiseMag;
-			LLVector3 nvec;
+		const F32 cap_nudge = 0.1f;			// Height to 'peak' the caps on top/bottom of branch
 
-			const F32 cap_nudge = 0.1f;			// Height to 'peak' the caps on top/bottom of branch
+		const S32 fractal_depth = 5;
+		F32 nvec_scale = 1.f * sSpeciesTable[species]->mNoiseScale;
+		F32 nvec_scalez = 4.f * sSpeciesTable[species]->mNoiseScale;
 
-			const S32 fractal_depth = 5;
-			F32 nvec_scale = 1.f * sSpeciesTable[mSpecies]->mNoiseScale;
-			F32 nvec_scalez = 4.f * sSpeciesTable[mSpecies]->mNoiseScale;
+		F32 tex_z_repeat = sSpeciesTable[species]->mRepeatTrunkZ;
 
-			F32 tex_z_repeat = sSpeciesTable[mSpecies]->mRepeatTrunkZ;
+		F32 start_radius;
+		F32 nangle = 0;
+		F32 height = 1.f;
+		F32 r0;
 
-			F32 start_radius;
-			F32 nangle = 0;
-			F32 height = 1.f;
-			F32 r0;
+		for (i = 0; i < slices; i++)
+		{
+			if (i == 0) 
+			{
+				z = - cap_nudge;
+				r0 = 0.0;
+			}
+			else if (i == (slices - 1))
+			{
+				z = 1.f + cap_nudge;//((i - 2) * z_inc) + cap_nudge;
+				r0 = 0.0;
+			}
+			else  
+			{
+				z = (i - 1) * z_inc;
+				r0 = base_radius + (top_radius - base_radius)*z;
+			}
 
-			for (i = 0; i < slices; i++)
+			for (j = 0; j < slices; j++)
 			{
-				if (i == 0) 
+				if (slices - 1 == j)
 				{
-					z = - cap_nudge;
-					r0 = 0.0;
+					angle = 0.f;
 				}
-				else if (i == (slices - 1))
+				else
 				{
-					z = 1.f + cap_nudge;//((i - 2) * z_inc) + cap_nudge;
-					r0 = 0.0;
+					angle =  j*angle_inc;
 				}
-				else  
+			
+				nangle = angle;
+				
+				x1 = cos(angle * DEG_TO_RAD);
+				y1 = sin(angle * DEG_TO_RAD);
+				LLVector2 tc;
+				// This isn't totally accurate.  Should compute based on slope as well.
+				start_radius = r0 * (1.f + 1.2f*fabs(z - 0.66f*height)/height);
+				nvec.set(	cos(nangle * DEG_TO_RAD)*start_radius*nvec_scale, 
+							sin(nangle * DEG_TO_RAD)*start_radius*nvec_scale, 
+							z*nvec_scalez); 
+				// First and last slice at 0 radius (to bring in top/bottom of structure)
+				radius = start_radius + turbulence3((F32*)&nvec.mV, (F32)fractal_depth)*noise_scale;
+
+				if (slices - 1 == j)
 				{
-					z = (i - 1) * z_inc;
-					r0 = base_radius + (top_radius - base_radius)*z;
+					// Not 0.5 for slight slop factor to avoid edges on leaves
+					tc = LLVector2(0.490f, (1.f - z/2.f)*tex_z_repeat);
 				}
-
-				for (j = 0; j < slices; j++)
+				else
 				{
-					if (slices - 1 == j)
-					{
-						angle = 0.f;
-					}
-					else
-					{
-						angle =  j*angle_inc;
-					}
-				
-					nangle = angle;
-					
-					x1 = cos(angle * DEG_TO_RAD);
-					y1 = sin(angle * DEG_TO_RAD);
-					LLVector2 tc;
-					// This isn't totally accurate.  Should compute based on slope as well.
-					start_radius = r0 * (1.f + 1.2f*fabs(z - 0.66f*height)/height);
-					nvec.set(	cos(nangle * DEG_TO_RAD)*start_radius*nvec_scale, 
-								sin(nangle * DEG_TO_RAD)*start_radius*nvec_scale, 
-								z*nvec_scalez); 
-					// First and last slice at 0 radius (to bring in top/bottom of structure)
-					radius = start_radius + turbulence3((F32*)&nvec.mV, (F32)fractal_depth)*noise_scale;
-
-					if (slices - 1 == j)
-					{
-						// Not 0.5 for slight slop factor to avoid edges on leaves
-						tc = LLVector2(0.490f, (1.f - z/2.f)*tex_z_repeat);
-					}
-					else
-					{
-						tc = LLVector2((angle/360.f)*0.5f, (1.f - z/2.f)*tex_z_repeat);
-					}
-
-					*(vertices++) =		LLVector3(x1*radius, y1*radius, z);
-					*(normals++) =		LLVector3(x1, y1, 0.f);
-					*(tex_coords++) = tc;
-					vertex_count++;
+					tc = LLVector2((angle/360.f)*0.5f, (1.f - z/2.f)*tex_z_repeat);
 				}
+
+				*(vertices++) =		LLVector3(x1*radius, y1*radius, z);
+				*(normals++) =		LLVector3(x1, y1, 0.f);
+				*(tex_coords++) = tc;
+				vertex_count++;
 			}
+		}
 
-			for (i = 0; i < (slices - 1); i++)
+		for (i = 0; i < (slices - 1); i++)
+		{
+			for (j = 0; j < (slices - 1); j++)
 			{
-				for (j = 0; j < (slices - 1); j++)
+				S32 x1_offset = j+1;
+				if ((j+1) == slices)
 				{
-					S32 x1_offset = j+1;
-					if ((j+1) == slices)
-					{
-						x1_offset = 0;
-					}
-					// Generate the matching quads
-					*(indicesp) = j + (i*slices) + sLODVertexOffset[lod];
-					llassert(*(indicesp) < (U32)max_vertices);
-					indicesp++;
-					index_count++;
-					*(indicesp) = x1_offset + ((i+1)*slices) + sLODVertexOffset[lod];
-					llassert(*(indicesp) < (U32)max_vertices);
-					indicesp++;
-					index_count++;
-					*(indicesp) = j + ((i+1)*slices) + sLODVertexOffset[lod];
-					llassert(*(indicesp) < (U32)max_vertices);
-					indicesp++;
-					index_count++;
-
-					*(indicesp) = j + (i*slices) + sLODVertexOffset[lod];
-					llassert(*(indicesp) < (U32)max_vertices);
-					indicesp++;
-					index_count++;
-					*(indicesp) = x1_offset + (i*slices) + sLODVertexOffset[lod];
-					llassert(*(indicesp) < (U32)max_vertices);
-					indicesp++;
-					index_count++;
-					*(indicesp) = x1_offset + ((i+1)*slices) + sLODVertexOffset[lod];
-					llassert(*(indicesp) < (U32)max_vertices);
-					indicesp++;
-					index_count++;
+					x1_offset = 0;
 				}
+				// Generate the matching quads
+				*(indicesp) = j + (i*slices) + sLODVertexOffset[lod];
+				llassert(*(indicesp) < (U32)max_vertices);
+				indicesp++;
+				index_count++;
+				*(indicesp) = x1_offset + ((i+1)*slices) + sLODVertexOffset[lod];
+				llassert(*(indicesp) < (U32)max_vertices);
+				indicesp++;
+				index_count++;
+				*(indicesp) = j + ((i+1)*slices) + sLODVertexOffset[lod];
+				llassert(*(indicesp) < (U32)max_vertices);
+				indicesp++;
+				index_count++;
+
+				*(indicesp) = j + (i*slices) + sLODVertexOffset[lod];
+				llassert(*(indicesp) < (U32)max_vertices);
+				indicesp++;
+				index_count++;
+				*(indicesp) = x1_offset + (i*slices) + sLODVertexOffset[lod];
+				llassert(*(indicesp) < (U32)max_vertices);
+				indicesp++;
+				index_count++;
+				*(indicesp) = x1_offset + ((i+1)*slices) + sLODVertexOffset[lod];
+				llassert(*(indicesp) < (U32)max_vertices);
+				indicesp++;
+				index_count++;
 			}
-			slices /= 2; 
 		}
+		slices /= 2; 
+	}
+
+	buffer->setBuffer(0);
+	llassert(vertex_count == max_vertices);
+	llassert(index_count == max_indices);
+
+	return buffer;
+}
+
+BOOL LLVOTree::updateGeometry(LLDrawable *drawable)
+{
+	LLFastTimer ftm(LLFastTimer::FTM_UPDATE_TREE);
+
+	if (mReferenceBuffer.isNull() || mDrawable->getFace(0)->mVertexBuffer.isNull())
+	{
+		LLFace *face = drawable->getFace(0);
 
-		mReferenceBuffer->setBuffer(0);
-		llassert(vertex_count == max_vertices);
-		llassert(index_count == max_indices);
+		face->mCenterAgent = getPositionAgent();
+		face->mCenterLocal = face->mCenterAgent;
+
+		if (useSharedMeshes())
+		{
+			// The reference mesh only depends on the species
+			LLPointer<LLVertexBuffer>& shared = sReferenceBuffers[mSpecies];
+			if (shared.isNull())
+			{
+				shared = createReferenceBuffer(mSpecies);
+				sMeshBytes += shared->getSize() + shared->getIndicesSize();
+			}
+			mReferenceBuffer = shared;
+		}
+		else
+		{
+			mReferenceBuffer = createReferenceBuffer(mSpecies);
+		}
 	}
 	static BOOL* sRenderAnimateTrees = rebind_llcontrol<BOOL>("RenderAnimateTrees", &gSavedSettings, true);
+	S32 mesh_bytes = 0;
+	if (!useSharedMeshes())
+	{
+		mesh_bytes += mReferenceBuffer->getSize() + mReferenceBuffer->getIndicesSize();
+	}
 	if (*sRenderAnimateTrees)
 	{
 		mDrawable->getFace(0)->mVertexBuffer = mReferenceBuffer;
@@ -864,12 +893,15 @@ BOOL LLVOTree::updateGeometry(LLDrawable *drawable)
 	{
 		//generate tree mesh
 		updateMesh();
+		LLVertexBuffer* buffer = mDrawable->getFace(0)->mVertexBuffer;
+		mesh_bytes += buffer->getSize() + buffer->getIndicesSize();
 	}
+	setMeshBytes(mesh_bytes);
 	
 	return TRUE;
 }
 
-void LLVOTree::updateMesh()
+void LLVOTree::getBaseMatrix(LLMatrix4& scale_mat) const
 {
 	LLMatrix4 matrix;
 	
@@ -895,12 +927,18 @@ void LLVOTree::updateMesh()
 	rot_mat *= trans_mat;
 
 	F32 radius = getScale().magVec()*0.05f;
-	LLMatrix4 scale_mat;
+	scale_mat.setIdentity();
 	scale_mat.mMatrix[0][0] = 
 		scale_mat.mMatrix[1][1] =
 		scale_mat.mMatrix[2][2] = radius;
 
 	scale_mat *= rot_mat;
+}
+
+void LLVOTree::updateMesh()
+{
+	LLMatrix4 scale_mat;
+	getBaseMatrix(scale_mat);
 
 //	const F32 THRESH_ANGLE_FOR_BILLBOARD = 15.f;
 //	const F32 BLEND_RANGE_FOR_BILLBOARD = 3.f;
@@ -1246,6 +1284,108 @@ U32 LLVOTree::drawBranchPipeline(LLMatrix4& matrix, U16* indicesp, S32 trunk_LOD
 	return ret;
 }
 
+void LLVOTree::appendInstances(std::vector<LLTreeInstance>* parts, const LLMatrix4& matrix, S32 trunk_LOD, S32 stop_level, U16 depth, U16 trunk_depth, F32 scale, F32 twist, F32 droop, F32 branches) const
+{
+	F32 length = ((trunk_depth || (scale == 1.f))? mTrunkLength:mBranchLength);
+	F32 aspect = ((trunk_depth || (scale == 1.f))? mTrunkAspect:mBranchAspect);
+	F32 constant_twist = 360.f/branches;
+
+	LLMatrix4 scale_mat;
+	S32 part = INSTANCE_LEAF;
+	F32 tex_offset = 0.f;
+
+	if (!LLPipeline::sReflectionRender && stop_level >= 0)
+	{
+		if (depth > stop_level)
+		{
+			// Recurse to create more branches
+			for (S32 i=0; i < (S32)branches; i++) 
+			{
+				LLMatrix4 trans_mat;
+				trans_mat.setTranslation(0,0,scale*length);
+				trans_mat *= matrix;
+
+				LLQuaternion rot = 
+					LLQuaternion(20.f*DEG_TO_RAD, LLVector4(0.f, 0.f, 1.f)) *
+					LLQuaternion(droop*DEG_TO_RAD, LLVector4(0.f, 1.f, 0.f)) *
+					LLQuaternion(((constant_twist + ((i%2==0)?twist:-twist))*i)*DEG_TO_RAD, LLVector4(0.f, 0.f, 1.f));
+				
+				LLMatrix4 rot_mat(rot);
+				rot_mat *= trans_mat;
+
+				appendInstances(parts, rot_mat, trunk_LOD, stop_level, depth - 1, 0, scale*mScaleStep, twist, droop, branches);
+			}
+			//  Recurse to continue trunk
+			if (trunk_depth)
+			{
+				LLMatrix4 trans_mat;
+				trans_mat.setTranslation(0,0,scale*length);
+				trans_mat *= matrix;
+
+				LLMatrix4 rot_mat(70.5f*DEG_TO_RAD, LLVector4(0,0,1));
+				rot_mat *= trans_mat; // rotate a bit around Z when ascending 
+				appendInstances(parts, rot_mat, trunk_LOD, stop_level, depth, trunk_depth-1, scale*mScaleStep, twist, droop, branches);
+			}
+
+			F32 width = scale * length * aspect;
+			scale_mat.mMatrix[0][0] = width;
+			scale_mat.mMatrix[1][1] = width;
+			scale_mat.mMatrix[2][2] = scale*length;
+			part = INSTANCE_TRUNK + trunk_LOD;
+		}
+		else
+		{
+			scale_mat.mMatrix[0][0] = 
+				scale_mat.mMatrix[1][1] =
+				scale_mat.mMatrix[2][2] = scale*mLeafScale;
+		}
+	}
+	else
+	{
+		scale_mat.mMatrix[0][0] = 
+			scale_mat.mMatrix[1][1] =
+			scale_mat.mMatrix[2][2] = mBillboardScale*mBillboardRatio;
+		tex_offset = -0.5f;
+	}
+
+	scale_mat *= matrix;
+
+	// LLMatrix4 transforms row vectors, the shader takes its columns
+	LLTreeInstance instance;
+	for (S32 row = 0; row < 3; row++)
+	{
+		for (S32 col = 0; col < 4; col++)
+		{
+			instance.mRows[row][col] = scale_mat.mMatrix[col][row];
+		}
+	}
+	instance.mTexOffset = tex_offset;
+	parts[part].push_back(instance);
+}
+
+//static
+BOOL LLVOTree::useSharedMeshes()
+{
+	static LLCachedControl<BOOL> tree_instancing("RenderTreeInstancing", TRUE);
+	return tree_instancing;
+}
+
+//static
+void LLVOTree::resetVertexBuffers()
+{
+	for (buffer_map_t::iterator iter = sReferenceBuffers.begin(); iter != sReferenceBuffers.end(); ++iter)
+	{
+		sMeshBytes -= iter->second->getSize() + iter->second->getIndicesSize();
+	}
+	sReferenceBuffers.clear();
+}
+
+void LLVOTree::setMeshBytes(S32 bytes)
+{
+	sMeshBytes += bytes - mMeshBytes;
+	mMeshBytes = bytes;
+}
+
 void LLVOTree::updateRadius()
 {
 	if (mDrawable.isNull())
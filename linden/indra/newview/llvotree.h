@@ -41,6 +41,14 @@ class LLFace;
 class LLDrawPool;
 class LLSelectNode;
 
+// One branch, leaf cluster or billboard of a tree, drawn instanced over the
+// mesh shared by its species
+struct LLTreeInstance
+{
+	F32		mRows[3][4];	// agent space transform, by rows
+	F32		mTexOffset;		// billboards use the lower half of the texture
+};
+
 class LLVOTree : public LLViewerObject
 {
 protected:
@@ -83,6 +91,9 @@ public:
 
 	void updateMesh();
 
+	// Agent space transform of the trunk base, bent by the wind
+	void getBaseMatrix(LLMatrix4& matrix) const;
+
 	void appendMesh(LLStrider<LLVector3>& vertices, 
 						 LLStrider<LLVector3>& normals, 
 						 LLStrider<LLVector2>& tex_coords, 
@@ -112,6 +123,32 @@ public:
 								 F32 alpha);
 
 	U32 drawBranchPipeline(LLMatrix4& matrix, U16* indicesp, S32 trunk_LOD, S32 stop_level, U16 depth, U16 trunk_depth,  F32 scale, F32 twist, F32 droop,  F32 branches, F32 alpha);
+
+	enum
+	{
+		LEAF_INDICES = 24,		// the leaf quads at the start of the reference mesh
+		LEAF_VERTICES = 16
+	};
+
+	enum
+	{
+		INSTANCE_LEAF = 0,		// leaves and billboards
+		INSTANCE_TRUNK = 1,		// plus the trunk LOD
+		NUM_INSTANCE_PARTS = 5
+	};
+
+	// Same recursion as drawBranchPipeline(), appending one instance per
+	// draw to parts[INSTANCE_LEAF] or parts[INSTANCE_TRUNK + trunk_LOD]
+	// instead of drawing.  matrix is in agent space.
+	void appendInstances(std::vector<LLTreeInstance>* parts, const LLMatrix4& matrix, S32 trunk_LOD, S32 stop_level, U16 depth, U16 trunk_depth, F32 scale, F32 twist, F32 droop, F32 branches) const;
+
+	// Trees of a species share one reference mesh when RenderTreeInstancing
+	// is on
+	static BOOL useSharedMeshes();
+	static void resetVertexBuffers();
+
+	// Bytes held by tree reference meshes, for the statistics floater
+	static S32 sMeshBytes;
  
 
 	 /*virtual*/ BOOL lineSegmentIntersect(const LLVector3& start, const LLVector3& end, 
@@ -194,6 +231,8 @@ protected:
 	
 	U32 mFrameCount;
 
+	S32 mMeshBytes;		// of mReferenceBuffer when it is not shared
+
 	typedef std::map<U32, TreeSpeciesData*> SpeciesMap;
 	static SpeciesMap sSpeciesTable;
 
@@ -204,7 +243,13 @@ protected:
 	static S32 sLODSlices[4];
 	static F32 sLODAngles[4];
 
+	typedef std::map<U8, LLPointer<LLVertexBuffer> > buffer_map_t;
+	static buffer_map_t sReferenceBuffers;
+
 private:
+	static LLPointer<LLVertexBuffer> createReferenceBuffer(U8 species);
+	void setMeshBytes(S32 bytes);
+
 	void generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 									std::vector<LLVector3> &normals,
 									std::vector<S32> &segments,
@@ -55,9 +55,11 @@
 #include "llhudmanager.h"
 #include "llflexibleobject.h"
 #include "llsky.h"
+#include "llthreadpool.h"
 #include "lltexturefetch.h"
 #include "llviewercamera.h"
 #include "llviewerimagelist.h"
+#include "llviewerobjectlist.h"
 #include "llviewerregion.h"
 #include "llviewertextureanim.h"
 #include "llworld.h"
@@ -209,9 +211,9 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 		// CORY TO DO: Figure out how to get the value here
 		if (update_type != OUT_TERSE_IMPROVED)
 		{
-			LLVolumeParams volume_params;
-			BOOL res = LLVolumeMessage::unpackVolumeParams(&volume_params, *dp);
-			if (!res)
+			const LLObjectUpdateData& update = *gObjectList.getDecodedUpdate();
+			LLVolumeParams volume_params = update.mVolumeParams;
+			if (!update.mVolumeParamsValid)
 			{
 				llwarns << "Bogus volume parameters in object " << getID() << llendl;
 				llwarns << getRegion()->getOriginGlobal() << llendl;
@@ -223,7 +225,11 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 			{
 				markForUpdate(TRUE);
 			}
-			S32 res2 = unpackTEMessage(*dp);
+			S32 res2 = update.mTEResult;
+			if (TEM_INVALID != res2)
+			{
+				res2 = applyParsedTEMessage(update.mTEContents);
+			}
 			if (TEM_INVALID == res2)
 			{
 				// Well, crap, there's something bogus in the data that we're unpacking.
@@ -240,9 +246,7 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 				updateTEData();
 			}
 
-			U32 value = dp->getPassFlags();
-
-			if (value & 0x40)
+			if (update.mSpecialCode & 0x40)
 			{
 				if (!mTextureAnimp)
 				{
@@ -256,7 +260,7 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 					}
 				}
 				mTexAnimMode = 0;
-				mTextureAnimp->unpackTAMessage(*dp);
+				static_cast<LLTextureAnim&>(*mTextureAnimp) = update.mTextureAnim;
 			}
 			else if (mTextureAnimp)
 			{
@@ -269,7 +273,8 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 		}
 		else
 		{
-			S32 texture_length = mesgsys->getSizeFast(_PREHASH_ObjectData, block_num, _PREHASH_TextureEntry);
+			// only terse updates without texture entries are held back and replayed without a message
+			S32 texture_length = mesgsys ? mesgsys->getSizeFast(_PREHASH_ObjectData, block_num, _PREHASH_TextureEntry) : 0;
 			if (texture_length)
 			{
 				U8							tdpbuffer[1024];
@@ -286,6 +291,18 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 	return retval;
 }
 
+// static
+void LLVOVolume::decodeVolumeUpdate(LLDataPacker &dp, LLObjectUpdateData &update)
+{
+	update.mVolumeParamsValid = LLVolumeMessage::unpackVolumeParams(&update.mVolumeParams, dp);
+	update.mTEResult = parseTEMessage(dp, update.mTEContents);
+	if (update.mSpecialCode & 0x40)
+	{
+		update.mTextureAnim.reset();
+		update.mTextureAnim.unpackTAMessage(dp);
+	}
+}
+
 
 void LLVOVolume::animateTextures()
 {
@@ -2248,6 +2265,109 @@ void LLVolumeGeometryManager::getGeometry(LLSpatialGroup* group)
 
 }
 
+//static
+std::vector<LLVolumeGeometryManager::GeometryItem> LLVolumeGeometryManager::sGeometryQueue;
+
+// Runs on LLThreadPool threads.  getGeometryVolume() only writes to its face
+// and through the face's striders into the mapped buffer; what it shares with
+// other faces is set up by queueGeometry() on the main thread.
+class LLVolumeGeometryManager::GeometryJob : public LLThreadPool::Job
+{
+public:
+	GeometryJob(GeometryItem* items)
+	:	mItems(items)
+	{
+	}
+
+	/*virtual*/ void run(S32 begin, S32 end)
+	{
+		for (S32 i = begin; i < end; i++)
+		{
+			GeometryItem& item = mItems[i];
+			LLFace* facep = item.mFace;
+			LLVOVolume* vobj = facep->getDrawable()->getVOVolume();
+			item.mRebuilt = facep->getGeometryVolume(*vobj->getVolume(), facep->getTEOffset(),
+				vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), item.mIndexOffset);
+		}
+	}
+
+private:
+	GeometryItem* mItems;
+};
+
+//static
+void LLVolumeGeometryManager::queueGeometry(LLFace* facep, U16 index_offset)
+{
+	LLVOVolume* vobj = facep->getDrawable()->getVOVolume();
+	LLVolume* volume = vobj->getVolume();
+	S32 te_idx = facep->getTEOffset();
+
+	// Mapping is GL work, and many faces share a buffer.
+	facep->mVertexBuffer->mapBuffer();
+	// getGeometryVolume() assigns this too, which won't touch the reference
+	// count of the shared buffer once it is already set.
+	facep->mLastVertexBuffer = facep->mVertexBuffer;
+	// Volumes are shared between objects, generate binormals up front.
+	const LLTextureEntry* te = vobj->getTE(te_idx);
+	if (te && (te->getBumpmap() || te->getTexGen() != LLTextureEntry::TEX_GEN_DEFAULT))
+	{
+		volume->genBinormals(te_idx);
+	}
+
+	GeometryItem item;
+	item.mFace = facep;
+	item.mIndexOffset = index_offset;
+	item.mRebuilt = FALSE;
+	sGeometryQueue.push_back(item);
+}
+
+//static
+void LLVolumeGeometryManager::flushGeometry()
+{
+	if (sGeometryQueue.empty())
+	{
+		return;
+	}
+
+	LLFastTimer ftm(LLFastTimer::FTM_REBUILD_VOLUME_GEOM);
+
+	static LLCachedControl<BOOL> threaded_rebuild("ThreadedGeometryRebuild", TRUE);
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	GeometryJob job(&sGeometryQueue[0]);
+	S32 count = (S32)sGeometryQueue.size();
+	if (pool)
+	{
+		pool->parallelFor(job, count, 8, threaded_rebuild ? true : false);
+	}
+	else
+	{
+		job.run(0, count);
+	}
+
+	for (std::vector<GeometryItem>::iterator iter = sGeometryQueue.begin(); iter != sGeometryQueue.end(); ++iter)
+	{
+		LLFace* facep = iter->mFace;
+		if (iter->mRebuilt)
+		{
+			facep->mVertexBuffer->markDirty(facep->getGeomIndex(), facep->getGeomCount(), 
+				facep->getIndicesStart(), facep->getIndicesCount());
+		}
+	}
+
+	// Only now that every face is filled; unmapping is GL work and a worker
+	// finding its buffer unmapped would map it again off the main thread.
+	for (std::vector<GeometryItem>::iterator iter = sGeometryQueue.begin(); iter != sGeometryQueue.end(); ++iter)
+	{
+		LLVertexBuffer* buffer = iter->mFace->mVertexBuffer;
+		if (buffer->isLocked())
+		{
+			buffer->setBuffer(0);
+		}
+	}
+
+	sGeometryQueue.clear();
+}
+
 void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 {
 	if (LLPipeline::sSkipUpdate)
@@ -2463,6 +2583,8 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 	genDrawInfo(group, fullbright_mask, fullbright_faces);
 	genDrawInfo(group, alpha_mask, alpha_faces, TRUE);
 
+	flushGeometry();
+
 	if (!LLPipeline::sDelayVBUpdate)
 	{
 		//drawables have been rebuilt, clear rebuild status
@@ -2506,17 +2628,25 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 			{
 				LLVOVolume* vobj = drawablep->getVOVolume();
 				vobj->preRebuild();
-				LLVolume* volume = vobj->getVolume();
 				for (S32 i = 0; i < drawablep->getNumFaces(); ++i)
 				{
 					LLFace* face = drawablep->getFace(i);
 					if (face && face->mVertexBuffer.notNull())
 					{
-						face->getGeometryVolume(*volume, face->getTEOffset(), 
-							vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), face->getGeomIndex());
+						queueGeometry(face, face->getGeomIndex());
 					}
 				}
+			}
+		}
+
+		flushGeometry();
 
+		// the rebuild flags are read while filling the buffers
+		for (LLSpatialGroup::element_iter drawable_iter = group->getData().begin(); drawable_iter != group->getData().end(); ++drawable_iter)
+		{
+			LLDrawable* drawablep = *drawable_iter;
+			if (!drawablep->isDead() && !drawablep->isState(LLDrawable::FORCE_INVISIBLE))
+			{
 				drawablep->clearState(LLDrawable::REBUILD_ALL);
 			}
 		}
@@ -2691,18 +2821,7 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 				facep->updateRebuildFlags();
 				if (!LLPipeline::sDelayVBUpdate)
 				{
-					LLDrawable* drawablep = facep->getDrawable();
-					LLVOVolume* vobj = drawablep->getVOVolume();
-					LLVolume* volume = vobj->getVolume();
-
-					U32 te_idx = facep->getTEOffset();
-
-					if (facep->getGeometryVolume(*volume, te_idx, 
-						vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset))
-					{
-						buffer->markDirty(facep->getGeomIndex(), facep->getGeomCount(), 
-							facep->getIndicesStart(), facep->getIndicesCount());
-					}
+					queueGeometry(facep, index_offset);
 				}
 			}
 
@@ -2823,7 +2942,11 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, std::
 			++face_iter;
 		}
 
-		buffer->setBuffer(0);
+		// buffers with queued faces stay mapped until flushGeometry()
+		if (LLPipeline::sDelayVBUpdate)
+		{
+			buffer->setBuffer(0);
+		}
 	}
 
 	group->mBufferMap[mask].clear();
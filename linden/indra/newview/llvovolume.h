@@ -146,6 +146,8 @@ public:
 											void **user_data,
 											U32 block_num, const EObjectUpdateType update_type,
 											LLDataPacker *dp);
+	// The volume part of LLViewerObject::decodeUpdate() for full updates.
+	static		void	decodeVolumeUpdate(LLDataPacker &dp, LLObjectUpdateData &update);
 
 	/*virtual*/ void	setSelected(BOOL sel);
 	/*virtual*/ BOOL	setDrawableParent(LLDrawable* parentp);
@@ -43,6 +43,7 @@
 
 // linden libraries
 #include "llgl.h"
+#include "lltimer.h"
 #include "patch_dct.h"
 #include "patch_code.h"
 
@@ -50,6 +51,7 @@
 #include "noise.h"
 #include "v4color.h"
 #include "llagent.h"
+#include "llcloud.h"
 #include "llworld.h"
 
 
@@ -61,8 +63,10 @@ const F32 CLOUD_DIVERGENCE_COEF = 0.5f;
 //////////////////////////////////////////////////////////////////////
 
 LLWind::LLWind()
-:	mSize(16),
-	mCloudDensityp(NULL)
+:	mSize(GRIDS_PER_EDGE),
+	mCloudLayerp(NULL),
+	mDecodePending(FALSE),
+	mCloudVelocityDirty(FALSE)
 {
 	init();
 }
@@ -70,10 +74,6 @@ LLWind::LLWind()
 
 LLWind::~LLWind()
 {
-	delete [] mVelX;
-	delete [] mVelY;
-	delete [] mCloudVelX;
-	delete [] mCloudVelY;
 }
 
 
@@ -85,12 +85,6 @@ LLWind::~LLWind()
 void LLWind::init()
 {
 	// Initialize vector data
-	mVelX = new F32[mSize*mSize];
-	mVelY = new F32[mSize*mSize];
-
-	mCloudVelX = new F32[mSize*mSize];
-	mCloudVelY = new F32[mSize*mSize];
-
 	S32 i;
 	for (i = 0; i < mSize*mSize; i++)
 	{
@@ -99,37 +93,71 @@ void LLWind::init()
 		mCloudVelX[i] = 0.0f;
 		mCloudVelY[i] = 0.0f;
 	}
+	mAverage.setVec(0.5f * WIND_SCALE_HACK, 0.5f * WIND_SCALE_HACK, 0.f);
 }
 
 
 void LLWind::decompress(LLBitPack &bitpack, LLGroupHeader *group_headerp)
 {
-	if (!mCloudDensityp)
+	if (!mCloudLayerp)
+	{
+		return;
+	}
+
+	if (group_headerp->patch_size != mSize)
 	{
+		llwarns << "Ignoring wind layer with patch size " << (S32)group_headerp->patch_size << llendl;
 		return;
 	}
 
-	LLPatchHeader  patch_header;
-	S32 buffer[16*16];
+	mPatch[0].unpack(bitpack, *group_headerp);
+	mPatch[1].unpack(bitpack, *group_headerp);
 
-	init_patch_decompressor(group_headerp->patch_size);
+	// A newer packet replaces this one if nothing samples the region before
+	mDecodePending = TRUE;
+}
 
-	// Don't use the packed group_header stride because the strides used on
-	// simulator and viewer are not equal.
-	group_headerp->stride = group_headerp->patch_size;	
-	set_group_of_patch_header(group_headerp);
 
-	// X component
-	decode_patch_header(bitpack, &patch_header, FALSE);
-	decode_patch(bitpack, buffer);
-	decompress_patch(mVelX, buffer, &patch_header);
+void LLWind::decode()
+{
+	LLTimer timer;
 
-	// Y component
-	decode_patch_header(bitpack, &patch_header, FALSE);
-	decode_patch(bitpack, buffer);
-	decompress_patch(mVelY, buffer, &patch_header);
+	mPatch[0].decompress(mVelX);
+	mPatch[1].decompress(mVelY);
+
+	S32 i, grid_count;
+	grid_count = mSize * mSize;
+	mAverage.setVec(0.f, 0.f, 0.f);
+	for (i = 0; i < grid_count; i++)
+	{
+		mAverage.mV[VX] += mVelX[i];
+		mAverage.mV[VY] += mVelY[i];
+	}
+	mAverage *= 1.f/((F32)(grid_count)) * WIND_SCALE_HACK;
+
+	mDecodePending = FALSE;
+	mCloudVelocityDirty = TRUE;
+	LLCloudLayer::sFrameCost += timer.getElapsedTimeF32();
+}
+
+
+void LLWind::updateCloudVelocity()
+{
+	if (mDecodePending)
+	{
+		decode();
+	}
+	mCloudVelocityDirty = FALSE;
 
+	const F32 *densityp = mCloudLayerp ? mCloudLayerp->getDensityGrid() : NULL;
+	if (!densityp)
+	{
+		memcpy(mCloudVelX, mVelX, sizeof(mVelX));
+		memcpy(mCloudVelY, mVelY, sizeof(mVelY));
+		return;
+	}
 
+	LLTimer timer;
 
 	S32 i, j, k;
 	// HACK -- mCloudVelXY is the same as mVelXY, except we add a divergence
@@ -143,8 +171,8 @@ void LLWind::decompress(LLBitPack &bitpack, LLGroupHeader *group_headerp)
 		for (i=1; i<mSize-1; i++)
 		{
 			k = i + j * mSize;
-			*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k + 1) - *(mCloudDensityp + k - 1));
-			*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k + mSize) - *(mCloudDensityp + k - mSize));
+			*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k + 1) - *(densityp + k - 1));
+			*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k + mSize) - *(densityp + k - mSize));
 		}
 	}
 
@@ -152,47 +180,43 @@ void LLWind::decompress(LLBitPack &bitpack, LLGroupHeader *group_headerp)
 	for (j=1; j<mSize-1; j++)
 	{
 		k = i + j * mSize;
-		*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k) - *(mCloudDensityp + k - 2));
-		*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k + mSize) - *(mCloudDensityp + k - mSize));
+		*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k) - *(densityp + k - 2));
+		*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k + mSize) - *(densityp + k - mSize));
 	}
 	i = 0;
 	for (j=1; j<mSize-1; j++)
 	{
 		k = i + j * mSize;
-		*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k + 2) - *(mCloudDensityp + k));
-		*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k + mSize) - *(mCloudDensityp + k + mSize));
+		*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k + 2) - *(densityp + k));
+		*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k + mSize) - *(densityp + k + mSize));
 	}
 	j = mSize - 1;
 	for (i=1; i<mSize-1; i++)
 	{
 		k = i + j * mSize;
-		*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k + 1) - *(mCloudDensityp + k - 1));
-		*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k) - *(mCloudDensityp + k - 2*mSize));
+		*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k + 1) - *(densityp + k - 1));
+		*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k) - *(densityp + k - 2*mSize));
 	}
 	j = 0;
 	for (i=1; i<mSize-1; i++)
 	{
 		k = i + j * mSize;
-		*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k + 1) - *(mCloudDensityp + k -1));
-		*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(mCloudDensityp + k + 2*mSize) - *(mCloudDensityp + k));
+		*(mCloudVelX + k) = *(mVelX + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k + 1) - *(densityp + k -1));
+		*(mCloudVelY + k) = *(mVelY + k) + CLOUD_DIVERGENCE_COEF * (*(densityp + k + 2*mSize) - *(densityp + k));
 	}
+
+	LLCloudLayer::sFrameCost += timer.getElapsedTimeF32();
 }
 
 
 LLVector3 LLWind::getAverage()
 {
 	//  Returns in average_wind the average wind velocity 
-	LLVector3 average(0.0f, 0.0f, 0.0f);	
-	S32 i, grid_count;
-	grid_count = mSize * mSize;
-	for (i = 0; i < grid_count; i++)
+	if (mDecodePending)
 	{
-		average.mV[VX] += mVelX[i];
-		average.mV[VY] += mVelY[i];
+		decode();
 	}
-
-	average *= 1.f/((F32)(grid_count)) * WIND_SCALE_HACK;
-	return average;
+	return mAverage;
 }
 
 
@@ -228,67 +252,25 @@ LLVector3 LLWind::getVelocityNoisy(const LLVector3 &pos_region, const F32 dim)
 
 LLVector3 LLWind::getVelocity(const LLVector3 &pos_region)
 {
-	llassert(mSize == 16);
-	// Resolves value of wind at a location relative to SW corner of region
-	//  
-	// Returns wind magnitude in X,Y components of vector3
-	LLVector3 r_val;
-	F32 dx,dy;
-	S32 k;
-
-	LLVector3 pos_clamped_region(pos_region);
-	
-	F32 region_width_meters = LLWorld::getInstance()->getRegionWidthInMeters();
-
-	if (pos_clamped_region.mV[VX] < 0.f)
-	{
-		pos_clamped_region.mV[VX] = 0.f;
-	}
-	else if (pos_clamped_region.mV[VX] >= region_width_meters)
+	if (mDecodePending)
 	{
-		pos_clamped_region.mV[VX] = (F32) fmod(pos_clamped_region.mV[VX], region_width_meters);
+		decode();
 	}
+	return sample(mVelX, mVelY, pos_region);
+}
 
-	if (pos_clamped_region.mV[VY] < 0.f)
-	{
-		pos_clamped_region.mV[VY] = 0.f;
-	}
-	else if (pos_clamped_region.mV[VY] >= region_width_meters)
-	{
-		pos_clamped_region.mV[VY] = (F32) fmod(pos_clamped_region.mV[VY], region_width_meters);
-	}
-	
-	
-	S32 i = llfloor(pos_clamped_region.mV[VX] * mSize / region_width_meters);
-	S32 j = llfloor(pos_clamped_region.mV[VY] * mSize / region_width_meters);
-	k = i + j*mSize;
-	dx = ((pos_clamped_region.mV[VX] * mSize / region_width_meters) - (F32) i);
-	dy = ((pos_clamped_region.mV[VY] * mSize / region_width_meters) - (F32) j);
 
-	if ((i < mSize-1) && (j < mSize-1))
-	{
-		//  Interior points, no edges
-		r_val.mV[VX] =  mVelX[k]*(1.0f - dx)*(1.0f - dy) + 
-						mVelX[k + 1]*dx*(1.0f - dy) + 
-						mVelX[k + mSize]*dy*(1.0f - dx) + 
-						mVelX[k + mSize + 1]*dx*dy;
-		r_val.mV[VY] =  mVelY[k]*(1.0f - dx)*(1.0f - dy) + 
-						mVelY[k + 1]*dx*(1.0f - dy) + 
-						mVelY[k + mSize]*dy*(1.0f - dx) + 
-						mVelY[k + mSize + 1]*dx*dy;
-	}
-	else 
+LLVector3 LLWind::getCloudVelocity(const LLVector3 &pos_region)
+{
+	if (mDecodePending || mCloudVelocityDirty)
 	{
-		r_val.mV[VX] = mVelX[k];
-		r_val.mV[VY] = mVelY[k];
+		updateCloudVelocity();
 	}
-
-	r_val.mV[VZ] = 0.f;
-	return r_val * WIND_SCALE_HACK;
+	return sample(mCloudVelX, mCloudVelY, pos_region);
 }
 
 
-LLVector3 LLWind::getCloudVelocity(const LLVector3 &pos_region)
+LLVector3 LLWind::sample(const F32 *vel_x, const F32 *vel_y, const LLVector3 &pos_region) const
 {
 	llassert(mSize == 16);
 	// Resolves value of wind at a location relative to SW corner of region
@@ -330,19 +312,19 @@ LLVector3 LLWind::getCloudVelocity(const LLVector3 &pos_region)
 	if ((i < mSize-1) && (j < mSize-1))
 	{
 		//  Interior points, no edges
-		r_val.mV[VX] =  mCloudVelX[k]*(1.0f - dx)*(1.0f - dy) + 
-						mCloudVelX[k + 1]*dx*(1.0f - dy) + 
-						mCloudVelX[k + mSize]*dy*(1.0f - dx) + 
-						mCloudVelX[k + mSize + 1]*dx*dy;
-		r_val.mV[VY] =  mCloudVelY[k]*(1.0f - dx)*(1.0f - dy) + 
-						mCloudVelY[k + 1]*dx*(1.0f - dy) + 
-						mCloudVelY[k + mSize]*dy*(1.0f - dx) + 
-						mCloudVelY[k + mSize + 1]*dx*dy;
+		r_val.mV[VX] =  vel_x[k]*(1.0f - dx)*(1.0f - dy) + 
+						vel_x[k + 1]*dx*(1.0f - dy) + 
+						vel_x[k + mSize]*dy*(1.0f - dx) + 
+						vel_x[k + mSize + 1]*dx*dy;
+		r_val.mV[VY] =  vel_y[k]*(1.0f - dx)*(1.0f - dy) + 
+						vel_y[k + 1]*dx*(1.0f - dy) + 
+						vel_y[k + mSize]*dy*(1.0f - dx) + 
+						vel_y[k + mSize + 1]*dx*dy;
 	}
 	else 
 	{
-		r_val.mV[VX] = mCloudVelX[k];
-		r_val.mV[VY] = mCloudVelY[k];
+		r_val.mV[VX] = vel_x[k];
+		r_val.mV[VY] = vel_y[k];
 	}
 
 	r_val.mV[VZ] = 0.f;
@@ -350,14 +332,13 @@ LLVector3 LLWind::getCloudVelocity(const LLVector3 &pos_region)
 }
 
 
-void LLWind::setCloudDensityPointer(F32 *densityp)
+void LLWind::setCloudLayer(LLCloudLayer *cloudp)
 {
-	mCloudDensityp = densityp;
+	mCloudLayerp = cloudp;
+	mCloudVelocityDirty = TRUE;
 }
 
 void LLWind::setOriginGlobal(const LLVector3d &origin_global)
 {
 	mOriginGlobal = origin_global;
 }
-
-
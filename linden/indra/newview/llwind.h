@@ -37,15 +37,21 @@
 #include "llmath.h"
 #include "v3math.h"
 #include "v3dmath.h"
+#include "llcompressedpatch.h"
 
 class LLVector3;
 class LLBitPack;
-class LLGroupHeader;
+class LLCloudLayer;
 
 
 class LLWind  
 {
 public:
+	enum
+	{
+		GRIDS_PER_EDGE = 16
+	};
+
 	LLWind();
 	~LLWind();
 	void renderVectors();
@@ -53,22 +59,37 @@ public:
 	LLVector3 getCloudVelocity(const LLVector3 &location); // "location" is region-local
 	LLVector3 getVelocityNoisy(const LLVector3 &location, const F32 dim);	// "location" is region-local
 
+	// Keeps the packet's coefficients, the field is decoded the first time
+	// it is sampled
 	void decompress(LLBitPack &bitpack, LLGroupHeader *group_headerp);
 	LLVector3 getAverage();
-	void setCloudDensityPointer(F32 *densityp);
+	void setCloudLayer(LLCloudLayer *cloudp);
+
+	// The cloud density the cloud velocities are bent by changed
+	void setCloudDensityChanged()			{ mCloudVelocityDirty = TRUE; }
 
 	void setOriginGlobal(const LLVector3d &origin_global);
+
 private:
+	void init();
+	void decode();
+	void updateCloudVelocity();
+	LLVector3 sample(const F32 *vel_x, const F32 *vel_y, const LLVector3 &pos_region) const;
+
 	S32 mSize;
-	F32 * mVelX;
-	F32 * mVelY;
-	F32 * mCloudVelX;
-	F32 * mCloudVelY;
-	F32 * mCloudDensityp;
+	F32 mVelX[GRIDS_PER_EDGE*GRIDS_PER_EDGE];
+	F32 mVelY[GRIDS_PER_EDGE*GRIDS_PER_EDGE];
+	F32 mCloudVelX[GRIDS_PER_EDGE*GRIDS_PER_EDGE];
+	F32 mCloudVelY[GRIDS_PER_EDGE*GRIDS_PER_EDGE];
+	LLVector3 mAverage;
+	LLCloudLayer *mCloudLayerp;
 
-	LLVector3d mOriginGlobal;
-	void init();
+	// The last packet, until something samples the field
+	BOOL			mDecodePending;
+	BOOL			mCloudVelocityDirty;
+	LLCompressedPatch mPatch[2];	// X and Y components
 
+	LLVector3d mOriginGlobal;
 };
 
 #endif
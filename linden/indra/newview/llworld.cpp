@@ -660,6 +660,16 @@ void LLWorld::updateRegions(F32 max_update_time)
 		max_time = llmin(max_time, max_update_time*.1f);
 		did_one |= regionp->idleUpdate(max_update_time);
 	}
+
+	// Every region queues on the one terrain job thread, so the total is
+	// what backs up
+	S32 pending_jobs = 0;
+	for (region_list_t::iterator iter = mRegionList.begin();
+		 iter != mRegionList.end(); ++iter)
+	{
+		pending_jobs += (*iter)->getLand().getPendingJobCount();
+	}
+	LLSurface::sPendingJobsStat.addValue((F32)pending_jobs);
 }
 
 void LLWorld::updateParticles()
@@ -669,16 +679,24 @@ void LLWorld::updateParticles()
 
 void LLWorld::updateClouds(const F32 dt)
 {
+	// Wind and cloud fields are decoded whenever something samples them,
+	// so this is the cost of the frame before, averaged over the regions
+	LLCloudLayer::sCostStat.addValue(LLCloudLayer::sFrameCost * 1000.f / llmax((S32)mActiveRegionList.size(), 1));
+	LLCloudLayer::sFrameCost = 0.f;
+
 	static BOOL* sFreezeTime = rebind_llcontrol<BOOL>("FreezeTime", &gSavedSettings, true);
 	if ((*sFreezeTime) ||
-		!gSavedSettings.getBOOL("SkyUseClassicClouds") ||
-		!gHippoLimits->skyUseClassicClouds)
+		!LLCloudLayer::useClassicClouds())
 	{
 		// don't move clouds in snapshot mode
 		return;
 	}
 	if (mActiveRegionList.size())
 	{
+		// Includes the fields decoded for the puffs
+		const F32 cost = LLCloudLayer::sFrameCost;
+		LLTimer timer;
+
 		// Update all the cloud puff positions, and timer based stuff
 		// such as death decay
 		for (region_list_t::iterator iter = mActiveRegionList.begin();
@@ -703,6 +721,8 @@ void LLWorld::updateClouds(const F32 dt)
 			LLViewerRegion* regionp = *iter;
 			regionp->mCloudLayer.updatePuffCount();
 		}
+
+		LLCloudLayer::sFrameCost = cost + timer.getElapsedTimeF32();
 	}
 }
 
@@ -45,6 +45,7 @@
 #include "llmemtype.h"
 #include "llnamevalue.h"
 #include "llprimitive.h"
+#include "llthreadpool.h"
 #include "llvolume.h"
 #include "material_codes.h"
 #include "timing.h"
@@ -64,10 +65,12 @@
 #include "lldrawpoolwater.h"
 #include "llface.h"
 #include "llfeaturemanager.h"
+#include "llflexibleobject.h"
 #include "llfloatertelehub.h"
 #include "llframestats.h"
 #include "llgldbg.h"
 #include "llhudmanager.h"
+#include "llimpostoratlas.h"
 #include "lllightconstants.h"
 #include "llresmgr.h"
 #include "llselectmgr.h"
@@ -289,6 +292,13 @@ LLPipeline::LLPipeline() :
 	mMinBatchSize(0),
 	mMeanBatchSize(0),
 	mTrianglesDrawn(0),
+	mDrawCalls(0),
+	mBatchesMerged(0),
+	mBatchTextureBinds(0),
+	mParticleVertexBytes(0),
+	mHUDTextGlyphsCached(0),
+	mHUDTextDrawsSaved(0),
+	mVegetationDrawCalls(0),
 	mNumVisibleNodes(0),
 	mVerticesRelit(0),
 	mLightingChanges(0),
@@ -344,6 +354,14 @@ void LLPipeline::init()
 	getPool(LLDrawPool::POOL_GLOW);
 
 	mTrianglesDrawnStat.reset();
+	mDrawCallsStat.reset();
+	mBatchesMergedStat.reset();
+	mBatchTextureBindsStat.reset();
+	mParticleVertexBytesStat.reset();
+	mHUDTextGlyphsCachedStat.reset();
+	mHUDTextDrawsSavedStat.reset();
+	mVegetationDrawCallsStat.reset();
+	mTreeMeshBytesStat.reset();
 	resetFrameStats();
 
 	mRenderTypeMask = 0xffffffff;	// All render types start on
@@ -1108,6 +1126,21 @@ void LLPipeline::resetFrameStats()
 		mMeanBatchSize = gPipeline.mTrianglesDrawn/gPipeline.mBatchCount;
 	}
 	mTrianglesDrawn = 0;
+	mDrawCallsStat.addValue((F32) mDrawCalls);
+	mBatchesMergedStat.addValue((F32) mBatchesMerged);
+	mBatchTextureBindsStat.addValue((F32) mBatchTextureBinds);
+	mParticleVertexBytesStat.addValue(mParticleVertexBytes / 1024.f);
+	mHUDTextGlyphsCachedStat.addValue((F32) mHUDTextGlyphsCached);
+	mHUDTextDrawsSavedStat.addValue((F32) mHUDTextDrawsSaved);
+	mVegetationDrawCallsStat.addValue((F32) mVegetationDrawCalls);
+	mTreeMeshBytesStat.addValue(LLVOTree::sMeshBytes / 1024.f);
+	mDrawCalls = 0;
+	mBatchesMerged = 0;
+	mBatchTextureBinds = 0;
+	mParticleVertexBytes = 0;
+	mHUDTextGlyphsCached = 0;
+	mHUDTextDrawsSaved = 0;
+	mVegetationDrawCalls = 0;
 	sCompiles        = 0;
 	mVerticesRelit   = 0;
 	mLightingChanges = 0;
@@ -1590,6 +1623,10 @@ void LLPipeline::updateGeom(F32 max_dtime)
 	// for now, only LLVOVolume does this to throttle LOD changes
 	LLVOVolume::preUpdateGeom();
 
+	// step flexible objects marked for a rebuild together, before any of
+	// them writes its path
+	LLVolumeImplFlexible::updateClass();
+
 	// Iterate through all drawables on the priority build queue,
 	for (LLDrawable::drawable_list_t::iterator iter = mBuildQ1.begin();
 		 iter != mBuildQ1.end();)
@@ -2192,6 +2229,35 @@ void renderSoundHighlights(LLDrawable* drawablep)
 	}
 }
 
+// Sorts the render maps, one render type per index.  Runs on LLThreadPool
+// threads; the comparators only read the draw infos.
+class LLRenderMapSortJob : public LLThreadPool::Job
+{
+public:
+	LLRenderMapSortJob(LLCullResult* cull)
+	:	mCull(cull)
+	{
+	}
+
+	/*virtual*/ void run(S32 begin, S32 end)
+	{
+		for (S32 i = begin; i < end; i++)
+		{
+			if (i == LLRenderPass::PASS_BUMP)
+			{
+				std::sort(mCull->beginRenderMap(i), mCull->endRenderMap(i), LLDrawInfo::CompareBump());
+			}
+			else 
+			{
+				std::sort(mCull->beginRenderMap(i), mCull->endRenderMap(i), LLDrawInfo::CompareRenderState());
+			}	
+		}
+	}
+
+private:
+	LLCullResult* mCull;
+};
+
 void LLPipeline::postSort(LLCamera& camera)
 {
 	LLMemType mt(LLMemType::MTYPE_PIPELINE);
@@ -2290,17 +2356,19 @@ void LLPipeline::postSort(LLCamera& camera)
 		
 	if (!sShadowRender)
 	{
+		LLFastTimer ftm(LLFastTimer::FTM_STATESORT_SORT);
+
 		//sort by texture or bump map
-		for (U32 i = 0; i < LLRenderPass::NUM_RENDER_TYPES; ++i)
+		static LLCachedControl<BOOL> threaded_sort("ThreadedGeometryRebuild", TRUE);
+		LLThreadPool* pool = LLThreadPool::getInstance();
+		LLRenderMapSortJob job(sCull);
+		if (pool)
 		{
-			if (i == LLRenderPass::PASS_BUMP)
-			{
-				std::sort(sCull->beginRenderMap(i), sCull->endRenderMap(i), LLDrawInfo::CompareBump());
-			}
-			else 
-			{
-				std::sort(sCull->beginRenderMap(i), sCull->endRenderMap(i), LLDrawInfo::CompareTexturePtrMatrix());
-			}	
+			pool->parallelFor(job, LLRenderPass::NUM_RENDER_TYPES, 1, threaded_sort ? true : false);
+		}
+		else
+		{
+			job.run(0, LLRenderPass::NUM_RENDER_TYPES);
 		}
 
 		std::sort(sCull->beginAlphaGroups(), sCull->endAlphaGroups(), LLSpatialGroup::CompareDepthGreater());
@@ -3058,6 +3126,7 @@ void LLPipeline::addTrianglesDrawn(S32 count)
 	assertInitialized();
 	mTrianglesDrawn += count;
 	mBatchCount++;
+	mDrawCalls++;
 	mMaxBatchSize = llmax(mMaxBatchSize, count);
 	mMinBatchSize = llmin(mMinBatchSize, count);
 
@@ -4883,6 +4952,8 @@ void LLPipeline::resetVertexBuffers()
 	resetDrawOrders();
 
 	gSky.resetVertexBuffers();
+	LLVOPartGroup::resetVertexBuffers();
+	LLVOTree::resetVertexBuffers();
 
 	if (LLVertexBuffer::sGLCount > 0)
 	{
@@ -6589,84 +6660,77 @@ void LLPipeline::generateImpostor(LLVOAvatar* avatar)
 	U32 resY = llmin(nhpo2((U32) (fov*pa)), (U32) 512);
 	U32 resX = llmin(nhpo2((U32) (atanf(tdim.mV[0]/distance)*2.f*RAD_TO_DEG*pa)), (U32) 512);
 
-	if (!avatar->mImpostor.isComplete() || resX != avatar->mImpostor.getWidth() ||
-		resY != avatar->mImpostor.getHeight())
-	{
-		if (LLPipeline::sRenderDeferred)
-		{
-			avatar->mImpostor.allocate(resX,resY,GL_RGBA16F_ARB,TRUE,TRUE);
-			addDeferredAttachments(avatar->mImpostor);
-		}
-		else
-		{
-			avatar->mImpostor.allocate(resX,resY,GL_RGBA,TRUE,TRUE);
-		}
-		gGL.getTexUnit(0)->bind(&avatar->mImpostor);
-		gGL.getTexUnit(0)->setTextureFilteringOption(LLTexUnit::TFO_POINT);
-		gGL.getTexUnit(0)->unbind(LLTexUnit::TT_TEXTURE);
-	}
+	resX = llmax(resX, (U32) 16);
+	resY = llmax(resY, (U32) 16);
 
+	LLImpostorAtlas* atlas = LLImpostorAtlas::getInstance();
+	LLImpostorSlot& slot = avatar->mImpostorSlot;
+	if (slot.isNull() || resX != (U32) slot.mWidth || resY != (U32) slot.mHeight)
 	{
-		LLGLEnable scissor(GL_SCISSOR_TEST);
-		glScissor(0, 0, resX, resY);
-		avatar->mImpostor.bindTarget();
-		avatar->mImpostor.clear();
+		atlas->free(slot);
+		atlas->allocate(resX, resY, slot);
 	}
-	
-	LLGLEnable stencil(GL_STENCIL_TEST);
 
-	glStencilFunc(GL_ALWAYS, 1, 0xFFFFFFFF);
-	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-
-	if (LLPipeline::sRenderDeferred)
-	{
-		stop_glerror();
-		renderGeomDeferred(camera);
-	}
-	else
+	// the impostor's part of the atlas page
+	LLGLEnable scissor(slot.isNull() ? 0 : GL_SCISSOR_TEST);
+	if (!slot.isNull())
 	{
-		renderGeom(camera);
-	}
-	
-	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-	glStencilFunc(GL_EQUAL, 1, 0xFFFFFF);
+		atlas->bindSlot(slot);
 
-	if (!sRenderDeferred || muted)
-	{
-		LLVector3 left = camera.getLeftAxis()*tdim.mV[0]*2.f;
-		LLVector3 up = camera.getUpAxis()*tdim.mV[1]*2.f;
+		LLGLEnable stencil(GL_STENCIL_TEST);
 
-		LLGLEnable blend(muted ? 0 : GL_BLEND);
+		glStencilFunc(GL_ALWAYS, 1, 0xFFFFFFFF);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
-		if (muted)
+		if (LLPipeline::sRenderDeferred)
 		{
-			gGL.setColorMask(true, true);
+			stop_glerror();
+			renderGeomDeferred(camera);
 		}
 		else
 		{
-			gGL.setColorMask(false, true);
+			renderGeom(camera);
 		}
-		
-		gGL.setSceneBlendType(LLRender::BT_ADD);
-		gGL.getTexUnit(0)->unbind(LLTexUnit::TT_TEXTURE);
+	
+		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+		glStencilFunc(GL_EQUAL, 1, 0xFFFFFF);
 
-		LLGLDepthTest depth(GL_FALSE, GL_FALSE);
+		if (!sRenderDeferred || muted)
+		{
+			LLVector3 left = camera.getLeftAxis()*tdim.mV[0]*2.f;
+			LLVector3 up = camera.getUpAxis()*tdim.mV[1]*2.f;
 
-		gGL.color4f(1,1,1,1);
-		gGL.color4ub(64,64,64,255);
-		gGL.begin(LLRender::QUADS);
-		gGL.vertex3fv((pos+left-up).mV);
-		gGL.vertex3fv((pos-left-up).mV);
-		gGL.vertex3fv((pos-left+up).mV);
-		gGL.vertex3fv((pos+left+up).mV);
-		gGL.end();
-		gGL.flush();
+			LLGLEnable blend(muted ? 0 : GL_BLEND);
 
-		gGL.setSceneBlendType(LLRender::BT_ALPHA);
-	}
+			if (muted)
+			{
+				gGL.setColorMask(true, true);
+			}
+			else
+			{
+				gGL.setColorMask(false, true);
+			}
+		
+			gGL.setSceneBlendType(LLRender::BT_ADD);
+			gGL.getTexUnit(0)->unbind(LLTexUnit::TT_TEXTURE);
+
+			LLGLDepthTest depth(GL_FALSE, GL_FALSE);
 
+			gGL.color4f(1,1,1,1);
+			gGL.color4ub(64,64,64,255);
+			gGL.begin(LLRender::QUADS);
+			gGL.vertex3fv((pos+left-up).mV);
+			gGL.vertex3fv((pos-left-up).mV);
+			gGL.vertex3fv((pos-left+up).mV);
+			gGL.vertex3fv((pos+left+up).mV);
+			gGL.end();
+			gGL.flush();
 
-	avatar->mImpostor.flush();
+			gGL.setSceneBlendType(LLRender::BT_ALPHA);
+		}
+
+		atlas->flushSlot(slot);
+	}
 
 	avatar->setImpostorDim(tdim);
 
@@ -6682,6 +6746,7 @@ void LLPipeline::generateImpostor(LLVOAvatar* avatar)
 	glPopMatrix();
 
 	avatar->mNeedsImpostorUpdate = FALSE;
+	avatar->mImpostorUpdateTime = LLFrameTimer::getElapsedSeconds();
 	avatar->cacheImpostorValues();
 
 	LLVertexBuffer::unbind();
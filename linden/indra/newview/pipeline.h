@@ -78,6 +78,8 @@ glh::matrix4f gl_ortho(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top,
 glh::matrix4f gl_perspective(GLfloat fovy, GLfloat aspect, GLfloat zNear, GLfloat zFar);
 glh::matrix4f gl_lookat(LLVector3 eye, LLVector3 center, LLVector3 up);
 
+void addDeferredAttachments(LLRenderTarget& target);
+
 class LLPipeline
 {
 public:
@@ -383,8 +385,23 @@ public:
 	S32						 mMinBatchSize;
 	S32						 mMeanBatchSize;
 	S32						 mTrianglesDrawn;
+	S32						 mDrawCalls;			// this frame
+	S32						 mBatchesMerged;		// into the draw call of the batch before them
+	S32						 mBatchTextureBinds;	// texture changes between batches
+	S32						 mParticleVertexBytes;	// particle geometry written this frame
+	S32						 mHUDTextGlyphsCached;	// floating text glyphs drawn without laying them out again
+	S32						 mHUDTextDrawsSaved;	// floating text lines drawn in a shared batch
+	S32						 mVegetationDrawCalls;	// by the tree and grass pools
 	S32						 mNumVisibleNodes;
 	LLStat                   mTrianglesDrawnStat;
+	LLStat					 mDrawCallsStat;
+	LLStat					 mBatchesMergedStat;
+	LLStat					 mBatchTextureBindsStat;
+	LLStat					 mParticleVertexBytesStat;
+	LLStat					 mHUDTextGlyphsCachedStat;
+	LLStat					 mHUDTextDrawsSavedStat;
+	LLStat					 mVegetationDrawCallsStat;
+	LLStat					 mTreeMeshBytesStat;
 	S32						 mVerticesRelit;
 
 	S32						 mLightingChanges;
@@ -0,0 +1,238 @@
+/**
+ * @file llanimationstage_tut.cpp
+ * @brief Tests and benchmark for the split motion update used by the
+ * parallel avatar animation stage
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llanimationtestutil.h"
+#include "llcharacter.h"
+#include "llkeyframemotion.h"
+#include "llthreadpool.h"
+#include "lltimer.h"
+#include "lltut.h"
+
+#include <vector>
+
+namespace
+{
+	const F32 FRAME_TIME = 1.f / 30.f;
+
+	const S32 NUM_CLIPS = 4;
+
+	// The repo ships no .anim assets (the standard ones come from the asset
+	// server), so the "built in" clips are synthesized once per run.
+	void load_clips(std::vector<LLUUID>& clip_ids)
+	{
+		static std::vector<LLUUID> sClipIDs;
+		if (sClipIDs.empty())
+		{
+			LLTestCharacter loader_character;
+			std::vector<U8> buffer;
+			for (S32 i = 0; i < NUM_CLIPS; i++)
+			{
+				LLUUID id;
+				id.generate();
+				S32 size = write_test_clip(buffer, 1.f + 0.5f * i, i, TRUE, NUM_TEST_SKELETON_JOINTS);
+				LLTestClipLoader loader(id);
+				if (loader.load(&loader_character, &buffer[0], size))
+				{
+					sClipIDs.push_back(id);
+				}
+			}
+		}
+		clip_ids = sClipIDs;
+	}
+
+	struct Crowd
+	{
+		Crowd(S32 count, const std::vector<LLUUID>& clip_ids)
+		{
+			for (S32 i = 0; i < count; i++)
+			{
+				LLTestCharacter* character = new LLTestCharacter;
+				character->getMotionController().setFixedTimeDelta(FRAME_TIME);
+				for (S32 c = 0; c < (S32)clip_ids.size(); c++)
+				{
+					character->registerMotion(clip_ids[c], LLKeyframeMotion::create);
+				}
+				// two overlapping clips per character exercises the blender
+				character->startMotion(clip_ids[i % clip_ids.size()], 0.05f * i);
+				character->startMotion(clip_ids[(i + 1) % clip_ids.size()], 0.f);
+				mCharacters.push_back(character);
+			}
+		}
+
+		~Crowd()
+		{
+			for (S32 i = 0; i < (S32)mCharacters.size(); i++)
+			{
+				delete mCharacters[i];
+			}
+		}
+
+		// what LLVOAvatar::updateCharacter() did before the stage
+		void updateSerial()
+		{
+			for (S32 i = 0; i < (S32)mCharacters.size(); i++)
+			{
+				mCharacters[i]->updateMotions(LLCharacter::NORMAL_UPDATE);
+				mCharacters[i]->getRootJoint()->updateWorldMatrixChildren();
+			}
+		}
+
+		// what the animation stage does
+		void updateStaged(bool threaded)
+		{
+			std::vector<LLCharacter*> staged;
+			for (S32 i = 0; i < (S32)mCharacters.size(); i++)
+			{
+				if (mCharacters[i]->beginMotionUpdate(LLCharacter::NORMAL_UPDATE))
+				{
+					staged.push_back(mCharacters[i]);
+				}
+				else
+				{
+					mCharacters[i]->getRootJoint()->updateWorldMatrixChildren();
+				}
+			}
+			LLCharacter::blendMotionsParallel(staged, threaded);
+			for (S32 i = 0; i < (S32)staged.size(); i++)
+			{
+				staged[i]->endMotionUpdate();
+			}
+		}
+
+		std::vector<LLTestCharacter*> mCharacters;
+	};
+
+	bool same_pose(LLTestCharacter* a, LLTestCharacter* b)
+	{
+		for (S32 j = 0; j < a->getNumJoints(); j++)
+		{
+			const LLMatrix4& ma = a->getCharacterJoint(j)->getWorldMatrix();
+			const LLMatrix4& mb = b->getCharacterJoint(j)->getWorldMatrix();
+			if (memcmp(ma.mMatrix, mb.mMatrix, sizeof(ma.mMatrix)) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+namespace tut
+{
+	struct animationstage
+	{
+		animationstage()
+		:	mOwnPool(LLThreadPool::getInstance() == NULL)
+		{
+			if (mOwnPool)
+			{
+				LLThreadPool::initClass();
+			}
+			load_clips(mClipIDs);
+		}
+
+		~animationstage()
+		{
+			if (mOwnPool)
+			{
+				LLThreadPool::cleanupClass();
+			}
+		}
+
+		bool mOwnPool;
+		std::vector<LLUUID> mClipIDs;
+	};
+
+	typedef test_group<animationstage> animationstage_t;
+	typedef animationstage_t::object animationstage_object_t;
+	tut::animationstage_t tut_animationstage("animationstage");
+
+	template<> template<>
+	void animationstage_object_t::test<1>()
+	{
+		ensure_equals("clips parsed", (S32)mClipIDs.size(), NUM_CLIPS);
+
+		// the staged update, threaded or not, poses every joint exactly like
+		// the one step update
+		const S32 NUM_CHARACTERS = 48;
+		Crowd serial(NUM_CHARACTERS, mClipIDs);
+		Crowd staged(NUM_CHARACTERS, mClipIDs);
+		Crowd threaded(NUM_CHARACTERS, mClipIDs);
+
+		for (S32 frame = 0; frame < 90; frame++)
+		{
+			serial.updateSerial();
+			staged.updateStaged(false);
+			threaded.updateStaged(true);
+		}
+
+		bool moved = false;
+		for (S32 i = 0; i < NUM_CHARACTERS; i++)
+		{
+			ensure("unthreaded stage matches serial update", same_pose(serial.mCharacters[i], staged.mCharacters[i]));
+			ensure("threaded stage matches serial update", same_pose(serial.mCharacters[i], threaded.mCharacters[i]));
+			moved |= serial.mCharacters[i]->getCharacterJoint(4)->getWorldRotation() != LLQuaternion::DEFAULT;
+		}
+		ensure("clips actually animate the skeleton", moved);
+	}
+
+	template<> template<>
+	void animationstage_object_t::test<2>()
+	{
+		// Crowd benchmark, logged rather than asserted since timings vary
+		// by machine.
+		const S32 NUM_CHARACTERS = 100;
+		const S32 NUM_FRAMES = 100;
+		Crowd serial(NUM_CHARACTERS, mClipIDs);
+		Crowd threaded(NUM_CHARACTERS, mClipIDs);
+
+		LLTimer timer;
+		for (S32 frame = 0; frame < NUM_FRAMES; frame++)
+		{
+			serial.updateSerial();
+		}
+		F64 serial_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		for (S32 frame = 0; frame < NUM_FRAMES; frame++)
+		{
+			threaded.updateStaged(true);
+		}
+		F64 threaded_time = timer.getElapsedTimeF64();
+
+		ensure("benchmark crowds agree", same_pose(serial.mCharacters[NUM_CHARACTERS - 1], threaded.mCharacters[NUM_CHARACTERS - 1]));
+
+		llinfos << "Animating " << NUM_CHARACTERS << " characters: serial "
+				<< (serial_time * 1000.0 / NUM_FRAMES) << " ms/frame, staged on "
+				<< LLThreadPool::getInstance()->getThreadCount() << " pool threads "
+				<< (threaded_time * 1000.0 / NUM_FRAMES) << " ms/frame" << llendl;
+	}
+}
@@ -0,0 +1,159 @@
+/**
+ * @file llanimationtestutil.cpp
+ * @brief Test skeleton, clip writer and loader shared by the animation tests
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include "linden_common.h"
+#include "llanimationtestutil.h"
+
+#include "lldatapacker.h"
+#include "llquantize.h"
+
+const LLTestJointDesc TEST_SKELETON[] =
+{
+	{ "mPelvis",		-1,	{ 0.f, 0.f, 1.067f } },
+	{ "mTorso",			0,	{ 0.f, 0.f, 0.084f } },
+	{ "mChest",			1,	{ -0.015f, 0.f, 0.205f } },
+	{ "mNeck",			2,	{ -0.01f, 0.f, 0.251f } },
+	{ "mHead",			3,	{ 0.f, 0.f, 0.076f } },
+	{ "mSkull",			4,	{ 0.f, 0.f, 0.079f } },
+	{ "mEyeLeft",		4,	{ 0.098f, 0.036f, 0.079f } },
+	{ "mEyeRight",		4,	{ 0.098f, -0.036f, 0.079f } },
+	{ "mCollarLeft",	2,	{ -0.021f, 0.085f, 0.165f } },
+	{ "mShoulderLeft",	8,	{ 0.f, 0.079f, 0.f } },
+	{ "mElbowLeft",		9,	{ 0.f, 0.248f, 0.f } },
+	{ "mWristLeft",		10,	{ 0.f, 0.205f, 0.f } },
+	{ "mCollarRight",	2,	{ -0.021f, -0.085f, 0.165f } },
+	{ "mShoulderRight",	12,	{ 0.f, -0.079f, 0.f } },
+	{ "mElbowRight",	13,	{ 0.f, -0.248f, 0.f } },
+	{ "mWristRight",	14,	{ 0.f, -0.205f, 0.f } },
+	{ "mHipLeft",		0,	{ 0.034f, 0.127f, -0.041f } },
+	{ "mKneeLeft",		16,	{ -0.001f, -0.046f, -0.491f } },
+	{ "mAnkleLeft",		17,	{ -0.029f, 0.001f, -0.468f } },
+	{ "mFootLeft",		18,	{ 0.112f, 0.f, -0.061f } },
+	{ "mToeLeft",		19,	{ 0.109f, 0.f, 0.f } },
+	{ "mHipRight",		0,	{ 0.034f, -0.129f, -0.041f } },
+	{ "mKneeRight",		21,	{ -0.001f, 0.049f, -0.491f } },
+	{ "mAnkleRight",	22,	{ -0.029f, 0.f, -0.468f } },
+	{ "mFootRight",		23,	{ 0.112f, 0.f, -0.061f } },
+	{ "mToeRight",		24,	{ 0.109f, 0.f, 0.f } },
+};
+const S32 NUM_TEST_SKELETON_JOINTS = LL_ARRAY_SIZE(TEST_SKELETON);
+
+LLTestCharacter::LLTestCharacter()
+{
+	mID.generate();
+	for (S32 i = 0; i < NUM_TEST_SKELETON_JOINTS; i++)
+	{
+		const LLTestJointDesc& desc = TEST_SKELETON[i];
+		LLJoint* parent = desc.mParent < 0 ? &mRoot : mJoints[desc.mParent];
+		LLJoint* joint = new LLJoint(desc.mName, parent);
+		joint->setJointNum(i);
+		joint->setPosition(LLVector3(desc.mOffset));
+		mJoints.push_back(joint);
+	}
+	mRoot.setName("mRoot");
+	mRoot.setJointNum(NUM_TEST_SKELETON_JOINTS);
+}
+
+LLTestCharacter::~LLTestCharacter()
+{
+	flushAllMotions();
+	for (S32 i = (S32)mJoints.size() - 1; i >= 0; i--)
+	{
+		delete mJoints[i];
+	}
+}
+
+void LLTestCharacter::getGround(const LLVector3& in_pos, LLVector3& out_pos, LLVector3& out_norm)
+{
+	out_pos = in_pos;
+	out_pos.mV[VZ] = 0.f;
+	out_norm.setVec(0.f, 0.f, 1.f);
+}
+
+BOOL LLTestClipLoader::load(LLCharacter* character, U8* data, S32 size)
+{
+	mCharacter = character;
+	LLDataPackerBinaryBuffer dp(data, size);
+	return deserialize(dp);
+}
+
+S32 write_test_clip(std::vector<U8>& buffer, F32 duration, S32 seed, BOOL loop, S32 num_joints)
+{
+	S32 num_keys = llmax(2, (S32)(duration * 30.f));
+	num_joints = llclamp(num_joints, 1, NUM_TEST_SKELETON_JOINTS);
+	buffer.resize(64 + num_joints * (32 + num_keys * 16));
+
+	LLDataPackerBinaryBuffer dp(&buffer[0], (S32)buffer.size());
+	dp.packU16(KEYFRAME_MOTION_VERSION, "version");
+	dp.packU16(KEYFRAME_MOTION_SUBVERSION, "sub_version");
+	dp.packS32(LLJoint::MEDIUM_PRIORITY, "base_priority");
+	dp.packF32(duration, "duration");
+	dp.packString(std::string(), "emote_name");
+	dp.packF32(0.f, "loop_in_point");
+	dp.packF32(duration, "loop_out_point");
+	dp.packS32(loop ? 1 : 0, "loop");
+	dp.packF32(0.3f, "ease_in_duration");
+	dp.packF32(0.3f, "ease_out_duration");
+	dp.packU32(0, "hand_pose");
+	dp.packU32(num_joints, "num_joints");
+
+	for (S32 j = 0; j < num_joints; j++)
+	{
+		S32 joint_keys = (j % 7 == 6) ? 1 : num_keys;
+		F32 amplitude = 0.2f + 0.05f * ((seed + j) % 9);
+		dp.packString(TEST_SKELETON[j].mName, "joint_name");
+		dp.packS32(LLJoint::USE_MOTION_PRIORITY, "joint_priority");
+		dp.packS32(joint_keys, "num_rot_keys");
+		for (S32 k = 0; k < joint_keys; k++)
+		{
+			F32 t = duration * (F32)k / (F32)llmax(1, joint_keys - 1);
+			F32 angle = amplitude * sinf(F_TWO_PI * t / duration + 0.3f * seed + 0.7f * j);
+			LLVector3 axis((F32)(j % 3 == 0), (F32)(j % 3 == 1), (F32)(j % 3 == 2) + 0.2f);
+			axis.normVec();
+			LLVector3 packed = LLQuaternion(angle, axis).packToVector3();
+			dp.packU16(F32_to_U16(t, 0.f, duration), "time");
+			dp.packU16(F32_to_U16(packed.mV[VX], -1.f, 1.f), "rot_angle_x");
+			dp.packU16(F32_to_U16(packed.mV[VY], -1.f, 1.f), "rot_angle_y");
+			dp.packU16(F32_to_U16(packed.mV[VZ], -1.f, 1.f), "rot_angle_z");
+		}
+
+		S32 num_pos_keys = (j == 0) ? num_keys : 0;
+		dp.packS32(num_pos_keys, "num_pos_keys");
+		for (S32 k = 0; k < num_pos_keys; k++)
+		{
+			F32 t = duration * (F32)k / (F32)(num_keys - 1);
+			F32 bob = 0.05f * sinf(2.f * F_TWO_PI * t / duration + seed);
+			dp.packU16(F32_to_U16(t, 0.f, duration), "time");
+			dp.packU16(F32_to_U16(0.f, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_x");
+			dp.packU16(F32_to_U16(0.f, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_y");
+			dp.packU16(F32_to_U16(bob, -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET), "pos_z");
+		}
+	}
+
+	dp.packS32(0, "num_constraints");
+	return dp.getCurrentSize();
+}
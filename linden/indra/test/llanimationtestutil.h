@@ -0,0 +1,108 @@
+/**
+ * @file llanimationtestutil.h
+ * @brief Test skeleton, clip writer and loader shared by the animation tests
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#ifndef LL_LLANIMATIONTESTUTIL_H
+#define LL_LLANIMATIONTESTUTIL_H
+
+#include "llcharacter.h"
+#include "llkeyframemotion.h"
+
+#include <vector>
+
+// The avatar joints the standard animations move, parents before their
+// children. Names and offsets match avatar_skeleton.xml so the clips would
+// play on a viewer avatar too.
+struct LLTestJointDesc
+{
+	const char* mName;
+	S32 mParent;
+	F32 mOffset[3];
+};
+
+extern const LLTestJointDesc TEST_SKELETON[];
+extern const S32 NUM_TEST_SKELETON_JOINTS;
+
+/**
+ * @brief A character with TEST_SKELETON and no meshes, standing on a flat
+ * ground at height zero.
+ */
+class LLTestCharacter : public LLCharacter
+{
+public:
+	LLTestCharacter();
+	~LLTestCharacter();
+
+	/*virtual*/ const char* getAnimationPrefix()	{ return "avatar"; }
+	/*virtual*/ LLJoint* getRootJoint()				{ return &mRoot; }
+	/*virtual*/ LLVector3 getCharacterPosition()	{ return mRoot.getWorldPosition(); }
+	/*virtual*/ LLQuaternion getCharacterRotation()	{ return mRoot.getWorldRotation(); }
+	/*virtual*/ LLVector3 getCharacterVelocity()	{ return LLVector3::zero; }
+	/*virtual*/ LLVector3 getCharacterAngularVelocity()	{ return LLVector3::zero; }
+	/*virtual*/ void getGround(const LLVector3& in_pos, LLVector3& out_pos, LLVector3& out_norm);
+	/*virtual*/ BOOL allocateCharacterJoints(U32 num)	{ return FALSE; }
+	/*virtual*/ LLJoint* getCharacterJoint(U32 i)	{ return i < mJoints.size() ? mJoints[i] : NULL; }
+	/*virtual*/ F32 getTimeDilation()				{ return 1.f; }
+	/*virtual*/ F32 getPixelArea() const			{ return 100000.f; }
+	/*virtual*/ LLPolyMesh* getHeadMesh()			{ return NULL; }
+	/*virtual*/ LLPolyMesh* getUpperBodyMesh()		{ return NULL; }
+	/*virtual*/ LLVector3d getPosGlobalFromAgent(const LLVector3& position)	{ return LLVector3d(position); }
+	/*virtual*/ LLVector3 getPosAgentFromGlobal(const LLVector3d& position)	{ return LLVector3(position); }
+	/*virtual*/ void addDebugText(const std::string& text) {}
+	/*virtual*/ const LLUUID& getID()				{ return mID; }
+
+	S32 getNumJoints() const						{ return (S32)mJoints.size(); }
+
+private:
+	LLUUID mID;
+	LLJoint mRoot;
+	std::vector<LLJoint*> mJoints;
+};
+
+/**
+ * @brief Parses clip data the way a keyframe motion does after reading it
+ * from the VFS, which also seeds the keyframe cache for every other
+ * instance with the same id.
+ */
+class LLTestClipLoader : public LLKeyframeMotion
+{
+public:
+	LLTestClipLoader(const LLUUID& id) : LLKeyframeMotion(id) {}
+
+	BOOL load(LLCharacter* character, U8* data, S32 size);
+};
+
+/**
+ * @brief Writes a clip in the .anim format into buffer and returns its size.
+ *
+ * The clip is shaped like the standard animations: 30 keys a second on the
+ * first num_joints joints of TEST_SKELETON, a pelvis track, and every
+ * seventh joint held with a single key. Each joint swings with its own
+ * phase so samples differ from joint to joint; seed varies the amplitudes.
+ */
+S32 write_test_clip(std::vector<U8>& buffer, F32 duration, S32 seed, BOOL loop, S32 num_joints);
+
+#endif // LL_LLANIMATIONTESTUTIL_H
@@ -0,0 +1,276 @@
+/**
+ * @file llcompressedpatch_tut.cpp
+ * @brief Tests and benchmark for decoding wind and cloud patches when sampled
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "bitpack.h"
+#include "indra_constants.h"
+#include "llcompressedpatch.h"
+#include "llmath.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "patch_code.h"
+#include "patch_dct.h"
+#include "lltut.h"
+
+#include <vector>
+
+namespace
+{
+	const S32 PREQUANT = 8;
+	const S32 MAX_PACKET_SIZE = 4096;
+
+	// A breeze with some gusts, like the wind and cloud layers a simulator
+	// sends.
+	void make_field(std::vector<F32>& field, S32 size, F32 phase)
+	{
+		field.resize(size * size);
+		F32 base = ll_frand(8.f) - 4.f;
+		for (S32 k = 0; k < size * size; k++)
+		{
+			field[k] = base + 2.f * sinf((k % size) * 0.4f + phase) + ll_frand(0.5f);
+		}
+	}
+
+	// Codes one patch per field the way the simulator sends a layer, and
+	// returns the packet size in bytes.
+	S32 pack_layer(U8* buffer, S32 size, S32 layer_type, std::vector< std::vector<F32> >& fields)
+	{
+		LLBitPack bitpack(buffer, MAX_PACKET_SIZE);
+		init_patch_coding(bitpack);
+
+		LLGroupHeader group;
+		group.stride = size;
+		group.patch_size = size;
+		group.layer_type = layer_type;
+		code_patch_group_header(bitpack, &group);
+
+		init_patch_compressor(size, size, layer_type);
+		std::vector<S32> coefficients(size * size);
+		for (size_t f = 0; f < fields.size(); f++)
+		{
+			LLPatchHeader header;
+			F32 zmax, zmin;
+			prescan_patch(&fields[f][0], &header, zmax, zmin);
+			compress_patch(&fields[f][0], &coefficients[0], &header, PREQUANT);
+			code_patch_header(bitpack, &header, &coefficients[0]);
+			code_patch(bitpack, &coefficients[0], 0);
+		}
+		code_end_of_data(bitpack);
+		return bitpack.flushBitPack();
+	}
+
+	// What the viewer did before LLCompressedPatch: every patch decoded as
+	// soon as the packet arrives.
+	void decode_eager(U8* buffer, S32 packet_size, std::vector< std::vector<F32> >& fields)
+	{
+		LLBitPack bitpack(buffer, packet_size);
+		LLGroupHeader group;
+		decode_patch_group_header(bitpack, &group);
+		group.stride = group.patch_size;
+
+		S32 coefficients[LARGE_PATCH_SIZE*LARGE_PATCH_SIZE];
+		init_patch_decompressor(group.patch_size);
+		set_group_of_patch_header(&group);
+		for (size_t f = 0; f < fields.size(); f++)
+		{
+			LLPatchHeader header;
+			fields[f].resize(group.patch_size * group.patch_size);
+			decode_patch_header(bitpack, &header, FALSE);
+			decode_patch(bitpack, coefficients);
+			decompress_patch(&fields[f][0], coefficients, &header);
+		}
+	}
+
+	void unpack_lazy(U8* buffer, S32 packet_size, LLCompressedPatch* patches, S32 count)
+	{
+		LLBitPack bitpack(buffer, packet_size);
+		LLGroupHeader group;
+		decode_patch_group_header(bitpack, &group);
+		for (S32 p = 0; p < count; p++)
+		{
+			patches[p].unpack(bitpack, group);
+		}
+	}
+
+	F32 max_difference(const std::vector<F32>& a, const std::vector<F32>& b)
+	{
+		F32 difference = 0.f;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			difference = llmax(difference, fabsf(a[i] - b[i]));
+		}
+		return difference;
+	}
+
+	// One region's wind packet, in the benchmark
+	struct WindRegion
+	{
+		U8 mPacket[MAX_PACKET_SIZE];
+		S32 mPacketSize;
+		LLCompressedPatch mPatch[2];
+		BOOL mDecodePending;
+		std::vector< std::vector<F32> > mVelocity;
+	};
+}
+
+namespace tut
+{
+	struct compressedpatch
+	{
+	};
+
+	typedef test_group<compressedpatch> compressedpatch_t;
+	typedef compressedpatch_t::object compressedpatch_object_t;
+	tut::compressedpatch_t tut_compressedpatch("compressed_patch");
+
+	template<> template<>
+	void compressedpatch_object_t::test<1>()
+	{
+		// A wind packet (X and Y) and a cloud packet are unpacked, then a
+		// 32x32 patch is decoded before anything samples them, which leaves
+		// the patch decoder set up for another size.  Decoding them late
+		// must still give exactly what decoding them on arrival gives.
+		U8 wind_packet[MAX_PACKET_SIZE];
+		U8 cloud_packet[MAX_PACKET_SIZE];
+		U8 large_packet[MAX_PACKET_SIZE];
+
+		std::vector< std::vector<F32> > wind(2);
+		make_field(wind[0], NORMAL_PATCH_SIZE, 0.f);
+		make_field(wind[1], NORMAL_PATCH_SIZE, 1.f);
+		std::vector< std::vector<F32> > cloud(1);
+		make_field(cloud[0], NORMAL_PATCH_SIZE, 2.f);
+		std::vector< std::vector<F32> > large(1);
+		make_field(large[0], LARGE_PATCH_SIZE, 3.f);
+
+		S32 wind_size = pack_layer(wind_packet, NORMAL_PATCH_SIZE, WIND_LAYER_CODE, wind);
+		S32 cloud_size = pack_layer(cloud_packet, NORMAL_PATCH_SIZE, CLOUD_LAYER_CODE, cloud);
+		S32 large_size = pack_layer(large_packet, LARGE_PATCH_SIZE, 0, large);
+
+		std::vector< std::vector<F32> > wind_eager(2);
+		std::vector< std::vector<F32> > cloud_eager(1);
+		decode_eager(wind_packet, wind_size, wind_eager);
+		decode_eager(cloud_packet, cloud_size, cloud_eager);
+
+		LLCompressedPatch wind_patches[2];
+		LLCompressedPatch cloud_patch;
+		unpack_lazy(wind_packet, wind_size, wind_patches, 2);
+		unpack_lazy(cloud_packet, cloud_size, &cloud_patch, 1);
+		ensure_equals("patch size", wind_patches[0].getPatchSize(), (S32)NORMAL_PATCH_SIZE);
+
+		std::vector< std::vector<F32> > large_eager(1);
+		decode_eager(large_packet, large_size, large_eager);
+
+		std::vector<F32> lazy(NORMAL_PATCH_SIZE * NORMAL_PATCH_SIZE);
+		for (S32 c = 0; c < 2; c++)
+		{
+			wind_patches[c].decompress(&lazy[0]);
+			ensure("lazy wind matches eager wind", lazy == wind_eager[c]);
+			ensure("wind within quantization error", max_difference(lazy, wind[c]) < 0.5f);
+		}
+		cloud_patch.decompress(&lazy[0]);
+		ensure("lazy cloud matches eager cloud", lazy == cloud_eager[0]);
+
+		// Decoding again, after another layer, gives the same values
+		std::vector<F32> again(NORMAL_PATCH_SIZE * NORMAL_PATCH_SIZE);
+		wind_patches[0].decompress(&again[0]);
+		ensure("decoding twice matches", again == wind_eager[0]);
+	}
+
+	template<> template<>
+	void compressedpatch_object_t::test<2>()
+	{
+		// Wind packets arrive for every region about every ten frames, and
+		// only the agent's region is sampled each frame.  Decoding on arrival
+		// is timed against decoding when sampled; both must sample the same
+		// velocities.  Timings are logged, not asserted, since they vary by
+		// machine.
+		const S32 NUM_REGIONS = 64;
+		const S32 NUM_FRAMES = 1000;
+		const S32 FRAMES_PER_PACKET = 10;	// roughly what a simulator sends at 45 fps
+		const S32 GRID_COUNT = NORMAL_PATCH_SIZE * NORMAL_PATCH_SIZE;
+
+		std::vector<WindRegion> regions(NUM_REGIONS);
+		for (S32 r = 0; r < NUM_REGIONS; r++)
+		{
+			std::vector< std::vector<F32> > fields(2);
+			make_field(fields[0], NORMAL_PATCH_SIZE, 0.f);
+			make_field(fields[1], NORMAL_PATCH_SIZE, 1.f);
+			regions[r].mPacketSize = pack_layer(regions[r].mPacket, NORMAL_PATCH_SIZE, WIND_LAYER_CODE, fields);
+			regions[r].mVelocity.resize(2);
+		}
+
+		const char* names[] = { "decoded on arrival", "decoded when sampled" };
+		F32 sampled[2] = { 0.f, 0.f };
+		for (S32 pass = 0; pass < 2; pass++)
+		{
+			S32 decodes = 0;
+			LLTimer timer;
+			for (S32 frame = 0; frame < NUM_FRAMES; frame++)
+			{
+				for (S32 r = 0; r < NUM_REGIONS; r++)
+				{
+					if ((frame + r) % FRAMES_PER_PACKET != 0)
+					{
+						continue;
+					}
+					WindRegion& region = regions[r];
+					if (pass == 0)
+					{
+						decode_eager(region.mPacket, region.mPacketSize, region.mVelocity);
+						decodes++;
+					}
+					else
+					{
+						unpack_lazy(region.mPacket, region.mPacketSize, region.mPatch, 2);
+						region.mDecodePending = TRUE;
+					}
+				}
+
+				WindRegion& agent_region = regions[0];
+				if (pass == 1 && agent_region.mDecodePending)
+				{
+					agent_region.mPatch[0].decompress(&agent_region.mVelocity[0][0]);
+					agent_region.mPatch[1].decompress(&agent_region.mVelocity[1][0]);
+					agent_region.mDecodePending = FALSE;
+					decodes++;
+				}
+				S32 k = frame % GRID_COUNT;
+				sampled[pass] += agent_region.mVelocity[0][k] + agent_region.mVelocity[1][k];
+			}
+			F64 time = timer.getElapsedTimeF64();
+
+			llinfos << "Wind fields " << names[pass] << ": " << NUM_REGIONS << " regions, "
+					<< NUM_FRAMES << " frames, " << (time * 1.0e3) << " ms, "
+					<< decodes << " field decodes" << llendl;
+		}
+
+		ensure_equals("sampled the same wind", sampled[1], sampled[0]);
+	}
+}
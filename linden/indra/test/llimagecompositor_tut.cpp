@@ -0,0 +1,980 @@
+/**
+ * @file llimagecompositor_tut.cpp
+ * @brief Tests for the software avatar bake compositor against a model of
+ * the GL compositing it replaces
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llimage.h"
+#include "llimagecompositor.h"
+#include "llmath.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "v4color.h"
+#include "lltut.h"
+
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	// What an OpenGL 1.x driver does with the same drawing, in floating
+	// point: textures sampled from the mip levels GL_LINEAR_MIPMAP_LINEAR
+	// picks (box filtered, as GL generates them), exact bilinear and
+	// trilinear weights, an unquantized current color and one rounding per
+	// blend into the 8 bit framebuffer.
+	class GLModel
+	{
+	public:
+		GLModel(S32 width, S32 height)
+		:	mWidth(width), mHeight(height), mFramebuffer(width * height * 4, 0), mUnsure(width * height, false),
+			mBlendType(LLImageCompositor::BT_ALPHA), mTextureBlendType(LLImageCompositor::TB_MULT),
+			mWriteColor(true), mWriteAlpha(true), mAlphaTest(true), mColor(1.f, 1.f, 1.f, 1.f)
+		{
+		}
+
+		void drawRect()
+		{
+			for (S32 i = 0; i < mWidth * mHeight; i++)
+			{
+				shade(i, mColor, false);
+			}
+		}
+
+		void drawImage(const LLImageRaw* image, BOOL is_mask)
+		{
+			S32 w = image->getWidth();
+			S32 h = image->getHeight();
+			S32 components = image->getComponents();
+			std::vector<U8> data(image->getData(), image->getData() + image->getDataSize());
+			while ((w >= mWidth * 2 || h >= mHeight * 2) && !(w & 1) && !(h & 1))
+			{
+				std::vector<U8> level((w / 2) * (h / 2) * components);
+				LLImageBase::generateMip(&data[0], &level[0], w / 2, h / 2, components);
+				data.swap(level);
+				w /= 2;
+				h /= 2;
+			}
+
+			// GL_LINEAR_MIPMAP_LINEAR between this level and the next
+			F32 ratio = llmax((F32)w / mWidth, (F32)h / mHeight);
+			F32 blend = 0.f;
+			std::vector<U8> next;
+			if (ratio > 1.f && !(w & 1) && !(h & 1))
+			{
+				blend = logf(ratio) / F_LN2;
+				next.resize((w / 2) * (h / 2) * components);
+				LLImageBase::generateMip(&data[0], &next[0], w / 2, h / 2, components);
+			}
+
+			for (S32 y = 0; y < mHeight; y++)
+			{
+				for (S32 x = 0; x < mWidth; x++)
+				{
+					LLColor4 texel = sample(data, w, h, components, is_mask, x, y);
+					if (blend > 0.f)
+					{
+						texel = lerp(texel, sample(next, w / 2, h / 2, components, is_mask, x, y), blend);
+					}
+
+					bool has_color = (components != 1) || !is_mask;
+					bool has_alpha = (components == 2) || (components == 4) || ((components == 1) && is_mask);
+					LLColor4 fragment;
+					for (S32 k = 0; k < 4; k++)
+					{
+						if (mTextureBlendType == LLImageCompositor::TB_MULT)
+						{
+							fragment.mV[k] = texel.mV[k] * mColor.mV[k];
+						}
+						else
+						{
+							bool from_texture = (k == 3) ? has_alpha : has_color;
+							fragment.mV[k] = from_texture ? texel.mV[k] : mColor.mV[k];
+						}
+					}
+					shade(y * mWidth + x, fragment, true);
+				}
+			}
+		}
+
+		void multiplyMask(std::vector<U8>& mask)
+		{
+			for (S32 i = 0; i < mWidth * mHeight; i++)
+			{
+				mask[i] = (U8)((mask[i] * (mFramebuffer[i * 4 + 3] + 1)) >> 8);
+			}
+		}
+
+		S32 mWidth;
+		S32 mHeight;
+		std::vector<U8> mFramebuffer;
+		// Pixels a textured fragment passed or failed the alpha test by less
+		// than a rounded texel could change. Which way that goes is up to the
+		// implementation, so they are left out of comparisons.
+		std::vector<bool> mUnsure;
+
+		LLImageCompositor::EBlendType mBlendType;
+		LLImageCompositor::ETextureBlendType mTextureBlendType;
+		bool mWriteColor;
+		bool mWriteAlpha;
+		bool mAlphaTest;
+		LLColor4 mColor;
+
+	private:
+		LLColor4 sample(const std::vector<U8>& data, S32 w, S32 h, S32 components, BOOL is_mask, S32 x, S32 y) const
+		{
+			F32 v = llclamp((y + 0.5f) * h / mHeight - 0.5f, 0.f, (F32)(h - 1));
+			S32 y0 = (S32)v;
+			S32 y1 = llmin(y0 + 1, h - 1);
+			F32 fy = v - y0;
+			F32 u = llclamp((x + 0.5f) * w / mWidth - 0.5f, 0.f, (F32)(w - 1));
+			S32 x0 = (S32)u;
+			S32 x1 = llmin(x0 + 1, w - 1);
+			F32 fx = u - x0;
+
+			LLColor4 texel;
+			for (S32 k = 0; k < 4; k++)
+			{
+				F32 a = channel(data, w, x0, y0, components, is_mask, k);
+				F32 b = channel(data, w, x1, y0, components, is_mask, k);
+				F32 c = channel(data, w, x0, y1, components, is_mask, k);
+				F32 d = channel(data, w, x1, y1, components, is_mask, k);
+				texel.mV[k] = ((a * (1.f - fx) + b * fx) * (1.f - fy) + (c * (1.f - fx) + d * fx) * fy) / 255.f;
+			}
+			return texel;
+		}
+
+		static F32 channel(const std::vector<U8>& data, S32 w, S32 x, S32 y, S32 components, BOOL is_mask, S32 k)
+		{
+			const U8* texel = &data[(y * w + x) * components];
+			switch (components)
+			{
+			case 1:
+				if (is_mask)
+				{
+					return (k == 3) ? texel[0] : 255.f;
+				}
+				return (k == 3) ? 255.f : texel[0];
+			case 2:
+				return (k == 3) ? texel[1] : texel[0];
+			case 3:
+				return (k == 3) ? 255.f : texel[k];
+			default:
+				return texel[k];
+			}
+		}
+
+		void shade(S32 i, LLColor4 fragment, bool textured)
+		{
+			for (S32 k = 0; k < 4; k++)
+			{
+				fragment.mV[k] = llclamp(fragment.mV[k], 0.f, 1.f);
+			}
+			if (mAlphaTest && textured && fabsf(fragment.mV[3] - 0.01f) < 1.f / 255.f)
+			{
+				mUnsure[i] = true;
+			}
+			if (mAlphaTest && !(fragment.mV[3] > 0.01f))
+			{
+				return;
+			}
+			U8* pixel = &mFramebuffer[i * 4];
+			F32 src_alpha = fragment.mV[3];
+			F32 dst_alpha = pixel[3] / 255.f;
+			for (S32 k = 0; k < 4; k++)
+			{
+				if ((k < 3) ? !mWriteColor : !mWriteAlpha)
+				{
+					continue;
+				}
+				F32 src = fragment.mV[k];
+				F32 dst = pixel[k] / 255.f;
+				F32 value;
+				switch (mBlendType)
+				{
+				case LLImageCompositor::BT_ALPHA:
+					value = src * src_alpha + dst * (1.f - src_alpha);
+					break;
+				case LLImageCompositor::BT_DEST_ALPHA:
+					value = src * dst_alpha + dst * (1.f - dst_alpha);
+					break;
+				case LLImageCompositor::BT_ADD:
+					value = src + dst;
+					break;
+				case LLImageCompositor::BT_MULT_ALPHA:
+					value = src * dst_alpha;
+					break;
+				default:
+					value = src;
+					break;
+				}
+				pixel[k] = (U8)llround(llclamp(value, 0.f, 1.f) * 255.f);
+			}
+		}
+	};
+
+	// Sends the same drawing to the compositor and the GL model.
+	class Pair
+	{
+	public:
+		Pair(S32 width, S32 height) : mModel(width, height) {}
+
+		void setBlendType(LLImageCompositor::EBlendType type)
+		{
+			mCompositor.setBlendType(type);
+			mModel.mBlendType = type;
+		}
+		void setTextureBlendType(LLImageCompositor::ETextureBlendType type)
+		{
+			mCompositor.setTextureBlendType(type);
+			mModel.mTextureBlendType = type;
+		}
+		void setColorMask(bool write_color, bool write_alpha)
+		{
+			mCompositor.setColorMask(write_color, write_alpha);
+			mModel.mWriteColor = write_color;
+			mModel.mWriteAlpha = write_alpha;
+		}
+		void setAlphaTest(bool enable)
+		{
+			mCompositor.setAlphaTest(enable);
+			mModel.mAlphaTest = enable;
+		}
+		void setColor(const LLColor4& color)
+		{
+			mCompositor.setColor(color);
+			mModel.mColor = color;
+		}
+		void drawRect()
+		{
+			mCompositor.drawRect();
+			mModel.drawRect();
+		}
+		void drawImage(LLImageRaw* image, BOOL is_mask = FALSE)
+		{
+			mCompositor.drawImage(image, is_mask);
+			mModel.drawImage(image, is_mask);
+		}
+
+		LLImageCompositor mCompositor;
+		GLModel mModel;
+	};
+
+	// Soft blotches over a gradient, closer to clothing textures and alpha
+	// masks than noise.
+	LLPointer<LLImageRaw> make_image(S32 width, S32 height, S32 components)
+	{
+		LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+		U8* data = image->getData();
+		F32 phase[4], freq[4];
+		for (S32 k = 0; k < 4; k++)
+		{
+			phase[k] = ll_frand(F_TWO_PI);
+			freq[k] = ll_frand(12.f) + 1.f;
+		}
+		for (S32 y = 0; y < height; y++)
+		{
+			for (S32 x = 0; x < width; x++)
+			{
+				for (S32 k = 0; k < components; k++)
+				{
+					F32 u = (F32)x / width;
+					F32 v = (F32)y / height;
+					F32 value = 0.5f + 0.35f * sinf(phase[k] + freq[k] * u) * cosf(freq[k] * v - phase[k]) + ll_frand(0.15f) - 0.075f;
+					*data++ = (U8)llclamp(llround(value * 255.f), 0, 255);
+				}
+			}
+		}
+		return image;
+	}
+
+	LLColor4 random_color()
+	{
+		return LLColor4(ll_frand(), ll_frand(), ll_frand(), ll_frand());
+	}
+
+	// Largest and mean channel difference between two RGBA images, skipping
+	// the pixels in unsure.
+	void compare(const U8* a, const U8* b, const std::vector<bool>& unsure, S32& max_diff, F32& mean_diff)
+	{
+		max_diff = 0;
+		F64 total = 0.0;
+		S32 count = 0;
+		for (S32 i = 0; i < (S32)unsure.size(); i++)
+		{
+			if (unsure[i])
+			{
+				continue;
+			}
+			for (S32 k = 0; k < 4; k++)
+			{
+				S32 diff = llabs((S32)a[i * 4 + k] - (S32)b[i * 4 + k]);
+				max_diff = llmax(max_diff, diff);
+				total += diff;
+				count++;
+			}
+		}
+		mean_diff = (F32)(total / llmax(count, 1));
+	}
+
+	// Drawings rendered by Mesa's llvmpipe with the GL state the bake uses:
+	// textures uploaded with GL_GENERATE_MIPMAP, GL_LINEAR_MIPMAP_LINEAR,
+	// GL_CLAMP_TO_EDGE, glTexEnv, glAlphaFunc, glBlendFunc and glColorMask as
+	// LLRender sets them, and a screen aligned quad over a 16x16 RGBA pbuffer
+	// read back with glReadPixels(). Each starts from a pattern drawn with
+	// BT_REPLACE and no alpha test, draws an image with the state given and
+	// then a rect with mRectBlendType.
+	struct GLReferenceDrawing
+	{
+		LLImageCompositor::EBlendType mBlendType;
+		LLImageCompositor::ETextureBlendType mTextureBlendType;
+		bool mAlphaTest;
+		bool mWriteColor;
+		bool mWriteAlpha;
+		S32 mFormat;	// 0 is a one component mask, else the component count
+		S32 mSize;
+		LLImageCompositor::EBlendType mRectBlendType;
+	};
+
+	const S32 GL_REFERENCE_SIZE = 16;
+
+	const GLReferenceDrawing GL_REFERENCE_DRAWINGS[] =
+	{
+		{ LLImageCompositor::BT_ALPHA, LLImageCompositor::TB_MULT, false, true, true, 0, 16, LLImageCompositor::BT_ADD },
+		{ LLImageCompositor::BT_DEST_ALPHA, LLImageCompositor::TB_MULT, true, true, true, 3, 64, LLImageCompositor::BT_MULT_ALPHA },
+		{ LLImageCompositor::BT_ADD, LLImageCompositor::TB_MULT, true, true, false, 1, 24, LLImageCompositor::BT_REPLACE },
+		{ LLImageCompositor::BT_MULT_ALPHA, LLImageCompositor::TB_MULT, false, false, true, 4, 32, LLImageCompositor::BT_ALPHA },
+		{ LLImageCompositor::BT_REPLACE, LLImageCompositor::TB_MULT, true, true, true, 2, 8, LLImageCompositor::BT_DEST_ALPHA },
+		{ LLImageCompositor::BT_ALPHA, LLImageCompositor::TB_REPLACE, true, true, true, 0, 32, LLImageCompositor::BT_ADD },
+		{ LLImageCompositor::BT_DEST_ALPHA, LLImageCompositor::TB_REPLACE, false, true, false, 3, 8, LLImageCompositor::BT_MULT_ALPHA },
+		{ LLImageCompositor::BT_ADD, LLImageCompositor::TB_REPLACE, true, true, true, 1, 16, LLImageCompositor::BT_REPLACE },
+		{ LLImageCompositor::BT_MULT_ALPHA, LLImageCompositor::TB_REPLACE, true, true, true, 4, 64, LLImageCompositor::BT_ALPHA },
+		{ LLImageCompositor::BT_REPLACE, LLImageCompositor::TB_REPLACE, false, true, true, 2, 24, LLImageCompositor::BT_DEST_ALPHA },
+		{ LLImageCompositor::BT_ALPHA, LLImageCompositor::TB_MULT, true, false, false, 0, 64, LLImageCompositor::BT_ADD },
+		{ LLImageCompositor::BT_DEST_ALPHA, LLImageCompositor::TB_MULT, true, true, true, 3, 24, LLImageCompositor::BT_MULT_ALPHA },
+		{ LLImageCompositor::BT_ADD, LLImageCompositor::TB_MULT, false, true, true, 1, 32, LLImageCompositor::BT_REPLACE },
+		{ LLImageCompositor::BT_MULT_ALPHA, LLImageCompositor::TB_MULT, true, true, true, 4, 8, LLImageCompositor::BT_ALPHA },
+		{ LLImageCompositor::BT_REPLACE, LLImageCompositor::TB_MULT, true, true, false, 2, 16, LLImageCompositor::BT_DEST_ALPHA },
+		{ LLImageCompositor::BT_ALPHA, LLImageCompositor::TB_REPLACE, false, true, true, 0, 8, LLImageCompositor::BT_ADD },
+		{ LLImageCompositor::BT_DEST_ALPHA, LLImageCompositor::TB_REPLACE, true, true, true, 3, 16, LLImageCompositor::BT_MULT_ALPHA },
+		{ LLImageCompositor::BT_ADD, LLImageCompositor::TB_REPLACE, true, false, true, 1, 64, LLImageCompositor::BT_REPLACE },
+		{ LLImageCompositor::BT_MULT_ALPHA, LLImageCompositor::TB_REPLACE, false, true, false, 4, 24, LLImageCompositor::BT_ALPHA },
+		{ LLImageCompositor::BT_REPLACE, LLImageCompositor::TB_REPLACE, true, true, true, 2, 32, LLImageCompositor::BT_DEST_ALPHA },
+	};
+
+	const S32 NUM_GL_REFERENCE_DRAWINGS = sizeof(GL_REFERENCE_DRAWINGS) / sizeof(GL_REFERENCE_DRAWINGS[0]);
+
+	// What glReadPixels() returned for each drawing, RGBA, bottom row first
+	const char* GL_REFERENCE_PIXELS[] =
+	{
+		"ca964effb45a5cff86419bff507cddff61b89fff92d46effb5aa4dffdf728bffd542bcffa56caeff8aa175ff68ce3cff76b76eff9382a2ffb957ccffe05691ff"
+		"9b576aff7652a5ff4f98cdff74c197ff95bd60ffb5a256fff16587ffd73edbffa374abff77a966ff67ce4dff73ad74ff8f85b4ffc637beffe46487ffc29a43ff"
+		"7471a4ff5498bfff89bf85ffa9bb51ffc9915ffffa4f9cffc256d8ffa27f98ff7dad60ff5ecd57ff7ba779ffa469bdffcb33b6fff2777bffbba844ff97c779ff"
+		"64a9a9ff8dc682ffa5be47ffcf8d67ffdf42a1ffae64d0ff909997ff7ebb66ff5fcb51ff85a08dffb167c6ffd44cacffd9876dffb5ae52ff9dd182ff69b5b9ff"
+		"90da7effbda837ffe27064ffe246a2ffb168c1ff92a28bff75c54fff6ebc58ff86959fffba55d9ffd556a1ffd0915dffaab14dff87c77cff66a7c0ff5375b4ff"
+		"bea233ffe6776fffc244aaff9f7ebaff82a082ff5ec94eff71b55dff9986abffb54fcaffe16895ffbc985affacb85dff82cf88ff3b93d2ff6e64afff93546fff"
+		"ed688bffbc50baffa07e9eff72ac6fff4fd538ff72b86cffa373b4ffcb56c0ffda7289ffb79f57ff9dd254ff66c998ff3689d4ff7c6094ff9b5e66ffc48658ff"
+		"b467b7ff9c8b9dff69b670ff49e03eff72ad6effab69bbffcc4db6ffd9797dffb6a152ff86d863ff5dc7adff5e7ed3ff885695ffa76e5affca8e54ffdbc38dff"
+		"949099ff5bcd67ff52ca41ff90a585ffb175b8ffd7599fffce7c77ffb6a93bff78e76cff48b3adff6486cdff935483ffb17c5affd2a059ffdfd994ffb6ccebff"
+		"4adb5cff5fcc4aff91928effb36bc6ffdf6499ffc87f6dff9db834ff77db71ff499dbdff6f7abcffa0537affbb7e52ffe49b69ffd9dc9affa6bacdff819095ff"
+		"70c15fff988894ffc968bcffe46e9bffc08965ff92ca3aff72d688ff5a95b9ff876aa7ffa95d77ffc77747ffe4b96bffbaeeaaff9ea8ccff7d8983ff675d5cff"
+		"af899cffc75cbcffd56c89ffbf9451ff8bcf52ff6abe87ff5b92beff9073a1ffad5a75ffd0823efff0b580ffb6e6b7ff8ba5bdff7b7d7dff624f53ff817a69ff"
+		"d143c1ffda7686ffa5a548ff82d356ff66af98ff7b8fc8ff926999ffba615affde9947ffdacf78ffb5cfbdff8ca1a3ff6b7c7fff6b563cff8b7464ffafb8adff"
+		"d57085ffa6a741ff81dd6bff5bab9dff7f84b6ff965696ffc96553fff4a246ffc6d383ff9eb8bdff8d8c97ff656274ff744e37ff917c7affb6bdafffedd6b9ff"
+		"97c42bff7aca72ff5fa19bff8379baff974287ffc87649fff4ae5effbecb94ff97bac0ff82849bff605d5aff766244ffa78b7dffbfc5c3ffddbfa3ffbe9f7eff"
+		"69c780ff679ca6ff876bb9ffb44081ffd07d3bffe5a56cffaee19cff97a2bdff748796ff4f4a4fff7b6c47ffae998effd4c2beffcfbca0ffb4976cff915f46ff",
+		"3d3a36333e3b38352f2d2b28171514132f2c2a283e3b38353d3a36332b2927253835322f3f3c39353634312e21201e1c312e2c2a3c3936333d3a363326242220"
+		"2f2d2b281211100f312e2c2a3d3a36333d3a36332f2d2b283835322f3f3c3935312e2c2a1d1b1a182f2d2b283e3b38353d3a3633302e2b29393633303f3c3935"
+		"2a2826243f3c39353d3a36332a282624393633303f3c39353633302d211f1d1c322f2d2a3d3a36333e3b3835262422203d3a36333f3c393534312f2c14131211"
+		"3e3b3835262422203a3734313f3c393534312f2c181716142f2c2a283d3a36333d3a3633302e2b293d3a36333f3c3935312e2c2a1a18171634312f2c3d3a3633"
+		"3734322f3f3c393535322f2d171514132f2d2b283d3a36333d3a3633302e2b293c3936333f3c39353634312e1d1b1a1834312f2c3f3c39353d3a36332d2b2826"
+		"312e2c2a151413122e2b29273d3a36333b3835322c2a28263b3835323f3c393532302d2b171615142b2926243e3b38353f3c3935312e2c2a39363330403c3936"
+		"312e2c2a3f3c39353e3b38352a2826243a3734313e3b38353734322f1f1d1c1a2a2826243e3b38353e3b38352f2d2b28393633303f3c393534312f2c1e1d1b1a"
+		"3e3b3835282624223c3936333e3b3835312e2c2a171514132b2926243f3c39353b383532272523213d3a36333e3b3835312e2c2a131211102f2d2b283f3c3935"
+		"3d3a3633403c39363633302d1a18171634312f2c3c3936333d3a3633302e2b29393633303f3c39353633302d171514132f2d2b283e3b38353d3a37342a282624"
+		"3734322f1e1d1b1a34312f2c3e3b38353d3a3734312e2c2a393734313f3c393532302d2b19181615312e2c2a3e3b38353e3b38352a282624393633303e3b3835"
+		"2d2b28263d3a36333d3a36332d2b28263d3a36333e3b38353634312e1a181716312e2c2a3e3b38353c3936332d2b28263c3936333e3b3835322f2d2a17161514"
+		"3c3936332b2927253b3835323f3c3935322f2d2a1e1d1b1a2a2826243d3a36333d3a3633312e2c2a3835322f3f3c393535322f2d151413122f2d2b283c393633"
+		"3d3a3633403c393634312f2c141312112f2d2b283d3a36333d3a3633312e2c2a393633303e3b38352f2d2b28141312112b2926243e3b38353d3a3734302e2b29"
+		"322f2d2a1d1b1a18322f2d2a3d3a36333d3a3633312e2c2a3b3835323f3c39352f2d2b28171615142e2b29273f3c39353d3a3633262422203b3835323e3b3835"
+		"2a2826243f3c39353e3b38352b292725393633303f3c39353835322f1a1817162e2b29273f3c39353c3936332d2b28263b3835323f3c3935322f2d2a211f1d1c"
+		"3d3a3633312e2c2a3b383532403c39362f2d2b28151413122d2b28263e3b38353b3835322d2b28263b3835323f3c39352f2d2b281d1b1a18312e2c2a3f3c3935",
+		"72685e5072685e9072685ed472685ea572685e5072685e3472685e8672685ec872685eab72685e6d72685e2872685e5772685eb272685ed372685e8372685e2c"
+		"72685eb472685ec272685e7a72685e4272685e5272685e9e72685ee272685e9f72685e5a72685e3472685e8272685ed172685ebc72685e7472685e2372685e5d"
+		"72685eb172685e6f72685e2772685e6e72685eb972685ec972685e8072685e3d72685e4972685e9472685eeb72685e9c72685e5772685e3272685e7672685eca"
+		"72685e4572685e2f72685e7b72685ec672685eb472685e6772685e1d72685e5972685eb772685ed572685e8772685e4272685e4672685e9f72685ed672685e95"
+		"72685e5072685e8d72685ed472685e9972685e4b72685e3572685e7c72685ec572685ebe72685e6e72685e1372685e6372685ea672685ed272685e8072685e34"
+		"72685ea472685eca72685e8d72685e3e72685e4672685e9372685ed772685ea172685e5a72685e3072685e7e72685ec772685ebb72685e6b72685e1d72685e6a"
+		"72685eaf72685e6b72685e2772685e6a72685eb372685eca72685e7e72685e4372685e4d72685e9c72685ede72685ea172685e5272685e2b72685e8372685ec8"
+		"72685e5972685e3572685e8272685ed072685ebd72685e7672685e1c72685e5e72685ea772685ecb72685e7f72685e4472685e4272685e9572685edd72685e98"
+		"72685e4a72685e9172685ed672685ea372685e4d72685e2572685e7f72685ec972685eb472685e6172685e2272685e6472685eb172685ec972685e8a72685e2e"
+		"72685eaa72685ec372685e8072685e2f72685e4872685e9e72685ed872685ea572685e5d72685e3272685e7e72685ebb72685eb972685e6472685e2572685e64"
+		"72685eb772685e6472685e1e72685e6f72685ea772685ec472685e7e72685e2f72685e4a72685e9e72685ede72685e9372685e4572685e2572685e7072685ecc"
+		"72685e4672685e3172685e7172685ebc72685eb772685e6672685e2a72685e5c72685eb472685ecb72685e8b72685e3872685e4e72685e8e72685ed972685ea6"
+		"72685e4272685e9b72685ee372685ea372685e5672685e3972685e7272685ed372685eb472685e7072685e2072685e6f72685eb472685ed772685e8a72685e3b"
+		"72685ea972685ec672685e8672685e2e72685e3e72685e9f72685ee772685ea772685e4c72685e2d72685e7c72685ec872685eb572685e6572685e1672685e67"
+		"72685ec172685e6c72685e2972685e6172685ea972685ed072685e8972685e3f72685e4872685e8d72685ee672685e9872685e4572685e2972685e8572685ec1"
+		"72685e4772685e3872685e7272685ec672685eb372685e5e72685e1472685e6072685ea272685ec272685e8f72685e4372685e5672685e9072685eeb72685e92",
+		"437cd42980c8a214b7ab4708d7643f0b84239d054371d8131db483255ac71c2d99827528da30cc1ab054b9127194601829e84221508a89239248ec18c63b9409"
+		"86d5aa0bb3b44502c2613e08921f96164a6dd82d1cc07c4171c426409e6f6131da2fb71aa75aae0b72a64c1228e4380d4a89960b8f4fd519cd388f1ebb8e381e"
+		"b4a64c07c15747118b1792245265d73f2bb57b5b63c62340ac767322d82cc211a75fa2065ea758062be6320d479a9a208d4cdd34d4429233b88c352c8bcf651f"
+		"cc58401b9526a3345767dc3f1abc823f67cb1a28a3727117da31c409b058b7035ea24f0d24dd361d569599388a4ede49d4438747c491282e79d953183eafb909"
+		"8e26a32a4a6dda2e2cb5782c59c11d1598807609ec24c70bb254b5096eac521528e72d2e49879a4a933cdf53ca317e37c792361d82d1600d4aa2ac043d5bbf04"
+		"4a7acd1e24b07c0e5ec924139e7f7214e737cd12a24bb50d6c964e1d30dd3c354397863d8343d739ca389020c8813d1183cd66053eaebb05326aba0d742f5721"
+		"32b37f226cce1f24a36e7623de37bb1ba951b011649e55202ed842254b969b268b50e81cca36930eca7e2e0d7edc640c44afb60c345abc187920642fb5693447"
+		"5bc72838a8715f31d728bf1da54daa0d61a3541521e23118438c84129143de0dc8367d1aca832e1c8ad1561541b0be0d326bbe226e2a642daf673536dbc1852f"
+		"ac76692ded2cbe16a34ab108729861082ed54206528995129249e82dc03e8e2fc7922b2877d761203caeb50f3d64b518702f681fa66e2322d7be8e1394bad610"
+		"e828c00b9c5bb10570aa500731dd3b15528c972a8d3fe743bd348144c57e28347fcb64194eabb20d3d5bb6126b21690ea877250cd6c07e1d9dc0d41e5d7f9c23"
+		"ae4dac0769954b1131dc3227458d9b3c9041e658c8318e3dbb922e2275d15e10499fad063f61b7077a1e5f0dac65351fcebb7837a1bfe1376281902f212a461c"
+		"729a631920d834344d8692418951ec41c736922ab580321684cb53094ab5b6023b59c30c6d1a611fba633730e2b8774e8ebdd94c5784972b132f34164d5b540b"
+		"24d23b2a4198912e8952ec28c4438612bb872c078cd8660a47a0b307335ac71671195c2bbc652e4bdab5785397cfe6375d72961d1126320b4d564d039f9cac05"
+		"509c8f1d8c4ce213cc358c0fb485331777db5f1240adbd0e3e5eb41c7d1c6f35b2643338e0b98e3b90bfd01f61759c0e1a2e47035b5247059f99aa0dd0e6cb1f"
+		"9443ea1fd23b7d27b8832d2581ce531a4ea8b0103f5fb81f7d1c6427ab762228d7b07f1da0bde00b62729f0c1527380c6053490c8ea3a818cdd0c135b6986647"
+		"cf318d36bb8d2e358dd9561e42aec10c2f67be136d2c6b15ad643412dcb08412a0cfe01d58818f181a3741164d5c4a0e8b9fa322dedcc22eab8e68327b43162b",
+		"322c25162c272115231e1a131c1916161d1a172123211e29302b272c38322b2939322b1d39322a153a312a13362f2918322c27232c27222a23211e2e201e1b2e"
+		"2d2722132b25201326231d1525211c1a272220252c27222a342d282a352e2925322b2518312a2513322a2513322d261c322c2726302b272c2b27232c2925212c"
+		"221e190f28221d12312a241837302a203c342e2a3c362f2e37322b282f29241f231e1a121d1a160f221e1a152924211f342d282a39332d2e3c342e283c352f25"
+		"221d190d28221e12322d261c39322c253d37302e3c362f2e36302a232e28221a221d180f1f1b160f24201c182c27212135302a2e3a332d2e39332c2339322b1d"
+		"2d2721112c2721152d2823202e2a25292b28232e2c27222a2e28231f2f2a2416302b2411342c271337302a1d39322b2636312a2c302b262923211c1d1f1b1818"
+		"2f2823132f29231a2f2a25252e29242a2b26222a292521252b25211a2e272313332b2613362f29183b342d233b342e2936302a2a2d292425231e1b181d181512"
+		"2b25201a2e29241f37312b293a342e2c3b342d263630291d2e2823132a241f1227231e1829242020302a252a322e282e342d2828332d281f352d2713342e270d"
+		"2c26221f302b252337312b2c3b332d2a39322b21342d27182d27221229231e1228231f1c2a262225302b272e322d282e322b2725322c261c342d2712352e270d"
+		"352e2a25332d2826322c272c2c28232924211d1f221f1a1628221d132d272216342d281f39332c263c362f2c3a332c29302b251f28241f16221d19121e1b1611"
+		"36312a29342f2929322b272a2b262225231e1b18221d191328221d132f28221a36302a253b342e293c342e2a36302a252e28231828231e13231e1a13201d1815"
+		"312c272e322d282c36312a2837302a1f352d2712312b240f2e2923152e28231f2f29252a2e29252e2c2823282b26211f2b2620123029220f373129163b332c1a"
+		"332e2830332e282c362f2923352f271a332d250f322c240f312a2418302b2623302b272e2d29252e2a26212328231f182a241e0f2f29220f3831291a3d352d20"
+		"3b352f2e38312a2a2d27231f25221d161f1b160f221e1a122e28231f352f29263a342e2e3c332d2a352e291f2f2924152a251f1127221d1326221e2025211f25"
+		"3a342e2c353029262b26211a25201c13201c181224201c182f2a252537302a2a3a322c2a38312b25332c26182e2822122a25201228231f18282320252924202a"
+		"312b2626302b252030292413312c2411342d2615362f291f36302a2a332e282e2b27222625221e1d221d1a13231f1a112b262115342f281d3e373029423b342e"
+		"2c2721212e29231d322c25113730290f3e362e163f372f213a342e2e322d292e25211f251d19161a181513111d1a150f2c2722163a342c204840382c4f453d32",
+		"fffffff9fffffff8fffffffcffffe7e3ffdbf6ffffbfffceffffffaaffffffeffffffffffffffffdfffcffb2ffb1ff8ffff7ffd0ffffffffffffffffffffffed"
+		"ffffffffffffffcfffffd2e1ffcdefffffecffc0ffffffbbffffffffffffffffffffffe9ffdbffadffc1ff89ffffffe3ffffffffffffffffffffffb6fffeffb4"
+		"ffffefb8fffec7dfffc5f9ffffffffccffffffe7fffffffffffff1ffffffefdaffd5ffa4ffe6ffa7fffffffffffffffffffffff3f6ffff97fbe7ffb3ffc6ffff"
+		"ffe2cbfaffe3fff1ffffffe6fffffffcffffffeaffffe2ffffffede1ffdbff95ffffffcdffffffffffffffffffffffcce2ffff8bffe6ffc9ffebffffffffffff"
+		"fffffffbfffffffffffffffafffff9deffffd1fffffbfecfffedffadfffffff2fffffffffffff3ffeeffffbcddffff7dffe0ffcdffffffffffffffffffffffe5"
+		"ffffffffffffffdaffffd7e2ffffc5fffffcffc7ffffffc7ffffffffffffffffffffe6eabefff8a7fdfcff97fff7ffdaffffffffffffffffffffffc6ffffffb8"
+		"feffffbaffffc3e9ffffd8ffffffffc9ffffffebffffffffffffffffefffd4e0c7fff5a1ffffffb0fffffff5fffffffffffffff6ffffff9fffffffb2eeffffff"
+		"f7ffa5f7fffffcebffffffe5fffffffffffffff7ffffe0fed5ffc6e2ebffff99ffffffcbffffffffffffffffffffe3c9fffff281fdffffc8fffffffafffffffe"
+		"fffffff6fffffff9fffffffdffffffe0fbffbbffc6ffddccffffffadfffffff1fffffffffffffffcffffd6beffffff82fdffffcafffffffffffffffffffffff0"
+		"ffffffffffffffcefffff5d8e5ffb1ffe3ffebcdffffffbfffffffffffffffffffffe0eaffffd4a0ffffff99ffffffdcfffffffffffffffffffffbbefffffbbb"
+		"ffffffb5ffffdbe6e8ffbaffffffffd5ffffffebffffffffffffffffffffc7daffffcfa8ffffffaafffffff4ffffffffffffffebffffe89bfffff2c0fffffffc"
+		"fdffcdfdf2ffdeefffffffe4fffffffffffffff0fff6fdffffffaad1ffffec99ffffffc8fffffffffffffffffffbf1ccffffd680ffffffc7fffffffeffffffff"
+		"fffff9f8fffffffffffffff4ffe8ffe1fff6e9ffffffabceffffffa7ffffffe9ffffffffffffffffffecceb9ffffd591ffffffc9ffffffffffffffffffffffeb"
+		"ffffffffffffffccffdcffdaffe8d8ffffffcecbffffffc3ffffffffffffffffffe8ffeeffdbb6b0ffffe390ffffffdcfffffffffffffffffffffbc0e0dae0ad"
+		"ffffffbeffd3ffe5ffffd2fafffff4ccfffffff0fffffffffffffffff8c5e7e3ffe9b799ffffffaffffffffaffffffffffffffedffedde96c3cbd7bff4fffff1"
+		"ffd0f9ebffffdbeaffffffe7fffffffffffffff5f9f1ffffffb8cad3fffac5a1ffffffcaffffffffffffffffffffffc8d1c9ba7fe2dbe5bbffffffffffffffff",
+		"0b080551130e088d1b130bc31d150cd419120bb3100c07780b08054d050402250d09065f110c077e1a130bbe20170ee619120bb5100c07780906044106040229"
+		"1a120bbc1e150dd818110ab2120d08850806043c0403021e0c09055b130e088e1b130bc21e160ddc19120bb3100c07760b0805510403021d0b08054f130e088e"
+		"18110aaf120d088209070445050402240c090558120d08851a130bc11e150ddb19120bb6100b07750906043f050402270c090558140e099219120bb51f160de2"
+		"09060441030201160b080552120d088019120bb61f160de519120bb5100b07740b0805510403021d0c09055a120d088319120bb81e150dd918110ab1110c077f"
+		"0a070448110c077f1a120bbc20170ee8161009a00f0b066e0806043c060402290a07044b120d088619120bb920170ee918110ab2120d08800b08054e05040228"
+		"18110ab01f160de218110ab2110c077b090704430604022a0b080552110c077d18110aaf1d150cd217110aab120d08850b0805500403021c0c09055a110c077e"
+		"18110aaf110c077e09070445040302200c080556120d08821b130bc31e160ddd161009a1110c077d0a0704490604022a0c080555130d08891b130cc41f160de2"
+		"09070443050302230a070449120d088019120bb31d150dd6161009a1120d08850a07044b050302230a07044a110c077f19120bb91e150dda18110aac110c0779"
+		"0d09055d130d08871a120bba1e160ddd16100aa2100c07770906043f0604032d0c080556110c077d18110aad20170ee817100aa6100b07750906044105040224"
+		"1b130bc31d140cd118110ab0110c077b0806033b050402260a070448130e088b1a120bbc1f160de21610099f120d08820a0704460403021e0c09055a120d0884"
+		"18110ab1100b07730b080551060402290a07044a120d08841a120bbb1f160de219120bb3120d08830b08054f050302220c09055b120d088119120bb320170ee8"
+		"0806033b050402280c09055a110c077c1a130bc11f160de416100aa3100c07760b08054f0403021a0d09055d110c077a1a130bbe1f160de119120bb3110c0779"
+		"0c090557140e099119120bb61d150dd517100aa70f0b066e0b08054f050302220d09065e120d08841b130bc21e150dd817110aab0f0b07700806033b0604032b"
+		"19120bb51e160dde17110aab120d08850806043c050402240a070448110c077b18110ab220170ee818110ab1100b077509070443050402280c09055b120d0882"
+		"19120bb3100b07730b0805520604032c0c090557110c077d19120bb91f160ddf17100aa8120d08840b08054d0604032c0b08054d130e088a1a120bba1d150dd6"
+		"090604420403021e0a07044a120d088618110ab11e150dd816100aa2110c077e090704450604022a0a07044a110c077f1b130cc41f160de516100aa2110c077c",
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2"
+		"d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2d1c6bcb2",
+		"3f353543404a4760627c667a8a7d826e945ea15c6246833c41575937475f453f4a41343c392d292e43382e413f583d4a46654d436d546b3992458b3f826f945c"
+		"51445b7f7f7177908a887b6a72677e4d453c5a323a3a452e3e3f353149463239513f2e4a4e39355b455b4a605d8e655689827c41834a7c3c6144774b3d4e5148"
+		"7748687a705e655649525037393e452b362f3629493d3b3669633d506b6e376f5b563f844e4b5773666c5f5071735f3561505e324335513834333832393e363a"
+		"47374138393c3b2c394d492d45424b30673c4d4688674c6974903d89517440854a44475c5f4650465b514b304647432c3432342a3933453e4f4a4e5b71714d68"
+		"4042513740625d335d6b63398b4f61559451537b62743d84416b366444463a454f333f3739302f264448462c3e555b3d474661556b4362799c7960927f92476f"
+		"4e697c3a7fa17e418a6b5e546d3f46604745335f3b51314d3d4130354033332c5335472e51556536447a7a4b5c727c6e8a4b74907f4d52765d653e593f5e313d"
+		"77706a3b6e6a4c454941364338322c4134342b34484e363e685a4b426d4865395648803b50809d5e698c7c7073595c6f683c4863433e333f36432c30383d2d29"
+		"504e3b3734332a2b36372c41473933566b5c455989895e53756e793e53468c404f5486525a625f545d5647523e35313839302f353a432e375064383276624d39"
+		"3e523541415936625f453b748d52527191866b595f826e3c43516b3746385d3d483c423a3d393132434336413f3c37494a4336497271453a91925a3f7d676a57"
+		"50883b818073429387424d677056594d455e5231394b4c2e3731362b46323d375b4d495651694660456341625f473c578c5b493f857b543b616f594a4043534b"
+		"70733b71694840505137463c35373729363f3a2949464c376d3d5f526846596b5576577d4f944e76665c3853713c3c37624b433344534239333936313c354440"
+		"4f48363f3730312c3935412c49525a326b7572498a637a6c794575934f605c874e7842625e6333455e4035304532342b3536312c3a5449424d4d5c57713e6f68"
+		"4149423a433c5a375f4f783a887e8c548c8c8374625a6881423c4a68484d384b46492c3239332a264635382d3d3c453c4967655b708688809866948b83458273"
+		"505f703c82479a43886187526a756a5d4759505d3b3c3e4f3b322d3249402c325252332e52534636433d5a4c5f5e7d718a8e948e84758079614b665c3e39463c"
+		"79517e3a723e71484f4d514837483b40373b333b4532313b6545313f676c3e375580533d4f62715c6643766a755d76706465625c4246453f3633383039333129"
+		"4f364d363932373239494149465d4256664f3d558a413a50796a4a4250925a3f4d6a5c4d5c415e535f3c5b5647434642353a332e373e3b33533a4433704d3a37",
+		"413a3237433b33325c564f41837f7b4389878434706e6c2d47434040322c27442e27203830282032423c354168635f438f8c8a31a09e9b2e86827e3f5f5a5544"
+		"423a322f4b443c3a57524c455754503f504e4d27403d3a353e3934443d3630413931282e48413a3a635e58457f7c783e8886842b6e6b68344c4844433a332d42"
+		"393129303d3730413e3a3544413f3c344e4c4a2a57534f3f56504b4449423b384139312c544e4741615d5844625f5c355654522a433f3c3c37322d443730283a"
+		"3029213a39342f444f4b473f7876742a898784347a7671445a544d413f372f303d362e37403a34453d3a363f3e3c3a2c4f4d4a33524d49434e47414140382f2d"
+		"4a443d426d69654393908d35a19f9d297975713f504b454538312a3a2d251d2f322c25413e3a3544595654377a78762b7e7a774067625c454e4740393f372f2f"
+		"69635e447c78753d7e7c7a2b6562603044403b44362f2941332b2335372f2837514c464574716d3e908e8c2f8b8885356b66624349423c41352d2531322a2334"
+		"58534f4355524f364d4b492a413e3b3c3f3a35443f37303b40383134544d464076726d44888582357c79772d5a5652403e393345322a23372f261e2e3b342e3f"
+		"3733303d413e3c2d54514e355e5a564359534d414a423b344e463f385c565144625e5a3f5654522b3e3b383537332e443630294138302831433b3437625c5644"
+		"716f6c2e8886832e8884813d6f6a6544443c34353931292f3d373041393530443b3835364644422f534f4b4055504a4547403836484038335e5852416c686344"
+		"9997952b8885823564605c43453f394131292130312a23383b363045514d4a3d716e6c2d807d7b3674706b445a544e414038303040393239433e3845413d3940"
+		"737170274f4c483f3f3a3545342c253b3229212e423b3540635e5a43898784349997952a7d7a763f59534e443d362f393129212c342e284138342f444f4c4938"
+		"3a3734353f3a3643403a33423e362f344a433c3969635e44827f7b3f8e8c8b286d6b683446413d43332c26412c231b2a332c253948423d44686461409492902b"
+		"6b67643c625c5744514a433a49423a3358514b415e595543595653354644422a3d39363d3d3832453b332c373e362e315b554e4279757044918e8b358d8c8a24"
+		"78746f4458524c42403830353d362e3a3d3832453d3a363e4e4c4a2c575552335f5b5743564f4941443c34314c453e395e58534466635f3e5856542f47444231"
+		"504b45453b332c3b31292131362f294144403b445e5b59377977752a7d79763c6d6862454b443d393e362e32413b344145403b4444413e3542403e2b4e4b483c"
+		"302a23412f271f33362f28394f4a4445777470409d9b982e969390356f6b66444c464041342c24312f282037322c264443403c3f5c59572d716e6b3579757042",
+		"a3701565832a6bb9404da5c01992d66558d57d277db74384ae854ccfe13f8f89ac3edd478079a15d42bc4ea315de2cce519584708b50be18bc19bd74de6175ce"
+		"662069c6495ac5ae1f8ecf5057ca7c3a88bb3689b67a5bdcd63b9881a634dd3d737b8f563fb244a927d437b05b9186668759da23c51ca184d86266db9ba12d8c"
+		"395dc3ae3b9bae526fe1653aa59b25a7d6666acebf30a9809056cc1c6c8481712bca3ecd32ca4ca86f798c5b9a3dd238d42ea58ac1784ce79cb92a8763d17d2d"
+		"4fb39f4381db69519c932ba3d35274c9b724ad68845fca164c91797d25e12ec74eb760aa69769649b336e242cf3b9c90b3844fcf7fb93f725dcd8c222c83ce6a"
+		"8ac84f66ba8525b5e24c84c1b32ec7587d59bb2342a6658412e92cdf5aa4629e8e62ad42bd26cc5ddf568ca6a57e3bc27fd54e7c50b99c181e85e9705948a7d7"
+		"c57c45c4e04192b09930c8587a73a12c34b0619835d927ea648e6b8f9a5dc532bb14bc52d84c77bea38c2db078cc5e6d3ebeac2a1f75de77523e89e49a39499f"
+		"ca2c8aa69937da545f8aa74d3bb05c9037c42ddb5e8f6f799e4cc822d820b06fc86c60c08eab28a86bd85d5f39a8aa2c365ccd9666347ce8a0553281c7804425"
+		"8942e23f4c91904e2bc141ab4ebf32ce7d8d8d65a941d019d034b66fb96a6acd8da81daa58de634c1aa3bc434f59c3a6791b7ad0a15a2978db8d6024bedf9c76"
+		"50a07a5618d641aa4ebd53b98d748b68ad2ad71fe4479b89b77b59e675b9339a4ad56e40228ec04c5843b3ad823077c7ab63186ae29f6217a5e5ad8083a0d2c7"
+		"20ec2fc251af5ab18c72955cb732d53edc579492a38244d672bf3f7d39b68a302485d75b683baaba8a2b6bc3c5671d67d6ab6b22afd0c18f7495bbdb48588191"
+		"679c6999965ab541cc13c848c94d86958b9c42d760d6447d34aa95313b69d46172309bc8964b59b4c8822354c0c2823595cebe8b678cb8d4305a768742242a35"
+		"b24caf3fe525cf50c76a83ad8baa39c057d761721ea9a61a4c6dde6c7d2399c3a85241a6de843d44b1c87c4796c4dca25c78a2d424376a793c3222267b716b65"
+		"d936ba5aa8766cb082bc18b94bd2615c1299a22c4963c9867a1a7dd7b1633095d5a0483ea3d3915d86b1d9ad42719ec813374a775c4128237e738374b9c4c8d8"
+		"ac7766bc6cc118b136d8635d3584b73e5656cb8f8a2e81dcbb5a3587de9f4b2ba1e79e627da6e6ba3c718cc22f29475e66473b34988c8a8fc8d5dae6ccc8ac97"
+		"63c5349c29cc7350378bc34c7545b3a79d3b64d2c57c2982caa55a2a9ad7ae6a6c95d4cd385089b539193a55625d4141a29a9084d4ded7dfcbaca58a9e72543c"
+		"2abd8f334077cf53792faea1a93368c2d188286eb5bc791491c6b56d5491bfd5255a75a744212a567f5d5f38a0ac9ba3d5e3e5cdc4a88d75846d42305b22366e",
+		"645b544c544d47402d2926222c2825214c46403a5f5750486c625a5270665e55645b544c524b453f2e2a27232d292622453f3a34645c544c6d645b5371675e56"
+		"2a27232023201d1b46403b36645c544c6e655c5470665e55625a524b4b453f392e2a272325221f1c443e39345d554e476d645b5371685f56645c544c544d4740"
+		"4b453f395f5750496c635b5271675e56625a524b564f48422e2a272324211e1b4e47413b625a524b6e645c5370665e55635b534c534c463f37322e2a201d1b18"
+		"6e645c5370675e55675f574f524b453f2c2825212c282521423c3732625a524b6d635b5370675e55625a524b4e47413b38332f2b2e2a27234e47413b635b534b"
+		"645b544c574f494238332f2b2926231f4e47413b5f5750496c635b5271685f56675f574f524b453f2d292622302c2824433d3833645b544c6e645c536f655d54"
+		"3a35302c25221f1c4f48423c625a524b6f655d5470665e55696058505049433d322e2a26211e1b194f48423c5e564f4770665e5571675e56635b534b554d4740"
+		"4b453f396159524a6c625a526f665d55645c544c564f48422f2b2824201d1b184b453f395f5750496c625a526f665d55655d554d564f48422e2a2723211e1b19"
+		"6d635b536f665d55685f574f534c463f2c2825212c28252148423c375d554e476e655c5470675e55675e564e534c463f38332f2b2d292622423c37325c544d46"
+		"6159524a514a443e2b2724212b282421453f3a34625a524b6d635b5370665e55675e564e544d474038332f2b2b27242146403b366159514a6f655d5471685f56"
+		"35312c282e2a2623453f3a345f5750496e655c546f665d55675f574f4f48423c302c292523201d1b4b453f39645c544c6c635b5270675e55696058504b453f39"
+		"49433e385d554e476d645b5371685f56675e564e4e47413b2e2a26231e1c1917413c37325f5750496f655d5471675e56645b544c4d46413b3b36312d2e2a2723"
+		"6d645b5371675e56655c554d524b453f2a2723202c2825214d46413b5e564f4770665e556f665d55665d554e4b453f39312d29252b28242149433e385f575049"
+		"69605850554e474134302c282b272421433e3833635b534c70665e5570675e55635b534c514a443e3934302b2926231f4f48423c645c544c6e655c5470675e55"
+		"2d2926221e1c19174c46403a5e564f476c625a526f665d55685f574f5049433d3934302b25221f1c4a443e386159514a70665e5570675e55625a524b544d4740"
+		"453f3a35625a524b6c635b5271685f56625a524b524b453f3b36312d2f2b2824443e39345e564f476d635b536f665d55625a524b4e47413b36312d292c282521"
+		"6f665d5571685f56685f574f5049433d2b2824212a272320433e38335d554e476d635b536f655d5469605850574f4942322e2a26302c2824433e38335d554e47",
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f"
+		"2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f2d23190f",
+		"a7a29a8fa7a0978ea69c958ca39b938ca29c938ca39d938ea79f9491aaa09693aaa09a92a9a19c8fa6a39b8da6a19a8ca89c968da69c948da29c938da39d938e"
+		"a49e958da39c948ca59c948ca79d958da7a0948fa7a19592aba39795aaa19892a89f998fa59e978da39d968ca29b938ca49b948da59c948ea7a19591a7a59592"
+		"a59f958ca7a1968da79e958eaaa09691aca39593aaa29692a79f9690a49d958da39c958ca39c958ca59e968da69e968ea69e9690a8a09692aca69693aaa59591"
+		"aaa5988daaa4978ea89f9590a79e9490a69f948fa59e948ea29b938ca49c958ca59e988ca7a0998da9a0988faba19892a8a09693a7a09592a7a0948ea6a0948d"
+		"a8a2958ea7a0948ea59c938ea39b938da39c938da49f968ea79e988da99e9b8daaa29b8faaa49b91a8a09792a79e9591a79e948fa49c938da29b938ba39d948c"
+		"a49d938da39c938da59c948ea69d958fa6a2988fa7a39a8eaba09d8eaa9f9b8ea8a1988fa7a09690a49d948fa29b938ca39c938ca69e948da79f968da7a1998d"
+		"a59e948fa79f9591a79f9791a8a19a90aca49d8fa9a19a8ea69e988ea49d968ea39d948da39c938da59c938ea79d948ea7a0968da8a3998eaca39d90aaa09b8f"
+		"aba19794aaa19994a8a19a90a7a0998ea69e978da49d958ca39b938ca39c948da59f948fa7a19590aa9f9590ab9f978fa9a4998ea7a2998ea69e988ea69c978e"
+		"a79e9790a69d968ea59d968da39c958ca39c948ca49e958ea79e9590a9a09592aba49592aaa39691a79e968ea69e978da7a0978da59d958da39b948ca39b958e"
+		"a39b948ca29b938ca49d958ca6a0988da6a0988fa7a09792aaa19694aaa19592a8a0958fa69e958da49c958ca39b948ca39c948ca59e968ea79d9891a89c9992"
+		"a69c978ca89e998da7a29a8ea9a59a91aba19893a99f9692a79f948fa59e948ea39c948ca39c948ca59d968da69e978ea7a19a91a7a29a92aba09992ab9e9891"
+		"aa9d9c8daaa09c8fa8a49990a6a1968fa79d958fa59c938ea39c938ca39d948ca49d958ca79f988eaaa09a90aba29c92a9a39b93a7a19891a89e968fa69c948d"
+		"a89d988ea69d968ea59e948ea39c938da39c938da49c948ea7a0958da9a3988daaa19b8fa9a09c91a8a29a92a7a09891a69e958ea49c948da29b928ba39c938c"
+		"a39c948da39c938da59e948ea69f948fa69d958fa79f978faba69a8eaaa49a8ea89f998fa59d978fa49d958ea39c948da49c938ca69d948da69e948da7a0948d"
+		"a59d948fa79f9590a8a29591aaa39691aca0988faaa0988ea7a1988ea49f978ea39b948da39b948da59e958ea7a0958ea69f948da7a0958eaba3968faba3978f"
+		"aca29695aba39694a7a29591a7a0958ea89d958ca59d958ca29c948ca39e968da59d9890a79d9891aba39791ada59690a7a1948ea59f948da79f958ea79e958e",
+		"39857d6c55746da17e796eee5c5c55ae315f585c18736f2e29847d4e4d978e916e8c83cf618f86b7498c8389207c753d1c615c344155507a616760b76d746bce"
+		"686860c5656860be4968618a207c763d229d95413daba3745c968cad70857bd3567e76a22a615c501045431f323b375e4c655e906d7970cd658279be4398907e"
+		"537c749d2f877f580db3ac1931bdb45d56928aa3758077dd5c756dad395e586b1e3a3639254f4b4645686283657d74be718278d5509f96982eb8af560fa49d1d"
+		"1fb9b03a1db9b0364290877d687d74c56b726acb4658528426423d4817504c2c39766f6c528b829b7b8178e95c978dad389b92691c8f88342a706a5044645d80"
+		"377b7467557068a172736bd854544e9e35544f641666622a26857e484a8f858b6d8d84ce648b81bd448b8380207e783c1c5f5b353a514c6d5d6159af6f746ad1"
+		"686962c4696e66c7416f697a1f79733a17938c2b409f96785b958bac70857bd44e817a93356e67640e4c481a32443f5e5467609e767a70de62827ab937a09768"
+		"557972a03291895f0cafa71635b7ad64569288a2787e74e35c7970ae43645e7f1e3e3b381f4b473b42665f7c657e75be718177d54aa49a8b24bfb644119d9520"
+		"22c4ba4124aaa1444a8e868c677971c2697269c744554f80273b374a1257532239746d6c598a80a87b8177e954a1979e38988f6a1788822c2b7972524c615a90"
+		"357b746458766ea773736ad95c5f58ae385c566919736d2f2e837c5747938a86688e85c45f9288b4469289851d736e362066613c40554f795c655eae6d726ace"
+		"66655dc1606b62b640665f7921827b3e209b923d3ca89f725b948bac748077db568178a2316f6a5d0f39371d2f403b58576861a5777a70e05a8178aa3c9b9371"
+		"577a71a42f948b5814b6ae262cb4ab544d958c926f8077d2627b73b94267607d2035333c2849464b4268627c6a7e75c9718279d64c9e949029b2a94e11a19920"
+		"1cc9c03423b3aa43498c8389617870b86d736bce4c5b548f233935430f59561d3d7c74735c857cad73867cda54a3999e38a3996a15908827276f69494a645c8b"
+		"3780796753726b9d77746be05258529a355c56640f5f5a1c2a8d86504a948a8b6f8c82d2698981c6478d85861d7d77361a656031394e486b5b645dab6d726acd"
+		"676960c35e6962b2426f687c1f87803a19a49c2f42a39a7d5d978db06f8279d24f807895346e67630d413e182a403b50576a62a46e786fcf5d7f76b03f9a9177"
+		"557870a02e8d85560daba31931b8af5c548d859f727e75d85a776eaa39625b6c1f312e3a28504b4c426d667c697c74c66e837acf459d94822fb1a75811a19921"
+		"18cac12d1fada43b49898189627a72ba67736bc247585286263e394710554f1e307c765b52837b9a7d8177ed539e959c3c9a92711b8d86332c6f685348605988",
+		"b9c5e293cee8b07de3cda0b8e7bb9fc6d591adb2b695df8193bec53f93dd9285c5d592d1dac4a8c8e89cc57afc7ed667d1a5a19dc2d673b9b9de9ea8bbcbbaa4"
+		"d8e5b061ecca8586edb29abed599b6c2c0a4d88aa2c2ba6098e1938ec1d185c0d9bbabb0e8a3c58cec9cc17ed6b59f9db6d46db897e29a81aebdc373c7abcc9a"
+		"f5bb8788e29f91b8c77fbcaba9abe46fa0cdb37db8e29aa6cbd092ccdab2b198ff85d854ef92bf79cdc59eaeb7da85bbaad8a59eb6babf76bc9ad28edc84a2c6"
+		"dd9d99bdc98bc59fa5a7d7648fd7a566b0e88fa3cbca99c2e1aab9a2fa93d873e5a4bb80bdc794b2ace37caea5d0aa8eb9bdcb87ca9ec6a0df909bc4ffb26887"
+		"c695c999abb3d178b1d9a896c4dc8fb3cac18cb6e993bc88f484db59dda8b091cacb93c8bae291b69ecfb179b8a6d46ad382c799f09b9ebcebc3869cdedaaa91"
+		"a3b9cb63a8d7a08ac6d589b7dcc29dbdf595c078f484d65ad2a7b08cbad488c3b4de92aab4c7b78bc3a6db7bd57eb89cf0a395b2f3c27b8ad8e2aa7bc9d0c4a5"
+		"aedea18dbed77daed8ad9e9ef690c86ce69dcc71d5b8ab9ebcda88c897e1949ea0bdb850bd8edf74e38ab3a9f8ac92b9e4cf929bcee6ab7ab3ccdd928cacc0c3"
+		"c8cb87b8e2adaca3ff7bcf6ee58fce5dc4c3a7a2b5dd83c2a6d8a39babb9c069c596d37bdc87aaadf5b08ab0dfd4998dcee0b18bb8c6d4a18eaac0c0a17b8693"
+		"e7a4b2a3f48cce78e0acbe8ec3c99cb3a8ea78b794d09d7db0b6c55bd498c896eba2a9c7edbc91b9ded8967dbee5c06da6c0e09a9f98b7c3bb909899d9b39885"
+		"f091d369d2aebc8ec0cc9db5a9e889be9ec8a37cbea3d162d38ec490efa49cbcedbd86b0d9da9f8ac3d4be839fbfdca59e9bafbabd8d8784ddb59274e9d0b8a3"
+		"d5b4b188b1cd90b783ed7e9f9bccab67c0a6ce6ce396c2a5efaf9ccae7c3799ec3ec9e54b0d1cc7599b0c9afb09eadb2cda48f9addbd9977fed7b68ce4e6eabe"
+		"aedb86c09adf8fa1a1beac67c597db68e98cbba7f7ac96c3decc8fa7c8eca7679cd2da80879fcfa9b58da4a8d19f848ee7c0a181f9d6bda4e7dfdec3c2bba48b"
+		"a1de90a2babdbc7cd5a7cb9be49db8b3f3b78cbddad6857ec6eca85faacbd68db0b3c0cac79aa0bbd2a47d85e5caa16ff9efcaa1d9dbcec0c3b6ad99b9a3928b"
+		"b9b6bc69d59ccd90ebaab1c1e8b895bdcfd88e8abde1b3619ac1e38ca5a8b9c5cba0a0b4deb39596f2cca386eaebc9a3d3d2ceb4b8b1a686ac968674b0a9a3aa"
+		"e28ad383f29ba0aee3bb7aa4c7e49078b4d4bf73a6c1d2a2aba0b5c4c7969194d5ad7759fbd1ad70e5e4cdaacfcababac3aea2a0a68e89809fa29a8fb7c7d0b9"
+		"fda4a3b7e8c8769fbdf8895e9be0cc5997b5d7a0c1a6b1c7cea696a0ddba8867ffdbb86ce7e1edaacdc2bdaabaaf9a9cbbab9aa8bab3aeaac5c4d2c1eef8ce93",
+		"4e4b474355514e494c4845414c48454155514e494744413d33312e2c2e2c2a274e4b474354514d494c4946424f4c484455514e494b474440302e2c2a2f2d2b29"
+		"4d4a46434c49464255514e4945423f3c2b292725302e2c2a4f4c484454514d494a4643404d4a464354514d4944413e3a2c2a2826373532304e4b474355514e49"
+		"54514d494845423e2826242232302e2b4f4c484454514d494845423e4f4c484455514e494c48454122211f1e373532304f4c484454514d494b4744404f4c4844"
+		"292726243a3735324f4c484454514d494c4946424f4c484454514d494c4946422422211f2f2c2a284845423e54514d494c494642524e4a4654514d494c494642"
+		"4e4b474355514e494d4a46434e4b474355514e494946423f282725232f2c2a284845423e55514e494d4a4643524e4a4655514e494c494642302e2c2a2c2a2826"
+		"4c494642514d4a4653504c4844413e3a2e2c2a2733312e2c4f4c484454514d494f4c48444f4c484454514d4944413e3a2422211f32302e2b4c49464254514d49"
+		"54514d494b47444025232220373532304e4b474355514e494845423e504c494555514e494744413d302e2c2a373532304f4c484455514e494845423e4f4c4844"
+		"2c2a28262f2d2b294845423e54514d494b474440514d4a4653504c484643403d2b2927252b2927254e4b474354514d494e4b47434c48454153504c484845423e"
+		"504c494554514d494c4845414c48454155514e4944413e3a2422211f2f2c2a284c49464254514d494a464340514d4a4654514d4944413e3a292726242f2d2b29"
+		"4f4c4844504c494555514e494744413d2f2c2a282c2a28264c49464254514d494f4c48444e4b4743534f4b474b474440262422213633312e4946423f54514d49"
+		"534f4b474b47444034322f2d37353230504c494554514d494c4845414f4c484455514e494c49464233312e2c34322f2d4a46434055514e49504c49454c494642"
+		"282725233532302d4e4b474354514d494c484541524e4a4655514e494744413d22211f1e3a3735324c48454155514e494c484541504c494553504c484c494642"
+		"4e4b474355514e494f4c48444c49464255514e494c494642252322202c2a28264e4b474355514e494d4a46434f4c484455514e494c48454134322f2d3532302d"
+		"4f4c4844504c494555514e494c4845412b2927253532302d4e4b474354514d494c484541514d4a4654514d494744413d262422213a373532504c494554514d49"
+		"53504c484c49464222211f1e34322f2d4c49464255514e494e4b4743504c494554514d494643403d32302e2b34322f2d4f4c484455514e494c4845414c494642"
+		"2422211f2f2d2b294c48454155514e494d4a46434f4c484453504c484c4946422f2c2a28373532304f4c484454514d494c4845414c48454154514d494c494642",
+		"57aadc6d90d99b6da5ba666ddc91116dda545d6da32b8d6d8b4edc6d6770aa6d43a86f6d28d3306d43c54b6d6e8d746d9b57c16dc425d46de7498d6dc1764c6d"
+		"aad9816dcea53e6ddb7d3f6dae447c6d8c26a86d6668d66d4194986d22be526d42cf146d549a536d80699f6da848de6dc52fbe6ddd556a6db68f386d84c83f6d"
+		"da8d2b6dbf58476d992e846d8545c76d546eb46d32ae7a6d23de4a6d53c2326d748d666d9460ba6dc12ad66dd648916dbb7d536d9eac1d6d68e3596d53bd9a6d"
+		"ab36706d811fa56d6a59de6d3f86ab6d28ca706d50da336d67a7466d9b768c6dbb37bf6dd123be6dc3578b6da0994d6d74b5306d5ccc666d329ba86d327ddb6d"
+		"6641b56d3f73c06d18aa996d3dce466d6ac2276d81896b6da35faa6dd932ee6dc8459c6dae736b6d82a7226d57db566d35bc946d1895cf6d5256b46d642a856d"
+		"279abc6d37c4716d49d5376d82a1466d9e777d6dc93dc36de728c36dc25f8c6d9e8e496d79b9226d46cd706d1da7a86d3c6de36d6147a86d8720626db4571e6d"
+		"4fcd626d69ba1b6d8f7f5b6dac58986de627cc6db93cb46daa76736d77ad326d5fd64a6d39be876d2a8ebe6d5c56d86d6d1c896d944d4f6dc27f246ddbb26d6d"
+		"8b9f366db5717d6dd446b16dcc21e46dad51916d7e935d6d68b5156d45d3606d1d97966d506ecb6d6c4bb06d9e23816dbe58316dd891446dc2ba786d97d5bf6d"
+		"cb528d6de924d56dba40c26d957d796d76a33f6d46e53d6d2abd676d3995ae6d674ccd6d83309b6db743686dc869166dd39b4d6db0d18f6d7fbae16d658aa86d"
+		"be30dc6d9460a06d6f88626d5ec2266d2cdf536d35a2866d5776bd6d7933bc6d961e7a6dbc613b6de1863b6dbfb4656d8ee0b56d62a4d76d5173a26d2041666d"
+		"8769916d5e9b536d42d72f6d29c8606d4882af6d665ee76d93209b6db74b616dd472216dbeb2486dabd57f6d84c0bf6d5b87b96d2b61856d25223a6d604a346d"
+		"4fb6356d2dcb3d6d3997886d6c6ec26d9144d76da52a8e6dc65e466dc98c2b6dadb6596d7bdca16d5ea7ec6d357caf6d2142676d4421276d665f536d9e90816d"
+		"34c0606d5d8e9e6d7862ce6d982db86dbd43806de2732f6db99c346d92d2806d79bcc86d4992d06d1860976d342c446d6b492a6d82746f6dad9ea56dc8dfe86d"
+		"6572b76d9548ce6db81ea16dd863576dbb9a1a6d95ba4e6d83d5a16d5d97d36d3368ab6d2e3a6a6d512b3a6d7a53496daa86766dcec2c86de0cbc36dc1a4996d"
+		"b01cba6dd93f7a6dc872486dada3316d8dd1766d6cbea76d3083d26d1d62a46d4c26516d7840166d8b7d5f6db7aaa26dd8e1ce6dcab7bb6da68b736d844c2a6d"
+		"e151636dbe88236d92b9586d6cdb876d3ba5bd6d207ac06d3837846d67233e6d7f59336db7906d6dcec8b96dcce0de6db5a1a46d7f78556d6349196d472f4f6d",
+		"2a1f28742c464da0507971bd8b8c9ede7d4092bd47316ba4223d3e751c381f49221b0f3226110c34291f154b284e30782e6551996c4f88d09b39a8e47b568cbf"
+		"4a3463db6a6577d16b7475aa4d4a6181261a3f5b16162139131610212c3215434f35197a4226238a3c5042b54e996cd46f7781cd6533729d42295b7d20323958"
+		"54295a9741374460242b2d3b0c0e1014130f1f33342d2c69555725866c7521b555422dc83d3946c2495b54ac4c5c4e7d413248611c1126321414202f1d372b50"
+		"251427321c232a341e3a3c572a334379592543a1826236c6789826e13c6227b02b2a35923529366d302d2d461415161a191a28351e1b3c5d3a3e488c66763ea5"
+		"2d38597429605b8c4b6b60b48a415ada813434c04e5c1fa526531b76212a1f551a0d15262619233337414862294f5c7c35396eae693b66cf866a4bd06b8027ae"
+		"417085c8648f71d3665744a65121288b28251461182a12401821143036222952431b42694144648a38777fb14f7d8be2703762ca603535953d421d702043115a"
+		"4c554686403f285e251e1441130d0a2b161e113f2c3c2157534a3f806f3871b75a4099d53a6c8bc2487369a852414289391720551c170e310e15081c192c123f"
+		"2124142c191f0f2d2124135e2e221b7f5350369680815fc080728ae4412d89b82f376c943b4948742f2d2343150e0c1b1e1213431e2d135a3f662a956f6743af"
+		"284e1a652b4f1a914c3826b68e424ae9897c64ca4964609a273b5e8220163e531e191e2e25241a313034205525261c712d321ea1606d33bd939c59df785962b8"
+		"4ba026dc685f35cb703141b44b313f7f253a37541523293513101c233317344e4139346744663695385b2bb04f3729e16f4d39cb64643f9c4553457f1c203349"
+		"4e5a2189462827672412203c0d0e111713282934363b4f6a522a5280653553a2547e48cf448e35d94a4f21b14b1e217e3a2825561a231b2e0f1517201b193746"
+		"262016341c121a331f1b3a5b2c4057755770719a855e7ec7814273e63c4541aa316720993c491674301d1547160b0e1e1c2424402349476a37436382692579a6"
+		"2838356d2c2b5d974a4284b28c89a7e08a8a7eca4d4452a126222c741f24144b181b0823221b0f2d311e25592828407d31626da0638092c68b5f92d66f286ab4"
+		"4b558edf60378ec867497aa75363598b27372e5a14141534140f0c262b24103e40481e6447454198383163b6575496e66a7c8dbd615b6797422d467920182a58"
+		"4d2b65884b23547327242c430c120d14151e1738341e1a665c3720916b7034b35c8d59d8405275d64c2d78b24b3a5f7d4145455f1f23243b1211162c1d181a49"
+		"1d0c1d251b12202e1b2d2a4c27522e75594125a0843322c3805f3ae33a7a42af2653478932214164361a3b4c110e11131e352b451c2f2d5f392b31936c3d22ac",
+		"dad1c9c8ddd5cec4d7d2ccaec8c5c17d9e9c9b4a888683628f8a859daaa39cbdc9c0b8c8c3bcb4c2beb8b3abc2bebb80d6d4d245cdcac76ac2beb998c2bbb5bc"
+		"ded6cec9ccc6bfbba9a4a09b74726f645452504c7c787587a8a39daacec7bfc5dad2c9c8d9d3ccbbd5d1cc93bdbab8609695934897949086a09a94b0bab3abc5"
+		"c0b9b1c298938daa726f6c796462614a9694916ebcb7b29dd6cfc9bce2d9d1c8dad3cbc2c1bcb6aa9894917f6766643d63605e6888837f9bb8b1aabdd7cec5c9"
+		"aaa39db89b979293a19f9c62bbb9b746d0ccc987d6d1cbb0d6cfc7c4d7cec5c9b0aaa4b685807c945c5a575d6563624aa09c9883c1bcb6afdcd4ccc6e0d8d0c8"
+		"c6c1bba6d1ceca7ccfcecc3dbdbab769b5b1ac98bcb6afbad0c7bec9b8b0a9c49a958fa993908c8498969444c1bebc67d5d0cb9ddcd6cfbaddd5ccc9ccc4bdc4"
+		"cecac599a8a6a4588886844f85817e8796908bacbeb6aec6d0c8bfc9c0bab3babebab599cac7c55fcfcdcb46c9c5c183bfb9b3b1c6beb7c4c9c1b9c8a19c96b3"
+		"8885827b5957564166636072918c889abeb7b1bcd7cfc7c8dcd4cdc4dcd7d1a9ccc9c674aaa8a74293918e62938e8a9ba59f99bac9c1b8c8bfb8b1c2b6b0abac"
+		"6664615b7f7d7b45b0ada984cfc9c4acdfd7cfc6e0d8cfc9cfc9c2baada9a4987e7b79605a585644736f6c80a39d97b0c7c0b8c4d9d1c9c8d4cdc7b8d4d0cb98"
+		"b3b1b041d2d0cd62d3ceca9bd3cdc6bad8cfc7c8c5bdb6c398938ea9726f6c7b5d5b59448b898665b7b2ae9bd6cfc8bde2d9d1c9ded7d0c2c5c0bba8a39f9c80"
+		"c7c5c44ab8b4b083b5afaaafc0b9b1c5c6beb6c8a7a19aba96918d949895935daeacaa45d1cdca7fdbd5cfaddad2cbc5d4ccc4c8b5afa9b985817d8d5e5b5960"
+		"827f7c6d8d8884a0a49e98bacfc6bdc9c5beb6c3beb8b3a6cac7c37cc9c7c63fcdcac769beb9b49ec2bbb4c0cfc6bec8bab3abc599938dad85827e7c8b8a884a"
+		"807c7883ada8a2afd0c8c0c6dcd4ccc9ddd7d0bad1cdc992bab8b55d959391518d89858398938daec0b8b0c7cac1b9c8bab4adb7b8b3af94c5c2c05fcfcdcb4f"
+		"c4bfbb9bd9d3ccbee1d8d0c8d6cfc8c2bcb7b1a9918e8b7b6361603f625f5d5f908b879bbbb4aebcdad2c9c9d7d0c8c2d8d2cdabd2cfcc79aaa9a748a3a09d6a"
+		"d7d1cbadd2cac3c4cec6bfc7aca69fb7847f7b9a625f5d5f6f6d6b45a7a3a087cac4beb1ded7cfc5e0d8d0c8d3cdc7bab6b2ad9884817f5f5d5c5a4a76726e83"
+		"b8b2abbec9c1b9c8b6aea7c3a19b95ad95928f7ba8a6a542c7c5c265dad5d19bd9d2cbc0dad2c9c9c8c0b9c3a09b95a9706c688258565445827f7d67b0aba79b"
+		"bfb7afc6cfc7bfc8c1bbb5bac7c3be98cdcac85dc9c7c64abebab782b8b2adabc5bdb6c5c8c0b8c9a69f99bb908b87958f8c8a5fa4a2a04cd0cdc986d8d3cdb3"
+	};
+
+	// Integer only, so the drawings get the same images on every platform.
+	LLPointer<LLImageRaw> make_pattern(S32 width, S32 height, S32 components, S32 seed)
+	{
+		LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+		U8* data = image->getData();
+		for (S32 y = 0; y < height; y++)
+		{
+			for (S32 x = 0; x < width; x++)
+			{
+				for (S32 k = 0; k < components; k++)
+				{
+					S32 t = x * (3 + (seed + k) % 5) * 256 / width + y * (2 + (seed * 3 + k) % 7) * 256 / height + seed * 37 + k * 91;
+					S32 wave = llabs((t & 511) - 256);
+					U32 hash = (U32)(x * 73856093) ^ (U32)(y * 19349663) ^ (U32)((k + 1) * 83492791) ^ (U32)(seed * 2654435761u);
+					S32 noise = (S32)((hash >> 7) % 25) - 12;
+					*data++ = (U8)llclamp(wave * 200 / 256 + 28 + noise, 0, 255);
+				}
+			}
+		}
+		return image;
+	}
+
+	LLColor4 pattern_color(S32 seed)
+	{
+		LLColor4 color;
+		for (S32 k = 0; k < 4; k++)
+		{
+			color.mV[k] = (F32)((seed * 53 + k * 97) % 101) / 100.f;
+		}
+		return color;
+	}
+
+	U8 hex_byte(const char* hex)
+	{
+		U8 value = 0;
+		for (S32 i = 0; i < 2; i++)
+		{
+			char c = hex[i];
+			value = (value << 4) | (U8)((c <= '9') ? c - '0' : c - 'a' + 10);
+		}
+		return value;
+	}
+}
+
+namespace tut
+{
+	struct imagecompositor
+	{
+	};
+
+	typedef test_group<imagecompositor> imagecompositor_t;
+	typedef imagecompositor_t::object imagecompositor_object_t;
+	tut::imagecompositor_t tut_imagecompositor("imagecompositor");
+
+	template<> template<>
+	void imagecompositor_object_t::test<1>()
+	{
+		// every blend type, texture environment and image format, drawn at
+		// the target size, minified through a mip level and magnified
+		const S32 SIZE = 64;
+		const LLImageCompositor::EBlendType blend_types[] =
+		{
+			LLImageCompositor::BT_ALPHA, LLImageCompositor::BT_DEST_ALPHA, LLImageCompositor::BT_ADD,
+			LLImageCompositor::BT_MULT_ALPHA, LLImageCompositor::BT_REPLACE
+		};
+		const S32 sizes[] = { SIZE, SIZE * 2, SIZE / 2, SIZE * 3 / 2 };
+
+		for (S32 blend = 0; blend < 5; blend++)
+		{
+			for (S32 tex_blend = 0; tex_blend < 2; tex_blend++)
+			{
+				for (S32 format = 0; format < 5; format++)
+				{
+					for (S32 size = 0; size < 4; size++)
+					{
+						Pair pair(SIZE, SIZE);
+						LLPointer<LLImageRaw> target = new LLImageRaw(SIZE, SIZE, 4);
+
+						// start from the same random contents
+						LLPointer<LLImageRaw> start = make_image(SIZE, SIZE, 4);
+						pair.setBlendType(LLImageCompositor::BT_REPLACE);
+						pair.setAlphaTest(false);
+						pair.drawImage(start);
+
+						pair.setBlendType(blend_types[blend]);
+						pair.setTextureBlendType(tex_blend ? LLImageCompositor::TB_REPLACE : LLImageCompositor::TB_MULT);
+						pair.setAlphaTest(ll_rand(2) != 0);
+						pair.setColorMask(ll_rand(4) != 0, ll_rand(4) != 0);
+						pair.setColor(random_color());
+						// format 0 is a one component mask, the others have that many components
+						S32 components = llmax(format, 1);
+						LLPointer<LLImageRaw> image = make_image(sizes[size], sizes[size], components);
+						pair.drawImage(image, format == 0);
+						pair.setColor(random_color());
+						pair.drawRect();
+
+						pair.mCompositor.execute(target);
+
+						S32 max_diff;
+						F32 mean_diff;
+						compare(target->getData(), &pair.mModel.mFramebuffer[0], pair.mModel.mUnsure, max_diff, mean_diff);
+						std::ostringstream message;
+						message << "blend " << blend << " texture blend " << tex_blend << " format " << format << " size " << sizes[size];
+						ensure(message.str() + " max difference", max_diff <= 2);
+						ensure(message.str() + " mean difference", mean_diff <= 0.25f);
+					}
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void imagecompositor_object_t::test<2>()
+	{
+		// A bake drawn the way LLTexLayerSet renders an upper body: a skin
+		// layer, clothing layers cut by alpha gradients through the alpha
+		// channel, and the mask channel gathered from their alphas. Checks
+		// the result against the GL model and logs how long a full size bake
+		// takes.
+		const S32 SIZE = 512;
+		const S32 NUM_LAYERS = 6;
+		Pair pair(SIZE, SIZE);
+		LLImageCompositor mask_compositor;
+
+		// clear
+		pair.setAlphaTest(false);
+		pair.setColor(LLColor4(0.f, 0.f, 0.f, 1.f));
+		pair.drawRect();
+		pair.setAlphaTest(true);
+
+		for (S32 layer = 0; layer < NUM_LAYERS; layer++)
+		{
+			LLColor4 net_color = random_color();
+			net_color.mV[VALPHA] = ll_frand(0.5f) + 0.5f;
+			LLPointer<LLImageRaw> local_texture = make_image(SIZE * ((layer & 1) + 1), SIZE * ((layer & 1) + 1), (layer % 3) ? 4 : 3);
+			bool has_alpha_params = (layer != 0);
+
+			if (has_alpha_params)
+			{
+				// renderAlphaMasks()
+				pair.setColorMask(false, true);
+				pair.setAlphaTest(false);
+				pair.setBlendType(LLImageCompositor::BT_REPLACE);
+				pair.setColor(LLColor4(0.f, 0.f, 0.f, 0.f));
+				pair.drawRect();
+				pair.setColor(LLColor4(1.f, 1.f, 1.f, 1.f));
+				for (S32 param = 0; param < 2; param++)
+				{
+					pair.setBlendType(param ? LLImageCompositor::BT_MULT_ALPHA : LLImageCompositor::BT_ADD);
+					LLPointer<LLImageRaw> gradient = make_image(SIZE / 2, SIZE / 2, 1);
+					pair.drawImage(gradient, TRUE);
+				}
+				pair.setBlendType(LLImageCompositor::BT_MULT_ALPHA);
+				if (local_texture->getComponents() == 4)
+				{
+					pair.drawImage(local_texture);
+				}
+				pair.setColor(net_color);
+				pair.drawRect();
+				pair.setColorMask(true, true);
+				pair.setAlphaTest(true);
+				pair.setBlendType(LLImageCompositor::BT_DEST_ALPHA);
+			}
+
+			// LLTexLayer::render()
+			pair.setColor(net_color);
+			pair.drawImage(local_texture);
+			pair.setBlendType(LLImageCompositor::BT_ALPHA);
+		}
+
+		// renderAlphaMaskTextures() with mClearAlpha
+		pair.setColorMask(false, true);
+		pair.setBlendType(LLImageCompositor::BT_REPLACE);
+		pair.setAlphaTest(false);
+		pair.setColor(LLColor4(0.f, 0.f, 0.f, 1.f));
+		pair.drawRect();
+		pair.setColorMask(true, true);
+		pair.setBlendType(LLImageCompositor::BT_ALPHA);
+		pair.setAlphaTest(true);
+
+		LLPointer<LLImageRaw> target = new LLImageRaw(SIZE, SIZE, 4);
+		LLTimer timer;
+		pair.mCompositor.execute(target);
+		F64 bake_time = timer.getElapsedTimeF64();
+
+		S32 max_diff;
+		F32 mean_diff;
+		compare(target->getData(), &pair.mModel.mFramebuffer[0], pair.mModel.mUnsure, max_diff, mean_diff);
+		ensure("bake max difference", max_diff <= 4);
+		ensure("bake mean difference", mean_diff <= 0.25f);
+		S32 bake_max_diff = max_diff;
+
+		// gatherAlphaMasks() works on a copy of the finished bake
+		LLPointer<LLImageRaw> scratch = new LLImageRaw(target->getData(), SIZE, SIZE, 4);
+		LLPointer<LLImageRaw> mask = new LLImageRaw(SIZE, SIZE, 1);
+		memset(mask->getData(), 255, SIZE * SIZE);
+		std::vector<U8> model_mask(SIZE * SIZE, 255);
+		mask_compositor.setColorMask(false, true);
+		mask_compositor.setAlphaTest(false);
+		for (S32 layer = 0; layer < 2; layer++)
+		{
+			LLPointer<LLImageRaw> gradient = make_image(SIZE, SIZE, 1);
+			mask_compositor.setBlendType(LLImageCompositor::BT_REPLACE);
+			mask_compositor.drawImage(gradient, TRUE);
+			mask_compositor.multiplyMask();
+
+			GLModel model(SIZE, SIZE);
+			model.mBlendType = LLImageCompositor::BT_REPLACE;
+			model.mWriteColor = false;
+			model.mAlphaTest = false;
+			model.drawImage(gradient, TRUE);
+			model.multiplyMask(model_mask);
+		}
+		mask_compositor.execute(scratch, mask);
+		ensure("mask channel matches", memcmp(mask->getData(), &model_mask[0], SIZE * SIZE) == 0);
+
+		llinfos << "CPU bake of " << NUM_LAYERS << " layers at " << SIZE << "x" << SIZE << ": "
+				<< (bake_time * 1000.0) << " ms for " << pair.mCompositor.getCommandCount()
+				<< " draws, max difference from GL model " << bake_max_diff << llendl;
+	}
+
+	template<> template<>
+	void imagecompositor_object_t::test<3>()
+	{
+		// against pixels captured from GL rather than the model above
+		const S32 SIZE = GL_REFERENCE_SIZE;
+		for (S32 i = 0; i < NUM_GL_REFERENCE_DRAWINGS; i++)
+		{
+			const GLReferenceDrawing& drawing = GL_REFERENCE_DRAWINGS[i];
+			LLImageCompositor compositor;
+			compositor.setBlendType(LLImageCompositor::BT_REPLACE);
+			compositor.setAlphaTest(false);
+			compositor.drawImage(make_pattern(SIZE, SIZE, 4, i * 7 + 1));
+
+			compositor.setBlendType(drawing.mBlendType);
+			compositor.setTextureBlendType(drawing.mTextureBlendType);
+			compositor.setAlphaTest(drawing.mAlphaTest);
+			compositor.setColorMask(drawing.mWriteColor, drawing.mWriteAlpha);
+			compositor.setColor(pattern_color(i * 7 + 3));
+			compositor.drawImage(make_pattern(drawing.mSize, drawing.mSize, llmax(drawing.mFormat, 1), i * 7 + 2), drawing.mFormat == 0);
+			compositor.setBlendType(drawing.mRectBlendType);
+			compositor.setColor(pattern_color(i * 7 + 4));
+			compositor.drawRect();
+
+			LLPointer<LLImageRaw> target = new LLImageRaw(SIZE, SIZE, 4);
+			compositor.execute(target);
+
+			const char* hex = GL_REFERENCE_PIXELS[i];
+			ensure_equals("reference size", (S32)strlen(hex), SIZE * SIZE * 4 * 2);
+			std::vector<U8> reference(SIZE * SIZE * 4);
+			for (S32 j = 0; j < SIZE * SIZE * 4; j++)
+			{
+				reference[j] = hex_byte(hex + j * 2);
+			}
+
+			S32 max_diff;
+			F32 mean_diff;
+			compare(target->getData(), &reference[0], std::vector<bool>(SIZE * SIZE, false), max_diff, mean_diff);
+			std::ostringstream message;
+			message << "drawing " << i << " size " << drawing.mSize;
+			ensure(message.str() + " max difference", max_diff <= 2);
+			ensure(message.str() + " mean difference", mean_diff <= 1.f);
+		}
+	}
+}
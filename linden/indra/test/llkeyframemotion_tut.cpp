@@ -0,0 +1,358 @@
+/**
+ * @file llkeyframemotion_tut.cpp
+ * @brief Tests and sampling benchmark for LLKeyframeMotion curves
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llanimationstates.h"
+#include "llanimationtestutil.h"
+#include "llcharacter.h"
+#include "lldatapacker.h"
+#include "llkeyframemotion.h"
+#include "llquantize.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "lltut.h"
+
+#include <map>
+#include <vector>
+
+namespace
+{
+	typedef LLKeyframeMotion::RotationCurve RotationCurve;
+	typedef std::map<F32, LLQuaternion> rotation_map_t;
+
+	// The keys of a curve the way they were held before: a std::map from
+	// time to the unpacked key.
+	void make_rotation_map(const RotationCurve& curve, F32 duration, rotation_map_t& keys)
+	{
+		for (S32 k = 0; k < curve.mNumKeys; k++)
+		{
+			LLKeyframeMotion::RotationKey key = curve.getKey(k, duration);
+			keys[key.mTime] = key.mRotation;
+		}
+	}
+
+	// what RotationCurve::getValue() did with the map
+	LLQuaternion sample_rotation_map(const rotation_map_t& keys, F32 time)
+	{
+		rotation_map_t::const_iterator right = keys.lower_bound(time);
+		if (right == keys.end())
+		{
+			--right;
+			return right->second;
+		}
+		if (right == keys.begin() || right->first == time)
+		{
+			return right->second;
+		}
+		rotation_map_t::const_iterator left = right;
+		--left;
+		F32 u = (time - left->first) / (right->first - left->first);
+		return nlerp(u, left->second, right->second);
+	}
+
+	// Bytes a key took in the std::map: the tree node's color and three
+	// links plus the time and the key itself.
+	const U32 MAP_KEY_SIZE = 4 * sizeof(void*) + sizeof(rotation_map_t::value_type::first_type)
+							 + sizeof(LLKeyframeMotion::RotationKey);
+}
+
+namespace tut
+{
+	struct keyframemotion
+	{
+	};
+
+	typedef test_group<keyframemotion> keyframemotion_t;
+	typedef keyframemotion_t::object keyframemotion_object_t;
+	tut::keyframemotion_t tut_keyframemotion("keyframemotion");
+
+	template<> template<>
+	void keyframemotion_object_t::test<1>()
+	{
+		// keys come in unsorted and with repeated times; the curve has to
+		// answer exactly like the std::map did, whichever way time moves
+		const F32 duration = 2.5f;
+		std::vector<RotationCurve::Key> keys;
+		rotation_map_t reference;
+		for (S32 k = 0; k < 40; k++)
+		{
+			RotationCurve::Key key;
+			key.mTime = (k % 10 == 9) ? keys[k - 3].mTime : (U16)ll_rand(65536);
+			LLQuaternion rot(ll_frand(F_TWO_PI), LLVector3(ll_frand() - 0.5f, ll_frand() - 0.5f, ll_frand() - 0.5f));
+			LLVector3 packed = rot.packToVector3();
+			key.mRotation[VX] = F32_to_U16(packed.mV[VX], -1.f, 1.f);
+			key.mRotation[VY] = F32_to_U16(packed.mV[VY], -1.f, 1.f);
+			key.mRotation[VZ] = F32_to_U16(packed.mV[VZ], -1.f, 1.f);
+			keys.push_back(key);
+
+			LLVector3 unpacked(U16_to_F32(key.mRotation[VX], -1.f, 1.f),
+							   U16_to_F32(key.mRotation[VY], -1.f, 1.f),
+							   U16_to_F32(key.mRotation[VZ], -1.f, 1.f));
+			reference[U16_to_F32(key.mTime, 0.f, duration)].unpackFromVector3(unpacked);
+		}
+
+		RotationCurve curve;
+		curve.setKeys(keys);
+		ensure_equals("repeated times collapse", curve.mNumKeys, (S32)reference.size());
+
+		LLKeyframeMotion::RotationCursor cursor;
+		for (S32 i = 0; i < 2000; i++)
+		{
+			// mostly forward playback with loops, some random jumps
+			F32 time = (i % 37 == 0) ? ll_frand(duration * 1.2f) : fmodf(i * 0.011f, duration);
+			LLQuaternion value = curve.getValue(time, duration, cursor);
+			LLQuaternion expected = sample_rotation_map(reference, time);
+			ensure("same rotation as the map", memcmp(value.mQ, expected.mQ, sizeof(value.mQ)) == 0);
+		}
+
+		// nlerp_batch() agrees with nlerp() to the bit, including pairs in
+		// opposite hemispheres and results written over the input
+		const S32 COUNT = 37;
+		std::vector<LLQuaternion> a(COUNT), b(COUNT), out(COUNT);
+		std::vector<F32> u(COUNT);
+		for (S32 i = 0; i < COUNT; i++)
+		{
+			a[i] = LLQuaternion(ll_frand(F_TWO_PI), LLVector3(ll_frand(), ll_frand(), 1.f));
+			b[i] = (i % 5 == 0) ? -1.f * a[i] : LLQuaternion(ll_frand(F_TWO_PI), LLVector3(1.f, ll_frand(), ll_frand()));
+			u[i] = ll_frand();
+		}
+		out = a;
+		nlerp_batch(COUNT, &u[0], &out[0], &b[0], &out[0]);
+		for (S32 i = 0; i < COUNT; i++)
+		{
+			LLQuaternion expected = nlerp(u[i], a[i], b[i]);
+			ensure("batch matches nlerp", memcmp(out[i].mQ, expected.mQ, sizeof(expected.mQ)) == 0);
+		}
+	}
+
+	template<> template<>
+	void keyframemotion_object_t::test<2>()
+	{
+		// the keys are kept as the file has them, so saving gives back the
+		// same bytes
+		LLTestCharacter character;
+		std::vector<U8> buffer;
+		S32 size = write_test_clip(buffer, 3.f, 5, TRUE, NUM_TEST_SKELETON_JOINTS - 5);
+
+		LLUUID id;
+		id.generate();
+		LLTestClipLoader loader(id);
+		ensure("clip parsed", loader.load(&character, &buffer[0], size));
+		ensure_equals("file size", (S32)loader.getFileSize(), size);
+
+		std::vector<U8> saved(size + 64);
+		LLDataPackerBinaryBuffer dp(&saved[0], (S32)saved.size());
+		ensure("clip saved", loader.serialize(dp));
+		ensure_equals("saved size", dp.getCurrentSize(), size);
+		ensure("saved bytes match", memcmp(&buffer[0], &saved[0], size) == 0);
+
+		LLKeyframeDataCache::removeKeyframeData(id);
+	}
+
+	template<> template<>
+	void keyframemotion_object_t::test<3>()
+	{
+		// Memory and sampling benchmark over one clip per user triggerable
+		// animation. The assets themselves come from the asset server, so
+		// the clips are synthesized to match their usual shape. Logged, not
+		// asserted beyond the results agreeing, since timings vary by machine.
+		LLTestCharacter character;
+		std::vector<LLKeyframeMotion::JointMotionList*> clips;
+		std::vector<U8> buffer;
+		for (S32 i = 0; i < gUserAnimStatesCount; i++)
+		{
+			F32 duration = 1.f + 0.25f * (i % 13);
+			S32 size = write_test_clip(buffer, duration, i, i & 1, NUM_TEST_SKELETON_JOINTS - i % 8);
+			LLTestClipLoader loader(gUserAnimStates[i].mID);
+			if (loader.load(&character, &buffer[0], size))
+			{
+				clips.push_back(LLKeyframeDataCache::getKeyframeData(gUserAnimStates[i].mID));
+			}
+		}
+		ensure_equals("every clip parsed", (S32)clips.size(), gUserAnimStatesCount);
+
+		U32 compact_size = 0;
+		U32 map_size = 0;
+		std::vector<rotation_map_t> maps;
+		std::vector<const RotationCurve*> curves;
+		std::vector<S32> first_curve;
+		for (S32 i = 0; i < (S32)clips.size(); i++)
+		{
+			compact_size += clips[i]->getMemoryUsage();
+			map_size += sizeof(LLKeyframeMotion::JointMotionList);
+			first_curve.push_back((S32)curves.size());
+			for (U32 j = 0; j < clips[i]->getNumJointMotions(); j++)
+			{
+				const RotationCurve& curve = clips[i]->getJointMotion(j)->mRotationCurve;
+				maps.push_back(rotation_map_t());
+				make_rotation_map(curve, clips[i]->mDuration, maps.back());
+				curves.push_back(&curve);
+				map_size += sizeof(LLKeyframeMotion::JointMotion) + sizeof(LLKeyframeMotion::JointMotion*)
+							+ curve.mNumKeys * MAP_KEY_SIZE
+							+ clips[i]->getJointMotion(j)->mPositionCurve.mNumKeys * MAP_KEY_SIZE;
+			}
+		}
+		S32 num_curves = (S32)curves.size();
+		first_curve.push_back(num_curves);
+
+		// play every clip for ten seconds at 60 fps
+		const S32 NUM_FRAMES = 600;
+		const F32 FRAME_TIME = 1.f / 60.f;
+		std::vector<LLQuaternion> map_results(num_curves);
+		std::vector<LLQuaternion> curve_results(num_curves);
+
+		LLTimer timer;
+		for (S32 frame = 0; frame < NUM_FRAMES; frame++)
+		{
+			for (S32 i = 0; i < (S32)clips.size(); i++)
+			{
+				F32 time = fmodf(frame * FRAME_TIME, clips[i]->mDuration);
+				for (S32 c = first_curve[i]; c < first_curve[i + 1]; c++)
+				{
+					map_results[c] = sample_rotation_map(maps[c], time);
+				}
+			}
+		}
+		F64 map_time = timer.getElapsedTimeF64();
+
+		// what applyKeyframes() does: cursors, then one batch blend per clip
+		std::vector<LLKeyframeMotion::RotationCursor> cursors(num_curves);
+		std::vector<LLQuaternion> before(LL_CHARACTER_MAX_JOINTS);
+		std::vector<LLQuaternion> after(LL_CHARACTER_MAX_JOINTS);
+		std::vector<F32> u(LL_CHARACTER_MAX_JOINTS);
+		std::vector<S32> blended(LL_CHARACTER_MAX_JOINTS);
+		timer.reset();
+		for (S32 frame = 0; frame < NUM_FRAMES; frame++)
+		{
+			for (S32 i = 0; i < (S32)clips.size(); i++)
+			{
+				F32 duration = clips[i]->mDuration;
+				F32 time = fmodf(frame * FRAME_TIME, duration);
+				S32 count = 0;
+				for (S32 c = first_curve[i]; c < first_curve[i + 1]; c++)
+				{
+					if (curves[c]->getKeys(time, duration, cursors[c], before[count], after[count], u[count]))
+					{
+						blended[count++] = c;
+					}
+					else
+					{
+						curve_results[c] = before[count];
+					}
+				}
+				nlerp_batch(count, &u[0], &before[0], &after[0], &before[0]);
+				for (S32 j = 0; j < count; j++)
+				{
+					curve_results[blended[j]] = before[j];
+				}
+			}
+		}
+		F64 curve_time = timer.getElapsedTimeF64();
+
+		for (S32 c = 0; c < num_curves; c++)
+		{
+			ensure("sampled rotations agree", memcmp(map_results[c].mQ, curve_results[c].mQ, sizeof(LLQuaternion)) == 0);
+		}
+		ensure("compact keys are smaller", compact_size < map_size);
+
+		S32 samples = NUM_FRAMES * num_curves;
+		llinfos << "Keyframes for " << clips.size() << " animations: std::map about "
+				<< map_size / 1024 << " KB, compact " << compact_size / 1024 << " KB; sampling "
+				<< (map_time * 1.0e9 / samples) << " ns/joint with std::map, "
+				<< (curve_time * 1.0e9 / samples) << " ns/joint with cursors and nlerp_batch()" << llendl;
+
+		for (S32 i = 0; i < gUserAnimStatesCount; i++)
+		{
+			LLKeyframeDataCache::removeKeyframeData(gUserAnimStates[i].mID);
+		}
+	}
+
+	template<> template<>
+	void keyframemotion_object_t::test<4>()
+	{
+		// from ANIMATION_LOD_LOW on, the detail joints keep their pose while
+		// the rest of the skeleton plays exactly as it does up close
+		std::vector<U8> buffer;
+		S32 size = write_test_clip(buffer, 2.f, 0, TRUE, NUM_TEST_SKELETON_JOINTS);
+		LLUUID id;
+		id.generate();
+		LLTestCharacter loader_character;
+		LLTestClipLoader loader(id);
+		ensure("clip parsed", loader.load(&loader_character, &buffer[0], size));
+
+		LLTestCharacter near_character;
+		LLTestCharacter far_character;
+		near_character.markAnimationDetailJoints();
+		far_character.markAnimationDetailJoints();
+		far_character.setAnimationLOD(LLCharacter::ANIMATION_LOD_LOW);
+
+		S32 num_detail = 0;
+		for (S32 j = 0; j < far_character.getNumJoints(); j++)
+		{
+			num_detail += far_character.getCharacterJoint(j)->mAnimationDetail ? 1 : 0;
+		}
+		ensure_equals("skull, eyes, collars, wrists, ankles, feet and toes", num_detail, 13);
+		ensure("pelvis animates at every LOD", !far_character.getJoint("mPelvis")->mAnimationDetail);
+		ensure("wrists are detail joints", far_character.getJoint("mWristLeft")->mAnimationDetail);
+
+		LLTestCharacter* characters[] = { &near_character, &far_character };
+		for (S32 c = 0; c < 2; c++)
+		{
+			characters[c]->getMotionController().setFixedTimeDelta(1.f / 30.f);
+			characters[c]->registerMotion(id, LLKeyframeMotion::create);
+			characters[c]->startMotion(id, 0.f);
+		}
+		for (S32 frame = 0; frame < 45; frame++)
+		{
+			near_character.updateMotions(LLCharacter::NORMAL_UPDATE);
+			far_character.updateMotions(LLCharacter::NORMAL_UPDATE);
+		}
+
+		for (S32 j = 0; j < far_character.getNumJoints(); j++)
+		{
+			LLJoint* near_joint = near_character.getCharacterJoint(j);
+			LLJoint* far_joint = far_character.getCharacterJoint(j);
+			std::string name = far_joint->getName();
+			ensure(name + " animates up close", near_joint->getRotation() != LLQuaternion::DEFAULT);
+			if (far_joint->mAnimationDetail)
+			{
+				ensure(name + " is left alone far away", far_joint->getRotation() == LLQuaternion::DEFAULT);
+			}
+			else
+			{
+				ensure(name + " animates the same far away", far_joint->getRotation() == near_joint->getRotation());
+			}
+		}
+
+		near_character.removeMotion(id);
+		far_character.removeMotion(id);
+		LLKeyframeDataCache::removeKeyframeData(id);
+	}
+}
@@ -0,0 +1,186 @@
+/**
+ * @file lllocalidtable_tut.cpp
+ * @brief Tests and lookup benchmark for LLLocalIDTable
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "lllocalidtable.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "lluuid.h"
+#include "lltut.h"
+
+#include <map>
+#include <vector>
+
+namespace
+{
+	struct Dummy
+	{
+		LLUUID mID;
+	};
+}
+
+namespace tut
+{
+	struct localidtable
+	{
+		typedef LLLocalIDTable<Dummy*> table_t;
+	};
+
+	typedef test_group<localidtable> localidtable_t;
+	typedef localidtable_t::object localidtable_object_t;
+	tut::localidtable_t tut_localidtable("localidtable");
+
+	template<> template<>
+	void localidtable_object_t::test<1>()
+	{
+		// basic set / find / remove
+		table_t table;
+		Dummy a, b;
+		ensure("empty find", table.find(7) == NULL);
+		ensure("set new", table.set(7, &a) == NULL);
+		ensure("find", table.find(7) == &a);
+		ensure("replace returns old", table.set(7, &b) == &a);
+		ensure_equals("length after replace", table.getLength(), 1);
+		ensure("remove with stale owner fails", !table.remove(7, &a));
+		ensure("entry survives stale remove", table.find(7) == &b);
+		ensure("remove with owner", table.remove(7, &b));
+		ensure("gone", table.find(7) == NULL);
+		ensure_equals("memory released when empty", table.getCapacity(), 0);
+	}
+
+	template<> template<>
+	void localidtable_object_t::test<2>()
+	{
+		// random churn checked against std::map, so removal has to keep every
+		// cluster reachable
+		table_t table;
+		std::map<U32, Dummy*> reference;
+		std::vector<Dummy> objects(4096);
+
+		for (S32 i = 0; i < 200000; i++)
+		{
+			// a narrow key range forces plenty of collisions and reuse
+			U32 key = (U32)ll_rand(8192) * ((i & 1) ? 1 : 4096);
+			if (ll_rand(3) == 0)
+			{
+				BOOL removed = table.remove(key);
+				ensure_equals("remove agrees", removed, (BOOL)reference.erase(key));
+			}
+			else
+			{
+				Dummy* data = &objects[ll_rand(4096)];
+				table.set(key, data);
+				reference[key] = data;
+			}
+		}
+
+		ensure_equals("length agrees", table.getLength(), (S32)reference.size());
+		ensure("load factor at most one half", table.getLength() * 2 <= table.getCapacity());
+		for (std::map<U32, Dummy*>::iterator iter = reference.begin(); iter != reference.end(); ++iter)
+		{
+			ensure("every key found", table.find(iter->first) == iter->second);
+		}
+		for (U32 key = 0; key < 8192; key++)
+		{
+			ensure("no phantom keys", (table.find(key) != NULL) == (reference.count(key) != 0));
+		}
+	}
+
+	template<> template<>
+	void localidtable_object_t::test<3>()
+	{
+		// Lookup benchmark for the terse update path: the old path went
+		// (ip, port, local id) -> UUID through a std::map, then UUID -> object
+		// through another. Logged, not asserted, since timings vary by machine.
+		const S32 NUM_OBJECTS = 15000;
+		const S32 NUM_LOOKUPS = 1000000;
+		const U64 SIM_INDEX = 3;
+
+		std::vector<Dummy> objects(NUM_OBJECTS);
+		std::vector<U32> local_ids(NUM_OBJECTS);
+		std::map<U64, LLUUID> local_to_uuid;
+		std::map<LLUUID, Dummy*> uuid_to_object;
+		table_t table;
+
+		U32 local_id = 1000000 + ll_rand(1000);
+		for (S32 i = 0; i < NUM_OBJECTS; i++)
+		{
+			// sims hand out ids mostly in order, with gaps where objects died
+			local_id += 1 + ll_rand(3);
+			local_ids[i] = local_id;
+			objects[i].mID.generate();
+			local_to_uuid[(SIM_INDEX << 32) | local_id] = objects[i].mID;
+			uuid_to_object[objects[i].mID] = &objects[i];
+			table.set(local_id, &objects[i]);
+		}
+
+		std::vector<U32> lookups(NUM_LOOKUPS);
+		for (S32 i = 0; i < NUM_LOOKUPS; i++)
+		{
+			lookups[i] = local_ids[ll_rand(NUM_OBJECTS)];
+		}
+
+		LLTimer timer;
+		S32 map_found = 0;
+		for (S32 i = 0; i < NUM_LOOKUPS; i++)
+		{
+			std::map<U64, LLUUID>::iterator id_iter = local_to_uuid.find((SIM_INDEX << 32) | lookups[i]);
+			if (id_iter != local_to_uuid.end())
+			{
+				std::map<LLUUID, Dummy*>::iterator obj_iter = uuid_to_object.find(id_iter->second);
+				if (obj_iter != uuid_to_object.end())
+				{
+					map_found++;
+				}
+			}
+		}
+		F64 map_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		table.resetProbeStats();
+		S32 table_found = 0;
+		for (S32 i = 0; i < NUM_LOOKUPS; i++)
+		{
+			if (table.find(lookups[i]))
+			{
+				table_found++;
+			}
+		}
+		F64 table_time = timer.getElapsedTimeF64();
+
+		ensure_equals("map path finds all", map_found, NUM_LOOKUPS);
+		ensure_equals("table finds all", table_found, NUM_LOOKUPS);
+		ensure("probe chains stay short", table.getAverageProbes() < 2.f);
+
+		llinfos << "Local id lookups, " << NUM_OBJECTS << " objects: two std::map "
+				<< (map_time * 1.0e9 / NUM_LOOKUPS) << " ns, LLLocalIDTable "
+				<< (table_time * 1.0e9 / NUM_LOOKUPS) << " ns ("
+				<< table.getAverageProbes() << " probes)" << llendl;
+	}
+}
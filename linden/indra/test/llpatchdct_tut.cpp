@@ -0,0 +1,312 @@
+/**
+ * @file llpatchdct_tut.cpp
+ * @brief Round trip tests and region benchmark for the terrain patch DCT
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llmath.h"
+#include "llrand.h"
+#include "lltimer.h"
+#include "patch_dct.h"
+#include "lltut.h"
+
+#include <vector>
+
+namespace
+{
+	const S32 PREQUANT = 10;
+
+	// Terrain-like heights: rolling hills, some ridges and a little noise.
+	void make_terrain(std::vector<F32>& heights, S32 width)
+	{
+		heights.resize(width * width);
+		for (S32 y = 0; y < width; y++)
+		{
+			for (S32 x = 0; x < width; x++)
+			{
+				heights[y * width + x] = 22.f
+					+ 12.f * sinf(x * 0.031f) * cosf(y * 0.047f)
+					+ 3.f * sinf(x * 0.23f + y * 0.17f)
+					+ 0.25f * ll_frand();
+			}
+		}
+	}
+
+	// The decoder as it was before the separable matrix version: dequantize
+	// in zigzag order, then a direct cosine sum per column and per line.
+	class ReferenceDecoder
+	{
+	public:
+		ReferenceDecoder(S32 size)
+		:	mSize(size), mCosines(size * size), mZigzag(size * size)
+		{
+			for (S32 u = 0; u < size; u++)
+			{
+				for (S32 n = 0; n < size; n++)
+				{
+					mCosines[u * size + n] = cosf((2.f * n + 1.f) * u * F_PI * 0.5f / size);
+				}
+			}
+
+			// zigzag: odd diagonals run down-left, even ones up-right
+			S32 count = 0;
+			for (S32 s = 0; s < 2 * size - 1; s++)
+			{
+				for (S32 k = 0; k <= s; k++)
+				{
+					S32 i = (s & 1) ? s - k : k;
+					S32 j = s - i;
+					if (i < size && j < size)
+					{
+						mZigzag[j * size + i] = count++;
+					}
+				}
+			}
+		}
+
+		void decompress(F32* patch, S32 stride, const S32* cpatch, const LLPatchHeader& ph) const
+		{
+			const S32 size = mSize;
+			std::vector<F32> block(size * size);
+			std::vector<F32> temp(size * size);
+			for (S32 j = 0; j < size; j++)
+			{
+				for (S32 i = 0; i < size; i++)
+				{
+					block[j * size + i] = cpatch[mZigzag[j * size + i]] * (1.f + 2.f * (i + j));
+				}
+			}
+
+			for (S32 column = 0; column < size; column++)
+			{
+				for (S32 n = 0; n < size; n++)
+				{
+					F32 total = OO_SQRT2 * block[column];
+					for (S32 u = 1; u < size; u++)
+					{
+						total += block[u * size + column] * mCosines[u * size + n];
+					}
+					temp[n * size + column] = total;
+				}
+			}
+
+			S32 prequant = (ph.quant_wbits >> 4) + 2;
+			F32 mult = ph.range / (F32)(1 << prequant);
+			F32 addval = mult * (F32)(1 << (prequant - 1)) + ph.dc_offset;
+			for (S32 line = 0; line < size; line++)
+			{
+				for (S32 n = 0; n < size; n++)
+				{
+					F32 total = OO_SQRT2 * temp[line * size];
+					for (S32 u = 1; u < size; u++)
+					{
+						total += temp[line * size + u] * mCosines[u * size + n];
+					}
+					patch[line * stride + n] = total * (2.f / size) * mult + addval;
+				}
+			}
+		}
+
+	private:
+		S32 mSize;
+		std::vector<F32> mCosines;
+		std::vector<S32> mZigzag;
+	};
+
+	// Every patch of a width x width height field, compressed.
+	struct CompressedRegion
+	{
+		std::vector<S32> mCoefficients;		// size * size per patch
+		std::vector<LLPatchHeader> mHeaders;
+	};
+
+	void compress_region(std::vector<F32>& heights, S32 width, S32 size, CompressedRegion& region)
+	{
+		S32 patches = width / size;
+		region.mCoefficients.resize(patches * patches * size * size);
+		region.mHeaders.resize(patches * patches);
+		init_patch_compressor(size, width, 0);
+		for (S32 p = 0; p < patches * patches; p++)
+		{
+			F32* patch = &heights[(p / patches) * size * width + (p % patches) * size];
+			F32 zmax, zmin;
+			prescan_patch(patch, &region.mHeaders[p], zmax, zmin);
+			compress_patch(patch, &region.mCoefficients[p * size * size], &region.mHeaders[p], PREQUANT);
+		}
+	}
+
+	void decompress_region(CompressedRegion& region, S32 width, S32 size, std::vector<F32>& heights)
+	{
+		S32 patches = width / size;
+		heights.resize(width * width);
+		LLGroupHeader group;
+		group.stride = width;
+		group.patch_size = size;
+		group.layer_type = 0;
+		init_patch_decompressor(size);
+		set_group_of_patch_header(&group);
+		for (S32 p = 0; p < patches * patches; p++)
+		{
+			decompress_patch(&heights[(p / patches) * size * width + (p % patches) * size],
+							 &region.mCoefficients[p * size * size], &region.mHeaders[p]);
+		}
+	}
+
+	void decompress_region_reference(const CompressedRegion& region, S32 width, S32 size, std::vector<F32>& heights)
+	{
+		S32 patches = width / size;
+		heights.resize(width * width);
+		ReferenceDecoder decoder(size);
+		for (S32 p = 0; p < patches * patches; p++)
+		{
+			decoder.decompress(&heights[(p / patches) * size * width + (p % patches) * size], width,
+							   &region.mCoefficients[p * size * size], region.mHeaders[p]);
+		}
+	}
+
+	F32 max_difference(const std::vector<F32>& a, const std::vector<F32>& b)
+	{
+		F32 difference = 0.f;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			difference = llmax(difference, fabsf(a[i] - b[i]));
+		}
+		return difference;
+	}
+}
+
+namespace tut
+{
+	struct patchdct
+	{
+	};
+
+	typedef test_group<patchdct> patchdct_t;
+	typedef patchdct_t::object patchdct_object_t;
+	tut::patchdct_t tut_patchdct("patch_dct");
+
+	template<> template<>
+	void patchdct_object_t::test<1>()
+	{
+		// Each basis function on its own, against the direct cosine sums.
+		const S32 sizes[] = { NORMAL_PATCH_SIZE, LARGE_PATCH_SIZE };
+		for (S32 s = 0; s < (S32)LL_ARRAY_SIZE(sizes); s++)
+		{
+			S32 size = sizes[s];
+			ReferenceDecoder reference(size);
+			LLGroupHeader group;
+			group.stride = size;
+			group.patch_size = size;
+			group.layer_type = 0;
+			init_patch_decompressor(size);
+			set_group_of_patch_header(&group);
+
+			LLPatchHeader ph;
+			ph.dc_offset = 10.f;
+			ph.range = 64;
+			ph.quant_wbits = (PREQUANT - 2) << 4;
+			ph.patchids = 0;
+
+			std::vector<S32> cpatch(size * size, 0);
+			std::vector<F32> expected(size * size);
+			std::vector<F32> actual(size * size);
+			for (S32 k = 0; k < size * size; k++)
+			{
+				cpatch[k] = (k & 1) ? -37 : 53;
+				reference.decompress(&expected[0], size, &cpatch[0], ph);
+				decompress_patch(&actual[0], &cpatch[0], &ph);
+				ensure("basis function matches the direct sum", max_difference(expected, actual) < 1.0e-3f);
+				cpatch[k] = 0;
+			}
+		}
+	}
+
+	template<> template<>
+	void patchdct_object_t::test<2>()
+	{
+		// Compressing with patch_dct.cpp and decoding gives the heights back
+		// within the quantization error, and the same heights as the direct
+		// sums.
+		const S32 WIDTH = 256;
+		const S32 sizes[] = { NORMAL_PATCH_SIZE, LARGE_PATCH_SIZE };
+		for (S32 s = 0; s < (S32)LL_ARRAY_SIZE(sizes); s++)
+		{
+			S32 size = sizes[s];
+			std::vector<F32> heights;
+			make_terrain(heights, WIDTH);
+			CompressedRegion region;
+			compress_region(heights, WIDTH, size, region);
+
+			std::vector<F32> decoded;
+			std::vector<F32> expected;
+			decompress_region(region, WIDTH, size, decoded);
+			decompress_region_reference(region, WIDTH, size, expected);
+
+			ensure("matches the direct sums", max_difference(expected, decoded) < 1.0e-3f);
+			ensure("round trip within quantization error", max_difference(heights, decoded) < 1.f);
+		}
+	}
+
+	template<> template<>
+	void patchdct_object_t::test<3>()
+	{
+		// Decodes a whole 256m region and a 1024m var region of 16x16
+		// patches. Timings are logged, not asserted, since they vary by
+		// machine.
+		const S32 widths[] = { 256, 1024 };
+		const S32 ITERATIONS = 10;
+		for (S32 w = 0; w < (S32)LL_ARRAY_SIZE(widths); w++)
+		{
+			S32 width = widths[w];
+			std::vector<F32> heights;
+			make_terrain(heights, width);
+			CompressedRegion region;
+			compress_region(heights, width, NORMAL_PATCH_SIZE, region);
+
+			std::vector<F32> decoded;
+			std::vector<F32> expected;
+			LLTimer timer;
+			for (S32 i = 0; i < ITERATIONS; i++)
+			{
+				decompress_region_reference(region, width, NORMAL_PATCH_SIZE, expected);
+			}
+			F64 reference_time = timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (S32 i = 0; i < ITERATIONS; i++)
+			{
+				decompress_region(region, width, NORMAL_PATCH_SIZE, decoded);
+			}
+			F64 time = timer.getElapsedTimeF64();
+
+			ensure("matches the direct sums", max_difference(expected, decoded) < 1.0e-3f);
+			llinfos << "Decoding a " << width << "m region (" << region.mHeaders.size() << " patches): direct sums "
+					<< (reference_time * 1.0e3 / ITERATIONS) << " ms, separable "
+					<< (time * 1.0e3 / ITERATIONS) << " ms" << llendl;
+		}
+	}
+}
@@ -0,0 +1,314 @@
+/**
+ * @file llrangeallocator_tut.cpp
+ * @brief Tests for LLRangeAllocator, the sub-allocator behind the vertex
+ * buffer pools, against blocks kept in client memory
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llrangeallocator.h"
+#include "llrand.h"
+#include "lltut.h"
+
+#include <map>
+#include <vector>
+
+namespace
+{
+	// what a vertex buffer is to the pool: where its range is, and what it
+	// wrote there
+	struct TestRange
+	{
+		U32 mBlock;
+		U32 mOffset;
+		U32 mSize;
+		U8 mFill;
+		BOOL mLocked;
+	};
+
+	// keeps its blocks in memory, so a test can look at what a move did
+	class TestAllocator : public LLRangeAllocator
+	{
+	public:
+		TestAllocator(U32 block_size, U32 max_range)
+		:	LLRangeAllocator(block_size, max_range, 16),
+			mNextName(1)
+		{
+		}
+
+		~TestAllocator()
+		{
+			deleteEmptyBlocks();
+		}
+
+		BOOL allocate(TestRange& range)
+		{
+			if (!LLRangeAllocator::allocate(&range, range.mSize, range.mBlock, range.mOffset))
+			{
+				return FALSE;
+			}
+			std::vector<U8>& block = mBlocks[range.mBlock];
+			for (U32 i = 0; i < range.mSize; i++)
+			{
+				block[range.mOffset + i] = range.mFill;
+			}
+			return TRUE;
+		}
+
+		// TRUE if the range's block still holds what the range wrote
+		bool intact(const TestRange& range)
+		{
+			std::map<U32, std::vector<U8> >::iterator iter = mBlocks.find(range.mBlock);
+			if (iter == mBlocks.end())
+			{
+				return false;
+			}
+			for (U32 i = 0; i < range.mSize; i++)
+			{
+				if (iter->second[range.mOffset + i] != range.mFill)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		std::map<U32, std::vector<U8> > mBlocks;
+
+	protected:
+		/*virtual*/ U32 createBlock(U32 size)
+		{
+			mBlocks[mNextName].assign(size, 0xCD);
+			return mNextName++;
+		}
+
+		/*virtual*/ void deleteBlock(U32 block)
+		{
+			mBlocks.erase(block);
+		}
+
+		/*virtual*/ BOOL canMoveRange(void* owner) const
+		{
+			return !((TestRange*) owner)->mLocked;
+		}
+
+		/*virtual*/ void moveRange(void* owner, U32 size, U32 src_block, U32 src_offset,
+								   U32 dst_block, U32 dst_offset)
+		{
+			TestRange* range = (TestRange*) owner;
+			memcpy(&mBlocks[dst_block][dst_offset], &mBlocks[src_block][src_offset], size);
+			// scribble over the source so a stale range shows up
+			memset(&mBlocks[src_block][src_offset], 0xCD, size);
+			range->mBlock = dst_block;
+			range->mOffset = dst_offset;
+		}
+
+	private:
+		U32 mNextName;
+	};
+}
+
+namespace tut
+{
+	struct rangeallocator
+	{
+	};
+
+	typedef test_group<rangeallocator> rangeallocator_t;
+	typedef rangeallocator_t::object rangeallocator_object_t;
+	tut::rangeallocator_t tut_rangeallocator("rangeallocator");
+
+	template<> template<>
+	void rangeallocator_object_t::test<1>()
+	{
+		// alignment, the size limit, and free space merging
+		TestAllocator allocator(4096, 1024);
+		TestRange a = { 0, 0, 1000, 1, FALSE };
+		TestRange b = { 0, 0, 10, 2, FALSE };
+		TestRange c = { 0, 0, 1024, 3, FALSE };
+		TestRange big = { 0, 0, 1025, 4, FALSE };
+
+		ensure("too big to pool", !allocator.allocate(big));
+		ensure("allocate a", allocator.allocate(a));
+		ensure("allocate b", allocator.allocate(b));
+		ensure("allocate c", allocator.allocate(c));
+		ensure_equals("one block", allocator.getBlockCount(), 1);
+		ensure_equals("first fit", a.mOffset, 0U);
+		ensure_equals("aligned", b.mOffset, 1008U);
+		ensure_equals("aligned after b", c.mOffset, 1024U);
+		ensure_equals("used bytes", allocator.getUsedBytes(), 1008U + 16U + 1024U);
+		ensure("a intact", allocator.intact(a));
+		ensure("b intact", allocator.intact(b));
+		ensure("c intact", allocator.intact(c));
+
+		// freeing a and c around b, then b, has to leave one free run
+		allocator.free(a.mBlock, a.mOffset);
+		allocator.free(c.mBlock, c.mOffset);
+		allocator.free(b.mBlock, b.mOffset);
+		ensure_equals("no ranges", allocator.getRangeCount(), 0U);
+		ensure_equals("empty block kept", allocator.getBlockCount(), 1);
+
+		TestRange quarters[4];
+		for (S32 i = 0; i < 4; i++)
+		{
+			TestRange range = { 0, 0, 1024, (U8)(10 + i), FALSE };
+			quarters[i] = range;
+			ensure("whole block reusable", allocator.allocate(quarters[i]));
+		}
+		ensure_equals("still one block", allocator.getBlockCount(), 1);
+
+		TestRange more = { 0, 0, 16, 20, FALSE };
+		ensure("allocate past a full block", allocator.allocate(more));
+		ensure_equals("second block", allocator.getBlockCount(), 2);
+		allocator.free(more.mBlock, more.mOffset);
+		ensure_equals("second block deleted once empty", allocator.getBlockCount(), 1);
+
+		for (S32 i = 0; i < 4; i++)
+		{
+			allocator.free(quarters[i].mBlock, quarters[i].mOffset);
+		}
+	}
+
+	template<> template<>
+	void rangeallocator_object_t::test<2>()
+	{
+		// random churn; ranges must never overlap
+		TestAllocator allocator(64 * 1024, 8 * 1024);
+		std::vector<TestRange> ranges(2000);
+		std::vector<bool> live(ranges.size(), false);
+		U32 used = 0;
+
+		for (S32 i = 0; i < 50000; i++)
+		{
+			S32 idx = ll_rand((S32)ranges.size());
+			TestRange& range = ranges[idx];
+			if (live[idx])
+			{
+				ensure("intact before free", allocator.intact(range));
+				allocator.free(range.mBlock, range.mOffset);
+				used -= (range.mSize + 15) & ~15;
+				live[idx] = false;
+			}
+			else
+			{
+				range.mSize = 1 + ll_rand(8 * 1024);
+				range.mFill = (U8)(1 + ll_rand(254));
+				range.mLocked = FALSE;
+				ensure("allocate", allocator.allocate(range));
+				used += (range.mSize + 15) & ~15;
+				live[idx] = true;
+			}
+		}
+
+		ensure_equals("used bytes agree", allocator.getUsedBytes(), used);
+		for (U32 i = 0; i < ranges.size(); i++)
+		{
+			if (live[i])
+			{
+				ensure("intact", allocator.intact(ranges[i]));
+				allocator.free(ranges[i].mBlock, ranges[i].mOffset);
+			}
+		}
+		ensure_equals("all freed", allocator.getRangeCount(), 0U);
+		ensure_equals("one block left", allocator.getBlockCount(), 1);
+	}
+
+	template<> template<>
+	void rangeallocator_object_t::test<3>()
+	{
+		// defragmenting sparse blocks moves the ranges intact, leaves the
+		// locked ones alone, and deletes the blocks it empties
+		const U32 BLOCK_SIZE = 16 * 1024;
+		TestAllocator allocator(BLOCK_SIZE, 1024);
+		std::vector<TestRange> ranges(128);
+		for (U32 i = 0; i < ranges.size(); i++)
+		{
+			TestRange range = { 0, 0, 512, (U8)(1 + i), FALSE };
+			ranges[i] = range;
+			ensure("allocate", allocator.allocate(ranges[i]));
+		}
+		ensure_equals("four full blocks", allocator.getBlockCount(), 4);
+
+		// keep every eighth range, one of them locked in the last block
+		std::vector<TestRange*> kept;
+		for (U32 i = 0; i < ranges.size(); i++)
+		{
+			if (i % 8)
+			{
+				allocator.free(ranges[i].mBlock, ranges[i].mOffset);
+			}
+			else
+			{
+				kept.push_back(&ranges[i]);
+			}
+		}
+		TestRange* locked = kept.back();
+		locked->mLocked = TRUE;
+		U32 locked_block = locked->mBlock;
+		U32 locked_offset = locked->mOffset;
+
+		S32 steps = 0;
+		U32 max_bytes = 1024;
+		while (steps < 100)
+		{
+			max_bytes = 1024;
+			if (!allocator.defragmentStep(max_bytes))
+			{
+				break;
+			}
+			steps++;
+		}
+		ensure("did something", steps > 0);
+		ensure("stayed within the byte budget", steps > 1);
+		ensure("moved bytes counted", allocator.getMovedBytes() > 0);
+		ensure_equals("blocks deleted up to the locked one", allocator.getBlockCount(), 2);
+		ensure_equals("every range still there", allocator.getRangeCount(), (U32)kept.size());
+		ensure_equals("block store agrees", (S32)allocator.mBlocks.size(), allocator.getBlockCount());
+		ensure("locked range not moved", locked->mBlock == locked_block && locked->mOffset == locked_offset);
+		for (U32 i = 0; i < kept.size(); i++)
+		{
+			ensure("moved ranges intact", allocator.intact(*kept[i]));
+		}
+
+		// once unlocked, its block can be drained too
+		locked->mLocked = FALSE;
+		while (steps < 200)
+		{
+			max_bytes = 1024;
+			if (!allocator.defragmentStep(max_bytes))
+			{
+				break;
+			}
+			steps++;
+		}
+		ensure_equals("packed into one block", allocator.getBlockCount(), 1);
+		for (U32 i = 0; i < kept.size(); i++)
+		{
+			ensure("intact after packing", allocator.intact(*kept[i]));
+			allocator.free(kept[i]->mBlock, kept[i]->mOffset);
+		}
+	}
+}
@@ -0,0 +1,316 @@
+/**
+ * @file llskinning_tut.cpp
+ * @brief Tests and avatar mesh benchmark for the software skinning kernels
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llfile.h"
+#include "llquaternion.h"
+#include "llrand.h"
+#include "llskinning.h"
+#include "llsys.h"
+#include "lltimer.h"
+#include "m3math.h"
+#include "m4math.h"
+#include "v3math.h"
+#include "v4math.h"
+#include "lltut.h"
+
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	const S32 NUM_JOINTS = 32;
+
+	// Avatar vertex buffers interleave position, normal, texcoord, weight and
+	// clothing weight, so skinned output lands 52 bytes apart.
+	const U32 AVATAR_STRIDE = 12 + 12 + 8 + 4 + 16;
+	const U32 NORMAL_OFFSET = 12;
+
+	void make_pose(std::vector<LLMatrix4>& mats)
+	{
+		mats.resize(NUM_JOINTS);
+		for (S32 i = 0; i < NUM_JOINTS; i++)
+		{
+			LLQuaternion rot(ll_frand(F_PI), LLVector3(ll_frand() - 0.5f, ll_frand() - 0.5f, ll_frand() + 0.1f));
+			LLVector4 pos(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(2.f), 1.f);
+			mats[i] = LLMatrix4(rot, pos);
+		}
+	}
+
+	// What updateGeometryOriginal does, with LLMatrix4 math.
+	void skin_reference(const std::vector<LLMatrix4>& mats, F32 weight, const LLVector3& coord,
+						const LLVector3& normal, LLVector3& out_pos, LLVector3& out_normal)
+	{
+		S32 joint = llfloor(weight);
+		F32 w = weight - joint;
+		LLMatrix4 blend;
+		for (S32 i = 0; i < 4; i++)
+		{
+			for (S32 j = 0; j < 4; j++)
+			{
+				blend.mMatrix[i][j] = lerp(mats[joint].mMatrix[i][j], mats[joint + 1].mMatrix[i][j], w);
+			}
+		}
+		out_pos = coord * blend;
+		out_normal = normal * blend.getMat3();
+	}
+
+	F32 max_difference(const std::vector<U8>& a, const std::vector<U8>& b, U32 count)
+	{
+		F32 diff = 0.f;
+		for (U32 i = 0; i < count; i++)
+		{
+			const F32* pa = (const F32*)&a[i * AVATAR_STRIDE];
+			const F32* pb = (const F32*)&b[i * AVATAR_STRIDE];
+			for (S32 k = 0; k < 6; k++)
+			{
+				diff = llmax(diff, fabsf(pa[k] - pb[k]));
+			}
+		}
+		return diff;
+	}
+
+	bool use_avx2()
+	{
+		return gSysCPU.hasAVX2() && ll_skin_avx2_built();
+	}
+
+	// The default avatar meshes shipped with the viewer, in the .llm format
+	// LLPolyMeshSharedData::loadMesh() reads: a 24 byte header, flags and
+	// transform, then (base meshes only) the vertex arrays, then faces.
+	const std::string CHARACTER_DIR = "../newview/character/";
+	const S32 LLM_VERTEX_COUNT_OFFSET = 24 + 2 + 12 + 12 + 1 + 12;
+
+	struct SkinMesh
+	{
+		std::vector<F32> mCoords;
+		std::vector<F32> mNormals;
+		std::vector<F32> mWeights;
+		std::vector<U32> mLODVertexCounts;
+	};
+
+	bool read_file(const std::string& filename, std::vector<U8>& data)
+	{
+		LLFILE* fp = LLFile::fopen(filename, "rb");
+		if (!fp)
+		{
+			return false;
+		}
+		fseek(fp, 0, SEEK_END);
+		long size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		data.resize(size);
+		bool ok = size > LLM_VERTEX_COUNT_OFFSET + 2 && fread(&data[0], 1, size, fp) == (size_t)size;
+		fclose(fp);
+		return ok;
+	}
+
+	U16 read_u16(const std::vector<U8>& data, S32 offset)
+	{
+		// .llm files are little endian, like the machines these tests run on
+		U16 value;
+		memcpy(&value, &data[offset], sizeof(U16));
+		return value;
+	}
+
+	void read_floats(const std::vector<U8>& data, S32& offset, S32 count, std::vector<F32>& out)
+	{
+		out.resize(count);
+		memcpy(&out[0], &data[offset], count * sizeof(F32));
+		offset += count * sizeof(F32);
+	}
+
+	bool load_mesh(const std::string& name, SkinMesh& mesh)
+	{
+		std::vector<U8> data;
+		if (!read_file(CHARACTER_DIR + "avatar_" + name + ".llm", data))
+		{
+			return false;
+		}
+		bool has_detail_tex_coords = data[25] != 0;
+		S32 num_vertices = read_u16(data, LLM_VERTEX_COUNT_OFFSET);
+		S32 offset = LLM_VERTEX_COUNT_OFFSET + 2;
+		read_floats(data, offset, num_vertices * 3, mesh.mCoords);
+		read_floats(data, offset, num_vertices * 3, mesh.mNormals);
+		offset += num_vertices * (12 + 8 + (has_detail_tex_coords ? 8 : 0));	// binormals, texcoords
+		read_floats(data, offset, num_vertices, mesh.mWeights);
+		mesh.mLODVertexCounts.push_back(num_vertices);
+
+		// Lower LODs only carry faces and skin the leading vertices of the
+		// base mesh, up to the highest index they use.
+		for (S32 lod = 1; ; lod++)
+		{
+			std::ostringstream filename;
+			filename << CHARACTER_DIR << "avatar_" << name << "_" << lod << ".llm";
+			if (!read_file(filename.str(), data))
+			{
+				break;
+			}
+			S32 num_faces = read_u16(data, LLM_VERTEX_COUNT_OFFSET);
+			U32 num_used = 0;
+			for (S32 i = 0; i < num_faces * 3; i++)
+			{
+				num_used = llmax(num_used, (U32)read_u16(data, LLM_VERTEX_COUNT_OFFSET + 2 + i * 2) + 1);
+			}
+			mesh.mLODVertexCounts.push_back(num_used);
+		}
+		return true;
+	}
+}
+
+namespace tut
+{
+	struct skinning
+	{
+	};
+
+	typedef test_group<skinning> skinning_t;
+	typedef skinning_t::object skinning_object_t;
+	tut::skinning_t tut_skinning("skinning");
+
+	template<> template<>
+	void skinning_object_t::test<1>()
+	{
+		// Both kernels against LLMatrix4 math, for counts that leave every
+		// possible tail after the eight wide loop, written into an
+		// interleaved buffer whose other fields must survive.
+		std::vector<LLMatrix4> mats;
+		make_pose(mats);
+
+		const U32 MAX_VERTICES = 41;
+		std::vector<F32> coords(MAX_VERTICES * 3), normals(MAX_VERTICES * 3), weights(MAX_VERTICES);
+		for (U32 i = 0; i < MAX_VERTICES; i++)
+		{
+			for (S32 k = 0; k < 3; k++)
+			{
+				coords[i * 3 + k] = ll_frand(2.f) - 1.f;
+				normals[i * 3 + k] = ll_frand(2.f) - 1.f;
+			}
+			// runs of equal weights like real meshes, and whole numbers
+			weights[i] = (i % 3 == 1) ? weights[i - 1] : (i % 5 == 0) ? (F32)(i % 30) : ll_frand(30.f);
+		}
+
+		for (U32 count = 0; count <= MAX_VERTICES; count++)
+		{
+			for (S32 pass = 0; pass < 2; pass++)
+			{
+				std::vector<U8> buffer(MAX_VERTICES * AVATAR_STRIDE, 0xCD);
+				LLSkinVerticesFunc skin = pass ? ll_skin_vertices_avx2 : ll_skin_vertices;
+				if (pass && !use_avx2())
+				{
+					continue;
+				}
+				skin(mats[0].mMatrix[0], &weights[0], &coords[0], &normals[0], count,
+					 &buffer[0], AVATAR_STRIDE, &buffer[NORMAL_OFFSET], AVATAR_STRIDE);
+
+				for (U32 i = 0; i < MAX_VERTICES; i++)
+				{
+					const U8* vertex = &buffer[i * AVATAR_STRIDE];
+					if (i >= count)
+					{
+						ensure("untouched past count", vertex[0] == 0xCD && vertex[NORMAL_OFFSET] == 0xCD);
+						continue;
+					}
+					LLVector3 pos, normal;
+					skin_reference(mats, weights[i], LLVector3(&coords[i * 3]), LLVector3(&normals[i * 3]), pos, normal);
+					const F32* out = (const F32*)vertex;
+					for (S32 k = 0; k < 3; k++)
+					{
+						ensure_approximately_equals("position", out[k], pos.mV[k], 16);
+						ensure_approximately_equals("normal", out[3 + k], normal.mV[k], 16);
+					}
+					for (U32 k = 24; k < AVATAR_STRIDE; k++)
+					{
+						ensure("other fields untouched", vertex[k] == 0xCD);
+					}
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void skinning_object_t::test<2>()
+	{
+		// Skins every default avatar mesh at each LOD with both kernels.
+		// Timings are logged, not asserted, since they vary by machine.
+		const char* MESHES[] = { "head", "upper_body", "lower_body", "skirt", "hair", "eyelashes" };
+		const S32 ITERATIONS = 500;
+
+		std::vector<LLMatrix4> mats;
+		make_pose(mats);
+		bool avx2 = use_avx2();
+		if (!avx2)
+		{
+			llinfos << "AVX2 skinning not available, timing the portable kernel only" << llendl;
+		}
+
+		for (S32 m = 0; m < (S32)LL_ARRAY_SIZE(MESHES); m++)
+		{
+			SkinMesh mesh;
+			ensure(std::string("load avatar_") + MESHES[m], load_mesh(MESHES[m], mesh));
+
+			for (S32 lod = 0; lod < (S32)mesh.mLODVertexCounts.size(); lod++)
+			{
+				U32 count = mesh.mLODVertexCounts[lod];
+				std::vector<U8> generic_out(count * AVATAR_STRIDE);
+				std::vector<U8> avx2_out(count * AVATAR_STRIDE);
+
+				LLTimer timer;
+				for (S32 i = 0; i < ITERATIONS; i++)
+				{
+					ll_skin_vertices(mats[0].mMatrix[0], &mesh.mWeights[0], &mesh.mCoords[0], &mesh.mNormals[0], count,
+									 &generic_out[0], AVATAR_STRIDE, &generic_out[NORMAL_OFFSET], AVATAR_STRIDE);
+				}
+				F64 generic_time = timer.getElapsedTimeF64();
+
+				F64 avx2_time = 0.0;
+				if (avx2)
+				{
+					timer.reset();
+					for (S32 i = 0; i < ITERATIONS; i++)
+					{
+						ll_skin_vertices_avx2(mats[0].mMatrix[0], &mesh.mWeights[0], &mesh.mCoords[0], &mesh.mNormals[0], count,
+											  &avx2_out[0], AVATAR_STRIDE, &avx2_out[NORMAL_OFFSET], AVATAR_STRIDE);
+					}
+					avx2_time = timer.getElapsedTimeF64();
+					ensure("AVX2 matches portable kernel", max_difference(generic_out, avx2_out, count) < 1.0e-4f);
+				}
+
+				std::ostringstream timings;
+				timings << "portable " << (generic_time * 1.0e6 / ITERATIONS) << " us";
+				if (avx2)
+				{
+					timings << ", AVX2 " << (avx2_time * 1.0e6 / ITERATIONS) << " us";
+				}
+				llinfos << "Skinning avatar_" << MESHES[m] << " LOD " << lod << " (" << count << " vertices): "
+						<< timings.str() << llendl;
+			}
+		}
+	}
+}
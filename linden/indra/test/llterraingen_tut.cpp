@@ -0,0 +1,557 @@
+/**
+ * @file llterraingen_tut.cpp
+ * @brief Tests and region benchmark for the terrain patch jobs
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llrand.h"
+#include "llterraingen.h"
+#include "lltimer.h"
+#include "noise.h"
+#include "lltut.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	// A 256m region as the viewer sets it up: one composition sample per
+	// meter, 16x16 patches of 16 grids.  The surface texture is
+	// RegionTextureSize texels across, 256 by default.
+	const S32 LAYER_WIDTH = 256;
+	const F32 LAYER_SCALE = 1.f;
+	const S32 PATCHES_PER_EDGE = 16;
+	const S32 GRIDS_PER_PATCH_EDGE = 16;
+	const S32 GRIDS_PER_EDGE = LAYER_WIDTH + 1;
+	const F32 METERS_PER_GRID = 1.f;
+	const S32 SURFACE_TEX_SIZE = 256;
+	const F32 TEX_SCALE = 16.f;
+	const S32 DETAIL_SIZE = LLTerrainTextureJob::DETAIL_SIZE;
+	const S32 CORNER_COUNT = LLTerrainTextureJob::CORNER_COUNT;
+
+	// Rolling terrain that carries on smoothly across region edges
+	F32 terrain_height(F64 x, F64 y)
+	{
+		return (F32)(24.0 + 12.0 * sin(x * 0.031) * cos(y * 0.047) + 3.0 * sin((x + y) * 0.11));
+	}
+
+	F32 terrain_composition(F64 x, F64 y)
+	{
+		return (F32)(1.5 + 1.5 * sin(x * 0.013 + y * 0.021));
+	}
+
+	struct TestRegion
+	{
+		LLVector3d mOriginGlobal;
+		F32 mStartHeight[CORNER_COUNT];
+		F32 mHeightRange[CORNER_COUNT];
+
+		TestRegion(S32 x, S32 y)
+		:	mOriginGlobal((F64)(1000 + x) * LAYER_WIDTH, (F64)(1000 + y) * LAYER_WIDTH, 0.0)
+		{
+			for (S32 i = 0; i < CORNER_COUNT; i++)
+			{
+				mStartHeight[i] = 10.f + ll_frand(10.f);
+				mHeightRange[i] = 30.f + ll_frand(30.f);
+			}
+		}
+
+		// LLSurface::resolveHeightRegion() at a composition sample
+		F32 getHeight(S32 i, S32 j) const
+		{
+			return terrain_height(mOriginGlobal.mdV[VX] + i * LAYER_SCALE, mOriginGlobal.mdV[VY] + j * LAYER_SCALE);
+		}
+	};
+
+	struct DetailImages
+	{
+		std::vector<U8> mData[CORNER_COUNT];
+		const U8* mPointers[CORNER_COUNT];
+		S32 mSizes[CORNER_COUNT];
+
+		DetailImages()
+		{
+			for (S32 i = 0; i < CORNER_COUNT; i++)
+			{
+				mData[i].resize(DETAIL_SIZE * DETAIL_SIZE * 3);
+				for (U32 k = 0; k < mData[i].size(); k++)
+				{
+					mData[i][k] = (U8)ll_rand(256);
+				}
+				mPointers[i] = &mData[i][0];
+				mSizes[i] = (S32)mData[i].size();
+			}
+		}
+	};
+
+	F32 bilinear(const F32 v00, const F32 v01, const F32 v10, const F32 v11, const F32 x_frac, const F32 y_frac)
+	{
+		const F32 inv_x_frac = 1.f - x_frac;
+		const F32 inv_y_frac = 1.f - y_frac;
+		return inv_x_frac*inv_y_frac*v00
+				+ x_frac*inv_y_frac*v10
+				+ inv_x_frac*y_frac*v01
+				+ x_frac*y_frac*v11;
+	}
+
+	// LLVLComposition::generateHeights() over the whole region, as the
+	// viewer did before the jobs
+	void reference_heights(const TestRegion& region, std::vector<F32>& layer)
+	{
+		const F32 slope_squared = 1.5f*1.5f;
+		const F32 xyScaleInv = 1.f / 4.9215f;
+		const F32 zScaleInv = 1.f / 4.f;
+		const F32 noise_magnitude = 2.f;
+		const F32 inv_width = 1.f/LAYER_WIDTH;
+
+		layer.resize(LAYER_WIDTH * LAYER_WIDTH);
+		for (S32 j = 0; j < LAYER_WIDTH; j++)
+		{
+			for (S32 i = 0; i < LAYER_WIDTH; i++)
+			{
+				F32 start_height = bilinear(region.mStartHeight[0], region.mStartHeight[1],
+											region.mStartHeight[2], region.mStartHeight[3],
+											i*inv_width, j*inv_width);
+				F32 height_range = bilinear(region.mHeightRange[0], region.mHeightRange[1],
+											region.mHeightRange[2], region.mHeightRange[3],
+											i*inv_width, j*inv_width);
+
+				LLVector3 location(i*LAYER_SCALE, j*LAYER_SCALE, 0.f);
+				F32 height = region.getHeight(i, j);
+
+				F32 vec[3];
+				F32 vec1[3];
+				vec[0] = (F32)(region.mOriginGlobal.mdV[VX]+location.mV[VX])*xyScaleInv;
+				vec[1] = (F32)(region.mOriginGlobal.mdV[VY]+location.mV[VY])*xyScaleInv;
+				vec[2] = height*zScaleInv;
+				vec1[0] = vec[0]*(0.2222222222f);
+				vec1[1] = vec[1]*(0.2222222222f);
+				vec1[2] = vec[2]*(0.2222222222f);
+				F32 twiddle = noise2(vec1)*6.5f;
+				twiddle += turbulence2(vec, 2)*slope_squared;
+				twiddle *= noise_magnitude;
+
+				F32 scaled_noisy_height = (height + twiddle - start_height) * 4.f / height_range;
+				scaled_noisy_height = llmax(0.f, scaled_noisy_height);
+				scaled_noisy_height = llmin(3.f, scaled_noisy_height);
+				layer[j*LAYER_WIDTH + i] = scaled_noisy_height;
+			}
+		}
+	}
+
+	// LLViewerLayer::getValueScaled()
+	F32 reference_composition(const std::vector<F32>& layer, F32 x, F32 y)
+	{
+		const F32 scale_inv = 1.f/LAYER_SCALE;
+		F32 x_frac = x*scale_inv;
+		S32 x1 = llfloor(x_frac);
+		S32 x2 = x1 + 1;
+		x_frac -= x1;
+		F32 y_frac = y*scale_inv;
+		S32 y1 = llfloor(y_frac);
+		S32 y2 = y1 + 1;
+		y_frac -= y1;
+
+		x1 = llclamp(x1, 0, LAYER_WIDTH - 1);
+		x2 = llclamp(x2, 0, LAYER_WIDTH - 1);
+		y1 = llclamp(y1, 0, LAYER_WIDTH - 1);
+		y2 = llclamp(y2, 0, LAYER_WIDTH - 1);
+
+		F32 row1_interp = layer[y1*LAYER_WIDTH + x1] - x_frac * (layer[y1*LAYER_WIDTH + x1] - layer[y1*LAYER_WIDTH + x2]);
+		F32 row2_interp = layer[y2*LAYER_WIDTH + x1] - x_frac * (layer[y2*LAYER_WIDTH + x1] - layer[y2*LAYER_WIDTH + x2]);
+		return row1_interp - y_frac * (row1_interp - row2_interp);
+	}
+
+	// LLVLComposition::generateTexture() for one patch, reading the whole
+	// region's composition
+	void reference_texture(const std::vector<F32>& layer, const DetailImages& details, F32 x, F32 y, F32 width,
+						   S32 tex_size, std::vector<U8>& image)
+	{
+		const S32 st_comps = 3;
+		const S32 st_width = DETAIL_SIZE;
+		const S32 st_height = DETAIL_SIZE;
+		const S32 tex_comps = 3;
+		const S32 tex_stride = tex_size * tex_comps;
+		const F32 scale_inv = 1.f/LAYER_SCALE;
+
+		S32 x_begin = (S32)(x * scale_inv);
+		S32 y_begin = (S32)(y * scale_inv);
+		S32 x_end = llmin(llround( (x + width) * scale_inv ), LAYER_WIDTH);
+		S32 y_end = llmin(llround( (y + width) * scale_inv ), LAYER_WIDTH);
+
+		F32 tex_x_scalef = (F32)tex_size / (F32)LAYER_WIDTH;
+		F32 tex_y_scalef = (F32)tex_size / (F32)LAYER_WIDTH;
+		S32 tex_x_begin = (S32)((F32)x_begin * tex_x_scalef);
+		S32 tex_y_begin = (S32)((F32)y_begin * tex_y_scalef);
+		S32 tex_x_end = (S32)((F32)x_end * tex_x_scalef);
+		S32 tex_y_end = (S32)((F32)y_end * tex_y_scalef);
+		F32 tex_x_ratiof = (F32)LAYER_WIDTH*LAYER_SCALE / (F32)tex_size;
+		F32 tex_y_ratiof = (F32)LAYER_WIDTH*LAYER_SCALE / (F32)tex_size;
+
+		F32 st_x_stride = ((F32)st_width / TEX_SCALE)*((F32)LAYER_WIDTH / (F32)tex_size);
+		F32 st_y_stride = ((F32)st_height / TEX_SCALE)*((F32)LAYER_WIDTH / (F32)tex_size);
+
+		F32 sti;
+		F32 stj = (tex_y_begin * st_y_stride) - st_height*(llfloor((tex_y_begin * st_y_stride)/st_height));
+		for (S32 j = tex_y_begin; j < tex_y_end; j++)
+		{
+			U32 offset = j * tex_stride + tex_x_begin * tex_comps;
+			sti = (tex_x_begin * st_x_stride) - st_width*((U32)(tex_x_begin * st_x_stride)/st_width);
+			for (S32 i = tex_x_begin; i < tex_x_end; i++)
+			{
+				F32 composition = reference_composition(layer, i*tex_x_ratiof, j*tex_y_ratiof);
+				S32 tex0 = llclamp(llfloor(composition), 0, 3);
+				composition -= tex0;
+				S32 tex1 = llclamp(tex0 + 1, 0, 3);
+
+				S32 st_offset = (lltrunc(sti) + lltrunc(stj)*st_width) * st_comps;
+				for (S32 k = 0; k < tex_comps; k++)
+				{
+					if (st_offset < details.mSizes[tex0] && st_offset < details.mSizes[tex1])
+					{
+						F32 a = details.mPointers[tex0][st_offset];
+						F32 b = details.mPointers[tex1][st_offset];
+						image[offset] = (U8)lltrunc( a + composition * (b - a) );
+					}
+					offset++;
+					st_offset++;
+				}
+
+				sti += st_x_stride;
+				if (sti >= st_width)
+				{
+					sti -= st_width;
+				}
+			}
+
+			stj += st_y_stride;
+			if (stj >= st_height)
+			{
+				stj -= st_height;
+			}
+		}
+	}
+
+	// What LLPatchTextureJob::prepare() hands the job for a patch
+	LLTerrainTextureJob* make_texture_job(const TestRegion& region, const DetailImages& details,
+										  const std::vector<F32>& layer, S32 patch_x, S32 patch_y, S32 tex_size)
+	{
+		const F32 x = (F32)(patch_x * GRIDS_PER_PATCH_EDGE) * METERS_PER_GRID;
+		const F32 y = (F32)(patch_y * GRIDS_PER_PATCH_EDGE) * METERS_PER_GRID;
+
+		LLTerrainTextureJob* job = new LLTerrainTextureJob;
+		job->setComposition(&layer[0], LAYER_WIDTH, LAYER_SCALE, x, y, METERS_PER_GRID*(GRIDS_PER_PATCH_EDGE+1));
+
+		std::vector<F32> heights(job->getCompWidth() * job->getCompHeight());
+		for (S32 j = 0; j < job->getCompHeight(); j++)
+		{
+			for (S32 i = 0; i < job->getCompWidth(); i++)
+			{
+				heights[j*job->getCompWidth() + i] = region.getHeight(job->getCompX() + i, job->getCompY() + j);
+			}
+		}
+		job->setHeights(&heights[0], region.mStartHeight, region.mHeightRange, region.mOriginGlobal);
+		job->setTexels(details.mPointers, details.mSizes, TEX_SCALE, TEX_SCALE, tex_size, tex_size,
+					   x, y, METERS_PER_GRID*GRIDS_PER_PATCH_EDGE);
+		return job;
+	}
+
+	// What LLPatchGeometryJob::prepare() hands the job for a patch
+	LLTerrainGeometryJob* make_geometry_job(const TestRegion& region, S32 patch_x, S32 patch_y)
+	{
+		const S32 points = GRIDS_PER_PATCH_EDGE + 1;
+		const S32 grid_x = patch_x * GRIDS_PER_PATCH_EDGE;
+		const S32 grid_y = patch_y * GRIDS_PER_PATCH_EDGE;
+		LLVector3 origin_region(grid_x * METERS_PER_GRID, grid_y * METERS_PER_GRID, 0.f);
+		LLVector3d origin_global = region.mOriginGlobal + LLVector3d(origin_region);
+
+		LLTerrainGeometryJob* job = new LLTerrainGeometryJob;
+		job->setPatch(points, GRIDS_PER_EDGE, METERS_PER_GRID, origin_region, origin_global);
+		for (S32 y = -2; y < points + 2; y++)
+		{
+			for (S32 x = -2; x < points + 2; x++)
+			{
+				F64 gx = origin_global.mdV[VX] + x * METERS_PER_GRID;
+				F64 gy = origin_global.mdV[VY] + y * METERS_PER_GRID;
+				job->setNormalHeight(x, y, terrain_height(gx, gy));
+				if (x >= 0 && y >= 0 && x < points && y < points)
+				{
+					job->setPoint(x, y, terrain_height(gx, gy), terrain_composition(gx, gy));
+				}
+			}
+		}
+		return job;
+	}
+
+	// All the patch jobs of a region, in the order the viewer queues them
+	void make_region_jobs(const TestRegion& region, const DetailImages& details, const std::vector<F32>& layer,
+						  std::vector<LLTerrainJob*>& jobs)
+	{
+		for (S32 py = 0; py < PATCHES_PER_EDGE; py++)
+		{
+			for (S32 px = 0; px < PATCHES_PER_EDGE; px++)
+			{
+				jobs.push_back(make_texture_job(region, details, layer, px, py, SURFACE_TEX_SIZE));
+				jobs.push_back(make_geometry_job(region, px, py));
+			}
+		}
+	}
+
+	bool same_vertices(const std::vector<LLTerrainVertex>& a, const std::vector<LLTerrainVertex>& b)
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+		for (U32 i = 0; i < a.size(); i++)
+		{
+			if (a[i].mPosition != b[i].mPosition || a[i].mNormal != b[i].mNormal
+				|| a[i].mTexCoord0 != b[i].mTexCoord0 || a[i].mTexCoord1 != b[i].mTexCoord1)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+namespace tut
+{
+	struct terraingen
+	{
+		terraingen()
+		{
+			// The tables behind noise2() are set up on its first call
+			F32 vec[2] = { 0.f, 0.f };
+			noise2(vec);
+		}
+	};
+
+	typedef test_group<terraingen> terraingen_t;
+	typedef terraingen_t::object terraingen_object_t;
+	tut::terraingen_t tut_terraingen("terraingen");
+
+	template<> template<>
+	void terraingen_object_t::test<1>()
+	{
+		// A job per patch generates the same composition and surface texture
+		// as generating the whole region at once did.  Past 256 texels the
+		// texels blend between composition samples, up to the patch edges.
+		TestRegion region(3, 7);
+		DetailImages details;
+
+		std::vector<F32> ref_layer;
+		reference_heights(region, ref_layer);
+
+		const S32 tex_sizes[] = { SURFACE_TEX_SIZE, 512 };
+		for (S32 t = 0; t < (S32)LL_ARRAY_SIZE(tex_sizes); t++)
+		{
+			const S32 tex_size = tex_sizes[t];
+			std::vector<U8> ref_image(tex_size * tex_size * 3, 0);
+			for (S32 py = 0; py < PATCHES_PER_EDGE; py++)
+			{
+				for (S32 px = 0; px < PATCHES_PER_EDGE; px++)
+				{
+					reference_texture(ref_layer, details, (F32)(px * GRIDS_PER_PATCH_EDGE), (F32)(py * GRIDS_PER_PATCH_EDGE),
+									  (F32)GRIDS_PER_PATCH_EDGE, tex_size, ref_image);
+				}
+			}
+
+			// Stale composition, which the jobs must not blend from
+			std::vector<F32> layer(LAYER_WIDTH * LAYER_WIDTH, 3.f);
+			std::vector<U8> image(tex_size * tex_size * 3, 0);
+			S32 texels = 0;
+			for (S32 py = 0; py < PATCHES_PER_EDGE; py++)
+			{
+				for (S32 px = 0; px < PATCHES_PER_EDGE; px++)
+				{
+					LLTerrainTextureJob* job = make_texture_job(region, details, layer, px, py, tex_size);
+					job->run();
+					ensure("generated heights", job->generatedHeights());
+					ensure("generated texels", job->generatedTexels());
+					job->copyComposition(&layer[0]);
+					job->copyTexels(&image[0]);
+					texels += job->getTexelCount();
+					delete job;
+				}
+			}
+
+			ensure_equals("every texel once", texels, tex_size * tex_size);
+			ensure("composition matches the whole region", layer == ref_layer);
+			for (U32 i = 0; i < image.size(); i++)
+			{
+				if (image[i] != ref_image[i])
+				{
+					S32 texel = i / 3;
+					fail(llformat("%d texels: texel (%d, %d) is %d, whole region gave %d", tex_size,
+								  texel % tex_size, texel / tex_size, image[i], ref_image[i]));
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void terraingen_object_t::test<2>()
+	{
+		// LLSurfacePatch::eval() and calcNormal() at each grid point of a
+		// patch in the middle of the region and at its north east corner.
+		TestRegion region(0, 0);
+		const S32 patches[2][2] = { { 5, 9 }, { PATCHES_PER_EDGE - 1, PATCHES_PER_EDGE - 1 } };
+		const S32 points = GRIDS_PER_PATCH_EDGE + 1;
+		const F32 mpg = METERS_PER_GRID * 2;
+
+		for (S32 p = 0; p < 2; p++)
+		{
+			LLTerrainGeometryJob* job = make_geometry_job(region, patches[p][0], patches[p][1]);
+			job->run();
+			ensure_equals("vertex count", (S32)job->mVertices.size(), points * points);
+
+			LLVector3 origin_region(patches[p][0] * GRIDS_PER_PATCH_EDGE * METERS_PER_GRID,
+									patches[p][1] * GRIDS_PER_PATCH_EDGE * METERS_PER_GRID, 0.f);
+			LLVector3d origin_global = region.mOriginGlobal + LLVector3d(origin_region);
+			for (S32 y = 0; y < points; y++)
+			{
+				for (S32 x = 0; x < points; x++)
+				{
+					const LLTerrainVertex& vertex = job->mVertices[y*points + x];
+					F64 gx = origin_global.mdV[VX] + x * METERS_PER_GRID;
+					F64 gy = origin_global.mdV[VY] + y * METERS_PER_GRID;
+
+					LLVector3 position(x * METERS_PER_GRID, y * METERS_PER_GRID, terrain_height(gx, gy));
+					ensure("position", vertex.mPosition == position);
+
+					LLVector3 p00(-mpg, -mpg, terrain_height(gx - 2, gy - 2));
+					LLVector3 p01(-mpg, +mpg, terrain_height(gx - 2, gy + 2));
+					LLVector3 p10(+mpg, -mpg, terrain_height(gx + 2, gy - 2));
+					LLVector3 p11(+mpg, +mpg, terrain_height(gx + 2, gy + 2));
+					LLVector3 normal = p11 - p00;
+					normal %= p01 - p10;
+					normal.normVec();
+					ensure_distance("normal x", vertex.mNormal.mV[VX], normal.mV[VX], 1e-5f);
+					ensure_distance("normal y", vertex.mNormal.mV[VY], normal.mV[VY], 1e-5f);
+					ensure_distance("normal z", vertex.mNormal.mV[VZ], normal.mV[VZ], 1e-5f);
+
+					LLVector3 tex_pos = (origin_region + LLVector3(x * METERS_PER_GRID, y * METERS_PER_GRID, 0.f))
+										* (1.f/GRIDS_PER_EDGE);
+					ensure_distance("tex0 s", vertex.mTexCoord0.mV[0], tex_pos.mV[0], 1e-6f);
+					ensure_distance("tex0 t", vertex.mTexCoord0.mV[1], tex_pos.mV[1], 1e-6f);
+
+					const F32 xyScaleInv = (1.f / (4.9215f*7.f))*(0.2222222222f);
+					F32 vec[3] = {
+									fmodf((F32)(origin_global.mdV[0] + x)*xyScaleInv, 256.f),
+									fmodf((F32)(origin_global.mdV[1] + y)*xyScaleInv, 256.f),
+									0.f
+								};
+					ensure_equals("tex1 composition", vertex.mTexCoord1.mV[0], terrain_composition(gx, gy));
+					ensure_equals("tex1 noise", vertex.mTexCoord1.mV[1], llclamp(noise2(vec)* 0.75f + 0.5f, 0.f, 1.f));
+				}
+			}
+			delete job;
+		}
+	}
+
+	template<> template<>
+	void terraingen_object_t::test<3>()
+	{
+		// Every patch job of the 3x3 regions around the agent, run on the
+		// main thread and then on LLTerrainJobThread, which must give the
+		// same results.
+		std::vector<TestRegion> regions;
+		std::vector<std::vector<F32> > layers;
+		for (S32 y = 0; y < 3; y++)
+		{
+			for (S32 x = 0; x < 3; x++)
+			{
+				regions.push_back(TestRegion(x, y));
+				layers.push_back(std::vector<F32>(LAYER_WIDTH * LAYER_WIDTH, 0.f));
+			}
+		}
+		DetailImages details;
+
+		std::vector<LLTerrainJob*> inline_jobs;
+		std::vector<LLTerrainJob*> threaded_jobs;
+		for (U32 r = 0; r < regions.size(); r++)
+		{
+			make_region_jobs(regions[r], details, layers[r], inline_jobs);
+			make_region_jobs(regions[r], details, layers[r], threaded_jobs);
+		}
+
+		LLTimer timer;
+		for (U32 i = 0; i < inline_jobs.size(); i++)
+		{
+			inline_jobs[i]->run();
+		}
+		F64 inline_time = timer.getElapsedTimeF64();
+
+		LLTerrainJobThread thread;
+		std::vector<LLQueuedThread::handle_t> handles;
+		timer.reset();
+		for (U32 i = 0; i < threaded_jobs.size(); i++)
+		{
+			handles.push_back(thread.addJob(threaded_jobs[i]));
+		}
+		F64 queue_time = timer.getElapsedTimeF64();
+		for (U32 i = 0; i < handles.size(); i++)
+		{
+			thread.waitForResult(handles[i], false);
+		}
+		F64 threaded_time = timer.getElapsedTimeF64();
+
+		for (U32 i = 0; i < handles.size(); i++)
+		{
+			LLTerrainJob* job = thread.getFinishedJob(handles[i]);
+			ensure("job finished", job == threaded_jobs[i]);
+			if (i % 2 == 0)
+			{
+				const LLTerrainTextureJob* a = (const LLTerrainTextureJob*)inline_jobs[i];
+				const LLTerrainTextureJob* b = (const LLTerrainTextureJob*)job;
+				std::vector<F32> layer_a(LAYER_WIDTH * LAYER_WIDTH, 0.f);
+				std::vector<F32> layer_b(LAYER_WIDTH * LAYER_WIDTH, 0.f);
+				std::vector<U8> image_a(SURFACE_TEX_SIZE * SURFACE_TEX_SIZE * 3, 0);
+				std::vector<U8> image_b(SURFACE_TEX_SIZE * SURFACE_TEX_SIZE * 3, 0);
+				a->copyComposition(&layer_a[0]);
+				b->copyComposition(&layer_b[0]);
+				a->copyTexels(&image_a[0]);
+				b->copyTexels(&image_b[0]);
+				ensure("threaded composition", layer_a == layer_b);
+				ensure("threaded texels", image_a == image_b);
+			}
+			else
+			{
+				ensure("threaded vertices", same_vertices(((LLTerrainGeometryJob*)inline_jobs[i])->mVertices,
+														  ((LLTerrainGeometryJob*)job)->mVertices));
+			}
+			thread.completeJob(handles[i]);
+			delete inline_jobs[i];
+		}
+
+		llinfos << "Terrain jobs: " << regions.size() << " regions, " << inline_jobs.size() << " jobs: main thread "
+				<< llformat("%.2f", inline_time * 1000.0) << " ms, threaded "
+				<< llformat("%.2f", threaded_time * 1000.0) << " ms until done, "
+				<< llformat("%.2f", queue_time * 1000.0) << " ms of it queueing" << llendl;
+	}
+}
@@ -0,0 +1,130 @@
+/**
+ * @file llthreadpool_tut.cpp
+ * @brief Tests for LLThreadPool
+ *
+ * Copyright (c) 2012, Imprudence Viewer Project
+ *
+ * The source code in this file ("Source Code") is provided to you
+ * under the terms of the GNU General Public License, version 2.0
+ * ("GPL"). Terms of the GPL can be found in doc/GPL-license.txt in
+ * this distribution, or online at
+ * http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL SOURCE CODE IS PROVIDED "AS IS." THE AUTHOR MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ */
+
+#include <tut/tut.hpp>
+
+#include "linden_common.h"
+#include "llthreadpool.h"
+#include "lltut.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// Adds each index into its own slot, so a lost or doubled index shows up.
+	class CountJob : public LLThreadPool::Job
+	{
+	public:
+		CountJob(S32 count) : mHits(count, 0) {}
+
+		/*virtual*/ void run(S32 begin, S32 end)
+		{
+			for (S32 i = begin; i < end; i++)
+			{
+				mHits[i] += i + 1;
+			}
+		}
+
+		bool allOnce() const
+		{
+			for (S32 i = 0; i < (S32)mHits.size(); i++)
+			{
+				if (mHits[i] != i + 1)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void clear()	{ std::fill(mHits.begin(), mHits.end(), 0); }
+
+	private:
+		std::vector<S32> mHits;
+	};
+}
+
+namespace tut
+{
+	struct threadpool
+	{
+	};
+
+	typedef test_group<threadpool> threadpool_t;
+	typedef threadpool_t::object threadpool_object_t;
+	tut::threadpool_t tut_threadpool("threadpool");
+
+	template<> template<>
+	void threadpool_object_t::test<1>()
+	{
+		// no threads: the loop runs on the caller in one chunk
+		LLThreadPool pool("tut", 0);
+		CountJob job(1000);
+		pool.parallelFor(job, 1000, 10);
+		ensure("inline loop covers every index once", job.allOnce());
+		ensure_equals("inline loop is one chunk", pool.getLastChunkCount(), 1);
+		ensure_equals("inline loop ran on caller", pool.getLastWorkerChunkCount(), 0);
+	}
+
+	template<> template<>
+	void threadpool_object_t::test<2>()
+	{
+		LLThreadPool pool("tut", 3);
+		ensure_equals("thread count", pool.getThreadCount(), 3);
+
+		CountJob job(10007);
+		pool.parallelFor(job, 10007, 64);
+		ensure("threaded loop covers every index once", job.allOnce());
+		ensure_equals("chunk count", pool.getLastChunkCount(), (10007 + 63) / 64);
+	}
+
+	template<> template<>
+	void threadpool_object_t::test<3>()
+	{
+		// many short loops back to back must neither hang nor leak work between loops
+		LLThreadPool pool("tut", 4);
+		CountJob job(257);
+		for (S32 i = 0; i < 2000; i++)
+		{
+			job.clear();
+			pool.parallelFor(job, 257, 1 + (i % 17));
+			ensure("repeated loop covers every index once", job.allOnce());
+		}
+
+		// small loops and disabled threading stay on the caller
+		job.clear();
+		pool.parallelFor(job, 257, 200);
+		ensure("small loop covers every index once", job.allOnce());
+		ensure_equals("small loop ran on caller", pool.getLastWorkerChunkCount(), 0);
+
+		job.clear();
+		pool.parallelFor(job, 257, 1, false);
+		ensure("unthreaded loop covers every index once", job.allOnce());
+		ensure_equals("unthreaded loop ran on caller", pool.getLastWorkerChunkCount(), 0);
+	}
+}